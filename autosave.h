@@ -18,6 +18,9 @@
 #define __RARCH_AUTOSAVE_H
 
 #include <stddef.h>
+#include <stdint.h>
+
+#include <boolean.h>
 
 #include <retro_common_api.h>
 
@@ -37,10 +40,42 @@ void autosave_lock(void);
  **/
 void autosave_unlock(void);
 
-bool autosave_init(bool compress_files, unsigned autosave_interval);
+bool autosave_init(bool compress_files, bool compress_zstd,
+      unsigned compress_level, unsigned autosave_interval);
 
 void autosave_deinit(void);
 
+/**
+ * autosave_journal_write:
+ * @path            : path to the save file
+ * @data            : the save file's new contents
+ * @len             : size of @data, which the file must already be
+ * @dirty           : one byte per @block_size block of @data,
+ *                    non-zero for each block that changed
+ * @block_size      : size of the blocks @dirty maps
+ *
+ * Writes the changed blocks of @data to the journal beside @path,
+ * for autosave_journal_replay() to write over the file in place.
+ *
+ * @return true if a journal was written; false on error, or if no
+ * block changed.
+ **/
+bool autosave_journal_write(const char *path,
+      const void *data, size_t len,
+      const uint8_t *dirty, size_t block_size);
+
+/**
+ * autosave_journal_replay:
+ * @path            : path to the save file
+ *
+ * Writes a journal left beside @path over the file, then deletes it.
+ * A journal that is incomplete, or for a file of another size, is
+ * deleted with @path left as it was.
+ *
+ * @return true if a journal was replayed.
+ **/
+bool autosave_journal_replay(const char *path);
+
 RETRO_END_DECLS
 
 #endif
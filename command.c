@@ -1058,6 +1058,7 @@ bool command_write_ram(command_t *cmd, const char *arg)
       *data = strtoul(arg, (char**)&arg, 16);
       data++;
    }
+   content_state_snapshot_invalidate();
    return true;
 }
 #endif
@@ -1472,6 +1473,10 @@ bool command_write_memory(command_t *cmd, const char *arg)
          data++;
       }
 
+      /* Poked bytes are not in any snapshot taken before them */
+      if (data != start)
+         content_state_snapshot_invalidate();
+
       snprintf(reply_at, sizeof(reply) - strlen(reply) - 1,
             " %u\n", (unsigned)(data - start));
 
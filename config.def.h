@@ -1454,6 +1454,9 @@
 
 #define DEFAULT_NETPLAY_NAT_TRAVERSAL false
 
+/* Also send input over UDP, a few frames per datagram */
+#define DEFAULT_NETPLAY_UDP_INPUT false
+
 #define DEFAULT_NETPLAY_CHECK_FRAMES 600
 
 #define DEFAULT_NETPLAY_USE_MITM_SERVER false
@@ -1547,6 +1550,11 @@
 #define DEFAULT_SAVESTATE_FILE_COMPRESSION true
 #endif
 
+/* When compressing save and save state files,
+ * use zstd rather than deflate, at this level */
+#define DEFAULT_SAVE_COMPRESSION_ZSTD false
+#define DEFAULT_SAVE_COMPRESSION_ZSTD_LEVEL 3
+
 /* Slowmotion ratio. */
 #define DEFAULT_SLOWMOTION_RATIO 3.0f
 
@@ -218,6 +218,7 @@ typedef struct settings
       unsigned replay_checkpoint_interval;
       unsigned replay_max_keep;
       unsigned savestate_max_keep;
+      unsigned save_compression_zstd_level;
       unsigned network_cmd_port;
       unsigned network_remote_base_port;
       unsigned keymapper_port;
@@ -854,6 +855,7 @@ typedef struct settings
       bool netplay_allow_slaves;
       bool netplay_require_slaves;
       bool netplay_nat_traversal;
+      bool netplay_udp_input;
       bool netplay_use_mitm_server;
       bool netplay_request_devices[MAX_USERS];
       bool netplay_ping_show;
@@ -957,6 +959,7 @@ typedef struct settings
       bool savestate_thumbnail_enable;
       bool save_file_compression;
       bool savestate_file_compression;
+      bool save_compression_zstd;
       bool network_cmd_enable;
       bool stdin_cmd_enable;
       bool keymapper_enable;
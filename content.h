@@ -63,6 +63,12 @@ bool content_auto_save_state(const char *path);
 /* Check a ram state write to disk. */
 bool content_ram_state_pending(void);
 
+/* Marks the core's state as moved on, so no save shares a snapshot
+ * taken before it.  Called wherever the core runs, resets or
+ * unserializes, and wherever its memory, cheats or disk tray are
+ * changed from outside. */
+void content_state_snapshot_invalidate(void);
+
 /* Gets the number of bytes required to serialize the state. */
 size_t content_get_serialized_size(void);
 
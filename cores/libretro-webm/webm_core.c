@@ -658,9 +658,16 @@ void WEBM_CORE_PREFIX(retro_get_system_av_info)(
 
 void WEBM_CORE_PREFIX(retro_set_environment)(retro_environment_t cb)
 {
+   static const struct retro_variable vars[] = {
+#ifdef HAVE_RMP4
+      { "webm_decoder_threads", "Video decoder thread count (restart); auto|1|2|4|6|8|10|12|14|16" },
+#endif
+      { NULL, NULL },
+   };
    struct retro_log_callback log;
    struct retro_vfs_interface_info vfs;
    WEBM_CORE_PREFIX(environ_cb) = cb;
+   cb(RETRO_ENVIRONMENT_SET_VARIABLES, (void*)vars);
    if (cb(RETRO_ENVIRONMENT_GET_LOG_INTERFACE, &log))
       WEBM_CORE_PREFIX(log_cb) = log.log;
    /* Route file access through the frontend's VFS when it offers
@@ -1552,6 +1559,17 @@ static bool webm_load_mp4(webm_player_t *p)
     * interleave stage at no per-frame cost), so the per-frame copy
     * below needs no per-pixel swizzle. */
    rmp4_video_stream_set_argb(p->mp4vs, 1);
+   {
+      /* H.265 wavefront slices spread their CTB rows over this many
+       * threads; "auto" leaves the choice (one per core) to rh265 */
+      struct retro_variable var;
+      var.key   = "webm_decoder_threads";
+      var.value = NULL;
+      if (WEBM_CORE_PREFIX(environ_cb)(RETRO_ENVIRONMENT_GET_VARIABLE, &var)
+            && var.value && strcmp(var.value, "auto"))
+         rmp4_video_stream_set_threads(p->mp4vs,
+               (unsigned)strtoul(var.value, NULL, 10));
+   }
    rmp4_video_stream_get_info(p->mp4vs, &w, &h, &nframes, &loops);
    if (!w || !h)
       return false;
@@ -23,6 +23,7 @@
 #include <string/stdstring.h>
 #include <file/file_path.h>
 
+#include "content.h"
 #include "paths.h"
 #include "retroarch.h"
 #include "verbosity.h"
@@ -343,6 +344,9 @@ bool disk_control_set_eject_state(
    if (!disk_control || !disk_control->cb.set_eject_state)
       return err;
 
+   /* The tray is part of the core's state */
+   content_state_snapshot_invalidate();
+
    /* Set eject state */
    if (disk_control->cb.set_eject_state(eject))
       _len = strlcpy(msg,
@@ -432,6 +436,7 @@ bool disk_control_set_index(
    num_images = disk_control->cb.get_num_images();
 
    /* Perform 'set index' action */
+   content_state_snapshot_invalidate();
    err = !disk_control->cb.set_image_index(index);
 
    /* Get log/notification message */
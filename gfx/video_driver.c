@@ -61,6 +61,9 @@
 
 #include "../audio/audio_driver.h"
 #include "../frontend/frontend_driver.h"
+#ifdef HAVE_NETWORKING
+#include "../network/netplay/netplay.h"
+#endif
 #include "../record/record_driver.h"
 #include "../ui/ui_companion_driver.h"
 #include "../input/input_overlay.h"
@@ -5553,6 +5556,38 @@ void video_driver_frame(const void *data, unsigned width,
                   " Run-Ahead: %u Preempt\n",
                   video_info.runahead_frames);
 
+#ifdef HAVE_NETWORKING
+         {
+            netplay_rollback_stats_t rb;
+            if (     __len < sizeof(video_info.stat_text)
+                  && netplay_driver_ctl(RARCH_NETPLAY_CTL_GET_ROLLBACK_STATS, &rb)
+                  && rb.frames)
+            {
+               __len += snprintf(video_info.stat_text + __len, sizeof(video_info.stat_text) - __len,
+                     "NETPLAY\n"
+                     " Rollback:   %5.2f fr\n"
+                     " -Max:       %5u fr\n"
+                     " -Stalled:   %5u fr\n"
+                     " Save:       %5.2f ms\n"
+                     " Load:       %5.2f ms\n"
+                     " Replay:     %5.2f ms\n"
+                     " Net I/O:    %5.2f ms\n"
+                     " Stall:      %5.2f ms\n",
+                     (float)rb.replayed / rb.frames,
+                     rb.max_replayed,
+                     rb.stalled,
+                     rb.serialize_usec   / 1000.0f,
+                     rb.unserialize_usec / 1000.0f,
+                     rb.replay_usec      / 1000.0f,
+                     rb.net_usec         / 1000.0f,
+                     rb.stall_usec       / 1000.0f);
+               /* The overlay is full; show what fit. */
+               if (__len >= sizeof(video_info.stat_text))
+                  __len = sizeof(video_info.stat_text) - 1;
+            }
+         }
+#endif
+
          /* Tracked length of stat_text; consumed by driver frame()
           * callbacks instead of strlen on every frame. */
          video_info.stat_text_len = __len;
@@ -104,6 +104,7 @@ COMPATIBILITY
 #include "../libretro-common/compat/fopen_utf8.c"
 #include "../libretro-common/memmap/memalign.c"
 #include "../libretro-common/memmap/memcpy_nt.c"
+#include "../libretro-common/memmap/memdiff.c"
 /* data_transfer's streaming window reserves address space through
  * memreserve()/memcommit(); those live here. */
 #include "../libretro-common/memmap/memmap.c"
@@ -161,6 +162,9 @@ COMPRESSION
 #endif
 #include "../libretro-common/streams/trans_stream_deflate.c"
 #include "../libretro-common/streams/rzip_stream.c"
+#if defined(HAVE_ZSTD) || defined(HAVE_RZSTD)
+#include "../libretro-common/streams/trans_stream_zstd.c"
+#endif
 
 #ifdef HAVE_ZLIB
 #include "../libretro-common/streams/trans_stream_zlib.c"
@@ -1364,6 +1368,7 @@ THREAD
 #endif
 
 #include "../libretro-common/rthreads/rthreads.c"
+#include "../libretro-common/rthreads/tpool.c"
 #include "../gfx/video_thread_wrapper.c"
 #include "../audio/audio_thread_wrapper.c"
 #endif
@@ -1376,8 +1381,11 @@ NETPLAY
 ============================================================ */
 #ifdef HAVE_NETWORKING
 #include "../network/natt.c"
+#include "../network/netplay/netplay_delta.c"
 #include "../network/netplay/netplay_frontend.c"
+#include "../network/netplay/netplay_pages.c"
 #include "../network/netplay/netplay_room_parse.c"
+#include "../network/netplay/netplay_udp.c"
 #include "../libretro-common/net/net_compat.c"
 #include "../libretro-common/net/net_socket.c"
 #include "../libretro-common/net/net_http.c"
@@ -1430,6 +1438,7 @@ DATA RUNLOOP
 #include "../tasks/task_database.c"
 #ifdef HAVE_LIBRETRODB
 #include "../tasks/task_database_cue.c"
+#include "../tasks/task_database_scan_cache.c"
 #endif
 #if defined(HAVE_NETWORKING) && defined(HAVE_MENU)
 #include "../tasks/task_core_updater.c"
@@ -1760,13 +1769,6 @@ ANDROID PLAY FEATURE DELIVERY
 #endif
 
 
-/*============================================================
-FFMPEG
-============================================================ */
-#ifdef HAVE_FFMPEG
-#include "../libretro-common/rthreads/tpool.c"
-#endif
-
 /*============================================================
 STEAM INTEGRATION USING MIST
 ============================================================ */
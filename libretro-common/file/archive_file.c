@@ -619,6 +619,30 @@ bool file_archive_perform_mode(const char *path, const char *valid_exts,
    return ret == 1;
 }
 
+bool file_archive_can_perform_detached(const file_archive_transfer_t *state)
+{
+   return     state
+         &&   state->type    == ARCHIVE_TRANSFER_ITERATE
+         &&   state->context
+         &&   state->backend
+         &&   state->backend->stream_decompress_data_to_file_detached;
+}
+
+bool file_archive_perform_mode_detached(file_archive_transfer_t *state,
+      const char *path, const uint8_t *cdata, unsigned cmode,
+      uint32_t csize, uint32_t size)
+{
+   /* Nothing here may touch the transfer beyond reading it: this runs
+    * on worker threads while the walk goes on stepping the same
+    * transfer on its own thread. */
+   if (!state || !state->backend || !state->context
+         || !state->backend->stream_decompress_data_to_file_detached)
+      return false;
+
+   return state->backend->stream_decompress_data_to_file_detached(
+         state->context, cdata, cmode, csize, size, path);
+}
+
 /**
  * file_archive_filename_split:
  * @str              : filename to turn into a string list
@@ -510,6 +510,7 @@ const struct file_archive_file_backend sevenzip_backend = {
    sevenzip_parse_file_free,
    sevenzip_stream_decompress_data_to_file_init,
    sevenzip_stream_decompress_data_to_file_iterate,
+   NULL,
    encoding_crc32,
    sevenzip_file_read,
    "7z"
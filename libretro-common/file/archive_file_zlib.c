@@ -83,6 +83,9 @@ enum file_archive_compression_mode
 typedef struct
 {
    struct file_archive_transfer *state;
+   /* The archive itself, for detached decodes to open their own
+    * handle on when it is not mapped. Lives after the directory. */
+   char *archive_path;
    uint8_t *directory;
    uint8_t *directory_entry;
    uint8_t *directory_end;
@@ -474,6 +477,67 @@ static int zlib_stream_decompress_data_to_file_iterate(
    return -1;
 }
 
+/* Decodes one member start to finish into path, on a stream and
+ * buffers of its own rather than the walk's. The walk's context is
+ * only read - for the mapping, or for the archive's path when there
+ * is none to share - so any number of these can run on worker threads
+ * at once while the walk steps on through the directory. Going
+ * through the ordinary init and iterate keeps every bounds check on
+ * the member exactly as it is for the serial path. */
+static bool zlib_stream_decompress_data_to_file_detached(void *context,
+      const uint8_t *cdata, unsigned cmode, uint32_t csize, uint32_t size,
+      const char *path)
+{
+   struct zip_detached
+   {
+      struct file_archive_transfer state;
+      zip_context_t zip;
+   } *d;
+   zip_context_t *shared             = (zip_context_t*)context;
+   file_archive_file_handle_t handle = {0};
+   bool mapped                       = false;
+   bool ret                          = false;
+   int rv;
+
+   /* The transfer carries a PATH_MAX_LENGTH buffer of its own, too
+    * much for a worker's stack, so both halves go on the heap. */
+   if (!(d = (struct zip_detached*)calloc(1, sizeof(*d))))
+      return false;
+
+   d->state.archive_size = shared->state->archive_size;
+   d->state.backend      = &zlib_backend;
+   d->zip.state          = &d->state;
+#ifdef HAVE_MMAP
+   d->state.archive_mmap_data = shared->state->archive_mmap_data;
+   mapped                     = (d->state.archive_mmap_data != NULL);
+#endif
+
+   /* A file handle's position is shared state; unmapped, each decode
+    * seeks and reads through one of its own. */
+   if (!mapped && !(d->state.archive_file = filestream_open(
+               shared->archive_path, RETRO_VFS_FILE_ACCESS_READ,
+               RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+      goto end;
+
+   if (zlib_stream_decompress_data_to_file_init(&d->zip, &handle,
+            cdata, cmode, csize, size))
+   {
+      do
+      {
+         rv = zlib_stream_decompress_data_to_file_iterate(&d->zip, &handle);
+      } while (rv == 0);
+
+      ret = (rv == 1) && filestream_write_file(path, handle.data, size);
+   }
+
+   zip_context_free_stream(&d->zip, false);
+   if (d->state.archive_file)
+      filestream_close(d->state.archive_file);
+end:
+   free(d);
+   return ret;
+}
+
 static bool zip_file_decompressed_handle(
       file_archive_transfer_t *transfer,
       file_archive_file_handle_t* handle,
@@ -640,6 +704,7 @@ static int zip_parse_file_init(file_archive_transfer_t *state,
    int64_t read_block = MIN(read_pos, (ssize_t)sizeof(footer_buf));
    int64_t directory_size, directory_offset;
    zip_context_t *zip_context = NULL;
+   size_t path_size           = strlen(file) + 1;
 
    /* Minimal ZIP file size is 22 bytes */
    if (read_block < 22)
@@ -695,17 +760,22 @@ static int zip_parse_file_init(file_archive_transfer_t *state,
     *     sizeof(zip_context_t) + (size_t)directory_size
     * to a tiny value, after which directory_end runs off the end of
     * the allocation. */
-   if ((size_t)directory_size > SIZE_MAX - sizeof(zip_context_t))
+   if ((size_t)directory_size > SIZE_MAX - sizeof(zip_context_t) - path_size)
       return -1;
 
-   /* This is a ZIP file, allocate one block of memory for both the
-    * context and the entire directory, then read the directory.
+   /* This is a ZIP file, allocate one block of memory for the
+    * context, the entire directory and the archive's path, then read
+    * the directory.
     */
-   zip_context = (zip_context_t*)malloc(sizeof(zip_context_t) + (size_t)directory_size);
+   zip_context = (zip_context_t*)malloc(sizeof(zip_context_t)
+         + (size_t)directory_size + path_size);
    if (!zip_context)
       return -1;
    zip_context->state             = state;
    zip_context->directory         = (uint8_t*)(zip_context + 1);
+   zip_context->archive_path      = (char*)zip_context->directory
+      + (size_t)directory_size;
+   memcpy(zip_context->archive_path, file, path_size);
    zip_context->directory_entry   = zip_context->directory;
    zip_context->directory_end     = zip_context->directory + (size_t)directory_size;
    zip_context->zstream           = NULL;
@@ -1177,6 +1247,7 @@ const struct file_archive_file_backend zlib_backend = {
    zip_parse_file_free,
    zlib_stream_decompress_data_to_file_init,
    zlib_stream_decompress_data_to_file_iterate,
+   zlib_stream_decompress_data_to_file_detached,
    encoding_crc32,
    zip_file_read,
    "zlib"
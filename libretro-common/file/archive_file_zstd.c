@@ -404,6 +404,7 @@ const struct file_archive_file_backend zstd_backend = {
    zstd_parse_file_free,
    zstd_stream_decompress_data_to_file_init,
    zstd_stream_decompress_data_to_file_iterate,
+   NULL,
    encoding_crc32,
    zstd_file_read,
    "zstd"
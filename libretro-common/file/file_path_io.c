@@ -143,6 +143,34 @@ int64_t path_get_size(const char *path)
    return -1;
 }
 
+/**
+ * path_get_size_and_mtime:
+ * @path               : path
+ * @size               : receives the size in bytes
+ * @mtime              : receives the modification time, seconds since
+ *                       the epoch
+ *
+ * One stat for both, for callers that want to know whether a file
+ * changed without reading it.  The libretro VFS has no modification
+ * time, so this only answers through the built-in implementation and
+ * fails once a core has installed its own.
+ *
+ * @return true if both were filled in.
+ **/
+bool path_get_size_and_mtime(const char *path, int64_t *size,
+      int64_t *mtime)
+{
+   int64_t t = 0;
+
+   if (path_stat64_cb != retro_vfs_stat_64_impl)
+      return false;
+   if (!(retro_vfs_stat_mtime_impl(path, size, &t) & RETRO_VFS_STAT_IS_VALID)
+         || t <= 0)
+      return false;
+   *mtime = t;
+   return true;
+}
+
 /**
  * path_mkdir:
  * @dir                : directory
@@ -50,6 +50,11 @@
 
 #include <encodings/crc32.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#include <features/features_cpu.h>
+#endif
+
 #include <7z/r7z_archive.h>
 #include <7z/r7z_lzma.h>
 #include <7z/r7z_lzma_stream.h>
@@ -343,6 +348,20 @@ struct r7z_archive
    size_t         cached_len;
    uint32_t       cached_folder;
 
+   /* The folder completed before cached_folder, so that a caller
+    * walking the folders in order can be told from one hopping between
+    * them. Only the former is worth decoding ahead for. */
+   uint32_t       prev_folder;
+
+   /* Worker threads for LZMA2 and folder read-ahead: 0 picks one per
+    * core, 1 keeps everything on the calling thread. */
+   unsigned       threads;
+#ifdef HAVE_THREADS
+   /* The next folder, being decoded on its own thread while the caller
+    * consumes this one. NULL when none is in flight. */
+   struct r7z_ahead *ahead;
+#endif
+
    /* A folder decode that has been started and paused part way.
     *
     * Only the LZMA and LZMA2 stages pause: they are 97% of the time
@@ -359,6 +378,10 @@ struct r7z_archive
    uint8_t       *pend_out;        /* buffer being filled */
    size_t         pend_out_len;
    void          *pend_dec;        /* rlzma2_dec_t, when one is live */
+#ifdef HAVE_THREADS
+   /* An LZMA2 stage split across workers instead, see lzma2_mt_t. */
+   struct lzma2_mt *pend_mt;
+#endif
    uint16_t      *pend_probs;
    size_t         pend_fed;        /* input consumed by this stage */
    uint32_t       pend_base;       /* coder_unpack_sizes base for folder */
@@ -391,6 +414,14 @@ struct r7z_archive
  * r7z_archive_close() has to release a decode left in flight. */
 static void decode_pending_reset(r7z_archive_t *a);
 
+/* Likewise the folder cache, which a closing archive hands its last
+ * folder to. */
+static void r7z_cache_give(const r7z_archive_t *a, uint32_t fi,
+      uint8_t *data, size_t len);
+#ifdef HAVE_THREADS
+static void r7z_ahead_keep(r7z_archive_t *a);
+#endif
+
 /* --------------------------------------------------------------------
  * CRC32
  * -------------------------------------------------------------------- */
@@ -1364,6 +1395,357 @@ fail:
    return res;
 }
 
+/* --------------------------------------------------------------------
+ * LZMA2 across threads
+ *
+ * An LZMA2 stream is a run of chunks, and a chunk that resets the
+ * dictionary (control 0x01, or 0xE0 and up) can never refer back past
+ * itself. Everything from one such chunk to the next is therefore a
+ * stream of its own. The chunk headers give each chunk's packed and
+ * unpacked size, so those runs can be found without decoding anything
+ * and then decoded side by side, each into its own stretch of the
+ * output buffer.
+ *
+ * Multithreaded 7-Zip, the default on any machine with more than one
+ * core, resets the dictionary at the start of every block it gave a
+ * thread, so a large solid folder from it comes apart into as many
+ * runs as it was written with. A stream written on one thread is one
+ * run, and decodes on the calling thread exactly as before.
+ * -------------------------------------------------------------------- */
+
+/* Ceiling on workers for one stream, and on the whole-archive setting. */
+#define R7Z_MAX_THREADS 16
+
+/* Output each worker produces between looks at its stop flag, so that
+ * an abandoned decode is torn down within a few milliseconds rather
+ * than after a whole run. */
+#define R7Z_MT_STEP (1024 * 1024)
+
+typedef struct
+{
+   size_t in_off;
+   size_t in_len;
+   size_t out_off;
+   size_t out_len;
+} lzma2_run_t;
+
+/* Advance an LZMA2 decode until it has written `limit` bytes of its
+ * window. Sets *done once all out_len are there. Shared by the
+ * whole-folder decoder, the slicer and the workers, which differ only
+ * in how far they ask for at a time. */
+static int lzma2_step(rlzma2_dec_t *dec, const uint8_t *in, size_t in_len,
+      size_t *fed, size_t out_len, size_t limit, int *done)
+{
+   size_t got    = in_len - *fed;
+   size_t before = dec->lzma.dic_pos;
+   int    status;
+
+   *done = 0;
+
+   if (rlzma2_dec_decode(dec, limit, in + *fed, &got, 1, &status)
+         != RLZMA_OK)
+      return R7Z_ERROR_DATA;
+
+   *fed += got;
+
+   if (dec->lzma.dic_pos >= out_len || status == RLZMA2_STATUS_FINISHED)
+   {
+      if (dec->lzma.dic_pos != out_len)
+         return R7Z_ERROR_DATA;
+      *done = 1;
+      return R7Z_OK;
+   }
+
+   /* No input consumed and none left, or no progress of any kind: the
+    * stream ended early, and calling again would only spin. */
+   if (got == 0 && (*fed >= in_len || dec->lzma.dic_pos == before))
+      return R7Z_ERROR_DATA;
+
+   return R7Z_OK;
+}
+
+#ifdef HAVE_THREADS
+/* Walk the chunk headers of an LZMA2 stream and cut it at every
+ * dictionary reset. Returns the number of runs, or 0 when the headers
+ * do not describe exactly out_len bytes of output: the stream is then
+ * left to the serial decoder, which finds and reports whatever is
+ * wrong with it in the usual way. */
+static uint32_t lzma2_find_runs(const uint8_t *in, size_t in_len,
+      size_t out_len, lzma2_run_t **out_runs)
+{
+   lzma2_run_t *runs = NULL;
+   uint32_t     num  = 0;
+   uint32_t     cap  = 0;
+   size_t       ip   = 0;
+   size_t       op   = 0;
+
+   while (op < out_len)
+   {
+      uint8_t ctl;
+      size_t  hdr, unpack, pack;
+
+      if (ip >= in_len)
+         goto fail;
+      ctl = in[ip];
+
+      if (ctl & 0x80)
+      {
+         hdr = (ctl & 0x40) ? 6 : 5;
+         if (hdr > in_len - ip)
+            goto fail;
+         unpack = ((((size_t)ctl & 0x1F) << 16)
+               | ((size_t)in[ip + 1] << 8) | in[ip + 2]) + 1;
+         pack   = (((size_t)in[ip + 3] << 8) | in[ip + 4]) + 1;
+      }
+      else if (ctl == 1 || ctl == 2)
+      {
+         hdr = 3;
+         if (hdr > in_len - ip)
+            goto fail;
+         unpack = (((size_t)in[ip + 1] << 8) | in[ip + 2]) + 1;
+         pack   = unpack;
+      }
+      else
+         goto fail;
+
+      if (pack > in_len - ip - hdr || unpack > out_len - op)
+         goto fail;
+
+      if (ctl == 1 || ctl >= 0xE0)
+      {
+         if (num == cap)
+         {
+            lzma2_run_t *n;
+            cap = cap ? cap * 2 : 16;
+            if (!(n = (lzma2_run_t *)realloc(runs, cap * sizeof(*runs))))
+               goto fail;
+            runs = n;
+         }
+         if (num)
+            runs[num - 1].in_len = ip - runs[num - 1].in_off;
+         runs[num].in_off  = ip;
+         runs[num].out_off = op;
+         num++;
+      }
+      else if (!num)
+         goto fail;   /* must open with a reset */
+
+      runs[num - 1].out_len = op + unpack - runs[num - 1].out_off;
+      ip += hdr + pack;
+      op += unpack;
+   }
+
+   /* Anything after the last chunk the folder needs has to be the end
+    * marker, as the serial decoder would insist. */
+   if (!num || (ip < in_len && in[ip] != 0))
+      goto fail;
+   runs[num - 1].in_len = ip - runs[num - 1].in_off;
+
+   *out_runs = runs;
+   return num;
+
+fail:
+   free(runs);
+   return 0;
+}
+
+/* One LZMA2 stream being decoded by a set of workers. Each claims the
+ * next undecoded run until none are left; nothing else is shared
+ * between them but the output buffer, which the runs partition. */
+typedef struct lzma2_mt
+{
+   const uint8_t *in;
+   uint8_t       *out;
+   lzma2_run_t   *runs;
+   uint32_t       num_runs;
+   uint8_t        prop;
+
+   slock_t       *lock;
+   uint32_t       next;      /* first run nobody has claimed */
+   unsigned       active;    /* workers, the caller included, still going */
+   int            stop;      /* set when the decode is abandoned */
+   int            res;       /* first failure, R7Z_OK if none */
+
+   sthread_t     *threads[R7Z_MAX_THREADS];
+   unsigned       num_threads;
+} lzma2_mt_t;
+
+static unsigned r7z_thread_count(const r7z_archive_t *a)
+{
+   unsigned n = a->threads ? a->threads : cpu_features_get_core_amount();
+   if (n > R7Z_MAX_THREADS)
+      n = R7Z_MAX_THREADS;
+   return n ? n : 1;
+}
+
+static void lzma2_mt_worker(void *data)
+{
+   lzma2_mt_t   *mt    = (lzma2_mt_t *)data;
+   rlzma2_dec_t *dec   = (rlzma2_dec_t *)malloc(sizeof(*dec));
+   uint16_t     *probs = (uint16_t *)malloc(RLZMA2_NUM_PROBS
+         * sizeof(uint16_t));
+   int           res   = (dec && probs) ? R7Z_OK : R7Z_ERROR_MEM;
+   int           stop  = 0;
+
+   while (res == R7Z_OK && !stop)
+   {
+      const lzma2_run_t *run;
+      uint32_t           i;
+      size_t             fed  = 0;
+      int                done = 0;
+
+      slock_lock(mt->lock);
+      i    = mt->next;
+      stop = mt->stop || mt->res != R7Z_OK || i >= mt->num_runs;
+      if (!stop)
+         mt->next++;
+      slock_unlock(mt->lock);
+      if (stop)
+         break;
+
+      run = &mt->runs[i];
+      if (rlzma2_dec_init(dec, mt->prop, probs,
+               mt->out + run->out_off, run->out_len) != RLZMA_OK)
+      {
+         res = R7Z_ERROR_DATA;
+         break;
+      }
+
+      while (!done)
+      {
+         size_t limit = dec->lzma.dic_pos + R7Z_MT_STEP;
+         if (limit > run->out_len)
+            limit = run->out_len;
+
+         if ((res = lzma2_step(dec, mt->in + run->in_off, run->in_len,
+                     &fed, run->out_len, limit, &done)) != R7Z_OK)
+            break;
+
+         slock_lock(mt->lock);
+         stop = mt->stop || mt->res != R7Z_OK;
+         slock_unlock(mt->lock);
+         if (stop)
+            break;
+      }
+   }
+
+   free(dec);
+   free(probs);
+
+   slock_lock(mt->lock);
+   if (res != R7Z_OK && mt->res == R7Z_OK)
+      mt->res = res;
+   mt->active--;
+   slock_unlock(mt->lock);
+}
+
+/* Start decoding an LZMA2 stream on workers. With `join` set the
+ * calling thread is expected to run lzma2_mt_worker() itself as well,
+ * so one fewer thread is spawned.
+ *
+ * Returns NULL whenever the stream should simply be decoded serially:
+ * one run, one core, or no threads to be had. */
+static lzma2_mt_t *lzma2_mt_start(const r7z_archive_t *a, uint8_t prop,
+      const uint8_t *in, size_t in_len, uint8_t *out, size_t out_len,
+      int join)
+{
+   lzma2_mt_t  *mt;
+   lzma2_run_t *runs = NULL;
+   uint32_t     num_runs;
+   unsigned     want = r7z_thread_count(a);
+   unsigned     i;
+
+   if (want < 2 || out_len == 0)
+      return NULL;
+   if ((num_runs = lzma2_find_runs(in, in_len, out_len, &runs)) < 2)
+   {
+      free(runs);
+      return NULL;
+   }
+   if (want > num_runs)
+      want = num_runs;
+   if (join)
+      want--;
+
+   if (!(mt = (lzma2_mt_t *)calloc(1, sizeof(*mt))))
+   {
+      free(runs);
+      return NULL;
+   }
+   mt->in       = in;
+   mt->out      = out;
+   mt->runs     = runs;
+   mt->num_runs = num_runs;
+   mt->prop     = prop;
+   mt->res      = R7Z_OK;
+   mt->active   = join ? 1 : 0;
+   if (!(mt->lock = slock_new()))
+   {
+      free(runs);
+      free(mt);
+      return NULL;
+   }
+
+   for (i = 0; i < want; i++)
+   {
+      slock_lock(mt->lock);
+      mt->active++;
+      slock_unlock(mt->lock);
+      if (!(mt->threads[mt->num_threads] =
+               sthread_create(lzma2_mt_worker, mt)))
+      {
+         slock_lock(mt->lock);
+         mt->active--;
+         slock_unlock(mt->lock);
+         break;
+      }
+      mt->num_threads++;
+   }
+
+   if (!mt->num_threads && !join)
+   {
+      slock_free(mt->lock);
+      free(runs);
+      free(mt);
+      return NULL;
+   }
+   return mt;
+}
+
+/* True once every worker has given up or run out of runs. */
+static int lzma2_mt_done(lzma2_mt_t *mt)
+{
+   int done;
+   slock_lock(mt->lock);
+   done = (mt->active == 0);
+   slock_unlock(mt->lock);
+   return done;
+}
+
+/* Wait for the workers and release everything. With `stop` set they
+ * are told to give up first, for a decode that is being abandoned. */
+static int lzma2_mt_finish(lzma2_mt_t *mt, int stop)
+{
+   unsigned i;
+   int      res;
+
+   if (stop)
+   {
+      slock_lock(mt->lock);
+      mt->stop = 1;
+      slock_unlock(mt->lock);
+   }
+   for (i = 0; i < mt->num_threads; i++)
+      sthread_join(mt->threads[i]);
+
+   res = mt->res;
+   slock_free(mt->lock);
+   free(mt->runs);
+   free(mt);
+   return res;
+}
+#endif
+
 /* --------------------------------------------------------------------
  * Folder decoding
  *
@@ -1409,13 +1791,27 @@ static int decode_coder(r7z_archive_t *a, const coder_t *c,
       {
          rlzma2_dec_t *dec;
          uint16_t     *probs;
-         size_t        fed = 0;
-         size_t        produced = 0;
-         int           res = R7Z_OK;
+         size_t        fed  = 0;
+         int           done = 0;
+         int           res;
 
          if (c->prop_size < 1)
             return R7Z_ERROR_DATA;
 
+#ifdef HAVE_THREADS
+         /* Independent runs are shared out, with this thread taking
+          * its turn alongside the workers. */
+         {
+            lzma2_mt_t *mt = lzma2_mt_start(a, a->props[c->prop_offset],
+                  in, in_len, out, out_len, 1);
+            if (mt)
+            {
+               lzma2_mt_worker(mt);
+               return lzma2_mt_finish(mt, 0);
+            }
+         }
+#endif
+
          dec   = (rlzma2_dec_t *)malloc(sizeof(*dec));
          probs = (uint16_t *)malloc(RLZMA2_NUM_PROBS * sizeof(uint16_t));
          if (!dec || !probs)
@@ -1436,26 +1832,10 @@ static int decode_coder(r7z_archive_t *a, const coder_t *c,
             return R7Z_ERROR_DATA;
          }
 
-         while (produced < out_len)
-         {
-            size_t got = in_len - fed;
-            int    status;
-
-            if (rlzma2_dec_decode(dec, out_len, in + fed, &got, 1,
-                     &status) != RLZMA_OK)
-            {
-               res = R7Z_ERROR_DATA;
-               break;
-            }
-            fed      += got;
-            produced  = dec->lzma.dic_pos;
-            if (status == RLZMA2_STATUS_FINISHED)
-               break;
-            if (got == 0 && fed >= in_len)
-               break;
-         }
-         if (res == R7Z_OK && produced != out_len)
-            res = R7Z_ERROR_DATA;
+         res = R7Z_OK;
+         while (out_len && !done && res == R7Z_OK)
+            res = lzma2_step(dec, in, in_len, &fed, out_len, out_len,
+                  &done);
 
          free(dec);
          free(probs);
@@ -2103,6 +2483,7 @@ int r7z_archive_open(r7z_archive_t **out, const uint8_t *data, size_t len)
    a->data          = data;
    a->len           = len;
    a->cached_folder = 0xFFFFFFFFu;
+   a->prev_folder   = 0xFFFFFFFFu;
    a->pend_folder   = 0xFFFFFFFFu;
 
    r.p   = data + 32 + next_off;
@@ -2146,7 +2527,14 @@ void r7z_archive_close(r7z_archive_t *a)
    if (!a)
       return;
    decode_pending_reset(a);
-   free(a->cached_data);
+#ifdef HAVE_THREADS
+   /* Waits out a folder still being read ahead: a decode in progress
+    * cannot be interrupted. Whatever it produced is kept. */
+   if (a->ahead)
+      r7z_ahead_keep(a);
+#endif
+   if (a->cached_data)
+      r7z_cache_give(a, a->cached_folder, a->cached_data, a->cached_len);
    free(a->header_buf);
    free(a->pack_sizes);
    free(a->coders);
@@ -2173,6 +2561,374 @@ const r7z_entry_t *r7z_archive_entry(const r7z_archive_t *a, uint32_t index)
 }
 
 
+/* --------------------------------------------------------------------
+ * Folder cache
+ *
+ * Each archive keeps the folder it decoded last. Two things extend
+ * that, both aimed at the caller extracting several members of one
+ * archive, which is what multi-disc sets and BIOS packs amount to:
+ *
+ *   - A folder the archive lets go of is handed to a process-wide
+ *     cache rather than freed, keyed by the archive and the folder, so
+ *     a member of it requested later through another handle, or after
+ *     the archive was closed and opened again, is a copy and not a
+ *     decode from the start of the folder. The frontend reopens the
+ *     archive for every member it extracts, so without this the
+ *     per-archive copy was gone before it could be used twice.
+ *
+ *   - A caller walking the folders in order has the next one decoded
+ *     on its own thread while it consumes this one.
+ *
+ * The shared cache is off until r7z_archive_cache_init(), so code that
+ * never calls it keeps exactly the old behaviour. Buffers move in and
+ * out of it rather than being copied: taking a folder removes it.
+ * -------------------------------------------------------------------- */
+
+/* Used when r7z_archive_cache_init() is given no budget. */
+#define R7Z_CACHE_DEFAULT_BYTES (64 * 1024 * 1024)
+
+typedef struct r7z_cache_node
+{
+   struct r7z_cache_node *next;
+   /* The archive's identity: its length and its signature block, which
+    * carries the CRC of a header describing every folder's size and
+    * CRC. Two archives that agree on both hold the same folders. */
+   uint8_t                sig[32];
+   size_t                 archive_len;
+   uint32_t               folder;
+   uint8_t               *data;
+   size_t                 len;
+} r7z_cache_node_t;
+
+/* Most recently given first. */
+static r7z_cache_node_t *r7z_cache_head   = NULL;
+static size_t            r7z_cache_bytes  = 0;
+/* 0 while the cache is off. */
+static size_t            r7z_cache_budget = 0;
+#ifdef HAVE_THREADS
+static slock_t          *r7z_cache_lock   = NULL;
+#define R7Z_CACHE_LOCK()   slock_lock(r7z_cache_lock)
+#define R7Z_CACHE_UNLOCK() slock_unlock(r7z_cache_lock)
+#else
+#define R7Z_CACHE_LOCK()
+#define R7Z_CACHE_UNLOCK()
+#endif
+
+static int r7z_cache_match(const r7z_cache_node_t *n,
+      const r7z_archive_t *a, uint32_t fi)
+{
+   return n->folder == fi
+      && n->archive_len == a->len
+      && !memcmp(n->sig, a->data, sizeof(n->sig));
+}
+
+/* Take folder fi of this archive out of the shared cache. Returns NULL
+ * when it is not there. */
+static uint8_t *r7z_cache_take(const r7z_archive_t *a, uint32_t fi)
+{
+   r7z_cache_node_t **pp;
+   uint8_t           *data = NULL;
+
+   if (!r7z_cache_budget)
+      return NULL;
+
+   R7Z_CACHE_LOCK();
+   for (pp = &r7z_cache_head; *pp; pp = &(*pp)->next)
+   {
+      r7z_cache_node_t *n = *pp;
+      if (r7z_cache_match(n, a, fi))
+      {
+         *pp              = n->next;
+         r7z_cache_bytes -= n->len;
+         data             = n->data;
+         free(n);
+         break;
+      }
+   }
+   R7Z_CACHE_UNLOCK();
+   return data;
+}
+
+/* Hand a decoded folder to the shared cache, which now owns it, and
+ * trim the oldest entries back under budget. With the cache off, or a
+ * folder bigger than the whole budget, it is simply freed. */
+static void r7z_cache_give(const r7z_archive_t *a, uint32_t fi,
+      uint8_t *data, size_t len)
+{
+   r7z_cache_node_t  *n;
+   r7z_cache_node_t  *evict = NULL;
+   r7z_cache_node_t **pp;
+   size_t             kept  = 0;
+
+   if (!data)
+      return;
+   if (!r7z_cache_budget || len > r7z_cache_budget
+         || !(n = (r7z_cache_node_t *)malloc(sizeof(*n))))
+   {
+      free(data);
+      return;
+   }
+
+   memcpy(n->sig, a->data, sizeof(n->sig));
+   n->archive_len = a->len;
+   n->folder      = fi;
+   n->data        = data;
+   n->len         = len;
+
+   R7Z_CACHE_LOCK();
+   n->next          = r7z_cache_head;
+   r7z_cache_head   = n;
+   r7z_cache_bytes += len;
+
+   /* Drop whatever no longer fits, and any older copy of the same
+    * folder, which two handles on one archive can each have given. */
+   for (pp = &n->next; *pp; )
+   {
+      r7z_cache_node_t *o = *pp;
+      if (      r7z_cache_match(o, a, fi)
+            || kept + len + o->len > r7z_cache_budget)
+      {
+         *pp              = o->next;
+         r7z_cache_bytes -= o->len;
+         o->next          = evict;
+         evict            = o;
+      }
+      else
+      {
+         kept += o->len;
+         pp    = &o->next;
+      }
+   }
+   R7Z_CACHE_UNLOCK();
+
+   /* Freed outside the lock: a large folder is a large free(). */
+   while (evict)
+   {
+      r7z_cache_node_t *next = evict->next;
+      free(evict->data);
+      free(evict);
+      evict = next;
+   }
+}
+
+void r7z_archive_cache_init(size_t budget)
+{
+#ifdef HAVE_THREADS
+   if (!r7z_cache_lock)
+      r7z_cache_lock = slock_new();
+   if (!r7z_cache_lock)
+      return;
+#endif
+   R7Z_CACHE_LOCK();
+   r7z_cache_budget = budget ? budget : R7Z_CACHE_DEFAULT_BYTES;
+   R7Z_CACHE_UNLOCK();
+}
+
+void r7z_archive_cache_deinit(void)
+{
+   r7z_cache_node_t *n;
+
+#ifdef HAVE_THREADS
+   if (!r7z_cache_lock)
+      return;
+#endif
+   R7Z_CACHE_LOCK();
+   n                = r7z_cache_head;
+   r7z_cache_head   = NULL;
+   r7z_cache_bytes  = 0;
+   r7z_cache_budget = 0;
+   R7Z_CACHE_UNLOCK();
+
+   while (n)
+   {
+      r7z_cache_node_t *next = n->next;
+      free(n->data);
+      free(n);
+      n = next;
+   }
+
+#ifdef HAVE_THREADS
+   slock_free(r7z_cache_lock);
+   r7z_cache_lock = NULL;
+#endif
+}
+
+void r7z_archive_set_threads(r7z_archive_t *a, unsigned threads)
+{
+   if (a)
+      a->threads = threads;
+}
+
+#ifdef HAVE_THREADS
+/* A folder being decoded ahead of the caller, on its own thread. Only
+ * the fields of the archive fixed at open time are read from there,
+ * so it runs alongside whatever the caller is doing with the handle. */
+typedef struct r7z_ahead
+{
+   r7z_archive_t *a;
+   uint32_t       folder;
+   uint8_t       *data;
+   int            res;
+   int            done;
+   slock_t       *lock;
+   sthread_t     *thread;
+} r7z_ahead_t;
+
+static void r7z_ahead_run(void *data)
+{
+   r7z_ahead_t *ah  = (r7z_ahead_t *)data;
+   uint8_t     *out = NULL;
+   int          res = decode_folder(ah->a, ah->folder, &out);
+
+   slock_lock(ah->lock);
+   ah->res  = res;
+   ah->data = (res == R7Z_OK) ? out : NULL;
+   ah->done = 1;
+   slock_unlock(ah->lock);
+}
+
+/* Wait for the read-ahead thread and return what it produced, if
+ * anything, passing ownership to the caller. */
+static uint8_t *r7z_ahead_finish(r7z_archive_t *a)
+{
+   r7z_ahead_t *ah = a->ahead;
+   uint8_t     *data;
+
+   sthread_join(ah->thread);
+   slock_free(ah->lock);
+   data     = ah->data;
+   free(ah);
+   a->ahead = NULL;
+   return data;
+}
+
+/* Wait for the read-ahead and give its folder to the shared cache. */
+static void r7z_ahead_keep(r7z_archive_t *a)
+{
+   uint32_t fi = a->ahead->folder;
+   r7z_cache_give(a, fi, r7z_ahead_finish(a),
+         (size_t)a->folders[fi].unpack_size);
+}
+
+static void r7z_ahead_start(r7z_archive_t *a, uint32_t fi)
+{
+   r7z_ahead_t *ah;
+
+   if (fi >= a->num_folders || r7z_thread_count(a) < 2)
+      return;
+
+   /* One in flight at a time. A finished one the caller skipped past
+    * is still worth keeping, so it goes to the shared cache. */
+   if (a->ahead)
+   {
+      int done;
+
+      slock_lock(a->ahead->lock);
+      done = a->ahead->done;
+      slock_unlock(a->ahead->lock);
+      if (!done)
+         return;
+      r7z_ahead_keep(a);
+   }
+   if (!a->folders[fi].unpack_size
+         || a->folders[fi].unpack_size > (uint64_t)((size_t)-1))
+      return;
+
+   if (!(ah = (r7z_ahead_t *)calloc(1, sizeof(*ah))))
+      return;
+   ah->a      = a;
+   ah->folder = fi;
+   if (!(ah->lock = slock_new()))
+   {
+      free(ah);
+      return;
+   }
+   if (!(ah->thread = sthread_create(r7z_ahead_run, ah)))
+   {
+      slock_free(ah->lock);
+      free(ah);
+      return;
+   }
+   a->ahead = ah;
+}
+#endif
+
+/* Make fi the archive's current folder, taking ownership of data. The
+ * folder it replaces goes to the shared cache. A caller that has just
+ * moved on to the folder after the previous one is taken to be walking
+ * the archive, and the next is started in the background. */
+static void folder_cache_set(r7z_archive_t *a, uint32_t fi, uint8_t *data)
+{
+   if (a->cached_data && a->cached_folder != fi)
+      r7z_cache_give(a, a->cached_folder, a->cached_data, a->cached_len);
+   else
+      free(a->cached_data);
+
+   a->prev_folder   = a->cached_folder;
+   a->cached_data   = data;
+   a->cached_len    = (size_t)a->folders[fi].unpack_size;
+   a->cached_folder = fi;
+
+#ifdef HAVE_THREADS
+   if (a->prev_folder != 0xFFFFFFFFu && a->prev_folder + 1 == fi)
+      r7z_ahead_start(a, fi + 1);
+#endif
+}
+
+/* Put folder fi in the archive's own slot if it can be had without
+ * decoding: it is already there, the read-ahead produced it, or the
+ * shared cache has it. Sets *have when it is in place, and leaves it
+ * clear when the caller must decode it. Returns R7Z_PENDING instead
+ * when the read-ahead has the folder in hand but is not finished and
+ * `wait` is clear, R7Z_OK otherwise. */
+static int folder_cache_get(r7z_archive_t *a, uint32_t fi, int wait,
+      int *have)
+{
+   uint8_t *data;
+
+   *have = 0;
+
+   if (a->cached_folder == fi && a->cached_data)
+   {
+      *have = 1;
+      return R7Z_OK;
+   }
+
+#ifdef HAVE_THREADS
+   if (a->ahead && a->ahead->folder == fi)
+   {
+      if (!wait)
+      {
+         int done;
+         slock_lock(a->ahead->lock);
+         done = a->ahead->done;
+         slock_unlock(a->ahead->lock);
+         if (!done)
+            return R7Z_PENDING;
+      }
+      /* A failed read-ahead is dropped, and the decode that follows
+       * reports the error itself. */
+      if ((data = r7z_ahead_finish(a)))
+      {
+         decode_pending_reset(a);
+         folder_cache_set(a, fi, data);
+         *have = 1;
+      }
+      return R7Z_OK;
+   }
+#else
+   (void)wait;
+#endif
+
+   if ((data = r7z_cache_take(a, fi)))
+   {
+      decode_pending_reset(a);
+      folder_cache_set(a, fi, data);
+      *have = 1;
+   }
+   return R7Z_OK;
+}
+
 /* --------------------------------------------------------------------
  * Resumable folder decode
  *
@@ -2199,6 +2955,14 @@ static void decode_pending_reset(r7z_archive_t *a)
 {
    if (!a)
       return;
+#ifdef HAVE_THREADS
+   /* First: the workers are reading pend_in and writing pend_out. */
+   if (a->pend_mt)
+   {
+      lzma2_mt_finish(a->pend_mt, 1);
+      a->pend_mt = NULL;
+   }
+#endif
    free(a->pend_in);
    free(a->pend_out);
    free(a->pend_dec);
@@ -2249,38 +3013,33 @@ static int decode_slice_lzma2(r7z_archive_t *a, const coder_t *c, int *done)
 {
    rlzma2_dec_t *dec = (rlzma2_dec_t *)a->pend_dec;
    size_t        limit;
-   size_t        got;
-   int           status;
 
+   (void)c;
    *done = 0;
 
-   limit = dec->lzma.dic_pos + R7Z_SLICE_BYTES;
-   if (limit > a->pend_out_len)
-      limit = a->pend_out_len;
-
-   got = a->pend_in_len - a->pend_fed;
-
-   if (rlzma2_dec_decode(dec, limit, a->pend_in + a->pend_fed, &got, 1,
-            &status) != RLZMA_OK)
-      return R7Z_ERROR_DATA;
-
-   a->pend_fed += got;
-
-   if (dec->lzma.dic_pos >= a->pend_out_len
-         || status == RLZMA2_STATUS_FINISHED)
+#ifdef HAVE_THREADS
+   /* Split across workers: a slice is only a look at whether they have
+    * finished, so the caller's frame is never spent decoding. */
+   if (a->pend_mt)
    {
-      if (dec->lzma.dic_pos != a->pend_out_len)
-         return R7Z_ERROR_DATA;
-      *done = 1;
-      return R7Z_OK;
+      int res;
+
+      if (!lzma2_mt_done(a->pend_mt))
+         return R7Z_OK;
+      res        = lzma2_mt_finish(a->pend_mt, 0);
+      a->pend_mt = NULL;
+      if (res == R7Z_OK)
+         *done = 1;
+      return res;
    }
+#endif
 
-   /* No input consumed and none left: the stream ended early. */
-   if (got == 0 && a->pend_fed >= a->pend_in_len)
-      return R7Z_ERROR_DATA;
+   limit = dec->lzma.dic_pos + R7Z_SLICE_BYTES;
+   if (limit > a->pend_out_len)
+      limit = a->pend_out_len;
 
-   (void)c;
-   return R7Z_OK;
+   return lzma2_step(dec, a->pend_in, a->pend_in_len, &a->pend_fed,
+         a->pend_out_len, limit, done);
 }
 
 /* Run one slice of a paused plain-LZMA stage. */
@@ -2349,6 +3108,13 @@ static int decode_stage_begin(r7z_archive_t *a, const folder_t *f)
       if (c->prop_size < 1)
          return R7Z_ERROR_DATA;
 
+#ifdef HAVE_THREADS
+      if ((a->pend_mt = lzma2_mt_start(a, a->props[c->prop_offset],
+                  a->pend_in, a->pend_in_len, a->pend_out,
+                  a->pend_out_len, 0)))
+         return R7Z_OK;
+#endif
+
       a->pend_dec   = malloc(sizeof(rlzma2_dec_t));
       a->pend_probs = (uint16_t *)malloc(RLZMA2_NUM_PROBS
             * sizeof(uint16_t));
@@ -2710,10 +3476,7 @@ static int decode_folder_bcj2_slice(r7z_archive_t *a, uint32_t fi,
       return R7Z_ERROR_CRC;
    }
 
-   free(a->cached_data);
-   a->cached_data   = a->pend_b2dst;
-   a->cached_len    = a->pend_b2dstlen;
-   a->cached_folder = fi;
+   folder_cache_set(a, fi, a->pend_b2dst);
    a->pend_b2dst    = NULL;
 
    decode_pending_reset(a);
@@ -2865,10 +3628,7 @@ static int decode_folder_slice(r7z_archive_t *a, uint32_t fi, int *done)
       return R7Z_ERROR_CRC;
    }
 
-   free(a->cached_data);
-   a->cached_data   = a->pend_in;
-   a->cached_len    = a->pend_in_len;
-   a->cached_folder = fi;
+   folder_cache_set(a, fi, a->pend_in);
 
    a->pend_in     = NULL;
    a->pend_in_len = 0;
@@ -2921,6 +3681,7 @@ int r7z_archive_extract_slice(r7z_archive_t *a, uint32_t index,
 {
    const r7z_entry_t *e;
    int                done = 0;
+   int                have = 0;
    int                res;
 
    if (!a || !out || !out_len)
@@ -2944,9 +3705,11 @@ int r7z_archive_extract_slice(r7z_archive_t *a, uint32_t index,
    if (e->folder >= a->num_folders)
       return R7Z_ERROR_DATA;
 
-   /* Already decoded, from this call sequence or an earlier entry in
-    * the same folder. */
-   if (a->cached_folder == e->folder && a->cached_data)
+   /* Already decoded, from this call sequence, an earlier entry in the
+    * same folder, a read-ahead or another handle. */
+   if ((res = folder_cache_get(a, e->folder, 0, &have)) != R7Z_OK)
+      return res;
+   if (have)
       return extract_from_cache(a, e, out, out_len);
 
    res = decode_folder_slice(a, e->folder, &done);
@@ -2961,10 +3724,7 @@ int r7z_archive_extract_slice(r7z_archive_t *a, uint32_t index,
       if ((res = decode_folder(a, e->folder, &folder_data)) != R7Z_OK)
          return res;
 
-      free(a->cached_data);
-      a->cached_data   = folder_data;
-      a->cached_len    = (size_t)a->folders[e->folder].unpack_size;
-      a->cached_folder = e->folder;
+      folder_cache_set(a, e->folder, folder_data);
 
       return extract_from_cache(a, e, out, out_len);
     }
@@ -2983,6 +3743,7 @@ int r7z_archive_extract(r7z_archive_t *a, uint32_t index,
    const r7z_entry_t *e;
    uint8_t           *folder_data;
    uint8_t           *buf;
+   int                have = 0;
    int                res;
 
    if (!a || !out || !out_len)
@@ -3013,7 +3774,7 @@ int r7z_archive_extract(r7z_archive_t *a, uint32_t index,
    /* Decode the folder unless the last call already left it here. A
     * solid folder holds many members, and without this each one costs
     * a full decode of everything around it. */
-   if (a->cached_folder == e->folder && a->cached_data)
+   if (folder_cache_get(a, e->folder, 1, &have) == R7Z_OK && have)
       folder_data = a->cached_data;
    else
    {
@@ -3021,10 +3782,7 @@ int r7z_archive_extract(r7z_archive_t *a, uint32_t index,
       if (res != R7Z_OK)
          return res;
 
-      free(a->cached_data);
-      a->cached_data   = folder_data;
-      a->cached_len    = (size_t)a->folders[e->folder].unpack_size;
-      a->cached_folder = e->folder;
+      folder_cache_set(a, e->folder, folder_data);
    }
 
    {
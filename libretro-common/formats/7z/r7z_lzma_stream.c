@@ -343,7 +343,7 @@ static dummy_res_t try_dummy(const rlzma_stream_t *s,
    const uint16_t  *prob;
    dummy_res_t      res;
 
-   pos_state = ((uint32_t)(s->dic_pos) & (((uint32_t)1 << s->pb) - 1)) << 4;
+   pos_state = ((uint32_t)(s->total_pos) & (((uint32_t)1 << s->pb) - 1)) << 4;
 
    prob = probs + IS_MATCH + COMBINED_PS_STATE;
    RC_IF_BIT_0_CHECK(prob)
@@ -357,9 +357,10 @@ static dummy_res_t try_dummy(const rlzma_stream_t *s,
 
       lit_mask  = ((uint32_t)0x100 << s->lp) - ((uint32_t)0x100 >> s->lc);
       lit_state = 0;
-      if (s->dic_pos != 0)
-         lit_state = ((((uint32_t)s->dic_pos << 8)
-                  + (uint32_t)s->dic[s->dic_pos - 1]) & lit_mask) << s->lc;
+      if (s->total_pos != 0)
+         lit_state = ((((uint32_t)s->total_pos << 8)
+                  + (uint32_t)s->dic[(s->dic_pos ? s->dic_pos : s->dic_size)
+                     - 1]) & lit_mask) << s->lc;
 
       prob = probs + LITERAL + (uint32_t)3 * lit_state;
 
@@ -573,7 +574,7 @@ static int decode_real(rlzma_stream_t *s, size_t dic_limit,
    do
    {
       uint16_t *prob;
-      uint32_t  pos_state = ((uint32_t)dic_pos & pb_mask) << 4;
+      uint32_t  pos_state = ((uint32_t)total_pos & pb_mask) << 4;
       uint32_t  len;
 
       prob = probs_is_match + COMBINED_PS_STATE;
@@ -585,12 +586,17 @@ static int decode_real(rlzma_stream_t *s, size_t dic_limit,
 
          RC_UPDATE_0(prob)
 
-         /* The first byte of the window has no predecessor; its context
-          * is zero, exactly as in the one-shot decoder. */
+         /* The first byte after a dictionary reset has no predecessor;
+          * its context is zero, exactly as in the one-shot decoder.
+          * Position contexts count from that reset too, which is why
+          * both come from total_pos rather than from where the byte
+          * lands in the window: an LZMA2 reset part way through a
+          * folder does not move the output. */
          lit_state = 0;
-         if (dic_pos != 0)
-            lit_state = ((((uint32_t)dic_pos << 8)
-                     + (uint32_t)dic[dic_pos - 1]) & lit_mask) << lc;
+         if (total_pos != 0)
+            lit_state = ((((uint32_t)total_pos << 8)
+                     + (uint32_t)dic[(dic_pos ? dic_pos : dic_size) - 1])
+                     & lit_mask) << lc;
 
          /* The masked context is already scaled by 0x100, so the stride
           * is 3 (one literal slot), not the full 0x300 table. */
@@ -661,6 +667,15 @@ static int decode_real(rlzma_stream_t *s, size_t dic_limit,
       else
       {
          RC_UPDATE_1(prob)
+         /* A rep match replays an earlier distance, and straight after
+          * a dictionary reset there is nothing to replay into: the
+          * bytes at that distance belong to history the stream has
+          * just said to forget. The reference rejects it here too. */
+         if (total_pos == 0)
+         {
+            ret = RLZMA_ERROR_DATA;
+            goto done;
+         }
          prob = probs + IS_REP_G0 + state;
          RC_IF_BIT_0(prob)
          {
@@ -1003,10 +1018,16 @@ void rlzma_stream_reset_parts(rlzma_stream_t *s, int init_dic, int init_state)
    /* LZMA2 needs these two independently. A chunk may reset the decoder
     * state while continuing the previous chunk's dictionary, or reset
     * the dictionary while the range coder carries on. Collapsing them
-    * into one operation would make those chunk types undecodable. */
+    * into one operation would make those chunk types undecodable.
+    *
+    * A dictionary reset forgets history: nothing before it may be
+    * referenced again. It does not move the output position. The
+    * caller's window is the whole output, so rewinding dic_pos here
+    * would write the next chunk over the start of the buffer, which is
+    * what a stream with a dictionary reset part way through (every
+    * block after the first from a multithreaded 7-Zip) used to get. */
    if (init_dic)
    {
-      s->dic_pos    = 0;
       s->total_pos  = 0;
       s->got_marker = 0;
    }
@@ -1033,6 +1054,9 @@ void rlzma_stream_reset_parts(rlzma_stream_t *s, int init_dic, int init_state)
 
 void rlzma_stream_reset(rlzma_stream_t *s)
 {
+   if (!s)
+      return;
+   s->dic_pos = 0;
    rlzma_stream_reset_parts(s, 1, 1);
 }
 
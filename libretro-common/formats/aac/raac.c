@@ -1593,6 +1593,7 @@ struct raac
    float    tw512_re[1024], tw512_im[1024];    /* pre+post twiddles 2048 */
    float    tw64_re[128],  tw64_im[128];       /* pre+post twiddles 256  */
    float    fft_re[512], fft_im[512];          /* scratch                */
+   float    fft_tw_re[511], fft_tw_im[511];    /* FFT stage twiddles     */
    unsigned frame_len;                          /* 1024, or 960 when the
                                                 * short frame length is
                                                 * signalled at open     */
@@ -1690,11 +1691,69 @@ static void raac_sine_window(float *w, int n)
  * Standard formulation: pre-twiddle the N/2 spectral pairs, run an
  * N/4 complex FFT, post-twiddle, and scatter the quarters with the
  * MDCT symmetries. Output is the full N time samples of this frame's
- * windowed contribution before overlap-add (scale 2/N folded in). */
+ * windowed contribution before overlap-add (scale 2/N folded in).
+ *
+ * The transform and the windowing below have SSE and NEON paths,
+ * selected at compile time as in rvorbis and rmp3: every target that
+ * defines these macros already lets the compiler emit the same
+ * instructions in ordinary code, so a runtime CPU check would guard
+ * nothing. The vector paths perform the same IEEE operations per
+ * element as the scalar ones (separate multiplies and adds, exact
+ * negations), so output does not depend on which one is built.
+ * RAAC_NO_SIMD forces the scalar code. */
+
+#if !defined(RAAC_NO_SIMD)
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define RAAC_HAVE_SSE 1
+#elif defined(__ARM_NEON) || defined(__aarch64__) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define RAAC_HAVE_NEON 1
+#endif
+#endif
 
-static void raac_fft(float *re, float *im, int n)
+#if defined(RAAC_HAVE_SSE)
+typedef __m128 raac_v4;
+#define RAAC_LD(p)        _mm_loadu_ps(p)
+#define RAAC_ST(p, v)     _mm_storeu_ps((p), (v))
+#define RAAC_ADD(x, y)    _mm_add_ps((x), (y))
+#define RAAC_SUB(x, y)    _mm_sub_ps((x), (y))
+#define RAAC_MUL(x, y)    _mm_mul_ps((x), (y))
+#define RAAC_SPLAT(f)     _mm_set1_ps(f)
+#define RAAC_NEG(x)       _mm_xor_ps((x), _mm_set1_ps(-0.0f))
+/* lanes 3,2,1,0 */
+#define RAAC_REV(x)       _mm_shuffle_ps((x), (x), _MM_SHUFFLE(0, 1, 2, 3))
+/* even lanes of lo:hi; odd lanes of lo:hi in descending order */
+#define RAAC_EVENS(lo, hi) _mm_shuffle_ps((lo), (hi), _MM_SHUFFLE(2, 0, 2, 0))
+#define RAAC_ODDS_REV(lo, hi) _mm_shuffle_ps((hi), (lo), _MM_SHUFFLE(1, 3, 1, 3))
+#define RAAC_ZIP_LO(x, y) _mm_unpacklo_ps((x), (y))
+#define RAAC_ZIP_HI(x, y) _mm_unpackhi_ps((x), (y))
+#define RAAC_SIMD 1
+#elif defined(RAAC_HAVE_NEON)
+typedef float32x4_t raac_v4;
+#define RAAC_LD(p)        vld1q_f32(p)
+#define RAAC_ST(p, v)     vst1q_f32((p), (v))
+#define RAAC_ADD(x, y)    vaddq_f32((x), (y))
+#define RAAC_SUB(x, y)    vsubq_f32((x), (y))
+#define RAAC_MUL(x, y)    vmulq_f32((x), (y))
+#define RAAC_SPLAT(f)     vdupq_n_f32(f)
+#define RAAC_NEG(x)       vnegq_f32(x)
+#define RAAC_REV(x)       vcombine_f32(vrev64_f32(vget_high_f32(x)), \
+                                       vrev64_f32(vget_low_f32(x)))
+#define RAAC_EVENS(lo, hi) vuzpq_f32((lo), (hi)).val[0]
+#define RAAC_ODDS_REV(lo, hi) RAAC_REV(vuzpq_f32((lo), (hi)).val[1])
+#define RAAC_ZIP_LO(x, y) vzipq_f32((x), (y)).val[0]
+#define RAAC_ZIP_HI(x, y) vzipq_f32((x), (y)).val[1]
+#define RAAC_SIMD 1
+#endif
+
+/* Radix-2 FFT over split re/im arrays, n a power of two up to 512.
+ * Stage len reads its len/2 twiddles exp(-2*pi*j*i/len) from
+ * a->fft_tw at offset len/2 - 1 (see raac_make_fft_twiddles), so
+ * every butterfly group of a stage walks one contiguous table. */
+static void raac_fft(const raac_t *a, float *re, float *im, int n)
 {
-   int i, j, k, len;
+   int i, j, len;
    /* bit reversal */
    for (i = 1, j = 0; i < n; i++)
    {
@@ -1711,28 +1770,58 @@ static void raac_fft(float *re, float *im, int n)
    }
    for (len = 2; len <= n; len <<= 1)
    {
-      double ang = -2.0 * M_PI / len;
-      float  wr0 = (float)cos(ang), wi0 = (float)sin(ang);
-      for (i = 0; i < n; i += len)
+      int          h   = len >> 1;
+      const float *twr = a->fft_tw_re + h - 1;
+      const float *twi = a->fft_tw_im + h - 1;
+#ifdef RAAC_SIMD
+      if (h >= 4)
       {
-         float wr = 1.0f, wi = 0.0f;
-         for (j = 0; j < len / 2; j++)
+         for (i = 0; i < n; i += len)
+            for (j = 0; j < h; j += 4)
+            {
+               float  *r0 = re + i + j, *i0 = im + i + j;
+               raac_v4 ur = RAAC_LD(r0),     ui = RAAC_LD(i0);
+               raac_v4 vr = RAAC_LD(r0 + h), vi = RAAC_LD(i0 + h);
+               raac_v4 wr = RAAC_LD(twr + j), wi = RAAC_LD(twi + j);
+               raac_v4 tr = RAAC_SUB(RAAC_MUL(vr, wr), RAAC_MUL(vi, wi));
+               raac_v4 ti = RAAC_ADD(RAAC_MUL(vr, wi), RAAC_MUL(vi, wr));
+               RAAC_ST(r0,     RAAC_ADD(ur, tr));
+               RAAC_ST(i0,     RAAC_ADD(ui, ti));
+               RAAC_ST(r0 + h, RAAC_SUB(ur, tr));
+               RAAC_ST(i0 + h, RAAC_SUB(ui, ti));
+            }
+         continue;
+      }
+#endif
+      for (i = 0; i < n; i += len)
+         for (j = 0; j < h; j++)
          {
-            float ur = re[i + j],           ui = im[i + j];
-            float vr = re[i + j + len / 2], vi = im[i + j + len / 2];
-            float tr = vr * wr - vi * wi;
-            float ti = vr * wi + vi * wr;
-            float nr;
-            re[i + j] = ur + tr; im[i + j] = ui + ti;
-            re[i + j + len / 2] = ur - tr;
-            im[i + j + len / 2] = ui - ti;
-            nr = wr * wr0 - wi * wi0;
-            wi = wr * wi0 + wi * wr0;
-            wr = nr;
+            float ur = re[i + j],     ui = im[i + j];
+            float vr = re[i + j + h], vi = im[i + j + h];
+            float tr = vr * twr[j] - vi * twi[j];
+            float ti = vr * twi[j] + vi * twr[j];
+            re[i + j]     = ur + tr;
+            im[i + j]     = ui + ti;
+            re[i + j + h] = ur - tr;
+            im[i + j + h] = ui - ti;
          }
-      }
    }
-   (void)k;
+}
+
+/* The FFT's per-stage twiddles, stages 2..512 packed back to back:
+ * 1 + 2 + ... + 256 = 511 entries. Computed directly per entry rather
+ * than by the rotation recurrence the butterflies used to run, which
+ * drifted by a few ulp over the 256-step stage. */
+static void raac_make_fft_twiddles(float *twr, float *twi)
+{
+   int h, j;
+   for (h = 1; h <= 256; h <<= 1)
+      for (j = 0; j < h; j++)
+      {
+         double ang = -M_PI * j / h;
+         twr[h - 1 + j] = (float)cos(ang);
+         twi[h - 1 + j] = (float)sin(ang);
+      }
 }
 
 /* Mixed-radix complex FFT for the 960-frame transforms, whose cores
@@ -1778,6 +1867,75 @@ static void raac_fft_mr(const float *in_re, const float *in_im,
       }
 }
 
+/* Pre-twiddle of the N/2 spectral coefficients into n4 complex FFT
+ * inputs: (x[2k] + j*x[n2-1-2k]) * p[k]. */
+static void raac_imdct_pre(float *fre, float *fim, const float *x,
+      const float *pr, const float *pi_, int n4)
+{
+   int n2 = n4 * 2;
+   int k;
+#ifdef RAAC_SIMD
+   if (!(n4 & 3))
+   {
+      for (k = 0; k < n4; k += 4)
+      {
+         const float *hi = x + n2 - 8 - 2 * k;
+         raac_v4 xr = RAAC_EVENS(RAAC_LD(x + 2 * k), RAAC_LD(x + 2 * k + 4));
+         raac_v4 xi = RAAC_ODDS_REV(RAAC_LD(hi), RAAC_LD(hi + 4));
+         raac_v4 wr = RAAC_LD(pr + k), wi = RAAC_LD(pi_ + k);
+         RAAC_ST(fre + k, RAAC_SUB(RAAC_MUL(xr, wr), RAAC_MUL(xi, wi)));
+         RAAC_ST(fim + k, RAAC_ADD(RAAC_MUL(xr, wi), RAAC_MUL(xi, wr)));
+      }
+      return;
+   }
+#endif
+   for (k = 0; k < n4; k++)
+   {
+      float xr = x[2 * k];
+      float xi = x[n2 - 1 - 2 * k];
+      fre[k] = xr * pr[k] - xi * pi_[k];
+      fim[k] = xr * pi_[k] + xi * pr[k];
+   }
+}
+
+/* Post-twiddle y[k] = z[k] * q[k], spread over the N/2 DCT-IV outputs
+ * as v[2k] = Re y[k], v[n2-1-2k] = -Im y[k]. fre/fim are consumed. */
+static void raac_imdct_post(float *v, float *fre, float *fim,
+      const float *qr, const float *qi, int n4)
+{
+   int n2 = n4 * 2;
+   int k;
+#ifdef RAAC_SIMD
+   if (!(n4 & 3))
+   {
+      /* twiddle in place, then interleave: the odd slots of v[2k..2k+7]
+       * are the negated imaginary parts of the mirrored block */
+      for (k = 0; k < n4; k += 4)
+      {
+         raac_v4 zr = RAAC_LD(fre + k), zi = RAAC_LD(fim + k);
+         raac_v4 wr = RAAC_LD(qr + k),  wi = RAAC_LD(qi + k);
+         RAAC_ST(fre + k, RAAC_SUB(RAAC_MUL(zr, wr), RAAC_MUL(zi, wi)));
+         RAAC_ST(fim + k, RAAC_ADD(RAAC_MUL(zr, wi), RAAC_MUL(zi, wr)));
+      }
+      for (k = 0; k < n4; k += 4)
+      {
+         raac_v4 yr = RAAC_LD(fre + k);
+         raac_v4 yi = RAAC_NEG(RAAC_REV(RAAC_LD(fim + n4 - 4 - k)));
+         RAAC_ST(v + 2 * k,     RAAC_ZIP_LO(yr, yi));
+         RAAC_ST(v + 2 * k + 4, RAAC_ZIP_HI(yr, yi));
+      }
+      return;
+   }
+#endif
+   for (k = 0; k < n4; k++)
+   {
+      float yr = fre[k] * qr[k] - fim[k] * qi[k];
+      float yi = fre[k] * qi[k] + fim[k] * qr[k];
+      v[2 * k]          =  yr;
+      v[n2 - 1 - 2 * k] = -yi;
+   }
+}
+
 /* in: N/2 spectral coefficients X, out: N time samples (2/N folded in).
  * Derivation: y is a signed/mirrored rearrangement of the length-N/2
  * DCT-IV of X, and the DCT-IV runs on an N/4-point complex FFT with
@@ -1796,17 +1954,12 @@ static void raac_imdct(raac_t *a, const float *x, float *out, int n)
    const float *qr  = lng ? a->tw512_re + n4 : a->tw64_re + n4;
    const float *qi  = lng ? a->tw512_im + n4 : a->tw64_im + n4;
    float *v   = a->imdct_v;
-   int    k;
+   float  s   = 2.0f / n;
+   int    k   = 0;
 
-   for (k = 0; k < n4; k++)
-   {
-      float xr = x[2 * k];
-      float xi = x[n2 - 1 - 2 * k];
-      fre[k] = xr * pr[k] - xi * pi_[k];
-      fim[k] = xr * pi_[k] + xi * pr[k];
-   }
+   raac_imdct_pre(fre, fim, x, pr, pi_, n4);
    if ((n4 & (n4 - 1)) == 0)
-      raac_fft(fre, fim, n4);
+      raac_fft(a, fre, fim, n4);
    else
    {
       const float *wr = (n4 == 480) ? a->w480_re : a->w60_re;
@@ -1816,16 +1969,24 @@ static void raac_imdct(raac_t *a, const float *x, float *out, int n)
       memcpy(fre, a->mr_re, sizeof(float) * (size_t)n4);
       memcpy(fim, a->mr_im, sizeof(float) * (size_t)n4);
    }
-   for (k = 0; k < n4; k++)
+   raac_imdct_post(v, fre, fim, qr, qi, n4);
+#ifdef RAAC_SIMD
    {
-      float yr = fre[k] * qr[k] - fim[k] * qi[k];
-      float yi = fre[k] * qi[k] + fim[k] * qr[k];
-      v[2 * k]           =  yr;
-      v[n2 - 1 - 2 * k]  = -yi;
+      /* -v * s == v * -s exactly, so the sign rides on the scale */
+      raac_v4 ps = RAAC_SPLAT(s), ns = RAAC_SPLAT(-s);
+      for (; k + 4 <= n4; k += 4)
+      {
+         RAAC_ST(out + k, RAAC_MUL(RAAC_LD(v + n4 + k), ps));
+         RAAC_ST(out + n4 + k,
+               RAAC_MUL(RAAC_REV(RAAC_LD(v + n2 - 4 - k)), ns));
+         RAAC_ST(out + n2 + k,
+               RAAC_MUL(RAAC_REV(RAAC_LD(v + n4 - 4 - k)), ns));
+         RAAC_ST(out + n2 + n4 + k, RAAC_MUL(RAAC_LD(v + k), ns));
+      }
    }
-   for (k = 0; k < n4; k++)
+#endif
+   for (; k < n4; k++)
    {
-      float s = 2.0f / n;
       out[k]           =  v[n4 + k] * s;
       out[n4 + k]      = -v[n2 - 1 - k] * s;
       out[n2 + k]      = -v[n4 - 1 - k] * s;
@@ -2380,6 +2541,43 @@ static void raac_tns_apply(raac_t *a, raac_ch *c)
 
 /* ===== filterbank: IMDCT + windowing + overlap-add (4.6.11) ===== */
 
+/* d[i] *= w[i] */
+static void raac_win_mul(float *d, const float *w, int n)
+{
+   int i = 0;
+#ifdef RAAC_SIMD
+   for (; i + 4 <= n; i += 4)
+      RAAC_ST(d + i, RAAC_MUL(RAAC_LD(d + i), RAAC_LD(w + i)));
+#endif
+   for (; i < n; i++)
+      d[i] = d[i] * w[i];
+}
+
+/* d[i] += s[i] * w[i] */
+static void raac_win_mac(float *d, const float *s, const float *w, int n)
+{
+   int i = 0;
+#ifdef RAAC_SIMD
+   for (; i + 4 <= n; i += 4)
+      RAAC_ST(d + i, RAAC_ADD(RAAC_LD(d + i),
+               RAAC_MUL(RAAC_LD(s + i), RAAC_LD(w + i))));
+#endif
+   for (; i < n; i++)
+      d[i] += s[i] * w[i];
+}
+
+/* d[i] = x[i] + y[i] */
+static void raac_win_add(float *d, const float *x, const float *y, int n)
+{
+   int i = 0;
+#ifdef RAAC_SIMD
+   for (; i + 4 <= n; i += 4)
+      RAAC_ST(d + i, RAAC_ADD(RAAC_LD(x + i), RAAC_LD(y + i)));
+#endif
+   for (; i < n; i++)
+      d[i] = x[i] + y[i];
+}
+
 static void raac_filterbank(raac_t *a, raac_ch *c, float out[RAAC_FRAME])
 {
    const float *long_cur  = c->window_shape ? a->kbd_long  : a->sine_long;
@@ -2407,15 +2605,13 @@ static void raac_filterbank(raac_t *a, raac_ch *c, float out[RAAC_FRAME])
       {
          case 0:  /* only long  */
          case 1:  /* long start */
-            for (i = 0; i < L; i++)
-               buf[i] = buf[i] * long_prev[i];
+            raac_win_mul(buf, long_prev, L);
             break;
          default: /* long stop: zero head, short rise, then a flat
                    * run that the in-place windowing leaves alone   */
             for (i = 0; i < flat; i++)
                buf[i] = 0.0f;
-            for (i = 0; i < Ls; i++)
-               buf[flat + i] = buf[flat + i] * shrt_prev[i];
+            raac_win_mul(buf + flat, shrt_prev, Ls);
             break;
       }
       /* second half: this frame's trailing shape */
@@ -2423,13 +2619,11 @@ static void raac_filterbank(raac_t *a, raac_ch *c, float out[RAAC_FRAME])
       {
          case 0:  /* long tail */
          case 3:
-            for (i = 0; i < L; i++)
-               buf[L + i] = buf[L + i] * long_cur[L + i];
+            raac_win_mul(buf + L, long_cur + L, L);
             break;
          default: /* long start: a flat run kept as it stands, then
                    * a short fall and a zero tail                   */
-            for (i = 0; i < Ls; i++)
-               buf[L + flat + i] = buf[L + flat + i] * shrt_cur[Ls + i];
+            raac_win_mul(buf + L + flat, shrt_cur + Ls, Ls);
             for (i = L + flat + Ls; i < nl; i++)
                buf[i] = 0.0f;
             break;
@@ -2445,18 +2639,14 @@ static void raac_filterbank(raac_t *a, raac_ch *c, float out[RAAC_FRAME])
       memset(buf, 0, sizeof(a->fb_win));
       for (w = 0; w < 8; w++)
       {
+         float *dst = buf + flat + w * Ls;
          raac_imdct(a, c->coef + w * 128, sbuf, ns);
-         for (i = 0; i < ns; i++)
-         {
-            const float *head = (w == 0) ? shrt_prev : shrt_cur;
-            float win = (i < Ls) ? head[i] : shrt_cur[i];
-            buf[flat + w * Ls + i] += sbuf[i] * win;
-         }
+         raac_win_mac(dst, sbuf, (w == 0) ? shrt_prev : shrt_cur, Ls);
+         raac_win_mac(dst + Ls, sbuf + Ls, shrt_cur + Ls, Ls);
       }
    }
 
-   for (i = 0; i < L; i++)
-      out[i] = buf[i] + c->overlap[i];
+   raac_win_add(out, buf, c->overlap, L);
    memcpy(c->overlap, buf + L, sizeof(float) * (size_t)L);
    c->prev_window_shape = c->window_shape;
 }
@@ -3346,22 +3536,9 @@ static void raac_imdct_half128(raac_t *a, const float in[64],
    float *fre = a->fft_re, *fim = a->fft_im;
    float  v[64], full[128];
    int    k;
-   for (k = 0; k < 32; k++)
-   {
-      float xr = in[2 * k], xi = in[63 - 2 * k];
-      float pr = a->tw32_re[k], pi_ = a->tw32_im[k];
-      fre[k] = xr * pr - xi * pi_;
-      fim[k] = xr * pi_ + xi * pr;
-   }
-   raac_fft(fre, fim, 32);
-   for (k = 0; k < 32; k++)
-   {
-      float qr = a->tw32_re[32 + k], qi = a->tw32_im[32 + k];
-      float yr = fre[k] * qr - fim[k] * qi;
-      float yi = fre[k] * qi + fim[k] * qr;
-      v[2 * k]      =  yr;
-      v[63 - 2 * k] = -yi;
-   }
+   raac_imdct_pre(fre, fim, in, a->tw32_re, a->tw32_im, 32);
+   raac_fft(a, fre, fim, 32);
+   raac_imdct_post(v, fre, fim, a->tw32_re + 32, a->tw32_im + 32, 32);
    for (k = 0; k < 32; k++)
    {
       full[k]      =  v[32 + k];
@@ -4816,6 +4993,7 @@ raac_t *raac_open(const uint8_t *asc, size_t asc_size)
       raac_make_twiddles(a->tw512_re, a->tw512_im, nl / 4, nl);
       raac_make_twiddles(a->tw64_re, a->tw64_im, ns / 4, ns);
       raac_make_twiddles(a->tw32_re, a->tw32_im, 32, 128);
+      raac_make_fft_twiddles(a->fft_tw_re, a->fft_tw_im);
       if (a->frame_len == 960)
       {
          int k;
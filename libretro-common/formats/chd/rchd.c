@@ -84,20 +84,26 @@
  *   By byte range, by hunk including a final hunk that is partly
  *   padding, and by sector, where each sector is emitted at its own
  *   track's size. Parent references chain through a bound parent.
- *   One decoded hunk is cached.
+ *   Decoded hunks are kept in the staging ring and given up least
+ *   recently used first, and in a cache shared by every handle in the
+ *   process, keyed by the image's digest, once rchd_cache_init() has
+ *   been called.
  *
  * SUPPLYING BYTES
  *   Requests are named by where they read from, so bytes can be
- *   supplied out of order in principle. Borrowing avoids the copy
- *   entirely for a caller that already holds the range.
+ *   supplied out of order. Borrowing avoids the copy entirely for a
+ *   caller that already holds the range.
+ *
+ * PIPELINING
+ *   A staging ring of rchd_set_pipeline_depth() slots. The read
+ *   reports the blobs of the hunks ahead of it, continuing past its
+ *   own end when reads have been walking the image in order, and a
+ *   blob that has fully arrived is decoded by a worker pool sized by
+ *   rchd_set_threads() while the caller fetches the next one.
  *
  * ---------------------------------------------------------------------
  * NOT BUILT
  *
- *   Pipelined fetch      one request is outstanding at a time. The
- *                        staging ring rchd_set_pipeline_depth() sizes
- *                        does not exist, so a depth above one is
- *                        refused rather than accepted and ignored.
  *   avhu audio modes     the raw-delta and Huffman-delta modes are
  *                        written but have never decoded a real stream:
  *                        every hunk of the only A/V image to hand
@@ -167,6 +173,11 @@
 #include <encodings/rzstd.h>
 #endif
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#include <features/features_cpu.h>
+#endif
+
 /* Container limits. A hunk is bounded by the format; the map and
  * metadata bounds are ours, sized well above anything a real image
  * carries, so a corrupt header cannot ask for an unbounded allocation. */
@@ -187,6 +198,13 @@
 #define RCHD_MAX_HUNK_COUNT  (32 * 1024 * 1024)
 /* An A/V hunk states its own channel count; this bounds it. */
 #define RCHD_AV_MAX_CHANNELS 16
+/* The deepest staging ring accepted. Each slot holds a compressed and
+ * a decoded hunk, so at the version 5 hunk size this is 64 MiB, which
+ * is past the point where more depth hides any more latency. */
+#define RCHD_MAX_PIPELINE_DEPTH 64
+/* Decode workers per image. More than the ring has slots would only
+ * ever wait, so the pool is also capped at the depth. */
+#define RCHD_MAX_THREADS     16
 
 /* Decoded map entry, one per hunk. Kept unpacked rather than as the
  * twelve bytes the CRC is computed over: that form exists only to be
@@ -235,6 +253,12 @@ static const char rchd_end_of_list[16] =
 
 static int rchd_build_tracks(rchd_t *chd);
 static int rchd_read_step_bytes(rchd_t *chd, rchd_request_t *req);
+static uint32_t rchd_ring_plan(rchd_t *chd, rchd_request_t *out,
+      uint32_t max);
+static int rchd_ring_supply(rchd_t *chd, uint64_t offset,
+      const uint8_t *data, size_t len, int borrow, size_t *took);
+static void rchd_ring_free(rchd_t *chd);
+static void rchd_pool_stop(rchd_t *chd);
 
 /* -------- byte access --------
  *
@@ -283,6 +307,50 @@ typedef struct rchd_codec_slot
    void               *ctx;
 } rchd_codec_slot_t;
 
+/* Where one slot of the staging ring is in its life. A slot is claimed
+ * for a hunk, collects that hunk's blob, waits to be decoded, and then
+ * holds the decoded hunk until it is the least recently used one and
+ * another hunk needs the room. */
+enum
+{
+   RCHD_SLOT_FREE = 0,
+   RCHD_SLOT_FETCH,   /* blob still arriving                       */
+   RCHD_SLOT_QUEUED,  /* blob complete, waiting for a decoder      */
+   RCHD_SLOT_BUSY,    /* a worker is decoding it                   */
+   RCHD_SLOT_DONE     /* decoded, or failed with @err              */
+};
+
+typedef struct rchd_slot
+{
+   uint64_t  offset;     /* where the blob is read from            */
+   uint8_t  *blob;       /* @blob_owned, or the caller's memory    */
+   uint8_t  *blob_owned;
+   uint8_t  *data;       /* the decoded hunk                       */
+   uint32_t  blob_cap;
+   uint32_t  size;       /* blob length; 0 when nothing is stored  */
+   uint32_t  have;
+   uint32_t  hunk;       /* the hunk decoded, after self references */
+   uint32_t  used;       /* ring clock at the last touch           */
+   uint32_t  ticket;     /* decode order, oldest first             */
+   int       state;
+   int       err;
+   int       borrowed;
+   int       parent;     /* filled by a read of the bound parent   */
+   int       asked;      /* reported by rchd_read_pending()        */
+} rchd_slot_t;
+
+#ifdef HAVE_THREADS
+/* A decode worker. Each has a decoder of its own that shares the
+ * owner's map and holds a copy of its codec table, so the codec state
+ * the decoder keeps between hunks is never shared between threads. */
+typedef struct rchd_worker
+{
+   rchd_t    *owner;
+   rchd_t    *ctx;
+   sthread_t *thread;
+} rchd_worker_t;
+#endif
+
 struct rchd
 {
    rchd_info_t        info;
@@ -355,10 +423,42 @@ struct rchd
    uint16_t          *av_lookup;
    int16_t           *av_samples;
 
-   /* One decoded hunk, kept so a range spanning several hunks, or two
-    * reads inside one, decode each hunk once. */
-   uint8_t           *cache;
-   uint32_t           cached;
+   /* The staging ring, which is also the decoded-hunk cache: @depth
+    * slots, each a hunk being fetched, a hunk waiting to be decoded, or
+    * a decoded hunk kept so a range spanning several hunks, or two
+    * reads inside one, decode each hunk once. Made on the first read.
+    * Depth one is the single cached hunk this reader started with. */
+   rchd_slot_t       *slots;
+   uint32_t           depth;
+   uint32_t           clock;
+   uint32_t           tickets;
+   /* The hunk after the last one a finished read touched. A read
+    * starting there is taken as part of a sequential walk, and the
+    * ring reads ahead past its end. */
+   uint32_t           seq_next;
+   int                rd_seq;
+
+   /* What the last rchd_read_step() asked for, which is where a plain
+    * rchd_feed() puts its bytes once the image is open. */
+   uint64_t           ask_offset;
+   int                ask_source;
+   int                ask_valid;
+
+   /* Whether the image has a digest to key the shared cache on. */
+   int                shared;
+
+   /* Decode threads wanted; zero and one both mean the caller's. */
+   unsigned           threads;
+#ifdef HAVE_THREADS
+   /* The pool, started by the first rchd_read_pending() that can use
+    * it. @lock guards slot states while it runs; with no pool there is
+    * one thread and no lock. */
+   rchd_worker_t     *workers;
+   unsigned           worker_count;
+   slock_t           *lock;
+   scond_t           *cond;
+   int                stop;
+#endif
 
    /* One hunk's worth of sector and subchannel data, before the two are
     * interleaved into the caller's buffer. */
@@ -422,9 +522,9 @@ static int rchd_want(rchd_t *chd, uint64_t offset, size_t len, int source,
  *
  * A request is identified by where it reads from, not by when it was
  * issued, so a caller may hold several fetches and satisfy them as they
- * land. Only one request is outstanding at a time today, which makes
- * that identification trivial rather than unnecessary: a caller written
- * against it keeps working when more become possible.
+ * land. While an image is opening there is one request at a time, held
+ * in @pending; once it is open, every request is for the blob of some
+ * slot in the staging ring, and a supply is matched against the slots.
  */
 
 /* Reports what the decoder is waiting for. */
@@ -432,6 +532,10 @@ uint32_t rchd_read_pending(rchd_t *chd, rchd_request_t *out, uint32_t max)
 {
    if (!chd || !out || !max)
       return 0;
+
+   if (chd->state == RCHD_OPEN_DONE)
+      return rchd_ring_plan(chd, out, max);
+
    if (!chd->pending || chd->pending_have >= chd->pending_size)
       return 0;
 
@@ -441,9 +545,9 @@ uint32_t rchd_read_pending(rchd_t *chd, rchd_request_t *out, uint32_t max)
    return 1;
 }
 
-/* Whether a supply names the range the decoder is actually waiting on.
- * Offered bytes that start anywhere else are refused rather than
- * quietly written at the position that happens to be current. */
+/* Whether a supply names the range the open sequence is actually
+ * waiting on. Offered bytes that start anywhere else are refused rather
+ * than quietly written at the position that happens to be current. */
 static int rchd_supply_matches(const rchd_t *chd, uint64_t offset,
       int source)
 {
@@ -454,44 +558,73 @@ static int rchd_supply_matches(const rchd_t *chd, uint64_t offset,
    return offset == chd->pending_off + chd->pending_have;
 }
 
-int rchd_feed_at(rchd_t *chd, uint64_t offset, int source,
-      const void *data, size_t len)
+/* The one place supplied bytes land. @took receives how many of them
+ * were used, which a plain rchd_feed() needs to know where its next
+ * bytes go. */
+static int rchd_supply(rchd_t *chd, uint64_t offset, int source,
+      const uint8_t *data, size_t len, int borrow, size_t *took)
 {
-   if (!chd || !data)
-      return RCHD_ERROR_PARAM;
+   *took = 0;
+
+   /* Bytes for a parent reference are what the parent asked for, so
+    * they are the parent's to match. */
+   if (source == RCHD_SOURCE_PARENT && chd->state == RCHD_OPEN_DONE)
+   {
+      if (!chd->parent)
+         return RCHD_ERROR_STATE;
+      return rchd_supply(chd->parent, offset, RCHD_SOURCE_SELF,
+            data, len, borrow, took);
+   }
+
+   if (chd->state == RCHD_OPEN_DONE)
+      return rchd_ring_supply(chd, offset, data, len, borrow, took);
+
    if (!rchd_supply_matches(chd, offset, source))
       return RCHD_ERROR_STATE;
 
+   /* Borrowing only helps when the whole request is covered: a partial
+    * borrow would have to be stitched to a copy of the rest, which
+    * costs the copy this exists to avoid. Anything short falls back. */
+   if (borrow && chd->pending_have == 0 && len >= chd->pending_size)
+   {
+      free(chd->pending_owned);
+      chd->pending_owned    = NULL;
+      chd->pending          = (uint8_t*)data;
+      chd->pending_have     = chd->pending_size;
+      chd->pending_borrowed = 1;
+      *took                 = chd->pending_size;
+      return RCHD_OK;
+   }
+
    if (len > chd->pending_size - chd->pending_have)
       len = chd->pending_size - chd->pending_have;
 
    memcpy(chd->pending + chd->pending_have, data, len);
-   chd->pending_have += len;
+   chd->pending_have    += len;
    chd->pending_borrowed = 0;
+   *took                 = len;
    return RCHD_OK;
 }
 
-int rchd_feed_borrow(rchd_t *chd, uint64_t offset, int source,
-      const uint8_t *data, size_t len)
+int rchd_feed_at(rchd_t *chd, uint64_t offset, int source,
+      const void *data, size_t len)
 {
+   size_t took;
+
    if (!chd || !data)
       return RCHD_ERROR_PARAM;
-   if (!rchd_supply_matches(chd, offset, source))
-      return RCHD_ERROR_STATE;
+   return rchd_supply(chd, offset, source, (const uint8_t*)data, len, 0,
+         &took);
+}
 
-   /* Borrowing only helps when the whole request is covered: a partial
-    * borrow would have to be stitched to a copy of the rest, which
-    * costs the copy this exists to avoid. Anything short falls back. */
-   if (chd->pending_have != 0
-         || len < chd->pending_size)
-      return rchd_feed_at(chd, offset, source, data, len);
+int rchd_feed_borrow(rchd_t *chd, uint64_t offset, int source,
+      const uint8_t *data, size_t len)
+{
+   size_t took;
 
-   free(chd->pending_owned);
-   chd->pending_owned    = NULL;
-   chd->pending          = (uint8_t*)data;
-   chd->pending_have     = chd->pending_size;
-   chd->pending_borrowed = 1;
-   return RCHD_OK;
+   if (!chd || !data)
+      return RCHD_ERROR_PARAM;
+   return rchd_supply(chd, offset, source, data, len, 1, &took);
 }
 
 int rchd_set_pipeline_depth(rchd_t *chd, uint32_t depth)
@@ -499,30 +632,64 @@ int rchd_set_pipeline_depth(rchd_t *chd, uint32_t depth)
    if (!chd || !depth)
       return RCHD_ERROR_PARAM;
 
-   /* One request is outstanding at a time, so depth one is what this
-    * does and anything above it would be a promise the staging ring
-    * does not yet exist to keep. Refused rather than accepted and
-    * ignored: a caller sizing a fetch queue from this needs to know it
-    * did not take. */
-   if (depth > 1)
+   /* Refused rather than clamped: a caller sizing a fetch queue from
+    * this needs to know it did not take. */
+   if (depth > RCHD_MAX_PIPELINE_DEPTH)
       return RCHD_ERROR_UNSUPPORTED;
 
+   /* The ring is remade at the new size by the next read. Whatever it
+    * held is dropped, including fetches in flight, which the read then
+    * simply asks for again. */
+   if (depth != chd->depth)
+   {
+      rchd_ring_free(chd);
+      chd->depth = depth;
+   }
+   return RCHD_OK;
+}
+
+int rchd_set_threads(rchd_t *chd, unsigned threads)
+{
+   if (!chd)
+      return RCHD_ERROR_PARAM;
+
+#ifdef HAVE_THREADS
+   if (!threads)
+      threads = (unsigned)cpu_features_get_core_amount();
+   if (threads > RCHD_MAX_THREADS)
+      threads = RCHD_MAX_THREADS;
+   if (threads != chd->threads)
+      rchd_pool_stop(chd);
+#endif
+   chd->threads = threads;
    return RCHD_OK;
 }
 
 int rchd_feed(rchd_t *chd, const void *data, size_t len)
 {
+   size_t took;
+   int    err;
+
    if (!chd || !data)
       return RCHD_ERROR_PARAM;
-   if (!chd->pending || chd->pending_have >= chd->pending_size)
-      return RCHD_ERROR_STATE;
 
-   if (len > chd->pending_size - chd->pending_have)
-      len = chd->pending_size - chd->pending_have;
+   if (chd->state != RCHD_OPEN_DONE)
+   {
+      if (!chd->pending || chd->pending_have >= chd->pending_size)
+         return RCHD_ERROR_STATE;
+      return rchd_supply(chd, chd->pending_off + chd->pending_have,
+            chd->pending_src, (const uint8_t*)data, len, 0, &took);
+   }
 
-   memcpy(chd->pending + chd->pending_have, data, len);
-   chd->pending_have += len;
-   return RCHD_OK;
+   /* Ping-pong once open: the bytes are for whatever the last step
+    * asked for, and the next ones follow on from them. */
+   if (!chd->ask_valid)
+      return RCHD_ERROR_STATE;
+   err = rchd_supply(chd, chd->ask_offset, chd->ask_source,
+         (const uint8_t*)data, len, 0, &took);
+   if (err == RCHD_OK)
+      chd->ask_offset += took;
+   return err;
 }
 
 /* -------- header -------- */
@@ -1074,15 +1241,10 @@ rchd_t *rchd_new(void)
    return (rchd_t*)calloc(1, sizeof(rchd_t));
 }
 
-void rchd_free(rchd_t *chd)
+/* What a decoder keeps between hunks for its codecs. Apart from the
+ * rest of rchd_free because a decode worker owns exactly this much. */
+static void rchd_codec_state_free(rchd_t *chd)
 {
-   if (!chd)
-      return;
-   free(chd->map);
-   free(chd->pending_owned);
-   free(chd->metadata);
-   free(chd->meta);
-   free(chd->codecs);
    free(chd->huff_lookup);
    free(chd->huff_dec);
    if (chd->inflate)
@@ -1090,12 +1252,24 @@ void rchd_free(rchd_t *chd)
 #ifdef HAVE_RCHD_LZMA
    free(chd->lzma);
 #endif
-   free(chd->cache);
    free(chd->cd_scratch);
-   free(chd->tracks);
-   free(chd->sec_frame);
    free(chd->av_lookup);
    free(chd->av_samples);
+}
+
+void rchd_free(rchd_t *chd)
+{
+   if (!chd)
+      return;
+   rchd_ring_free(chd);
+   rchd_codec_state_free(chd);
+   free(chd->map);
+   free(chd->pending_owned);
+   free(chd->metadata);
+   free(chd->meta);
+   free(chd->codecs);
+   free(chd->tracks);
+   free(chd->sec_frame);
    free(chd);
 }
 
@@ -1227,6 +1401,10 @@ int rchd_open_step(rchd_t *chd, rchd_request_t *req)
 
          rchd_meta_resolve(chd);
          rchd_infer_unit_bytes(chd);
+         {
+            static const uint8_t none[20];
+            chd->shared = memcmp(chd->info.sha1, none, 20) != 0;
+         }
          if ((err = rchd_build_tracks(chd)) != RCHD_OK)
             return err;
          free(chd->pending_owned);
@@ -1352,6 +1530,10 @@ int rchd_register_codec(rchd_t *chd, uint32_t tag,
    if (!chd)
       return RCHD_ERROR_PARAM;
 
+   /* Workers decode from a copy of the table, so they are let go and
+    * the next read starts them again with this registration in it. */
+   rchd_pool_stop(chd);
+
    if ((slot = rchd_find_codec(chd, tag)))
    {
       slot->fn  = fn;
@@ -2323,22 +2505,11 @@ static int rchd_build_hunk(rchd_t *chd, uint32_t hunk,
 /* -------- reading --------
  *
  * A read walks the hunks its byte range covers. For each one it names
- * the blob it needs, decodes it once into a cache, and copies out the
- * slice wanted. The cache means a range spanning several hunks, or two
- * reads within one hunk, decode each hunk once.
+ * the blob it needs, decodes it once into a slot of the staging ring,
+ * and copies out the slice wanted. The ring means a range spanning
+ * several hunks, or two reads within one hunk, decode each hunk once.
  */
 
-static int rchd_cache_alloc(rchd_t *chd)
-{
-   if (!chd->cache)
-   {
-      if (!(chd->cache = (uint8_t*)malloc(chd->info.hunk_bytes)))
-         return RCHD_ERROR_MEM;
-      chd->cached = (uint32_t)-1;
-   }
-   return RCHD_OK;
-}
-
 /* Which hunk actually holds a hunk's data, following a self reference
  * to its target. A chain is not expected and not followed: a reference
  * to a reference is a malformed map, not a shape to support. */
@@ -2375,6 +2546,793 @@ static int rchd_resolve_self(const rchd_t *chd, uint32_t hunk, uint32_t *out)
    return RCHD_OK;
 }
 
+/* -------- the shared hunk cache --------
+ *
+ * Decoded hunks kept for every handle in the process, so that two
+ * handles on the same image -- a scan and an achievement hash of the
+ * same disc, say -- decompress each hunk once between them. A hunk is
+ * keyed by the image's combined SHA-1 and its hunk size, which is what
+ * makes two handles the same image whatever path they were opened by,
+ * and by its index. An image whose header carries no digest, which is
+ * every image before version 3, is not cached here: there is nothing to
+ * tell two of them apart by.
+ *
+ * A parent is an image like any other, so hunks a child reads through
+ * its parent are cached under the parent's key and shared with anything
+ * else reading that parent, or another child of it.
+ *
+ * Off until rchd_cache_init() is called, which also creates the lock,
+ * so that no two threads race to make it.
+ */
+
+#define RCHD_CACHE_BUCKETS       4096
+#define RCHD_CACHE_DEFAULT_BYTES (32 * 1024 * 1024)
+
+typedef struct rchd_cache_entry
+{
+   struct rchd_cache_entry *chain;   /* next in the bucket      */
+   struct rchd_cache_entry *newer;   /* LRU list, newest first  */
+   struct rchd_cache_entry *older;
+   uint8_t                  sha1[20];
+   uint32_t                 hunk_bytes;
+   uint32_t                 hunk;
+   /* The hunk itself follows, in the same allocation. */
+} rchd_cache_entry_t;
+
+static rchd_cache_entry_t **rchd_cache_table;
+static rchd_cache_entry_t  *rchd_cache_newest;
+static rchd_cache_entry_t  *rchd_cache_oldest;
+static size_t               rchd_cache_bytes;
+static size_t               rchd_cache_budget;
+static uint32_t             rchd_cache_entries;
+static uint64_t             rchd_cache_hits;
+static uint64_t             rchd_cache_misses;
+static uint64_t             rchd_cache_evictions;
+#ifdef HAVE_THREADS
+static slock_t             *rchd_cache_lock;
+#define RCHD_CACHE_LOCK()   do { if (rchd_cache_lock) slock_lock(rchd_cache_lock);   } while (0)
+#define RCHD_CACHE_UNLOCK() do { if (rchd_cache_lock) slock_unlock(rchd_cache_lock); } while (0)
+#else
+#define RCHD_CACHE_LOCK()   do { } while (0)
+#define RCHD_CACHE_UNLOCK() do { } while (0)
+#endif
+
+static uint32_t rchd_cache_bucket(const uint8_t *sha1, uint32_t hunk)
+{
+   uint32_t h = rchd_rd32(sha1) ^ (hunk * 0x9E3779B1u);
+   return (h ^ (h >> 15)) & (RCHD_CACHE_BUCKETS - 1);
+}
+
+static rchd_cache_entry_t **rchd_cache_find(const rchd_t *chd, uint32_t hunk)
+{
+   rchd_cache_entry_t **p = &rchd_cache_table[
+         rchd_cache_bucket(chd->info.sha1, hunk)];
+
+   for (; *p; p = &(*p)->chain)
+      if ((*p)->hunk == hunk && (*p)->hunk_bytes == chd->info.hunk_bytes
+            && !memcmp((*p)->sha1, chd->info.sha1, 20))
+         break;
+   return p;
+}
+
+static void rchd_cache_unlink(rchd_cache_entry_t *e)
+{
+   if (e->newer)
+      e->newer->older = e->older;
+   else
+      rchd_cache_newest = e->older;
+   if (e->older)
+      e->older->newer = e->newer;
+   else
+      rchd_cache_oldest = e->newer;
+}
+
+static void rchd_cache_push(rchd_cache_entry_t *e)
+{
+   e->newer = NULL;
+   e->older = rchd_cache_newest;
+   if (rchd_cache_newest)
+      rchd_cache_newest->newer = e;
+   else
+      rchd_cache_oldest = e;
+   rchd_cache_newest = e;
+}
+
+static void rchd_cache_drop(rchd_cache_entry_t *e)
+{
+   rchd_cache_entry_t **p = &rchd_cache_table[
+         rchd_cache_bucket(e->sha1, e->hunk)];
+
+   while (*p != e)
+      p = &(*p)->chain;
+   *p = e->chain;
+   rchd_cache_unlink(e);
+   rchd_cache_bytes -= sizeof(*e) + e->hunk_bytes;
+   rchd_cache_entries--;
+   free(e);
+}
+
+/* Copies a cached hunk into @dst. Counts a hit or a miss, and is only
+ * asked for hunks that would otherwise be fetched and decoded. */
+static int rchd_cache_get(const rchd_t *chd, uint32_t hunk, uint8_t *dst)
+{
+   rchd_cache_entry_t *e;
+
+   if (!chd->shared || !rchd_cache_budget)
+      return 0;
+
+   RCHD_CACHE_LOCK();
+   if (!rchd_cache_table || !(e = *rchd_cache_find(chd, hunk)))
+   {
+      rchd_cache_misses++;
+      RCHD_CACHE_UNLOCK();
+      return 0;
+   }
+   rchd_cache_unlink(e);
+   rchd_cache_push(e);
+   memcpy(dst, e + 1, e->hunk_bytes);
+   rchd_cache_hits++;
+   RCHD_CACHE_UNLOCK();
+   return 1;
+}
+
+static void rchd_cache_put(const rchd_t *chd, uint32_t hunk,
+      const uint8_t *src)
+{
+   rchd_cache_entry_t *e;
+   size_t              cost = sizeof(*e) + chd->info.hunk_bytes;
+
+   if (!chd->shared || cost > rchd_cache_budget)
+      return;
+   /* Made outside the lock; a hunk another handle put in first is the
+    * rare case, and costs only this allocation. */
+   if (!(e = (rchd_cache_entry_t*)malloc(cost)))
+      return;
+   memcpy(e->sha1, chd->info.sha1, 20);
+   e->hunk_bytes = chd->info.hunk_bytes;
+   e->hunk       = hunk;
+   memcpy(e + 1, src, chd->info.hunk_bytes);
+
+   RCHD_CACHE_LOCK();
+   if (!rchd_cache_table || *rchd_cache_find(chd, hunk))
+   {
+      RCHD_CACHE_UNLOCK();
+      free(e);
+      return;
+   }
+   while (rchd_cache_oldest && rchd_cache_bytes + cost > rchd_cache_budget)
+   {
+      rchd_cache_drop(rchd_cache_oldest);
+      rchd_cache_evictions++;
+   }
+   e->chain = rchd_cache_table[rchd_cache_bucket(e->sha1, hunk)];
+   rchd_cache_table[rchd_cache_bucket(e->sha1, hunk)] = e;
+   rchd_cache_push(e);
+   rchd_cache_bytes += cost;
+   rchd_cache_entries++;
+   RCHD_CACHE_UNLOCK();
+}
+
+void rchd_cache_init(size_t budget)
+{
+   if (rchd_cache_table)
+      return;
+#ifdef HAVE_THREADS
+   if (!(rchd_cache_lock = slock_new()))
+      return;
+#endif
+   if (!(rchd_cache_table = (rchd_cache_entry_t**)calloc(
+               RCHD_CACHE_BUCKETS, sizeof(*rchd_cache_table))))
+   {
+#ifdef HAVE_THREADS
+      slock_free(rchd_cache_lock);
+      rchd_cache_lock = NULL;
+#endif
+      return;
+   }
+   rchd_cache_budget = budget ? budget : RCHD_CACHE_DEFAULT_BYTES;
+}
+
+void rchd_cache_deinit(void)
+{
+   if (!rchd_cache_table)
+      return;
+   while (rchd_cache_oldest)
+      rchd_cache_drop(rchd_cache_oldest);
+   free(rchd_cache_table);
+   rchd_cache_table     = NULL;
+   rchd_cache_budget    = 0;
+   rchd_cache_hits      = 0;
+   rchd_cache_misses    = 0;
+   rchd_cache_evictions = 0;
+#ifdef HAVE_THREADS
+   slock_free(rchd_cache_lock);
+   rchd_cache_lock = NULL;
+#endif
+}
+
+void rchd_cache_stats(rchd_cache_stats_t *out)
+{
+   if (!out)
+      return;
+   RCHD_CACHE_LOCK();
+   out->hits      = rchd_cache_hits;
+   out->misses    = rchd_cache_misses;
+   out->evictions = rchd_cache_evictions;
+   out->bytes     = rchd_cache_bytes;
+   out->budget    = rchd_cache_budget;
+   out->entries   = rchd_cache_entries;
+   RCHD_CACHE_UNLOCK();
+}
+
+/* -------- the staging ring --------
+ *
+ * Slots are found by the hunk they decode, so a self reference to a
+ * hunk already in the ring costs nothing. All the bookkeeping happens
+ * on the caller's thread; a worker only ever moves a slot from queued
+ * to busy to done, and that move, and anything reading a state a
+ * worker can change, happens under @lock.
+ */
+
+#ifdef HAVE_THREADS
+#define RCHD_LOCK(chd)   do { if ((chd)->lock) slock_lock((chd)->lock);     } while (0)
+#define RCHD_UNLOCK(chd) do { if ((chd)->lock) slock_unlock((chd)->lock);   } while (0)
+#define RCHD_SIGNAL(chd) do { if ((chd)->cond) scond_broadcast((chd)->cond); } while (0)
+#else
+#define RCHD_LOCK(chd)   do { } while (0)
+#define RCHD_UNLOCK(chd) do { } while (0)
+#define RCHD_SIGNAL(chd) do { } while (0)
+#endif
+
+static int rchd_is_parent_ref(const rchd_t *chd, uint32_t hunk)
+{
+   const rchd_map_entry_t *e = &chd->map[hunk];
+
+   if (chd->info.version >= 5)
+      return e->type == RCHD_V5_PARENT;
+   return e->type == RCHD_V34_PARENT;
+}
+
+/* Decodes a slot's blob with @ctx's codec state. @ctx is the owner
+ * itself or one of its workers; either has the map. */
+static int rchd_decode_slot(rchd_t *ctx, const rchd_slot_t *s)
+{
+   const rchd_map_entry_t *e = &ctx->map[s->hunk];
+   int err = rchd_build_hunk(ctx, s->hunk, s->blob, s->size, s->data);
+
+   /* Versions 3 and 4 record a CRC-32 per hunk; checking it is the
+    * only integrity signal those images carry. */
+   if (err == RCHD_OK
+         && ctx->info.version >= 3 && ctx->info.version <= 4
+         && e->crc != 0
+         && encoding_crc32(0, s->data, ctx->info.hunk_bytes) != e->crc)
+      err = RCHD_ERROR_CRC;
+   return err;
+}
+
+/* Records a finished decode. The blob is not needed any more, so a
+ * borrowed one is handed back here rather than when the read ends. */
+static void rchd_slot_done(rchd_slot_t *s, int err)
+{
+   s->err   = err;
+   s->state = RCHD_SLOT_DONE;
+   if (s->borrowed)
+   {
+      s->blob     = s->blob_owned;
+      s->borrowed = 0;
+   }
+}
+
+static void rchd_slot_queue(rchd_t *chd, rchd_slot_t *s)
+{
+   s->state  = RCHD_SLOT_QUEUED;
+   s->ticket = ++chd->tickets;
+   RCHD_SIGNAL(chd);
+}
+
+#ifdef HAVE_THREADS
+static rchd_slot_t *rchd_next_queued(rchd_t *chd)
+{
+   rchd_slot_t *best = NULL;
+   uint32_t     i;
+
+   for (i = 0; i < chd->depth; i++)
+   {
+      rchd_slot_t *s = &chd->slots[i];
+      if (s->state == RCHD_SLOT_QUEUED
+            && (!best || s->ticket - best->ticket > 0x80000000u))
+         best = s;
+   }
+   return best;
+}
+
+static void rchd_worker_run(void *data)
+{
+   rchd_worker_t *w   = (rchd_worker_t*)data;
+   rchd_t        *chd = w->owner;
+
+   slock_lock(chd->lock);
+   while (!chd->stop)
+   {
+      rchd_slot_t *s = rchd_next_queued(chd);
+      int          err;
+
+      if (!s)
+      {
+         scond_wait(chd->cond, chd->lock);
+         continue;
+      }
+      s->state = RCHD_SLOT_BUSY;
+      slock_unlock(chd->lock);
+      if ((err = rchd_decode_slot(w->ctx, s)) == RCHD_OK && s->size)
+         rchd_cache_put(chd, s->hunk, s->data);
+      slock_lock(chd->lock);
+      rchd_slot_done(s, err);
+      scond_broadcast(chd->cond);
+   }
+   slock_unlock(chd->lock);
+}
+
+/* Lets the workers go. A slot one of them is decoding is finished
+ * first; anything still queued stays queued and is decoded by the
+ * caller when a read reaches it, or by the next pool. */
+static void rchd_pool_stop(rchd_t *chd)
+{
+   unsigned i;
+
+   if (!chd->workers)
+      return;
+
+   slock_lock(chd->lock);
+   chd->stop = 1;
+   scond_broadcast(chd->cond);
+   slock_unlock(chd->lock);
+
+   for (i = 0; i < chd->worker_count; i++)
+   {
+      rchd_worker_t *w = &chd->workers[i];
+      if (w->thread)
+         sthread_join(w->thread);
+      if (w->ctx)
+      {
+         rchd_codec_state_free(w->ctx);
+         free(w->ctx->codecs);
+         free(w->ctx);
+      }
+   }
+   free(chd->workers);
+   scond_free(chd->cond);
+   slock_free(chd->lock);
+   chd->workers      = NULL;
+   chd->worker_count = 0;
+   chd->cond         = NULL;
+   chd->lock         = NULL;
+   chd->stop         = 0;
+}
+
+/* Starts the pool, if it would have anything to do. A failure leaves
+ * the caller's thread decoding everything, which is slower and no less
+ * correct, so it is not reported. */
+static void rchd_pool_start(rchd_t *chd)
+{
+   unsigned n = chd->threads, i;
+
+   if (chd->workers || n < 2 || chd->depth < 2)
+      return;
+   if (n > chd->depth)
+      n = chd->depth;
+
+   /* Built here, before any worker exists, so no two of them race to
+    * build the tables on their first stripped CD frame. */
+   rchd_ecc_tables();
+
+   if (!(chd->workers = (rchd_worker_t*)calloc(n, sizeof(*chd->workers))))
+      return;
+   chd->lock = slock_new();
+   chd->cond = scond_new();
+   if (!chd->lock || !chd->cond)
+   {
+      chd->worker_count = 0;
+      rchd_pool_stop(chd);
+      return;
+   }
+
+   for (i = 0; i < n; i++)
+   {
+      rchd_worker_t *w = &chd->workers[i];
+      rchd_t        *c = rchd_new();
+
+      chd->worker_count = i + 1;
+      w->owner = chd;
+      w->ctx   = c;
+      if (!c)
+         break;
+      c->info  = chd->info;
+      c->map   = chd->map;
+      c->state = RCHD_OPEN_DONE;
+      if (chd->codec_count)
+      {
+         if (!(c->codecs = (rchd_codec_slot_t*)malloc(
+                     chd->codec_count * sizeof(*c->codecs))))
+            break;
+         memcpy(c->codecs, chd->codecs,
+               chd->codec_count * sizeof(*c->codecs));
+         c->codec_count = chd->codec_count;
+      }
+      if (!(w->thread = sthread_create(rchd_worker_run, w)))
+         break;
+   }
+
+   if (i < n)
+      rchd_pool_stop(chd);
+}
+#else
+static void rchd_pool_stop(rchd_t *chd) { (void)chd; }
+#endif
+
+static void rchd_ring_free(rchd_t *chd)
+{
+   uint32_t i;
+
+   rchd_pool_stop(chd);
+   if (!chd->slots)
+      return;
+   for (i = 0; i < chd->depth; i++)
+   {
+      free(chd->slots[i].blob_owned);
+      free(chd->slots[i].data);
+   }
+   free(chd->slots);
+   chd->slots = NULL;
+}
+
+static int rchd_ring_alloc(rchd_t *chd)
+{
+   if (!chd->depth)
+      chd->depth = 1;
+   if (!chd->slots && !(chd->slots = (rchd_slot_t*)calloc(chd->depth,
+               sizeof(*chd->slots))))
+      return RCHD_ERROR_MEM;
+   return RCHD_OK;
+}
+
+static rchd_slot_t *rchd_slot_find(rchd_t *chd, uint32_t hunk)
+{
+   uint32_t i;
+
+   for (i = 0; i < chd->depth; i++)
+      if (chd->slots[i].state != RCHD_SLOT_FREE
+            && chd->slots[i].hunk == hunk)
+         return &chd->slots[i];
+   return NULL;
+}
+
+/* Takes a slot for @hunk: a free one, or else the least recently used
+ * one not touched since @keep. Slots a worker is decoding are never
+ * taken. Returns RCHD_OK with *out NULL when every slot is spoken for,
+ * which is the ring being full rather than anything going wrong. */
+static int rchd_slot_claim(rchd_t *chd, uint32_t hunk, uint32_t keep,
+      rchd_slot_t **out)
+{
+   const rchd_map_entry_t *e = &chd->map[hunk];
+   rchd_slot_t            *s = NULL;
+   uint32_t                i;
+
+   *out = NULL;
+   for (i = 0; i < chd->depth; i++)
+   {
+      rchd_slot_t *c = &chd->slots[i];
+
+      if (c->state == RCHD_SLOT_FREE)
+      {
+         s = c;
+         break;
+      }
+      if (c->state == RCHD_SLOT_BUSY || c->used - keep < 0x80000000u)
+         continue;
+      if (!s || c->used - s->used > 0x80000000u)
+         s = c;
+   }
+   if (!s)
+      return RCHD_OK;
+
+   if (!s->data && !(s->data = (uint8_t*)malloc(chd->info.hunk_bytes)))
+      return RCHD_ERROR_MEM;
+
+   s->state    = RCHD_SLOT_FREE;
+   s->hunk     = hunk;
+   s->parent   = rchd_is_parent_ref(chd, hunk);
+   s->offset   = e->offset;
+   s->size     = s->parent ? 0 : e->length;
+   s->have     = 0;
+   s->err      = RCHD_OK;
+   s->asked    = 0;
+   s->borrowed = 0;
+   s->used     = ++chd->clock;
+   if (s->size > s->blob_cap)
+   {
+      free(s->blob_owned);
+      s->blob_cap = 0;
+      if (!(s->blob_owned = (uint8_t*)malloc(s->size)))
+         return RCHD_ERROR_MEM;
+      s->blob_cap = s->size;
+   }
+   s->blob = s->blob_owned;
+
+   /* A hole, a mini hunk or a parent reference stores no blob, so there
+    * is nothing to fetch. The first two can be decoded at once; the
+    * last is read from the parent when the read reaches it, and the
+    * parent looks in the shared cache under its own key. Anything else
+    * another handle may have decoded already. */
+   if (s->size && rchd_cache_get(chd, hunk, s->data))
+   {
+      s->err   = RCHD_OK;
+      s->state = RCHD_SLOT_DONE;
+   }
+   else if (s->parent || s->size)
+      s->state = RCHD_SLOT_FETCH;
+   else
+      rchd_slot_queue(chd, s);
+   *out = s;
+   return RCHD_OK;
+}
+
+/* Plans the window the armed read looks ahead over, claiming slots for
+ * the hunks in it and reporting the blobs not yet asked for. The window
+ * is the next @depth hunks from the read's position; it runs on past
+ * the read's own end when the read began where the last one finished,
+ * since a caller walking an image in order will want those next. */
+static uint32_t rchd_ring_plan(rchd_t *chd, rchd_request_t *out,
+      uint32_t max)
+{
+   uint64_t at;
+   uint32_t hunk, last, keep, i, n = 0;
+
+   if (!chd->reading || chd->rd_done >= chd->rd_len)
+      return 0;
+   if (rchd_ring_alloc(chd) != RCHD_OK)
+      return 0;
+#ifdef HAVE_THREADS
+   rchd_pool_start(chd);
+#endif
+
+   at    = chd->rd_offset + chd->rd_done;
+   hunk  = (uint32_t)(at / chd->info.hunk_bytes);
+   last  = (uint32_t)((chd->rd_offset + chd->rd_len - 1)
+         / chd->info.hunk_bytes);
+   if (chd->rd_seq)
+      last = chd->info.hunk_count - 1;
+   keep  = chd->clock + 1;
+
+   RCHD_LOCK(chd);
+   for (i = 0; i < chd->depth && hunk + i <= last; i++)
+   {
+      rchd_slot_t *s;
+      uint32_t     src;
+
+      if (rchd_resolve_self(chd, hunk + i, &src) != RCHD_OK)
+         break;
+      /* Parent references are the parent's to fetch, and only once the
+       * read reaches them. */
+      if (rchd_is_parent_ref(chd, src))
+         continue;
+      if (!(s = rchd_slot_find(chd, src)))
+      {
+         if (rchd_slot_claim(chd, src, keep, &s) != RCHD_OK || !s)
+            break;
+      }
+      else
+         s->used = ++chd->clock;
+
+      if (s->state == RCHD_SLOT_FETCH && !s->asked && n < max)
+      {
+         out[n].offset = s->offset + s->have;
+         out[n].length = s->size - s->have;
+         out[n].source = RCHD_SOURCE_SELF;
+         s->asked      = 1;
+         n++;
+      }
+   }
+   RCHD_UNLOCK(chd);
+   return n;
+}
+
+static int rchd_ring_supply(rchd_t *chd, uint64_t offset,
+      const uint8_t *data, size_t len, int borrow, size_t *took)
+{
+   rchd_slot_t *s = NULL;
+   uint32_t     i;
+
+   if (!chd->slots)
+      return RCHD_ERROR_STATE;
+
+   /* Only the caller's thread moves a slot into or out of FETCH, so
+    * once found the slot's blob can be filled without the lock. */
+   RCHD_LOCK(chd);
+   for (i = 0; i < chd->depth; i++)
+   {
+      rchd_slot_t *c = &chd->slots[i];
+      if (c->state == RCHD_SLOT_FETCH && c->size
+            && offset == c->offset + c->have)
+      {
+         s = c;
+         break;
+      }
+   }
+   RCHD_UNLOCK(chd);
+   if (!s)
+      return RCHD_ERROR_STATE;
+
+   if (borrow && s->have == 0 && len >= s->size)
+   {
+      s->blob     = (uint8_t*)data;
+      s->borrowed = 1;
+      s->have     = s->size;
+      *took       = s->size;
+   }
+   else
+   {
+      if (len > s->size - s->have)
+         len = s->size - s->have;
+      memcpy(s->blob + s->have, data, len);
+      s->have += (uint32_t)len;
+      *took    = len;
+      /* Whatever is left is reported again. */
+      s->asked = 0;
+   }
+
+   if (s->have == s->size)
+   {
+      RCHD_LOCK(chd);
+      rchd_slot_queue(chd, s);
+      RCHD_UNLOCK(chd);
+   }
+   return RCHD_OK;
+}
+
+/* A borrowed blob has to be let go of before the step returns, since
+ * that is as long as the caller promised to keep it. One still waiting
+ * for a worker is copied; one a worker has is waited for. */
+static void rchd_ring_settle(rchd_t *chd)
+{
+   uint32_t i;
+
+   if (!chd->slots)
+      return;
+
+   RCHD_LOCK(chd);
+   for (i = 0; i < chd->depth; i++)
+   {
+      rchd_slot_t *s = &chd->slots[i];
+
+#ifdef HAVE_THREADS
+      while (s->borrowed && s->state == RCHD_SLOT_BUSY)
+         scond_wait(chd->cond, chd->lock);
+#endif
+      if (!s->borrowed)
+         continue;
+      if (s->size > s->blob_cap)
+      {
+         uint8_t *b = (uint8_t*)malloc(s->size);
+         if (!b)
+         {
+            s->state    = RCHD_SLOT_FREE;
+            s->borrowed = 0;
+            continue;
+         }
+         free(s->blob_owned);
+         s->blob_owned = b;
+         s->blob_cap   = s->size;
+      }
+      memcpy(s->blob_owned, s->blob, s->size);
+      s->blob     = s->blob_owned;
+      s->borrowed = 0;
+   }
+   RCHD_UNLOCK(chd);
+}
+
+/* Brings the slot for @hunk to a decoded state: asks for its blob if
+ * it is still arriving, decodes it here if no worker has, or waits for
+ * the worker that has. */
+static int rchd_slot_ready(rchd_t *chd, uint32_t hunk, rchd_request_t *req,
+      rchd_slot_t **out)
+{
+   rchd_slot_t *s;
+   int          err;
+
+   RCHD_LOCK(chd);
+   while (!(s = rchd_slot_find(chd, hunk)))
+   {
+      if ((err = rchd_slot_claim(chd, hunk, chd->clock + 1, &s))
+            != RCHD_OK)
+      {
+         RCHD_UNLOCK(chd);
+         return err;
+      }
+      if (s)
+         break;
+#ifdef HAVE_THREADS
+      /* Every slot is being decoded; one will be done shortly. */
+      scond_wait(chd->cond, chd->lock);
+#endif
+   }
+   s->used = ++chd->clock;
+
+   for (;;)
+   {
+      switch (s->state)
+      {
+         case RCHD_SLOT_FETCH:
+            if (s->parent)
+            {
+               /* A parent reference is the parent's data at a unit
+                * position, so it is read from the bound parent. */
+               RCHD_UNLOCK(chd);
+               if (!chd->parent)
+                  err = RCHD_ERROR_NO_PARENT;
+               else if ((err = rchd_read_begin(chd->parent,
+                           s->offset * chd->info.unit_bytes,
+                           s->data, chd->info.hunk_bytes)) == RCHD_OK)
+                  err = rchd_read_step(chd->parent, req);
+               if (err == RCHD_PENDING)
+               {
+                  req->source = RCHD_SOURCE_PARENT;
+                  return RCHD_PENDING;
+               }
+               RCHD_LOCK(chd);
+               rchd_slot_done(s, err);
+               break;
+            }
+            RCHD_UNLOCK(chd);
+            req->offset = s->offset + s->have;
+            req->length = s->size - s->have;
+            req->source = RCHD_SOURCE_SELF;
+            return RCHD_PENDING;
+
+         case RCHD_SLOT_QUEUED:
+            s->state = RCHD_SLOT_BUSY;
+            RCHD_UNLOCK(chd);
+            if ((err = rchd_decode_slot(chd, s)) == RCHD_OK && s->size)
+               rchd_cache_put(chd, s->hunk, s->data);
+            RCHD_LOCK(chd);
+            rchd_slot_done(s, err);
+            break;
+
+#ifdef HAVE_THREADS
+         case RCHD_SLOT_BUSY:
+            scond_wait(chd->cond, chd->lock);
+            break;
+#endif
+
+         case RCHD_SLOT_DONE:
+            err = s->err;
+            /* A failed hunk is forgotten, so asking again retries it
+             * instead of repeating the failure from the cache. */
+            if (err != RCHD_OK)
+               s->state = RCHD_SLOT_FREE;
+            RCHD_UNLOCK(chd);
+            *out = s;
+            return err;
+
+         default:
+            RCHD_UNLOCK(chd);
+            return RCHD_ERROR_STATE;
+      }
+   }
+}
+
+/* Forgets which fetches were reported, so a re-armed read reports them
+ * again. */
+static void rchd_ring_rearm(rchd_t *chd)
+{
+   uint32_t i;
+
+   if (!chd->slots)
+      return;
+   for (i = 0; i < chd->depth; i++)
+      chd->slots[i].asked = 0;
+}
+
 /* -------- CD track table --------
  *
  * A CD image's tracks come from metadata rather than any header field.
@@ -2673,9 +3631,29 @@ int rchd_read_sectors_begin(rchd_t *chd, uint32_t lba, uint32_t count,
    chd->sec_dst    = (uint8_t*)dst;
    chd->reading    = 0;
    chd->sec_active = 1;
+   rchd_ring_rearm(chd);
    return RCHD_OK;
 }
 
+/* Points the byte-range worker at a range. The sector path arms one
+ * frame at a time through this rather than rchd_read_begin, since its
+ * read as a whole has not been re-armed and what it reported still
+ * stands. */
+static void rchd_read_arm(rchd_t *chd, uint64_t offset, uint8_t *dst,
+      size_t len)
+{
+   chd->rd_dst    = dst;
+   chd->rd_len    = len;
+   chd->rd_done   = 0;
+   chd->rd_offset = offset;
+   chd->reading   = 1;
+   if (chd->info.hunk_bytes)
+   {
+      uint32_t first = (uint32_t)(offset / chd->info.hunk_bytes);
+      chd->rd_seq    = first == chd->seq_next || first + 1 == chd->seq_next;
+   }
+}
+
 /* Serves a sector read by pulling whole frames and copying out the part
  * each track carries. */
 static int rchd_read_step_sectors(rchd_t *chd, rchd_request_t *req)
@@ -2697,10 +3675,8 @@ static int rchd_read_step_sectors(rchd_t *chd, rchd_request_t *req)
             if (!chd->sec_frame)
                return RCHD_ERROR_MEM;
          }
-         err = rchd_read_begin(chd, frame * chd->info.unit_bytes,
+         rchd_read_arm(chd, frame * chd->info.unit_bytes,
                chd->sec_frame, chd->info.unit_bytes);
-         if (err != RCHD_OK)
-            return err;
       }
 
       err = rchd_read_step_bytes(chd, req);
@@ -2731,11 +3707,9 @@ int rchd_read_begin(rchd_t *chd, uint64_t offset, void *dst, size_t len)
          || len > chd->info.logical_bytes - offset)
       return RCHD_ERROR_PARAM;
 
-   chd->rd_dst    = (uint8_t*)dst;
-   chd->rd_len    = len;
-   chd->rd_done   = 0;
-   chd->rd_offset = offset;
-   chd->reading   = 1;
+   chd->sec_active = 0;
+   rchd_read_arm(chd, offset, (uint8_t*)dst, len);
+   rchd_ring_rearm(chd);
    return RCHD_OK;
 }
 
@@ -2754,11 +3728,10 @@ int rchd_read_hunk_begin(rchd_t *chd, uint32_t hunk, void *dst)
     * this addresses and the padding is part of what the hunk holds.
     * Half the images in any collection have such a hunk, and it is the
     * one a reader tries last. */
-   chd->rd_dst    = (uint8_t*)dst;
-   chd->rd_len    = chd->info.hunk_bytes;
-   chd->rd_done   = 0;
-   chd->rd_offset = (uint64_t)hunk * chd->info.hunk_bytes;
-   chd->reading   = 1;
+   chd->sec_active = 0;
+   rchd_read_arm(chd, (uint64_t)hunk * chd->info.hunk_bytes,
+         (uint8_t*)dst, chd->info.hunk_bytes);
+   rchd_ring_rearm(chd);
    return RCHD_OK;
 }
 
@@ -2767,22 +3740,18 @@ size_t rchd_read_progress(const rchd_t *chd)
    return chd ? chd->rd_done : 0;
 }
 
-/* The byte-range worker. A sector-addressed read drives this directly
- * rather than going back through rchd_read_step, which would dispatch
- * straight back to the sector path. */
-static int rchd_read_step_bytes(rchd_t *chd, rchd_request_t *req)
+/* The byte-range walk. */
+static int rchd_read_walk(rchd_t *chd, rchd_request_t *req)
 {
-   if (!chd->reading)
-      return RCHD_ERROR_STATE;
-
    while (chd->rd_done < chd->rd_len)
    {
-      uint64_t at    = chd->rd_offset + chd->rd_done;
-      uint32_t hunk  = (uint32_t)(at / chd->info.hunk_bytes);
-      uint32_t skip  = (uint32_t)(at % chd->info.hunk_bytes);
-      size_t   avail = chd->info.hunk_bytes - skip;
-      uint32_t src_hunk;
-      int      err;
+      uint64_t     at    = chd->rd_offset + chd->rd_done;
+      uint32_t     hunk  = (uint32_t)(at / chd->info.hunk_bytes);
+      uint32_t     skip  = (uint32_t)(at % chd->info.hunk_bytes);
+      size_t       avail = chd->info.hunk_bytes - skip;
+      rchd_slot_t *s;
+      uint32_t     src_hunk;
+      int          err;
 
       if (avail > chd->rd_len - chd->rd_done)
          avail = chd->rd_len - chd->rd_done;
@@ -2790,10 +3759,7 @@ static int rchd_read_step_bytes(rchd_t *chd, rchd_request_t *req)
       if (hunk >= chd->info.hunk_count)
          return RCHD_ERROR_DATA;
 
-      if ((err = rchd_cache_alloc(chd)) != RCHD_OK)
-         return err;
-
-      /* Resolve before consulting the cache, and key the cache on what
+      /* Resolve before consulting the ring, and key the ring on what
        * was decoded rather than on what was asked for.
        *
        * A self-reference is a hunk saying "the same bytes as hunk N".
@@ -2801,84 +3767,52 @@ static int rchd_read_step_bytes(rchd_t *chd, rchd_request_t *req)
        * miss and N is decoded twice. Keyed on N, the second one hits. */
       if ((err = rchd_resolve_self(chd, hunk, &src_hunk)) != RCHD_OK)
          return err;
+      if ((err = rchd_slot_ready(chd, src_hunk, req, &s)) != RCHD_OK)
+         return err;
 
-      if (chd->cached != src_hunk)
-      {
-         const rchd_map_entry_t *e;
-         e = &chd->map[src_hunk];
-
-         /* A parent reference is the parent's data at a unit position,
-          * so it is read from the bound parent rather than from here. */
-         if ((chd->info.version >= 5 && e->type == RCHD_V5_PARENT)
-               || (chd->info.version < 5 && e->type == RCHD_V34_PARENT))
-         {
-            if (!chd->parent)
-               return RCHD_ERROR_NO_PARENT;
-            err = rchd_read_begin(chd->parent,
-                  e->offset * chd->info.unit_bytes,
-                  chd->cache, chd->info.hunk_bytes);
-            if (err != RCHD_OK)
-               return err;
-            for (;;)
-            {
-               err = rchd_read_step(chd->parent, req);
-               if (err == RCHD_PENDING)
-               {
-                  req->source = RCHD_SOURCE_PARENT;
-                  return RCHD_PENDING;
-               }
-               if (err != RCHD_OK)
-                  return err;
-               break;
-            }
-            chd->cached = src_hunk;
-         }
-         else
-         {
-            size_t need = e->length;
-            int    ready;
-
-            if (need > 0)
-            {
-               if ((ready = rchd_want(chd, e->offset, need,
-                           RCHD_SOURCE_SELF, req)) < 0)
-                  return RCHD_ERROR_MEM;
-               if (!ready)
-                  return RCHD_PENDING;
-            }
-
-            err = rchd_build_hunk(chd, src_hunk, chd->pending,
-                  (uint32_t)need, chd->cache);
-            if (err != RCHD_OK)
-               return err;
-
-            /* Versions 3 and 4 record a CRC-32 per hunk; checking it is
-             * the only integrity signal those images carry. */
-            if (chd->info.version >= 3 && chd->info.version <= 4
-                  && e->crc != 0
-                  && encoding_crc32(0, chd->cache, chd->info.hunk_bytes)
-                     != e->crc)
-               return RCHD_ERROR_CRC;
-
-            chd->cached = src_hunk;
-         }
-      }
-
-      memcpy(chd->rd_dst + chd->rd_done, chd->cache + skip, avail);
+      memcpy(chd->rd_dst + chd->rd_done, s->data + skip, avail);
       chd->rd_done += avail;
+      chd->seq_next = hunk + 1;
    }
 
    chd->reading = 0;
    return RCHD_OK;
 }
 
+/* The byte-range worker. A sector-addressed read drives this directly
+ * rather than going back through rchd_read_step, which would dispatch
+ * straight back to the sector path. */
+static int rchd_read_step_bytes(rchd_t *chd, rchd_request_t *req)
+{
+   int err;
+
+   if (!chd->reading)
+      return RCHD_ERROR_STATE;
+   if ((err = rchd_ring_alloc(chd)) != RCHD_OK)
+      return err;
+   if ((err = rchd_read_walk(chd, req)) != RCHD_PENDING)
+      rchd_ring_settle(chd);
+   return err;
+}
+
 int rchd_read_step(rchd_t *chd, rchd_request_t *req)
 {
+   int err;
+
    if (!chd || !req)
       return RCHD_ERROR_PARAM;
    if (chd->sec_active)
-      return rchd_read_step_sectors(chd, req);
-   return rchd_read_step_bytes(chd, req);
+      err = rchd_read_step_sectors(chd, req);
+   else
+      err = rchd_read_step_bytes(chd, req);
+
+   chd->ask_valid = (err == RCHD_PENDING);
+   if (err == RCHD_PENDING)
+   {
+      chd->ask_offset = req->offset;
+      chd->ask_source = req->source;
+   }
+   return err;
 }
 
 int rchd_set_parent(rchd_t *chd, rchd_t *parent)
@@ -66,15 +66,18 @@
  * pointer (cast it; the stride counts samples) and
  * rh265_video_bit_depth reports the active depth.
  *
- * Wavefront parallel processing (entropy_coding_sync) decodes
- * serially: slice-header entry points position each CTB row's
+ * Wavefront parallel processing (entropy_coding_sync): slice-header
+ * entry points position each CTB row's
  * substream (offsets translated from the escaped byte domain), the
  * CABAC engine re-anchors per row with contexts carried from after
  * the second CTB of the row above (9.3.2.2-3, falling back to slice
  * initialisation across slice boundaries), end_of_subset bits close
  * each row, and qPY_PREV resets to SliceQpY at row starts (8.6.1).
  * Since WPP is x265's default, this is what most real-world HEVC
- * needs.  Multi-slice pictures honour
+ * needs.  With HAVE_THREADS the rows of a WPP slice decode
+ * concurrently on a worker pool, each a two-CTB wavefront behind the
+ * row above (see rh265_wpp.h below; rh265_video_set_threads sizes
+ * it), otherwise serially.  Multi-slice pictures honour
  * slice_loop_filter_across_slices: deblocking skips slice-boundary
  * edges and SAO treats cross-slice neighbours as unavailable when
  * the flag is off (8.7.2, 8.7.3).
@@ -124,6 +127,13 @@
 
 #include <formats/rh265.h>
 
+#ifdef HAVE_THREADS
+#include <boolean.h>
+#include <rthreads/rthreads.h>
+#include <features/features_cpu.h>
+#include <retro_atomic.h>
+#endif
+
 #if defined(_MSC_VER)
 #define RH265_INLINE __forceinline
 #elif defined(__GNUC__)
@@ -3773,6 +3783,12 @@ struct rh265_video
    rh265_sps  sps_tmp;
    rh265_pps  pps_tmp;
    rh265_shdr sh_tmp;
+
+   unsigned threads;          /* requested decode threads, 0 = auto */
+#ifdef HAVE_THREADS
+   struct rh265_wpp *wpp;     /* wavefront worker pool, lazily created */
+   int wpp_attempted;
+#endif
 };
 
 static void rh265_free_frame(rh265_video *v)
@@ -3932,6 +3948,400 @@ static void rh265_dpb_bump(rh265_video *v, int reorder)
    rh265_dpb_prune(v);
 }
 
+/* CABAC context initialisation at a slice start, or at a WPP row start
+ * with no stored row above to inherit from (9.3.2.2). */
+static void rh265_slice_init_contexts(rh265_dec *d)
+{
+   int init_type = 0;
+   if (d->sh.slice_type == RH265_SLICE_P)
+      init_type = d->sh.cabac_init ? 2 : 1;
+   else if (d->sh.slice_type == RH265_SLICE_B)
+      init_type = d->sh.cabac_init ? 1 : 2;
+   rh265_cabac_init_contexts(&d->cb, d->sh.slice_qp, init_type);
+}
+
+#ifdef HAVE_THREADS
+/* ==================== rh265_wpp.h ==================== */
+/* Wavefront-parallel slice decode.  With entropy_coding_sync every CTB
+ * row of a slice is its own substream whose start is known up front
+ * from the entry points, and a CTB depends only on CTBs to its left
+ * and on the row above up to one CTB to the right (the above-right
+ * intra samples and merge candidates, and the context state stored
+ * after the row's second CTB).  Rows are handed out in order to the
+ * calling thread plus a pool of workers; each decodes with a private
+ * copy of rh265_dec - the per-CU state and scratch buffers - while the
+ * pointers inside it share the picture planes and the per-4x4/8x8/CTB
+ * metadata, which rows write at disjoint positions.  A row waits until
+ * the row above has finished the CTB one to the right of the one it
+ * is about to decode.  The in-loop filters still run over the whole
+ * picture once its last slice is in, so the output is bit-identical
+ * to the serial path.
+ *
+ * Progress is published after every CTB, so it cannot go through the
+ * pool lock: with real atomics each row's count is an atomic word, and
+ * a row that finds the row above not far enough along sets
+ * RH265_WPP_PARKED in that word before sleeping.  Publishing swaps the
+ * count in and clears the bit; only a publish that finds it set takes
+ * the lock to wake the sleeper.  Both are read-modify-writes of the
+ * same word, so one of the two always sees the other. */
+
+#define RH265_MAX_THREADS 16
+
+#if defined(RETRO_ATOMIC_LOCK_FREE) && defined(RETRO_ATOMIC_HAS_CAS)
+#define RH265_WPP_ATOMIC
+#define RH265_WPP_PARKED 0x40000000
+#endif
+
+struct rh265_wpp;
+
+typedef struct rh265_wpp_worker
+{
+   sthread_t *thread;
+   struct rh265_wpp *w;
+   rh265_dec *d;              /* private decoder state, re-seeded per job */
+} rh265_wpp_worker;
+
+typedef struct rh265_wpp
+{
+   slock_t *lock;
+   scond_t *cond;             /* job start, row progress and job end */
+   rh265_wpp_worker workers[RH265_MAX_THREADS - 1];
+   unsigned num_workers;
+
+   /* current job: the rows of one slice segment */
+   const uint8_t *rbsp;
+   size_t size;
+   int first_ry;              /* picture CTB row of the slice's first row */
+   int num_rows;
+   int next_row;              /* next row to hand out */
+   int active;                /* workers still inside the current job */
+   int error;
+   int end_ctb;               /* CTB address after the slice's last CTB */
+   unsigned job_seq;
+   bool shutdown;
+
+   size_t row_off[RH265_MAX_ENTRY_POINTS + 1];  /* substream byte offsets */
+   /* CTBs finished per row */
+#ifdef RH265_WPP_ATOMIC
+   retro_atomic_int_t progress[RH265_MAX_ENTRY_POINTS + 1];
+#else
+   int    progress[RH265_MAX_ENTRY_POINTS + 1];
+#endif
+   /* contexts stored after each row's second CTB (9.3.2.3), state then
+    * MPS, RH265_CTX_COUNT each */
+   uint8_t *ctx;
+   int ctx_rows;
+} rh265_wpp;
+
+static void rh265_wpp_free(rh265_video *v)
+{
+   rh265_wpp *w = v->wpp;
+   unsigned i;
+   if (!w)
+      return;
+   if (w->lock && w->cond)
+   {
+      slock_lock(w->lock);
+      w->shutdown = true;
+      scond_broadcast(w->cond);
+      slock_unlock(w->lock);
+   }
+   for (i = 0; i < w->num_workers; i++)
+      if (w->workers[i].thread)
+         sthread_join(w->workers[i].thread);
+   for (i = 0; i < RH265_MAX_THREADS - 1; i++)
+      free(w->workers[i].d);
+   if (w->cond)
+      scond_free(w->cond);
+   if (w->lock)
+      slock_free(w->lock);
+   free(w->ctx);
+   free(w);
+   v->wpp = NULL;
+}
+
+/* Block until row 'row' has finished 'need' CTBs.  Returns 0 when the
+ * job failed meanwhile. */
+static int rh265_wpp_wait(rh265_wpp *w, int row, int need)
+{
+   int ok;
+#ifdef RH265_WPP_ATOMIC
+   /* the row above is usually ahead: no lock at all */
+   if ((retro_atomic_load_acquire_int(&w->progress[row])
+            & ~RH265_WPP_PARKED) >= need)
+      return 1;
+   slock_lock(w->lock);
+   /* parked again on every pass - the publish that woke us cleared it */
+   while (!w->error && (retro_atomic_fetch_or_int(&w->progress[row],
+               RH265_WPP_PARKED) & ~RH265_WPP_PARKED) < need)
+      scond_wait(w->cond, w->lock);
+#else
+   slock_lock(w->lock);
+   while (w->progress[row] < need && !w->error)
+      scond_wait(w->cond, w->lock);
+#endif
+   ok = !w->error;
+   slock_unlock(w->lock);
+   return ok;
+}
+
+static void rh265_wpp_publish(rh265_wpp *w, int row, int done)
+{
+#ifdef RH265_WPP_ATOMIC
+   if (!(retro_atomic_exchange_int(&w->progress[row], done)
+            & RH265_WPP_PARKED))
+      return;
+#endif
+   slock_lock(w->lock);
+#ifndef RH265_WPP_ATOMIC
+   w->progress[row] = done;
+#endif
+   scond_broadcast(w->cond);
+   slock_unlock(w->lock);
+}
+
+/* Decode one CTB row of the current job on decoder state d.  Returns
+ * the CTB address after the row's last CTB, or -1. */
+static int rh265_wpp_row(rh265_wpp *w, rh265_dec *d, int row)
+{
+   const rh265_sps *sps = d->sps;
+   int ry       = w->first_ry + row;
+   int ctb_addr = row ? ry * sps->ctb_w : d->slice_start_ctb;
+   int row_end  = (ry + 1) * sps->ctb_w;
+   int last     = (row == w->num_rows - 1);
+   uint8_t *ctx = w->ctx + (size_t)row * 2 * RH265_CTX_COUNT;
+
+   rh265_cabac_init_engine(&d->cb, w->rbsp + w->row_off[row],
+         w->rbsp + w->size);
+   if (row && sps->ctb_w > 1 &&
+       ctb_addr - sps->ctb_w + 1 >= d->slice_start_ctb)
+   {
+      /* the second CTB of the row above is in this slice: inherit the
+       * contexts it stored */
+      if (!rh265_wpp_wait(w, row - 1, 2))
+         return -1;
+      memcpy(d->cb.state, ctx - 2 * RH265_CTX_COUNT, sizeof(d->cb.state));
+      memcpy(d->cb.mps,   ctx - RH265_CTX_COUNT,     sizeof(d->cb.mps));
+   }
+   else
+      rh265_slice_init_contexts(d);
+
+   d->qp_y                 = d->sh.slice_qp;
+   d->qp_y_pred            = d->sh.slice_qp;
+   d->first_qg             = 1;
+   d->cu_qp_delta          = 0;
+   d->is_cu_qp_delta_coded = 0;
+
+   while (ctb_addr < row_end)
+   {
+      int rx = ctb_addr % sps->ctb_w;
+      int x0 = rx << sps->log2_ctb;
+      int y0 = ry << sps->log2_ctb;
+
+      if (row && !rh265_wpp_wait(w, row - 1,
+               rh265_min(rx + 2, sps->ctb_w)))
+         return -1;
+
+      d->ctb_slice[ctb_addr]     = (uint16_t)d->slice_seq;
+      d->ctb_lf_across[ctb_addr] =
+            (uint8_t)d->sh.loop_filter_across_slices;
+      d->cur_zaddr = rh265_zaddr(d, x0, y0);
+      if (sps->sao_enabled)
+         rh265_sao_param(d, rx, ry);
+      if (rh265_coding_quadtree(d, x0, y0, sps->log2_ctb, 0) < 0)
+         return -1;
+      if (rx == 1)
+      {
+         memcpy(ctx,                   d->cb.state, sizeof(d->cb.state));
+         memcpy(ctx + RH265_CTX_COUNT, d->cb.mps,   sizeof(d->cb.mps));
+      }
+      ctb_addr++;
+      rh265_wpp_publish(w, row, rx + 1);
+      if (rh265_cabac_terminate(&d->cb))
+      {
+         /* end_of_slice_segment_flag: only the last substream may
+          * carry it, the entry points said more rows follow */
+         return last ? ctb_addr : -1;
+      }
+      if (rx == sps->ctb_w - 1)
+      {
+         /* the last row must have ended the slice by now; the others
+          * close their substream with end_of_subset_one_bit */
+         if (last || !rh265_cabac_terminate(&d->cb))
+            return -1;
+      }
+   }
+   return ctb_addr;
+}
+
+/* Pull rows of the current job until none are left. */
+static void rh265_wpp_run(rh265_wpp *w, rh265_dec *d)
+{
+   for (;;)
+   {
+      int row, ret;
+      slock_lock(w->lock);
+      row = (!w->error && w->next_row < w->num_rows) ? w->next_row++ : -1;
+      slock_unlock(w->lock);
+      if (row < 0)
+         break;
+      ret = rh265_wpp_row(w, d, row);
+      slock_lock(w->lock);
+      if (ret < 0)
+      {
+         w->error = 1;
+         scond_broadcast(w->cond);
+      }
+      else if (row == w->num_rows - 1)
+         w->end_ctb = ret;
+      slock_unlock(w->lock);
+      /* a finished row never holds up the row below, whatever its
+       * slice coverage */
+      rh265_wpp_publish(w, row, d->sps->ctb_w);
+   }
+}
+
+static void rh265_wpp_thread(void *data)
+{
+   rh265_wpp_worker *wk = (rh265_wpp_worker*)data;
+   rh265_wpp *w         = wk->w;
+   unsigned seen        = 0;
+   slock_lock(w->lock);
+   for (;;)
+   {
+      while (!w->shutdown && w->job_seq == seen)
+         scond_wait(w->cond, w->lock);
+      if (w->shutdown)
+         break;
+      seen = w->job_seq;
+      slock_unlock(w->lock);
+      rh265_wpp_run(w, wk->d);
+      slock_lock(w->lock);
+      w->active--;
+      scond_broadcast(w->cond);
+   }
+   slock_unlock(w->lock);
+}
+
+/* Lazily creates the worker pool.  Returns 0 when no usable pool
+ * exists, in which case WPP slices decode serially. */
+static int rh265_wpp_init(rh265_video *v)
+{
+   unsigned i, num_threads;
+   rh265_wpp *w;
+
+   if (v->wpp)
+      return 1;
+   /* only attempt pool creation once per decoder */
+   if (v->wpp_attempted)
+      return 0;
+   v->wpp_attempted = 1;
+
+   num_threads = v->threads ? v->threads : cpu_features_get_core_amount();
+   if (num_threads < 2)
+      return 0;
+   if (num_threads > RH265_MAX_THREADS)
+      num_threads = RH265_MAX_THREADS;
+
+   if (!(w = (rh265_wpp*)calloc(1, sizeof(*w))))
+      return 0;
+   v->wpp = w;
+   if (!(w->lock = slock_new()) || !(w->cond = scond_new()))
+      goto error;
+
+   /* the calling thread decodes rows too */
+   for (i = 0; i < num_threads - 1; i++)
+   {
+      rh265_wpp_worker *wk = &w->workers[i];
+      wk->w = w;
+      if (!(wk->d = (rh265_dec*)malloc(sizeof(rh265_dec))))
+         goto error;
+      if (!(wk->thread = sthread_create(rh265_wpp_thread, wk)))
+         goto error;
+      w->num_workers = i + 1;
+   }
+   return 1;
+
+error:
+   rh265_wpp_free(v);
+   return 0;
+}
+
+/* Decode a WPP slice whose first substream starts at unescaped byte
+ * data_byte; esc_base/esc_idx describe that position in the escaped
+ * domain as in rh265_decode_slice_data.  Returns as that function. */
+static int rh265_wpp_decode(rh265_video *v, const uint8_t *rbsp,
+      size_t size, size_t data_byte, size_t esc_base, int esc_idx,
+      const uint32_t *esc_pos, int esc_count)
+{
+   rh265_dec *d = &v->d;
+   rh265_wpp *w = v->wpp;
+   int num_rows = d->sh.num_entry_points + 1;
+   int i;
+   unsigned k;
+
+   w->first_ry = d->slice_start_ctb / d->sps->ctb_w;
+   if (w->first_ry + num_rows > d->sps->ctb_h)
+      return -1;
+   w->row_off[0] = data_byte;
+   for (i = 1; i < num_rows; i++)
+   {
+      esc_base += d->sh.entry_point[i - 1];
+      while (esc_idx < esc_count && esc_pos[esc_idx] < esc_base)
+         esc_idx++;
+      w->row_off[i] = esc_base - (size_t)esc_idx;
+      if (w->row_off[i] > size)
+         return -1;
+   }
+   if (num_rows > w->ctx_rows)
+   {
+      uint8_t *ctx = (uint8_t*)realloc(w->ctx,
+            (size_t)num_rows * 2 * RH265_CTX_COUNT);
+      if (!ctx)
+         return -1;
+      w->ctx      = ctx;
+      w->ctx_rows = num_rows;
+   }
+   /* the partial first row is complete up to the slice start; the
+    * lock taken to start the job publishes these */
+#ifdef RH265_WPP_ATOMIC
+   for (i = 0; i < num_rows; i++)
+      retro_atomic_int_init(&w->progress[i],
+            i ? 0 : d->slice_start_ctb % d->sps->ctb_w);
+#else
+   for (i = 0; i < num_rows; i++)
+      w->progress[i] = 0;
+   w->progress[0] = d->slice_start_ctb % d->sps->ctb_w;
+#endif
+
+   /* workers are idle between jobs, so their state can be re-seeded
+    * from the slice-level decoder state without the lock */
+   for (k = 0; k < w->num_workers; k++)
+      memcpy(w->workers[k].d, d, sizeof(*d));
+
+   slock_lock(w->lock);
+   w->rbsp     = rbsp;
+   w->size     = size;
+   w->num_rows = num_rows;
+   w->next_row = 0;
+   w->error    = 0;
+   w->end_ctb  = -1;
+   w->active   = (int)w->num_workers;
+   w->job_seq++;
+   scond_broadcast(w->cond);
+   slock_unlock(w->lock);
+
+   rh265_wpp_run(w, d);
+
+   slock_lock(w->lock);
+   while (w->active)
+      scond_wait(w->cond, w->lock);
+   slock_unlock(w->lock);
+
+   return w->error ? -1 : w->end_ctb;
+}
+#endif
+
 /* Decode the slice_segment_data of one I slice.  rbsp/size cover the
  * whole slice NAL payload (unescaped); data_bit is the first bit after
  * the slice header's byte alignment. */
@@ -3964,14 +4374,7 @@ static int rh265_decode_slice_data(rh265_video *v, const uint8_t *rbsp,
    }
 
    rh265_cabac_init_engine(&d->cb, rbsp + data_bit / 8, rbsp + size);
-   {
-      int init_type = 0;
-      if (d->sh.slice_type == RH265_SLICE_P)
-         init_type = d->sh.cabac_init ? 2 : 1;
-      else if (d->sh.slice_type == RH265_SLICE_B)
-         init_type = d->sh.cabac_init ? 1 : 2;
-      rh265_cabac_init_contexts(&d->cb, d->sh.slice_qp, init_type);
-   }
+   rh265_slice_init_contexts(d);
 
    d->sl = NULL;
    if (sps->scaling_list_enabled)
@@ -3987,6 +4390,13 @@ static int rh265_decode_slice_data(rh265_video *v, const uint8_t *rbsp,
          (ctb_addr % sps->ctb_w) << sps->log2_ctb,
          (ctb_addr / sps->ctb_w) << sps->log2_ctb);
 
+#ifdef HAVE_THREADS
+   if (wpp && d->sh.num_entry_points > 0 && v->threads != 1 &&
+         rh265_wpp_init(v))
+      return rh265_wpp_decode(v, rbsp, size, data_bit / 8,
+            esc_base, esc_idx, esc_pos, esc_count);
+#endif
+
    while (ctb_addr < sps->pic_size_ctbs)
    {
       int rx = ctb_addr % sps->ctb_w;
@@ -4020,14 +4430,7 @@ static int rh265_decode_slice_data(rh265_video *v, const uint8_t *rbsp,
             memcpy(d->cb.mps,   d->wpp_mps,   sizeof(d->cb.mps));
          }
          else
-         {
-            int init_type = 0;
-            if (d->sh.slice_type == RH265_SLICE_P)
-               init_type = d->sh.cabac_init ? 2 : 1;
-            else if (d->sh.slice_type == RH265_SLICE_B)
-               init_type = d->sh.cabac_init ? 1 : 2;
-            rh265_cabac_init_contexts(&d->cb, d->sh.slice_qp, init_type);
-         }
+            rh265_slice_init_contexts(d);
          /* qPY_PREV resets to SliceQpY at the first quantisation group
           * of a WPP CTB row (8.6.1) */
          d->qp_y_pred = d->sh.slice_qp;
@@ -4417,10 +4820,25 @@ void rh265_video_close(rh265_video *v)
 {
    if (!v)
       return;
+#ifdef HAVE_THREADS
+   rh265_wpp_free(v);
+#endif
    rh265_free_frame(v);
    free(v);
 }
 
+void rh265_video_set_threads(rh265_video *v, unsigned threads)
+{
+   if (!v || v->threads == threads)
+      return;
+   v->threads = threads;
+#ifdef HAVE_THREADS
+   /* the pool is sized at creation; rebuild it on the next WPP slice */
+   rh265_wpp_free(v);
+   v->wpp_attempted = 0;
+#endif
+}
+
 /* hvcC: HEVCDecoderConfigurationRecord (ISO/IEC 14496-15 8.3.3.1) */
 int rh265_video_set_extradata(rh265_video *v, const uint8_t *hvcc, size_t len)
 {
@@ -96,6 +96,7 @@ struct rmp4_video_stream
    int          is10;       /* last decoded frame written as 10-bit    */
    int          emit_argb;  /* emit ARGB words instead of the default
                                R,G,B,A memory order (8-bit paths)     */
+   unsigned     threads;    /* decoder thread count, 0 = auto          */
 };
 
 /* Still-image decode progress across sliced process calls. */
@@ -477,6 +478,7 @@ static bool rmp4_video_stream_open_decoder(rmp4_video_stream_t *s)
          const rmp4_track *t = rmp4_get_track(s->demux, s->track);
          if (!(s->h265 = rh265_video_open()))
             return false;
+         rh265_video_set_threads(s->h265, s->threads);
          if (t && t->codec_private && t->codec_private_size)
             rh265_video_set_extradata(s->h265, t->codec_private,
                   t->codec_private_size);
@@ -726,6 +728,16 @@ void rmp4_video_stream_set_argb(rmp4_video_stream_t *s, int argb)
       s->emit_argb = argb ? 1 : 0;
 }
 
+void rmp4_video_stream_set_threads(rmp4_video_stream_t *s,
+      unsigned threads)
+{
+   if (!s)
+      return;
+   s->threads = threads;
+   if (s->h265)
+      rh265_video_set_threads(s->h265, threads);
+}
+
 /* Display duration of packet 'idx', in ms, from the pre-scanned
  * timestamp table; 0 when unknown (caller applies its default). */
 static int rmp4_video_duration_ms(const rmp4_video_stream_t *s, int idx)
@@ -49,6 +49,25 @@
 
 #include "rmpeg1_tables.h"
 
+/* SSE2 and NEON kernels for the IDCT, the motion compensation averages and
+ * the RGB conversion. Every one reproduces the scalar integer arithmetic
+ * bit for bit -- prediction feeds on its own output, so an approximation
+ * here would drift across a GOP rather than stay a one-frame error.
+ * Define RMPEG1_NO_SIMD to build the scalar code alone, which is how the
+ * two are compared. */
+#if !defined(RMPEG1_NO_SIMD)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RMPEG1_SSE2 1
+#include <emmintrin.h>
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define RMPEG1_NEON 1
+#include <arm_neon.h>
+#endif
+#endif
+
 /* The generated tables stay the single source of truth; the decoder builds a
  * lookup index over them at init rather than carrying a second, hand-written
  * copy of the same data in a faster shape.
@@ -490,6 +509,7 @@ static bool alloc_planes(rmpeg1_video_t *v)
 #define W6 1108
 #define W7 565
 
+#if !defined(RMPEG1_SSE2) && !defined(RMPEG1_NEON)
 static void idct_row(const int16_t *in, int *b)
 {
    int x0, x1, x2, x3, x4, x5, x6, x7, x8;
@@ -734,10 +754,467 @@ static void idct_block_add(const int16_t *blk, uint8_t *dst, unsigned stride)
       idct_col_add(tmp + i, dst + i, stride);
 }
 
+#else
+
+/* The vector IDCT runs the same two passes, four rows or four columns to a
+ * register: rows are transposed in so each row pass lane holds one row, and
+ * the 32-bit row results are transposed back so each column pass lane holds
+ * one column.
+ *
+ * The scalar code shares W7 * (x4 + x5) between two outputs to save a
+ * multiply. Here that is undone into direct sums, W1 * x4 + W7 * x5 and so
+ * on -- in integers the two are the same number, and the direct form is a
+ * multiply-accumulate. Two further details keep it exact rather than close:
+ *
+ * - The rotation by 181/256 widens to 64 bits in the scalar code. Here it
+ *   is split as 181 * (s >> 8) + ((181 * (s & 255) + 128) >> 8), which is
+ *   the same floor and never leaves 32 bits.
+ * - The DC-only shortcuts are not taken. With every AC term zero the
+ *   general path produces exactly what they do, so the test buys nothing
+ *   when eight lanes go through the butterflies together. */
+
+#if defined(RMPEG1_SSE2)
+typedef __m128i rmpeg1_v32;
+
+static INLINE __m128i rmpeg1_mul32(__m128i a, int k)
+{
+#if defined(__SSE4_1__)
+   return _mm_mullo_epi32(a, _mm_set1_epi32(k));
+#else
+   /* The low 32 bits of a product are the same signed or unsigned, so the
+    * unsigned even-lane multiply serves for both halves. */
+   const __m128i kk  = _mm_set1_epi32(k);
+   __m128i       ev  = _mm_mul_epu32(a, kk);
+   __m128i       od  = _mm_mul_epu32(_mm_srli_epi64(a, 32), kk);
+   return _mm_unpacklo_epi32(_mm_shuffle_epi32(ev, _MM_SHUFFLE(0, 0, 2, 0)),
+                             _mm_shuffle_epi32(od, _MM_SHUFFLE(0, 0, 2, 0)));
+#endif
+}
+
+#define RMPEG1_ADD(a, b)  _mm_add_epi32(a, b)
+#define RMPEG1_SUB(a, b)  _mm_sub_epi32(a, b)
+#define RMPEG1_SRA(a, n)  _mm_srai_epi32(a, n)
+#define RMPEG1_MUL(a, k)  rmpeg1_mul32(a, k)
+#define RMPEG1_SPLAT(k)   _mm_set1_epi32(k)
+
+static INLINE __m128i rmpeg1_rot181(__m128i s)
+{
+   /* s & 255 is a non-negative 16-bit value with a zero upper half, so a
+    * pairwise multiply-add by 181 is a plain 32-bit product. */
+   __m128i lo = _mm_madd_epi16(_mm_and_si128(s, _mm_set1_epi32(255)),
+         _mm_set1_epi32(181));
+   return _mm_add_epi32(rmpeg1_mul32(_mm_srai_epi32(s, 8), 181),
+         _mm_srai_epi32(_mm_add_epi32(lo, _mm_set1_epi32(128)), 8));
+}
+#else
+typedef int32x4_t rmpeg1_v32;
+
+#define RMPEG1_ADD(a, b)  vaddq_s32(a, b)
+#define RMPEG1_SUB(a, b)  vsubq_s32(a, b)
+#define RMPEG1_SRA(a, n)  vshrq_n_s32(a, n)
+#define RMPEG1_MUL(a, k)  vmulq_n_s32(a, k)
+#define RMPEG1_SPLAT(k)   vdupq_n_s32(k)
+
+static INLINE int32x4_t rmpeg1_rot181(int32x4_t s)
+{
+   int32x4_t lo = vmulq_n_s32(vandq_s32(s, vdupq_n_s32(255)), 181);
+   return vaddq_s32(vmulq_n_s32(vshrq_n_s32(s, 8), 181),
+         vshrq_n_s32(vaddq_s32(lo, vdupq_n_s32(128)), 8));
+}
+#endif
+
+/* The butterflies both passes share, from the point where the scalar code
+ * has x0 (DC plus rounding), x1 (the scaled in[4] term), the even pair
+ * x2/x3 and the odd quartet x4..x7. The results are left unshifted; the
+ * passes differ only in the shift. */
+static INLINE void rmpeg1_idct_bfly(rmpeg1_v32 x0, rmpeg1_v32 x1,
+      rmpeg1_v32 x2, rmpeg1_v32 x3, rmpeg1_v32 x4, rmpeg1_v32 x5,
+      rmpeg1_v32 x6, rmpeg1_v32 x7, rmpeg1_v32 *o)
+{
+   rmpeg1_v32 x8 = RMPEG1_ADD(x0, x1);
+   x0 = RMPEG1_SUB(x0, x1);
+   x1 = RMPEG1_ADD(x4, x6);
+   x4 = RMPEG1_SUB(x4, x6);
+   x6 = RMPEG1_ADD(x5, x7);
+   x5 = RMPEG1_SUB(x5, x7);
+
+   x7 = RMPEG1_ADD(x8, x3);
+   x8 = RMPEG1_SUB(x8, x3);
+   x3 = RMPEG1_ADD(x0, x2);
+   x0 = RMPEG1_SUB(x0, x2);
+   x2 = rmpeg1_rot181(RMPEG1_ADD(x4, x5));
+   x4 = rmpeg1_rot181(RMPEG1_SUB(x4, x5));
+
+   o[0] = RMPEG1_ADD(x7, x1);
+   o[1] = RMPEG1_ADD(x3, x2);
+   o[2] = RMPEG1_ADD(x0, x4);
+   o[3] = RMPEG1_ADD(x8, x6);
+   o[4] = RMPEG1_SUB(x8, x6);
+   o[5] = RMPEG1_SUB(x0, x4);
+   o[6] = RMPEG1_SUB(x3, x2);
+   o[7] = RMPEG1_SUB(x7, x1);
+}
+
+/* Column pass over four columns. v[k] holds row k of the row pass output. */
+static INLINE void rmpeg1_idct_cols(const rmpeg1_v32 *v, rmpeg1_v32 *o)
+{
+   const rmpeg1_v32 r4 = RMPEG1_SPLAT(4);
+   rmpeg1_v32 x4, x5, x6, x7, x2, x3;
+   int i;
+
+   x4 = RMPEG1_SRA(RMPEG1_ADD(RMPEG1_ADD(RMPEG1_MUL(v[1], W1),
+               RMPEG1_MUL(v[7], W7)), r4), 3);
+   x5 = RMPEG1_SRA(RMPEG1_ADD(RMPEG1_SUB(RMPEG1_MUL(v[1], W7),
+               RMPEG1_MUL(v[7], W1)), r4), 3);
+   x6 = RMPEG1_SRA(RMPEG1_ADD(RMPEG1_ADD(RMPEG1_MUL(v[5], W5),
+               RMPEG1_MUL(v[3], W3)), r4), 3);
+   x7 = RMPEG1_SRA(RMPEG1_ADD(RMPEG1_SUB(RMPEG1_MUL(v[5], W3),
+               RMPEG1_MUL(v[3], W5)), r4), 3);
+   x2 = RMPEG1_SRA(RMPEG1_ADD(RMPEG1_SUB(RMPEG1_MUL(v[2], W6),
+               RMPEG1_MUL(v[6], W2)), r4), 3);
+   x3 = RMPEG1_SRA(RMPEG1_ADD(RMPEG1_ADD(RMPEG1_MUL(v[2], W2),
+               RMPEG1_MUL(v[6], W6)), r4), 3);
+
+   rmpeg1_idct_bfly(
+         RMPEG1_ADD(RMPEG1_MUL(v[0], 256), RMPEG1_SPLAT(8192)),
+         RMPEG1_MUL(v[4], 256), x2, x3, x4, x5, x6, x7, o);
+
+   for (i = 0; i < 8; i++)
+      o[i] = RMPEG1_SRA(o[i], 14);
+}
+
+#if defined(RMPEG1_SSE2)
+#define RMPEG1_TRANSPOSE4(a, b, c, d) \
+   do { \
+      __m128i t0_ = _mm_unpacklo_epi32(a, b); \
+      __m128i t1_ = _mm_unpacklo_epi32(c, d); \
+      __m128i t2_ = _mm_unpackhi_epi32(a, b); \
+      __m128i t3_ = _mm_unpackhi_epi32(c, d); \
+      a = _mm_unpacklo_epi64(t0_, t1_); \
+      b = _mm_unpackhi_epi64(t0_, t1_); \
+      c = _mm_unpacklo_epi64(t2_, t3_); \
+      d = _mm_unpackhi_epi64(t2_, t3_); \
+   } while (0)
+
+/* Pairs two 16-bit coefficients for _mm_madd_epi16: the first multiplies
+ * the even lane of an unpacked pair, the second the odd one. */
+#define RMPEG1_K2(ka, kb) _mm_set_epi16(kb, ka, kb, ka, kb, ka, kb, ka)
+
+/* Row pass over four rows. pAB interleaves transposed columns A and B, so
+ * a multiply-add gives kA * in[A] + kB * in[B] for each row. */
+static INLINE void rmpeg1_idct_rows(__m128i p04, __m128i p26,
+      __m128i p17, __m128i p53, __m128i *o)
+{
+   const __m128i r128 = _mm_set1_epi32(128);
+   int i;
+
+   rmpeg1_idct_bfly(
+         _mm_add_epi32(_mm_madd_epi16(p04, RMPEG1_K2(2048, 0)), r128),
+         _mm_madd_epi16(p04, RMPEG1_K2(0, 2048)),
+         _mm_madd_epi16(p26, RMPEG1_K2(W6, -W2)),
+         _mm_madd_epi16(p26, RMPEG1_K2(W2, W6)),
+         _mm_madd_epi16(p17, RMPEG1_K2(W1, W7)),
+         _mm_madd_epi16(p17, RMPEG1_K2(W7, -W1)),
+         _mm_madd_epi16(p53, RMPEG1_K2(W5, W3)),
+         _mm_madd_epi16(p53, RMPEG1_K2(W3, -W5)),
+         o);
+
+   for (i = 0; i < 8; i++)
+      o[i] = _mm_srai_epi32(o[i], 8);
+}
+
+/* Both passes; leaves each output row as eight int16 lanes, saturated
+ * (which the final clamp makes harmless). */
+static void rmpeg1_idct(const int16_t *blk, __m128i *out)
+{
+   __m128i c[8], b[2][8], o[2][8];
+   int     h;
+
+   /* 8x8 int16 transpose: c[k] holds coefficient k of every row. */
+   {
+      __m128i r0 = _mm_loadu_si128((const __m128i*)(blk +  0));
+      __m128i r1 = _mm_loadu_si128((const __m128i*)(blk +  8));
+      __m128i r2 = _mm_loadu_si128((const __m128i*)(blk + 16));
+      __m128i r3 = _mm_loadu_si128((const __m128i*)(blk + 24));
+      __m128i r4 = _mm_loadu_si128((const __m128i*)(blk + 32));
+      __m128i r5 = _mm_loadu_si128((const __m128i*)(blk + 40));
+      __m128i r6 = _mm_loadu_si128((const __m128i*)(blk + 48));
+      __m128i r7 = _mm_loadu_si128((const __m128i*)(blk + 56));
+      __m128i a0 = _mm_unpacklo_epi16(r0, r1);
+      __m128i a1 = _mm_unpacklo_epi16(r2, r3);
+      __m128i a2 = _mm_unpacklo_epi16(r4, r5);
+      __m128i a3 = _mm_unpacklo_epi16(r6, r7);
+      __m128i a4 = _mm_unpackhi_epi16(r0, r1);
+      __m128i a5 = _mm_unpackhi_epi16(r2, r3);
+      __m128i a6 = _mm_unpackhi_epi16(r4, r5);
+      __m128i a7 = _mm_unpackhi_epi16(r6, r7);
+      __m128i b0 = _mm_unpacklo_epi32(a0, a1);
+      __m128i b1 = _mm_unpackhi_epi32(a0, a1);
+      __m128i b2 = _mm_unpacklo_epi32(a2, a3);
+      __m128i b3 = _mm_unpackhi_epi32(a2, a3);
+      __m128i b4 = _mm_unpacklo_epi32(a4, a5);
+      __m128i b5 = _mm_unpackhi_epi32(a4, a5);
+      __m128i b6 = _mm_unpacklo_epi32(a6, a7);
+      __m128i b7 = _mm_unpackhi_epi32(a6, a7);
+      c[0] = _mm_unpacklo_epi64(b0, b2);
+      c[1] = _mm_unpackhi_epi64(b0, b2);
+      c[2] = _mm_unpacklo_epi64(b1, b3);
+      c[3] = _mm_unpackhi_epi64(b1, b3);
+      c[4] = _mm_unpacklo_epi64(b4, b6);
+      c[5] = _mm_unpackhi_epi64(b4, b6);
+      c[6] = _mm_unpacklo_epi64(b5, b7);
+      c[7] = _mm_unpackhi_epi64(b5, b7);
+   }
+
+   /* b[h][k]: output k of rows 4h..4h+3. */
+   rmpeg1_idct_rows(
+         _mm_unpacklo_epi16(c[0], c[4]), _mm_unpacklo_epi16(c[2], c[6]),
+         _mm_unpacklo_epi16(c[1], c[7]), _mm_unpacklo_epi16(c[5], c[3]),
+         b[0]);
+   rmpeg1_idct_rows(
+         _mm_unpackhi_epi16(c[0], c[4]), _mm_unpackhi_epi16(c[2], c[6]),
+         _mm_unpackhi_epi16(c[1], c[7]), _mm_unpackhi_epi16(c[5], c[3]),
+         b[1]);
+
+   /* Back to rows: after this b[h][k] is columns 0..3 (k < 4) or 4..7
+    * (k >= 4) of row 4h + (k & 3). */
+   for (h = 0; h < 2; h++)
+   {
+      RMPEG1_TRANSPOSE4(b[h][0], b[h][1], b[h][2], b[h][3]);
+      RMPEG1_TRANSPOSE4(b[h][4], b[h][5], b[h][6], b[h][7]);
+   }
+
+   for (h = 0; h < 2; h++)
+   {
+      __m128i v[8];
+      v[0] = b[0][4 * h + 0]; v[1] = b[0][4 * h + 1];
+      v[2] = b[0][4 * h + 2]; v[3] = b[0][4 * h + 3];
+      v[4] = b[1][4 * h + 0]; v[5] = b[1][4 * h + 1];
+      v[6] = b[1][4 * h + 2]; v[7] = b[1][4 * h + 3];
+      rmpeg1_idct_cols(v, o[h]);
+   }
+
+   for (h = 0; h < 8; h++)
+      out[h] = _mm_packs_epi32(o[0][h], o[1][h]);
+}
+
+static void idct_block(const int16_t *blk, uint8_t *dst, unsigned stride)
+{
+   __m128i out[8];
+   int     i;
+
+   rmpeg1_idct(blk, out);
+   for (i = 0; i < 8; i++)
+      _mm_storel_epi64((__m128i*)(dst + (size_t)i * stride),
+            _mm_packus_epi16(out[i], out[i]));
+}
+
+static void idct_block_add(const int16_t *blk, uint8_t *dst, unsigned stride)
+{
+   const __m128i zero = _mm_setzero_si128();
+   __m128i out[8];
+   int     i;
+
+   rmpeg1_idct(blk, out);
+   for (i = 0; i < 8; i++)
+   {
+      uint8_t *d = dst + (size_t)i * stride;
+      __m128i  p = _mm_unpacklo_epi8(
+            _mm_loadl_epi64((const __m128i*)d), zero);
+      /* Saturating in 16 bits then to 8 is the scalar clamp: a residual
+       * that saturated is already far outside 0..255 either way. */
+      _mm_storel_epi64((__m128i*)d,
+            _mm_packus_epi16(_mm_adds_epi16(p, out[i]), zero));
+   }
+}
+#else
+#define RMPEG1_TRANSPOSE4(a, b, c, d) \
+   do { \
+      int32x4x2_t p_ = vtrnq_s32(a, b); \
+      int32x4x2_t q_ = vtrnq_s32(c, d); \
+      a = vcombine_s32(vget_low_s32(p_.val[0]),  vget_low_s32(q_.val[0])); \
+      b = vcombine_s32(vget_low_s32(p_.val[1]),  vget_low_s32(q_.val[1])); \
+      c = vcombine_s32(vget_high_s32(p_.val[0]), vget_high_s32(q_.val[0])); \
+      d = vcombine_s32(vget_high_s32(p_.val[1]), vget_high_s32(q_.val[1])); \
+   } while (0)
+
+/* Row pass over four rows; c[k] holds coefficient k of each of them. */
+static INLINE void rmpeg1_idct_rows(const int16x4_t *c, int32x4_t *o)
+{
+   const int32x4_t r128 = vdupq_n_s32(128);
+   int i;
+
+   rmpeg1_idct_bfly(
+         vmlal_n_s16(r128, c[0], 2048),
+         vmull_n_s16(c[4], 2048),
+         vmlsl_n_s16(vmull_n_s16(c[2], W6), c[6], W2),
+         vmlal_n_s16(vmull_n_s16(c[2], W2), c[6], W6),
+         vmlal_n_s16(vmull_n_s16(c[1], W1), c[7], W7),
+         vmlsl_n_s16(vmull_n_s16(c[1], W7), c[7], W1),
+         vmlal_n_s16(vmull_n_s16(c[5], W5), c[3], W3),
+         vmlsl_n_s16(vmull_n_s16(c[5], W3), c[3], W5),
+         o);
+
+   for (i = 0; i < 8; i++)
+      o[i] = vshrq_n_s32(o[i], 8);
+}
+
+static void rmpeg1_idct(const int16_t *blk, int16x8_t *out)
+{
+   int16x4_t c[2][8];
+   int32x4_t b[2][8], o[2][8];
+   int       h;
+
+   /* 8x8 int16 transpose: c[h][k] holds coefficient k of rows 4h..4h+3. */
+   {
+      int16x8x2_t t0 = vtrnq_s16(vld1q_s16(blk +  0), vld1q_s16(blk +  8));
+      int16x8x2_t t1 = vtrnq_s16(vld1q_s16(blk + 16), vld1q_s16(blk + 24));
+      int16x8x2_t t2 = vtrnq_s16(vld1q_s16(blk + 32), vld1q_s16(blk + 40));
+      int16x8x2_t t3 = vtrnq_s16(vld1q_s16(blk + 48), vld1q_s16(blk + 56));
+      int32x4x2_t u0 = vtrnq_s32(vreinterpretq_s32_s16(t0.val[0]),
+                                 vreinterpretq_s32_s16(t1.val[0]));
+      int32x4x2_t u1 = vtrnq_s32(vreinterpretq_s32_s16(t0.val[1]),
+                                 vreinterpretq_s32_s16(t1.val[1]));
+      int32x4x2_t u2 = vtrnq_s32(vreinterpretq_s32_s16(t2.val[0]),
+                                 vreinterpretq_s32_s16(t3.val[0]));
+      int32x4x2_t u3 = vtrnq_s32(vreinterpretq_s32_s16(t2.val[1]),
+                                 vreinterpretq_s32_s16(t3.val[1]));
+#define RMPEG1_LO(x) vreinterpret_s16_s32(vget_low_s32(x))
+#define RMPEG1_HI(x) vreinterpret_s16_s32(vget_high_s32(x))
+      c[0][0] = RMPEG1_LO(u0.val[0]); c[1][0] = RMPEG1_LO(u2.val[0]);
+      c[0][4] = RMPEG1_HI(u0.val[0]); c[1][4] = RMPEG1_HI(u2.val[0]);
+      c[0][2] = RMPEG1_LO(u0.val[1]); c[1][2] = RMPEG1_LO(u2.val[1]);
+      c[0][6] = RMPEG1_HI(u0.val[1]); c[1][6] = RMPEG1_HI(u2.val[1]);
+      c[0][1] = RMPEG1_LO(u1.val[0]); c[1][1] = RMPEG1_LO(u3.val[0]);
+      c[0][5] = RMPEG1_HI(u1.val[0]); c[1][5] = RMPEG1_HI(u3.val[0]);
+      c[0][3] = RMPEG1_LO(u1.val[1]); c[1][3] = RMPEG1_LO(u3.val[1]);
+      c[0][7] = RMPEG1_HI(u1.val[1]); c[1][7] = RMPEG1_HI(u3.val[1]);
+#undef RMPEG1_LO
+#undef RMPEG1_HI
+   }
+
+   for (h = 0; h < 2; h++)
+   {
+      rmpeg1_idct_rows(c[h], b[h]);
+      RMPEG1_TRANSPOSE4(b[h][0], b[h][1], b[h][2], b[h][3]);
+      RMPEG1_TRANSPOSE4(b[h][4], b[h][5], b[h][6], b[h][7]);
+   }
+
+   for (h = 0; h < 2; h++)
+   {
+      int32x4_t v[8];
+      v[0] = b[0][4 * h + 0]; v[1] = b[0][4 * h + 1];
+      v[2] = b[0][4 * h + 2]; v[3] = b[0][4 * h + 3];
+      v[4] = b[1][4 * h + 0]; v[5] = b[1][4 * h + 1];
+      v[6] = b[1][4 * h + 2]; v[7] = b[1][4 * h + 3];
+      rmpeg1_idct_cols(v, o[h]);
+   }
+
+   for (h = 0; h < 8; h++)
+      out[h] = vcombine_s16(vqmovn_s32(o[0][h]), vqmovn_s32(o[1][h]));
+}
+
+static void idct_block(const int16_t *blk, uint8_t *dst, unsigned stride)
+{
+   int16x8_t out[8];
+   int       i;
+
+   rmpeg1_idct(blk, out);
+   for (i = 0; i < 8; i++)
+      vst1_u8(dst + (size_t)i * stride, vqmovun_s16(out[i]));
+}
+
+static void idct_block_add(const int16_t *blk, uint8_t *dst, unsigned stride)
+{
+   int16x8_t out[8];
+   int       i;
+
+   rmpeg1_idct(blk, out);
+   for (i = 0; i < 8; i++)
+   {
+      uint8_t  *d = dst + (size_t)i * stride;
+      int16x8_t p = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(d)));
+      vst1_u8(d, vqmovun_s16(vqaddq_s16(p, out[i])));
+   }
+}
+#endif
+
+#undef RMPEG1_ADD
+#undef RMPEG1_SUB
+#undef RMPEG1_SRA
+#undef RMPEG1_MUL
+#undef RMPEG1_SPLAT
+#endif
+
 /* --------------------------------------------------------------------- */
 /* Motion compensation                                                   */
 /* --------------------------------------------------------------------- */
 
+/* The averages motion compensation is made of. d may alias a: the B picture
+ * interpolation averages the forward prediction in place.
+ *
+ * (a + b + 1) >> 1 is exactly what pavgb and vrhadd compute. The four-point
+ * average is not an average of averages -- that rounds twice -- so it widens
+ * to 16 bits, which holds 4 * 255 + 2 with room to spare. */
+static void mc_avg2(uint8_t *d, const uint8_t *a, const uint8_t *b,
+      unsigned n)
+{
+   unsigned i = 0;
+
+#if defined(RMPEG1_SSE2)
+   for (; i + 16 <= n; i += 16)
+      _mm_storeu_si128((__m128i*)(d + i), _mm_avg_epu8(
+            _mm_loadu_si128((const __m128i*)(a + i)),
+            _mm_loadu_si128((const __m128i*)(b + i))));
+   for (; i + 8 <= n; i += 8)
+      _mm_storel_epi64((__m128i*)(d + i), _mm_avg_epu8(
+            _mm_loadl_epi64((const __m128i*)(a + i)),
+            _mm_loadl_epi64((const __m128i*)(b + i))));
+#elif defined(RMPEG1_NEON)
+   for (; i + 16 <= n; i += 16)
+      vst1q_u8(d + i, vrhaddq_u8(vld1q_u8(a + i), vld1q_u8(b + i)));
+   for (; i + 8 <= n; i += 8)
+      vst1_u8(d + i, vrhadd_u8(vld1_u8(a + i), vld1_u8(b + i)));
+#endif
+   for (; i < n; i++)
+      d[i] = (uint8_t)((a[i] + b[i] + 1) >> 1);
+}
+
+/* a/b are one row, c/e the next; each pair is horizontally adjacent. */
+static void mc_avg4(uint8_t *d, const uint8_t *a, const uint8_t *b,
+      const uint8_t *c, const uint8_t *e, unsigned n)
+{
+   unsigned i = 0;
+
+#if defined(RMPEG1_SSE2)
+   {
+      const __m128i zero = _mm_setzero_si128();
+      const __m128i two  = _mm_set1_epi16(2);
+      for (; i + 8 <= n; i += 8)
+      {
+         __m128i s = _mm_add_epi16(
+               _mm_add_epi16(
+                  _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(a + i)), zero),
+                  _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(b + i)), zero)),
+               _mm_add_epi16(
+                  _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(c + i)), zero),
+                  _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(e + i)), zero)));
+         s = _mm_srli_epi16(_mm_add_epi16(s, two), 2);
+         _mm_storel_epi64((__m128i*)(d + i), _mm_packus_epi16(s, s));
+      }
+   }
+#elif defined(RMPEG1_NEON)
+   for (; i + 8 <= n; i += 8)
+   {
+      uint16x8_t s = vaddq_u16(vaddl_u8(vld1_u8(a + i), vld1_u8(b + i)),
+                               vaddl_u8(vld1_u8(c + i), vld1_u8(e + i)));
+      vst1_u8(d + i, vrshrn_n_u16(s, 2));
+   }
+#endif
+   for (; i < n; i++)
+      d[i] = (uint8_t)((a[i] + b[i] + c[i] + e[i] + 2) >> 2);
+}
+
 /* Copy a bw x bh region from the reference with half-sample interpolation.
  *
  * Motion vectors are in half-sample units, so the integer part is an
@@ -782,9 +1259,7 @@ static void mc_predict(const uint8_t *ref, unsigned stride,
          for (j = 0; j < bh; j++)
          {
             const uint8_t *r = src + (size_t)j * stride;
-            uint8_t       *d = dst + (size_t)j * dstride;
-            for (i = 0; i < bw; i++)
-               d[i] = (uint8_t)((r[i] + r[i + 1] + 1) >> 1);
+            mc_avg2(dst + (size_t)j * dstride, r, r + 1, bw);
          }
       }
       else if (!hx && hy)
@@ -792,9 +1267,7 @@ static void mc_predict(const uint8_t *ref, unsigned stride,
          for (j = 0; j < bh; j++)
          {
             const uint8_t *r = src + (size_t)j * stride;
-            uint8_t       *d = dst + (size_t)j * dstride;
-            for (i = 0; i < bw; i++)
-               d[i] = (uint8_t)((r[i] + r[i + stride] + 1) >> 1);
+            mc_avg2(dst + (size_t)j * dstride, r, r + stride, bw);
          }
       }
       else
@@ -802,10 +1275,8 @@ static void mc_predict(const uint8_t *ref, unsigned stride,
          for (j = 0; j < bh; j++)
          {
             const uint8_t *r = src + (size_t)j * stride;
-            uint8_t       *d = dst + (size_t)j * dstride;
-            for (i = 0; i < bw; i++)
-               d[i] = (uint8_t)((r[i] + r[i + 1]
-                               + r[i + stride] + r[i + stride + 1] + 2) >> 2);
+            mc_avg4(dst + (size_t)j * dstride, r, r + 1,
+                  r + stride, r + stride + 1, bw);
          }
       }
       return;
@@ -1200,22 +1671,20 @@ static bool decode_inter_macroblock(rmpeg1_video_t *v, unsigned addr,
 
       if (fwd_on && bwd_on)
       {
-         unsigned r, c;
+         unsigned r;
 
          for (r = 0; r < 16; r++)
-            for (c = 0; c < 16; c++)
-            {
-               uint8_t *p = py + (size_t)r * v->y_stride + c;
-               *p = (uint8_t)((*p + tmp_y[r * 16 + c] + 1) >> 1);
-            }
+         {
+            uint8_t *p = py + (size_t)r * v->y_stride;
+            mc_avg2(p, p, tmp_y + r * 16, 16);
+         }
          for (r = 0; r < 8; r++)
-            for (c = 0; c < 8; c++)
-            {
-               uint8_t *p = pcb + (size_t)r * v->c_stride + c;
-               uint8_t *q = pcr + (size_t)r * v->c_stride + c;
-               *p = (uint8_t)((*p + tmp_cb[r * 8 + c] + 1) >> 1);
-               *q = (uint8_t)((*q + tmp_cr[r * 8 + c] + 1) >> 1);
-            }
+         {
+            uint8_t *p = pcb + (size_t)r * v->c_stride;
+            uint8_t *q = pcr + (size_t)r * v->c_stride;
+            mc_avg2(p, p, tmp_cb + r * 8, 8);
+            mc_avg2(q, q, tmp_cr + r * 8, 8);
+         }
       }
    }
 
@@ -1697,6 +2166,171 @@ static void emit_picture(rmpeg1_video_t *v, rmpeg1_video_frame_t *out)
     * valid for the lifetime the header promises. */
 }
 
+/* --------------------------------------------------------------------- */
+/* Colour conversion                                                     */
+/* --------------------------------------------------------------------- */
+
+/* 11172-2 samples are CCIR 601: limited range, 4:2:0, with chroma sited
+ * between luma samples. The coefficients are the 8-bit fixed point set
+ * rmp4_video and the webm converter use for BT.601, so an attract-mode
+ * clip looks the same whichever container it arrived in. Chroma is
+ * replicated rather than interpolated, again as they do. */
+static INLINE uint32_t rmpeg1_yuv_px(int y, int u, int v, bool argb)
+{
+   int c = 298 * (y - 16);
+   int d = u - 128;
+   int e = v - 128;
+   int r = (c + 409 * e + 128) >> 8;
+   int g = (c - 100 * d - 208 * e + 128) >> 8;
+   int b = (c + 516 * d + 128) >> 8;
+
+   if (r < 0)
+      r = 0;
+   else if (r > 255)
+      r = 255;
+   if (g < 0)
+      g = 0;
+   else if (g > 255)
+      g = 255;
+   if (b < 0)
+      b = 0;
+   else if (b > 255)
+      b = 255;
+
+   if (argb)
+      return 0xFF000000u
+           | ((uint32_t)r << 16)
+           | ((uint32_t)g << 8)
+           |  (uint32_t)b;
+   return 0xFF000000u
+        | ((uint32_t)b << 16)
+        | ((uint32_t)g << 8)
+        |  (uint32_t)r;
+}
+
+/* One output row, eight pixels at a time. The vector paths are the scalar
+ * arithmetic in 32-bit lanes -- multiply-add, arithmetic shift -- and the
+ * saturating narrows are its clamp; the pre-clamp range, about -223..481,
+ * fits 16 bits, so nothing saturates early. */
+static void rmpeg1_yuv_row(uint32_t *dr, const uint8_t *yr,
+      const uint8_t *ur, const uint8_t *vr, unsigned w, bool argb)
+{
+   unsigned i = 0;
+
+#if defined(RMPEG1_SSE2)
+   {
+      const __m128i k16  = _mm_set1_epi16(16);
+      const __m128i k128 = _mm_set1_epi16(128);
+      const __m128i zero = _mm_setzero_si128();
+      const __m128i ones = _mm_set1_epi16(1);
+      const __m128i a255 = _mm_set1_epi8((char)0xFF);
+      const __m128i rnd  = _mm_set1_epi32(128);
+      /* {y - 16, e} and friends against a coefficient pair per lane, in
+       * _mm_madd_epi16's order: first multiplies the even lane. */
+      const __m128i c_r  = _mm_set_epi16(409, 298, 409, 298, 409, 298, 409, 298);
+      const __m128i c_g1 = _mm_set_epi16(-100, 298, -100, 298, -100, 298, -100, 298);
+      const __m128i c_g2 = _mm_set_epi16(128, -208, 128, -208, 128, -208, 128, -208);
+      const __m128i c_b  = _mm_set_epi16(516, 298, 516, 298, 516, 298, 516, 298);
+
+      for (; i + 8 <= w; i += 8)
+      {
+         int32_t u32, v32;
+         __m128i ys, d, e, ye_lo, ye_hi, yd_lo, yd_hi, e1_lo, e1_hi;
+         __m128i r16, g16, b16, r8, g8, b8, lo, hi;
+
+         ys = _mm_sub_epi16(_mm_unpacklo_epi8(
+                  _mm_loadl_epi64((const __m128i*)(yr + i)), zero), k16);
+         /* four chroma samples, each doubled to cover two pixels */
+         memcpy(&u32, ur + (i >> 1), sizeof(u32));
+         memcpy(&v32, vr + (i >> 1), sizeof(v32));
+         d  = _mm_cvtsi32_si128(u32);
+         e  = _mm_cvtsi32_si128(v32);
+         d  = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_unpacklo_epi8(d, d), zero), k128);
+         e  = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_unpacklo_epi8(e, e), zero), k128);
+
+         ye_lo = _mm_unpacklo_epi16(ys, e);
+         ye_hi = _mm_unpackhi_epi16(ys, e);
+         yd_lo = _mm_unpacklo_epi16(ys, d);
+         yd_hi = _mm_unpackhi_epi16(ys, d);
+         e1_lo = _mm_unpacklo_epi16(e, ones);
+         e1_hi = _mm_unpackhi_epi16(e, ones);
+
+         r16 = _mm_packs_epi32(
+               _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(ye_lo, c_r), rnd), 8),
+               _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(ye_hi, c_r), rnd), 8));
+         g16 = _mm_packs_epi32(
+               _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yd_lo, c_g1),
+                     _mm_madd_epi16(e1_lo, c_g2)), 8),
+               _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yd_hi, c_g1),
+                     _mm_madd_epi16(e1_hi, c_g2)), 8));
+         b16 = _mm_packs_epi32(
+               _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yd_lo, c_b), rnd), 8),
+               _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yd_hi, c_b), rnd), 8));
+         r8  = _mm_packus_epi16(r16, r16);
+         g8  = _mm_packus_epi16(g16, g16);
+         b8  = _mm_packus_epi16(b16, b16);
+
+         lo  = _mm_unpacklo_epi8(argb ? b8 : r8, g8);
+         hi  = _mm_unpacklo_epi8(argb ? r8 : b8, a255);
+         _mm_storeu_si128((__m128i*)(dr + i),     _mm_unpacklo_epi16(lo, hi));
+         _mm_storeu_si128((__m128i*)(dr + i + 4), _mm_unpackhi_epi16(lo, hi));
+      }
+   }
+#elif defined(RMPEG1_NEON)
+   {
+      const int16x8_t k16  = vdupq_n_s16(16);
+      const int16x8_t k128 = vdupq_n_s16(128);
+      const int32x4_t rnd  = vdupq_n_s32(128);
+
+      for (; i + 8 <= w; i += 8)
+      {
+         uint32_t    u32, v32;
+         int16x8_t   ys, d, e;
+         int32x4_t   c_lo, c_hi, r_lo, r_hi, g_lo, g_hi, b_lo, b_hi;
+         int16x8_t   r16, g16, b16;
+         uint8x8x2_t uu, vv;
+         uint8x8x4_t px;
+
+         ys   = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(yr + i))), k16);
+         /* four chroma samples, zipped with themselves to cover two
+          * pixels each; an eight-byte load could run off the plane */
+         memcpy(&u32, ur + (i >> 1), sizeof(u32));
+         memcpy(&v32, vr + (i >> 1), sizeof(v32));
+         uu   = vzip_u8(vreinterpret_u8_u32(vdup_n_u32(u32)),
+                        vreinterpret_u8_u32(vdup_n_u32(u32)));
+         vv   = vzip_u8(vreinterpret_u8_u32(vdup_n_u32(v32)),
+                        vreinterpret_u8_u32(vdup_n_u32(v32)));
+         d    = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(uu.val[0])), k128);
+         e    = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vv.val[0])), k128);
+
+         c_lo = vmlal_n_s16(rnd, vget_low_s16(ys),  298);
+         c_hi = vmlal_n_s16(rnd, vget_high_s16(ys), 298);
+         r_lo = vshrq_n_s32(vmlal_n_s16(c_lo, vget_low_s16(e),  409), 8);
+         r_hi = vshrq_n_s32(vmlal_n_s16(c_hi, vget_high_s16(e), 409), 8);
+         g_lo = vshrq_n_s32(vmlsl_n_s16(vmlsl_n_s16(c_lo,
+                  vget_low_s16(d),  100), vget_low_s16(e),  208), 8);
+         g_hi = vshrq_n_s32(vmlsl_n_s16(vmlsl_n_s16(c_hi,
+                  vget_high_s16(d), 100), vget_high_s16(e), 208), 8);
+         b_lo = vshrq_n_s32(vmlal_n_s16(c_lo, vget_low_s16(d),  516), 8);
+         b_hi = vshrq_n_s32(vmlal_n_s16(c_hi, vget_high_s16(d), 516), 8);
+
+         r16  = vcombine_s16(vqmovn_s32(r_lo), vqmovn_s32(r_hi));
+         g16  = vcombine_s16(vqmovn_s32(g_lo), vqmovn_s32(g_hi));
+         b16  = vcombine_s16(vqmovn_s32(b_lo), vqmovn_s32(b_hi));
+
+         px.val[0] = vqmovun_s16(argb ? b16 : r16);
+         px.val[1] = vqmovun_s16(g16);
+         px.val[2] = vqmovun_s16(argb ? r16 : b16);
+         px.val[3] = vdup_n_u8(0xFF);
+         vst4_u8((uint8_t*)(dr + i), px);
+      }
+   }
+#endif
+
+   for (; i < w; i++)
+      dr[i] = rmpeg1_yuv_px(yr[i], ur[i >> 1], vr[i >> 1], argb);
+}
+
 /* --------------------------------------------------------------------- */
 /* Public entry points                                                   */
 /* --------------------------------------------------------------------- */
@@ -1984,3 +2618,19 @@ uint32_t rmpeg1_video_errors(const rmpeg1_video_t *v)
 {
    return v ? v->errors : 0;
 }
+
+void rmpeg1_video_frame_blit(const rmpeg1_video_frame_t *frame,
+      uint32_t *dst, unsigned dst_stride, bool argb)
+{
+   unsigned j;
+
+   if (!frame || !frame->y || !dst)
+      return;
+
+   for (j = 0; j < frame->height; j++)
+      rmpeg1_yuv_row(dst + (size_t)j * dst_stride,
+            frame->y  + (size_t)j        * frame->y_stride,
+            frame->cb + (size_t)(j >> 1) * frame->c_stride,
+            frame->cr + (size_t)(j >> 1) * frame->c_stride,
+            frame->width, argb);
+}
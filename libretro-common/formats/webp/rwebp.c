@@ -42,6 +42,11 @@
 #include <formats/rwebp.h>
 #include <formats/rvp8.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#include <features/features_cpu.h>
+#endif
+
 /* ===== RIFF Container ===== */
 
 static uint32_t rw32(const uint8_t *p)
@@ -401,6 +406,20 @@ static int vh_read_codes(vbr *br, int ns, uint8_t *lens)
 
 /* ===== VP8L Pixel Math ===== */
 
+/* SSE2/NEON paths for the inverse transforms and the alpha merge,
+ * chosen at compile time like rvp8's (which also owns the lossy
+ * YUV->RGB rows). Every vector path reproduces the scalar arithmetic
+ * exactly; RWEBP_NO_SIMD builds the scalar code alone. */
+#if !defined(RWEBP_NO_SIMD)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RWEBP_VL_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define RWEBP_VL_NEON 1
+#include <arm_neon.h>
+#endif
+#endif
+
 static INLINE uint32_t px_add(uint32_t a, uint32_t b)
 {
    return ((((a>>8)&0xFF00FF)+((b>>8)&0xFF00FF))&0xFF00FF)<<8 |
@@ -458,6 +477,262 @@ static uint32_t px_predict(int m, uint32_t L, uint32_t T, uint32_t TL, uint32_t
    }
 }
 
+/* ---- Inverse-transform row kernels ----
+ * The predictor and colour transforms change parameters only at tile
+ * boundaries, so vlbd_xform_rows hands these whole tile-wide runs of
+ * one row instead of resolving the tile for every pixel. */
+
+#if defined(RWEBP_VL_SSE2)
+/* Floor average per byte, as px_avg2: pavgb rounds up, so take the odd
+ * bit back off. */
+static INLINE __m128i vl_avg2_x(__m128i a, __m128i b)
+{
+   __m128i odd = _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1));
+   return _mm_sub_epi8(_mm_avg_epu8(a, b), odd);
+}
+#define VL_LD(p)     _mm_loadu_si128((const __m128i*)(p))
+#define VL_ST(p, v)  _mm_storeu_si128((__m128i*)(p), (v))
+#define VL_ADD8(a,b) _mm_add_epi8((a), (b))
+#define VL_AVG2(a,b) vl_avg2_x((a), (b))
+#define VL_BLACK()   _mm_set1_epi32((int)0xFF000000u)
+typedef __m128i vl_v;
+#elif defined(RWEBP_VL_NEON)
+#define VL_LD(p)     vld1q_u8((const uint8_t*)(p))
+#define VL_ST(p, v)  vst1q_u8((uint8_t*)(p), (v))
+#define VL_ADD8(a,b) vaddq_u8((a), (b))
+#define VL_AVG2(a,b) vhaddq_u8((a), (b))   /* truncating halving add */
+#define VL_BLACK()   vreinterpretq_u8_u32(vdupq_n_u32(0xFF000000u))
+typedef uint8x16_t vl_v;
+#endif
+
+#if defined(RWEBP_VL_SSE2)
+/* One pixel with its four channels widened to 16-bit lanes, for the
+ * clamping predictors: still serial along the row (each pixel needs
+ * its finished left neighbour), but one saturating pack replaces four
+ * px_clb calls. */
+static INLINE __m128i vl_px_x(uint32_t v)
+{
+   return _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)v), _mm_setzero_si128());
+}
+
+static INLINE uint32_t vl_pack_x(__m128i v)
+{
+   return (uint32_t)_mm_cvtsi128_si32(_mm_packus_epi16(v, v));
+}
+
+/* px_select: summed |L - TL| against summed |T - TL| */
+static INLINE uint32_t vl_select_x(uint32_t TL, uint32_t T, uint32_t L)
+{
+   __m128i tl = _mm_cvtsi32_si128((int)TL);
+   int pl = _mm_cvtsi128_si32(_mm_sad_epu8(_mm_cvtsi32_si128((int)L), tl));
+   int pt = _mm_cvtsi128_si32(_mm_sad_epu8(_mm_cvtsi32_si128((int)T), tl));
+   return (pl - pt <= 0) ? T : L;
+}
+
+static INLINE uint32_t vl_casf_x(uint32_t a, uint32_t b, uint32_t c)
+{
+   return vl_pack_x(_mm_sub_epi16(_mm_add_epi16(vl_px_x(a), vl_px_x(b)),
+            vl_px_x(c)));
+}
+
+/* a + (a - b) / 2 with C's truncating division: add the sign bit
+ * before the arithmetic shift */
+static INLINE uint32_t vl_cash_x(uint32_t a, uint32_t b)
+{
+   __m128i va = vl_px_x(a);
+   __m128i d  = _mm_sub_epi16(va, vl_px_x(b));
+   d = _mm_srai_epi16(_mm_add_epi16(d, _mm_srli_epi16(d, 15)), 1);
+   return vl_pack_x(_mm_add_epi16(va, d));
+}
+#define VL_SELECT(tl, t, l) vl_select_x((tl), (t), (l))
+#define VL_CASF(a, b, c)    vl_casf_x((a), (b), (c))
+#define VL_CASH(a, b)       vl_cash_x((a), (b))
+#elif defined(RWEBP_VL_NEON)
+static INLINE int16x8_t vl_px_n(uint32_t v)
+{
+   return vreinterpretq_s16_u16(vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(v))));
+}
+
+static INLINE uint32_t vl_pack_n(int16x8_t v)
+{
+   return vget_lane_u32(vreinterpret_u32_u8(vqmovun_s16(v)), 0);
+}
+
+static INLINE uint32_t vl_sad_n(uint32_t a, uint32_t b)
+{
+   uint8x8_t d = vabd_u8(vreinterpret_u8_u32(vdup_n_u32(a)),
+         vreinterpret_u8_u32(vdup_n_u32(b)));
+   return vget_lane_u32(vpaddl_u16(vpaddl_u8(d)), 0);
+}
+
+static INLINE uint32_t vl_select_n(uint32_t TL, uint32_t T, uint32_t L)
+{
+   return ((int)vl_sad_n(L, TL) - (int)vl_sad_n(T, TL) <= 0) ? T : L;
+}
+
+static INLINE uint32_t vl_casf_n(uint32_t a, uint32_t b, uint32_t c)
+{
+   return vl_pack_n(vsubq_s16(vaddq_s16(vl_px_n(a), vl_px_n(b)),
+            vl_px_n(c)));
+}
+
+static INLINE uint32_t vl_cash_n(uint32_t a, uint32_t b)
+{
+   int16x8_t va = vl_px_n(a);
+   int16x8_t d  = vsubq_s16(va, vl_px_n(b));
+   d = vshrq_n_s16(vaddq_s16(d, vreinterpretq_s16_u16(
+            vshrq_n_u16(vreinterpretq_u16_s16(d), 15))), 1);
+   return vl_pack_n(vaddq_s16(va, d));
+}
+#define VL_SELECT(tl, t, l) vl_select_n((tl), (t), (l))
+#define VL_CASF(a, b, c)    vl_casf_n((a), (b), (c))
+#define VL_CASH(a, b)       vl_cash_n((a), (b))
+#endif
+
+/* Add the mode-m prediction to the n residuals at cur, whose row above
+ * is upper. Runs never start at column 0, so cur[-1] and upper[-1] are
+ * valid, and upper[n] is at worst the current row's first pixel (the
+ * top-right wrap px_predict's caller has always had). */
+static void vl_pred_run(int m, uint32_t *cur, const uint32_t *upper, int n)
+{
+   int i = 0;
+#ifdef VL_LD
+   /* modes that read only the row above have no serial dependency */
+   if (m == 0 || (m >= 2 && m <= 4) || m == 8 || m == 9)
+      for (; i + 4 <= n; i += 4)
+      {
+         vl_v t = VL_LD(upper + i), p;
+         switch (m)
+         {
+            case 0:  p = VL_BLACK();                       break;
+            case 2:  p = t;                                break;
+            case 3:  p = VL_LD(upper + i + 1);             break;
+            case 4:  p = VL_LD(upper + i - 1);             break;
+            case 8:  p = VL_AVG2(VL_LD(upper + i - 1), t); break;
+            default: p = VL_AVG2(t, VL_LD(upper + i + 1)); break;
+         }
+         VL_ST(cur + i, VL_ADD8(VL_LD(cur + i), p));
+      }
+   else if (m >= 11 && m <= 13)
+   {
+      uint32_t l = cur[-1];
+      for (; i < n; i++)
+      {
+         uint32_t p;
+         if (m == 11)
+            p = VL_SELECT(upper[i - 1], upper[i], l);
+         else if (m == 12)
+            p = VL_CASF(l, upper[i], upper[i - 1]);
+         else
+            p = VL_CASH(px_avg2(l, upper[i]), upper[i - 1]);
+         cur[i] = l = px_add(cur[i], p);
+      }
+   }
+#endif
+   for (; i < n; i++)
+      cur[i] = px_add(cur[i],
+            px_predict(m, cur[i - 1], upper[i], upper[i - 1], upper[i + 1]));
+}
+
+/* Subtract-green inverse: add green into red and blue. */
+static void vl_add_green(uint32_t *p, int n)
+{
+   int i = 0;
+#if defined(RWEBP_VL_SSE2)
+   const __m128i lo = _mm_set1_epi32(0xFF);
+   for (; i + 4 <= n; i += 4)
+   {
+      __m128i c = VL_LD(p + i);
+      __m128i g = _mm_and_si128(_mm_srli_epi32(c, 8), lo);
+      VL_ST(p + i, _mm_add_epi8(c, _mm_or_si128(g, _mm_slli_epi32(g, 16))));
+   }
+#elif defined(RWEBP_VL_NEON)
+   for (; i + 4 <= n; i += 4)
+   {
+      uint32x4_t c = vld1q_u32(p + i);
+      uint32x4_t g = vandq_u32(vshrq_n_u32(c, 8), vdupq_n_u32(0xFF));
+      g = vorrq_u32(g, vshlq_n_u32(g, 16));
+      vst1q_u32(p + i, vreinterpretq_u32_u8(vaddq_u8(
+            vreinterpretq_u8_u32(c), vreinterpretq_u8_u32(g))));
+   }
+#endif
+   for (; i < n; i++)
+   {
+      uint32_t c = p[i];
+      uint32_t g = (c >> 8) & 0xFF;
+      uint32_t r = (((c >> 16) & 0xFF) + g) & 0xFF;
+      uint32_t b2 = ((c & 0xFF) + g) & 0xFF;
+      p[i] = (c & 0xFF00FF00u) | (r << 16) | b2;
+   }
+}
+
+/* Colour-transform inverse over n pixels sharing the tile word td.
+ * libwebp ColorCodeToMultipliers: green_to_red in the BLUE byte,
+ * green_to_blue in GREEN, red_to_blue in RED. */
+static void vl_color_run(uint32_t td, uint32_t *p, int n)
+{
+   int8_t g2r = (int8_t)(td & 0xFF);
+   int8_t g2b = (int8_t)((td >>  8) & 0xFF);
+   int8_t r2b = (int8_t)((td >> 16) & 0xFF);
+   int i = 0;
+#if defined(RWEBP_VL_SSE2)
+   /* libwebp's TransformColorInverse_SSE2: with green (resp. red) in the
+    * high byte of a 16-bit lane and the multiplier pre-scaled by 8, the
+    * signed high multiply yields exactly (m * c) >> 5. */
+   const __m128i m_rb = _mm_set1_epi32((int)
+         (((uint32_t)(uint16_t)(g2r * 8) << 16) | (uint16_t)(g2b * 8)));
+   const __m128i m_b2 = _mm_set1_epi32((int)
+         ((uint32_t)(uint16_t)(r2b * 8) << 16));
+   const __m128i m_ag = _mm_set1_epi32((int)0xFF00FF00u);
+   for (; i + 4 <= n; i += 4)
+   {
+      __m128i in = VL_LD(p + i);
+      __m128i a  = _mm_and_si128(in, m_ag);            /* a 0 g 0     */
+      __m128i g  = _mm_shufflehi_epi16(
+            _mm_shufflelo_epi16(a, _MM_SHUFFLE(2, 2, 0, 0)),
+            _MM_SHUFFLE(2, 2, 0, 0));                   /* g 0 g 0     */
+      __m128i e  = _mm_add_epi8(in, _mm_mulhi_epi16(g, m_rb)); /* r' b' */
+      __m128i f  = _mm_slli_epi16(e, 8);               /* r' 0 b' 0   */
+      __m128i h  = _mm_srli_epi32(_mm_mulhi_epi16(f, m_b2), 8);
+      __m128i j  = _mm_srli_epi16(_mm_add_epi8(h, f), 8);
+      VL_ST(p + i, _mm_or_si128(j, a));
+   }
+#elif defined(RWEBP_VL_NEON)
+   const int32x4_t  k_g2r = vdupq_n_s32(g2r);
+   const int32x4_t  k_g2b = vdupq_n_s32(g2b);
+   const int32x4_t  k_r2b = vdupq_n_s32(r2b);
+   const uint32x4_t k_ff  = vdupq_n_u32(0xFF);
+   for (; i + 4 <= n; i += 4)
+   {
+      uint32x4_t c = vld1q_u32(p + i);
+      int32x4_t  g = vshrq_n_s32(vshlq_n_s32(vreinterpretq_s32_u32(c), 16), 24);
+      int32x4_t  r = vreinterpretq_s32_u32(vandq_u32(vshrq_n_u32(c, 16), k_ff));
+      int32x4_t  b = vreinterpretq_s32_u32(vandq_u32(c, k_ff));
+      int32x4_t  rs;
+      r  = vaddq_s32(r, vshrq_n_s32(vmulq_s32(k_g2r, g), 5));
+      b  = vaddq_s32(b, vshrq_n_s32(vmulq_s32(k_g2b, g), 5));
+      rs = vshrq_n_s32(vshlq_n_s32(r, 24), 24);          /* (int8_t)r' */
+      b  = vaddq_s32(b, vshrq_n_s32(vmulq_s32(k_r2b, rs), 5));
+      vst1q_u32(p + i, vorrq_u32(vandq_u32(c, vdupq_n_u32(0xFF00FF00u)),
+            vorrq_u32(vshlq_n_u32(vandq_u32(vreinterpretq_u32_s32(r), k_ff), 16),
+                      vandq_u32(vreinterpretq_u32_s32(b), k_ff))));
+   }
+#endif
+   for (; i < n; i++)
+   {
+      uint32_t c2 = p[i];
+      /* Channel values are SIGNED in the color transform
+       * (libwebp ColorTransformDelta takes int8_t). */
+      int g  = (int)(int8_t)((c2 >> 8) & 0xFF);
+      int r  = (int)((c2 >> 16) & 0xFF);
+      int b2 = (int)(c2 & 0xFF);
+      r  = (r + ((g2r * g) >> 5)) & 0xFF;
+      b2 = b2 + ((g2b * g) >> 5);
+      b2 = (b2 + ((r2b * (int)(int8_t)r) >> 5)) & 0xFF;
+      p[i] = (c2 & 0xFF00FF00u) | ((uint32_t)r << 16) | (uint32_t)b2;
+   }
+}
+
 /* Distance mapping, per libwebp PlaneCodeToDistance: the decoded distance
  * prefix value ("plane code") 1..120 maps through kCodeToPlane to a 2D
  * (x,y) offset; values above 120 are linear distances (code - 120). */
@@ -859,8 +1134,7 @@ xfail:
  * the next transform (reverse order) as each completes. Returns 1 while
  * transform work remains, 0 when all transforms are done, -1 on error.
  * Row-range slicing preserves the original top-to-bottom order, which
- * the predictor transform relies on. The loop bodies are the original
- * inverse-transform passes verbatim.
+ * the predictor transform relies on.
  *
  * When swap_rb is set, output rows are converted to memory R,G,B,A
  * order as they become final: rows completed by the LAST transform
@@ -947,76 +1221,59 @@ static int vlbd_xform_rows(vlbd *s, int nrows)
             break;
          }
          case XF_SUBG:
-         {
-            int j, j0 = r0 * cw, j1 = r1 * cw;
-            for (j = j0; j < j1; j++)
-            {
-               uint32_t c = pix[j];
-               uint32_t g = (c >> 8) & 0xFF;
-               uint32_t r = (((c >> 16) & 0xFF) + g) & 0xFF;
-               uint32_t b2 = ((c & 0xFF) + g) & 0xFF;
-               pix[j] = (c & 0xFF00FF00u) | (r << 16) | b2;
-            }
+            vl_add_green(pix + (size_t)r0 * cw, (r1 - r0) * cw);
             break;
-         }
          case XF_PRED:
          {
-            int bw = x->dw;
-            uint32_t *td = x->data;
+            int bw = x->dw, bits = x->bits;
+            const uint32_t *td = x->data;
             int px2, py2;
             for (py2 = r0; py2 < r1; py2++)
             {
-               for (px2 = 0; px2 < cw; px2++)
+               uint32_t *cur = pix + (size_t)py2 * cw;
+               const uint32_t *trow = td + (size_t)(py2 >> bits) * bw;
+               if (py2 == 0)
                {
-                  uint32_t L  = (px2 > 0)            ? pix[py2*cw+px2-1]     : 0xFF000000u;
-                  uint32_t T  = (py2 > 0)             ? pix[(py2-1)*cw+px2]   : 0xFF000000u;
-                  uint32_t TL = (px2>0 && py2>0)      ? pix[(py2-1)*cw+px2-1] : 0xFF000000u;
-                  /* TR at the last column wraps to the current row's
-                   * first pixel (libwebp reads upper[x+1] in the flat
-                   * buffer, which is contiguous with the next row). */
-                  uint32_t TR = (py2 > 0)             ? pix[(py2-1)*cw+px2+1] : 0xFF000000u;
-                  int bx = px2 >> x->bits, by = py2 >> x->bits;
-                  int mode;
+                  /* top row: black, then left all the way */
+                  cur[0] = px_add(cur[0], 0xFF000000u);
+                  for (px2 = 1; px2 < cw; px2++)
+                     cur[px2] = px_add(cur[px2], cur[px2 - 1]);
+                  continue;
+               }
+               /* left column: top. The rest goes a tile at a time; the
+                * last column's TR wraps to cur[0], as libwebp reads
+                * upper[x+1] from the flat buffer. */
+               cur[0] = px_add(cur[0], cur[-cw]);
+               for (px2 = 1; px2 < cw; )
+               {
+                  int bx  = px2 >> bits;
+                  int end = (bx + 1) << bits;
+                  if (end > cw) end = cw;
                   if (bx >= bw) bx = bw - 1;
-                  mode = (td[by * bw + bx] >> 8) & 0xF;
-                  if (px2 == 0 && py2 == 0) mode = 0;
-                  else if (px2 == 0) mode = 2;
-                  else if (py2 == 0) mode = 1;
-                  pix[py2*cw+px2] = px_add(pix[py2*cw+px2], px_predict(mode, L, T, TL, TR));
+                  vl_pred_run((int)((trow[bx] >> 8) & 0xF),
+                        cur + px2, cur + px2 - cw, end - px2);
+                  px2 = end;
                }
             }
             break;
          }
          case XF_CCOL:
          {
-            int bw = x->dw;
-            uint32_t *td = x->data;
+            int bw = x->dw, bits = x->bits;
+            const uint32_t *td = x->data;
             int px2, py2;
             for (py2 = r0; py2 < r1; py2++)
             {
-               for (px2 = 0; px2 < cw; px2++)
+               uint32_t *cur = pix + (size_t)py2 * cw;
+               const uint32_t *trow = td + (size_t)(py2 >> bits) * bw;
+               for (px2 = 0; px2 < cw; )
                {
-                  int bx = px2 >> x->bits, by = py2 >> x->bits;
-                  uint32_t td2, c2;
-                  int8_t g2r, g2b, r2b;
-                  int r, g, b2;
+                  int bx  = px2 >> bits;
+                  int end = (bx + 1) << bits;
+                  if (end > cw) end = cw;
                   if (bx >= bw) bx = bw - 1;
-                  td2 = td[by * bw + bx];
-                  /* libwebp ColorCodeToMultipliers: green_to_red in the
-                   * BLUE byte, green_to_blue in GREEN, red_to_blue in RED. */
-                  g2r = (int8_t)(td2 & 0xFF);
-                  g2b = (int8_t)((td2 >>  8) & 0xFF);
-                  r2b = (int8_t)((td2 >> 16) & 0xFF);
-                  c2 = pix[py2 * cw + px2];
-                  /* Channel values are SIGNED in the color transform
-                   * (libwebp ColorTransformDelta takes int8_t). */
-                  g = (int)(int8_t)((c2 >> 8) & 0xFF);
-                  r = (int)((c2 >> 16) & 0xFF);
-                  b2 = (int)(c2 & 0xFF);
-                  r = (r + ((g2r * g) >> 5)) & 0xFF;
-                  b2 = b2 + ((g2b * g) >> 5);
-                  b2 = (b2 + ((r2b * (int)(int8_t)r) >> 5)) & 0xFF;
-                  pix[py2*cw+px2] = (c2 & 0xFF00FF00u) | ((uint32_t)r << 16) | (uint32_t)b2;
+                  vl_color_run(trow[bx], cur + px2, end - px2);
+                  px2 = end;
                }
             }
             break;
@@ -1137,7 +1394,12 @@ static void alph_unfilter_row(int filter, const uint8_t *prev,
       }
       case 2: /* vertical */
          if (!prev) { alph_unfilter_row(1, NULL, row, width); break; }
-         for (i = 0; i < width; i++)
+         i = 0;
+#if defined(RWEBP_VL_SSE2) || defined(RWEBP_VL_NEON)
+         for (; i + 16 <= width; i += 16)
+            VL_ST(row + i, VL_ADD8(VL_LD(prev + i), VL_LD(row + i)));
+#endif
+         for (; i < width; i++)
             row[i] = (uint8_t)(prev[i] + row[i]);
          break;
       case 3: /* gradient */
@@ -1192,7 +1454,30 @@ static uint8_t *alph_decode(const uint8_t *data, size_t len,
       vbr_init(&br, data + 1, len - 1);
       pix = vl_decode_body(&br, w, h, 0);
       if (!pix) { free(plane); return NULL; }
-      for (k = 0; k < n; k++)
+      k = 0;
+#if defined(RWEBP_VL_SSE2)
+      {
+         const __m128i lo = _mm_set1_epi32(0xFF);
+         for (; k + 16 <= n; k += 16)
+         {
+            __m128i g0 = _mm_srli_epi32(VL_LD(pix + k),      8);
+            __m128i g1 = _mm_srli_epi32(VL_LD(pix + k + 4),  8);
+            __m128i g2 = _mm_srli_epi32(VL_LD(pix + k + 8),  8);
+            __m128i g3 = _mm_srli_epi32(VL_LD(pix + k + 12), 8);
+            g0 = _mm_packs_epi32(_mm_and_si128(g0, lo), _mm_and_si128(g1, lo));
+            g2 = _mm_packs_epi32(_mm_and_si128(g2, lo), _mm_and_si128(g3, lo));
+            VL_ST(plane + k, _mm_packus_epi16(g0, g2));
+         }
+      }
+#elif defined(RWEBP_VL_NEON)
+      for (; k + 16 <= n; k += 16)
+      {
+         /* de-interleave bytes: lane 1 of each word is green */
+         uint8x16x4_t q = vld4q_u8((const uint8_t*)(pix + k));
+         vst1q_u8(plane + k, q.val[1]);
+      }
+#endif
+      for (; k < n; k++)
          plane[k] = (uint8_t)((pix[k] >> 8) & 0xFF); /* green */
       free(pix);
    }
@@ -1206,6 +1491,110 @@ static uint8_t *alph_decode(const uint8_t *data, size_t len,
 
 
 
+/* Set the top byte of each of n words from the alpha plane a. Order
+ * agnostic: alpha is byte 3 in both ARGB and memory R,G,B,A words. */
+static void alph_merge(uint32_t *pix, const uint8_t *a, size_t n)
+{
+   size_t k = 0;
+#if defined(RWEBP_VL_SSE2)
+   const __m128i z   = _mm_setzero_si128();
+   const __m128i rgb = _mm_set1_epi32(0x00FFFFFF);
+   for (; k + 16 <= n; k += 16)
+   {
+      __m128i v  = VL_LD(a + k);
+      __m128i lo = _mm_unpacklo_epi8(z, v);   /* alpha << 8, 16-bit lanes */
+      __m128i hi = _mm_unpackhi_epi8(z, v);
+      /* one more zero interleave lifts each alpha to bits 24-31 */
+      __m128i a0 = _mm_unpacklo_epi16(z, lo), a1 = _mm_unpackhi_epi16(z, lo);
+      __m128i a2 = _mm_unpacklo_epi16(z, hi), a3 = _mm_unpackhi_epi16(z, hi);
+      VL_ST(pix + k,      _mm_or_si128(_mm_and_si128(VL_LD(pix + k),      rgb), a0));
+      VL_ST(pix + k + 4,  _mm_or_si128(_mm_and_si128(VL_LD(pix + k + 4),  rgb), a1));
+      VL_ST(pix + k + 8,  _mm_or_si128(_mm_and_si128(VL_LD(pix + k + 8),  rgb), a2));
+      VL_ST(pix + k + 12, _mm_or_si128(_mm_and_si128(VL_LD(pix + k + 12), rgb), a3));
+   }
+#elif defined(RWEBP_VL_NEON)
+   for (; k + 16 <= n; k += 16)
+   {
+      uint8x16x4_t q = vld4q_u8((const uint8_t*)(pix + k));
+      q.val[3] = vld1q_u8(a + k);
+      vst4q_u8((uint8_t*)(pix + k), q);
+   }
+#endif
+   for (; k < n; k++)
+      pix[k] = (pix[k] & 0x00FFFFFFu) | ((uint32_t)a[k] << 24);
+}
+
+/* Alpha planes of at least this many pixels are decoded on a thread of
+ * their own while the lossy planes decode on the caller's: below it,
+ * starting the thread costs about what the plane takes to decode. */
+#define RWEBP_ALPH_THREAD_MIN (256 * 256)
+
+typedef struct
+{
+   const uint8_t *data;
+   size_t len;
+   unsigned w, h;
+   uint8_t *plane;
+} rwebp_alph_job;
+
+static void rwebp_alph_run(void *userdata)
+{
+   rwebp_alph_job *job = (rwebp_alph_job*)userdata;
+   job->plane = alph_decode(job->data, job->len, job->w, job->h);
+}
+
+/* Frame size from a VP8 key-frame header: 3-byte frame tag, start code
+ * 9D 01 2A, then 14-bit width and height with 2-bit scale fields. */
+static int rw_vp8_size(const uint8_t *d, size_t len, unsigned *w, unsigned *h)
+{
+   if (len < 10 || (d[0] & 1) || d[3] != 0x9D || d[4] != 0x01 || d[5] != 0x2A)
+      return 0;
+   *w = ((unsigned)d[6] | ((unsigned)d[7] << 8)) & 0x3FFF;
+   *h = ((unsigned)d[8] | ((unsigned)d[9] << 8)) & 0x3FFF;
+   return *w && *h;
+}
+
+/* Lossy image plus optional ALPH chunk. The two are independent
+ * bitstreams whose only meeting point is the final merge, so a large
+ * image decodes its alpha plane concurrently with the VP8 planes. An
+ * alpha plane that fails to decode leaves the image opaque. */
+static uint32_t *rwebp_decode_lossy(const uint8_t *vp8, size_t vp8s,
+      const uint8_t *alph, size_t alphs, unsigned *w, unsigned *h,
+      int swap_rb)
+{
+   rwebp_alph_job job;
+   uint32_t *pix;
+#ifdef HAVE_THREADS
+   sthread_t *thread = NULL;
+#endif
+
+   if (!alph || alphs == 0
+         || !rw_vp8_size(vp8, vp8s, &job.w, &job.h))
+      return rvp8_decode(vp8, vp8s, w, h, swap_rb);
+   job.data  = alph;
+   job.len   = alphs;
+   job.plane = NULL;
+#ifdef HAVE_THREADS
+   if ((size_t)job.w * job.h >= RWEBP_ALPH_THREAD_MIN
+         && cpu_features_get_core_amount() > 1)
+      thread = sthread_create(rwebp_alph_run, &job);
+#endif
+   pix = rvp8_decode(vp8, vp8s, w, h, swap_rb);
+#ifdef HAVE_THREADS
+   if (thread)
+      sthread_join(thread);
+   else if (pix)
+      rwebp_alph_run(&job);
+#else
+   if (pix)
+      rwebp_alph_run(&job);
+#endif
+   if (pix && job.plane && *w == job.w && *h == job.h)
+      alph_merge(pix, job.plane, (size_t)job.w * job.h);
+   free(job.plane);
+   return pix;
+}
+
 /* ===== Top-level ===== */
 
 static uint32_t *rwebp_do(const uint8_t *buf, size_t len,
@@ -1222,20 +1611,8 @@ static uint32_t *rwebp_do(const uint8_t *buf, size_t len,
    if (c.vp8l && c.vp8ls > 0)
       pix = vl_decode_full(c.vp8l, c.vp8ls, w, h, rgba ? 1 : 0);
    if (!pix && c.vp8 && c.vp8s > 0)
-   {
-      pix = rvp8_decode(c.vp8, c.vp8s, w, h, rgba ? 1 : 0);
-      if (pix && c.alph && c.alphs > 0)
-      {
-         uint8_t *ap = alph_decode(c.alph, c.alphs, *w, *h);
-         if (ap)
-         {
-            size_t k, n = (size_t)*w * *h;
-            for (k = 0; k < n; k++)
-               pix[k] = (pix[k] & 0x00FFFFFFu) | ((uint32_t)ap[k] << 24);
-            free(ap);
-         }
-      }
-   }
+      pix = rwebp_decode_lossy(c.vp8, c.vp8s, c.alph, c.alphs, w, h,
+            rgba ? 1 : 0);
    return pix;
 }
 
@@ -1273,18 +1650,8 @@ static uint32_t *rwebp_anim_frame_pixels(const uint8_t *d, size_t sz,
        * caller can skip per-pixel blending for such frames. */
       if (out_opaque && !(fa && fas > 0))
          *out_opaque = 1;
-      pix = rvp8_decode(fv, fvs, &w, &h, swap_rb); /* canvas order */
-      if (pix && fa && fas > 0)
-      {
-         uint8_t *ap = alph_decode(fa, fas, w, h);
-         if (ap)
-         {
-            size_t k, n = (size_t)w * h;
-            for (k = 0; k < n; k++)
-               pix[k] = (pix[k] & 0x00FFFFFFu) | ((uint32_t)ap[k] << 24);
-            free(ap);
-         }
-      }
+      pix = rwebp_decode_lossy(fv, fvs, fa, fas, &w, &h,
+            swap_rb); /* canvas order */
    }
    if (!pix) return NULL;
    /* Frames of both kinds decode straight into the canvas's current
@@ -170,6 +170,56 @@ const r7z_entry_t *r7z_archive_entry(const r7z_archive_t *a,
 int r7z_archive_extract_slice(r7z_archive_t *a, uint32_t index,
       uint8_t **out, size_t *out_len);
 
+/**
+ * r7z_archive_set_threads:
+ * @a          : opened archive
+ * @threads    : 0 for one per core (the default), 1 for none
+ *
+ * Caps the threads this archive decodes with. Two things use them,
+ * both only in builds with HAVE_THREADS:
+ *
+ *   - an LZMA2 folder whose stream resets its dictionary part way
+ *     through, as multithreaded 7-Zip writes them, is decoded one
+ *     independent run per thread. The sliced entry point then does no
+ *     decoding of its own and only reports whether the workers are
+ *     done, so its calls stay short however large the folder;
+ *   - a caller that has gone from one folder to the next is taken to
+ *     be walking the archive, and the folder after that is decoded in
+ *     the background.
+ *
+ * Output is identical for every setting. Call it before the first
+ * extract.
+ */
+void r7z_archive_set_threads(r7z_archive_t *a, unsigned threads);
+
+/**
+ * r7z_archive_cache_init:
+ * @budget     : bytes of decoded folders to keep; 0 for 64 MiB
+ *
+ * Turns on a process-wide cache of decoded folders, shared by every
+ * archive. A folder an archive is done with -- because another was
+ * requested, or because the archive was closed -- is kept there, keyed
+ * by the archive's contents and the folder, until the budget pushes it
+ * out. Extracting another member of that folder later, through any
+ * handle on the same archive, is then a copy instead of a decode from
+ * the start of a solid block.
+ *
+ * Without it each archive keeps only its own last folder, and nothing
+ * outlives r7z_archive_close().
+ *
+ * Call it before any thread can reach this code, and not concurrently
+ * with anything here. Calling it again only changes the budget, which
+ * takes effect as folders are next added.
+ */
+void r7z_archive_cache_init(size_t budget);
+
+/**
+ * r7z_archive_cache_deinit:
+ *
+ * Empties the shared cache and turns it off. No archive may be open.
+ */
+void r7z_archive_cache_deinit(void);
+
 /**
  * r7z_archive_extract:
  * @a          : opened archive
@@ -180,9 +230,10 @@ int r7z_archive_extract_slice(r7z_archive_t *a, uint32_t index,
  * Decodes the folder containing @index and returns that entry's bytes.
  * The caller owns @out and must free() it.
  *
- * Decoding a folder is all-or-nothing, so extracting several entries
- * from one solid folder decodes it once per call. Callers that want
- * the whole folder should extract in index order and cache.
+ * Decoding a folder is all-or-nothing. The archive keeps the last
+ * folder it decoded, and the cache r7z_archive_cache_init() enables
+ * keeps more, so callers wanting several members of a solid folder
+ * should extract them together, in index order where they can.
  *
  * If the archive records a CRC for the entry, it is checked, and a
  * mismatch is an error.
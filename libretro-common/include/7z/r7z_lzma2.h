@@ -67,12 +67,12 @@
  * since resetting decoder state without also resetting the dictionary
  * buys nothing an encoder wants.
  *
- * Such a stream also cannot easily be built by hand. Chunks cannot be
- * encoded independently and concatenated: an LZMA encoder assumes it
- * starts at stream position zero, so a chunk produced that way is
- * rejected even when the control byte says 0xE0. Producing a genuine
- * 0xA0-0xDF stream needs an encoder that can be driven a chunk at a
- * time, which is out of scope here.
+ * Such a stream also cannot easily be built by hand. Streams encoded
+ * independently and concatenated are valid -- each begins with a full
+ * 0xE0 (or 0x01) reset, which is what multithreaded 7-Zip writes -- but
+ * that only ever adds more full resets. Producing a genuine 0xA0-0xDF
+ * stream needs an encoder that can be driven a chunk at a time, which
+ * is out of scope here.
  *
  * What that leaves untested is narrow, and worth stating precisely
  * rather than as a blanket warning. The two branches are a pair of
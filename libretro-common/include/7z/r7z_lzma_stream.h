@@ -178,7 +178,9 @@ void rlzma_stream_reset(rlzma_stream_t *s);
 /**
  * rlzma_stream_reset_parts:
  * @s          : initialized decoder state
- * @init_dic   : non-zero to reset the dictionary position
+ * @init_dic   : non-zero to forget the dictionary history, so that no
+ *               later match may reach back past this point. The output
+ *               position is left where it is.
  * @init_state : non-zero to reset the range coder, probabilities and
  *               match history
  *
@@ -152,6 +152,13 @@ struct file_archive_file_backend
    int      (*stream_decompress_data_to_file_iterate)(
       void *context,
       file_archive_file_handle_t *handle);
+   /* Optional. Decodes one member start to finish and writes it to
+    * path, on a stream of its own, so that it may run on another
+    * thread while the walk goes on. NULL where members cannot be
+    * decoded independently of each other (7z solid blocks). */
+   bool     (*stream_decompress_data_to_file_detached)(
+      void *context, const uint8_t *cdata, unsigned cmode,
+      uint32_t csize, uint32_t size, const char *path);
 
    uint32_t (*stream_crc_calculate)(uint32_t, const uint8_t *, size_t);
    int64_t (*compressed_file_read)(const char *path, const char *needle, void **buf,
@@ -232,6 +239,30 @@ bool file_archive_perform_mode(const char *name, const char *valid_exts,
       const uint8_t *cdata, unsigned cmode, uint32_t csize, uint32_t size,
       uint32_t crc32, struct archive_extract_userdata *userdata);
 
+/**
+ * file_archive_can_perform_detached:
+ *
+ * Returns: true if the archive open in @state can have its members
+ * extracted with file_archive_perform_mode_detached().
+ */
+bool file_archive_can_perform_detached(const file_archive_transfer_t *state);
+
+/**
+ * file_archive_perform_mode_detached:
+ *
+ * Extracts one member, as handed to a file_archive_file_cb, straight
+ * to @path. Unlike file_archive_perform_mode_start() this leaves the
+ * transfer's pending slot alone and only reads the transfer, so it is
+ * safe to call from worker threads, several members at once, while
+ * the walk carries on. The transfer must not be stopped or advanced
+ * past ARCHIVE_TRANSFER_ITERATE until every call has returned.
+ *
+ * Returns: true if the member was decoded and written.
+ */
+bool file_archive_perform_mode_detached(file_archive_transfer_t *state,
+      const char *path, const uint8_t *cdata, unsigned cmode,
+      uint32_t csize, uint32_t size);
+
 int file_archive_compressed_read(
       const char* path, void **buf,
       const char* optional_filename, int64_t *length);
@@ -69,11 +69,12 @@
  *          break;
  *    }
  *
- * One handle decodes one hunk at a time; that bound is what keeps a
- * single rchd_read_step() call cheap. Decoding several hunks in
- * parallel means one handle per thread, which is inexpensive because
- * the map is the only large allocation and parent images are shared by
- * reference rather than copied.
+ * The depth is also how many decoded hunks a handle keeps, least
+ * recently used first out. With rchd_set_threads() above one, a hunk
+ * whose bytes have all arrived is decompressed on a worker while the
+ * caller fetches the next, so a sequential read runs at the speed of
+ * the storage rather than of one core's codec. Without threads the
+ * caller's own rchd_read_step() decodes, one hunk at a time.
  *
  * Codec support is drawn from the primitives already present in
  * libretro-common: <encodings/deflate.h> for the 'zlib' family, <7z/r7z_lzma.h>
@@ -303,16 +304,16 @@ int rchd_open_step(rchd_t *chd, rchd_request_t *req);
  * @data       : bytes read for the outstanding request
  * @len        : how many bytes @data holds
  *
- * Supplies some or all of the single outstanding request, which is the
- * only shape the open sequence produces. Supplying fewer bytes than
- * were asked for is legal; the remainder is requested again. @data is
- * consumed immediately and need not outlive the call.
+ * Supplies some or all of the request the last rchd_open_step() or
+ * rchd_read_step() returned. Supplying fewer bytes than were asked for
+ * is legal; the rest can follow in another call, or the remainder is
+ * requested again. @data is consumed immediately and need not outlive
+ * the call.
  *
  * Reads driven with several fetches in flight use rchd_feed_at()
  * instead, since order of arrival no longer identifies the request.
  *
- * Returns: RCHD_OK, or RCHD_ERROR_STATE if no request is outstanding,
- * or if more than one is.
+ * Returns: RCHD_OK, or RCHD_ERROR_STATE if no request is outstanding.
  */
 int rchd_feed(rchd_t *chd, const void *data, size_t len);
 
@@ -502,22 +503,47 @@ int rchd_read_hunk_begin(rchd_t *chd, uint32_t hunk, void *dst);
  * @depth      : hunks that may be in flight at once, at least 1
  *
  * Sizes the staging ring compressed hunks are held in while they are
- * being fetched. Depth one is the default and behaves exactly like the
- * ping-pong pattern. Each further slot costs another hunk_bytes of
- * memory and lets one more fetch overlap the decode of an earlier hunk,
- * so this is the dial between memory and how much of the storage
- * latency gets hidden.
+ * being fetched and decoded. Depth one is the default and behaves
+ * exactly like the ping-pong pattern. Each further slot costs two more
+ * hunk_bytes of memory -- the blob and the hunk it decodes to -- and
+ * lets one more fetch overlap the decode of an earlier hunk, so this is
+ * the dial between memory and how much of the storage latency gets
+ * hidden. The same slots hold decoded hunks for reuse afterwards.
  *
- * The staging ring is not built yet, so one request is outstanding at a
- * time and depth one is the only depth this accepts. Anything above it
- * is refused rather than accepted and ignored, because a caller sizing
- * a fetch queue from the return value needs to know it did not take.
+ * The ring looks ahead of the armed read by @depth hunks, and past the
+ * read's end when it starts where the previous read finished, which is
+ * what makes a caller reading one hunk at a time in order benefit.
  *
- * Returns: RCHD_OK for a depth of one, RCHD_ERROR_PARAM if @depth is
- * zero, RCHD_ERROR_UNSUPPORTED above one.
+ * Changing the depth drops whatever the ring held, fetches in flight
+ * included; the read asks for those again.
+ *
+ * Returns: RCHD_OK, RCHD_ERROR_PARAM if @depth is zero, or
+ * RCHD_ERROR_UNSUPPORTED above 64, rather than a depth silently
+ * clamped, because a caller sizing a fetch queue from the return value
+ * needs to know it did not take.
  */
 int rchd_set_pipeline_depth(rchd_t *chd, uint32_t depth);
 
+/**
+ * rchd_set_threads:
+ * @chd        : decoder
+ * @threads    : decode threads; 0 means one per core, 1 means none
+ *
+ * Decodes hunks of the staging ring on a pool of worker threads, at
+ * most one per slot. Only a depth above one gives the pool anything to
+ * do. The pool starts on the first rchd_read_pending() after this and
+ * lives until the handle is freed; each worker costs a copy of the
+ * per-codec state the handle keeps between hunks.
+ *
+ * Codecs registered with rchd_register_codec() are called from the
+ * workers, so they must be safe to call from another thread. Builds
+ * without HAVE_THREADS decode on the caller's thread whatever this is
+ * set to.
+ *
+ * Returns: RCHD_OK, or RCHD_ERROR_PARAM if @chd is NULL.
+ */
+int rchd_set_threads(rchd_t *chd, unsigned threads);
+
 /**
  * rchd_read_pending:
  * @chd        : decoder with a read armed
@@ -529,7 +555,11 @@ int rchd_set_pipeline_depth(rchd_t *chd, uint32_t depth);
  * caller may issue all of them at once.
  *
  * This does not advance the read and does not decode anything; a range
- * reported here is not reported again until the read is re-armed.
+ * reported here is not reported again until the read is re-armed. The
+ * ranges can run past the end of the armed read: see
+ * rchd_set_pipeline_depth(). A supply for a range the ring has since
+ * given up, because the read moved elsewhere, is refused with
+ * RCHD_ERROR_STATE and can be dropped.
  *
  * Returns: how many requests were written to @out. Zero means the read
  * already holds everything it needs and only rchd_read_step() remains.
@@ -588,6 +618,56 @@ int rchd_feed_at(rchd_t *chd, uint64_t offset, int source,
 int rchd_feed_borrow(rchd_t *chd, uint64_t offset, int source,
       const uint8_t *data, size_t len);
 
+/* -------- shared hunk cache -------- */
+
+/**
+ * rchd_cache_stats_t:
+ *
+ * Counters for the process-wide hunk cache. A lookup is made only for
+ * a hunk that would otherwise be fetched and decoded, so @hits is the
+ * decodes saved and @misses the decodes done.
+ */
+typedef struct rchd_cache_stats
+{
+   uint64_t hits;
+   uint64_t misses;
+   uint64_t evictions;
+   size_t   bytes;     /* held now, bookkeeping included */
+   size_t   budget;
+   uint32_t entries;
+} rchd_cache_stats_t;
+
+/**
+ * rchd_cache_init:
+ * @budget     : bytes the cache may hold; 0 picks a default of 32 MiB
+ *
+ * Turns on a cache of decoded hunks shared by every rchd_t in the
+ * process, so several handles on one image, or several children of
+ * one parent, decode each hunk once between them. Hunks are keyed by
+ * the image's combined SHA-1 and hunk size, which makes two copies of
+ * an image at different paths the same image; images too old to carry
+ * a digest are not cached.
+ *
+ * Call once, before any thread that reads images exists: this creates
+ * the cache's lock, and creating it on first use would let two threads
+ * each make one. A second call is ignored.
+ */
+void rchd_cache_init(size_t budget);
+
+/**
+ * rchd_cache_deinit:
+ *
+ * Frees every cached hunk and turns the cache off. Call only once
+ * nothing is reading.
+ */
+void rchd_cache_deinit(void);
+
+/**
+ * rchd_cache_stats:
+ * @out        : receives the counters
+ */
+void rchd_cache_stats(rchd_cache_stats_t *out);
+
 /* -------- prefetch -------- */
 
 /**
@@ -63,6 +63,13 @@ int rh265_video_decode(rh265_video *v, const uint8_t *data, size_t len);
  * inter prediction lands.) */
 int rh265_video_drain(rh265_video *v);
 
+/* Number of threads decoding the CTB rows of wavefront (WPP) slices:
+ * 0 (the default) uses one per CPU core, 1 keeps every slice on the
+ * calling thread.  Non-WPP streams, and builds without HAVE_THREADS,
+ * always decode serially.  Output is identical for every setting.
+ * Call between decodes; the pool is rebuilt on the next WPP slice. */
+void rh265_video_set_threads(rh265_video *v, unsigned threads);
+
 /* Borrow a decoded plane (0=Y, 1=U, 2=V). Valid until the next decode call. */
 /* Active luma bit depth of the stream (8 or 10).  At 10 bits the
  * plane pointers reference uint16_t samples: cast the returned byte
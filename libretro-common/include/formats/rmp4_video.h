@@ -127,6 +127,14 @@ const uint32_t *rmp4_video_stream_next(rmp4_video_stream_t *stream,
  * the default order. */
 void rmp4_video_stream_set_argb(rmp4_video_stream_t *stream, int argb);
 
+/* Decoder thread count for codecs that can spread a picture across
+ * threads (today H.265 wavefront slices): 0 (the default) picks one
+ * per CPU core, 1 decodes on the calling thread only.  Output is
+ * identical either way.  Applies to the current decoder and to any
+ * decoder the stream re-creates. */
+void rmp4_video_stream_set_threads(rmp4_video_stream_t *stream,
+      unsigned threads);
+
 /* Advance past the next displayed frame without colour-converting it:
  * the picture stays inside the decoder and no work is spent on its
  * pixels.  Returns 1 when a frame was consumed (its display duration
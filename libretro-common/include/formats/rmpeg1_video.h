@@ -82,6 +82,13 @@ uint32_t rmpeg1_video_skipped(const rmpeg1_video_t *v);
 /* Count of slices abandoned on a bitstream inconsistency. */
 uint32_t rmpeg1_video_errors(const rmpeg1_video_t *v);
 
+/* Convert a decoded frame to 32-bit pixels, frame->width by frame->height,
+ * limited-range BT.601 as 11172-2 specifies. Words are 0xFFRRGGBB when argb
+ * is set, memory order R,G,B,A otherwise -- the same choice
+ * rmp4_video_stream_set_argb offers. dst_stride is in pixels. */
+void rmpeg1_video_frame_blit(const rmpeg1_video_frame_t *frame,
+      uint32_t *dst, unsigned dst_stride, bool argb);
+
 RETRO_END_DECLS
 
 #endif
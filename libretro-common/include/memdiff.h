@@ -0,0 +1,50 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------
+ * The following license statement only applies to this file (memdiff.h).
+ * ---------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _LIBRETRO_MEMDIFF_H
+#define _LIBRETRO_MEMDIFF_H
+
+#include <stddef.h>
+
+#include <retro_common_api.h>
+
+RETRO_BEGIN_DECLS
+
+/**
+ * memdiff_first:
+ *
+ * Offset of the first byte at which @a and @b differ, or @len if the
+ * first @len bytes of each are the same.  memcmp answers only whether
+ * two buffers differ; this says where, which is what a caller looking
+ * for the changed parts of a large, mostly unchanged buffer needs: save
+ * RAM between autosaves, a savestate against the one before it.
+ *
+ * Reads exactly @len bytes of each, at any alignment.  The scan is
+ * vectorised where the platform allows - SSE2 on x86, widened to AVX2
+ * at run time on CPUs that have it, NEON on AArch64 - and a word at a
+ * time elsewhere.
+ */
+size_t memdiff_first(const void *a, const void *b, size_t len);
+
+RETRO_END_DECLS
+
+#endif
@@ -61,6 +61,12 @@ typedef struct intfstream_info
       void *handle;
       int32_t track;
    } chd;
+   struct
+   {
+      /* enum rzip_codec, and its level; used when writing */
+      unsigned codec;
+      int level;
+   } rzip;
    enum intfstream_type type;
 } intfstream_info_t;
 
@@ -169,6 +175,12 @@ intfstream_t *intfstream_open_chd_track(const char *path,
 intfstream_t *intfstream_open_rzip_file(const char *path,
       unsigned mode);
 
+/* As intfstream_open_rzip_file(), but a file opened for
+ * writing is compressed with 'codec' (an enum rzip_codec)
+ * at 'level' (<= 0 selects the codec's default) */
+intfstream_t *intfstream_open_rzip_file_codec(const char *path,
+      unsigned mode, unsigned codec, int level);
+
 RETRO_END_DECLS
 
 #endif
@@ -33,7 +33,7 @@
 RETRO_BEGIN_DECLS
 
 /* Rudimentary interface for streaming data to/from a
- * zlib-compressed chunk-based RZIP archive file.
+ * zlib- or zstd-compressed chunk-based RZIP archive file.
  * 
  * This is somewhat less efficient than using regular
  * gzip code, but this is by design - the intention here
@@ -55,6 +55,8 @@ RETRO_BEGIN_DECLS
  * 
  * <file id header>:                8 bytes
  *                                  - [#][R][Z][I][P][v][file format version][#]
+ *                                  - version 1: chunks are zlib data
+ *                                  - version 2: chunks are zstd frames
  * <uncompressed chunk size>:       4 bytes, little endian order
  *                                  - nominal (maximum) size of each uncompressed
  *                                    chunk, in bytes
@@ -62,13 +64,27 @@ RETRO_BEGIN_DECLS
  * <size of next compressed chunk>: 4 bytes, little endian order
  *                                  - size on-disk of next compressed data
  *                                    chunk, in bytes
- * <next compressed chunk>:         n bytes of zlib compressed data
+ * <next compressed chunk>:         n bytes of compressed data, one
+ *                                  independent zlib stream or zstd
+ *                                  frame per chunk
  * ...
  * <size of next compressed chunk> : repeated until end of file
  * <next compressed chunk>         :
  * 
+ * Readers accept either version. A version 2 file
+ * opened by a build without zstd fails to open,
+ * rather than being mistaken for uncompressed data.
+ * 
  */
 
+/* Chunk codec of a written RZIP file */
+enum rzip_codec
+{
+   RZIP_CODEC_DEFLATE = 0,
+   /* Falls back to deflate when zstd is not built in */
+   RZIP_CODEC_ZSTD
+};
+
 /* Prevent direct access to rzipstream_t members */
 typedef struct rzipstream rzipstream_t;
 
@@ -84,6 +100,13 @@ typedef struct rzipstream rzipstream_t;
  * is invalid or an IO error occurs */
 rzipstream_t* rzipstream_open(const char *path, unsigned mode);
 
+/* As rzipstream_open(), but when writing, compresses
+ * with 'codec' at 'level' (<= 0 selects the codec's
+ * default). Both are ignored when reading: the file
+ * header names its codec */
+rzipstream_t* rzipstream_open_codec(const char *path, unsigned mode,
+      enum rzip_codec codec, int level);
+
 /* File Read */
 
 /* Reads (a maximum of) 'len' bytes from an RZIP file.
@@ -173,6 +196,12 @@ int rzipstream_printf(rzipstream_t *stream, const char* format, ...);
  * Returns false in the event of an error */
 bool rzipstream_write_file(const char *path, const void *data, int64_t len);
 
+/* As rzipstream_write_file(), compressing with
+ * 'codec' at 'level' (<= 0 selects the codec's
+ * default) */
+bool rzipstream_write_file_codec(const char *path, const void *data,
+      int64_t len, enum rzip_codec codec, int level);
+
 /* File Control */
 
 /* Sets file position to the beginning of the
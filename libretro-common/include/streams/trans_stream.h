@@ -122,6 +122,18 @@ const struct trans_stream_backend* trans_stream_get_deflate_inflate_backend(void
 extern const struct trans_stream_backend deflate_deflate_backend;
 extern const struct trans_stream_backend deflate_inflate_backend;
 
+#if defined(HAVE_RZSTD) || defined(HAVE_ZSTD)
+/* Zstandard, one whole frame per flushed transcoding - the built-in
+ * codec when HAVE_RZSTD, else the reference library.  The compressor
+ * takes a "level" property; the output buffer should allow for
+ * rzstd_compress_bound()/ZSTD_compressBound() of the input. */
+const struct trans_stream_backend* trans_stream_get_zstd_compress_backend(void);
+const struct trans_stream_backend* trans_stream_get_zstd_decompress_backend(void);
+
+extern const struct trans_stream_backend zstd_compress_backend;
+extern const struct trans_stream_backend zstd_decompress_backend;
+#endif
+
 RETRO_END_DECLS
 
 #endif
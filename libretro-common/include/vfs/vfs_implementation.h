@@ -80,6 +80,13 @@ int retro_vfs_stat_impl(const char *path, int32_t *size);
 
 int retro_vfs_stat_64_impl(const char *path, int64_t *size);
 
+/* As retro_vfs_stat_64_impl(), also reporting the modification time
+ * in seconds since the epoch.  Not part of the libretro VFS interface,
+ * which has no way to ask; *mtime is left untouched where the platform
+ * or the path's scheme (SMB, SAF) does not provide one. */
+int retro_vfs_stat_mtime_impl(const char *path, int64_t *size,
+      int64_t *mtime);
+
 int retro_vfs_mkdir_impl(const char *dir);
 
 libretro_vfs_implementation_dir *retro_vfs_opendir_impl(const char *dir, bool include_hidden);
@@ -0,0 +1,237 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------
+ * The following license statement only applies to this file (memdiff.c).
+ * ---------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdint.h>
+
+#include <retro_inline.h>
+#include <compat/intrinsics.h>
+#include <memdiff.h>
+
+/* Scanner selection.
+ *
+ * x86/x86_64: SSE2, the x86_64 baseline, gated on 32-bit the usual
+ * way.  Where the compiler can emit an AVX2 function without raising
+ * the ISA of the whole file, an AVX2 scanner is chosen at run time on
+ * CPUs that report it; cpu_features_get() probes once and caches.
+ *
+ * AArch64: NEON, which is baseline there.  There is no movemask; a
+ * narrowing shift packs the 16 byte-compare lanes four bits apiece
+ * into one 64-bit word instead.
+ *
+ * Everything else: size_t words, aligned first where the two buffers
+ * allow it, since the ARMv7 and MIPS targets fault or trap-and-emulate
+ * on unaligned word loads. */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MEMDIFF_HAVE_SSE2 1
+#include <emmintrin.h>
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__i386__) || defined(__x86_64__))
+#define MEMDIFF_HAVE_AVX2 1
+#include <immintrin.h>
+#include <features/features_cpu.h>
+#endif
+#elif defined(__aarch64__) && (defined(__GNUC__) || defined(__clang__))
+#define MEMDIFF_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+/* The bytes the vector loop leaves, and the whole of a buffer with no
+ * vector path. */
+static size_t memdiff_first_scalar(const uint8_t *a, const uint8_t *b,
+      size_t len)
+{
+   size_t i = 0;
+
+   /* Words only where both can be aligned together */
+   if (((uintptr_t)a & (sizeof(size_t) - 1))
+         == ((uintptr_t)b & (sizeof(size_t) - 1)))
+   {
+      while (i < len && ((uintptr_t)(a + i) & (sizeof(size_t) - 1)))
+      {
+         if (a[i] != b[i])
+            return i;
+         i++;
+      }
+      while (     len - i >= sizeof(size_t)
+            && *(const size_t*)(const void*)(a + i)
+            == *(const size_t*)(const void*)(b + i))
+         i += sizeof(size_t);
+   }
+
+   while (i < len && a[i] == b[i])
+      i++;
+   return i;
+}
+
+#if defined(MEMDIFF_HAVE_AVX2)
+#define MEMDIFF_CMP256(p, q, at) _mm256_cmpeq_epi8( \
+      _mm256_loadu_si256((const __m256i*)(const void*)((p) + (at))), \
+      _mm256_loadu_si256((const __m256i*)(const void*)((q) + (at))))
+
+/* Four vectors per iteration, so the compare-and-branch is paid once
+ * per 128 bytes; in unchanged memory that branch is all there is. */
+__attribute__((target("avx2")))
+static size_t memdiff_first_avx2(const uint8_t *a, const uint8_t *b,
+      size_t len)
+{
+   size_t i = 0;
+
+   for (; len - i >= 128; i += 128)
+   {
+      __m256i c0 = MEMDIFF_CMP256(a, b, i);
+      __m256i c1 = MEMDIFF_CMP256(a, b, i + 32);
+      __m256i c2 = MEMDIFF_CMP256(a, b, i + 64);
+      __m256i c3 = MEMDIFF_CMP256(a, b, i + 96);
+
+      if ((uint32_t)_mm256_movemask_epi8(_mm256_and_si256(
+               _mm256_and_si256(c0, c1), _mm256_and_si256(c2, c3)))
+            != 0xffffffffu)
+      {
+         uint32_t m;
+         if ((m = (uint32_t)_mm256_movemask_epi8(c0)) != 0xffffffffu)
+            return i + compat_ctz(~m);
+         if ((m = (uint32_t)_mm256_movemask_epi8(c1)) != 0xffffffffu)
+            return i + 32 + compat_ctz(~m);
+         if ((m = (uint32_t)_mm256_movemask_epi8(c2)) != 0xffffffffu)
+            return i + 64 + compat_ctz(~m);
+         m = (uint32_t)_mm256_movemask_epi8(c3);
+         return i + 96 + compat_ctz(~m);
+      }
+   }
+
+   for (; len - i >= 32; i += 32)
+   {
+      uint32_t mask = (uint32_t)_mm256_movemask_epi8(
+            MEMDIFF_CMP256(a, b, i));
+      if (mask != 0xffffffffu)
+         return i + compat_ctz(~mask);
+   }
+
+   return i + memdiff_first_scalar(a + i, b + i, len - i);
+}
+#endif
+
+#if defined(MEMDIFF_HAVE_SSE2)
+#define MEMDIFF_CMP128(p, q, at) _mm_cmpeq_epi8( \
+      _mm_loadu_si128((const __m128i*)(const void*)((p) + (at))), \
+      _mm_loadu_si128((const __m128i*)(const void*)((q) + (at))))
+
+static size_t memdiff_first_sse2(const uint8_t *a, const uint8_t *b,
+      size_t len)
+{
+   size_t i = 0;
+
+   for (; len - i >= 64; i += 64)
+   {
+      __m128i c0 = MEMDIFF_CMP128(a, b, i);
+      __m128i c1 = MEMDIFF_CMP128(a, b, i + 16);
+      __m128i c2 = MEMDIFF_CMP128(a, b, i + 32);
+      __m128i c3 = MEMDIFF_CMP128(a, b, i + 48);
+
+      if (_mm_movemask_epi8(_mm_and_si128(
+               _mm_and_si128(c0, c1), _mm_and_si128(c2, c3))) != 0xffff)
+      {
+         unsigned m;
+         if ((m = (unsigned)_mm_movemask_epi8(c0)) != 0xffff)
+            return i + compat_ctz(~m);
+         if ((m = (unsigned)_mm_movemask_epi8(c1)) != 0xffff)
+            return i + 16 + compat_ctz(~m);
+         if ((m = (unsigned)_mm_movemask_epi8(c2)) != 0xffff)
+            return i + 32 + compat_ctz(~m);
+         m = (unsigned)_mm_movemask_epi8(c3);
+         return i + 48 + compat_ctz(~m);
+      }
+   }
+
+   for (; len - i >= 16; i += 16)
+   {
+      unsigned mask = (unsigned)_mm_movemask_epi8(MEMDIFF_CMP128(a, b, i));
+      if (mask != 0xffff)
+         return i + compat_ctz(~mask);
+   }
+
+   return i + memdiff_first_scalar(a + i, b + i, len - i);
+}
+#endif
+
+#if defined(MEMDIFF_HAVE_NEON)
+/* Byte lanes of @eq that are all ones or all zeros, as the offset of
+ * the first zero one.  @eq must have one. */
+static INLINE size_t memdiff_neon_lane(uint8x16_t eq)
+{
+   uint64_t bits = vget_lane_u64(vreinterpret_u64_u8(
+            vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+   return compat_ctz_u64(~bits) >> 2;
+}
+
+static size_t memdiff_first_neon(const uint8_t *a, const uint8_t *b,
+      size_t len)
+{
+   size_t i = 0;
+
+   for (; len - i >= 64; i += 64)
+   {
+      uint8x16_t c0 = vceqq_u8(vld1q_u8(a + i),      vld1q_u8(b + i));
+      uint8x16_t c1 = vceqq_u8(vld1q_u8(a + i + 16), vld1q_u8(b + i + 16));
+      uint8x16_t c2 = vceqq_u8(vld1q_u8(a + i + 32), vld1q_u8(b + i + 32));
+      uint8x16_t c3 = vceqq_u8(vld1q_u8(a + i + 48), vld1q_u8(b + i + 48));
+
+      if (vminvq_u8(vandq_u8(vandq_u8(c0, c1), vandq_u8(c2, c3))) != 0xff)
+      {
+         if (vminvq_u8(c0) != 0xff)
+            return i + memdiff_neon_lane(c0);
+         if (vminvq_u8(c1) != 0xff)
+            return i + 16 + memdiff_neon_lane(c1);
+         if (vminvq_u8(c2) != 0xff)
+            return i + 32 + memdiff_neon_lane(c2);
+         return i + 48 + memdiff_neon_lane(c3);
+      }
+   }
+
+   for (; len - i >= 16; i += 16)
+   {
+      uint8x16_t c = vceqq_u8(vld1q_u8(a + i), vld1q_u8(b + i));
+      if (vminvq_u8(c) != 0xff)
+         return i + memdiff_neon_lane(c);
+   }
+
+   return i + memdiff_first_scalar(a + i, b + i, len - i);
+}
+#endif
+
+size_t memdiff_first(const void *a, const void *b, size_t len)
+{
+   const uint8_t *a8 = (const uint8_t*)a;
+   const uint8_t *b8 = (const uint8_t*)b;
+
+#if defined(MEMDIFF_HAVE_AVX2)
+   /* A vector's worth or less is not worth the feature check */
+   if (len > 32 && (cpu_features_get() & RETRO_SIMD_AVX2))
+      return memdiff_first_avx2(a8, b8, len);
+#endif
+#if defined(MEMDIFF_HAVE_SSE2)
+   return memdiff_first_sse2(a8, b8, len);
+#elif defined(MEMDIFF_HAVE_NEON)
+   return memdiff_first_neon(a8, b8, len);
+#else
+   return memdiff_first_scalar(a8, b8, len);
+#endif
+}
@@ -0,0 +1,370 @@
+/* Benchmark for rh265's wavefront (WPP) row threading.
+ *
+ * Each Annex-B H.265 elementary stream named on the command line is
+ * split into access units and decoded end to end once per thread
+ * count, serial first.  Every run checksums the cropped output
+ * pictures in display order; a threaded run whose checksum differs
+ * from the serial one is a decoder bug and fails the benchmark, so
+ * this doubles as the regression check for the row scheduling.
+ *
+ * Only streams coded with entropy_coding_sync (x265's default, or
+ * "--wpp" explicitly) have rows to spread; anything else decodes
+ * serially at every thread count and shows no speedup.
+ *
+ * With no stream named, the bundled wpp_ctu16.265 is decoded: twelve
+ * 256x144 pictures (I, P and B, SAO and weighted prediction on) in
+ * 16px CTBs, so nine wavefront rows a picture.  It is small enough to
+ * run under the sanitizers in CI, where the checksum comparison is
+ * the point and the timings are noise.  It was made with
+ *
+ *   ffmpeg -f lavfi -i testsrc2=size=256x144:rate=25,format=yuv420p \
+ *          -frames:v 12 -c:v libx265 -preset medium -crf 30 \
+ *          -x265-params wpp=1:ctu=16:keyint=8:bframes=2 \
+ *          -f hevc wpp_ctu16.265
+ *
+ * Larger sets for timing can be made with x265, e.g.
+ *
+ *   x265 --input park_joy_1080p50.y4m --preset medium --wpp \
+ *        --frames 120 -o park_wpp.265
+ *   x265 --input park_joy_1080p50.y4m --preset medium --wpp \
+ *        --ctu 32 --frames 120 -o park_wpp_ctu32.265
+ *
+ * (or "ffmpeg -i in.y4m -c:v libx265 -x265-params wpp=1 out.265").
+ * The best of --runs runs is reported, which keeps the numbers stable
+ * on a desktop with background load.  A single-thread decode is always
+ * the first, whether or not --threads names one, and each stream ends
+ * with a line setting it against the fastest threaded count.
+ *
+ * Usage:
+ *   rh265_wpp_bench [--threads 1,2,4,8] [--runs N] [stream.265 ...]
+ *
+ * Build (see Makefile):
+ *   make -C libretro-common/samples/formats/h265
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <formats/rh265.h>
+#include <encodings/crc32.h>
+#include <features/features_cpu.h>
+
+#define BENCH_MAX_COUNTS 16
+#define BENCH_FIXTURE    "wpp_ctu16.265"
+/* The default thread counts go at least this high even on a machine
+ * with fewer cores, so a small CI runner still compares threaded
+ * decodes against the serial one. */
+#define BENCH_MIN_THREADS 4
+
+typedef struct
+{
+   const uint8_t *data;
+   size_t size;
+} bench_au;
+
+static double now_ms(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static uint8_t *load_file(const char *path, size_t *size)
+{
+   uint8_t *buf = NULL;
+   long len;
+   FILE *f = fopen(path, "rb");
+   if (!f)
+      return NULL;
+   if (fseek(f, 0, SEEK_END) == 0 && (len = ftell(f)) > 0
+         && fseek(f, 0, SEEK_SET) == 0
+         && (buf = (uint8_t*)malloc((size_t)len)))
+   {
+      if (fread(buf, 1, (size_t)len, f) != (size_t)len)
+      {
+         free(buf);
+         buf = NULL;
+      }
+      else
+         *size = (size_t)len;
+   }
+   fclose(f);
+   return buf;
+}
+
+/* Offset of the start code at or after pos, or size. */
+static size_t next_start_code(const uint8_t *d, size_t size, size_t pos)
+{
+   for (; pos + 3 <= size; pos++)
+      if (d[pos] == 0 && d[pos + 1] == 0 && d[pos + 2] == 1)
+         return (pos > 0 && d[pos - 1] == 0) ? pos - 1 : pos;
+   return size;
+}
+
+/* Split an Annex-B stream into access units: a new one starts at the
+ * first parameter set, AUD or prefix SEI after a picture's slices, or
+ * at a slice with first_slice_segment_in_pic_flag set. */
+static int split_access_units(const uint8_t *d, size_t size,
+      bench_au **out)
+{
+   bench_au *aus = NULL;
+   int count = 0, cap = 0, have_vcl = 0;
+   size_t au_start = next_start_code(d, size, 0);
+   size_t pos = au_start;
+
+   while (pos < size)
+   {
+      size_t nal = pos + (d[pos + 2] == 1 ? 3 : 4);
+      size_t end = next_start_code(d, size, nal);
+      int type, starts;
+      if (nal + 2 >= end)
+      {
+         pos = end;
+         continue;
+      }
+      type = (d[nal] >> 1) & 0x3f;
+      if (type < 32)
+         starts = have_vcl && (d[nal + 2] & 0x80);
+      else
+         starts = have_vcl && (type <= 35 || type == 39);
+      if (starts)
+      {
+         if (count == cap)
+         {
+            bench_au *n;
+            cap = cap ? cap * 2 : 256;
+            if (!(n = (bench_au*)realloc(aus, cap * sizeof(*aus))))
+            {
+               free(aus);
+               return -1;
+            }
+            aus = n;
+         }
+         aus[count].data = d + au_start;
+         aus[count].size = pos - au_start;
+         count++;
+         au_start = pos;
+         have_vcl = 0;
+      }
+      if (type < 32)
+         have_vcl = 1;
+      pos = end;
+   }
+   if (au_start < size)
+   {
+      bench_au *n = (bench_au*)realloc(aus, (count + 1) * sizeof(*aus));
+      if (!n)
+      {
+         free(aus);
+         return -1;
+      }
+      aus = n;
+      aus[count].data = d + au_start;
+      aus[count].size = size - au_start;
+      count++;
+   }
+   *out = aus;
+   return count;
+}
+
+static uint32_t hash_picture(const rh265_video *v, uint32_t crc)
+{
+   int p;
+   int pel = rh265_video_bit_depth(v) > 8 ? 2 : 1;
+   for (p = 0; p < 3; p++)
+   {
+      int stride, w, h, y;
+      const uint8_t *pl = rh265_video_plane(v, p, &stride, &w, &h);
+      if (!pl)
+         continue;
+      for (y = 0; y < h; y++)
+         crc = encoding_crc32(crc,
+               pl + (size_t)y * stride * pel, (size_t)w * pel);
+   }
+   return crc;
+}
+
+/* One full decode.  Returns the number of pictures output, -1 on a
+ * decode error. */
+static int decode_all(const bench_au *aus, int count, unsigned threads,
+      double *ms, uint32_t *crc)
+{
+   int i, pics = 0;
+   double t0;
+   rh265_video *v = rh265_video_open();
+   if (!v)
+      return -1;
+   rh265_video_set_threads(v, threads);
+   *crc = 0;
+   t0   = now_ms();
+   for (i = 0; i < count; i++)
+   {
+      int ret = rh265_video_decode(v, aus[i].data, aus[i].size);
+      if (ret < 0)
+      {
+         rh265_video_close(v);
+         return -1;
+      }
+      if (ret == 1)
+      {
+         *crc = hash_picture(v, *crc);
+         pics++;
+      }
+   }
+   while (rh265_video_drain(v) == 0)
+   {
+      *crc = hash_picture(v, *crc);
+      pics++;
+   }
+   *ms = now_ms() - t0;
+   rh265_video_close(v);
+   return pics;
+}
+
+static int parse_counts(const char *s, unsigned *counts)
+{
+   int n = 0;
+   while (*s && n < BENCH_MAX_COUNTS)
+   {
+      char *end;
+      unsigned long c = strtoul(s, &end, 10);
+      if (end == s || c < 1)
+         return -1;
+      counts[n++] = (unsigned)c;
+      s = (*end == ',') ? end + 1 : end;
+   }
+   return n;
+}
+
+int main(int argc, char **argv)
+{
+   unsigned counts[BENCH_MAX_COUNTS];
+   int num_counts = 0, runs = 3, failed = 0, i, first, last;
+
+   for (i = 1; i < argc && argv[i][0] == '-'; i++)
+   {
+      if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+      {
+         if ((num_counts = parse_counts(argv[++i], counts)) <= 0)
+            goto usage;
+      }
+      else if (!strcmp(argv[i], "--runs") && i + 1 < argc)
+      {
+         if ((runs = atoi(argv[++i])) < 1)
+            goto usage;
+      }
+      else
+         goto usage;
+   }
+   if (i >= argc)
+   {
+      first = 0;
+      last  = 1;
+   }
+   else
+   {
+      first = i;
+      last  = argc;
+   }
+
+   if (!num_counts)
+   {
+      unsigned cores = cpu_features_get_core_amount();
+      unsigned c;
+      if (cores < BENCH_MIN_THREADS)
+         cores = BENCH_MIN_THREADS;
+      for (c = 1; c <= cores && num_counts < BENCH_MAX_COUNTS; c *= 2)
+         counts[num_counts++] = c;
+      if (counts[num_counts - 1] != cores && num_counts < BENCH_MAX_COUNTS)
+         counts[num_counts++] = cores;
+   }
+   /* every speedup is against one thread, so that runs first */
+   if (counts[0] != 1)
+   {
+      if (num_counts == BENCH_MAX_COUNTS)
+         num_counts--;
+      memmove(counts + 1, counts, num_counts * sizeof(*counts));
+      counts[0] = 1;
+      num_counts++;
+   }
+
+   for (i = first; i < last; i++)
+   {
+      const char *path = first ? argv[i] : BENCH_FIXTURE;
+      size_t size = 0;
+      bench_au *aus = NULL;
+      uint8_t *data = load_file(path, &size);
+      int count, c, serial_pics = 0, fastest = -1;
+      double serial_ms = 0.0, fastest_ms = 0.0;
+      uint32_t serial_crc = 0;
+
+      if (!data || (count = split_access_units(data, size, &aus)) <= 0)
+      {
+         fprintf(stderr, "%s: cannot read an Annex-B stream\n", path);
+         free(data);
+         failed = 1;
+         continue;
+      }
+      printf("%s: %d access units\n", path, count);
+
+      for (c = 0; c < num_counts; c++)
+      {
+         double best = 0.0;
+         uint32_t crc = 0;
+         int pics = 0, mismatch = 0, r;
+         for (r = 0; r < runs; r++)
+         {
+            double ms;
+            if ((pics = decode_all(aus, count, counts[c], &ms, &crc)) < 0)
+               break;
+            if (!c && !r)
+            {
+               serial_pics = pics;
+               serial_crc  = crc;
+            }
+            /* Every run is checked, not only the last: a race in the
+             * row scheduling need not lose it every time. */
+            if (pics != serial_pics || crc != serial_crc)
+               mismatch = 1;
+            if (!r || ms < best)
+               best = ms;
+         }
+         if (pics < 0)
+         {
+            printf("  threads %2u: decode error\n", counts[c]);
+            failed = 1;
+            break;
+         }
+         if (!c)
+            serial_ms = best;
+         else if (counts[c] > 1 && (fastest < 0 || best < fastest_ms))
+         {
+            fastest    = c;
+            fastest_ms = best;
+         }
+         printf("  threads %2u: %5d pictures  %9.2f ms  %8.2f fps"
+               "  x%.2f  crc %08x%s\n",
+               counts[c], pics, best,
+               best > 0.0 ? pics * 1000.0 / best : 0.0,
+               best > 0.0 ? serial_ms / best : 0.0,
+               (unsigned)crc, mismatch ? "  MISMATCH" : "");
+         if (mismatch)
+            failed = 1;
+      }
+      if (fastest >= 0)
+         printf("  1 thread %.2f ms, %u threads %.2f ms: x%.2f\n",
+               serial_ms, counts[fastest], fastest_ms,
+               fastest_ms > 0.0 ? serial_ms / fastest_ms : 0.0);
+      free(aus);
+      free(data);
+   }
+   return failed;
+
+usage:
+   fprintf(stderr,
+         "usage: %s [--threads 1,2,4,8] [--runs N] [stream.265 ...]\n",
+         argv[0]);
+   return 2;
+}
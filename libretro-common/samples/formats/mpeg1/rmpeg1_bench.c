@@ -0,0 +1,283 @@
+/* Decode throughput for the MPEG-1 program stream path.
+ *
+ * Each file named on the command line -- an MPEG-1 system stream, as a
+ * .mpg attract-mode clip or a VCD track with the sector headers stripped
+ * -- is read into memory once, then demuxed with rmpeg1_ps and decoded
+ * with rmpeg1_video end to end, first on its own and then with every
+ * picture converted to 32-bit RGB as a frontend would.  Frames per
+ * second are reported for both, best of --runs.
+ *
+ * Every run also checksums the decoded planes and the converted pixels.
+ * The vector kernels are meant to be bit-exact with the scalar code, so
+ *
+ *   make && ./rmpeg1_bench clip.mpg
+ *   make clean && make SIMD=0 && ./rmpeg1_bench clip.mpg
+ *
+ * must print the same checksums, and the ratio of the two fps columns is
+ * the SIMD speedup.  No streams are bundled; any MPEG-1 system stream
+ * will do, e.g.
+ *
+ *   ffmpeg -i in.y4m -c:v mpeg1video -b:v 1500k -bf 2 -f mpeg clip.mpg
+ *
+ * Usage:
+ *   rmpeg1_bench [--runs N] clip.mpg [...]
+ *
+ * Build (see Makefile):
+ *   make -C libretro-common/samples/formats/mpeg1
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <formats/rmpeg1_ps.h>
+#include <formats/rmpeg1_video.h>
+#include <encodings/crc32.h>
+
+/* One CD-XA sector's worth of payload at a time, as a VCD reader feeds it. */
+#define BENCH_CHUNK 2324
+
+typedef struct
+{
+   uint32_t *rgb;
+   size_t    rgb_cap;
+   uint32_t  yuv_crc;
+   uint32_t  rgb_crc;
+   bool      convert;
+} bench_state;
+
+static double now_ms(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static uint8_t *load_file(const char *path, size_t *size)
+{
+   uint8_t *buf = NULL;
+   long len;
+   FILE *f = fopen(path, "rb");
+   if (!f)
+      return NULL;
+   if (fseek(f, 0, SEEK_END) == 0 && (len = ftell(f)) > 0
+         && fseek(f, 0, SEEK_SET) == 0
+         && (buf = (uint8_t*)malloc((size_t)len)))
+   {
+      if (fread(buf, 1, (size_t)len, f) != (size_t)len)
+      {
+         free(buf);
+         buf = NULL;
+      }
+      else
+         *size = (size_t)len;
+   }
+   fclose(f);
+   return buf;
+}
+
+static void hash_plane(uint32_t *crc, const uint8_t *p, unsigned stride,
+      unsigned w, unsigned h)
+{
+   unsigned y;
+   for (y = 0; y < h; y++)
+      *crc = encoding_crc32(*crc, p + (size_t)y * stride, w);
+}
+
+/* Returns false only when a conversion buffer cannot be had. */
+static bool consume_frame(bench_state *st, const rmpeg1_video_frame_t *fr)
+{
+   unsigned cw = (fr->width  + 1) >> 1;
+   unsigned ch = (fr->height + 1) >> 1;
+
+   hash_plane(&st->yuv_crc, fr->y,  fr->y_stride, fr->width, fr->height);
+   hash_plane(&st->yuv_crc, fr->cb, fr->c_stride, cw, ch);
+   hash_plane(&st->yuv_crc, fr->cr, fr->c_stride, cw, ch);
+
+   if (st->convert)
+   {
+      size_t px = (size_t)fr->width * fr->height;
+      if (px > st->rgb_cap)
+      {
+         uint32_t *n = (uint32_t*)realloc(st->rgb, px * sizeof(*n));
+         if (!n)
+            return false;
+         st->rgb     = n;
+         st->rgb_cap = px;
+      }
+      rmpeg1_video_frame_blit(fr, st->rgb, fr->width, false);
+      st->rgb_crc = encoding_crc32(st->rgb_crc,
+            (const uint8_t*)st->rgb, px * sizeof(*st->rgb));
+   }
+   return true;
+}
+
+/* One full demux and decode.  Returns the number of pictures output, -1
+ * on an allocation failure. */
+static int decode_all(const uint8_t *data, size_t size, bench_state *st,
+      double *ms)
+{
+   rmpeg1_ps_packet_t   pkt;
+   rmpeg1_video_frame_t fr;
+   size_t off = 0;
+   int pics   = 0;
+   double t0;
+   rmpeg1_ps_t    *ps = rmpeg1_ps_init(0);
+   rmpeg1_video_t *v  = rmpeg1_video_init();
+
+   if (!ps || !v)
+   {
+      rmpeg1_ps_free(ps);
+      rmpeg1_video_free(v);
+      return -1;
+   }
+
+   st->yuv_crc = 0;
+   st->rgb_crc = 0;
+   t0          = now_ms();
+
+   while (off < size)
+   {
+      size_t want = size - off;
+      size_t got;
+      if (want > BENCH_CHUNK)
+         want = BENCH_CHUNK;
+      got  = rmpeg1_ps_write(ps, data + off, want);
+      off += got;
+      while (rmpeg1_ps_next(ps, &pkt))
+      {
+         size_t q = 0;
+         if (pkt.type != RMPEG1_PS_VIDEO || pkt.index != 0)
+            continue;
+         while (q < pkt.size)
+         {
+            size_t w = rmpeg1_video_write(v, pkt.data + q, pkt.size - q);
+            q += w;
+            while (rmpeg1_video_decode(v, &fr))
+            {
+               if (!fr.y)
+                  continue;
+               if (!consume_frame(st, &fr))
+                  goto oom;
+               pics++;
+            }
+            if (!w)
+               break;
+         }
+      }
+      if (!got)
+         break;
+   }
+
+   rmpeg1_video_flush(v);
+   while (rmpeg1_video_decode(v, &fr))
+   {
+      if (!fr.y)
+         continue;
+      if (!consume_frame(st, &fr))
+         goto oom;
+      pics++;
+   }
+
+   *ms = now_ms() - t0;
+   rmpeg1_video_free(v);
+   rmpeg1_ps_free(ps);
+   return pics;
+
+oom:
+   rmpeg1_video_free(v);
+   rmpeg1_ps_free(ps);
+   return -1;
+}
+
+/* Best of runs; returns the picture count of the last run. */
+static int bench(const uint8_t *data, size_t size, bench_state *st,
+      int runs, double *best)
+{
+   int pics = 0, r;
+   *best = 0.0;
+   for (r = 0; r < runs; r++)
+   {
+      double ms = 0.0;
+      if ((pics = decode_all(data, size, st, &ms)) < 0)
+         return -1;
+      if (!r || ms < *best)
+         *best = ms;
+   }
+   return pics;
+}
+
+int main(int argc, char **argv)
+{
+   bench_state st;
+   int runs = 3, failed = 0, i;
+
+   memset(&st, 0, sizeof(st));
+
+   for (i = 1; i < argc && argv[i][0] == '-'; i++)
+   {
+      if (!strcmp(argv[i], "--runs") && i + 1 < argc)
+      {
+         if ((runs = atoi(argv[++i])) < 1)
+            goto usage;
+      }
+      else
+         goto usage;
+   }
+   if (i >= argc)
+      goto usage;
+
+#if defined(RMPEG1_NO_SIMD)
+   printf("scalar build\n");
+#endif
+
+   for (; i < argc; i++)
+   {
+      size_t size = 0;
+      uint8_t *data = load_file(argv[i], &size);
+      double dec_ms, cvt_ms;
+      int pics, pics_cvt;
+
+      if (!data)
+      {
+         fprintf(stderr, "%s: cannot read\n", argv[i]);
+         failed = 1;
+         continue;
+      }
+
+      st.convert = false;
+      pics       = bench(data, size, &st, runs, &dec_ms);
+      st.convert = true;
+      pics_cvt   = bench(data, size, &st, runs, &cvt_ms);
+
+      if (pics < 0 || pics_cvt < 0)
+      {
+         fprintf(stderr, "%s: out of memory\n", argv[i]);
+         failed = 1;
+      }
+      else if (!pics)
+      {
+         fprintf(stderr, "%s: no pictures decoded\n", argv[i]);
+         failed = 1;
+      }
+      else
+      {
+         printf("%s: %d pictures, %lu bytes\n", argv[i], pics,
+               (unsigned long)size);
+         printf("  decode         %9.2f ms  %8.2f fps  yuv crc %08x\n",
+               dec_ms, dec_ms > 0.0 ? pics * 1000.0 / dec_ms : 0.0,
+               (unsigned)st.yuv_crc);
+         printf("  decode + rgb   %9.2f ms  %8.2f fps  rgb crc %08x\n",
+               cvt_ms, cvt_ms > 0.0 ? pics * 1000.0 / cvt_ms : 0.0,
+               (unsigned)st.rgb_crc);
+      }
+      free(data);
+   }
+   free(st.rgb);
+   return failed;
+
+usage:
+   fprintf(stderr, "usage: %s [--runs N] clip.mpg [...]\n", argv[0]);
+   return 2;
+}
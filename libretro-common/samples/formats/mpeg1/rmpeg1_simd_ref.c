@@ -0,0 +1,71 @@
+/* The scalar half of rmpeg1_simd_test.
+ *
+ * rmpeg1_video.c picks its kernels at compile time, so the scalar ones
+ * only exist in a build made with RMPEG1_NO_SIMD.  This file is that
+ * build: it includes the decoder with the vector paths off and hands
+ * its kernels out under scalar_* names for the test to hold against
+ * the vector ones it includes itself.
+ *
+ * The decoder's entry points are renamed on the way in; otherwise they
+ * would be defined twice in one link. */
+
+#ifndef RMPEG1_NO_SIMD
+#define RMPEG1_NO_SIMD
+#endif
+
+#define rmpeg1_video_init         scalar_rmpeg1_video_init
+#define rmpeg1_video_free         scalar_rmpeg1_video_free
+#define rmpeg1_video_reset        scalar_rmpeg1_video_reset
+#define rmpeg1_video_write        scalar_rmpeg1_video_write
+#define rmpeg1_video_decode       scalar_rmpeg1_video_decode
+#define rmpeg1_video_flush        scalar_rmpeg1_video_flush
+#define rmpeg1_video_has_sequence scalar_rmpeg1_video_has_sequence
+#define rmpeg1_video_width        scalar_rmpeg1_video_width
+#define rmpeg1_video_height       scalar_rmpeg1_video_height
+#define rmpeg1_video_framerate    scalar_rmpeg1_video_framerate
+#define rmpeg1_video_aspect_code  scalar_rmpeg1_video_aspect_code
+#define rmpeg1_video_skipped      scalar_rmpeg1_video_skipped
+#define rmpeg1_video_errors       scalar_rmpeg1_video_errors
+#define rmpeg1_video_frame_blit   scalar_rmpeg1_video_frame_blit
+
+#include "../../../formats/mpeg1/rmpeg1_video.c"
+
+#include "rmpeg1_simd_ref.h"
+
+void scalar_idct_block(const int16_t *blk, uint8_t *dst, unsigned stride)
+{
+   idct_block(blk, dst, stride);
+}
+
+void scalar_idct_block_add(const int16_t *blk, uint8_t *dst,
+      unsigned stride)
+{
+   idct_block_add(blk, dst, stride);
+}
+
+void scalar_mc_avg2(uint8_t *d, const uint8_t *a, const uint8_t *b,
+      unsigned n)
+{
+   mc_avg2(d, a, b, n);
+}
+
+void scalar_mc_avg4(uint8_t *d, const uint8_t *a, const uint8_t *b,
+      const uint8_t *c, const uint8_t *e, unsigned n)
+{
+   mc_avg4(d, a, b, c, e, n);
+}
+
+void scalar_mc_predict(const uint8_t *ref, unsigned stride,
+      unsigned pw, unsigned ph,
+      uint8_t *dst, unsigned dstride,
+      int x, int y, int mvx, int mvy, unsigned bw, unsigned bh)
+{
+   mc_predict(ref, stride, pw, ph, dst, dstride,
+         x, y, mvx, mvy, bw, bh);
+}
+
+void scalar_yuv_row(uint32_t *dr, const uint8_t *yr,
+      const uint8_t *ur, const uint8_t *vr, unsigned w, bool argb)
+{
+   rmpeg1_yuv_row(dr, yr, ur, vr, w, argb);
+}
@@ -0,0 +1,25 @@
+#ifndef RMPEG1_SIMD_REF_H
+#define RMPEG1_SIMD_REF_H
+
+/* rmpeg1_video.c's kernels as built with RMPEG1_NO_SIMD; see
+ * rmpeg1_simd_ref.c. */
+
+#include <stdint.h>
+
+#include <boolean.h>
+
+void scalar_idct_block(const int16_t *blk, uint8_t *dst, unsigned stride);
+void scalar_idct_block_add(const int16_t *blk, uint8_t *dst,
+      unsigned stride);
+void scalar_mc_avg2(uint8_t *d, const uint8_t *a, const uint8_t *b,
+      unsigned n);
+void scalar_mc_avg4(uint8_t *d, const uint8_t *a, const uint8_t *b,
+      const uint8_t *c, const uint8_t *e, unsigned n);
+void scalar_mc_predict(const uint8_t *ref, unsigned stride,
+      unsigned pw, unsigned ph,
+      uint8_t *dst, unsigned dstride,
+      int x, int y, int mvx, int mvy, unsigned bw, unsigned bh);
+void scalar_yuv_row(uint32_t *dr, const uint8_t *yr,
+      const uint8_t *ur, const uint8_t *vr, unsigned w, bool argb);
+
+#endif
@@ -0,0 +1,307 @@
+/* Random-input check of rmpeg1's vector kernels against its scalar ones.
+ *
+ * rmpeg1_video.c carries SSE2 and NEON versions of the IDCT, the motion
+ * compensation averages and the YUV to RGB row, chosen at compile time,
+ * and every one is meant to be bit-exact with the scalar code: the
+ * decoder predicts from its own output, so an off-by-one in a vector
+ * path drifts across a GOP rather than staying in one picture.  A
+ * stream's checksum only catches that if the stream happens to reach
+ * the inputs that differ.  This throws random blocks at both builds
+ * instead:
+ *
+ *  - IDCT, store and add, on blocks drawn like real ones (a DC and a
+ *    few AC terms), on IEEE 1180's uniform ranges, and on the full
+ *    [-2048, 2047] range dequantisation clamps to, which is where a
+ *    16-bit intermediate would overflow.
+ *
+ *  - The two- and four-point averages at every length up to 40, so
+ *    each vector width and the scalar tail are all reached, including
+ *    in place (d == a) as the B picture interpolation calls it.
+ *
+ *  - mc_predict with vectors in every half-sample phase, including
+ *    ones pointing off the reference, which take the clamped path.
+ *
+ *  - The RGB row at every width up to 70, in both channel orders.
+ *
+ * The vector side is the decoder included here; the scalar side is the
+ * same source built with RMPEG1_NO_SIMD in rmpeg1_simd_ref.c.  Every
+ * buffer is allocated at exactly the size a kernel may touch, so a
+ * sanitizer build also catches a vector load or store that runs past
+ * the end.  Exits non-zero on the first kernel that differs.
+ *
+ * "make SIMD=0" builds both sides scalar, which passes trivially; the
+ * point of the test is the default build.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../../formats/mpeg1/rmpeg1_video.c"
+
+#include "rmpeg1_simd_ref.h"
+
+#define TEST_IDCT_BLOCKS 20000
+#define TEST_MC_ROUNDS   4000
+#define TEST_RGB_ROUNDS  200
+
+static uint64_t test_rs = 1;
+
+static long test_rnd(long lo, long hi)
+{
+   test_rs = test_rs * 6364136223846793005ULL + 1442695040888963407ULL;
+   return lo + (long)((test_rs >> 33) % (uint64_t)(hi - lo + 1));
+}
+
+static void test_fill(uint8_t *p, size_t n)
+{
+   size_t i;
+   for (i = 0; i < n; i++)
+      p[i] = (uint8_t)test_rnd(0, 255);
+}
+
+/* A coefficient block of one of the shapes above. */
+static void test_block(int16_t *blk, int shape)
+{
+   int k;
+
+   memset(blk, 0, 64 * sizeof(*blk));
+   switch (shape)
+   {
+      case 0:
+         /* intra-like: a DC near the 1024 predictor and a few small
+          * AC terms */
+         blk[0] = (int16_t)test_rnd(0, 2047);
+         for (k = (int)test_rnd(0, 6); k > 0; k--)
+            blk[test_rnd(1, 63)] = (int16_t)test_rnd(-64, 64);
+         break;
+      case 1:
+         /* sparse inter residual, large terms */
+         for (k = (int)test_rnd(1, 4); k > 0; k--)
+            blk[test_rnd(0, 63)] = (int16_t)test_rnd(-2048, 2047);
+         break;
+      case 2:
+         for (k = 0; k < 64; k++)
+            blk[k] = (int16_t)test_rnd(-256, 255);
+         break;
+      case 3:
+         for (k = 0; k < 64; k++)
+            blk[k] = (int16_t)test_rnd(-5, 5);
+         break;
+      default:
+         for (k = 0; k < 64; k++)
+            blk[k] = (int16_t)test_rnd(-2048, 2047);
+         break;
+   }
+}
+
+static int test_idct(void)
+{
+   int16_t  blk[64];
+   uint8_t  got[24 * 8], want[24 * 8];
+   int      i;
+
+   for (i = 0; i < TEST_IDCT_BLOCKS; i++)
+   {
+      int      shape  = i % 5;
+      unsigned stride = (unsigned)test_rnd(8, 24);
+      size_t   n      = (size_t)stride * 7 + 8;
+
+      test_block(blk, shape);
+      test_fill(got, n);
+      memcpy(want, got, n);
+      idct_block(blk, got, stride);
+      scalar_idct_block(blk, want, stride);
+      if (memcmp(got, want, n))
+      {
+         printf("FAIL: idct store differs on block %d (shape %d)\n",
+               i, shape);
+         return 1;
+      }
+
+      test_fill(got, n);
+      memcpy(want, got, n);
+      idct_block_add(blk, got, stride);
+      scalar_idct_block_add(blk, want, stride);
+      if (memcmp(got, want, n))
+      {
+         printf("FAIL: idct add differs on block %d (shape %d)\n",
+               i, shape);
+         return 1;
+      }
+   }
+   printf("ok:   idct store and add on %d blocks\n", TEST_IDCT_BLOCKS);
+   return 0;
+}
+
+static int test_avg(void)
+{
+   int i;
+
+   for (i = 0; i < TEST_MC_ROUNDS; i++)
+   {
+      unsigned n       = (unsigned)(i % 40) + 1;
+      int      inplace = (i / 40) & 1;
+      uint8_t *src[4], *got, *want;
+      int      k, bad;
+
+      for (k = 0; k < 4; k++)
+      {
+         src[k] = (uint8_t*)malloc(n);
+         test_fill(src[k], n);
+      }
+      got  = (uint8_t*)malloc(n);
+      want = (uint8_t*)malloc(n);
+
+      /* two-point */
+      memcpy(got,  src[0], n);
+      memcpy(want, src[0], n);
+      if (inplace)
+      {
+         mc_avg2(got, got, src[1], n);
+         scalar_mc_avg2(want, want, src[1], n);
+      }
+      else
+      {
+         mc_avg2(got, src[0], src[1], n);
+         scalar_mc_avg2(want, src[0], src[1], n);
+      }
+      bad = memcmp(got, want, n) != 0;
+
+      /* four-point */
+      if (!bad)
+      {
+         mc_avg4(got, src[0], src[1], src[2], src[3], n);
+         scalar_mc_avg4(want, src[0], src[1], src[2], src[3], n);
+         bad = memcmp(got, want, n) != 0 ? 2 : 0;
+      }
+
+      for (k = 0; k < 4; k++)
+         free(src[k]);
+      free(got);
+      free(want);
+
+      if (bad)
+      {
+         printf("FAIL: mc_avg%d differs at length %u%s\n",
+               bad == 2 ? 4 : 2, n, inplace ? " in place" : "");
+         return 1;
+      }
+   }
+   printf("ok:   two- and four-point averages, lengths 1..40\n");
+   return 0;
+}
+
+static int test_predict(void)
+{
+   const unsigned pw = 48, ph = 32, stride = 56;
+   uint8_t *ref = (uint8_t*)malloc((size_t)stride * (ph - 1) + pw);
+   uint8_t  got[16 * 24], want[16 * 24];
+   int      i, clamped = 0;
+
+   test_fill(ref, (size_t)stride * (ph - 1) + pw);
+   for (i = 0; i < TEST_MC_ROUNDS; i++)
+   {
+      unsigned bw = (i & 1) ? 16 : 8;
+      unsigned bh = (i & 2) ? 16 : 8;
+      int      x  = (int)test_rnd(0, (long)(pw - bw)) & ~7;
+      int      y  = (int)test_rnd(0, (long)(ph - bh)) & ~7;
+      /* mostly in range; one in four allowed well off the plane */
+      int      r   = (i & 12) ? 12 : 80;
+      int      mvx = (int)test_rnd(-r, r);
+      int      mvy = (int)test_rnd(-r, r);
+      int      sx  = x + (mvx >> 1), sy = y + (mvy >> 1);
+
+      if (     sx < 0 || sy < 0
+            || sx + (int)bw + (mvx & 1) > (int)pw
+            || sy + (int)bh + (mvy & 1) > (int)ph)
+         clamped++;
+
+      memset(got,  0, sizeof(got));
+      memset(want, 0, sizeof(want));
+      mc_predict(ref, stride, pw, ph, got, 24, x, y, mvx, mvy, bw, bh);
+      scalar_mc_predict(ref, stride, pw, ph, want, 24,
+            x, y, mvx, mvy, bw, bh);
+      if (memcmp(got, want, sizeof(got)))
+      {
+         printf("FAIL: mc_predict differs: %ux%u at %d,%d mv %d,%d\n",
+               bw, bh, x, y, mvx, mvy);
+         free(ref);
+         return 1;
+      }
+   }
+   free(ref);
+   if (!clamped)
+   {
+      printf("FAIL: no prediction reached the clamped path\n");
+      return 1;
+   }
+   printf("ok:   mc_predict, %d of %d off the reference\n",
+         clamped, TEST_MC_ROUNDS);
+   return 0;
+}
+
+static int test_rgb(void)
+{
+   int i;
+
+   for (i = 0; i < TEST_RGB_ROUNDS; i++)
+   {
+      unsigned  w    = (unsigned)(i % 70) + 1;
+      bool      argb = (i / 70) & 1;
+      uint8_t  *yr   = (uint8_t*)malloc(w);
+      uint8_t  *ur   = (uint8_t*)malloc((w + 1) / 2);
+      uint8_t  *vr   = (uint8_t*)malloc((w + 1) / 2);
+      uint32_t *got  = (uint32_t*)malloc(w * sizeof(*got));
+      uint32_t *want = (uint32_t*)malloc(w * sizeof(*want));
+      int       bad;
+
+      test_fill(yr, w);
+      test_fill(ur, (w + 1) / 2);
+      test_fill(vr, (w + 1) / 2);
+      rmpeg1_yuv_row(got, yr, ur, vr, w, argb);
+      scalar_yuv_row(want, yr, ur, vr, w, argb);
+      bad = memcmp(got, want, w * sizeof(*got)) != 0;
+
+      free(yr);
+      free(ur);
+      free(vr);
+      free(got);
+      free(want);
+
+      if (bad)
+      {
+         printf("FAIL: rgb row differs at width %u (%s)\n",
+               w, argb ? "ARGB" : "ABGR");
+         return 1;
+      }
+   }
+   printf("ok:   rgb rows, widths 1..70, both channel orders\n");
+   return 0;
+}
+
+int main(void)
+{
+   int fails = 0;
+
+#if defined(RMPEG1_SSE2)
+#if defined(__SSE4_1__)
+   printf("rmpeg1 kernel path: SSE4.1\n");
+#else
+   printf("rmpeg1 kernel path: SSE2\n");
+#endif
+#elif defined(RMPEG1_NEON)
+   printf("rmpeg1 kernel path: NEON\n");
+#else
+   printf("rmpeg1 kernel path: scalar (nothing to compare)\n");
+#endif
+
+   fails += test_idct();
+   fails += test_avg();
+   fails += test_predict();
+   fails += test_rgb();
+
+   if (fails)
+      printf("%d check(s) failed\n", fails);
+   return fails ? 1 : 0;
+}
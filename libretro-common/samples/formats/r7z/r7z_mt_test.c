@@ -0,0 +1,318 @@
+/* Threaded LZMA2 decoding and the shared folder cache, on a bundled
+ * archive.
+ *
+ * r7z_mt.7z is laid out the way multithreaded 7-Zip writes one: each
+ * folder's LZMA2 stream resets its dictionary every 16 KiB, so the runs
+ * between resets can be decoded independently.  It was written by
+ * compressing each 16 KiB block on its own as raw LZMA2 with Python's
+ * lzma module and joining the chunks.  It has three folders, so a
+ * caller walking them in order also sets off the read-ahead:
+ *
+ *   folder 0  disc1.bin 40 KiB, disc2.bin 24 KiB   four runs
+ *   folder 1  bios.bin 48 KiB                      three runs
+ *   folder 2  readme.txt 8 KiB                     one run
+ *
+ * Every entry's bytes come from test_content(), so they are checked
+ * against the source as well as against each other and the archive's
+ * CRCs.  Three things are checked:
+ *
+ *   - a serial decode (one thread) reproduces every entry, which also
+ *     covers the mid-stream dictionary resets the serial decoder once
+ *     mishandled;
+ *   - decodes on four threads, whole and sliced, match it byte for
+ *     byte;
+ *   - with the shared cache on, a folder decoded through one handle is
+ *     served to the next open of the same archive without decoding.
+ *     The second open is of a copy with every packed byte zeroed, so
+ *     anything it extracts can only have come from the cache; with the
+ *     cache off the same extraction must fail.
+ *
+ * Build: make -C libretro-common/samples/formats/r7z check
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <7z/r7z_archive.h>
+
+#define TEST_ARCHIVE  "r7z_mt.7z"
+#define TEST_ENTRIES  4
+#define TEST_THREADS  4
+
+static int failures = 0;
+static int checks   = 0;
+
+static void check(int ok, const char *what, const char *detail)
+{
+   checks++;
+   printf("  %-5s %-48s %s\n", ok ? "ok" : "FAIL", what,
+         detail ? detail : "");
+   if (!ok)
+      failures++;
+}
+
+/* The entries in archive order: name, seed and size for
+ * test_content(), and the folder each is in. */
+static const struct
+{
+   const char *name;
+   uint32_t    seed;
+   size_t      size;
+   uint32_t    folder;
+} test_entries[TEST_ENTRIES] = {
+   { "disc1.bin",  1, 40 * 1024, 0 },
+   { "disc2.bin",  2, 24 * 1024, 0 },
+   { "bios.bin",   3, 48 * 1024, 1 },
+   { "readme.txt", 4,  8 * 1024, 2 },
+};
+
+/* 16-byte windows onto a phrase, picked by an LCG: compressible, so the
+ * archive stays small, but not so regular that a wrong match distance
+ * goes unnoticed. */
+static uint8_t *test_content(uint32_t seed, size_t n)
+{
+   static const char phrase[] =
+      "the quick brown fox jumps over the lazy dog; ";
+   uint8_t *out = (uint8_t *)malloc(n);
+   uint32_t s   = seed;
+   unsigned off = 0;
+   size_t   i;
+
+   for (i = 0; i < n; i++)
+   {
+      if (i % 16 == 0)
+      {
+         s   = s * 1103515245u + 12345u;
+         off = (s >> 16) % 29;
+      }
+      out[i] = (uint8_t)phrase[off + i % 16];
+   }
+   return out;
+}
+
+static uint8_t *test_load(const char *path, size_t *len)
+{
+   FILE    *f = fopen(path, "rb");
+   uint8_t *buf;
+   long     n;
+
+   if (!f)
+      return NULL;
+   fseek(f, 0, SEEK_END);
+   n = ftell(f);
+   fseek(f, 0, SEEK_SET);
+   buf = (uint8_t *)malloc(n > 0 ? (size_t)n : 1);
+   if (n <= 0 || fread(buf, 1, (size_t)n, f) != (size_t)n)
+   {
+      free(buf);
+      buf = NULL;
+   }
+   fclose(f);
+   *len = (size_t)n;
+   return buf;
+}
+
+/* Dictionary resets in the LZMA2 stream starting at in: the number of
+ * runs the threaded decoder can split it into. */
+static unsigned test_count_runs(const uint8_t *in, size_t len)
+{
+   unsigned runs = 0;
+   size_t   ip   = 0;
+
+   while (ip < len && in[ip])
+   {
+      uint8_t ctl = in[ip];
+
+      if (ctl == 1 || ctl >= 0xE0)
+         runs++;
+      if (ctl & 0x80)
+      {
+         if (ip + 5 > len)
+            break;
+         ip += ((ctl & 0x40) ? 6 : 5)
+            + (((size_t)in[ip + 3] << 8) | in[ip + 4]) + 1;
+      }
+      else if (ip + 3 <= len)
+         ip += 3 + (((size_t)in[ip + 1] << 8) | in[ip + 2]) + 1;
+      else
+         break;
+   }
+   return runs;
+}
+
+/* Extracts every entry of the archive in buf with the given thread cap,
+ * sliced or whole, into out[]. Returns the first failure, R7Z_OK if
+ * none. */
+static int test_extract_all(const uint8_t *buf, size_t len,
+      unsigned threads, int sliced, uint8_t **out, size_t *out_len)
+{
+   r7z_archive_t *a   = NULL;
+   int            res = r7z_archive_open(&a, buf, len);
+   uint32_t       i;
+
+   if (res != R7Z_OK)
+      return res;
+   r7z_archive_set_threads(a, threads);
+   if (r7z_archive_num_entries(a) != TEST_ENTRIES)
+      res = R7Z_ERROR_DATA;
+
+   for (i = 0; i < TEST_ENTRIES && res == R7Z_OK; i++)
+   {
+      const r7z_entry_t *e = r7z_archive_entry(a, i);
+
+      out[i] = NULL;
+      if (!e || e->folder != test_entries[i].folder)
+         res = R7Z_ERROR_DATA;
+      else if (!sliced)
+         res = r7z_archive_extract(a, i, &out[i], &out_len[i]);
+      else
+         while ((res = r7z_archive_extract_slice(a, i,
+                     &out[i], &out_len[i])) == R7Z_PENDING) { }
+   }
+
+   r7z_archive_close(a);
+   return res;
+}
+
+static void test_free_all(uint8_t **out)
+{
+   unsigned i;
+   for (i = 0; i < TEST_ENTRIES; i++)
+   {
+      free(out[i]);
+      out[i] = NULL;
+   }
+}
+
+/* Opens buf with one thread and extracts entry i. */
+static int test_extract_one(const uint8_t *buf, size_t len, uint32_t i,
+      uint8_t **out, size_t *out_len)
+{
+   r7z_archive_t *a   = NULL;
+   int            res = r7z_archive_open(&a, buf, len);
+
+   *out = NULL;
+   if (res != R7Z_OK)
+      return res;
+   r7z_archive_set_threads(a, 1);
+   res = r7z_archive_extract(a, i, out, out_len);
+   r7z_archive_close(a);
+   return res;
+}
+
+int main(void)
+{
+   uint8_t *serial[TEST_ENTRIES]      = { NULL };
+   uint8_t *threaded[TEST_ENTRIES]    = { NULL };
+   size_t   serial_len[TEST_ENTRIES]  = { 0 };
+   size_t   threaded_len[TEST_ENTRIES] = { 0 };
+   uint8_t *buf, *zeroed, *got;
+   size_t   len, got_len, pack_len;
+   unsigned i, runs;
+   int      res, same;
+   char     detail[128];
+
+   printf("r7z threaded decode and folder cache test\n\n");
+
+   if (!(buf = test_load(TEST_ARCHIVE, &len)) || len < 32)
+   {
+      printf("cannot read %s; run this from its own directory\n",
+            TEST_ARCHIVE);
+      free(buf);
+      return 1;
+   }
+
+   /* The packed streams sit between the 32-byte signature header and
+    * the header it points at; folder 0's comes first. */
+   pack_len = (size_t)buf[12] | ((size_t)buf[13] << 8)
+            | ((size_t)buf[14] << 16) | ((size_t)buf[15] << 24);
+   if (pack_len > len - 32)
+      pack_len = len - 32;
+   runs = test_count_runs(buf + 32, pack_len);
+   sprintf(detail, "%u runs", runs);
+   check(runs >= 2, "folder 0 resets its dictionary mid-stream", detail);
+
+   /* Serial, against the source. */
+   res = test_extract_all(buf, len, 1, 0, serial, serial_len);
+   sprintf(detail, "res %d", res);
+   check(res == R7Z_OK, "serial decode of every entry", detail);
+   same = (res == R7Z_OK);
+   for (i = 0; i < TEST_ENTRIES && same; i++)
+   {
+      uint8_t *want = test_content(test_entries[i].seed,
+            test_entries[i].size);
+      same = serial_len[i] == test_entries[i].size
+         && !memcmp(serial[i], want, serial_len[i]);
+      if (!same)
+         printf("        %s differs from its source\n",
+               test_entries[i].name);
+      free(want);
+   }
+   check(same, "serial output matches the source", NULL);
+
+   /* Threaded, whole and sliced, against serial. */
+   res = test_extract_all(buf, len, TEST_THREADS, 0, threaded,
+         threaded_len);
+   same = (res == R7Z_OK);
+   for (i = 0; i < TEST_ENTRIES && same; i++)
+      same = threaded_len[i] == serial_len[i]
+         && !memcmp(threaded[i], serial[i], serial_len[i]);
+   sprintf(detail, "res %d", res);
+   check(same, "4-thread decode matches serial", detail);
+   test_free_all(threaded);
+
+   res = test_extract_all(buf, len, TEST_THREADS, 1, threaded,
+         threaded_len);
+   same = (res == R7Z_OK);
+   for (i = 0; i < TEST_ENTRIES && same; i++)
+      same = threaded_len[i] == serial_len[i]
+         && !memcmp(threaded[i], serial[i], serial_len[i]);
+   sprintf(detail, "res %d", res);
+   check(same, "4-thread sliced decode matches serial", detail);
+   test_free_all(threaded);
+
+   /* The same archive with nothing left to decode from. */
+   zeroed = (uint8_t *)malloc(len);
+   memcpy(zeroed, buf, len);
+   memset(zeroed + 32, 0, pack_len);
+
+   res = test_extract_one(zeroed, len, 1, &got, &got_len);
+   sprintf(detail, "res %d", res);
+   check(res == R7Z_ERROR_DATA, "zeroed copy does not decode, cache off",
+         detail);
+   free(got);
+
+   r7z_archive_cache_init(0);
+
+   res = test_extract_one(buf, len, 0, &got, &got_len);
+   sprintf(detail, "res %d", res);
+   check(res == R7Z_OK, "first open decodes folder 0", detail);
+   free(got);
+
+   res = test_extract_one(zeroed, len, 1, &got, &got_len);
+   same = res == R7Z_OK && got_len == serial_len[1]
+      && !memcmp(got, serial[1], got_len);
+   sprintf(detail, "res %d", res);
+   check(same, "second open takes folder 0 from the cache", detail);
+   free(got);
+
+   /* Only what was decoded is cached: another folder of the zeroed
+    * copy still has to be decoded, and cannot be.  A CRC error instead
+    * would mean it was handed some other folder's bytes. */
+   res = test_extract_one(zeroed, len, 2, &got, &got_len);
+   sprintf(detail, "res %d", res);
+   check(res == R7Z_ERROR_DATA, "folder 1 of the copy is not cached",
+         detail);
+   free(got);
+
+   r7z_archive_cache_deinit();
+
+   test_free_all(serial);
+   free(zeroed);
+   free(buf);
+
+   printf("\n%d checks, %d failures\n", checks, failures);
+   return failures ? 1 : 0;
+}
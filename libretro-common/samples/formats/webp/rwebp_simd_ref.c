@@ -0,0 +1,69 @@
+/* The scalar half of rwebp_simd_test.
+ *
+ * rwebp.c picks its lossless transform and alpha kernels at compile
+ * time, so the scalar ones only exist in a build made with
+ * RWEBP_NO_SIMD.  This file is that build: it includes the decoder with
+ * the vector paths off and hands its kernels, and its whole-image
+ * decode, out under scalar_* names for the test to hold against the
+ * vector ones it includes itself.
+ *
+ * The decoder's entry points are renamed on the way in; otherwise they
+ * would be defined twice in one link.  rvp8.c is linked once and shared
+ * by both sides: its own vector paths are not what is under test. */
+
+#ifndef RWEBP_NO_SIMD
+#define RWEBP_NO_SIMD
+#endif
+
+#define rwebp_process_image        scalar_rwebp_process_image
+#define rwebp_still_ready          scalar_rwebp_still_ready
+#define rwebp_set_buf_ptr          scalar_rwebp_set_buf_ptr
+#define rwebp_free                 scalar_rwebp_free
+#define rwebp_alloc                scalar_rwebp_alloc
+#define rwebp_anim_decode          scalar_rwebp_anim_decode
+#define rwebp_anim_free            scalar_rwebp_anim_free
+#define rwebp_anim_num_frames      scalar_rwebp_anim_num_frames
+#define rwebp_anim_get_info        scalar_rwebp_anim_get_info
+#define rwebp_anim_get_frame       scalar_rwebp_anim_get_frame
+#define rwebp_anim_stream_open     scalar_rwebp_anim_stream_open
+#define rwebp_anim_stream_close    scalar_rwebp_anim_stream_close
+#define rwebp_anim_stream_get_info scalar_rwebp_anim_stream_get_info
+#define rwebp_anim_stream_next     scalar_rwebp_anim_stream_next
+#define rwebp_anim_stream_rewind   scalar_rwebp_anim_stream_rewind
+#define rwebp_anim_stream_set_argb scalar_rwebp_anim_stream_set_argb
+
+#include "../../../formats/webp/rwebp.c"
+
+#include "rwebp_simd_ref.h"
+
+uint32_t *scalar_rwebp_do(const uint8_t *buf, size_t len,
+      unsigned *w, unsigned *h, bool rgba)
+{
+   return rwebp_do(buf, len, w, h, rgba);
+}
+
+void scalar_pred_run(int m, uint32_t *cur, const uint32_t *upper, int n)
+{
+   vl_pred_run(m, cur, upper, n);
+}
+
+void scalar_add_green(uint32_t *p, int n)
+{
+   vl_add_green(p, n);
+}
+
+void scalar_color_run(uint32_t td, uint32_t *p, int n)
+{
+   vl_color_run(td, p, n);
+}
+
+void scalar_alph_unfilter_row(int filter, const uint8_t *prev,
+      uint8_t *row, int width)
+{
+   alph_unfilter_row(filter, prev, row, width);
+}
+
+void scalar_alph_merge(uint32_t *pix, const uint8_t *a, size_t n)
+{
+   alph_merge(pix, a, n);
+}
@@ -0,0 +1,21 @@
+#ifndef RWEBP_SIMD_REF_H
+#define RWEBP_SIMD_REF_H
+
+/* rwebp.c's kernels and still-image decode as built with RWEBP_NO_SIMD;
+ * see rwebp_simd_ref.c. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <boolean.h>
+
+uint32_t *scalar_rwebp_do(const uint8_t *buf, size_t len,
+      unsigned *w, unsigned *h, bool rgba);
+void scalar_pred_run(int m, uint32_t *cur, const uint32_t *upper, int n);
+void scalar_add_green(uint32_t *p, int n);
+void scalar_color_run(uint32_t td, uint32_t *p, int n);
+void scalar_alph_unfilter_row(int filter, const uint8_t *prev,
+      uint8_t *row, int width);
+void scalar_alph_merge(uint32_t *pix, const uint8_t *a, size_t n);
+
+#endif
@@ -0,0 +1,523 @@
+/* rwebp's vector paths against its scalar ones, on whole images and on
+ * random input to each kernel.
+ *
+ * rwebp.c carries SSE2 and NEON versions of the lossless inverse
+ * transforms (predictor, cross-colour and subtract-green), of the ALPH
+ * chunk's vertical unfilter and green extraction, and of the merge that
+ * lays a decoded alpha plane over the lossy pixels, all chosen at
+ * compile time and all meant to be bit-exact with the scalar code.  The
+ * predictor in particular feeds each output pixel into the next, so a
+ * difference in one mode spreads down and right across the image.  This
+ * checks both builds two ways:
+ *
+ *  - Whole images, decoded by each side in both channel orders and held
+ *    against each other and against the source pixels, which are
+ *    regenerated here (test_px) since every fixture is lossless where it
+ *    matters:
+ *
+ *      lossless_rgb.webp   128x96 VP8L.  Uses all three transforms and
+ *                          every one of the 14 predictor modes.
+ *      lossless_rgba.webp  99x61 VP8L with alpha, kept exactly; an odd
+ *                          width, so every row ends in a scalar tail.
+ *      lossy_alpha.webp    256x256 VP8 with a VP8L-compressed ALPH
+ *                          chunk.  At RWEBP_ALPH_THREAD_MIN, so its alpha
+ *                          plane is decoded on a thread of its own beside
+ *                          the VP8 planes.  Only the alpha is checked
+ *                          against the source.
+ *
+ *    The fixtures are test_px's images written by Pillow's WebP encoder
+ *    (libwebp 1.6): lossless=True, quality=100, method=6, with exact=True
+ *    for the alpha one; and lossless=False, quality=10,
+ *    alpha_quality=100, method=4.  libwebp picks no ALPH filter for that
+ *    last one, so the horizontal, vertical and gradient filters are
+ *    covered by splicing a raw, filtered copy of the source alpha into
+ *    it in place of its own ALPH chunk.
+ *
+ *  - Each kernel on random input: every predictor mode and the two
+ *    pointwise transforms at run lengths 1..40, the unfilters with and
+ *    without a row above and the merge at widths 1..70, so each vector
+ *    width and the scalar tail are all reached.
+ *
+ * The vector side is the decoder included here; the scalar side is the
+ * same source built with RWEBP_NO_SIMD in rwebp_simd_ref.c.  Kernel
+ * buffers are allocated at exactly the size a kernel may touch, so a
+ * sanitizer build also catches a vector load or store past the end.
+ * Run from this directory; exits non-zero if anything differs.
+ *
+ * "make SIMD=0" builds both sides scalar, which passes trivially; the
+ * point of the test is the default build.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../../formats/webp/rwebp.c"
+
+#include "rwebp_simd_ref.h"
+
+#define TEST_KERNEL_ROUNDS 20
+
+static unsigned test_core_queries;
+
+/* Stands in for features_cpu.c, which is not linked: rwebp only starts
+ * the alpha thread when it is told there is a core to spare, and the
+ * machine running this may have one. */
+unsigned cpu_features_get_core_amount(void)
+{
+   test_core_queries++;
+   return 2;
+}
+
+static uint64_t test_rs = 1;
+
+static long test_rnd(long lo, long hi)
+{
+   test_rs = test_rs * 6364136223846793005ULL + 1442695040888963407ULL;
+   return lo + (long)((test_rs >> 33) % (uint64_t)(hi - lo + 1));
+}
+
+static uint32_t test_word(void)
+{
+   return ((uint32_t)test_rnd(0, 0xFFFF) << 16) | (uint32_t)test_rnd(0, 0xFFFF);
+}
+
+static void test_fill8(uint8_t *p, size_t n)
+{
+   size_t i;
+   for (i = 0; i < n; i++)
+      p[i] = (uint8_t)test_rnd(0, 255);
+}
+
+static void test_fill32(uint32_t *p, size_t n)
+{
+   size_t i;
+   for (i = 0; i < n; i++)
+      p[i] = test_word();
+}
+
+/* The fixtures' source image: four kinds of 32x32 region (correlated
+ * channels, the same with noise, plain ramps, and noise), so the
+ * encoder finds a use for each transform and predictor mode. */
+static void test_px(unsigned x, unsigned y, unsigned s, uint8_t *px)
+{
+   uint32_t n   = (x * 73856093u) ^ (y * 19349663u) ^ (s * 83492791u);
+   unsigned reg = ((x >> 5) + (y >> 5) + s) & 3;
+   unsigned l   = (x * 3 + y * 2) & 255;
+   unsigned d;
+
+   n = (n ^ (n >> 13)) * 1274126177u;
+   n = n ^ (n >> 16);
+   switch (reg)
+   {
+      case 0:
+         px[0] = (uint8_t)l;
+         px[1] = (uint8_t)(l + 16);
+         px[2] = (uint8_t)(l + 40);
+         break;
+      case 1:
+         d     = n & 31;
+         px[0] = (uint8_t)(l + d);
+         px[1] = (uint8_t)(l + d + 8);
+         px[2] = (uint8_t)(l + d - 8);
+         break;
+      case 2:
+         px[0] = (uint8_t)(x * 4);
+         px[1] = (uint8_t)(y * 4);
+         px[2] = (uint8_t)((x + y) * 2);
+         break;
+      default:
+         px[0] = (uint8_t)(n >> 8);
+         px[1] = (uint8_t)(n >> 16);
+         px[2] = (uint8_t)(n >> 24);
+         break;
+   }
+   px[3] = (uint8_t)(x * 2 + y * 3 + (reg == 1 ? (n >> 12) & 7 : 0));
+}
+
+static uint8_t *test_load(const char *path, size_t *len)
+{
+   FILE    *f = fopen(path, "rb");
+   uint8_t *buf;
+   long     n;
+
+   if (!f)
+      return NULL;
+   fseek(f, 0, SEEK_END);
+   n = ftell(f);
+   fseek(f, 0, SEEK_SET);
+   buf = (uint8_t*)malloc(n > 0 ? (size_t)n : 1);
+   if (n <= 0 || fread(buf, 1, (size_t)n, f) != (size_t)n)
+   {
+      free(buf);
+      buf = NULL;
+   }
+   fclose(f);
+   *len = (size_t)n;
+   return buf;
+}
+
+#define TEST_ALPHA_ONLY 1
+#define TEST_OPAQUE     2
+
+/* Decodes buf on both sides in both channel orders; they must agree with
+ * each other and with test_px(seed), all of it or (TEST_ALPHA_ONLY) just
+ * its alpha. */
+static int test_decode(const char *what, const uint8_t *buf, size_t len,
+      unsigned seed, unsigned ew, unsigned eh, int flags)
+{
+   int order;
+
+   for (order = 0; order < 2; order++)
+   {
+      bool      rgba = order == 0;
+      unsigned  w = 0, h = 0, rw = 0, rh = 0, x, y;
+      uint32_t *got  = rwebp_do(buf, len, &w, &h, rgba);
+      uint32_t *want = scalar_rwebp_do(buf, len, &rw, &rh, rgba);
+      const char *err = NULL;
+
+      if (!got || !want)
+         err = "did not decode";
+      else if (w != ew || h != eh || rw != ew || rh != eh)
+         err = "decoded at the wrong size";
+      else if (memcmp(got, want, (size_t)w * h * sizeof(*got)))
+         err = "vector and scalar pixels differ";
+      else
+      {
+         for (y = 0; y < h && !err; y++)
+            for (x = 0; x < w && !err; x++)
+            {
+               uint8_t  p[4];
+               uint32_t e, mask = 0xFFFFFFFFu;
+
+               test_px(x, y, seed, p);
+               if (flags & TEST_OPAQUE)
+                  p[3] = 0xFF;
+               if (rgba)
+                  e = (uint32_t)p[0] | ((uint32_t)p[1] << 8)
+                    | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+               else
+                  e = ((uint32_t)p[3] << 24) | ((uint32_t)p[0] << 16)
+                    | ((uint32_t)p[1] << 8) | (uint32_t)p[2];
+               if (flags & TEST_ALPHA_ONLY)
+                  mask = 0xFF000000u;
+               if ((got[(size_t)y * w + x] & mask) != (e & mask))
+               {
+                  printf("FAIL: %s (%s): pixel %u,%u is %08x, not %08x\n",
+                        what, rgba ? "RGBA" : "ARGB", x, y,
+                        (unsigned)(got[(size_t)y * w + x] & mask),
+                        (unsigned)(e & mask));
+                  err = "";
+               }
+            }
+      }
+
+      free(got);
+      free(want);
+      if (err)
+      {
+         if (*err)
+            printf("FAIL: %s (%s): %s\n", what, rgba ? "RGBA" : "ARGB", err);
+         return 1;
+      }
+   }
+   printf("ok:   %s, %ux%u, both channel orders\n", what, ew, eh);
+   return 0;
+}
+
+static int test_lossless(void)
+{
+   static const struct
+   {
+      const char *file;
+      unsigned    seed, w, h;
+      int         flags;
+   } t[] = {
+      { "lossless_rgb.webp",  1, 128, 96, TEST_OPAQUE },
+      { "lossless_rgba.webp", 2,  99, 61, 0           },
+   };
+   int    fails = 0;
+   size_t i;
+
+   for (i = 0; i < sizeof(t) / sizeof(t[0]); i++)
+   {
+      size_t   len;
+      uint8_t *buf = test_load(t[i].file, &len);
+
+      if (!buf)
+      {
+         printf("FAIL: cannot read %s\n", t[i].file);
+         fails++;
+         continue;
+      }
+      fails += test_decode(t[i].file, buf, len, t[i].seed,
+            t[i].w, t[i].h, t[i].flags);
+      free(buf);
+   }
+   return fails;
+}
+
+/* The ALPH filters' prediction of a[x] in a plane of width w, per the
+ * container spec; the pixels left of and above it are the source's,
+ * which is what a lossless decode reconstructs. */
+static int test_alph_pred(int filter, const uint8_t *a, unsigned w,
+      unsigned x, unsigned y)
+{
+   const uint8_t *p = a + (size_t)y * w + x;
+
+   if (y == 0)
+      return x ? p[-1] : 0;
+   if (x == 0 || filter == 2)
+      return p[-(long)w];
+   if (filter == 1)
+      return p[-1];
+   return alph_grad(p[-1], p[-(long)w], p[-(long)w - 1]);
+}
+
+/* Copies the chunks of src to a new RIFF, with alph (n bytes) in place
+ * of its ALPH chunk's payload. */
+static uint8_t *test_splice(const uint8_t *src, size_t len,
+      const uint8_t *alph, size_t n, size_t *out_len)
+{
+   uint8_t *out = (uint8_t*)malloc(len + n + 8);
+   size_t   p, o = 12;
+
+   memcpy(out, src, 12);
+   for (p = 12; p + 8 <= len; )
+   {
+      uint32_t sz  = rw32(src + p + 4);
+      size_t   adv = 8 + ((sz + 1) & ~(size_t)1);
+
+      if (rw32(src + p) == RW_CC('A','L','P','H'))
+      {
+         memcpy(out + o, src + p, 4);
+         out[o + 4] = (uint8_t)n;
+         out[o + 5] = (uint8_t)(n >> 8);
+         out[o + 6] = (uint8_t)(n >> 16);
+         out[o + 7] = (uint8_t)(n >> 24);
+         memcpy(out + o + 8, alph, n);
+         o += 8 + n;
+         if (n & 1)
+            out[o++] = 0;
+      }
+      else
+      {
+         memcpy(out + o, src + p, adv);
+         o += adv;
+      }
+      p += adv;
+   }
+   out[4] = (uint8_t)(o - 8);
+   out[5] = (uint8_t)((o - 8) >> 8);
+   out[6] = (uint8_t)((o - 8) >> 16);
+   out[7] = (uint8_t)((o - 8) >> 24);
+   *out_len = o;
+   return out;
+}
+
+static int test_lossy_alpha(void)
+{
+   static const char *names[] = { NULL,
+      "lossy_alpha.webp, raw ALPH, horizontal filter",
+      "lossy_alpha.webp, raw ALPH, vertical filter",
+      "lossy_alpha.webp, raw ALPH, gradient filter" };
+   const unsigned w = 256, h = 256, seed = 3;
+   size_t   len, n = (size_t)w * h;
+   uint8_t *buf  = test_load("lossy_alpha.webp", &len);
+   uint8_t *src, *alph;
+   unsigned x, y;
+   int      filter, fails;
+
+   if (!buf)
+   {
+      printf("FAIL: cannot read lossy_alpha.webp\n");
+      return 1;
+   }
+   fails = test_decode("lossy_alpha.webp", buf, len, seed, w, h,
+         TEST_ALPHA_ONLY);
+   if (!test_core_queries)
+   {
+      printf("FAIL: lossy_alpha.webp did not take the threaded alpha path\n");
+      fails++;
+   }
+
+   src  = (uint8_t*)malloc(n);
+   alph = (uint8_t*)malloc(n + 1);
+   for (y = 0; y < h; y++)
+      for (x = 0; x < w; x++)
+      {
+         uint8_t p[4];
+         test_px(x, y, seed, p);
+         src[(size_t)y * w + x] = p[3];
+      }
+   for (filter = 1; filter <= 3; filter++)
+   {
+      size_t   slen;
+      uint8_t *spliced;
+
+      alph[0] = (uint8_t)(filter << 2); /* raw, no pre-processing */
+      for (y = 0; y < h; y++)
+         for (x = 0; x < w; x++)
+            alph[1 + (size_t)y * w + x] = (uint8_t)(src[(size_t)y * w + x]
+                  - test_alph_pred(filter, src, w, x, y));
+      spliced = test_splice(buf, len, alph, n + 1, &slen);
+      fails  += test_decode(names[filter], spliced, slen, seed, w, h,
+            TEST_ALPHA_ONLY);
+      free(spliced);
+   }
+
+   free(alph);
+   free(src);
+   free(buf);
+   return fails;
+}
+
+static int test_pred_kernel(void)
+{
+   int m, n, r;
+
+   for (m = 0; m < 14; m++)
+      for (n = 1; n <= 40; n++)
+         for (r = 0; r < TEST_KERNEL_ROUNDS; r++)
+         {
+            /* the row above and the current row, each with its column 0
+             * ahead of the run, laid out as in the decoder's buffer */
+            size_t    words = 2 * (size_t)(n + 1);
+            uint32_t *got   = (uint32_t*)malloc(words * sizeof(*got));
+            uint32_t *want  = (uint32_t*)malloc(words * sizeof(*want));
+            int       bad;
+
+            test_fill32(got, words);
+            memcpy(want, got, words * sizeof(*got));
+            vl_pred_run(m, got + n + 2, got + 1, n);
+            scalar_pred_run(m, want + n + 2, want + 1, n);
+            bad = memcmp(got, want, words * sizeof(*got)) != 0;
+            free(got);
+            free(want);
+            if (bad)
+            {
+               printf("FAIL: predictor mode %d differs at length %d\n", m, n);
+               return 1;
+            }
+         }
+   printf("ok:   predictor modes 0..13, lengths 1..40\n");
+   return 0;
+}
+
+static int test_point_kernels(void)
+{
+   int n, r;
+
+   for (n = 1; n <= 40; n++)
+      for (r = 0; r < TEST_KERNEL_ROUNDS; r++)
+      {
+         uint32_t *got  = (uint32_t*)malloc(n * sizeof(*got));
+         uint32_t *want = (uint32_t*)malloc(n * sizeof(*want));
+         uint32_t  td   = test_word();
+         const char *bad = NULL;
+
+         test_fill32(got, n);
+         memcpy(want, got, n * sizeof(*got));
+         vl_add_green(got, n);
+         scalar_add_green(want, n);
+         if (memcmp(got, want, n * sizeof(*got)))
+            bad = "subtract-green";
+         else
+         {
+            vl_color_run(td, got, n);
+            scalar_color_run(td, want, n);
+            if (memcmp(got, want, n * sizeof(*got)))
+               bad = "cross-colour";
+         }
+         free(got);
+         free(want);
+         if (bad)
+         {
+            printf("FAIL: %s differs at length %d\n", bad, n);
+            return 1;
+         }
+      }
+   printf("ok:   subtract-green and cross-colour, lengths 1..40\n");
+   return 0;
+}
+
+static int test_alpha_kernels(void)
+{
+   int w, r, filter;
+
+   for (w = 1; w <= 70; w++)
+      for (r = 0; r < TEST_KERNEL_ROUNDS; r++)
+      {
+         uint8_t  *prev = (uint8_t*)malloc(w);
+         uint8_t  *row  = (uint8_t*)malloc(w);
+         uint8_t  *got  = (uint8_t*)malloc(w);
+         uint8_t  *want = (uint8_t*)malloc(w);
+         uint32_t *pg   = (uint32_t*)malloc(w * sizeof(*pg));
+         uint32_t *pw   = (uint32_t*)malloc(w * sizeof(*pw));
+         const char *bad = NULL;
+
+         test_fill8(prev, w);
+         test_fill8(row, w);
+         for (filter = 0; filter <= 3 && !bad; filter++)
+         {
+            int above;
+            for (above = 0; above < 2 && !bad; above++)
+            {
+               memcpy(got,  row, w);
+               memcpy(want, row, w);
+               alph_unfilter_row(filter, above ? prev : NULL, got, w);
+               scalar_alph_unfilter_row(filter, above ? prev : NULL,
+                     want, w);
+               if (memcmp(got, want, w))
+                  bad = "alpha unfilter";
+            }
+         }
+
+         if (!bad)
+         {
+            test_fill32(pg, w);
+            memcpy(pw, pg, w * sizeof(*pg));
+            alph_merge(pg, row, w);
+            scalar_alph_merge(pw, row, w);
+            if (memcmp(pg, pw, w * sizeof(*pg)))
+               bad = "alpha merge";
+         }
+
+         free(prev);
+         free(row);
+         free(got);
+         free(want);
+         free(pg);
+         free(pw);
+         if (bad)
+         {
+            printf("FAIL: %s differs at width %d\n", bad, w);
+            return 1;
+         }
+      }
+   printf("ok:   alpha unfilters and merge, widths 1..70\n");
+   return 0;
+}
+
+int main(void)
+{
+   int fails = 0;
+
+#if defined(RWEBP_VL_SSE2)
+   printf("rwebp kernel path: SSE2\n");
+#elif defined(RWEBP_VL_NEON)
+   printf("rwebp kernel path: NEON\n");
+#else
+   printf("rwebp kernel path: scalar (nothing to compare)\n");
+#endif
+
+   fails += test_lossless();
+   fails += test_lossy_alpha();
+   fails += test_pred_kernel();
+   fails += test_point_kernels();
+   fails += test_alpha_kernels();
+
+   if (fails)
+      printf("%d check(s) failed\n", fails);
+   return fails ? 1 : 0;
+}
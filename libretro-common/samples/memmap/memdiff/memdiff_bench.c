@@ -0,0 +1,205 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------
+ * The following license statement only applies to this file (memdiff_bench.c).
+ * ---------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Microbenchmark for memdiff_first(), in the shapes its callers use it.
+ *
+ *   autosave   - the autosave thread's scan of save RAM for changed
+ *                4 KiB blocks, with one byte changed: memdiff_first()
+ *                skipping between changes, against a memcmp() per
+ *                block and the size_t word loop it used to be.
+ *   rewind     - the state manager's patch builder finding each
+ *                changed run of a 1 MiB state, a few bytes changed
+ *                every 16 KiB: memdiff_first(), against a word loop.
+ *   netplay    - netplay's per-page "has this 4 KiB page of the state
+ *                changed" test, on an unchanged page: memcmp(), which
+ *                netplay keeps, against memdiff_first() == len.
+ *
+ * Each figure is the best of five runs.  Each runs with AVX2 withheld (SSE2 on x86) and, where the CPU has
+ * it, allowed; the sample answers cpu_features_get() itself.
+ *
+ * Build:  make
+ * Run:    ./memdiff_bench */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <boolean.h>
+#include <libretro.h>
+#include <memdiff.h>
+#include <features/features_cpu.h>
+
+#define BLOCK 4096
+
+static uint64_t cpu_mask = 0;
+/* Keeps the compiler from dropping a result nothing reads */
+static volatile size_t sink;
+
+uint64_t cpu_features_get(void) { return cpu_mask; }
+
+static double now_us(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static size_t word_loop(const uint8_t *a, const uint8_t *b, size_t len)
+{
+   const size_t *a_w = (const size_t*)(const void*)a;
+   const size_t *b_w = (const size_t*)(const void*)b;
+   size_t i, n       = len / sizeof(size_t);
+   for (i = 0; i < n; i++)
+      if (a_w[i] != b_w[i])
+         break;
+   i *= sizeof(size_t);
+   while (i < len && a[i] == b[i])
+      i++;
+   return i;
+}
+
+/* Blocks of @len that differ, found three ways */
+static size_t scan_blocks_memcmp(const uint8_t *a, const uint8_t *b,
+      size_t len)
+{
+   size_t off, n = 0;
+   for (off = 0; off < len; off += BLOCK)
+      n += memcmp(a + off, b + off,
+            len - off < BLOCK ? len - off : BLOCK) != 0;
+   return n;
+}
+
+static size_t scan_blocks(const uint8_t *a, const uint8_t *b, size_t len,
+      size_t (*first)(const uint8_t*, const uint8_t*, size_t))
+{
+   size_t off = 0, n = 0;
+   while ((off += first(a + off, b + off, len - off)) < len)
+   {
+      off = (off / BLOCK + 1) * BLOCK;
+      n++;
+   }
+   return n;
+}
+
+static size_t memdiff_u8(const uint8_t *a, const uint8_t *b, size_t len)
+{
+   return memdiff_first(a, b, len);
+}
+
+/* Runs of the state that differ; the changed bytes are single */
+static size_t scan_runs(const uint8_t *a, const uint8_t *b, size_t len,
+      size_t (*first)(const uint8_t*, const uint8_t*, size_t))
+{
+   size_t off = 0, n = 0;
+   while ((off += first(a + off, b + off, len - off)) < len)
+   {
+      off++;
+      n++;
+   }
+   return n;
+}
+
+static void report(const char *lane, const char *how, size_t bytes,
+      unsigned iters, double us)
+{
+   printf("  %-9s %-22s %10.2f us/call %8.2f GB/s\n", lane, how,
+         us / iters, (double)bytes * iters / (us * 1e3));
+}
+
+/* Best of five, which on a busy machine is the one least disturbed */
+#define TIME(lane, how, bytes, iters, expr) \
+   do { \
+      unsigned _i, _r; \
+      double _best = 0; \
+      for (_r = 0; _r < 5; _r++) \
+      { \
+         double _t = now_us(); \
+         for (_i = 0; _i < (iters); _i++) \
+            sink = (expr); \
+         _t = now_us() - _t; \
+         if (!_r || _t < _best) \
+            _best = _t; \
+      } \
+      report(lane, how, bytes, iters, _best); \
+   } while (0)
+
+static void run(const char *name)
+{
+   static const size_t sram_sizes[] = { 256 << 10, 8 << 20 };
+   const size_t state_len           = 1 << 20;
+   uint8_t *a                       = (uint8_t*)malloc(8 << 20);
+   uint8_t *b                       = (uint8_t*)malloc(8 << 20);
+   size_t i;
+
+   printf("%s:\n", name);
+   for (i = 0; i < (8u << 20); i++)
+      a[i] = b[i] = (uint8_t)(i * 31);
+
+   for (i = 0; i < 2; i++)
+   {
+      size_t len     = sram_sizes[i];
+      unsigned iters = len > (1u << 20) ? 50 : 2000;
+      char lane[16];
+      snprintf(lane, sizeof(lane), "autosave%s", i ? "8M" : "");
+      b[len / 2] ^= 1;
+      TIME(lane, "memdiff skip", len, iters,
+            scan_blocks(a, b, len, memdiff_u8));
+      TIME(lane, "memcmp per block", len, iters,
+            scan_blocks_memcmp(a, b, len));
+      TIME(lane, "word loop skip", len, iters,
+            scan_blocks(a, b, len, word_loop));
+      b[len / 2] ^= 1;
+   }
+
+   for (i = 7; i < state_len; i += 16 << 10)
+      b[i] ^= 0x40;
+   TIME("rewind", "memdiff", state_len, 500,
+         scan_runs(a, b, state_len, memdiff_u8));
+   TIME("rewind", "word loop", state_len, 500,
+         scan_runs(a, b, state_len, word_loop));
+   for (i = 7; i < state_len; i += 16 << 10)
+      b[i] ^= 0x40;
+
+   TIME("netplay", "memcmp", BLOCK, 200000,
+         (size_t)(memcmp(a + BLOCK, b + BLOCK, BLOCK) != 0));
+   TIME("netplay", "memdiff == len", BLOCK, 200000,
+         (size_t)(memdiff_first(a + BLOCK, b + BLOCK, BLOCK) != BLOCK));
+
+   free(a);
+   free(b);
+}
+
+int main(void)
+{
+   cpu_mask = 0;
+   run("baseline (SSE2 on x86)");
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__i386__) || defined(__x86_64__))
+   if (__builtin_cpu_supports("avx2"))
+   {
+      cpu_mask = RETRO_SIMD_AVX2;
+      run("avx2");
+   }
+#endif
+   return 0;
+}
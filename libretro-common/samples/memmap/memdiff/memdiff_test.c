@@ -0,0 +1,178 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------
+ * The following license statement only applies to this file (memdiff_test.c).
+ * ---------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Oracle for memdiff_first().
+ *
+ * Against a byte loop, at every length up to a few vectors, every
+ * position of the first difference (and none), and the mutual
+ * alignments that pick different paths through the scanners: both
+ * aligned, both off by the same amount, off by different amounts.
+ * Each buffer ends where its allocation does, so a scanner reading a
+ * byte past @len is an ASan report (make SANITIZER=address).
+ *
+ * The test answers cpu_features_get() itself, so it runs each x86
+ * scanner the dispatch can pick: AVX2 where this CPU has it, and SSE2
+ * with AVX2 withheld.  Elsewhere both passes take the one path there
+ * is. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <boolean.h>
+#include <libretro.h>
+#include <memdiff.h>
+#include <features/features_cpu.h>
+
+static uint64_t cpu_mask = 0;
+static unsigned failures = 0;
+
+uint64_t cpu_features_get(void) { return cpu_mask; }
+
+static bool have_avx2(void)
+{
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__i386__) || defined(__x86_64__))
+   return __builtin_cpu_supports("avx2");
+#else
+   return false;
+#endif
+}
+
+static size_t reference(const uint8_t *a, const uint8_t *b, size_t len)
+{
+   size_t i = 0;
+   while (i < len && a[i] == b[i])
+      i++;
+   return i;
+}
+
+/* @a and @b end at the end of their allocations */
+static void check(const uint8_t *a, const uint8_t *b, size_t len,
+      const char *what)
+{
+   size_t want = reference(a, b, len);
+   size_t got  = memdiff_first(a, b, len);
+   if (got != want)
+   {
+      if (failures++ < 10)
+         fprintf(stderr, "FAIL %s: len %u, got %u, want %u\n", what,
+               (unsigned)len, (unsigned)got, (unsigned)want);
+   }
+}
+
+static void pass_small(const char *name)
+{
+   static const unsigned shifts[][2] = {
+      {0, 0}, {1, 1}, {3, 3}, {0, 1}, {1, 0}, {5, 2}, {7, 8}, {8, 0} };
+   unsigned had = failures;
+   size_t len, s, d;
+
+   for (len = 0; len <= 200; len++)
+   {
+      for (s = 0; s < sizeof(shifts) / sizeof(shifts[0]); s++)
+      {
+         uint8_t *a_buf = (uint8_t*)malloc(len + shifts[s][0] + 1);
+         uint8_t *b_buf = (uint8_t*)malloc(len + shifts[s][1] + 1);
+         /* Offsets from malloc's alignment, ending flush with it */
+         uint8_t *a     = a_buf + shifts[s][0] + 1;
+         uint8_t *b     = b_buf + shifts[s][1] + 1;
+
+         for (d = 0; d < len; d++)
+            a[d] = b[d] = (uint8_t)(d * 7 + 1);
+         check(a, b, len, name);
+
+         /* Each position in turn the first difference, with another
+          * after it the scanner must not report instead */
+         for (d = 0; d < len; d++)
+         {
+            b[d] ^= 0x80;
+            if (d + 1 < len)
+               b[len - 1] ^= 0x01;
+            check(a, b, len, name);
+            if (d + 1 < len)
+               b[len - 1] ^= 0x01;
+            b[d] ^= 0x80;
+         }
+
+         free(a_buf);
+         free(b_buf);
+      }
+   }
+
+   if (failures == had)
+      fprintf(stderr, "[pass] %s: lengths 0..200, all positions\n", name);
+}
+
+static void pass_large(const char *name)
+{
+   const size_t len = 1 << 20;
+   uint8_t *a       = (uint8_t*)malloc(len);
+   uint8_t *b       = (uint8_t*)malloc(len);
+   unsigned had     = failures;
+   static const size_t at[] = {
+      0, 31, 32, 63, 64, 65, 4095, 4096, 65537, (1 << 20) - 33,
+      (1 << 20) - 1 };
+   size_t i;
+
+   for (i = 0; i < len; i++)
+      a[i] = b[i] = (uint8_t)(i ^ (i >> 8));
+   check(a, b, len, name);
+   check(a + 3, b + 3, len - 3, name);
+
+   for (i = 0; i < sizeof(at) / sizeof(at[0]); i++)
+   {
+      b[at[i]]++;
+      check(a, b, len, name);
+      check(a + 1, b + 1, len - 1, name);
+      b[at[i]]--;
+   }
+
+   free(a);
+   free(b);
+   if (failures == had)
+      fprintf(stderr, "[pass] %s: 1 MiB\n", name);
+}
+
+int main(void)
+{
+   cpu_mask = 0;
+   pass_small("baseline");
+   pass_large("baseline");
+
+   if (have_avx2())
+   {
+      cpu_mask = RETRO_SIMD_AVX2;
+      pass_small("avx2");
+      pass_large("avx2");
+   }
+   else
+      fprintf(stderr, "[skip] avx2: not on this CPU\n");
+
+   if (failures)
+   {
+      fprintf(stderr, "FAIL memdiff_test: %u failures\n", failures);
+      return 1;
+   }
+   fprintf(stderr, "PASS memdiff_test\n");
+   return 0;
+}
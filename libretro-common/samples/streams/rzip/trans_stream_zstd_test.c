@@ -0,0 +1,328 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (trans_stream_zstd_test.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Round-trip test for the zstd trans_stream backends
+ * (streams/trans_stream_zstd.c), which netplay compresses savestates
+ * and savestate deltas with.  This pins:
+ *
+ *  - each backend names the other as its reverse;
+ *  - compressible, incompressible and all-zero buffers, from one byte
+ *    to past a megabyte, come back byte for byte at both ends of the
+ *    level range, with rd and wn reporting the whole buffer;
+ *  - one pair of streams serves many buffers in turn, as netplay's
+ *    does for the whole session;
+ *  - a transcoding that is not flushed does nothing and asks for more;
+ *  - trans_stream_trans_full() creates the stream it is not given;
+ *  - an output buffer too small, a truncated frame and a corrupt one
+ *    are errors with nothing written, not short data.
+ *
+ * Build:  make            (SANITIZER=address,undefined for a checked run)
+ * Run:    ./trans_stream_zstd_test
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <boolean.h>
+#include <streams/trans_stream.h>
+#include <encodings/rzstd.h>
+
+#define MAX_SIZE (1024 * 1024 + 77)
+
+static int failures = 0;
+
+static void report(bool ok, const char *label)
+{
+   printf("[%s] %s\n", ok ? "SUCCESS" : "FAILED", label);
+   if (!ok)
+      failures++;
+}
+
+enum fill_kind
+{
+   FILL_RECORDS = 0,
+   FILL_RANDOM,
+   FILL_ZERO
+};
+
+static void fill(uint8_t *buf, size_t len, enum fill_kind kind)
+{
+   uint32_t seed = 0x12345678;
+   size_t i;
+   for (i = 0; i < len; i++)
+   {
+      seed = seed * 1103515245u + 12345u;
+      switch (kind)
+      {
+         case FILL_RECORDS:
+            buf[i] = (i % 16 < 12)
+                  ? (uint8_t)((i / 16) & 0x3F)
+                  : (uint8_t)(seed >> 24);
+            break;
+         case FILL_RANDOM:
+            buf[i] = (uint8_t)(seed >> 24);
+            break;
+         case FILL_ZERO:
+            buf[i] = 0;
+            break;
+      }
+   }
+}
+
+/* Compress @len bytes of @in with @c, decompress with @d, compare. */
+static bool round_trip(void *c, void *d, const uint8_t *in, size_t len,
+      uint8_t *z, size_t z_size, uint8_t *out, size_t *zlen)
+{
+   uint32_t rd = 0, wn = 0;
+   enum trans_stream_error err = TRANS_STREAM_ERROR_OTHER;
+
+   zstd_compress_backend.set_in(c, in, (uint32_t)len);
+   zstd_compress_backend.set_out(c, z, (uint32_t)z_size);
+   if (     !zstd_compress_backend.trans(c, true, &rd, &wn, &err)
+         || err != TRANS_STREAM_ERROR_NONE
+         || rd  != len
+         || !wn)
+      return false;
+   *zlen = wn;
+
+   memset(out, 0xA5, len);
+   err = TRANS_STREAM_ERROR_OTHER;
+   zstd_decompress_backend.set_in(d, z, wn);
+   zstd_decompress_backend.set_out(d, out, (uint32_t)len);
+   return zstd_decompress_backend.trans(d, true, &rd, &wn, &err)
+      && err == TRANS_STREAM_ERROR_NONE
+      && rd  == *zlen
+      && wn  == len
+      && !memcmp(in, out, len);
+}
+
+static void test_backends(void)
+{
+   report(trans_stream_get_zstd_compress_backend() == &zstd_compress_backend
+         && trans_stream_get_zstd_decompress_backend()
+            == &zstd_decompress_backend,
+         "getters return the backends");
+   report(zstd_compress_backend.reverse == &zstd_decompress_backend
+         && zstd_decompress_backend.reverse == &zstd_compress_backend,
+         "backends reverse each other");
+}
+
+static void test_round_trips(uint8_t *in, uint8_t *z, size_t z_size,
+      uint8_t *out)
+{
+   static const size_t sizes[]  = { 1, 100, 4096, 65536 + 7, MAX_SIZE };
+   static const uint32_t levels[] = { 1, 9 };
+   static const char *kinds[]   = { "records", "random", "zeros" };
+   char label[128];
+   size_t k, s, l;
+   void *c = zstd_compress_backend.stream_new();
+   void *d = zstd_decompress_backend.stream_new();
+
+   report(zstd_compress_backend.define(c, "level", 9)
+         && !zstd_compress_backend.define(c, "window", 1),
+         "level is the one property");
+
+   for (k = 0; k < 3; k++)
+   {
+      fill(in, MAX_SIZE, (enum fill_kind)k);
+      for (l = 0; l < 2; l++)
+      {
+         zstd_compress_backend.define(c, "level", levels[l]);
+         for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+         {
+            size_t zlen = 0;
+            bool ok     = round_trip(c, d, in, sizes[s], z, z_size, out,
+                  &zlen);
+            /* Records and zeros must actually shrink */
+            if (ok && k != FILL_RANDOM && sizes[s] >= 4096)
+               ok = zlen < sizes[s] / 2;
+            snprintf(label, sizeof(label),
+                  "%s, level %u, %u bytes (%u compressed)", kinds[k],
+                  (unsigned)levels[l], (unsigned)sizes[s], (unsigned)zlen);
+            report(ok, label);
+         }
+      }
+   }
+
+   zstd_compress_backend.stream_free(c);
+   zstd_decompress_backend.stream_free(d);
+}
+
+/* Netplay keeps one pair of streams and transcodes every state through
+ * them: each transcoding must stand alone. */
+static void test_reuse(uint8_t *in, uint8_t *z, size_t z_size, uint8_t *out)
+{
+   size_t i;
+   bool ok = true;
+   void *c = zstd_compress_backend.stream_new();
+   void *d = zstd_decompress_backend.stream_new();
+
+   fill(in, MAX_SIZE, FILL_RECORDS);
+   for (i = 0; i < 64 && ok; i++)
+   {
+      size_t zlen = 0;
+      size_t len  = 1 + (i * 7919) % 20000;
+      in[i * 31] ^= (uint8_t)i;
+      ok = round_trip(c, d, in + i * 13, len, z, z_size, out, &zlen);
+   }
+   report(ok, "one pair of streams, 64 buffers in turn");
+
+   zstd_compress_backend.stream_free(c);
+   zstd_decompress_backend.stream_free(d);
+}
+
+static void test_no_flush(uint8_t *in, uint8_t *z, size_t z_size)
+{
+   uint32_t rd = 1, wn = 1;
+   enum trans_stream_error err = TRANS_STREAM_ERROR_NONE;
+   void *c = zstd_compress_backend.stream_new();
+
+   fill(in, 4096, FILL_RECORDS);
+   zstd_compress_backend.set_in(c, in, 4096);
+   zstd_compress_backend.set_out(c, z, (uint32_t)z_size);
+   report(zstd_compress_backend.trans(c, false, &rd, &wn, &err)
+         && rd == 0 && wn == 0 && err == TRANS_STREAM_ERROR_AGAIN,
+         "unflushed transcoding waits");
+   report(zstd_compress_backend.trans(c, true, &rd, &wn, &err)
+         && rd == 4096 && wn > 0 && err == TRANS_STREAM_ERROR_NONE,
+         "then the flush does it all");
+
+   zstd_compress_backend.stream_free(c);
+}
+
+static void test_trans_full(uint8_t *in, uint8_t *z, size_t z_size,
+      uint8_t *out)
+{
+   uint32_t rd, zlen = 0;
+   void *c = NULL, *d = NULL;
+   void *s = zstd_compress_backend.stream_new();
+   uint8_t *ref = (uint8_t*)malloc(z_size);
+   enum trans_stream_error err = TRANS_STREAM_ERROR_OTHER;
+   bool ok;
+
+   /* The same input through a stream of our own, for the frame size
+    * trans_stream_trans_full() does not report */
+   fill(in, 65536, FILL_RECORDS);
+   zstd_compress_backend.set_in(s, in, 65536);
+   zstd_compress_backend.set_out(s, ref, (uint32_t)z_size);
+   zstd_compress_backend.trans(s, true, &rd, &zlen, NULL);
+
+   ok = trans_stream_trans_full(
+         (struct trans_stream_backend*)&zstd_compress_backend, &c,
+         in, 65536, z, (uint32_t)z_size, &err)
+      && c && err == TRANS_STREAM_ERROR_NONE
+      && zlen && !memcmp(z, ref, zlen);
+   ok = ok && trans_stream_trans_full(
+         (struct trans_stream_backend*)&zstd_decompress_backend, &d,
+         z, zlen, out, 65536, &err)
+      && d && !memcmp(in, out, 65536);
+   report(ok, "trans_stream_trans_full creates its streams");
+
+   if (c)
+      zstd_compress_backend.stream_free(c);
+   if (d)
+      zstd_decompress_backend.stream_free(d);
+   zstd_compress_backend.stream_free(s);
+   free(ref);
+}
+
+static void test_errors(uint8_t *in, uint8_t *z, size_t z_size,
+      uint8_t *out)
+{
+   uint32_t rd, wn, zlen;
+   enum trans_stream_error err;
+   void *c = zstd_compress_backend.stream_new();
+   void *d = zstd_decompress_backend.stream_new();
+
+   fill(in, 65536, FILL_RANDOM);
+
+   rd = wn = 1;
+   err = TRANS_STREAM_ERROR_NONE;
+   zstd_compress_backend.set_in(c, in, 65536);
+   zstd_compress_backend.set_out(c, z, 64);
+   report(!zstd_compress_backend.trans(c, true, &rd, &wn, &err)
+         && rd == 0 && wn == 0 && err == TRANS_STREAM_ERROR_INVALID,
+         "compress: output too small");
+
+   zstd_compress_backend.set_in(c, in, 65536);
+   zstd_compress_backend.set_out(c, z, (uint32_t)z_size);
+   zstd_compress_backend.trans(c, true, &rd, &zlen, &err);
+
+   rd = wn = 1;
+   err = TRANS_STREAM_ERROR_NONE;
+   zstd_decompress_backend.set_in(d, z, zlen);
+   zstd_decompress_backend.set_out(d, out, 65535);
+   report(!zstd_decompress_backend.trans(d, true, &rd, &wn, &err)
+         && wn == 0 && err == TRANS_STREAM_ERROR_INVALID,
+         "decompress: output too small");
+
+   rd = wn = 1;
+   err = TRANS_STREAM_ERROR_NONE;
+   zstd_decompress_backend.set_in(d, z, zlen - 1);
+   zstd_decompress_backend.set_out(d, out, 65536);
+   report(!zstd_decompress_backend.trans(d, true, &rd, &wn, &err)
+         && wn == 0 && err == TRANS_STREAM_ERROR_INVALID,
+         "decompress: truncated frame");
+
+   rd = wn = 1;
+   err = TRANS_STREAM_ERROR_NONE;
+   z[0] ^= 0xFF;
+   zstd_decompress_backend.set_in(d, z, zlen);
+   zstd_decompress_backend.set_out(d, out, 65536);
+   report(!zstd_decompress_backend.trans(d, true, &rd, &wn, &err)
+         && wn == 0 && err == TRANS_STREAM_ERROR_INVALID,
+         "decompress: bad magic");
+
+   zstd_compress_backend.stream_free(c);
+   zstd_decompress_backend.stream_free(d);
+}
+
+int main(void)
+{
+   size_t z_size = rzstd_compress_bound(MAX_SIZE);
+   uint8_t *in   = (uint8_t*)malloc(MAX_SIZE);
+   uint8_t *out  = (uint8_t*)malloc(MAX_SIZE);
+   uint8_t *z    = (uint8_t*)malloc(z_size);
+   if (!in || !out || !z)
+      return 1;
+
+   test_backends();
+   test_round_trips(in, z, z_size, out);
+   test_reuse(in, z, z_size, out);
+   test_no_flush(in, z, z_size);
+   test_trans_full(in, z, z_size, out);
+   test_errors(in, z, z_size, out);
+
+   free(in);
+   free(out);
+   free(z);
+
+   if (failures)
+   {
+      printf("\n%d test(s) failed\n", failures);
+      return 1;
+   }
+   printf("\nAll zstd trans_stream tests passed.\n");
+   return 0;
+}
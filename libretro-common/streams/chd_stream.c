@@ -41,6 +41,13 @@
 #define SUBCODE_SIZE 96
 #define TRACK_PAD 4
 
+#ifdef HAVE_RCHD
+/* Hunks rchd fetches ahead of a read and decodes on its workers while
+ * this reads the next one. A CD hunk is eight frames, so this keeps
+ * about 300 KiB per open track in flight. */
+#define CHDSTREAM_PIPELINE_DEPTH 8
+#endif
+
 struct chdstream
 {
 #ifdef HAVE_RCHD
@@ -415,6 +422,59 @@ static bool chdstream_pump(RFILE *f, rchd_t *chd, int opening,
    }
 }
 
+/* Supplies one whole request from the open file, in as many reads as
+ * it takes. */
+static bool chdstream_supply(RFILE *f, rchd_t *chd, const rchd_request_t *rq)
+{
+   static uint8_t buf[65536];
+   uint32_t       done = 0;
+
+   while (done < rq->length)
+   {
+      size_t want = rq->length - done;
+      size_t got;
+
+      if (want > sizeof(buf))
+         want = sizeof(buf);
+      if (filestream_seek(f, (int64_t)(rq->offset + done),
+               RETRO_VFS_SEEK_POSITION_START) < 0)
+         return false;
+      if (!(got = (size_t)filestream_read(f, buf, want)))
+         return false;
+      if (rchd_feed_at(chd, rq->offset + done, rq->source,
+               buf, got) != RCHD_OK)
+         return false;
+      done += (uint32_t)got;
+   }
+   return true;
+}
+
+/* Drives an armed read with the hunks ahead of it in flight: everything
+ * rchd reports is read before each step, so while its workers decode
+ * one hunk this is already reading the next, and a sequential read
+ * goes at the speed of the file rather than of the codec. */
+static bool chdstream_pump_read(RFILE *f, rchd_t *chd)
+{
+   rchd_request_t reqs[CHDSTREAM_PIPELINE_DEPTH];
+   rchd_request_t rq;
+
+   for (;;)
+   {
+      uint32_t n = rchd_read_pending(chd, reqs, CHDSTREAM_PIPELINE_DEPTH);
+      uint32_t i;
+      int      e;
+
+      for (i = 0; i < n; i++)
+         if (!chdstream_supply(f, chd, &reqs[i]))
+            return false;
+
+      if ((e = rchd_read_step(chd, &rq)) == RCHD_OK)
+         return true;
+      if (e != RCHD_PENDING || !chdstream_supply(f, chd, &rq))
+         return false;
+   }
+}
+
 /* The track the caller asked for. Track numbers are 1-based and need
  * not be contiguous, so this searches rather than indexes; the special
  * values match what the libchdr path accepted. */
@@ -496,6 +556,8 @@ chdstream_t *chdstream_open(const char *path, int32_t track)
       goto error;
    if (!(t = chdstream_track_of(chd, track)))
       goto error;
+   rchd_set_pipeline_depth(chd, CHDSTREAM_PIPELINE_DEPTH);
+   rchd_set_threads(chd, 0);
    if (!(stream = (chdstream_t*)malloc(sizeof(*stream))))
       goto error;
 
@@ -672,15 +734,11 @@ chdstream_load_hunk(chdstream_t *stream, uint32_t hunknum)
       return true;
 
 #ifdef HAVE_RCHD
-   {
-      rchd_request_t rq;
-
-      if (rchd_read_hunk_begin(stream->chd, hunknum,
-               stream->hunkmem) != RCHD_OK)
-         return false;
-      if (!chdstream_pump(stream->file, stream->chd, 0, &rq))
-         return false;
-   }
+   if (rchd_read_hunk_begin(stream->chd, hunknum,
+            stream->hunkmem) != RCHD_OK)
+      return false;
+   if (!chdstream_pump_read(stream->file, stream->chd))
+      return false;
 #else
    if (chd_read(stream->chd, hunknum, stream->hunkmem) != CHDERR_NONE)
       return false;
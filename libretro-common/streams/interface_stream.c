@@ -56,6 +56,8 @@ struct intfstream_internal
    struct
    {
       rzipstream_t *fp;
+      enum rzip_codec codec;
+      int level;
    } rzip;
 #endif
    struct
@@ -195,7 +197,8 @@ bool intfstream_open(intfstream_internal_t *intf, const char *path,
          break;
       case INTFSTREAM_RZIP:
 #if defined(HAVE_COMPRESSION)
-         intf->rzip.fp = rzipstream_open(path, mode);
+         intf->rzip.fp = rzipstream_open_codec(path, mode,
+               intf->rzip.codec, intf->rzip.level);
          if (!intf->rzip.fp)
             return false;
          break;
@@ -287,6 +290,8 @@ void *intfstream_init(intfstream_info_t *info)
 #endif
 #ifdef HAVE_COMPRESSION
    intf->rzip.fp         = NULL;
+   intf->rzip.codec      = RZIP_CODEC_DEFLATE;
+   intf->rzip.level      = 0;
 #endif
 
    switch (intf->type)
@@ -307,6 +312,10 @@ void *intfstream_init(intfstream_info_t *info)
       case INTFSTREAM_BUFFERED:
          break;   /* filled in by intfstream_open_buffered() */
       case INTFSTREAM_RZIP:
+#ifdef HAVE_COMPRESSION
+         intf->rzip.codec = (enum rzip_codec)info->rzip.codec;
+         intf->rzip.level = info->rzip.level;
+#endif
          break;
    }
 
@@ -1007,11 +1016,20 @@ intfstream_t *intfstream_open_chd_track(const char *path,
 
 intfstream_t* intfstream_open_rzip_file(const char *path,
       unsigned mode)
+{
+   /* RZIP_CODEC_DEFLATE, at its default level */
+   return intfstream_open_rzip_file_codec(path, mode, 0, 0);
+}
+
+intfstream_t* intfstream_open_rzip_file_codec(const char *path,
+      unsigned mode, unsigned codec, int level)
 {
    intfstream_info_t info;
    intfstream_t *fd = NULL;
 
    info.type        = INTFSTREAM_RZIP;
+   info.rzip.codec  = codec;
+   info.rzip.level  = level;
    fd               = (intfstream_t*)intfstream_init(&info);
 
    if (!fd)
@@ -33,8 +33,15 @@
 #include <features/features_cpu.h>
 #endif
 
-/* Current RZIP file format version */
-#define RZIP_VERSION 1
+#if defined(HAVE_ZSTD) || defined(HAVE_RZSTD)
+#define RZIP_HAVE_ZSTD
+#endif
+
+/* RZIP file format versions
+ * > The version byte also names the codec
+ *   every chunk of the file is compressed with */
+#define RZIP_VERSION_DEFLATE 1
+#define RZIP_VERSION_ZSTD    2
 
 /* Compression level
  * > zlib default of 6 provides the best
@@ -42,6 +49,12 @@
  *   compression speed */
 #define RZIP_COMPRESSION_LEVEL 6
 
+/* Default zstd level
+ * > Matches replay files. Against deflate at 6,
+ *   compresses and decompresses in a fraction of
+ *   the time, for files of about the same size */
+#define RZIP_ZSTD_COMPRESSION_LEVEL 3
+
 /* Default chunk size: 128kb */
 #define RZIP_DEFAULT_CHUNK_SIZE 131072
 
@@ -128,6 +141,8 @@ struct rzipstream
    uint32_t out_buf_ptr;
    uint32_t out_buf_occupancy;
    uint32_t chunk_size;
+   enum rzip_codec codec;
+   int level;
 #ifdef HAVE_THREADS
    rzip_par_t *par;
    bool par_attempted;
@@ -136,6 +151,32 @@ struct rzipstream
    bool is_writing;
 };
 
+/* Codec Functions */
+
+/* Returns the transform backend for 'codec' in the
+ * requested direction, or NULL if it is not built in */
+static const struct trans_stream_backend *rzipstream_get_backend(
+      enum rzip_codec codec, bool is_writing)
+{
+   switch (codec)
+   {
+      case RZIP_CODEC_DEFLATE:
+         return is_writing
+               ? trans_stream_get_zlib_deflate_backend()
+               : trans_stream_get_zlib_inflate_backend();
+#ifdef RZIP_HAVE_ZSTD
+      case RZIP_CODEC_ZSTD:
+         return is_writing
+               ? trans_stream_get_zstd_compress_backend()
+               : trans_stream_get_zstd_decompress_backend();
+#endif
+      default:
+         break;
+   }
+
+   return NULL;
+}
+
 /* Header Functions */
 
 /* Reads header information from RZIP file
@@ -167,14 +208,15 @@ static bool rzipstream_read_file_header(rzipstream_t *stream)
     * of header */
    if (
           (length       < RZIP_HEADER_SIZE)
-       || (header_bytes[0] !=           35)  /* # */
-       || (header_bytes[1] !=           82)  /* R */
-       || (header_bytes[2] !=           90)  /* Z */
-       || (header_bytes[3] !=           73)  /* I */
-       || (header_bytes[4] !=           80)  /* P */
-       || (header_bytes[5] !=          118)  /* v */
-       || (header_bytes[6] != RZIP_VERSION)  /* file format version number */
-       || (header_bytes[7] !=           35)) /* # */
+       || (header_bytes[0] !=  35)  /* # */
+       || (header_bytes[1] !=  82)  /* R */
+       || (header_bytes[2] !=  90)  /* Z */
+       || (header_bytes[3] !=  73)  /* I */
+       || (header_bytes[4] !=  80)  /* P */
+       || (header_bytes[5] != 118)  /* v */
+       || (   (header_bytes[6] != RZIP_VERSION_DEFLATE)
+           && (header_bytes[6] != RZIP_VERSION_ZSTD))
+       || (header_bytes[7] !=  35)) /* # */
    {
       /* Reset file to start */
       filestream_seek(stream->file, 0, SEEK_SET);
@@ -184,6 +226,20 @@ static bool rzipstream_read_file_header(rzipstream_t *stream)
       return true;
    }
 
+   /* Get codec from file format version number
+    * > A zstd file read by a build without zstd is
+    *   an error, not uncompressed data */
+   if (header_bytes[6] == RZIP_VERSION_ZSTD)
+   {
+#ifdef RZIP_HAVE_ZSTD
+      stream->codec = RZIP_CODEC_ZSTD;
+#else
+      return false;
+#endif
+   }
+   else
+      stream->codec = RZIP_CODEC_DEFLATE;
+
    /* Get uncompressed chunk size - next 4 bytes */
    if ((stream->chunk_size = (
                             (uint32_t)header_bytes[11] << 24)
@@ -231,14 +287,15 @@ static bool rzipstream_write_file_header(rzipstream_t *stream)
       header_bytes[i] = 0;
 
    /* > 'Magic numbers' - first 8 bytes */
-   header_bytes[0]    =        35;    /* # */
-   header_bytes[1]    =        82;    /* R */
-   header_bytes[2]    =        90;    /* Z */
-   header_bytes[3]    =        73;    /* I */
-   header_bytes[4]    =        80;    /* P */
-   header_bytes[5]    =       118;    /* v */
-   header_bytes[6]    = RZIP_VERSION; /* file format version number */
-   header_bytes[7]    =        35;    /* # */
+   header_bytes[0]    =  35; /* # */
+   header_bytes[1]    =  82; /* R */
+   header_bytes[2]    =  90; /* Z */
+   header_bytes[3]    =  73; /* I */
+   header_bytes[4]    =  80; /* P */
+   header_bytes[5]    = 118; /* v */
+   header_bytes[6]    = (stream->codec == RZIP_CODEC_ZSTD) /* file format */
+         ? RZIP_VERSION_ZSTD : RZIP_VERSION_DEFLATE;       /* version number */
+   header_bytes[7]    =  35; /* # */
 
    /* > Uncompressed chunk size - next 4 bytes */
    header_bytes[11]   = (stream->chunk_size >> 24) & 0xFF;
@@ -335,7 +392,8 @@ static bool rzipstream_init_stream(
    if (stream->is_writing)
    {
       /* Compression */
-      if (!(stream->deflate_backend = trans_stream_get_zlib_deflate_backend()))
+      if (!(stream->deflate_backend = rzipstream_get_backend(
+            stream->codec, true)))
          return false;
 
       if (!(stream->deflate_stream = stream->deflate_backend->stream_new()))
@@ -343,7 +401,7 @@ static bool rzipstream_init_stream(
 
       /* Set compression level */
       if (!stream->deflate_backend->define(
-            stream->deflate_stream, "level", RZIP_COMPRESSION_LEVEL))
+            stream->deflate_stream, "level", (uint32_t)stream->level))
          return false;
 
       /* Buffers
@@ -368,7 +426,8 @@ static bool rzipstream_init_stream(
    else if (stream->is_compressed)
    {
       /* Decompression */
-      if (!(stream->inflate_backend = trans_stream_get_zlib_inflate_backend()))
+      if (!(stream->inflate_backend = rzipstream_get_backend(
+            stream->codec, false)))
          return false;
 
       if (!(stream->inflate_stream = stream->inflate_backend->stream_new()))
@@ -466,6 +525,16 @@ static int rzipstream_free_stream(rzipstream_t *stream)
  * Returns NULL if arguments are invalid, file
  * is invalid or an IO error occurs */
 rzipstream_t* rzipstream_open(const char *path, unsigned mode)
+{
+   return rzipstream_open_codec(path, mode, RZIP_CODEC_DEFLATE, 0);
+}
+
+/* As rzipstream_open(), but when writing, compresses
+ * with 'codec' at 'level' (<= 0 selects the codec's
+ * default). Both are ignored when reading: the file
+ * header names its codec */
+rzipstream_t* rzipstream_open_codec(const char *path, unsigned mode,
+      enum rzip_codec codec, int level)
 {
    rzipstream_t *stream = NULL;
 
@@ -504,6 +573,21 @@ rzipstream_t* rzipstream_open(const char *path, unsigned mode)
    stream->out_buf_ptr     = 0;
    stream->out_buf_occupancy = 0;
 
+   /* Select codec
+    * > Without zstd built in, fall back to deflate:
+    *   the file is still readable everywhere */
+#ifdef RZIP_HAVE_ZSTD
+   stream->codec           = codec;
+#else
+   stream->codec           = RZIP_CODEC_DEFLATE;
+#endif
+   if (stream->codec == RZIP_CODEC_ZSTD)
+      stream->level        = (level > 0)
+            ? level : RZIP_ZSTD_COMPRESSION_LEVEL;
+   else
+      stream->level        = (level > 0 && level <= 9)
+            ? level : RZIP_COMPRESSION_LEVEL;
+
    /* Initialise stream */
    if (!rzipstream_init_stream(
          stream, path,
@@ -981,8 +1065,8 @@ static void rzipstream_par_worker(void *data)
       slock_unlock(par->lock);
 
       /* Compress assigned chunk with this worker's
-       * private deflate state. Each chunk is an
-       * independent zlib stream (flush == true), so
+       * private compressor state. Each chunk is an
+       * independent stream (flush == true), so
        * output is identical to serial compression */
       worker->backend->set_in(
             worker->stream, slot->in, slot->in_size);
@@ -1089,12 +1173,13 @@ static bool rzipstream_par_init(rzipstream_t *stream)
       worker->par     = par;
       worker->index   = i;
 
-      if (!(worker->backend = trans_stream_get_zlib_deflate_backend()))
+      if (!(worker->backend = rzipstream_get_backend(
+            stream->codec, true)))
          goto error;
       if (!(worker->stream = worker->backend->stream_new()))
          goto error;
       if (!worker->backend->define(
-            worker->stream, "level", RZIP_COMPRESSION_LEVEL))
+            worker->stream, "level", (uint32_t)stream->level))
          goto error;
 
       if (!(par->slots[i].out = (uint8_t*)malloc(par->out_buf_size)))
@@ -1243,7 +1328,7 @@ int64_t rzipstream_write(rzipstream_t *stream, const void *data, int64_t len)
 
          /* Multiple whole chunks pending: compress them
           * concurrently across the worker pool. Chunks
-          * are independent zlib streams, so output is
+          * are independent streams, so output is
           * byte-identical to the serial path */
          if (   (num_chunks >= 2)
              && rzipstream_par_init(stream))
@@ -1353,6 +1438,16 @@ int rzipstream_printf(rzipstream_t *stream, const char* format, ...)
  * specified by 'path'.
  * Returns false in the event of an error */
 bool rzipstream_write_file(const char *path, const void *data, int64_t len)
+{
+   return rzipstream_write_file_codec(path, data, len,
+         RZIP_CODEC_DEFLATE, 0);
+}
+
+/* As rzipstream_write_file(), compressing with
+ * 'codec' at 'level' (<= 0 selects the codec's
+ * default) */
+bool rzipstream_write_file_codec(const char *path, const void *data,
+      int64_t len, enum rzip_codec codec, int level)
 {
    int64_t bytes_written = 0;
    rzipstream_t *stream  = NULL;
@@ -1361,7 +1456,8 @@ bool rzipstream_write_file(const char *path, const void *data, int64_t len)
       return false;
 
    /* Attempt to open file */
-   if (!(stream = rzipstream_open(path, RETRO_VFS_FILE_ACCESS_WRITE)))
+   if (!(stream = rzipstream_open_codec(path, RETRO_VFS_FILE_ACCESS_WRITE,
+         codec, level)))
       return false;
 
    /* Write contents of data buffer to file */
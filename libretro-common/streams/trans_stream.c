@@ -102,3 +102,15 @@ const struct trans_stream_backend* trans_stream_get_pipe_backend(void)
 {
    return &pipe_backend;
 }
+
+#if defined(HAVE_RZSTD) || defined(HAVE_ZSTD)
+const struct trans_stream_backend* trans_stream_get_zstd_compress_backend(void)
+{
+   return &zstd_compress_backend;
+}
+
+const struct trans_stream_backend* trans_stream_get_zstd_decompress_backend(void)
+{
+   return &zstd_decompress_backend;
+}
+#endif
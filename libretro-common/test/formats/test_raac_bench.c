@@ -0,0 +1,641 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (test_raac_bench.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Decode-throughput benchmark and transform check for raac.
+ *
+ * raac's IMDCT, FFT and window/overlap-add stages have SSE and NEON
+ * paths chosen at compile time. This program exercises whichever
+ * set the build selected:
+ *
+ *  - The transform check runs raac_imdct at every size a decoder can
+ *    ask for (2048 and 256 in 1024-frame mode, 1920 and 240 in
+ *    960-frame mode) on pseudo-random spectra and compares against
+ *    the defining cosine sum of 14496-3 4.6.11.3.
+ *
+ *  - FIX is a stock ffmpeg AAC-LC encode (stereo, 44.1 kHz, 64 kbit/s,
+ *    34 access units) of tones with periodic clicks, so it switches
+ *    through all four window sequences and both window shapes.  Each
+ *    frame's per-channel RMS must match that of ffmpeg's own decode
+ *    (test_fix_rms) within 0.1 percent, which catches a wrong
+ *    window, overlap or scatter that an all-frames hash would only
+ *    report as "changed".
+ *
+ *  - The fixture is then decoded repeatedly and the rate reported in
+ *    microseconds per access unit and as a multiple of real time.
+ *    Nothing is asserted about the timing; compare a build against
+ *    one made with -DRAAC_NO_SIMD, which forces the scalar code:
+ *
+ *    gcc -std=gnu99 -O2 -I../../include test_raac_bench.c -lm && ./a.out
+ *    gcc -std=gnu99 -O2 -DRAAC_NO_SIMD -I../../include \
+ *        test_raac_bench.c -lm && ./a.out
+ *
+ * An optional argument sets the number of timed passes (default 200).
+ * The decoder source is included directly so the check can reach the
+ * static transform. */
+
+#include "../../formats/aac/raac.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static const unsigned char test_fix_asc[2] = {
+   18,16
+};
+
+static const unsigned short test_fix_size[34] = {
+   203,271,201,200,135,138,147,171,209,152,168,208,
+   157,190,227,156,153,155,200,228,175,155,229,178,
+   245,149,156,162,171,209,244,233,246,7
+};
+
+static const unsigned char test_fix_au[6228] = {
+   220,0,76,97,118,99,54,49,46,51,46,49,48,48,0,66,
+   80,158,2,0,0,5,28,29,19,5,34,106,9,249,188,112,
+   189,119,90,202,151,137,23,31,114,73,36,19,166,206,102,149,
+   74,68,217,104,62,122,248,75,15,110,191,96,98,97,235,168,
+   146,219,167,38,182,4,74,122,57,10,151,101,177,198,252,59,
+   127,177,249,250,154,92,106,216,228,29,112,34,83,207,221,63,
+   202,34,159,140,71,217,198,35,236,227,17,246,81,210,145,218,
+   26,10,7,76,77,212,174,244,226,105,114,238,252,231,59,167,
+   207,190,174,238,229,130,129,60,16,133,24,145,140,154,98,170,
+   134,27,176,120,211,37,58,242,194,65,129,129,129,129,129,129,
+   145,3,27,54,108,25,21,10,10,122,249,187,224,115,9,166,
+   75,52,211,37,74,148,225,192,144,142,9,195,165,154,110,177,
+   187,229,243,87,253,143,75,3,34,150,94,33,74,108,140,8,
+   4,0,16,79,217,27,178,200,245,100,186,178,157,63,63,143,
+   231,207,13,189,107,143,255,15,207,199,243,199,28,107,90,255,
+   235,253,62,255,207,90,235,87,175,255,181,249,248,255,203,173,
+   107,87,98,23,220,210,138,255,214,46,94,33,140,205,41,184,
+   28,32,66,48,108,131,100,51,168,151,158,7,242,217,252,255,
+   152,127,63,231,252,192,254,127,207,249,139,69,141,129,139,214,
+   176,168,25,210,176,12,33,214,56,253,1,194,104,192,15,151,
+   203,233,244,157,81,15,167,210,112,8,15,167,211,233,56,16,
+   129,244,250,125,17,240,40,149,116,36,36,36,36,36,36,36,
+   36,36,36,36,36,228,157,146,218,236,148,242,39,221,145,158,
+   68,251,178,59,219,255,237,127,235,237,231,223,255,71,69,235,
+   247,253,191,235,231,142,63,254,215,138,127,143,250,127,235,237,
+   199,159,255,183,239,85,255,95,253,63,245,243,245,251,127,233,
+   248,162,223,183,127,192,0,179,246,114,42,40,7,108,11,193,
+   197,250,217,188,116,6,48,227,10,184,243,43,143,50,176,48,
+   176,27,188,124,187,146,33,86,28,99,20,98,142,196,118,77,
+   116,200,167,196,71,15,170,9,93,192,32,163,121,69,141,107,
+   190,247,251,79,215,219,204,155,255,199,254,92,121,157,69,203,
+   142,57,36,146,73,32,37,215,115,166,230,243,25,223,127,112,
+   149,143,125,26,0,248,248,9,247,247,132,124,124,24,123,251,
+   129,147,224,15,127,114,31,31,0,80,37,109,178,61,89,40,
+   45,21,145,233,253,63,247,243,199,207,254,159,255,230,113,255,
+   241,127,219,255,95,110,61,255,244,255,255,60,107,255,237,127,
+   79,252,188,241,243,255,167,255,201,199,0,207,52,51,254,134,
+   118,52,80,195,60,223,13,111,229,172,162,74,77,116,219,35,
+   174,96,152,58,9,129,90,232,88,152,190,174,68,68,68,81,
+   113,40,184,164,162,87,77,113,252,240,106,59,184,48,48,48,
+   49,179,106,119,6,6,28,12,12,108,89,220,134,215,37,131,
+   5,253,219,255,157,212,74,107,191,157,207,231,252,240,15,231,
+   252,247,142,32,133,25,68,177,110,181,149,250,127,252,95,215,
+   255,95,253,102,159,255,119,253,127,255,239,243,198,247,213,239,
+   206,241,215,185,68,5,15,165,20,35,2,42,40,162,138,18,
+   179,82,7,169,26,17,179,215,27,54,71,11,245,70,107,102,
+   228,114,163,74,155,36,110,145,118,74,233,39,36,122,178,80,
+   94,145,47,233,255,219,83,151,255,178,253,127,253,175,223,207,
+   42,189,205,127,79,231,141,223,237,254,59,242,255,183,255,62,
+   221,120,255,246,255,255,127,255,247,225,1,191,86,60,0,122,
+   107,169,140,116,127,39,169,177,68,143,218,227,243,215,192,126,
+   215,252,247,13,64,163,116,174,57,251,189,180,135,160,161,105,
+   125,2,191,84,175,246,34,127,3,248,31,192,254,0,208,204,
+   208,121,1,252,127,136,17,243,117,0,201,216,37,101,162,34,
+   34,136,162,81,44,205,13,64,106,132,56,32,134,25,68,177,
+   110,181,183,207,255,242,159,255,15,197,235,95,255,99,254,159,
+   255,243,239,245,61,123,86,92,229,217,154,100,169,55,37,15,
+   148,243,156,234,41,231,158,118,146,179,83,83,159,57,244,145,
+   79,106,219,78,113,164,71,61,244,152,77,60,162,198,132,69,
+   170,115,75,252,252,254,159,126,184,253,222,87,46,215,29,190,
+   63,254,159,253,252,251,94,174,92,144,59,239,239,239,51,231,
+   243,209,239,160,23,199,195,99,223,222,17,147,225,177,239,239,
+   8,248,248,3,223,64,63,193,134,125,1,240,6,127,113,35,
+   194,14,33,25,69,73,99,90,215,159,127,227,243,255,157,212,
+   170,255,167,254,222,175,151,205,252,107,92,61,102,146,90,210,
+   88,251,20,126,7,49,143,246,47,156,97,43,17,137,62,113,
+   132,252,227,194,228,252,254,113,129,39,204,193,63,56,192,249,
+   239,61,210,124,207,4,80,20,104,68,90,165,102,247,191,252,
+   127,251,127,167,255,63,204,213,203,231,219,158,170,183,167,175,
+   255,243,255,255,156,86,183,42,234,7,210,138,40,162,132,32,
+   197,69,20,81,69,20,81,69,20,81,38,200,236,154,57,108,
+   56,91,10,197,80,107,248,124,4,160,214,14,33,25,69,17,
+   103,88,102,127,225,255,149,58,240,254,255,239,199,59,247,169,
+   245,168,183,190,78,183,122,206,51,140,15,155,63,186,91,207,
+   239,163,221,62,254,233,88,247,31,9,83,255,25,128,248,248,
+   109,62,254,224,103,247,133,240,7,199,192,25,62,12,50,124,
+   54,4,17,72,77,161,17,104,68,58,133,102,247,159,253,63,
+   233,252,255,248,253,238,245,47,159,57,166,120,242,244,255,254,
+   127,255,255,143,105,205,212,136,62,95,47,148,243,206,159,91,
+   141,60,252,211,207,62,201,246,79,205,85,131,154,21,113,41,
+   126,123,171,190,239,80,178,230,109,130,80,108,5,192,224,32,
+   136,25,72,71,18,21,196,77,208,136,117,36,251,127,253,170,
+   255,31,251,106,79,252,123,255,249,93,223,62,111,190,47,33,
+   213,74,73,64,4,132,132,198,226,250,136,80,72,72,72,72,
+   72,233,236,254,40,243,207,61,244,123,233,172,44,59,244,117,
+   222,118,0,189,201,74,211,207,139,207,47,201,211,107,90,217,
+   126,176,99,6,108,178,120,73,210,148,152,17,234,156,107,231,
+   199,125,254,159,127,111,111,142,47,89,197,92,21,239,255,246,
+   191,238,240,235,141,75,185,32,15,15,44,32,0,0,0,72,
+   120,121,247,0,0,49,24,120,123,98,0,0,24,140,60,61,
+   224,0,0,84,97,225,239,96,0,3,184,120,123,110,32,0,
+   195,135,141,191,208,32,254,159,112,224,32,129,25,69,141,8,
+   135,86,221,126,223,255,79,199,254,191,250,203,191,255,189,253,
+   127,255,231,197,235,158,47,122,204,120,69,50,47,32,40,233,
+   232,65,200,191,93,20,81,0,77,66,131,125,62,143,115,243,
+   235,145,105,129,34,77,97,55,215,251,139,16,63,97,34,224,
+   97,40,221,213,62,149,166,200,221,34,236,149,210,46,201,93,
+   34,236,141,210,45,254,191,252,249,157,192,255,126,53,255,237,
+   255,143,253,124,245,225,241,87,255,111,235,230,113,55,226,248,
+   243,253,255,210,115,53,72,142,250,177,224,14,250,177,231,131,
+   190,172,121,0,103,28,1,159,90,14,12,66,115,134,185,194,
+   98,74,37,48,107,0,152,1,78,161,120,252,136,138,40,162,
+   136,28,36,253,191,168,252,55,239,31,207,249,234,57,209,101,
+   180,198,53,201,207,129,219,104,210,153,13,157,70,142,38,70,
+   38,25,24,127,129,252,48,7,146,33,192,32,134,25,69,141,
+   8,135,86,143,159,255,191,63,245,255,189,235,95,255,87,250,
+   255,255,207,198,179,126,213,190,48,235,222,67,37,107,46,135,
+   203,229,242,192,241,155,229,242,249,124,187,130,106,29,6,233,
+   48,169,29,139,3,141,223,201,191,100,79,218,158,51,113,210,
+   64,85,96,3,72,78,101,229,22,52,34,45,83,187,159,62,
+   60,126,126,189,186,252,78,162,92,139,170,124,255,253,63,250,
+   249,243,173,92,151,3,39,199,198,239,127,127,127,95,143,143,
+   129,159,223,220,178,124,124,27,63,191,184,201,241,240,29,247,
+   247,15,252,54,61,253,200,255,25,134,127,120,79,241,240,41,
+   119,240,7,32,160,41,73,141,72,135,66,66,115,206,123,255,
+   95,253,238,93,124,255,79,251,245,241,56,225,122,145,197,165,
+   218,227,245,189,0,120,120,120,124,107,15,15,15,15,15,15,
+   123,107,184,121,240,247,128,0,1,227,15,15,110,0,0,7,
+   112,243,238,32,0,1,199,135,159,113,0,12,59,130,4,149,
+   24,47,105,42,163,5,211,180,7,193,148,149,17,232,68,90,
+   17,14,161,190,119,189,255,244,255,227,253,63,245,255,23,119,
+   167,126,220,245,85,222,159,127,255,211,255,248,117,230,115,97,
+   6,40,197,129,129,129,217,11,43,22,100,12,13,25,16,48,
+   48,48,57,106,218,180,104,229,51,107,202,164,104,242,171,169,
+   231,177,68,16,132,5,34,247,2,224,112,32,157,74,155,100,
+   122,178,93,89,30,172,149,216,254,253,31,92,113,122,250,255,
+   250,124,125,191,31,93,93,241,227,254,159,122,154,246,213,235,
+   223,254,159,227,247,235,78,107,189,12,203,210,10,18,169,118,
+   226,143,87,224,204,127,129,247,31,29,163,55,202,35,250,67,
+   252,18,151,151,39,199,242,137,74,20,118,117,202,139,86,86,
+   183,238,32,117,145,41,90,32,126,19,237,52,174,92,144,143,
+   67,208,97,6,44,33,252,40,24,124,84,3,15,139,16,14,
+   233,92,121,23,117,29,44,39,185,185,249,190,140,230,84,16,
+   202,44,104,76,90,165,55,155,255,227,255,219,252,255,235,254,
+   28,90,249,243,151,175,14,158,159,255,207,255,255,241,83,9,
+   116,31,79,167,211,233,244,220,250,12,84,125,40,162,138,53,
+   238,163,118,182,221,53,11,54,176,186,235,221,229,105,128,96,
+   96,72,254,135,227,168,75,186,229,192,56,32,162,121,69,141,
+   81,13,206,103,143,237,255,157,223,29,255,31,63,237,254,143,
+   51,139,185,35,125,105,36,143,194,195,190,254,254,238,151,191,
+   191,191,184,206,19,80,204,32,247,247,15,252,102,3,222,17,
+   241,240,100,251,251,145,254,51,7,125,244,7,254,27,2,197,
+   0,138,88,59,93,80,30,44,79,191,186,153,227,240,32,70,
+   81,84,71,161,49,106,153,188,222,127,251,127,211,249,255,247,
+   123,93,220,190,124,231,25,156,251,61,191,255,159,255,254,227,
+   58,230,37,72,62,83,207,60,243,166,118,50,121,231,158,117,
+   79,58,167,158,112,105,246,41,161,54,81,81,234,202,94,133,
+   10,234,197,80,238,182,65,192,32,128,25,72,75,19,22,70,
+   135,33,232,72,58,183,142,62,223,244,253,63,235,254,122,95,
+   254,159,183,255,195,173,86,252,214,68,120,170,175,2,40,107,
+   107,222,55,125,8,147,33,219,34,240,11,142,235,45,59,89,
+   208,191,207,127,169,248,180,187,190,235,173,76,12,12,108,216,
+   55,58,198,192,96,100,102,217,117,71,216,76,8,145,48,59,
+   144,69,180,165,170,196,137,167,138,83,65,18,98,213,60,235,
+   231,190,249,254,191,191,215,213,251,52,197,200,103,143,254,191,
+   250,187,252,241,119,46,72,34,50,132,177,108,92,214,197,204,
+   228,186,39,137,193,87,57,85,84,163,44,178,136,67,91,51,
+   149,85,195,195,219,112,0,5,56,120,122,236,0,48,241,135,
+   182,224,0,15,104,120,122,236,0,0,125,126,39,227,63,253,
+   127,252,255,79,198,112,32,135,25,69,173,90,159,111,255,167,
+   227,255,95,253,229,207,254,191,183,255,251,226,239,159,55,75,
+   222,169,211,138,144,200,31,47,151,203,3,152,223,47,151,203,
+   229,16,78,129,253,139,229,22,88,184,241,8,27,50,252,190,
+   92,80,69,199,41,231,87,202,30,40,19,68,2,182,85,12,
+   79,228,170,68,138,164,166,206,75,105,19,166,200,245,100,186,
+   178,60,106,87,227,195,60,60,189,179,255,183,255,214,255,223,
+   243,83,237,254,222,36,254,223,251,251,107,63,254,207,255,250,
+   235,95,255,23,253,63,249,248,235,215,255,217,255,255,127,255,
+   231,160,242,23,181,207,116,224,65,247,126,68,144,186,238,132,
+   37,59,101,243,36,231,232,33,8,99,132,36,127,3,5,2,
+   40,34,245,192,24,191,136,7,132,1,120,57,190,110,111,154,
+   144,16,169,95,46,105,254,83,168,62,22,16,64,192,135,18,
+   0,135,203,229,20,234,4,7,203,229,199,228,165,41,64,217,
+   68,113,209,236,254,171,69,177,192,32,128,25,69,141,9,7,
+   72,33,211,51,63,79,255,171,207,254,191,250,203,127,253,223,
+   219,255,254,241,169,151,172,212,167,138,165,86,33,80,73,251,
+   253,186,150,205,251,253,254,226,136,30,241,249,138,40,162,138,
+   40,146,128,64,92,14,15,218,185,213,57,65,199,143,163,149,
+   98,28,157,134,125,73,104,20,156,195,202,70,146,244,34,29,
+   91,197,121,247,245,235,243,245,231,175,214,92,146,226,20,251,
+   255,251,185,241,214,181,37,201,0,160,160,162,188,84,20,23,
+   182,10,10,10,92,32,186,21,151,254,62,27,79,191,185,31,
+   227,225,177,239,238,67,227,224,195,63,188,33,255,140,193,223,
+   127,114,18,204,224,33,25,69,65,107,86,213,103,247,175,247,
+   169,237,239,207,233,254,220,183,190,239,226,245,118,122,73,36,
+   146,72,59,168,194,164,220,126,238,158,106,182,198,118,15,224,
+   191,251,114,122,127,128,127,116,254,187,190,181,11,250,180,155,
+   14,203,199,86,158,145,217,124,99,79,76,66,253,247,39,167,
+   184,63,22,52,34,45,8,135,80,204,223,59,255,199,255,95,
+   243,255,175,248,154,185,174,124,243,213,103,126,95,31,255,207,
+   255,255,241,241,55,18,164,17,69,20,93,209,96,178,52,81,
+   69,20,81,69,20,69,23,33,111,116,92,152,10,32,132,161,
+   73,23,72,2,3,98,14,119,68,160,216,9,129,192,33,25,
+   68,233,107,86,83,255,143,183,254,254,203,207,233,251,127,247,
+   201,207,60,207,142,46,228,122,174,73,34,65,147,59,240,28,
+   139,54,140,142,229,7,96,205,157,247,114,193,11,97,25,220,
+   107,54,134,198,76,249,29,155,158,22,243,228,206,252,19,65,
+   14,109,14,59,151,113,55,163,50,160,146,66,109,9,139,84,
+   170,172,223,255,135,255,135,249,255,215,249,154,147,94,60,213,
+   183,191,103,183,255,243,255,255,254,106,115,170,151,64,18,18,
+   18,18,18,19,20,109,168,36,36,36,36,36,36,36,224,73,
+   192,154,110,176,145,51,108,91,164,184,70,51,179,101,172,178,
+   60,54,125,236,29,198,212,67,128,32,133,25,86,104,44,156,
+   141,161,16,232,132,58,135,83,199,255,222,127,246,243,213,117,
+   255,247,63,111,255,241,169,151,47,45,78,197,42,174,148,148,
+   5,25,43,18,139,17,144,134,93,21,195,199,244,212,140,18,
+   82,69,41,50,172,116,197,125,139,236,30,78,94,229,208,235,
+   99,149,145,87,34,175,140,155,169,230,59,241,115,40,208,170,
+   111,81,57,78,63,92,72,238,111,192,48,94,53,162,169,146,
+   148,132,163,163,156,90,166,113,190,92,255,127,199,199,90,158,
+   101,77,94,163,157,251,255,211,253,222,158,122,214,174,75,128,
+   0,0,2,49,217,201,231,118,126,86,58,103,133,22,8,203,
+   3,66,14,30,30,30,176,15,212,52,2,135,135,159,112,0,
+   6,28,60,61,187,0,0,28,120,123,192,0,238,30,30,240,
+   0,0,59,143,62,224,0,87,71,169,26,156,140,48,195,8,
+   7,32,130,25,76,100,150,132,195,171,99,244,255,233,250,127,
+   223,255,121,167,255,212,252,255,255,239,241,87,223,179,158,39,
+   135,118,179,46,160,153,3,179,180,140,2,19,113,79,95,249,
+   101,148,27,91,63,179,185,112,149,156,130,192,106,218,219,222,
+   199,50,81,117,189,121,42,85,245,189,2,20,1,171,188,4,
+   226,101,151,93,158,121,139,88,140,234,86,107,35,213,146,186,
+   73,217,30,172,142,214,255,95,253,252,202,255,235,255,242,113,
+   62,223,255,87,245,189,100,22,151,199,253,63,221,226,254,223,
+   243,243,223,223,199,243,231,138,255,251,127,255,36,211,223,87,
+   60,0,0,44,238,51,120,233,77,157,71,4,112,94,255,207,
+   125,215,36,196,203,161,4,80,127,60,17,127,60,21,254,127,
+   207,120,168,184,86,102,35,91,147,27,194,233,244,155,184,201,
+   233,45,163,176,215,8,219,144,105,208,49,139,248,24,140,167,
+   63,226,17,65,20,60,32,167,132,15,55,56,128,103,28,28,
+   231,175,90,176,112,32,129,25,82,212,94,133,3,171,99,231,
+   255,237,125,191,249,255,155,175,143,255,229,227,255,228,250,178,
+   107,105,111,17,117,83,18,160,214,213,203,126,235,106,223,193,
+   235,54,183,111,221,117,123,177,110,27,187,206,254,90,166,111,
+   148,205,48,76,207,209,142,96,150,199,74,123,124,179,219,131,
+   173,165,169,188,26,238,79,86,164,115,210,25,45,171,154,97,
+   229,38,52,38,45,83,189,111,215,125,254,223,143,143,111,110,
+   43,73,114,234,86,62,255,254,239,255,62,124,234,238,228,176,
+   26,10,11,196,181,208,80,80,176,93,11,177,56,80,86,138,
+   180,20,20,211,133,5,52,227,65,77,60,65,65,79,8,40,
+   43,184,80,82,220,104,41,167,136,40,41,98,88,222,47,74,
+   233,92,211,128,32,152,41,73,173,90,124,252,255,111,31,233,
+   198,186,235,215,244,255,174,100,196,95,14,35,246,72,180,146,
+   0,3,17,199,106,128,0,0,12,40,123,197,85,195,214,224,
+   0,0,0,10,112,240,240,243,239,0,0,0,3,14,60,60,
+   60,60,251,136,0,0,0,97,222,208,240,240,240,240,245,184,
+   128,0,7,241,148,88,208,136,181,76,173,239,63,253,191,233,
+   254,63,253,62,166,174,57,242,173,87,122,124,127,255,79,255,
+   249,197,107,155,169,16,79,60,243,207,58,118,55,116,243,207,
+   60,243,207,60,254,179,206,115,79,84,255,89,250,148,121,255,
+   8,86,89,162,124,3,131,156,243,28,82,47,231,0,224,32,
+   155,74,109,100,174,203,35,213,145,169,44,151,58,95,167,63,
+   167,235,236,253,213,223,251,255,241,153,199,30,120,156,124,254,
+   126,255,175,26,227,90,215,255,197,250,123,127,167,92,121,227,
+   95,253,135,67,89,160,133,149,67,207,49,33,180,158,181,83,
+   236,162,78,171,202,52,38,186,136,116,63,129,140,193,16,244,
+   88,49,224,14,158,139,1,143,221,208,10,251,61,177,203,193,
+   142,121,162,146,177,29,107,235,111,248,107,61,215,9,186,238,
+   13,120,36,37,220,24,144,72,72,75,187,131,3,102,18,18,
+   18,238,224,192,192,208,138,4,47,148,81,68,81,69,20,81,
+   69,20,0,202,76,104,76,90,165,248,102,255,248,255,246,255,
+   79,254,127,195,78,25,170,226,155,183,199,255,243,255,255,157,
+   102,183,117,32,1,141,203,47,163,232,225,239,43,215,47,83,
+   44,178,203,44,191,229,150,89,121,86,50,203,46,114,184,58,
+   36,72,226,50,100,206,235,66,215,242,85,46,40,171,202,29,
+   215,193,217,14,32,155,121,76,242,78,176,130,239,158,127,108,
+   255,62,223,30,62,51,255,219,255,47,175,111,111,2,72,231,
+   146,72,180,147,249,7,141,56,211,141,56,157,57,6,15,32,
+   158,44,216,177,59,189,248,196,160,24,96,239,131,136,124,124,
+   25,67,227,224,201,247,247,35,252,124,1,239,238,15,241,240,
+   19,239,238,1,254,62,13,102,143,126,105,130,148,152,17,234,
+   72,43,241,83,223,243,250,125,250,227,247,158,115,134,151,196,
+   206,254,223,253,127,247,122,121,227,139,151,39,255,168,0,70,
+   30,30,126,8,5,135,135,135,173,176,0,0,6,7,135,135,
+   183,0,0,3,22,135,135,173,196,0,41,199,135,135,182,239,
+   96,0,3,184,240,243,246,7,200,74,47,241,254,62,35,111,
+   128,147,231,2,246,240,32,127,25,73,141,9,135,86,202,253,
+   63,254,151,191,255,63,251,221,235,255,237,255,241,255,255,127,
+   26,215,60,42,94,222,74,100,138,188,129,165,191,203,254,95,
+   55,191,245,250,254,71,247,30,167,169,145,251,223,121,246,53,
+   104,96,98,87,185,177,110,40,245,175,230,32,189,42,130,59,
+   119,192,221,224,74,4,145,26,221,51,153,240,249,186,138,75,
+   165,108,178,87,72,164,54,74,13,178,87,73,59,37,116,147,
+   127,251,127,235,237,198,225,95,142,53,255,225,255,211,255,95,
+   142,183,255,246,191,255,223,90,255,233,255,237,250,220,149,175,
+   19,175,239,245,237,157,215,182,237,239,171,30,0,0,61,237,
+   140,85,4,37,41,66,105,140,12,102,81,173,234,62,156,224,
+   225,208,249,252,189,64,254,95,203,134,176,228,206,18,18,18,
+   84,171,162,157,164,50,159,160,21,81,0,17,48,137,226,137,
+   226,137,149,85,162,130,47,228,212,63,151,242,215,80,124,62,
+   19,16,67,136,91,230,43,176,44,36,43,192,236,49,244,139,
+   209,101,161,226,206,6,114,206,79,153,254,32,134,25,69,113,
+   22,172,130,170,247,255,251,243,255,183,251,221,207,254,191,253,
+   63,255,231,235,195,191,50,184,222,244,236,171,172,73,71,3,
+   233,244,231,74,110,39,158,121,239,160,117,98,33,16,121,108,
+   50,64,161,116,11,111,92,20,27,95,214,246,222,75,61,136,
+   139,34,193,9,103,84,3,182,97,229,22,52,34,29,89,158,
+   57,222,255,227,254,191,77,117,52,226,95,18,183,219,235,255,
+   239,111,235,207,26,213,218,193,255,135,125,253,253,253,214,207,
+   127,127,127,113,147,227,224,59,239,160,31,227,224,195,223,220,
+   12,159,31,0,15,127,114,15,252,124,1,239,238,66,89,156,
+   33,25,68,121,107,86,43,255,238,127,95,253,127,242,163,251,
+   255,251,127,255,122,172,221,75,227,83,81,232,185,36,146,65,
+   22,159,59,86,68,247,157,29,51,133,172,30,120,187,158,215,
+   211,58,34,253,189,174,143,212,245,69,139,40,234,158,47,219,
+   212,87,60,88,188,191,212,241,119,61,71,76,241,119,61,4,
+   148,18,104,68,90,165,55,188,255,233,255,79,231,255,183,222,
+   245,107,171,203,149,205,189,191,255,103,255,252,235,53,187,203,
+   176,4,132,132,132,137,9,176,91,108,137,42,19,116,36,168,
+   72,72,145,34,74,220,18,84,36,168,77,171,19,9,89,124,
+   37,194,126,249,77,102,82,33,40,61,81,14,33,25,72,16,
+   0,0,0,42,19,26,18,14,173,117,191,234,255,158,110,147,
+   251,255,156,215,141,243,62,53,118,248,215,18,73,36,92,0,
+   204,221,187,99,46,24,121,114,162,6,124,30,237,131,3,3,
+   35,150,85,96,18,18,19,205,124,91,174,48,48,242,229,68,
+   109,66,66,110,217,120,48,243,253,27,60,243,169,249,40,68,
+   208,152,181,70,111,156,255,246,255,183,250,127,243,251,220,212,
+   158,61,179,76,223,79,143,255,231,255,255,184,206,59,186,178,
+   11,6,6,6,6,6,64,57,166,3,3,3,3,3,3,3,
+   3,3,3,3,11,88,225,133,143,30,193,97,151,143,96,166,
+   218,61,235,1,7,106,134,186,104,14,227,106,33,192,33,25,
+   68,57,107,86,205,247,255,244,190,127,245,255,206,239,63,227,
+   255,31,255,36,204,82,231,82,227,221,114,73,8,19,202,37,
+   156,198,230,158,141,220,225,43,25,103,245,232,163,119,209,231,
+   191,127,184,162,249,124,167,159,245,209,69,31,71,153,202,47,
+   151,52,255,170,40,250,115,189,202,44,179,207,235,69,28,240,
+   40,104,25,63,66,162,208,136,116,34,29,50,102,243,127,223,
+   254,159,175,251,255,135,19,78,122,223,19,121,167,175,255,226,
+   255,255,124,123,43,47,56,170,0,192,192,210,203,43,162,135,
+   204,172,49,162,138,40,162,138,40,162,138,47,150,82,138,40,
+   170,3,44,157,217,103,169,74,141,10,24,4,0,70,1,199,
+   219,38,183,160,4,192,169,0,224,32,124,25,86,214,41,27,
+   66,65,208,144,117,45,235,243,255,215,159,253,190,252,94,191,
+   167,252,127,250,234,101,201,85,120,245,149,37,42,38,88,68,
+   133,146,55,35,25,173,42,114,121,172,96,43,110,224,64,58,
+   4,104,17,168,41,189,61,128,78,107,119,107,189,190,124,3,
+   10,94,154,233,122,72,237,50,50,7,172,76,190,128,25,63,
+   71,160,252,237,11,27,135,157,226,115,60,196,99,16,117,27,
+   135,212,55,93,178,133,41,11,70,71,72,181,77,237,185,227,
+   250,125,254,181,195,164,105,37,84,247,254,255,229,243,231,139,
+   187,180,176,96,120,120,127,120,211,33,33,196,36,123,147,87,
+   198,236,120,184,245,101,210,249,135,196,0,40,135,135,135,184,
+   128,3,14,60,60,61,236,0,0,123,67,195,221,192,0,29,
+   195,195,219,176,0,0,195,135,135,159,128,86,24,106,122,103,
+   141,207,55,79,155,12,48,195,8,28,32,135,25,72,71,18,
+   22,68,135,18,232,68,90,149,79,159,255,181,159,227,255,59,
+   143,254,187,255,244,235,87,157,57,242,239,78,194,74,168,80,
+   4,132,132,198,236,126,68,40,36,36,36,36,168,231,252,31,
+   206,246,143,77,49,80,144,144,155,162,97,187,116,72,147,133,
+   106,37,31,229,142,90,245,165,103,192,74,114,225,19,133,229,
+   44,105,227,148,147,137,70,236,142,215,100,186,178,61,89,46,
+   159,246,255,223,218,235,255,226,113,107,95,254,159,255,111,249,
+   195,243,247,212,248,255,240,255,9,159,111,190,79,143,251,127,
+   235,237,199,127,253,63,255,215,28,32,239,183,254,0,239,183,
+   127,248,6,234,72,199,213,177,104,186,232,128,56,65,147,243,
+   223,225,180,134,59,194,99,222,1,146,100,118,82,116,65,42,
+   36,33,14,135,240,48,22,254,33,20,17,101,192,24,182,99,
+   3,155,8,5,43,139,200,226,206,227,34,4,80,241,249,115,
+   23,203,228,16,14,19,8,108,66,8,117,79,17,113,3,154,
+   121,254,89,81,242,230,31,47,151,55,203,229,199,128,32,159,
+   41,73,157,56,143,68,241,207,63,167,175,253,250,171,239,231,
+   246,255,219,95,119,77,75,151,110,43,90,231,180,112,16,8,
+   0,0,177,77,136,0,97,195,222,218,238,30,30,30,235,16,
+   0,0,196,97,225,235,112,0,6,28,120,121,247,16,0,195,
+   198,30,125,224,0,48,227,195,207,191,3,229,200,254,153,143,
+   198,38,223,186,89,243,148,159,74,219,100,110,145,118,82,9,
+   210,78,200,237,36,159,235,255,175,198,189,64,255,126,56,255,
+   235,255,199,254,190,220,122,127,142,56,255,251,159,219,255,127,
+   110,62,127,252,63,254,79,255,251,194,223,183,127,248,223,183,
+   126,0,0,222,58,3,123,228,51,42,49,189,227,190,251,55,
+   182,40,146,151,27,23,184,13,251,192,13,12,26,76,18,41,
+   65,75,91,173,109,76,112,172,199,10,164,162,79,10,12,243,
+   47,3,93,6,231,121,239,163,102,250,125,40,250,125,57,204,
+   227,128,51,190,144,158,109,115,215,173,68,166,187,233,67,111,
+   48,125,62,159,71,146,56,33,74,216,128,32,0,0,0,77,
+   217,26,146,200,245,100,174,192,237,255,199,227,253,58,215,90,
+   191,175,255,185,254,191,143,244,235,142,175,139,255,240,255,93,
+   127,142,58,119,106,236,110,107,188,87,29,76,140,243,98,34,
+   201,70,15,82,254,166,255,229,19,221,112,144,151,112,98,83,
+   45,220,24,24,36,36,37,221,193,129,179,9,9,9,119,112,
+   96,96,109,59,176,88,165,240,215,186,42,149,203,24,70,111,
+   195,91,126,185,152,31,13,99,126,185,155,238,7,245,223,168,
+   15,203,213,253,123,70,237,3,230,100,92,205,79,89,40,43,
+   200,171,35,199,171,37,116,147,14,223,244,255,215,219,143,127,
+   253,59,255,254,252,127,253,223,233,255,191,78,127,244,255,239,
+   250,183,255,111,191,226,126,144,31,60,88,13,116,83,88,188,
+   142,68,68,68,81,113,40,190,74,36,164,215,76,53,65,252,
+   255,158,175,229,252,191,144,247,121,198,244,89,191,245,55,192,
+   96,142,11,189,215,241,155,18,81,43,166,184,60,123,46,144,
+   246,3,100,211,225,170,57,220,203,61,28,236,224,33,64,218,
+   70,8,193,192
+};
+
+static const float test_fix_rms[68] = {
+   1.269297e-02f,5.838584e-03f,2.045680e-01f,1.743573e-01f,
+   1.871448e-01f,1.928411e-01f,2.017293e-01f,1.911426e-01f,
+   2.194680e-01f,1.981214e-01f,2.210018e-01f,2.056028e-01f,
+   2.519111e-01f,2.036611e-01f,1.789562e-01f,1.626745e-01f,
+   1.339433e-01f,1.621099e-01f,1.600008e-01f,1.713392e-01f,
+   1.735545e-01f,2.209220e-01f,2.755750e-01f,1.474499e-01f,
+   2.278185e-01f,1.770360e-01f,2.090823e-01f,2.068519e-01f,
+   1.714685e-01f,2.145023e-01f,1.544003e-01f,1.859964e-01f,
+   1.378455e-01f,1.767753e-01f,1.989197e-01f,1.535708e-01f,
+   2.021335e-01f,1.879879e-01f,1.787553e-01f,1.683629e-01f,
+   1.665514e-01f,1.700369e-01f,1.909626e-01f,1.374667e-01f,
+   2.267300e-01f,2.124637e-01f,1.684187e-01f,2.147508e-01f,
+   1.921929e-01f,1.684352e-01f,2.401089e-01f,1.646195e-01f,
+   2.104408e-01f,1.385342e-01f,2.116742e-01f,1.389394e-01f,
+   1.728504e-01f,1.617573e-01f,1.551507e-01f,1.552749e-01f,
+   1.693207e-01f,1.768269e-01f,1.745890e-01f,1.847453e-01f,
+   2.309536e-01f,1.891901e-01f,1.260134e-01f,9.486970e-02f
+};
+
+static int test_imdct(raac_t *a, int n)
+{
+   static float x[1024], ref[2048];
+   float   *out = a->fb_win;
+   uint32_t seed = 0x12345678u ^ (uint32_t)n;
+   double   err = 0.0, mag = 0.0;
+   int      i, k;
+
+   for (k = 0; k < n / 2; k++)
+   {
+      seed = seed * 1664525u + 1013904223u;
+      x[k] = (float)((int32_t)seed >> 8) / 8388608.0f;
+   }
+   for (i = 0; i < n; i++)
+   {
+      double n0 = (n / 2 + 1) / 2.0, s = 0.0;
+      for (k = 0; k < n / 2; k++)
+         s += x[k] * cos(2.0 * M_PI / n * (i + n0) * (k + 0.5));
+      ref[i] = (float)(2.0 * s / n);
+   }
+   raac_imdct(a, x, out, n);
+   for (i = 0; i < n; i++)
+   {
+      double d = fabs((double)out[i] - ref[i]);
+      if (d > err)
+         err = d;
+      if (fabs(ref[i]) > mag)
+         mag = fabs(ref[i]);
+   }
+   if (err > mag * 1e-5)
+   {
+      printf("FAIL: imdct %4d: max error %g against peak %g\n",
+            n, err, mag);
+      return 1;
+   }
+   printf("ok:   imdct %4d: max error %.3g against peak %.3g\n",
+         n, err, mag);
+   return 0;
+}
+
+/* Decode the whole fixture once. rms, when non-NULL, receives the
+ * per-frame per-channel RMS; seen collects the window sequences. */
+static int test_decode_pass(raac_t *a, float *pcm, float *rms,
+      unsigned *seen)
+{
+   const unsigned char *p = test_fix_au;
+   unsigned f;
+   raac_reset(a);
+   for (f = 0; f < sizeof(test_fix_size) / sizeof(test_fix_size[0]); f++)
+   {
+      int ret = raac_decode_f32(a, p, test_fix_size[f], pcm);
+      p += test_fix_size[f];
+      if (ret != 1024)
+      {
+         printf("FAIL: access unit %u returned %d\n", f, ret);
+         return 1;
+      }
+      if (seen)
+         *seen |= (1u << a->ch[0].window_sequence)
+                | (1u << a->ch[1].window_sequence);
+      if (rms)
+      {
+         int ch, i;
+         for (ch = 0; ch < 2; ch++)
+         {
+            double s = 0.0;
+            for (i = 0; i < 1024; i++)
+               s += (double)pcm[2 * i + ch] * pcm[2 * i + ch];
+            rms[2 * f + ch] = (float)sqrt(s / 1024.0);
+         }
+      }
+   }
+   return 0;
+}
+
+int main(int argc, char **argv)
+{
+   static float pcm[RAAC_MAX_FRAME * 2];
+   static float rms[sizeof(test_fix_rms) / sizeof(test_fix_rms[0])];
+   static const uint8_t asc_960[2] = { 0x12, 0x14 };
+   unsigned frames = sizeof(test_fix_size) / sizeof(test_fix_size[0]);
+   unsigned seen   = 0, i;
+   int      passes = (argc > 1) ? atoi(argv[1]) : 200;
+   int      fails  = 0, p;
+   raac_t  *a;
+   clock_t  t0;
+   double   secs;
+
+#if defined(RAAC_HAVE_SSE)
+   printf("raac transform path: SSE\n");
+#elif defined(RAAC_HAVE_NEON)
+   printf("raac transform path: NEON\n");
+#else
+   printf("raac transform path: scalar\n");
+#endif
+
+   if (!(a = raac_open(asc_960, sizeof(asc_960))))
+   {
+      printf("FAIL: 960-frame configuration refused\n");
+      return 1;
+   }
+   fails += test_imdct(a, 1920);
+   fails += test_imdct(a, 240);
+   raac_close(a);
+
+   if (!(a = raac_open(test_fix_asc, sizeof(test_fix_asc))))
+   {
+      printf("FAIL: fixture configuration refused\n");
+      return 1;
+   }
+   fails += test_imdct(a, 2048);
+   fails += test_imdct(a, 256);
+
+   if (test_decode_pass(a, pcm, rms, &seen))
+   {
+      raac_close(a);
+      return 1;
+   }
+   if (seen != 0xF)
+   {
+      printf("FAIL: fixture exercised window sequences 0x%x, not 0xf\n",
+            seen);
+      fails++;
+   }
+   for (i = 0; i < 2 * frames; i++)
+   {
+      float want = test_fix_rms[i];
+      if (fabs(rms[i] - want) > want * 1e-3 + 1e-6)
+      {
+         printf("FAIL: frame %u channel %u: rms %g, ffmpeg %g\n",
+               i / 2, i % 2, rms[i], want);
+         fails++;
+      }
+   }
+   if (!fails)
+      printf("ok:   %u frames match ffmpeg's per-frame rms\n", frames);
+
+   t0 = clock();
+   for (p = 0; p < passes; p++)
+      if (test_decode_pass(a, pcm, NULL, NULL))
+      {
+         fails++;
+         break;
+      }
+   secs = (double)(clock() - t0) / CLOCKS_PER_SEC;
+   if (p == passes && secs > 0.0)
+      printf("bench: %d x %u frames in %.3f s: %.1f us/frame, %.0fx real time\n",
+            passes, frames, secs, secs * 1e6 / ((double)passes * frames),
+            (double)passes * frames * 1024.0 / 44100.0 / secs);
+   raac_close(a);
+
+   if (fails)
+   {
+      printf("%d check(s) failed\n", fails);
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,187 @@
+#!/usr/bin/env python3
+"""Writes a compressed version 5 CHD, and a child of it, without chdman.
+
+The staging ring and the shared hunk cache are only worth testing on
+hunks a codec has to decode and on a child that references its parent,
+and rchd_write_* only writes uncompressed images with neither.  This
+writes both, straight from FORMAT.md:
+
+  parent.chd  48 hunks of 16 KiB: LZMA, deflate, and stored hunks of
+              noise that neither codec shrinks
+  child.chd   the parent with a third of its hunks changed; the rest
+              are references into the parent, at their own position
+              and at another hunk's
+
+each beside the .raw it was made from, which is what a read of it has
+to give back.  The map's code tree gives all sixteen codes four bits,
+a complete tree that needs no frequencies, and no run-length codes are
+written: the point is to be decoded, not to be small.
+
+    make_test_chd.py <out-dir>
+
+then, for instance:
+
+    rchd_pipeline_test <out-dir>/parent.chd 8 4
+    rchd_cache_test <out-dir>/parent.chd <out-dir>/parent.raw \\
+                    <out-dir>/child.chd <out-dir>/child.raw
+"""
+import hashlib, lzma, os, struct, sys, zlib
+
+HUNK_BYTES = 16384
+UNIT_BYTES = 512
+HUNKS      = 48
+
+CODEC_LZMA = b'lzma'
+CODEC_ZLIB = b'zlib'
+
+TYPE_0, TYPE_1  = 0, 1          # compressors[0] and [1]
+NONE, PARENT    = 4, 6
+PARENT_SELF     = 11
+
+def crc16(data):
+    """CRC-16/CCITT from 0xffff, as encoding_crc16_ccitt()."""
+    crc = 0xffff
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021 if crc & 0x8000 else crc << 1) & 0xffff
+    return crc
+
+class Bits:
+    """Most significant bit first, as rhuff_bits_read() takes them."""
+    def __init__(self):
+        self.out, self.acc, self.n = bytearray(), 0, 0
+    def put(self, value, bits):
+        for i in range(bits - 1, -1, -1):
+            self.acc = (self.acc << 1) | ((value >> i) & 1)
+            self.n  += 1
+            if self.n == 8:
+                self.out.append(self.acc)
+                self.acc, self.n = 0, 0
+    def done(self):
+        if self.n:
+            self.out.append(self.acc << (8 - self.n))
+            self.acc, self.n = 0, 0
+        return bytes(self.out)
+
+def deflate(data):
+    z = zlib.compressobj(9, zlib.DEFLATED, -15)
+    return z.compress(data) + z.flush()
+
+def lzma_raw(data):
+    # lc/lp/pb as rchd_lzma_props() derives them; any dictionary up to
+    # the one it derives from the hunk size will do.
+    return lzma.compress(data, format=lzma.FORMAT_RAW, filters=[{
+        'id': lzma.FILTER_LZMA1, 'dict_size': HUNK_BYTES,
+        'lc': 3, 'lp': 0, 'pb': 2, 'preset': 9}])
+
+def hunk_content(seed, n):
+    """Runs of a hunk-specific byte broken up by noise; every fifth
+    hunk is all noise, which no codec shrinks and so is stored."""
+    out, s = bytearray(), (seed * 2654435761 + n * 40503) & 0xffffffff
+    for i in range(HUNK_BYTES):
+        s = (s * 1103515245 + 12345) & 0xffffffff
+        if n % 5 == 4 or i % 64 >= 40:
+            out.append(s >> 24)
+        else:
+            out.append((seed + n + i // 64) & 0xff)
+    return bytes(out)
+
+def write_chd(path, raw, refs=None, parent_sha1=b'\0' * 20):
+    """@refs maps a hunk to the parent unit it references."""
+    refs    = refs or {}
+    hunks   = [raw[i:i + HUNK_BYTES] for i in range(0, len(raw), HUNK_BYTES)]
+    data    = bytearray()
+    entries = []                # (code, length, offset, crc)
+    offset  = 124
+
+    for n, h in enumerate(hunks):
+        crc = crc16(h)
+        if n in refs:
+            unit = refs[n]
+            code = PARENT_SELF if unit * UNIT_BYTES == n * HUNK_BYTES \
+                   else PARENT
+            entries.append((code, 0, unit, 0))
+            continue
+        # Alternate the codecs rather than take the smaller, so that
+        # both are decoded whatever the data.
+        code, packed = (TYPE_0, lzma_raw(h)) if n % 2 == 0 \
+                       else (TYPE_1, deflate(h))
+        if len(packed) >= HUNK_BYTES:
+            code, packed = NONE, h
+        entries.append((code, len(packed), offset, crc))
+        data   += packed
+        offset += len(packed)
+
+    map_offset = offset
+    lengthbits = max(e[1] for e in entries).bit_length()
+    parentbits = max([1] + [e[2].bit_length()
+                            for e in entries if e[0] == PARENT])
+
+    bits = Bits()
+    for _ in range(16):
+        bits.put(4, 4)          # sixteen lengths of four: codes 0..15
+    for e in entries:
+        bits.put(e[0], 4)
+    check = bytearray()
+    for code, length, off, crc in entries:
+        if code <= 3:
+            bits.put(length, lengthbits)
+            bits.put(crc, 16)
+        elif code == NONE:
+            bits.put(crc, 16)
+        elif code == PARENT:
+            bits.put(off, parentbits)
+        if code == PARENT_SELF:
+            code = PARENT
+        check += struct.pack('>B', code) + length.to_bytes(3, 'big') \
+               + off.to_bytes(6, 'big') + struct.pack('>H', crc)
+    body = bits.done()
+    map_header = struct.pack('>I', len(body)) + (124).to_bytes(6, 'big') \
+               + struct.pack('>HBBBB', crc16(check), lengthbits, 0,
+                             parentbits, 0)
+
+    raw_sha1 = hashlib.sha1(raw).digest()
+    # With no metadata the overall hash covers the raw one alone.
+    sha1     = hashlib.sha1(raw_sha1).digest()
+    header   = b'MComprHD' + struct.pack('>II', 124, 5) \
+             + CODEC_LZMA + CODEC_ZLIB + b'\0' * 8 \
+             + struct.pack('>QQQII', len(raw), map_offset, 0,
+                           HUNK_BYTES, UNIT_BYTES) \
+             + raw_sha1 + sha1 + parent_sha1
+
+    with open(path, 'wb') as f:
+        f.write(header + data + map_header + body)
+    return sha1
+
+def main():
+    if len(sys.argv) != 2:
+        print(__doc__)
+        return 2
+    out = sys.argv[1]
+    os.makedirs(out, exist_ok=True)
+
+    parent = b''.join(hunk_content(1, n) for n in range(HUNKS))
+    sha1   = write_chd(os.path.join(out, 'parent.chd'), parent)
+
+    child, refs = bytearray(), {}
+    per_hunk    = HUNK_BYTES // UNIT_BYTES
+    for n in range(HUNKS):
+        if n % 3 == 1:
+            child += hunk_content(2, n)         # changed
+        elif n % 3 == 2:
+            src    = (n * 7) % HUNKS            # another hunk's
+            refs[n] = src * per_hunk
+            child += parent[src * HUNK_BYTES:(src + 1) * HUNK_BYTES]
+        else:
+            refs[n] = n * per_hunk              # its own position
+            child += parent[n * HUNK_BYTES:(n + 1) * HUNK_BYTES]
+    write_chd(os.path.join(out, 'child.chd'), bytes(child), refs, sha1)
+
+    for name, raw in (('parent.raw', parent), ('child.raw', child)):
+        with open(os.path.join(out, name), 'wb') as f:
+            f.write(raw)
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,155 @@
+/* Reads an image through two handles with the shared hunk cache on,
+ * and checks the second decodes nothing the first already did. Given
+ * a child image of the first as well, reads it with the first bound as
+ * its parent, and checks its parent references resolve from the cache
+ * rather than by decoding the parent again. Everything read is checked
+ * against the image's uncompressed source.
+ *
+ * Then does it all again with a budget of a few hunks, which has to
+ * evict, and must still read back the same bytes.
+ *
+ *   cc -I libretro-common/include -DHAVE_THREADS \
+ *      -DHAVE_RCHD_DEFLATE -DHAVE_RCHD_LZMA \
+ *      -o rchd_cache_test <this> <rchd.c and its deps> \
+ *      <rthreads.c> <features_cpu.c> -lpthread
+ *
+ *   rchd_cache_test image.chd image.raw [child.chd child.raw]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <formats/rchd.h>
+
+typedef struct { uint8_t *d; size_t n; } blob_t;
+
+static rchd_t *g_parent;
+static blob_t  g_parent_img;
+
+static int load(const char *p, blob_t *b)
+{
+   FILE *f = fopen(p, "rb");
+   if (!f) return 0;
+   fseek(f, 0, SEEK_END); b->n = ftell(f); fseek(f, 0, SEEK_SET);
+   b->d = malloc(b->n);
+   if (fread(b->d, 1, b->n, f) != b->n) return 0;
+   fclose(f);
+   return 1;
+}
+
+static const blob_t *source_of(const blob_t *img, const rchd_request_t *r)
+{
+   const blob_t *src = r->source == RCHD_SOURCE_PARENT ? &g_parent_img : img;
+   return r->offset + r->length > src->n ? NULL : src;
+}
+
+static int pull(rchd_t *c, const blob_t *img, const rchd_request_t *r)
+{
+   const blob_t *src = source_of(img, r);
+   if (!src) return 0;
+   return rchd_feed(c, src->d + r->offset, r->length) == RCHD_OK;
+}
+
+static rchd_t *open_image(const blob_t *img, uint32_t depth, unsigned threads)
+{
+   rchd_request_t rq; int e; rchd_t *c = rchd_new();
+   while ((e = rchd_open_step(c, &rq)) == RCHD_PENDING)
+      if (!pull(c, img, &rq)) break;
+   if (e != RCHD_OK) { rchd_free(c); return NULL; }
+   rchd_set_pipeline_depth(c, depth);
+   rchd_set_threads(c, threads);
+   return c;
+}
+
+/* Reads every hunk, feeding whatever is asked for, and returns how many
+ * differ from @raw. */
+static uint32_t read_all(rchd_t *c, const blob_t *img, const blob_t *raw)
+{
+   const rchd_info_t *i = rchd_info(c);
+   uint8_t *hunk = malloc(i->hunk_bytes);
+   uint32_t n, bad = 0;
+   for (n = 0; n < i->hunk_count; n++)
+   {
+      rchd_request_t rq, reqs[8]; uint32_t k, m; int e;
+      if (rchd_read_hunk_begin(c, n, hunk) != RCHD_OK) { bad++; continue; }
+      for (;;)
+      {
+         /* A child's read-ahead can ask for its parent's bytes too. */
+         m = rchd_read_pending(c, reqs, 8);
+         for (k = 0; k < m; k++)
+         {
+            const blob_t *src = source_of(img, &reqs[k]);
+            if (src)
+               rchd_feed_at(c, reqs[k].offset, reqs[k].source,
+                     src->d + reqs[k].offset, reqs[k].length);
+         }
+         if ((e = rchd_read_step(c, &rq)) != RCHD_PENDING) break;
+         if (!pull(c, img, &rq)) break;
+      }
+      if (e != RCHD_OK
+            || memcmp(hunk, raw->d + (size_t)n * i->hunk_bytes, i->hunk_bytes))
+         bad++;
+   }
+   free(hunk);
+   return bad;
+}
+
+static int run(size_t budget, int argc, char **argv)
+{
+   blob_t img, raw, cimg, craw;
+   rchd_cache_stats_t s0, s1, s2;
+   rchd_t *a, *b;
+   uint32_t bad = 0;
+
+   rchd_cache_init(budget);
+   load(argv[1], &img); load(argv[2], &raw);
+   a = open_image(&img, 1, 1);
+   b = open_image(&img, 8, 4);
+   if (!a || !b) { printf("  open failed\n"); return 1; }
+
+   bad += read_all(a, &img, &raw);
+   rchd_cache_stats(&s0);
+   bad += read_all(b, &img, &raw);
+   rchd_cache_stats(&s1);
+   printf("  budget %-9lu first: %lu misses  second: %lu hits %lu misses"
+          "  evictions %lu\n", (unsigned long)budget,
+          (unsigned long)s0.misses, (unsigned long)(s1.hits - s0.hits),
+          (unsigned long)(s1.misses - s0.misses),
+          (unsigned long)s1.evictions);
+   if (!s1.evictions && (s1.misses != s0.misses || s1.hits == s0.hits))
+      bad++;
+
+   if (argc > 4)
+   {
+      rchd_t *c;
+      uint32_t cb;
+      load(argv[3], &cimg); load(argv[4], &craw);
+      g_parent = a; g_parent_img = img;
+      if (!(c = open_image(&cimg, 8, 4)) || rchd_set_parent(c, a) != RCHD_OK)
+      { printf("  child open failed\n"); return 1; }
+      cb = read_all(c, &cimg, &craw);
+      rchd_cache_stats(&s2);
+      printf("  child: %lu hits %lu misses, %u bad\n",
+             (unsigned long)(s2.hits - s1.hits),
+             (unsigned long)(s2.misses - s1.misses), cb);
+      bad += cb;
+      if (!s1.evictions && s2.hits == s1.hits)
+         bad++;
+      rchd_free(c);
+      free(cimg.d); free(craw.d);
+   }
+
+   rchd_free(a); rchd_free(b);
+   free(img.d); free(raw.d);
+   rchd_cache_deinit();
+   printf("  %-44s %s\n", argv[1], bad ? "FAIL" : "PASS");
+   return bad ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+   int r;
+   if (argc < 3) return 2;
+   r  = run((size_t)1 << 30, argc, argv);
+   r |= run((size_t)4 * 65536, argc, argv);
+   return r;
+}
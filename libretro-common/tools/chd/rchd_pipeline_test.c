@@ -0,0 +1,116 @@
+/* Reads every hunk of an image through the staging ring and compares
+ * against a plain ping-pong read of the same hunk.
+ *
+ * The ring is driven the way an asynchronous caller drives it: every
+ * request rchd_read_pending() reports is collected first and supplied
+ * afterwards in reverse, so supplies land out of order, with half of
+ * them borrowed rather than copied. The pass is made in order, which
+ * is what the read-ahead keys on, and then in a scattered order,
+ * which it must not get wrong.
+ *
+ *   cc -I libretro-common/include -DHAVE_THREADS \
+ *      -DHAVE_RCHD_DEFLATE -DHAVE_RCHD_LZMA \
+ *      -o rchd_pipeline_test <this> <rchd.c and its deps> \
+ *      <rthreads.c> <features_cpu.c> -lpthread
+ *
+ *   rchd_pipeline_test image.chd [depth [threads]]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <formats/rchd.h>
+
+static uint8_t *img;
+static size_t   img_len;
+
+static int pull(rchd_t *c, const rchd_request_t *r)
+{
+   if (r->offset + r->length > img_len) return 0;
+   return rchd_feed(c, img + r->offset, r->length) == RCHD_OK;
+}
+
+static rchd_t *open_image(void)
+{
+   rchd_request_t rq; int e; rchd_t *c = rchd_new();
+   while ((e = rchd_open_step(c, &rq)) == RCHD_PENDING)
+      if (!pull(c, &rq)) break;
+   if (e != RCHD_OK) { rchd_free(c); return NULL; }
+   return c;
+}
+
+/* Supplies everything the ring asks for, latest first. */
+static int supply_all(rchd_t *c, uint32_t depth, unsigned long *fed)
+{
+   rchd_request_t reqs[64];
+   uint32_t n = rchd_read_pending(c, reqs, depth), i;
+   for (i = n; i-- > 0; )
+   {
+      const rchd_request_t *r = &reqs[i];
+      int e;
+      if (r->source != RCHD_SOURCE_SELF || r->offset + r->length > img_len)
+         return 0;
+      e = (i & 1)
+         ? rchd_feed_borrow(c, r->offset, r->source, img + r->offset, r->length)
+         : rchd_feed_at(c, r->offset, r->source, img + r->offset, r->length);
+      if (e != RCHD_OK) return 0;
+      (*fed)++;
+   }
+   return 1;
+}
+
+static int read_hunk(rchd_t *c, uint32_t n, uint8_t *dst, uint32_t depth,
+      unsigned long *fed)
+{
+   rchd_request_t rq; int e;
+   if (rchd_read_hunk_begin(c, n, dst) != RCHD_OK) return -1;
+   for (;;)
+   {
+      if (!supply_all(c, depth, fed)) return -1;
+      if ((e = rchd_read_step(c, &rq)) != RCHD_PENDING) return e;
+      if (!pull(c, &rq)) return -1;
+   }
+}
+
+int main(int argc, char **argv)
+{
+   FILE *f; rchd_t *a, *b; rchd_request_t rq; const rchd_info_t *i;
+   uint8_t *want, *got; uint32_t n, k, bad = 0, depth = 8;
+   unsigned threads = 4; unsigned long fed = 0; int e;
+
+   if (argc < 2) return 2;
+   if (argc > 2) depth = (uint32_t)atoi(argv[2]);
+   if (argc > 3) threads = (unsigned)atoi(argv[3]);
+   if (!(f = fopen(argv[1], "rb"))) return 1;
+   fseek(f, 0, SEEK_END); img_len = ftell(f); fseek(f, 0, SEEK_SET);
+   img = malloc(img_len);
+   if (fread(img, 1, img_len, f) != img_len) return 1;
+   fclose(f);
+
+   if (!(a = open_image()) || !(b = open_image()))
+   { printf("  open failed\n"); return 1; }
+   if (rchd_set_pipeline_depth(b, depth) != RCHD_OK
+         || rchd_set_threads(b, threads) != RCHD_OK)
+   { printf("  depth %u refused\n", depth); return 1; }
+
+   i = rchd_info(a); want = malloc(i->hunk_bytes); got = malloc(i->hunk_bytes);
+   for (k = 0; k < 2 * i->hunk_count; k++)
+   {
+      /* In order, then scattered: 7919 is prime, so this visits each. */
+      n = k < i->hunk_count ? k
+        : (uint32_t)(((uint64_t)(k - i->hunk_count) * 7919) % i->hunk_count);
+      if (rchd_read_hunk_begin(a, n, want) != RCHD_OK) { bad++; continue; }
+      while ((e = rchd_read_step(a, &rq)) == RCHD_PENDING)
+         if (!pull(a, &rq)) break;
+      if (e != RCHD_OK) { bad++; continue; }
+      if ((e = read_hunk(b, n, got, depth, &fed)) != RCHD_OK
+            || memcmp(want, got, i->hunk_bytes))
+      {
+         if (bad < 3) printf("    hunk %u differs: step=%d\n", n, e);
+         bad++;
+      }
+   }
+   printf("  %-44s depth %-2u threads %-2u fetches %-6lu %s\n", argv[1],
+          depth, threads, fed, bad ? "FAIL" : "PASS");
+   rchd_free(a); rchd_free(b); free(want); free(got); free(img);
+   return bad ? 1 : 0;
+}
@@ -1594,7 +1594,11 @@ static int vfs_stat_win32_wide(const char *path,
 #endif
 #endif
 
-int retro_vfs_stat_64_impl(const char *path, int64_t *size)
+/* retro_vfs_stat_64_impl() with the modification time as well, for
+ * the platforms whose stat carries one; @mtime is left alone on the
+ * others, which is how the caller tells. */
+static int retro_vfs_stat_internal(const char *path, int64_t *size,
+      int64_t *mtime)
 {
    int ret                   = RETRO_VFS_STAT_IS_VALID;
 
@@ -1695,6 +1699,8 @@ int retro_vfs_stat_64_impl(const char *path, int64_t *size)
 
       if (size)
          *size = (int64_t)stat_buf.st_size;
+      if (mtime)
+         *mtime = (int64_t)stat_buf.st_mtime;
 
       if (file_info & FILE_ATTRIBUTE_DIRECTORY)
          ret  |= RETRO_VFS_STAT_IS_DIRECTORY;
@@ -1715,6 +1721,8 @@ int retro_vfs_stat_64_impl(const char *path, int64_t *size)
 
       if (size)
          *size = (int64_t)stat_buf.st_size;
+      if (mtime)
+         *mtime = (int64_t)stat_buf.st_mtime;
 
       if (S_ISDIR(stat_buf.st_mode))
          ret |= RETRO_VFS_STAT_IS_DIRECTORY;
@@ -1741,6 +1749,8 @@ int retro_vfs_stat_64_impl(const char *path, int64_t *size)
 
       if (size)
          *size = (int64_t)stat_buf.st_size;
+      if (mtime)
+         *mtime = (int64_t)stat_buf.st_mtime;
 
       if (S_ISDIR(stat_buf.st_mode))
          ret |= RETRO_VFS_STAT_IS_DIRECTORY;
@@ -1751,6 +1761,17 @@ int retro_vfs_stat_64_impl(const char *path, int64_t *size)
    return ret;
 }
 
+int retro_vfs_stat_64_impl(const char *path, int64_t *size)
+{
+   return retro_vfs_stat_internal(path, size, NULL);
+}
+
+int retro_vfs_stat_mtime_impl(const char *path, int64_t *size,
+      int64_t *mtime)
+{
+   return retro_vfs_stat_internal(path, size, mtime);
+}
+
 int retro_vfs_stat_impl(const char *path, int32_t *size)
 {
    int64_t size64 = 0;
@@ -829,6 +829,7 @@ int main(int argc, char** argv)
    const char* rdb_path;
    dat_converter_match_key_t* match_key = NULL;
    intfstream_t* rdb_file;
+   libretrodb_t* rdb;
 
    if (argc < 2)
    {
@@ -911,6 +912,20 @@ int main(int argc, char** argv)
 
    intfstream_close(rdb_file);
 
+   /* Index the crc: a scan looks content up by it, and a query that
+    * pins the field an index is named after seeks through the index
+    * instead of walking every record. */
+   rdb = libretrodb_new();
+   if (     !rdb
+         || libretrodb_open(rdb_path, rdb, true) != 0
+         || libretrodb_create_index(rdb, "crc", "crc") != 0)
+      printf("  could not index crc in '%s'\n", rdb_path);
+   if (rdb)
+   {
+      libretrodb_close(rdb);
+      libretrodb_free(rdb);
+   }
+
    dat_converter_list_free(dat_parser_list);
 
    while (dat_count--)
@@ -30,6 +30,15 @@
 #include <sys/stat.h>
 #include <stdlib.h>
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
+
 #include <streams/file_stream.h>
 #include <retro_endianness.h>
 #include <string/stdstring.h>
@@ -118,6 +127,11 @@ struct libretrodb_cursor
    intfstream_t *fd;
    libretrodb_query_t *query;
    libretrodb_t *db;
+   /* Record offsets an index lookup narrowed the query to, in file
+    * order.  NULL when the cursor walks every record. */
+   uint64_t *seek;
+   size_t seek_count;
+   size_t seek_pos;
    int is_valid;
    int eof;
 };
@@ -328,7 +342,10 @@ static int libretrodb_find_index(libretrodb_t *db, const char *index_name,
         break;
       }
 
-      if (strncmp(index_name, idx->name, strlen(idx->name)) == 0)
+      /* Whole-name match.  Comparing only strlen(idx->name) bytes let
+       * an index named "crc" answer for "crc32", and an empty name
+       * answer for anything. */
+      if (strncmp(index_name, idx->name, sizeof(idx->name)) == 0)
          return 0;
 
       /* idx->next is a file-supplied relative seek.  Zero re-reads
@@ -346,121 +363,112 @@ static int libretrodb_find_index(libretrodb_t *db, const char *index_name,
    return -1;
 }
 
+/* idx->next, idx->count and idx->key_size all come from the file
+ * with no relationship enforced between them.  The search below walks
+ * idx->count entries of (key_size + 8) bytes, so without this check a
+ * small "next" and a large "count" send it past the payload the header
+ * reserved.  Degenerate key sizes are rejected outright. */
+static int libretrodb_index_check(const libretrodb_index_t *idx)
+{
+   uint64_t item_size;
+
+   if (idx->key_size == 0 || idx->key_size > LIBRETRODB_MAX_KEY_SIZE)
+      return -1;
+
+   item_size = idx->key_size + sizeof(uint64_t);
+   if (idx->count > idx->next / item_size)
+      return -1;
+   if (idx->next > (uint64_t)INT64_MAX)
+      return -1;
+   return 0;
+}
+
+/* Reads entry @pos of @idx, whose payload starts at @base in @fd, into
+ * @entry: key_size key bytes followed by a uint64 offset. */
+static int libretrodb_index_read(intfstream_t *fd, uint64_t base,
+      const libretrodb_index_t *idx, uint64_t pos, uint8_t *entry)
+{
+   uint64_t item_size = idx->key_size + sizeof(uint64_t);
+
+   if (intfstream_seek(fd, (int64_t)(base + pos * item_size),
+            RETRO_VFS_SEEK_POSITION_START) < 0)
+      return -1;
+   if (intfstream_read(fd, entry, item_size) != (int64_t)item_size)
+      return -1;
+   return 0;
+}
+
 /**
- * binsearch:
- *
- * Locate @item in the @count fixed-size entries at @buff and return
- * the record offset stored alongside it.  Each entry is @field_size
- * key bytes followed by a uint64 offset.
+ * libretrodb_index_search:
  *
- * The previous recursive form had three defects, all reachable from
- * a malformed index header:
+ * Locate the first of the sorted entries of @idx, whose payload starts
+ * at @base in @fd, that holds @key.  A key can be held more than once -
+ * one entry per record carrying it, in file order - so the rest follow
+ * it directly; @pos is where it is, for a caller that wants them too,
+ * and @offset is the record offset stored alongside it.
  *
- *  - the memcmp() ran before the "count == 0" test, so an empty
- *    sub-range was compared against buff[0..field_size) - a read past
- *    the end of the allocation whenever the search narrowed to
- *    nothing;
- *  - the tail call passed "count - mid", and mid is 0 when count is
- *    1, so a one-element range recursed on itself forever, walking
- *    further past the buffer on each step until it faulted;
- *  - the offset was read with *(uint64_t*)(current + field_size).
- *    field_size comes from the file, so unless it is a multiple of
- *    eight every entry after the first is misaligned - undefined
- *    behaviour that UBSan flags and that faults outright on
- *    strict-alignment targets.
+ * Probes the file one entry at a time instead of loading the payload:
+ * a lookup then reads log2(count) entries rather than all of them,
+ * which is what makes an index worth consulting from a cursor.
  *
- * Iterative, half-open [lo, hi), and the offset is assembled with
- * memcpy so alignment never matters.
+ * Half-open [lo, hi), so an empty range is never compared against, and
+ * the offset is assembled with memcpy so that alignment never matters
+ * - key_size comes from the file and is rarely a multiple of eight.
  */
-static int binsearch(const void *buff, const void *item,
-      uint64_t count, uint64_t field_size, uint64_t *offset)
+static int libretrodb_index_search(intfstream_t *fd, uint64_t base,
+      const libretrodb_index_t *idx, const void *key, uint64_t *pos,
+      uint64_t *offset)
 {
+   uint8_t  entry[LIBRETRODB_MAX_KEY_SIZE + sizeof(uint64_t)];
    uint64_t lo        = 0;
-   uint64_t hi        = count;
-   uint64_t item_size = field_size + sizeof(uint64_t);
-
-   if (field_size == 0)
-      return -1;
+   uint64_t hi        = idx->count;
 
    while (lo < hi)
    {
-      uint64_t mid           = lo + ((hi - lo) / 2);
-      const uint8_t *current = (const uint8_t *)buff + (mid * item_size);
-      int rv                 = memcmp(current, item, (size_t)field_size);
+      uint64_t mid = lo + ((hi - lo) / 2);
 
-      if (rv == 0)
-      {
-         memcpy(offset, current + field_size, sizeof(uint64_t));
-         return 0;
-      }
+      if (libretrodb_index_read(fd, base, idx, mid, entry) < 0)
+         return -1;
 
-      if (rv > 0)
-         hi = mid;
-      else
+      if (memcmp(entry, key, (size_t)idx->key_size) < 0)
          lo = mid + 1;
+      else
+         hi = mid;
    }
 
-   return -1;
+   if (     lo >= idx->count
+         || libretrodb_index_read(fd, base, idx, lo, entry) < 0
+         || memcmp(entry, key, (size_t)idx->key_size) != 0)
+      return -1;
+
+   memcpy(offset, entry + idx->key_size, sizeof(uint64_t));
+   *pos = lo;
+   return 0;
 }
 
 int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
       const void *key, struct rmsgpack_dom_value *out)
 {
    libretrodb_index_t idx;
-   int rv;
-   uint8_t *buff;
-   uint64_t offset;
-   uint64_t item_size;
-   uint64_t bufflen;
-   int64_t  nread = 0;
+   uint64_t pos, offset;
+   int64_t  base;
 
    if (libretrodb_find_index(db, index_name, &idx) < 0)
       return -1;
 
-   /* idx.next, idx.count and idx.key_size all come from the file
-    * with no relationship enforced between them.  binsearch() walks
-    * idx.count entries of (key_size + 8) bytes, so without this
-    * check a small "next" and a large "count" send it off the end of
-    * the allocation.  Require the payload the header describes to
-    * actually fit in the payload the header reserved, and reject
-    * degenerate key sizes outright. */
-   if (idx.key_size == 0 || idx.key_size > LIBRETRODB_MAX_KEY_SIZE)
+   if (libretrodb_index_check(&idx) < 0)
       return -1;
 
-   item_size = idx.key_size + sizeof(uint64_t);
-   if (idx.count > idx.next / item_size)
+   if ((base = intfstream_tell(db->fd)) < 0)
       return -1;
 
-   bufflen        = idx.next;
-   if (bufflen == 0 || bufflen > (uint64_t)INT64_MAX)
+   if (libretrodb_index_search(db->fd, (uint64_t)base, &idx,
+            key, &pos, &offset) < 0)
       return -1;
-   if (!(buff = (uint8_t*)malloc((size_t)bufflen)))
-      return -1;
-
-   while (nread < (int64_t)bufflen)
-   {
-      void *buff_ = (buff + nread);
-      rv          = (int)intfstream_read(db->fd, buff_,
-            (uint64_t)((int64_t)bufflen - nread));
-
-      if (rv <= 0)
-      {
-         free(buff);
-         return -1;
-      }
-      nread += rv;
-   }
 
-   rv = binsearch(buff, key, idx.count, idx.key_size, &offset);
-   free(buff);
-
-   if (rv == 0)
-   {
-      intfstream_seek(db->fd, (ssize_t)offset, RETRO_VFS_SEEK_POSITION_START);
-      rmsgpack_dom_read(db->fd, out);
-      return 0;
-   }
-   return -1;
+   intfstream_seek(db->fd, (ssize_t)offset, RETRO_VFS_SEEK_POSITION_START);
+   rmsgpack_dom_read(db->fd, out);
+   return 0;
 }
 
 /**
@@ -473,7 +481,8 @@ int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
  **/
 int libretrodb_cursor_reset(libretrodb_cursor_t *cursor)
 {
-   cursor->eof = 0;
+   cursor->eof      = 0;
+   cursor->seek_pos = 0;
    return (int)intfstream_seek(cursor->fd,
          (ssize_t)(cursor->db->root + sizeof(libretrodb_header_t)),
          RETRO_VFS_SEEK_POSITION_START);
@@ -573,6 +582,10 @@ static int32_t rmsgpack_read_key_string(intfstream_t *fd,
  * fast path. Typical .rdb records have 10-15 fields. */
 #define CURSOR_MAX_MAP_FIELDS    24
 
+/* Most values a query may pin an indexed field to before the cursor
+ * stops resolving them through the index and walks instead. */
+#define LIBRETRODB_MAX_SEEK_KEYS 64
+
 /**
  * libretrodb_scan_field:
  *
@@ -853,6 +866,29 @@ int libretrodb_cursor_read_item(libretrodb_cursor_t *cursor,
    if (cursor->eof)
       return EOF;
 
+   /* Planned by libretrodb_cursor_plan(): visit only the records the
+    * index led to.  The index settled one field; the rest of the
+    * query still has to hold. */
+   if (cursor->seek)
+   {
+      while (cursor->seek_pos < cursor->seek_count)
+      {
+         uint64_t offset = cursor->seek[cursor->seek_pos++];
+
+         if (intfstream_seek(cursor->fd, (int64_t)offset,
+                  RETRO_VFS_SEEK_POSITION_START) < 0)
+            continue;
+         if ((rv = rmsgpack_dom_read(cursor->fd, out)) < 0)
+            return rv;
+         if (     out->type == RDT_MAP
+               && libretrodb_query_filter(cursor->query, out))
+            return 0;
+         rmsgpack_dom_value_free(out);
+      }
+      cursor->eof = 1;
+      return EOF;
+   }
+
    /* If no query is active, use the original full-DOM path */
    if (!cursor->query)
    {
@@ -1064,11 +1100,155 @@ void libretrodb_cursor_close(libretrodb_cursor_t *cursor)
    if (cursor->query)
       libretrodb_query_free(cursor->query);
 
-   cursor->is_valid = 0;
-   cursor->eof      = 1;
-   cursor->fd       = NULL;
-   cursor->db       = NULL;
-   cursor->query    = NULL;
+   if (cursor->seek)
+      free(cursor->seek);
+
+   cursor->is_valid   = 0;
+   cursor->eof        = 1;
+   cursor->fd         = NULL;
+   cursor->db         = NULL;
+   cursor->query      = NULL;
+   cursor->seek       = NULL;
+   cursor->seek_count = 0;
+   cursor->seek_pos   = 0;
+}
+
+static int libretrodb_offset_cmp(const void *a, const void *b)
+{
+   uint64_t x = *(const uint64_t*)a;
+   uint64_t y = *(const uint64_t*)b;
+   return (x > y) - (x < y);
+}
+
+/**
+ * libretrodb_cursor_plan:
+ *
+ * Look for a field that @q pins to fixed values and that the
+ * database carries an index of the same name for, and if there is one,
+ * resolve the values through the index up front so the cursor visits
+ * only those records.  A query over a crc then costs a handful of index
+ * probes per value instead of a walk over every record.
+ *
+ * The format indexes fixed-width binary keys only, so the values have
+ * to be binary too.  One of the index's width is a candidate; one of
+ * another width cannot equal any indexed record, and a record without
+ * the field reads as nil, which no binary value equals either - so it
+ * is dropped.  Anything else (a string, an int, nil) could match
+ * records the index does not hold, and rules the field out.
+ *
+ * A key the index holds more than once yields every record holding
+ * it.  Offsets are sorted so that results come back in file order, as
+ * they do from a full walk.
+ *
+ * Returns: 0 if the cursor was planned, -1 to walk every record.
+ **/
+static int libretrodb_cursor_plan(libretrodb_t *db,
+      libretrodb_cursor_t *cursor, libretrodb_query_t *q)
+{
+   const char *fields[CURSOR_MAX_MAP_FIELDS];
+   uint32_t    field_lens[CURSOR_MAX_MAP_FIELDS];
+   int         num_fields;
+   int         i;
+
+   if (!db->fd)
+      return -1;
+
+   num_fields = libretrodb_query_get_filter_fields(q, fields, field_lens,
+         CURSOR_MAX_MAP_FIELDS);
+   if (num_fields > CURSOR_MAX_MAP_FIELDS)
+      num_fields = CURSOR_MAX_MAP_FIELDS;
+
+   for (i = 0; i < num_fields; i++)
+   {
+      const struct rmsgpack_dom_value *keys[LIBRETRODB_MAX_SEEK_KEYS];
+      libretrodb_index_t idx;
+      int64_t   base;
+      uint64_t *seek;
+      size_t    seek_cap;
+      size_t    seek_count = 0;
+      int       num_keys;
+      int       j;
+
+      if ((num_keys = libretrodb_query_get_seek_keys(q, fields[i],
+                  field_lens[i], keys, LIBRETRODB_MAX_SEEK_KEYS)) < 0)
+         continue;
+
+      for (j = 0; j < num_keys; j++)
+         if (keys[j]->type != RDT_BINARY)
+            break;
+      if (j < num_keys)
+         continue;
+
+      /* A payload running past the end of the file would read as
+       * keys that are not there, not as an error. */
+      if (     libretrodb_find_index(db, fields[i], &idx) < 0
+            || libretrodb_index_check(&idx) < 0
+            || (base = intfstream_tell(db->fd)) < 0
+            || (uint64_t)base + idx.next
+               > (uint64_t)intfstream_get_size(db->fd))
+         continue;
+
+      seek_cap = num_keys ? num_keys : 1;
+      if (!(seek = (uint64_t*)malloc(seek_cap * sizeof(*seek))))
+         return -1;
+
+      for (j = 0; j < num_keys; j++)
+      {
+         uint8_t  entry[LIBRETRODB_MAX_KEY_SIZE + sizeof(uint64_t)];
+         uint64_t pos, offset;
+
+         if (keys[j]->val.binary.len != idx.key_size)
+            continue;
+         if (libretrodb_index_search(db->fd, (uint64_t)base, &idx,
+                  keys[j]->val.binary.buff, &pos, &offset) < 0)
+            continue;
+
+         /* The first entry with the key, then any after it that
+          * hold it too. */
+         for (;;)
+         {
+            if (seek_count == seek_cap)
+            {
+               uint64_t *grown = (uint64_t*)realloc(seek,
+                     seek_cap * 2 * sizeof(*seek));
+               if (!grown)
+               {
+                  free(seek);
+                  return -1;
+               }
+               seek      = grown;
+               seek_cap *= 2;
+            }
+            seek[seek_count++] = offset;
+
+            if (     ++pos >= idx.count
+                  || libretrodb_index_read(db->fd, (uint64_t)base, &idx,
+                        pos, entry) < 0
+                  || memcmp(entry, keys[j]->val.binary.buff,
+                        (size_t)idx.key_size) != 0)
+               break;
+            memcpy(&offset, entry + idx.key_size, sizeof(uint64_t));
+         }
+      }
+
+      if (seek_count > 1)
+      {
+         size_t k, n = 1;
+         qsort(seek, seek_count, sizeof(*seek), libretrodb_offset_cmp);
+         /* or() may name a value twice */
+         for (k = 1; k < seek_count; k++)
+            if (seek[k] != seek[n - 1])
+               seek[n++] = seek[k];
+         seek_count = n;
+      }
+
+      cursor->seek       = seek;
+      cursor->seek_count = seek_count;
+      cursor->seek_pos   = 0;
+      return 0;
+   }
+
+   return -1;
 }
 
 /**
@@ -1101,11 +1281,13 @@ int libretrodb_cursor_open(libretrodb_t *db,
                   RETRO_VFS_FILE_ACCESS_HINT_NONE)))
          return -1;
 
-   cursor->fd       = fd;
-   cursor->db       = db;
-   cursor->is_valid = 1;
+   cursor->fd         = fd;
+   cursor->db         = db;
+   cursor->is_valid   = 1;
+   cursor->seek       = NULL;
+   cursor->seek_count = 0;
    libretrodb_cursor_reset(cursor);
-   cursor->query    = q;
+   cursor->query      = q;
 
    if (q)
    {
@@ -1116,6 +1298,7 @@ int libretrodb_cursor_open(libretrodb_t *db,
        * the cursor that references it, and a second walk over the
        * same query used to inherit the first walk's extreme. */
       libretrodb_query_reset_accumulator(q);
+      libretrodb_cursor_plan(db, cursor, q);
    }
 
    return 0;
@@ -1143,9 +1326,19 @@ static int node_iter(void *value, void *ctx)
    return -1;
 }
 
+/* By key, then by record offset: a key several records hold gets an
+ * entry for each, in file order. */
 static int node_compare(const void *a, const void *b, void *ctx)
 {
-   return memcmp(a, b, *(uint8_t *)ctx);
+   uint8_t  key_size = *(uint8_t *)ctx;
+   uint64_t x, y;
+   int      rv;
+
+   if ((rv = memcmp(a, b, key_size)) != 0)
+      return rv;
+   memcpy(&x, (const uint8_t*)a + key_size, sizeof(x));
+   memcpy(&y, (const uint8_t*)b + key_size, sizeof(y));
+   return (x > y) - (x < y);
 }
 
 int libretrodb_create_index(libretrodb_t *db,
@@ -1160,7 +1353,7 @@ int libretrodb_create_index(libretrodb_t *db,
    void *buff                       = NULL;
    uint64_t *buff_u64               = NULL;
    uint8_t field_size               = 0;
-   uint64_t item_loc                = intfstream_tell(db->fd);
+   uint64_t item_loc                = 0;
    bintree_t *tree;
    uint64_t item_count              = 0;
    int rval                         = -1;
@@ -1177,6 +1370,11 @@ int libretrodb_create_index(libretrodb_t *db,
    if (!tree || (libretrodb_cursor_open(db, &cur, NULL) != 0))
       goto clean;
 
+   /* The first record's offset is where the cursor starts.  db->fd
+    * is left at the metadata by libretrodb_open(), so taking it from
+    * there pointed the first record's entry past every record. */
+   item_loc                         = intfstream_tell(cur.fd);
+
    key.type                         = RDT_STRING;
    key.val.string.len               = (uint32_t)strlen(field_name);
    key.val.string.buff              = (char *)field_name;   /* We know we aren't going to change it */
@@ -1220,12 +1418,11 @@ int libretrodb_create_index(libretrodb_t *db,
 
       memcpy(buff_u64, &item_loc, sizeof(uint64_t));
 
-      /* Value is not unique? */
+      /* Keys need not be unique, and with the offset in the
+       * comparison no two entries are equal: this only fails when
+       * the tree cannot grow. */
       if (bintree_insert(tree, tree->root, buff) != 0)
-      {
-         rmsgpack_dom_value_print(field);
          goto clean;
-      }
       item_count++;
       buff     = NULL;
       rmsgpack_dom_value_free(&item);
@@ -1284,6 +1481,9 @@ libretrodb_cursor_t *libretrodb_cursor_new(void)
    dbc->eof                 = 0;
    dbc->query               = NULL;
    dbc->db                  = NULL;
+   dbc->seek                = NULL;
+   dbc->seek_count          = 0;
+   dbc->seek_pos            = 0;
 
    return dbc;
 }
@@ -1316,6 +1516,474 @@ void libretrodb_free(libretrodb_t *db)
       free(db);
 }
 
+/* ------------------------------------------------------------------
+ * In-place reader
+ *
+ * The cursor hands back every record as an rmsgpack_dom_value tree,
+ * which costs an allocation per string and binary in the record plus
+ * one for the map itself - whether or not the caller looks at them.
+ * A caller that wants a few fields out of every record in a database
+ * pays for all of them.
+ *
+ * The reader instead decodes each record where it lies and reports
+ * its fields as views into that storage.  Scalars are decoded as they
+ * are met; strings and binaries are a pointer and a length; nested
+ * containers are only stepped over, and libretrodb_field_decode()
+ * builds the DOM for one of them if a caller really wants it.
+ *
+ * The database is mapped where the platform has mmap() and the path
+ * is a plain host file.  Anywhere else each record is read into one
+ * reusable buffer first, which keeps the same contract at the cost of
+ * a copy.
+ * ------------------------------------------------------------------ */
+
+/* Matches RMSGPACK_MAX_DEPTH in rmsgpack.c: a run of nested
+ * containers in a downloaded file must not become a stack overflow. */
+#define LIBRETRODB_READER_MAX_DEPTH 32
+
+struct libretrodb_reader
+{
+   /* Mapped: the whole file, and pos is the next record.
+    * Streamed: the current record only. */
+   const uint8_t *data;
+   size_t size;
+   size_t pos;
+   intfstream_t *fd;
+   uint8_t *buf;
+   size_t buf_cap;
+#ifdef HAVE_MMAP
+   void *map;
+   size_t map_len;
+#endif
+   int eof;
+};
+
+static uint64_t libretrodb_load_be(const uint8_t *p, unsigned n)
+{
+   uint64_t v = 0;
+   while (n--)
+      v = (v << 8) | *p++;
+   return v;
+}
+
+/**
+ * libretrodb_mem_value:
+ *
+ * Decode the value at @p, bounded by @end, into @f and point @next just
+ * past it.  Containers are stepped over whole, with their element count
+ * in f->val.uint_.
+ *
+ * Returns: 0 on success, -1 if the value is malformed or runs past @end.
+ */
+static int libretrodb_mem_value(const uint8_t *p, const uint8_t *end,
+      libretrodb_field_t *f, const uint8_t **next, unsigned depth)
+{
+   uint8_t  type;
+   uint64_t n      = 0;
+   unsigned width  = 0;
+   uint64_t elems  = 0;
+
+   if (p >= end || depth > LIBRETRODB_READER_MAX_DEPTH)
+      return -1;
+
+   type = *p++;
+
+   if (type < 0x80)                  /* positive fixint */
+   {
+      f->type      = RDT_UINT;
+      f->val.uint_ = type;
+      goto done;
+   }
+   if (type >= 0xe0)                 /* negative fixint */
+   {
+      f->type      = RDT_INT;
+      f->val.int_  = (int8_t)type;
+      goto done;
+   }
+   if (type < 0x90)                  /* fixmap */
+   {
+      f->type      = RDT_MAP;
+      n            = type & 0x0f;
+      elems        = n * 2;
+      goto container;
+   }
+   if (type < 0xa0)                  /* fixarray */
+   {
+      f->type      = RDT_ARRAY;
+      n            = type & 0x0f;
+      elems        = n;
+      goto container;
+   }
+   if (type < 0xc0)                  /* fixstr */
+   {
+      f->type      = RDT_STRING;
+      n            = type & 0x1f;
+      goto payload;
+   }
+
+   switch (type)
+   {
+      case 0xc0:
+         f->type      = RDT_NULL;
+         f->val.uint_ = 0;
+         goto done;
+      case 0xc2:
+      case 0xc3:
+         f->type      = RDT_BOOL;
+         f->val.uint_ = type & 1;
+         goto done;
+      case 0xc4: case 0xc5: case 0xc6:
+         f->type      = RDT_BINARY;
+         width        = 1u << (type - 0xc4);
+         break;
+      case 0xd9: case 0xda: case 0xdb:
+         f->type      = RDT_STRING;
+         width        = 1u << (type - 0xd9);
+         break;
+      case 0xcc: case 0xcd: case 0xce: case 0xcf:
+         width        = 1u << (type - 0xcc);
+         if ((size_t)(end - p) < width)
+            return -1;
+         f->type      = RDT_UINT;
+         f->val.uint_ = libretrodb_load_be(p, width);
+         p           += width;
+         goto done;
+      case 0xd0: case 0xd1: case 0xd2: case 0xd3:
+         width        = 1u << (type - 0xd0);
+         if ((size_t)(end - p) < width)
+            return -1;
+         n            = libretrodb_load_be(p, width);
+         /* Sign-extend from the encoded width. */
+         if (width < 8 && (n >> (width * 8 - 1)))
+            n        |= ~(uint64_t)0 << (width * 8);
+         f->type      = RDT_INT;
+         f->val.int_  = (int64_t)n;
+         p           += width;
+         goto done;
+      case 0xdc: case 0xdd:
+         width        = (type == 0xdc) ? 2 : 4;
+         if ((size_t)(end - p) < width)
+            return -1;
+         f->type      = RDT_ARRAY;
+         n            = libretrodb_load_be(p, width);
+         elems        = n;
+         p           += width;
+         goto container;
+      case 0xde: case 0xdf:
+         width        = (type == 0xde) ? 2 : 4;
+         if ((size_t)(end - p) < width)
+            return -1;
+         f->type      = RDT_MAP;
+         n            = libretrodb_load_be(p, width);
+         elems        = n * 2;
+         p           += width;
+         goto container;
+      default:
+         return -1;
+   }
+
+   /* Length-prefixed string or binary */
+   if ((size_t)(end - p) < width)
+      return -1;
+   n  = libretrodb_load_be(p, width);
+   p += width;
+
+payload:
+   if (n > (uint64_t)(end - p))
+      return -1;
+   f->val.string.buff = (const char*)p;
+   f->val.string.len  = (uint32_t)n;
+   p                 += n;
+   goto done;
+
+container:
+   {
+      libretrodb_field_t inner;
+      /* Every element takes at least a byte, so a count beyond what
+       * is left is malformed - and would otherwise spin for a while
+       * before running out. */
+      if (elems > (uint64_t)(end - p))
+         return -1;
+      f->val.uint_ = n;
+      while (elems--)
+         if (libretrodb_mem_value(p, end, &inner, &p, depth + 1) < 0)
+            return -1;
+   }
+
+done:
+   *next = p;
+   return 0;
+}
+
+#ifdef HAVE_MMAP
+static bool libretrodb_reader_map(libretrodb_reader_t *reader,
+      const char *path)
+{
+   struct stat st;
+   void *map;
+   int   fd;
+
+   /* mmap needs a real host file: not a VFS URL, and not a platform
+    * whose file_stream is not backed by POSIX descriptors. */
+   if (strstr(path, "://"))
+      return false;
+   if ((fd = open(path, O_RDONLY)) < 0)
+      return false;
+   if (fstat(fd, &st) != 0 || st.st_size <= 0
+         || (uint64_t)st.st_size > (uint64_t)SIZE_MAX)
+   {
+      close(fd);
+      return false;
+   }
+
+   map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+   close(fd);
+   if (map == MAP_FAILED)
+      return false;
+#ifdef MADV_SEQUENTIAL
+   madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+
+   reader->map     = map;
+   reader->map_len = (size_t)st.st_size;
+   reader->data    = (const uint8_t*)map;
+   reader->size    = (size_t)st.st_size;
+   return true;
+}
+#endif
+
+/**
+ * libretrodb_reader_open:
+ * @db                  : Handle to an open database.
+ *
+ * Returns: a reader positioned on the first record, or NULL.
+ **/
+libretrodb_reader_t *libretrodb_reader_open(libretrodb_t *db)
+{
+   libretrodb_reader_t *reader;
+   uint64_t first;
+
+   if (!db || !db->path || !*db->path)
+      return NULL;
+   if (!(reader = (libretrodb_reader_t*)calloc(1, sizeof(*reader))))
+      return NULL;
+
+   first = db->root + sizeof(libretrodb_header_t);
+
+#ifdef HAVE_MMAP
+   if (libretrodb_reader_map(reader, db->path))
+   {
+      if (first >= reader->size)
+      {
+         libretrodb_reader_close(reader);
+         return NULL;
+      }
+      reader->pos = (size_t)first;
+      return reader;
+   }
+#endif
+
+   if (!(reader->fd = intfstream_open_buffered(db->path,
+               LIBRETRODB_WINDOW_SIZE)))
+      reader->fd = intfstream_open_file(db->path,
+            RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+   if (     !reader->fd
+         || intfstream_seek(reader->fd, (int64_t)first,
+               RETRO_VFS_SEEK_POSITION_START) < 0)
+   {
+      libretrodb_reader_close(reader);
+      return NULL;
+   }
+   return reader;
+}
+
+/* Streamed mode: bring the next record into reader->buf whole, so it
+ * can be decoded in place like a mapped one.  Returns 1 when there was
+ * one, 0 at the nil sentinel, -1 on a malformed stream. */
+static int libretrodb_reader_fill(libretrodb_reader_t *reader)
+{
+   uint8_t type;
+   int64_t start = intfstream_tell(reader->fd);
+   int64_t end;
+   size_t  len;
+
+   if (start < 0 || intfstream_read(reader->fd, &type, 1) != 1)
+      return -1;
+   if (type == _MPF_NIL)
+      return 0;
+
+   if (     intfstream_seek(reader->fd, start,
+               RETRO_VFS_SEEK_POSITION_START) < 0
+         || rmsgpack_skip_value(reader->fd) < 0
+         || (end = intfstream_tell(reader->fd)) <= start)
+      return -1;
+
+   len = (size_t)(end - start);
+   if (len > reader->buf_cap)
+   {
+      size_t   cap = reader->buf_cap ? reader->buf_cap : 4096;
+      uint8_t *buf;
+      while (cap < len)
+         cap *= 2;
+      if (!(buf = (uint8_t*)realloc(reader->buf, cap)))
+         return -1;
+      reader->buf     = buf;
+      reader->buf_cap = cap;
+   }
+
+   if (     intfstream_seek(reader->fd, start,
+               RETRO_VFS_SEEK_POSITION_START) < 0
+         || intfstream_read(reader->fd, reader->buf, len) != (int64_t)len)
+      return -1;
+
+   reader->data = reader->buf;
+   reader->size = len;
+   reader->pos  = 0;
+   return 1;
+}
+
+/**
+ * libretrodb_reader_next:
+ * @reader              : Reader from libretrodb_reader_open().
+ * @fields              : Receives the fields of the next record.
+ * @max_fields          : Capacity of @fields.
+ *
+ * Step to the next record and describe its fields in @fields, in the
+ * order they are stored.  Pairs whose key is not a string are skipped.
+ * A record with more fields than @max_fields has only the first
+ * @max_fields described.
+ *
+ * Returns: the number of fields described, EOF after the last record,
+ * or -1 on a malformed database.
+ **/
+int libretrodb_reader_next(libretrodb_reader_t *reader,
+      libretrodb_field_t *fields, unsigned max_fields)
+{
+   const uint8_t *p;
+   const uint8_t *end;
+   uint64_t pairs;
+   uint64_t i;
+   unsigned count = 0;
+
+   if (!reader || reader->eof)
+      return EOF;
+
+   if (reader->fd)
+   {
+      int rv = libretrodb_reader_fill(reader);
+      if (rv <= 0)
+      {
+         reader->eof = 1;
+         return rv < 0 ? -1 : EOF;
+      }
+   }
+
+   p   = reader->data + reader->pos;
+   end = reader->data + reader->size;
+
+   if (p >= end)
+      goto error;
+
+   /* Map header.  Anything else where a record belongs, the nil
+    * sentinel aside, is a malformed file. */
+   if (*p == _MPF_NIL)
+   {
+      reader->eof = 1;
+      return EOF;
+   }
+   if (*p >= _MPF_FIXMAP && *p < _MPF_FIXARRAY)
+   {
+      pairs = *p & 0x0f;
+      p    += 1;
+   }
+   else if (*p == _MPF_MAP16 || *p == _MPF_MAP32)
+   {
+      unsigned width = (*p == _MPF_MAP16) ? 2 : 4;
+      if ((size_t)(end - p) <= width)
+         goto error;
+      pairs = libretrodb_load_be(p + 1, width);
+      p    += 1 + width;
+   }
+   else
+      goto error;
+
+   for (i = 0; i < pairs; i++)
+   {
+      libretrodb_field_t key;
+      const uint8_t *val;
+
+      if (libretrodb_mem_value(p, end, &key, &val, 1) < 0)
+         goto error;
+
+      if (key.type != RDT_STRING || count >= max_fields)
+      {
+         libretrodb_field_t skip;
+         if (libretrodb_mem_value(val, end, &skip, &p, 1) < 0)
+            goto error;
+         continue;
+      }
+
+      if (libretrodb_mem_value(val, end, &fields[count], &p, 1) < 0)
+         goto error;
+      fields[count].key     = key.val.string.buff;
+      fields[count].key_len = key.val.string.len;
+      fields[count].raw     = val;
+      fields[count].raw_len = (size_t)(p - val);
+      count++;
+   }
+
+   reader->pos = (size_t)(p - reader->data);
+   return (int)count;
+
+error:
+   reader->eof = 1;
+   return -1;
+}
+
+/**
+ * libretrodb_field_decode:
+ *
+ * Build the DOM for one field, for a caller that needs more than the
+ * view - a nested map or array, or a value that must outlive the
+ * record.  @out is the caller's to free.
+ *
+ * Returns: 0 on success, -1 on failure.
+ **/
+int libretrodb_field_decode(const libretrodb_field_t *field,
+      struct rmsgpack_dom_value *out)
+{
+   int rv;
+   intfstream_t *fd;
+
+   if (!field || !field->raw || !out)
+      return -1;
+   if (!(fd = intfstream_open_memory((void*)field->raw,
+               RETRO_VFS_FILE_ACCESS_READ,
+               RETRO_VFS_FILE_ACCESS_HINT_NONE, field->raw_len)))
+      return -1;
+   rv = (rmsgpack_dom_read(fd, out) < 0) ? -1 : 0;
+   intfstream_close(fd);
+   free(fd);
+   return rv;
+}
+
+void libretrodb_reader_close(libretrodb_reader_t *reader)
+{
+   if (!reader)
+      return;
+#ifdef HAVE_MMAP
+   if (reader->map)
+      munmap(reader->map, reader->map_len);
+#endif
+   if (reader->fd)
+   {
+      intfstream_close(reader->fd);
+      free(reader->fd);
+   }
+   free(reader->buf);
+   free(reader);
+}
+
 /* Accessor for query.c, which owns the formatting but not the
  * storage.  Returns NULL when there is no db handle to borrow from;
  * the caller then falls back to a fixed message. */
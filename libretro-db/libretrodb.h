@@ -125,6 +125,49 @@ int libretrodb_cursor_reset(libretrodb_cursor_t *cursor);
  **/
 void libretrodb_cursor_close(libretrodb_cursor_t *cursor);
 
+typedef struct libretrodb_reader libretrodb_reader_t;
+
+/* One field of the record libretrodb_reader_next() stopped on.
+ *
+ * Nothing here is allocated.  @key, and val.string for RDT_STRING and
+ * RDT_BINARY, point into the reader's storage and are NOT
+ * NUL-terminated; like @raw they stay valid until the next call to
+ * libretrodb_reader_next() or libretrodb_reader_close().  RDT_BOOL is
+ * 0 or 1 in val.uint_.  RDT_MAP and RDT_ARRAY carry their element
+ * count in val.uint_ and are otherwise only reachable through
+ * libretrodb_field_decode(). */
+typedef struct libretrodb_field
+{
+   const char *key;
+   const uint8_t *raw;      /* the encoded value */
+   size_t raw_len;
+   union
+   {
+      uint64_t uint_;
+      int64_t int_;
+      struct
+      {
+         const char *buff;
+         uint32_t len;
+      } string;
+   } val;
+   uint32_t key_len;
+   enum rmsgpack_dom_type type;
+} libretrodb_field_t;
+
+/* Allocation-free sequential read of every record, for callers that
+ * want a handful of fields out of each one.  Maps the file where the
+ * platform allows. */
+libretrodb_reader_t *libretrodb_reader_open(libretrodb_t *db);
+
+int libretrodb_reader_next(libretrodb_reader_t *reader,
+      libretrodb_field_t *fields, unsigned max_fields);
+
+int libretrodb_field_decode(const libretrodb_field_t *field,
+      struct rmsgpack_dom_value *out);
+
+void libretrodb_reader_close(libretrodb_reader_t *reader);
+
 void *libretrodb_query_compile(libretrodb_t *db, const char *query,
         size_t buff_len, const char **err);
 
@@ -108,6 +108,24 @@ int main(int argc, char ** argv)
    }
 
    rv = libretrodb_create(dst, &value_provider, L);
+   intfstream_close(dst);
+   dst = NULL;
+
+   /* Indexed as c_converter indexes it, so the two still write the
+    * same file. */
+   if (rv == 0)
+   {
+      libretrodb_t *db = libretrodb_new();
+      if (     !db
+            || libretrodb_open(db_file, db, true) != 0
+            || libretrodb_create_index(db, "crc", "crc") != 0)
+         printf("Could not index crc in '%s'\n", db_file);
+      if (db)
+      {
+         libretrodb_close(db);
+         libretrodb_free(db);
+      }
+   }
 
 clean:
    lua_close(L);
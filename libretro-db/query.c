@@ -681,6 +681,18 @@ static struct buffer query_parse_value(char *s, size_t len,
    else if (   (size_t)buff.offset < buff.len
             && ISDIGIT((int)buff.data[buff.offset]))
       buff = query_parse_integer(s, len, buff, value, err);
+   else
+   {
+      /* Nothing here is a value.  Say so rather than returning with
+       * @value untouched: the caller counts the argument as parsed,
+       * and freeing whatever the stack slot last held was a double
+       * free on a query as short as "{'a':". */
+      value->type = RDT_NULL;
+      snprintf(s, len,
+            "%" PRIu64 "::Expected value",
+            (uint64_t)buff.offset);
+      *err = s;
+   }
    return buff;
 }
 
@@ -1308,3 +1320,102 @@ int libretrodb_query_eval_field(libretrodb_query_t *q,
    /* Field not in query — irrelevant */
    return -1;
 }
+
+/* Whether @inv can answer differently for the same record depending
+ * on which records were evaluated before it.  min() and max() report
+ * "beyond everything seen so far", so they only mean what they say
+ * over a walk that visits every record. */
+static int query_invocation_accumulates(const struct invocation *inv)
+{
+   unsigned i;
+
+   if (     inv->func == query_func_min
+         || inv->func == query_func_max)
+      return 1;
+
+   for (i = 0; i < inv->argc; i++)
+      if (     inv->argv[i].type == AT_FUNCTION
+            && query_invocation_accumulates(&inv->argv[i].a.invocation))
+         return 1;
+
+   return 0;
+}
+
+/**
+ * libretrodb_query_get_seek_keys:
+ *
+ * Report the values a table query pins @field_name to, so that a
+ * cursor can seek to them through an index rather than test every
+ * record.  A field is pinned when its matcher is a plain value, as in
+ * {crc:b"..."}, or an or() of plain values, as in
+ * {crc:or(b"...", b"...")}.
+ *
+ * The keys only narrow the walk: a record they lead to still has to
+ * pass the whole query, so the other fields of the table need no
+ * special handling here.
+ *
+ * @q           : Compiled query handle.
+ * @field_name  : The map key name (e.g. "crc").
+ * @field_len   : Length of field_name.
+ * @keys        : Output array of values (not copied - valid for the
+ *                lifetime of the query).
+ * @max_keys    : Capacity of @keys.
+ *
+ * Returns: number of keys written, or -1 if the field is not pinned,
+ *          is pinned to more than @max_keys values, or the query uses
+ *          min()/max(), which need to see every record.
+ */
+int libretrodb_query_get_seek_keys(libretrodb_query_t *q,
+      const char *field_name, uint32_t field_len,
+      const struct rmsgpack_dom_value **keys, unsigned max_keys)
+{
+   unsigned i;
+   struct query *rq = (struct query *)q;
+
+   if (!rq || !rq->root.func || !rq->root.argv)
+      return -1;
+
+   if (rq->root.func != query_func_all_map)
+      return -1;
+
+   if (query_invocation_accumulates(&rq->root))
+      return -1;
+
+   for (i = 0; i + 1 < rq->root.argc; i += 2)
+   {
+      unsigned j;
+      const struct invocation *inv;
+      struct argument *key_arg = &rq->root.argv[i];
+      struct argument *val_arg = &rq->root.argv[i + 1];
+
+      if (  key_arg->type              != AT_VALUE
+         || key_arg->a.value.type      != RDT_STRING
+         || key_arg->a.value.val.string.len != field_len)
+         continue;
+
+      if (memcmp(key_arg->a.value.val.string.buff, field_name, field_len) != 0)
+         continue;
+
+      if (val_arg->type == AT_VALUE)
+      {
+         if (max_keys < 1)
+            return -1;
+         keys[0] = &val_arg->a.value;
+         return 1;
+      }
+
+      inv = &val_arg->a.invocation;
+      if (inv->func != query_func_operator_or || inv->argc > max_keys)
+         return -1;
+
+      for (j = 0; j < inv->argc; j++)
+      {
+         if (inv->argv[j].type != AT_VALUE)
+            return -1;
+         keys[j] = &inv->argv[j].a.value;
+      }
+      return (int)inv->argc;
+   }
+
+   return -1;
+}
@@ -50,6 +50,10 @@ int libretrodb_query_eval_field(libretrodb_query_t *q,
       const char *field_name, uint32_t field_len,
       struct rmsgpack_dom_value *value);
 
+int libretrodb_query_get_seek_keys(libretrodb_query_t *q,
+      const char *field_name, uint32_t field_len,
+      const struct rmsgpack_dom_value **keys, unsigned max_keys);
+
 RETRO_END_DECLS
 
 #endif
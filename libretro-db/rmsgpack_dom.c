@@ -338,6 +338,7 @@ int rmsgpack_dom_value_cmp(
                               &b->val.map.items[i].value)) != 0)
                      return rv;
                }
+               return 0;
             }
             break;
          case RDT_ARRAY:
@@ -351,6 +352,7 @@ int rmsgpack_dom_value_cmp(
                               &b->val.array.items[i])) != 0)
                      return rv;
                }
+               return 0;
             }
             break;
       }
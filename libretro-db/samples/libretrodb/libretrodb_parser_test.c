@@ -53,13 +53,34 @@
  *                           back from such an offset.  The two have
  *                           to agree with what a query returns,
  *                           including for keys that repeat.
+ *   planned query           a cursor whose query pins an indexed
+ *                           field seeks through the index instead
+ *                           of walking; it has to return exactly
+ *                           what the walk does, in the same order.
+ *   shared keys             libretrodb_create_index() refused any
+ *                           key two records shared, which real DATs
+ *                           are full of, so no converter could emit
+ *                           an index for the planner to use.  Now
+ *                           each record gets an entry, and a query
+ *                           for a shared key returns all of them.
+ *                           The first record's entry also pointed
+ *                           at the metadata, not the record.
+ *   in-place reader         libretrodb_reader_next() decodes records
+ *                           where they lie instead of through the
+ *                           DOM; every field has to come out as the
+ *                           cursor reports it, and a record that
+ *                           runs past the end of the file has to be
+ *                           refused, not read beyond.
  *   query slices            libretrodb_query_compile() takes a
  *                           (pointer, length) pair, but the parser
  *                           handed identifier slices to strlcpy(),
  *                           which strlen()s its source, and indexed
  *                           buff.data[buff.offset] after chomping
  *                           trailing space without checking the
- *                           offset against the length.
+ *                           offset against the length.  A query
+ *                           cut off where a value belonged left the
+ *                           value slot unset, and the error path
+ *                           freed whatever it last held.
  *
  * Self-contained: builds each .rdb in a temp directory, exercises
  * it, and reports.  Exits non-zero if any case regresses.
@@ -830,6 +851,447 @@ static void case_index_round_trip(const char *dir)
    libretrodb_free(db);
 }
 
+/* Run @query over @path and join the names it returns, as
+ * walk_names() does for an unfiltered walk. */
+static char *query_names(const char *path, const char *query)
+{
+   libretrodb_t        *db  = libretrodb_new();
+   libretrodb_cursor_t *cur = libretrodb_cursor_new();
+   struct rmsgpack_dom_value item;
+   const char *err = NULL;
+   void *q         = NULL;
+   buf_t out;
+   unsigned i;
+
+   memset(&out, 0, sizeof(out));
+
+   if (!db || !cur || libretrodb_open(path, db, false) != 0)
+   {
+      libretrodb_free(db);
+      libretrodb_cursor_free(cur);
+      return NULL;
+   }
+   q = libretrodb_query_compile(db, query, strlen(query), &err);
+   if (!q || err || libretrodb_cursor_open(db, cur,
+            (libretrodb_query_t*)q) != 0)
+   {
+      if (q)
+         libretrodb_query_free(q);
+      libretrodb_close(db);
+      libretrodb_free(db);
+      libretrodb_cursor_free(cur);
+      return NULL;
+   }
+
+   while (libretrodb_cursor_read_item(cur, &item) == 0)
+   {
+      if (item.type == RDT_MAP)
+      {
+         for (i = 0; i < item.val.map.len; i++)
+         {
+            struct rmsgpack_dom_value *k = &item.val.map.items[i].key;
+            struct rmsgpack_dom_value *v = &item.val.map.items[i].value;
+            if (   k->type == RDT_STRING && k->val.string.buff
+                && !strcmp(k->val.string.buff, "name")
+                && v->type == RDT_STRING && v->val.string.buff)
+            {
+               bput(&out, v->val.string.buff,
+                     strlen(v->val.string.buff));
+               bbyte(&out, '|');
+            }
+         }
+      }
+      rmsgpack_dom_value_free(&item);
+   }
+   bbyte(&out, 0);
+
+   libretrodb_cursor_close(cur);
+   libretrodb_query_free(q);
+   libretrodb_close(db);
+   libretrodb_free(db);
+   libretrodb_cursor_free(cur);
+   return (char*)out.data;
+}
+
+/* The same queries over the same records, once with a crc index and
+ * once without.  Without, every query walks; with, the ones that pin
+ * crc seek.  Every third record has no crc, so the index does not
+ * cover the whole database and the planner has to know when that
+ * matters. */
+static void case_planned_query(const char *dir)
+{
+   static const struct
+   {
+      const char *text;
+      const char *want;
+   } queries[] = {
+      { "{crc:b\"00000151\"}",                      "G00337|" },
+      /* out of order, repeated: comes back once each, in file order */
+      { "{crc:or(b\"00000254\",b\"00000001\",b\"00000254\")}",
+                                                    "G00001|G00596|" },
+      { "{crc:b\"00000151\",name:\"G00337\"}",        "G00337|" },
+      { "{crc:b\"00000151\",name:\"G00338\"}",        ""        },
+      { "{crc:b\"DEADBEEF\"}",                      ""        },
+      /* wrong width for the index: can equal nothing */
+      { "{crc:b\"0151\"}",                          ""        },
+      /* nil is not a key the index holds: this one has to walk */
+      { "{crc:or(b\"00000001\",nil)}",               "G00001|" },
+      { "{name:\"G00300\"}",                        "G00300|" }
+   };
+   char   plain[512], indexed[512];
+   buf_t  body, meta;
+   unsigned i;
+   const int records = 600;
+   libretrodb_t *db;
+
+   memset(&body, 0, sizeof(body));
+   memset(&meta, 0, sizeof(meta));
+
+   for (i = 0; i < (unsigned)records; i++)
+   {
+      char name[32];
+      uint8_t crc[4];
+      sprintf(name, "G%05u", i);
+      crc[0] = (uint8_t)(i >> 24); crc[1] = (uint8_t)(i >> 16);
+      crc[2] = (uint8_t)(i >> 8);  crc[3] = (uint8_t)i;
+      if (i % 3 == 0)
+      {
+         bfixmap(&body, 1);
+         bfixstr(&body, "name"); bfixstr(&body, name);
+         continue;
+      }
+      bfixmap(&body, 2);
+      bfixstr(&body, "name"); bfixstr(&body, name);
+      bfixstr(&body, "crc");  bbin(&body, crc, 4);
+   }
+   bnil(&body);
+   meta_count(&meta, 1);
+
+   sprintf(plain,   "%s/planned_plain.rdb",   dir);
+   sprintf(indexed, "%s/planned_indexed.rdb", dir);
+   write_rdb(plain,   &body, &meta);
+   write_rdb(indexed, &body, &meta);
+   bfree(&body); bfree(&meta);
+
+   db = libretrodb_new();
+   if (   !db || libretrodb_open(indexed, db, true) != 0
+       || libretrodb_create_index(db, "crc", "crc") != 0)
+   {
+      check(0, "planned query", "index could not be built");
+      if (db)
+         libretrodb_close(db);
+      libretrodb_free(db);
+      return;
+   }
+   libretrodb_close(db);
+   libretrodb_free(db);
+
+   for (i = 0; i < sizeof(queries) / sizeof(queries[0]); i++)
+   {
+      char  what[48];
+      char *a, *b;
+      int   ok;
+
+      sprintf(what, "planned query %u", i);
+      begin(what);
+      a  = query_names(plain,   queries[i].text);
+      b  = query_names(indexed, queries[i].text);
+      ok = a && b && !strcmp(a, queries[i].want) && !strcmp(b, a);
+      check(ok, what, ok ? "index agrees with the walk"
+                         : (a && b && strcmp(a, b) ? "index and walk differ"
+                                                   : "wrong result"));
+      free(a);
+      free(b);
+   }
+}
+
+/* crc indexed over records that share crcs - seven values among 99
+ * records - must build, and answer as the walk does. */
+static void case_shared_keys(const char *dir)
+{
+   static const struct
+   {
+      const char *text;
+      const char *want;
+   } queries[] = {
+      { "{crc:b\"00000003\"}",
+        "G00003|G00010|G00017|G00024|G00031|G00038|G00045|G00052|"
+        "G00059|G00066|G00073|G00080|G00087|G00094|" },
+      { "{crc:or(b\"00000006\",b\"00000000\")}",
+        "G00000|G00006|G00007|G00013|G00014|G00020|G00021|G00027|"
+        "G00028|G00034|G00035|G00041|G00042|G00048|G00049|G00055|"
+        "G00056|G00062|G00063|G00069|G00070|G00076|G00077|G00083|"
+        "G00084|G00090|G00091|G00097|G00098|" },
+      { "{crc:b\"00000003\",name:\"G00045\"}", "G00045|" },
+      { "{crc:b\"00000009\"}",                  ""        }
+   };
+   char   plain[512], indexed[512];
+   buf_t  body, meta;
+   unsigned i;
+   const unsigned records = 99;
+   libretrodb_t *db;
+
+   memset(&body, 0, sizeof(body));
+   memset(&meta, 0, sizeof(meta));
+
+   for (i = 0; i < records; i++)
+   {
+      char name[32];
+      uint8_t crc[4] = { 0, 0, 0, 0 };
+      sprintf(name, "G%05u", i);
+      crc[3] = (uint8_t)(i % 7);
+      bfixmap(&body, 2);
+      bfixstr(&body, "name"); bfixstr(&body, name);
+      bfixstr(&body, "crc");  bbin(&body, crc, 4);
+   }
+   bnil(&body);
+   meta_count(&meta, 1);
+
+   sprintf(plain,   "%s/shared_plain.rdb",   dir);
+   sprintf(indexed, "%s/shared_indexed.rdb", dir);
+   write_rdb(plain,   &body, &meta);
+   write_rdb(indexed, &body, &meta);
+   bfree(&body); bfree(&meta);
+
+   begin("shared keys");
+   db = libretrodb_new();
+   if (   !db || libretrodb_open(indexed, db, true) != 0
+       || libretrodb_create_index(db, "crc", "crc") != 0)
+   {
+      check(0, "shared keys", "index could not be built");
+      if (db)
+         libretrodb_close(db);
+      libretrodb_free(db);
+      return;
+   }
+   check(1, "shared keys", "index built over shared keys");
+   libretrodb_close(db);
+   libretrodb_free(db);
+
+   for (i = 0; i < sizeof(queries) / sizeof(queries[0]); i++)
+   {
+      char  what[48];
+      char *a, *b;
+      int   ok;
+
+      sprintf(what, "shared key query %u", i);
+      begin(what);
+      a  = query_names(plain,   queries[i].text);
+      b  = query_names(indexed, queries[i].text);
+      ok = a && b && !strcmp(a, queries[i].want) && !strcmp(b, a);
+      check(ok, what, ok ? "index agrees with the walk"
+                         : (a && b && strcmp(a, b) ? "index and walk differ"
+                                                   : "wrong result"));
+      free(a);
+      free(b);
+   }
+
+   /* A direct lookup gets the first record holding the key. */
+   begin("shared key lookup");
+   db = libretrodb_new();
+   if (db && libretrodb_open(indexed, db, false) == 0)
+   {
+      struct rmsgpack_dom_value out;
+      static const unsigned char key[4] = { 0, 0, 0, 3 };
+      int ok = 0;
+
+      if (libretrodb_find_entry(db, "crc", key, &out) == 0)
+      {
+         if (out.type == RDT_MAP)
+         {
+            unsigned j;
+            for (j = 0; j < out.val.map.len; j++)
+            {
+               struct rmsgpack_dom_value *k = &out.val.map.items[j].key;
+               struct rmsgpack_dom_value *w = &out.val.map.items[j].value;
+               if (   k->type == RDT_STRING && k->val.string.buff
+                   && !strcmp(k->val.string.buff, "name")
+                   && w->type == RDT_STRING && w->val.string.buff)
+                  ok = !strcmp(w->val.string.buff, "G00003");
+            }
+         }
+         rmsgpack_dom_value_free(&out);
+      }
+      check(ok, "shared key lookup", ok ? "first record in file order"
+                                        : "wrong or missing record");
+      libretrodb_close(db);
+   }
+   else
+      check(0, "shared key lookup", "database would not reopen");
+   libretrodb_free(db);
+}
+
+/* Every encoding the writer side can produce, in one record, plus a
+ * wide record and a long string. */
+static void reader_fixture(buf_t *b)
+{
+   unsigned i;
+   char     longstr[300];
+
+   bfixmap(b, 10);
+   bfixstr(b, "name");    bfixstr(b, "Alpha");
+   bfixstr(b, "crc");     bbin(b, "\x12\x34\x56\x78", 4);
+   bfixstr(b, "size");    bbyte(b, 0xce); bput(b, "\x12\x34\x56\x78", 4);
+   bfixstr(b, "year");    bbyte(b, 0xcd); bput(b, "\x07\xcb", 2);
+   bfixstr(b, "neg");     bbyte(b, 0xfb);                        /* -5 */
+   bfixstr(b, "wide");    bbyte(b, 0xd1); bput(b, "\xfe\xd4", 2); /* -300 */
+   bfixstr(b, "flag");    bbyte(b, 0xc3);
+   bfixstr(b, "nothing"); bnil(b);
+   bfixstr(b, "nested");  bfixmap(b, 1); bfixstr(b, "a"); bbyte(b, 1);
+   bfixstr(b, "list");    bbyte(b, 0x93); bbyte(b, 1); bbyte(b, 2); bbyte(b, 3);
+
+   bbyte(b, 0xde); bbyte(b, 0); bbyte(b, 20);                   /* map16 */
+   for (i = 0; i < 20; i++)
+   {
+      char key[8];
+      sprintf(key, "k%02u", i);
+      bfixstr(b, key);
+      buint8(b, (uint8_t)(200 + i));
+   }
+
+   memset(longstr, 'x', sizeof(longstr));
+   bfixmap(b, 2);
+   bfixstr(b, "name");  bfixstr(b, "Long");
+   bfixstr(b, "description");
+   bbyte(b, 0xda); bbyte(b, (uint8_t)(sizeof(longstr) >> 8));
+   bbyte(b, (uint8_t)sizeof(longstr));
+   bput(b, longstr, sizeof(longstr));
+}
+
+/* Whether the view @f says what the DOM value @v does. */
+static int reader_field_matches(const libretrodb_field_t *f,
+      const struct rmsgpack_dom_value *v)
+{
+   struct rmsgpack_dom_value d;
+   int ok;
+
+   if (f->type != v->type)
+      return 0;
+   switch (v->type)
+   {
+      case RDT_NULL:
+         return 1;
+      case RDT_BOOL:
+         return f->val.uint_ == (uint64_t)(v->val.bool_ ? 1 : 0);
+      case RDT_UINT:
+         return f->val.uint_ == v->val.uint_;
+      case RDT_INT:
+         return f->val.int_ == v->val.int_;
+      case RDT_STRING:
+      case RDT_BINARY:
+         return f->val.string.len == v->val.string.len
+             && !memcmp(f->val.string.buff, v->val.string.buff,
+                   v->val.string.len);
+      default:
+         break;
+   }
+   /* Containers are only reachable by decoding them. */
+   if (libretrodb_field_decode(f, &d) != 0)
+      return 0;
+   ok = (rmsgpack_dom_value_cmp(&d, v) == 0);
+   rmsgpack_dom_value_free(&d);
+   return ok;
+}
+
+static void case_reader(const char *dir)
+{
+   char   path[512];
+   buf_t  body, meta;
+   libretrodb_t        *db  = libretrodb_new();
+   libretrodb_cursor_t *cur = libretrodb_cursor_new();
+   libretrodb_reader_t *reader;
+   libretrodb_field_t   fields[32];
+   struct rmsgpack_dom_value item;
+   int records = 0;
+   int ok      = 1;
+   int n;
+
+   memset(&body, 0, sizeof(body));
+   memset(&meta, 0, sizeof(meta));
+   reader_fixture(&body);
+   bnil(&body);
+   meta_count(&meta, 3);
+   sprintf(path, "%s/reader.rdb", dir);
+   write_rdb(path, &body, &meta);
+   bfree(&body); bfree(&meta);
+
+   begin("reader agrees with the cursor");
+   if (   !db || !cur || libretrodb_open(path, db, false) != 0
+       || libretrodb_cursor_open(db, cur, NULL) != 0
+       || !(reader = libretrodb_reader_open(db)))
+   {
+      check(0, "reader agrees with the cursor", "could not open");
+      libretrodb_free(db);
+      libretrodb_cursor_free(cur);
+      return;
+   }
+
+   while (libretrodb_cursor_read_item(cur, &item) == 0)
+   {
+      unsigned i;
+      n = libretrodb_reader_next(reader, fields, 32);
+      if (item.type != RDT_MAP || n != (int)item.val.map.len)
+         ok = 0;
+      /* The DOM does not keep the stored order, so match by key. */
+      for (i = 0; ok && i < item.val.map.len; i++)
+      {
+         const struct rmsgpack_dom_value *k = &item.val.map.items[i].key;
+         int j, found = 0;
+         for (j = 0; j < n && !found; j++)
+            if (   fields[j].key_len == k->val.string.len
+                && !memcmp(fields[j].key, k->val.string.buff,
+                      k->val.string.len))
+               found = reader_field_matches(&fields[j],
+                     &item.val.map.items[i].value);
+         if (!found)
+            ok = 0;
+      }
+      rmsgpack_dom_value_free(&item);
+      records++;
+   }
+   ok = ok && records == 3
+      && libretrodb_reader_next(reader, fields, 32) == EOF;
+   check(ok, "reader agrees with the cursor",
+         ok ? "every field, every encoding" : "mismatch");
+
+   libretrodb_reader_close(reader);
+   libretrodb_cursor_close(cur);
+   libretrodb_close(db);
+
+   /* A third record whose string claims far more bytes than the file
+    * holds. */
+   memset(&body, 0, sizeof(body));
+   memset(&meta, 0, sizeof(meta));
+   bfixmap(&body, 1); bfixstr(&body, "name"); bfixstr(&body, "One");
+   bfixmap(&body, 1); bfixstr(&body, "name"); bfixstr(&body, "Two");
+   bfixmap(&body, 1); bfixstr(&body, "name");
+   bbyte(&body, 0xda); bbyte(&body, 0xea); bbyte(&body, 0x60);
+   bput(&body, "short", 5);
+   bnil(&body);
+   meta_count(&meta, 3);
+   sprintf(path, "%s/reader_cut.rdb", dir);
+   write_rdb(path, &body, &meta);
+   bfree(&body); bfree(&meta);
+
+   begin("reader refuses an overlong field");
+   ok = 0;
+   if (   libretrodb_open(path, db, false) == 0
+       && (reader = libretrodb_reader_open(db)))
+   {
+      ok =  libretrodb_reader_next(reader, fields, 32) == 1
+         && libretrodb_reader_next(reader, fields, 32) == 1
+         && libretrodb_reader_next(reader, fields, 32) < 0
+         && libretrodb_reader_next(reader, fields, 32) < 0;
+      libretrodb_reader_close(reader);
+      libretrodb_close(db);
+   }
+   check(ok, "reader refuses an overlong field",
+         ok ? "stopped at it" : "read past it");
+
+   libretrodb_free(db);
+   libretrodb_cursor_free(cur);
+}
+
 /* Collector for the scan test below. */
 typedef struct
 {
@@ -1002,6 +1464,9 @@ int main(int argc, char **argv)
    case_minmax_zero(dir);
    case_index_round_trip(dir);
    case_field_scan(dir);
+   case_planned_query(dir);
+   case_shared_keys(dir);
+   case_reader(dir);
 
    printf("\n%d checks, %d failures\n", checks, failures);
    return failures ? 1 : 0;
@@ -2098,6 +2098,7 @@ int menu_cbs_init_bind_sublabel(menu_file_list_cbs_t *cbs,
       { MENU_ENUM_LABEL_STDIN_CMD_ENABLE, MENU_ENUM_SUBLABEL_STDIN_CMD_ENABLE },
       { MENU_ENUM_LABEL_NETPLAY_PUBLIC_ANNOUNCE, MENU_ENUM_SUBLABEL_NETPLAY_PUBLIC_ANNOUNCE },
       { MENU_ENUM_LABEL_NETPLAY_NAT_TRAVERSAL, MENU_ENUM_SUBLABEL_NETPLAY_NAT_TRAVERSAL },
+      { MENU_ENUM_LABEL_NETPLAY_UDP_INPUT, MENU_ENUM_SUBLABEL_NETPLAY_UDP_INPUT },
       { MENU_ENUM_LABEL_NETPLAY_CHECK_FRAMES, MENU_ENUM_SUBLABEL_NETPLAY_CHECK_FRAMES },
       { MENU_ENUM_LABEL_NETPLAY_START_AS_SPECTATOR, MENU_ENUM_SUBLABEL_NETPLAY_START_AS_SPECTATOR },
       { MENU_ENUM_LABEL_NETPLAY_FADE_CHAT, MENU_ENUM_SUBLABEL_NETPLAY_FADE_CHAT },
@@ -2193,6 +2194,8 @@ int menu_cbs_init_bind_sublabel(menu_file_list_cbs_t *cbs,
       { MENU_ENUM_LABEL_SAVESTATE_THUMBNAIL_ENABLE, MENU_ENUM_SUBLABEL_SAVESTATE_THUMBNAIL_ENABLE },
       { MENU_ENUM_LABEL_SAVE_FILE_COMPRESSION, MENU_ENUM_SUBLABEL_SAVE_FILE_COMPRESSION },
       { MENU_ENUM_LABEL_SAVESTATE_FILE_COMPRESSION, MENU_ENUM_SUBLABEL_SAVESTATE_FILE_COMPRESSION },
+      { MENU_ENUM_LABEL_SAVE_COMPRESSION_ZSTD, MENU_ENUM_SUBLABEL_SAVE_COMPRESSION_ZSTD },
+      { MENU_ENUM_LABEL_SAVE_COMPRESSION_ZSTD_LEVEL, MENU_ENUM_SUBLABEL_SAVE_COMPRESSION_ZSTD_LEVEL },
       { MENU_ENUM_LABEL_SAVESTATE_AUTO_SAVE, MENU_ENUM_SUBLABEL_SAVESTATE_AUTO_SAVE },
       { MENU_ENUM_LABEL_SAVESTATE_AUTO_LOAD, MENU_ENUM_SUBLABEL_SAVESTATE_AUTO_LOAD },
       { MENU_ENUM_LABEL_PERFCNT_ENABLE, MENU_ENUM_SUBLABEL_PERFCNT_ENABLE },
@@ -9905,6 +9905,7 @@ unsigned menu_displaylist_build_list(
                {MENU_ENUM_LABEL_NETPLAY_INPUT_LATENCY_FRAMES_MIN,   PARSE_ONLY_INT,    true},
                {MENU_ENUM_LABEL_NETPLAY_INPUT_LATENCY_FRAMES_RANGE, PARSE_ONLY_INT,    true},
                {MENU_ENUM_LABEL_NETPLAY_NAT_TRAVERSAL,              PARSE_ONLY_BOOL,   true},
+               {MENU_ENUM_LABEL_NETPLAY_UDP_INPUT,                  PARSE_ONLY_BOOL,   true},
                {MENU_ENUM_LABEL_NETPLAY_SHARE_DIGITAL,              PARSE_ONLY_UINT,   true},
                {MENU_ENUM_LABEL_NETPLAY_SHARE_ANALOG,               PARSE_ONLY_UINT,   true},
             };
@@ -11733,6 +11734,9 @@ unsigned menu_displaylist_build_list(
          {
             bool savestate_auto_index = settings->bools.savestate_auto_index;
             bool replay_auto_index    = settings->bools.replay_auto_index;
+#if defined(HAVE_COMPRESSION)
+            bool save_compression_zstd = settings->bools.save_compression_zstd;
+#endif
 
             static menu_displaylist_build_info_selective_t build_list[] = {
 #if HAVE_CLOUDSYNC
@@ -11754,6 +11758,8 @@ unsigned menu_displaylist_build_list(
                {MENU_ENUM_LABEL_SAVESTATE_THUMBNAIL_ENABLE,         PARSE_ONLY_BOOL, true},
 #if defined(HAVE_COMPRESSION)
                {MENU_ENUM_LABEL_SAVESTATE_FILE_COMPRESSION,         PARSE_ONLY_BOOL, true},
+               {MENU_ENUM_LABEL_SAVE_COMPRESSION_ZSTD,              PARSE_ONLY_BOOL, true},
+               {MENU_ENUM_LABEL_SAVE_COMPRESSION_ZSTD_LEVEL,        PARSE_ONLY_UINT, false},
 #endif
                {MENU_ENUM_LABEL_SAVESTATE_AUTOMATIC_INTERVAL,       PARSE_ONLY_UINT, true},
                {MENU_ENUM_LABEL_SAVESTATE_AUTO_INDEX,               PARSE_ONLY_BOOL, true},
@@ -11779,6 +11785,11 @@ unsigned menu_displaylist_build_list(
                   case MENU_ENUM_LABEL_REPLAY_MAX_KEEP:
                      build_list[i].checked = replay_auto_index;
                      break;
+#if defined(HAVE_COMPRESSION)
+                  case MENU_ENUM_LABEL_SAVE_COMPRESSION_ZSTD_LEVEL:
+                     build_list[i].checked = save_compression_zstd;
+                     break;
+#endif
                   case MENU_ENUM_LABEL_VIDEO_GPU_SCREENSHOT:
                   {
 #ifdef HAVE_SCREENSHOTS
@@ -13170,6 +13181,7 @@ static bool menu_displaylist_ctl_internal(
                   {MENU_ENUM_LABEL_NETPLAY_ALLOW_SLAVES,       PARSE_ONLY_BOOL,   true},
                   {MENU_ENUM_LABEL_NETPLAY_REQUIRE_SLAVES,     PARSE_ONLY_BOOL,   false},
                   {MENU_ENUM_LABEL_NETPLAY_NAT_TRAVERSAL,      PARSE_ONLY_BOOL,   true},
+                  {MENU_ENUM_LABEL_NETPLAY_UDP_INPUT,          PARSE_ONLY_BOOL,   true},
                };
 
                menu_entries_clear(list);
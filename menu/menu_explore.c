@@ -20,6 +20,7 @@
 #include <compat/strl.h>
 #include <array/rbuf.h>
 #include <array/rhmap.h>
+#include <file/file_path.h>
 #include <formats/rjson.h>
 #include <formats/rjson_stream.h>
 #include <formats/rjson_helpers.h>
@@ -38,6 +39,13 @@
 #include "../libretro-db/libretrodb.h"
 #include "../tasks/tasks_internal.h"
 
+#ifdef HAVE_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 /* Explore */
 enum
 {
@@ -120,6 +128,11 @@ struct explore_state
    playlist_t **playlists;
    uintptr_t *icons;
    const char *label_explore_item_str;
+   /* Explore cache image the category strings were taken from in
+    * place, if they were; see explore_cache_load(). */
+   void *cache_image;
+   size_t cache_image_len;
+   bool cache_image_mapped;
 
    char title[1024];
    bool has_unknown[EXPLORE_CAT_COUNT];
@@ -181,6 +194,9 @@ static explore_state_t* explore_state;
 #define EX_ALIGNOF(type) ((int)__alignof__(type))
 #endif
 
+/* Fields described per RDB record.  Records carry 10-15. */
+#define EXPLORE_RDB_MAX_FIELDS 64
+
 #define EX_ARENA_ALIGNMENT 8
 #define EX_ARENA_BLOCK_SIZE (64 * 1024)
 #define EX_ARENA_ALIGN_UP(n, a) (((n) + (a) - 1) & ~((a) - 1))
@@ -315,6 +331,29 @@ static int explore_check_company_suffix(const char* p, bool search_reverse)
    return 0;
 }
 
+static bool explore_rdb_key_is(const libretrodb_field_t *field,
+      const char *key)
+{
+   size_t _len = strlen(key);
+   return field->key_len == _len && !memcmp(field->key, key, _len);
+}
+
+/* Append the string @field views to @buf, NUL-terminated, and return
+ * where it starts.  Offsets rather than pointers: a later append may
+ * move the buffer. */
+static ptrdiff_t explore_rdb_copy_string(char **buf,
+      const libretrodb_field_t *field)
+{
+   size_t at   = RBUF_LEN(*buf);
+   size_t _len = field->val.string.len;
+   if (!RBUF_TRYFIT(*buf, at + _len + 1))
+      return -1;
+   RBUF_RESIZE(*buf, at + _len + 1);
+   memcpy(*buf + at, field->val.string.buff, _len);
+   (*buf)[at + _len] = '\0';
+   return (ptrdiff_t)at;
+}
+
 static void explore_add_unique_string(
       explore_state_t *state,
       explore_string_t** maps[EXPLORE_CAT_COUNT], explore_entry_t *e,
@@ -473,6 +512,692 @@ static void explore_load_icons(explore_state_t *state)
    }
 }
 
+static playlist_t *explore_playlist_open(const char *path)
+{
+   playlist_config_t playlist_config;
+
+   playlist_config.base_content_directory[0] = '\0';
+   playlist_config.capacity                  = COLLECTION_SIZE;
+   playlist_config.old_format                = false;
+   playlist_config.compress                  = false;
+   playlist_config.fuzzy_archive_match       = false;
+   playlist_config.autofix_paths             = false;
+   strlcpy(playlist_config.path, path, sizeof(playlist_config.path));
+
+   return playlist_init(&playlist_config);
+}
+
+/* Explore cache
+ *
+ * Building the state reads every playlist and every database they
+ * name, then sorts what came out; with a large collection that is
+ * seconds of work.  The result depends on nothing but those files, so
+ * it is written out once built and taken back for as long as none of
+ * them has changed.
+ *
+ * The playlists are still loaded - entries point into them - but no
+ * database is opened, nothing is hashed and nothing is sorted.  The
+ * category strings are used where they lie in the image, which is
+ * mapped where HAVE_MMAP is available and read whole otherwise, and
+ * which lives as long as the state.
+ *
+ * Layout, in native byte order (the cache does not travel), with
+ * every field padded to a multiple of 4 bytes:
+ *
+ *   "RAEX" u32 version u32 byte order mark u32 flags u32 category count
+ *   str database directory, str "Yes", str "No"
+ *   u32 n, n x { u32 kind, i64 size, i64 mtime, str path }
+ *   u32 n, n x { str playlist path, u32 entry count }
+ *   u8 has_unknown[category count]
+ *   u32 len, string block of { u32 idx, chars, NUL }
+ *   per category: u32 n, n x u32 string, in sorted order
+ *   u32 n, n x { u32 playlist, u32 entry, u32 string[category count],
+ *                u32 split count, u32 split string[split count],
+ *                [u32 original title] }
+ *
+ * where str is a u32 length and that many bytes, and a string is an
+ * offset into the string block - in entries one more than the
+ * offset, 0 meaning none.
+ *
+ * The sources are every playlist in the playlist directory, whether
+ * or not it contributed, the journal path beside each (see
+ * playlist_set_journaled(): an append there changes what the playlist
+ * reads as, the .lpl itself untouched), and every database path a
+ * playlist led to, with a size of -1 for those that did not exist.  Yes and No are
+ * kept because boolean categories are filed under them in the
+ * language of the moment. */
+#define EXPLORE_CACHE_FILE_NAME            ".explore_cache"
+#define EXPLORE_CACHE_MAGIC                "RAEX"
+#define EXPLORE_CACHE_VERSION              2
+#define EXPLORE_CACHE_BYTE_ORDER_MARK      0x01020304
+#define EXPLORE_CACHE_FLAG_ORIGINAL_TITLE  (1 << 0)
+
+#ifdef EXPLORE_SHOW_ORIGINAL_TITLE
+#define EXPLORE_CACHE_FLAGS EXPLORE_CACHE_FLAG_ORIGINAL_TITLE
+#else
+#define EXPLORE_CACHE_FLAGS 0
+#endif
+
+enum explore_cache_source_kind
+{
+   EXPLORE_CACHE_SOURCE_PLAYLIST = 0,
+   EXPLORE_CACHE_SOURCE_DATABASE,
+   EXPLORE_CACHE_SOURCE_JOURNAL
+};
+
+typedef struct
+{
+   char *path;
+   int64_t size;               /* -1: did not exist */
+   int64_t mtime;
+   uint32_t kind;              /* enum explore_cache_source_kind */
+} explore_cache_source_t;
+
+typedef struct
+{
+   uint8_t *buf;
+   bool oom;
+} explore_cache_writer_t;
+
+typedef struct
+{
+   const uint8_t *p;
+   const uint8_t *end;
+   bool ok;
+} explore_cache_reader_t;
+
+/* Where a string went in the string block, looked up by address. */
+typedef struct
+{
+   const void *ptr;
+   uint32_t off;
+} explore_cache_ref_t;
+
+/* False when @path exists but cannot be stamped.  A build that
+ * depended on such a file is not cached: without a modification
+ * time, a rewrite of the same size would go unnoticed. */
+static bool explore_cache_stamp(const char *path,
+      int64_t *size, int64_t *mtime)
+{
+   if (!path_is_valid(path))
+   {
+      *size  = -1;
+      *mtime = 0;
+      return true;
+   }
+   return path_get_size_and_mtime(path, size, mtime);
+}
+
+static bool explore_cache_add_source(explore_cache_source_t **sources,
+      const char *path, enum explore_cache_source_kind kind)
+{
+   explore_cache_source_t src;
+   size_t _len = RBUF_LEN(*sources);
+
+   if (     !explore_cache_stamp(path, &src.size, &src.mtime)
+         || !(src.path = strdup(path)))
+      return false;
+   src.kind = (uint32_t)kind;
+   RBUF_PUSH(*sources, src);
+   if (RBUF_LEN(*sources) == _len)
+   {
+      free(src.path);
+      return false;
+   }
+   return true;
+}
+
+static void explore_cache_free_sources(explore_cache_source_t **sources)
+{
+   size_t i;
+   for (i = 0; i < RBUF_LEN(*sources); i++)
+      free((*sources)[i].path);
+   RBUF_FREE(*sources);
+}
+
+static void explore_cache_put(explore_cache_writer_t *w,
+      const void *data, size_t len)
+{
+   size_t at  = RBUF_LEN(w->buf);
+   size_t pad = EX_ARENA_ALIGN_UP(len, 4) - len;
+
+   RBUF_RESIZE(w->buf, at + len + pad);
+   if (RBUF_LEN(w->buf) != at + len + pad)
+   {
+      w->oom = true;
+      return;
+   }
+   memcpy(w->buf + at, data, len);
+   memset(w->buf + at + len, 0, pad);
+}
+
+static void explore_cache_put_u32(explore_cache_writer_t *w, uint32_t v)
+{
+   explore_cache_put(w, &v, sizeof(v));
+}
+
+static void explore_cache_put_i64(explore_cache_writer_t *w, int64_t v)
+{
+   explore_cache_put(w, &v, sizeof(v));
+}
+
+static void explore_cache_put_str(explore_cache_writer_t *w, const char *s)
+{
+   size_t _len = strlen(s);
+   explore_cache_put_u32(w, (uint32_t)_len);
+   explore_cache_put(w, s, _len);
+}
+
+/* Appends a { u32 idx, chars, NUL } record to the string block that
+ * starts at @block and notes where it went. */
+static void explore_cache_put_string(explore_cache_writer_t *w,
+      explore_cache_ref_t **refs, size_t block,
+      const void *ptr, uint32_t idx, const char *str)
+{
+   explore_cache_ref_t ref;
+
+   ref.ptr = ptr;
+   ref.off = (uint32_t)(RBUF_LEN(w->buf) - block);
+   explore_cache_put_u32(w, idx);
+   explore_cache_put(w, str, strlen(str) + 1);
+   RBUF_PUSH(*refs, ref);
+   if (RBUF_LEN(*refs) == 0 || (*refs)[RBUF_LEN(*refs) - 1].ptr != ptr)
+      w->oom = true;
+}
+
+static int explore_cache_ref_cmp(const void *a_, const void *b_)
+{
+   uintptr_t a = (uintptr_t)((const explore_cache_ref_t*)a_)->ptr;
+   uintptr_t b = (uintptr_t)((const explore_cache_ref_t*)b_)->ptr;
+   return (a < b) ? -1 : (a > b);
+}
+
+/* One more than the offset of @ptr in the string block, 0 for NULL
+ * or for a string that was never written. */
+static uint32_t explore_cache_ref_find(const explore_cache_ref_t *refs,
+      const void *ptr)
+{
+   explore_cache_ref_t key;
+   const explore_cache_ref_t *ref;
+
+   if (!ptr)
+      return 0;
+   key.ptr = ptr;
+   key.off = 0;
+   ref     = (const explore_cache_ref_t*)bsearch(&key, refs,
+         RBUF_LEN(refs), sizeof(*refs), explore_cache_ref_cmp);
+   return ref ? ref->off + 1 : 0;
+}
+
+static void explore_cache_save(explore_state_t *state,
+      const char *directory_playlist, const char *directory_database,
+      explore_cache_source_t *sources)
+{
+   size_t i, block;
+   unsigned cat;
+   bool ok;
+   uint32_t block_len;
+   uint8_t has_unknown[EXPLORE_CAT_COUNT];
+   char path[PATH_MAX_LENGTH];
+   char tmp_path[PATH_MAX_LENGTH];
+   explore_cache_writer_t w;
+   explore_cache_ref_t *refs = NULL;
+
+   w.buf = NULL;
+   w.oom = false;
+
+   explore_cache_put(&w, EXPLORE_CACHE_MAGIC, 4);
+   explore_cache_put_u32(&w, EXPLORE_CACHE_VERSION);
+   explore_cache_put_u32(&w, EXPLORE_CACHE_BYTE_ORDER_MARK);
+   explore_cache_put_u32(&w, EXPLORE_CACHE_FLAGS);
+   explore_cache_put_u32(&w, EXPLORE_CAT_COUNT);
+   explore_cache_put_str(&w, directory_database);
+   explore_cache_put_str(&w, msg_hash_to_str(MENU_ENUM_LABEL_VALUE_YES));
+   explore_cache_put_str(&w, msg_hash_to_str(MENU_ENUM_LABEL_VALUE_NO));
+
+   explore_cache_put_u32(&w, (uint32_t)RBUF_LEN(sources));
+   for (i = 0; i < RBUF_LEN(sources); i++)
+   {
+      explore_cache_put_u32(&w, sources[i].kind);
+      explore_cache_put_i64(&w, sources[i].size);
+      explore_cache_put_i64(&w, sources[i].mtime);
+      explore_cache_put_str(&w, sources[i].path);
+   }
+
+   explore_cache_put_u32(&w, (uint32_t)RBUF_LEN(state->playlists));
+   for (i = 0; i < RBUF_LEN(state->playlists); i++)
+   {
+      const char *pl_path = playlist_get_conf_path(state->playlists[i]);
+      if (!pl_path)
+         goto end;
+      explore_cache_put_str(&w, pl_path);
+      explore_cache_put_u32(&w,
+            (uint32_t)playlist_size(state->playlists[i]));
+   }
+
+   for (cat = 0; cat < EXPLORE_CAT_COUNT; cat++)
+      has_unknown[cat] = state->has_unknown[cat] ? 1 : 0;
+   explore_cache_put(&w, has_unknown, sizeof(has_unknown));
+
+   /* The block length is filled in once it is known. */
+   explore_cache_put_u32(&w, 0);
+   block = RBUF_LEN(w.buf);
+   for (cat = 0; cat < EXPLORE_CAT_COUNT; cat++)
+      for (i = 0; i < RBUF_LEN(state->by[cat]); i++)
+         explore_cache_put_string(&w, &refs, block, state->by[cat][i],
+               state->by[cat][i]->idx, state->by[cat][i]->str);
+#ifdef EXPLORE_SHOW_ORIGINAL_TITLE
+   for (i = 0; i < RBUF_LEN(state->entries); i++)
+      if (state->entries[i].original_title)
+         explore_cache_put_string(&w, &refs, block,
+               state->entries[i].original_title, 0,
+               state->entries[i].original_title);
+#endif
+   if (w.oom)
+      goto end;
+   block_len = (uint32_t)(RBUF_LEN(w.buf) - block);
+   memcpy(w.buf + block - sizeof(block_len), &block_len, sizeof(block_len));
+
+   if (refs)
+      qsort(refs, RBUF_LEN(refs), sizeof(*refs), explore_cache_ref_cmp);
+
+   for (cat = 0; cat < EXPLORE_CAT_COUNT; cat++)
+   {
+      explore_cache_put_u32(&w, (uint32_t)RBUF_LEN(state->by[cat]));
+      for (i = 0; i < RBUF_LEN(state->by[cat]); i++)
+         explore_cache_put_u32(&w,
+               explore_cache_ref_find(refs, state->by[cat][i]) - 1);
+   }
+
+   explore_cache_put_u32(&w, (uint32_t)RBUF_LEN(state->entries));
+   for (i = 0; i < RBUF_LEN(state->entries); i++)
+   {
+      size_t pl_idx;
+      const explore_entry_t *e = &state->entries[i];
+      explore_string_t **split;
+
+      for (pl_idx = 0; pl_idx < RBUF_LEN(state->playlists); pl_idx++)
+      {
+         const struct playlist_entry *pl_first = NULL;
+         playlist_t *pl = state->playlists[pl_idx];
+         playlist_get_index(pl, 0, &pl_first);
+         if (     e->playlist_entry >= pl_first
+               && e->playlist_entry <  pl_first + playlist_size(pl))
+         {
+            explore_cache_put_u32(&w, (uint32_t)pl_idx);
+            explore_cache_put_u32(&w,
+                  (uint32_t)(e->playlist_entry - pl_first));
+            break;
+         }
+      }
+      if (pl_idx == RBUF_LEN(state->playlists))
+         goto end;
+
+      for (cat = 0; cat < EXPLORE_CAT_COUNT; cat++)
+         explore_cache_put_u32(&w, explore_cache_ref_find(refs, e->by[cat]));
+
+      for (split = e->split; split && *split; split++);
+      explore_cache_put_u32(&w, (uint32_t)(split - e->split));
+      for (split = e->split; split && *split; split++)
+         explore_cache_put_u32(&w, explore_cache_ref_find(refs, *split));
+#ifdef EXPLORE_SHOW_ORIGINAL_TITLE
+      explore_cache_put_u32(&w,
+            explore_cache_ref_find(refs, e->original_title));
+#endif
+   }
+   if (w.oom)
+      goto end;
+
+   /* Written aside and moved into place, as the scan cache is: a
+    * state built from this file may still be using the old one. */
+   fill_pathname_join_special(path, directory_playlist,
+         EXPLORE_CACHE_FILE_NAME, sizeof(path));
+   fill_pathname_join_delim(tmp_path, path, "tmp", '.', sizeof(tmp_path));
+   ok = filestream_write_file(tmp_path, w.buf, (int64_t)RBUF_LEN(w.buf));
+   if (ok && filestream_rename(tmp_path, path) != 0)
+   {
+      filestream_delete(path);
+      ok = filestream_rename(tmp_path, path) == 0;
+   }
+   if (!ok)
+   {
+      filestream_delete(tmp_path);
+      RARCH_WARN("[Explore] Could not write cache \"%s\".\n", path);
+   }
+
+end:
+   RBUF_FREE(refs);
+   RBUF_FREE(w.buf);
+}
+
+static const uint8_t *explore_cache_get(explore_cache_reader_t *r,
+      size_t len)
+{
+   const uint8_t *p = r->p;
+   size_t padded    = EX_ARENA_ALIGN_UP(len, 4);
+
+   if (!r->ok || padded < len || (size_t)(r->end - r->p) < padded)
+   {
+      r->ok = false;
+      return NULL;
+   }
+   r->p += padded;
+   return p;
+}
+
+static uint32_t explore_cache_get_u32(explore_cache_reader_t *r)
+{
+   uint32_t v       = 0;
+   const uint8_t *p = explore_cache_get(r, sizeof(v));
+   if (p)
+      memcpy(&v, p, sizeof(v));
+   return v;
+}
+
+static int64_t explore_cache_get_i64(explore_cache_reader_t *r)
+{
+   int64_t v        = 0;
+   const uint8_t *p = explore_cache_get(r, sizeof(v));
+   if (p)
+      memcpy(&v, p, sizeof(v));
+   return v;
+}
+
+/* Copies a str field out into @s, failing on one that does not fit. */
+static bool explore_cache_get_str(explore_cache_reader_t *r,
+      char *s, size_t len)
+{
+   uint32_t _len    = explore_cache_get_u32(r);
+   const uint8_t *p = explore_cache_get(r, _len);
+   if (!p || _len >= len)
+   {
+      r->ok = false;
+      return false;
+   }
+   memcpy(s, p, _len);
+   s[_len] = '\0';
+   return true;
+}
+
+static bool explore_cache_match_str(explore_cache_reader_t *r,
+      const char *s)
+{
+   uint32_t _len    = explore_cache_get_u32(r);
+   const uint8_t *p = explore_cache_get(r, _len);
+   return p && _len == strlen(s) && !memcmp(p, s, _len);
+}
+
+/* The record at offset @off of the string block, NULL unless it lies
+ * wholly inside the block, aligned and NUL-terminated. */
+static explore_string_t *explore_cache_string(const uint8_t *block,
+      uint32_t block_len, uint32_t off)
+{
+   if (     (off & 3)
+         || off >= block_len
+         || block_len - off <= sizeof(uint32_t)
+         || !memchr(block + off + sizeof(uint32_t), '\0',
+               block_len - off - sizeof(uint32_t)))
+      return NULL;
+   return (explore_string_t*)(block + off);
+}
+
+static void *explore_cache_map(const char *path, size_t *len,
+      bool *mapped)
+{
+   void *data    = NULL;
+   int64_t _len  = 0;
+#ifdef HAVE_MMAP
+   /* Only a host file can be mapped, not a VFS URL. */
+   if (!strstr(path, "://"))
+   {
+      struct stat st;
+      int fd = open(path, O_RDONLY);
+      if (fd < 0)
+         return NULL;
+      if (     fstat(fd, &st) == 0
+            && st.st_size > 0
+            && (uint64_t)st.st_size <= (uint64_t)SIZE_MAX)
+         data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE,
+               fd, 0);
+      close(fd);
+      if (!data || data == MAP_FAILED)
+         return NULL;
+      *len    = (size_t)st.st_size;
+      *mapped = true;
+      return data;
+   }
+#endif
+   if (     !path_is_valid(path)
+         || !filestream_read_file(path, &data, &_len)
+         || !data)
+   {
+      free(data);
+      return NULL;
+   }
+   *len    = (size_t)_len;
+   *mapped = false;
+   return data;
+}
+
+static void explore_cache_unmap(explore_state_t *state)
+{
+   if (!state->cache_image)
+      return;
+#ifdef HAVE_MMAP
+   if (state->cache_image_mapped)
+      munmap(state->cache_image, state->cache_image_len);
+   else
+#endif
+      free(state->cache_image);
+   state->cache_image        = NULL;
+   state->cache_image_len    = 0;
+   state->cache_image_mapped = false;
+}
+
+static bool explore_cache_sources_current(explore_cache_reader_t *r,
+      const char *directory_playlist)
+{
+   uint32_t i, count;
+   size_t playlists = 0;
+   libretro_vfs_implementation_dir *dir;
+   char path[PATH_MAX_LENGTH];
+
+   count = explore_cache_get_u32(r);
+   for (i = 0; i < count && r->ok; i++)
+   {
+      int64_t size, mtime;
+      uint32_t kind        = explore_cache_get_u32(r);
+      int64_t cached_size  = explore_cache_get_i64(r);
+      int64_t cached_mtime = explore_cache_get_i64(r);
+
+      if (     !explore_cache_get_str(r, path, sizeof(path))
+            || !explore_cache_stamp(path, &size, &mtime)
+            || size  != cached_size
+            || mtime != cached_mtime)
+         return false;
+      if (kind == EXPLORE_CACHE_SOURCE_PLAYLIST)
+         playlists++;
+   }
+   if (!r->ok)
+      return false;
+
+   /* Every playlist the cache knows of is unchanged; one it does not
+    * know of would show up as an extra. */
+   for (dir = retro_vfs_opendir_impl(directory_playlist, false);
+         dir && retro_vfs_readdir_impl(dir);)
+   {
+      const char *fname = retro_vfs_dirent_get_name_impl(dir);
+      const char *fext  = fname ? strrchr(fname, '.') : NULL;
+      if (fext && !strcasecmp(fext, ".lpl"))
+         playlists--;
+   }
+   if (dir)
+      retro_vfs_closedir_impl(dir);
+   return playlists == 0;
+}
+
+/* Fills an empty @state from the cache, leaving whatever it got
+ * through to the caller to free when the cache turns out to be
+ * missing, stale or damaged. */
+static bool explore_cache_load(explore_state_t *state,
+      const char *directory_playlist, const char *directory_database)
+{
+   size_t i;
+   unsigned cat;
+   uint32_t count, block_len;
+   const uint8_t *block, *has_unknown;
+   explore_cache_reader_t r;
+   char path[PATH_MAX_LENGTH];
+
+   fill_pathname_join_special(path, directory_playlist,
+         EXPLORE_CACHE_FILE_NAME, sizeof(path));
+   if (!(state->cache_image = explore_cache_map(path,
+               &state->cache_image_len, &state->cache_image_mapped)))
+      return false;
+
+   r.p   = (const uint8_t*)state->cache_image;
+   r.end = r.p + state->cache_image_len;
+   r.ok  = true;
+
+   if (     !(block = explore_cache_get(&r, 4))
+         || memcmp(block, EXPLORE_CACHE_MAGIC, 4)
+         || explore_cache_get_u32(&r) != EXPLORE_CACHE_VERSION
+         || explore_cache_get_u32(&r) != EXPLORE_CACHE_BYTE_ORDER_MARK
+         || explore_cache_get_u32(&r) != EXPLORE_CACHE_FLAGS
+         || explore_cache_get_u32(&r) != EXPLORE_CAT_COUNT
+         || !explore_cache_match_str(&r, directory_database)
+         || !explore_cache_match_str(&r,
+               msg_hash_to_str(MENU_ENUM_LABEL_VALUE_YES))
+         || !explore_cache_match_str(&r,
+               msg_hash_to_str(MENU_ENUM_LABEL_VALUE_NO))
+         || !explore_cache_sources_current(&r, directory_playlist))
+      return false;
+
+   count = explore_cache_get_u32(&r);
+   for (i = 0; i < count && r.ok; i++)
+   {
+      playlist_t *playlist;
+      size_t _len = RBUF_LEN(state->playlists);
+
+      if (     !explore_cache_get_str(&r, path, sizeof(path))
+            || !(playlist = explore_playlist_open(path)))
+         return false;
+      RBUF_PUSH(state->playlists, playlist);
+      if (RBUF_LEN(state->playlists) == _len)
+      {
+         playlist_free(playlist);
+         return false;
+      }
+      if (playlist_size(playlist) != explore_cache_get_u32(&r))
+         return false;
+   }
+
+   if (!(has_unknown = explore_cache_get(&r, EXPLORE_CAT_COUNT)))
+      return false;
+   for (cat = 0; cat < EXPLORE_CAT_COUNT; cat++)
+      state->has_unknown[cat] = (has_unknown[cat] != 0);
+
+   block_len = explore_cache_get_u32(&r);
+   if (!(block = explore_cache_get(&r, block_len)))
+      return false;
+
+   for (cat = 0; cat < EXPLORE_CAT_COUNT; cat++)
+   {
+      count = explore_cache_get_u32(&r);
+      if (!r.ok || count > (size_t)(r.end - r.p) / sizeof(uint32_t))
+         return false;
+      RBUF_RESIZE(state->by[cat], count);
+      if (RBUF_LEN(state->by[cat]) != count)
+         return false;
+      for (i = 0; i < count; i++)
+      {
+         explore_string_t *str = explore_cache_string(block, block_len,
+               explore_cache_get_u32(&r));
+         /* Which also makes the views' range filters safe. */
+         if (!str || str->idx != i)
+            return false;
+         state->by[cat][i] = str;
+      }
+   }
+
+   count = explore_cache_get_u32(&r);
+   if (!r.ok || count > (size_t)(r.end - r.p) / sizeof(uint32_t))
+      return false;
+   RBUF_RESIZE(state->entries, count);
+   if (RBUF_LEN(state->entries) != count)
+      return false;
+   for (i = 0; i < count; i++)
+   {
+      uint32_t k, split_count, off;
+      explore_entry_t *e = &state->entries[i];
+      uint32_t pl_idx    = explore_cache_get_u32(&r);
+      uint32_t entry_idx = explore_cache_get_u32(&r);
+
+      if (     pl_idx    >= RBUF_LEN(state->playlists)
+            || entry_idx >= playlist_size(state->playlists[pl_idx]))
+         return false;
+      playlist_get_index(state->playlists[pl_idx], entry_idx,
+            &e->playlist_entry);
+
+      for (cat = 0; cat < EXPLORE_CAT_COUNT; cat++)
+      {
+         e->by[cat] = NULL;
+         if (     (off = explore_cache_get_u32(&r))
+               && !(e->by[cat] = explore_cache_string(block, block_len,
+                     off - 1)))
+            return false;
+      }
+
+      e->split    = NULL;
+      split_count = explore_cache_get_u32(&r);
+      if (!r.ok || split_count > (size_t)(r.end - r.p) / sizeof(uint32_t))
+         return false;
+      if (split_count)
+      {
+         if (!(e->split = (explore_string_t**)ex_arena_alloc(
+                     &state->arena, (split_count + 1) * sizeof(*e->split))))
+            return false;
+         for (k = 0; k < split_count; k++)
+            if (!(e->split[k] = explore_cache_string(block, block_len,
+                        explore_cache_get_u32(&r) - 1)))
+               return false;
+         e->split[split_count] = NULL;
+      }
+
+#ifdef EXPLORE_SHOW_ORIGINAL_TITLE
+      e->original_title = NULL;
+      if ((off = explore_cache_get_u32(&r)))
+      {
+         explore_string_t *title = explore_cache_string(block, block_len,
+               off - 1);
+         if (!title)
+            return false;
+         e->original_title = title->str;
+      }
+#endif
+   }
+
+   return r.ok && r.p == r.end;
+}
+
+/* Everything a state owns except its icons, which are only ever
+ * loaded once it is installed. */
+static void explore_free_contents(explore_state_t *state)
+{
+   unsigned i;
+   for (i = 0; i != EXPLORE_CAT_COUNT; i++)
+      RBUF_FREE(state->by[i]);
+
+   RBUF_FREE(state->entries);
+
+   for (i = 0; i != RBUF_LEN(state->playlists); i++)
+      playlist_free(state->playlists[i]);
+   RBUF_FREE(state->playlists);
+
+   ex_arena_free(&state->arena);
+   explore_cache_unmap(state);
+}
+
 explore_state_t *menu_explore_build_list(const char *directory_playlist,
       const char *directory_database)
 {
@@ -495,7 +1220,11 @@ explore_state_t *menu_explore_build_list(const char *directory_playlist,
    int *rdb_indices                               = NULL;
    explore_string_t **cat_maps[EXPLORE_CAT_COUNT] = {NULL};
    explore_string_t **split_buf                   = NULL;
+   libretrodb_field_t *rdb_fields                 = NULL;
+   char *str_buf                                  = NULL;
    libretro_vfs_implementation_dir *dir           = NULL;
+   explore_cache_source_t *cache_sources          = NULL;
+   bool cacheable                                 = true;
 
    explore_state_t *state = (explore_state_t*)calloc(1, sizeof(*state));
 
@@ -504,24 +1233,20 @@ explore_state_t *menu_explore_build_list(const char *directory_playlist,
 
    state->label_explore_item_str = MENU_ENUM_LABEL_EXPLORE_ITEM_STR;
 
+   if (explore_cache_load(state, directory_playlist, directory_database))
+      return state;
+   explore_free_contents(state);
+   memset(state->has_unknown, 0, sizeof(state->has_unknown));
+
    /* Index all playlists */
    for (dir = retro_vfs_opendir_impl(directory_playlist, false); dir;)
    {
-      playlist_config_t playlist_config;
       size_t j, used_entries                    = 0;
       playlist_t *playlist                      = NULL;
       const char *fext                          = NULL;
       const char *fname                         = NULL;
       uint32_t fhash                            = 0;
 
-      playlist_config.path[0]                   = '\0';
-      playlist_config.base_content_directory[0] = '\0';
-      playlist_config.capacity                  = 0;
-      playlist_config.old_format                = false;
-      playlist_config.compress                  = false;
-      playlist_config.fuzzy_archive_match       = false;
-      playlist_config.autofix_paths             = false;
-
       if (!retro_vfs_readdir_impl(dir))
       {
          retro_vfs_closedir_impl(dir);
@@ -535,10 +1260,18 @@ explore_state_t *menu_explore_build_list(const char *directory_playlist,
       if (!fext || strcasecmp(fext, ".lpl"))
          continue;
 
-      fill_pathname_join_special(playlist_config.path,
-            directory_playlist, fname, sizeof(playlist_config.path));
-      playlist_config.capacity          = COLLECTION_SIZE;
-      playlist                          = playlist_init(&playlist_config);
+      fill_pathname_join_special(tmp,
+            directory_playlist, fname, sizeof(tmp));
+      playlist_get_journal_path(tmp, tmp, sizeof(tmp));
+      if (cacheable && !explore_cache_add_source(&cache_sources, tmp,
+               EXPLORE_CACHE_SOURCE_JOURNAL))
+         cacheable = false;
+      fill_pathname_join_special(tmp,
+            directory_playlist, fname, sizeof(tmp));
+      if (cacheable && !explore_cache_add_source(&cache_sources, tmp,
+               EXPLORE_CACHE_SOURCE_PLAYLIST))
+         cacheable = false;
+      playlist                          = explore_playlist_open(tmp);
 
       fhash = ex_hash32_nocase_filtered(
             (unsigned char*)fname, fext - fname, '0', 255);
@@ -605,6 +1338,10 @@ explore_state_t *menu_explore_build_list(const char *directory_playlist,
                ext_path[3] = 'b';
             }
 
+            if (cacheable && !explore_cache_add_source(&cache_sources, tmp,
+                     EXPLORE_CACHE_SOURCE_DATABASE))
+               cacheable = false;
+
             if (libretrodb_open(tmp, newrdb.handle, false) != 0)
             {
                /* Invalid RDB file */
@@ -647,59 +1384,65 @@ explore_state_t *menu_explore_build_list(const char *directory_playlist,
    }
 
    /* Loop through all RDBs referenced in the playlists
-    * and load meta data strings */
+    * and load meta data strings.
+    *
+    * Records are read in place rather than decoded into DOM trees:
+    * most of them match no playlist entry, and for those nothing is
+    * copied at all.  For the ones that do, only the strings Explore
+    * files the entry under are copied out, into one reused buffer. */
+   rdb_fields = (libretrodb_field_t*)malloc(
+         EXPLORE_RDB_MAX_FIELDS * sizeof(*rdb_fields));
    for (i = 0; i != RBUF_LEN(rdbs); i++)
    {
-      struct rmsgpack_dom_value item;
-      struct explore_rdb* rdb  = &rdbs[i];
-      libretrodb_cursor_t *cur = libretrodb_cursor_new();
-      bool more                =
-         (
-          libretrodb_cursor_open(rdb->handle, cur, NULL) == 0
-          && libretrodb_cursor_read_item(cur, &item) == 0);
-
-      for (; more; more = (rmsgpack_dom_value_free(&item),
-               libretrodb_cursor_read_item(cur, &item) == 0))
+      int num_fields;
+      struct explore_rdb* rdb     = &rdbs[i];
+      libretrodb_reader_t *reader = rdb_fields
+         ? libretrodb_reader_open(rdb->handle)
+         : NULL;
+
+      while (reader && (num_fields = libretrodb_reader_next(reader,
+                  rdb_fields, EXPLORE_RDB_MAX_FIELDS)) >= 0)
       {
          unsigned k, l, cat;
          explore_entry_t* e;
          const char *fields[EXPLORE_CAT_COUNT];
+         const libretrodb_field_t *field_src[EXPLORE_CAT_COUNT];
+         ptrdiff_t field_at[EXPLORE_CAT_COUNT];
          char numeric_buf[EXPLORE_CAT_COUNT][16];
-         uint32_t crc32                     = 0;
-         uint32_t meta_count                = 0;
-         char *name                         = NULL;
+         uint32_t crc32                         = 0;
+         uint32_t meta_count                    = 0;
+         const libretrodb_field_t *name         = NULL;
 #ifdef EXPLORE_SHOW_ORIGINAL_TITLE
-         char *original_title               = NULL;
+         const libretrodb_field_t *original_title = NULL;
 #endif
-         struct explore_source* src         = NULL;
+         struct explore_source* src             = NULL;
 
-         if (item.type != RDT_MAP)
-            continue;
+         RBUF_CLEAR(str_buf);
 
          for (k = 0; k < EXPLORE_CAT_COUNT; k++)
-            fields[k]                       = NULL;
+         {
+            fields[k]                           = NULL;
+            field_src[k]                        = NULL;
+         }
 
-         for (k = 0; k < item.val.map.len; k++)
+         for (k = 0; k < (unsigned)num_fields; k++)
          {
-            const char *key_str             = NULL;
-            struct rmsgpack_dom_value *key  = &item.val.map.items[k].key;
-            struct rmsgpack_dom_value *val  = &item.val.map.items[k].value;
-            if (!key || !val || key->type != RDT_STRING)
-               continue;
+            const libretrodb_field_t *val       = &rdb_fields[k];
 
-            key_str                         = key->val.string.buff;
-            if (!strcmp(key_str, "crc"))
+            if (explore_rdb_key_is(val, "crc"))
             {
-               switch (val->val.binary.len)
+               const uint8_t *b = (const uint8_t*)val->val.string.buff;
+               switch (val->type == RDT_BINARY ? val->val.string.len : 0)
                {
                   case 1:
-                     crc32 = *(uint8_t*)val->val.binary.buff;
+                     crc32 = b[0];
                      break;
                   case 2:
-                     crc32 = swap_if_little16(*(uint16_t*)val->val.binary.buff);
+                     crc32 = ((uint32_t)b[0] << 8) | b[1];
                      break;
                   case 4:
-                     crc32 = swap_if_little32(*(uint32_t*)val->val.binary.buff);
+                     crc32 = ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16)
+                           | ((uint32_t)b[2] << 8)  |  (uint32_t)b[3];
                      break;
                   default:
                      crc32 = 0;
@@ -708,22 +1451,24 @@ explore_state_t *menu_explore_build_list(const char *directory_playlist,
 
                continue;
             }
-            else if (!strcmp(key_str, "name"))
+            else if (explore_rdb_key_is(val, "name"))
             {
-               name = val->val.string.buff;
+               if (val->type == RDT_STRING)
+                  name = val;
                continue;
             }
 #ifdef EXPLORE_SHOW_ORIGINAL_TITLE
-            else if (!strcmp(key_str, "original_title"))
+            else if (explore_rdb_key_is(val, "original_title"))
             {
-               original_title = val->val.string.buff;
+               if (val->type == RDT_STRING)
+                  original_title = val;
                continue;
             }
 #endif
 
             for (cat = 0; cat != EXPLORE_CAT_COUNT; cat++)
             {
-               if (strcmp(key_str, explore_by_info[cat].rdbkey) != 0)
+               if (!explore_rdb_key_is(val, explore_by_info[cat].rdbkey))
                   continue;
 
                meta_count++;
@@ -741,13 +1486,13 @@ explore_state_t *menu_explore_build_list(const char *directory_playlist,
                {
                   if (val->type >= RDT_STRING)
                      break;
-                  fields[cat] = msg_hash_to_str(val->val.int_ ?
+                  fields[cat] = msg_hash_to_str(val->val.uint_ ?
                         MENU_ENUM_LABEL_VALUE_YES : MENU_ENUM_LABEL_VALUE_NO);
                   break;
                }
                if (val->type != RDT_STRING)
                   break;
-               fields[cat] = val->val.string.buff;
+               field_src[cat] = val;
                break;
             }
          }
@@ -759,7 +1504,9 @@ explore_state_t *menu_explore_build_list(const char *directory_playlist,
          }
          if (!src && name)
          {
-            ptrdiff_t idx = RHMAP_IDX_STR(rdb->playlist_names, name);
+            ptrdiff_t at  = explore_rdb_copy_string(&str_buf, name);
+            ptrdiff_t idx = (at < 0) ? -1
+               : RHMAP_IDX_STR(rdb->playlist_names, str_buf + at);
             src = (idx != -1 ? &rdb->playlist_names[idx] : NULL);
          }
          if (!src)
@@ -767,6 +1514,17 @@ explore_state_t *menu_explore_build_list(const char *directory_playlist,
          if (src->entry_index != (uint32_t)-1 && src->meta_count >= meta_count)
             continue;
 
+         /* A match: now the strings are worth copying.  All of them
+          * first, then the pointers, since each copy may move the
+          * buffer. */
+         for (cat = 0; cat != EXPLORE_CAT_COUNT; cat++)
+            field_at[cat] = field_src[cat]
+               ? explore_rdb_copy_string(&str_buf, field_src[cat])
+               : -1;
+         for (cat = 0; cat != EXPLORE_CAT_COUNT; cat++)
+            if (field_at[cat] >= 0)
+               fields[cat] = str_buf + field_at[cat];
+
          if (src->entry_index == (uint32_t)-1)
          {
             src->entry_index = (uint32_t)RBUF_LEN(state->entries);
@@ -792,11 +1550,11 @@ explore_state_t *menu_explore_build_list(const char *directory_playlist,
          }
 
 #ifdef EXPLORE_SHOW_ORIGINAL_TITLE
-         if (original_title && *original_title)
+         if (original_title && original_title->val.string.len)
          {
-            size_t _len       = strlen(original_title) + 1;
+            size_t _len       = original_title->val.string.len;
             e->original_title = (char*)
-               ex_arena_alloc(&state->arena, _len);
+               ex_arena_alloc(&state->arena, _len + 1);
             /* NULL-check: arena alloc returns NULL on OOM.  Skip
              * the memcpy; e->original_title stays NULL (matches
              * the 'e->original_title = NULL' initialisation a
@@ -804,7 +1562,11 @@ explore_state_t *menu_explore_build_list(const char *directory_playlist,
              * EXPLORE_SHOW_ORIGINAL_TITLE are expected to gate
              * reads of this field. */
             if (e->original_title)
-               memcpy(e->original_title, original_title, _len);
+            {
+               memcpy(e->original_title,
+                     original_title->val.string.buff, _len);
+               e->original_title[_len] = '\0';
+            }
          }
 #endif
 
@@ -828,13 +1590,14 @@ explore_state_t *menu_explore_build_list(const char *directory_playlist,
          /* Do not leave early, even if all items have been found - merge all hits */
       }
 
-      libretrodb_cursor_close(cur);
-      libretrodb_cursor_free(cur);
+      libretrodb_reader_close(reader);
       libretrodb_close(rdb->handle);
       libretrodb_free(rdb->handle);
       RHMAP_FREE(rdb->playlist_crcs);
       RHMAP_FREE(rdb->playlist_names);
    }
+   free(rdb_fields);
+   RBUF_FREE(str_buf);
    RBUF_FREE(split_buf);
    RHMAP_FREE(rdb_indices);
    RBUF_FREE(rdbs);
@@ -859,6 +1622,11 @@ explore_state_t *menu_explore_build_list(const char *directory_playlist,
       qsort(state->entries,
          RBUF_LEN(state->entries),
          sizeof(*state->entries), explore_qsort_func_entries);
+
+   if (cacheable)
+      explore_cache_save(state, directory_playlist, directory_database,
+            cache_sources);
+   explore_cache_free_sources(&cache_sources);
    return state;
 }
 
@@ -1911,24 +2679,15 @@ void menu_explore_context_deinit(void)
 
 void menu_explore_free_state(explore_state_t *state)
 {
-   unsigned i;
    if (!state)
       return;
-   for (i = 0; i != EXPLORE_CAT_COUNT; i++)
-      RBUF_FREE(state->by[i]);
-
-   RBUF_FREE(state->entries);
-
-   for (i = 0; i != RBUF_LEN(state->playlists); i++)
-      playlist_free(state->playlists[i]);
-   RBUF_FREE(state->playlists);
 
    /* Invalidate in-flight async icon loads before freeing */
    explore_icon_load_gen++;
    explore_unload_icons(state);
    RBUF_FREE(state->icons);
 
-   ex_arena_free(&state->arena);
+   explore_free_contents(state);
 }
 
 void menu_explore_free(void)
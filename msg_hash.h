@@ -22084,6 +22084,8 @@ enum msg_hash_enums
    MENU_LABEL(SAVESTATE_THUMBNAIL_ENABLE),
    MENU_LABEL(SAVE_FILE_COMPRESSION),
    MENU_LABEL(SAVESTATE_FILE_COMPRESSION),
+   MENU_LABEL(SAVE_COMPRESSION_ZSTD),
+   MENU_LABEL(SAVE_COMPRESSION_ZSTD_LEVEL),
 
    /* GENERATED REGION: screensaver suspend group enum rows
     * (see settings/settings_def_video_suspend_screensaver.h). */
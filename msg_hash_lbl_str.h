@@ -1481,6 +1481,8 @@
 #define MENU_ENUM_LABEL_SAVESTATE_AUTO_INDEX_STR "savestate_auto_index"
 #define MENU_ENUM_LABEL_SAVESTATE_FILE_COMPRESSION_STR "savestate_file_compression"
 #define MENU_ENUM_LABEL_SAVESTATE_MAX_KEEP_STR "savestate_max_keep"
+#define MENU_ENUM_LABEL_SAVE_COMPRESSION_ZSTD_LEVEL_STR "save_compression_zstd_level"
+#define MENU_ENUM_LABEL_SAVE_COMPRESSION_ZSTD_STR "save_compression_zstd"
 #define MENU_ENUM_LABEL_SAVE_CURRENT_CONFIG_STR "save_current_config"
 #define MENU_ENUM_LABEL_SAVE_CURRENT_CONFIG_OVERRIDE_CONTENT_DIR_STR "save_current_config_override_content_dir"
 #define MENU_ENUM_LABEL_SAVE_CURRENT_CONFIG_OVERRIDE_CORE_STR "save_current_config_override_core"
@@ -53,6 +53,23 @@ typedef struct netplay_client_info
    char     name[NETPLAY_NICK_LEN];
 } netplay_client_info_t;
 
+/* What rollback has cost over the last few frames
+ * (RARCH_NETPLAY_CTL_GET_ROLLBACK_STATS).  Times are microseconds a
+ * frame, averaged over every frame counted. */
+typedef struct netplay_rollback_stats
+{
+   uint32_t frames;           /* frames counted */
+   uint32_t rollbacks;        /* ...that rolled back */
+   uint32_t replayed;         /* frames re-run, in all */
+   uint32_t max_replayed;     /* most re-run by one rollback */
+   uint32_t stalled;          /* frames spent stalled */
+   uint32_t serialize_usec;
+   uint32_t unserialize_usec;
+   uint32_t replay_usec;
+   uint32_t net_usec;
+   uint32_t stall_usec;
+} netplay_rollback_stats_t;
+
 typedef struct mitm_server
 {
    const char *name;
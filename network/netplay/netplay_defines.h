@@ -88,7 +88,8 @@ enum rarch_netplay_ctl_state
    RARCH_NETPLAY_CTL_BAN_CLIENT,
    RARCH_NETPLAY_CTL_SET_CORE_PACKET_INTERFACE,
    RARCH_NETPLAY_CTL_USE_CORE_PACKET_INTERFACE,
-   RARCH_NETPLAY_CTL_ALLOW_TIMESKIP
+   RARCH_NETPLAY_CTL_ALLOW_TIMESKIP,
+   RARCH_NETPLAY_CTL_GET_ROLLBACK_STATS
 };
 
 /* The current status of a connection */
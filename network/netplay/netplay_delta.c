@@ -0,0 +1,708 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "netplay_private.h"
+
+/* The rollback ring's states as tables of page ids, and the savestate
+ * deltas and repairs exchanged between peers as runs of those pages.
+ * Nothing here touches a socket or the core: the frontend serializes
+ * into the working buffer and sends what is built here. */
+
+/* Point work page @i at page @id, moving the reference over. */
+static void netplay_work_page_set(netplay_t *netplay, size_t i, uint32_t id)
+{
+   netplay_pages_ref(netplay->pages, id);
+   netplay_pages_unref(netplay->pages, netplay->work_pages[i]);
+   netplay->work_pages[i] = id;
+}
+
+/**
+ * netplay_state_invalidate
+ *
+ * Forget what the working buffer mirrors, after writing to it with
+ * no frame to store the result in.
+ */
+void netplay_state_invalidate(netplay_t *netplay)
+{
+   size_t i;
+   for (i = 0; i < netplay->state_pages; i++)
+      netplay_work_page_set(netplay, i, NETPLAY_PAGE_NONE);
+}
+
+/**
+ * netplay_delta_frame_store
+ *
+ * Store the working buffer as this frame's state.  A page that still
+ * matches what the buffer held before is compared once and shared,
+ * never hashed; only pages that changed are looked up or added.
+ */
+bool netplay_delta_frame_store(netplay_t *netplay,
+      struct delta_frame *delta)
+{
+   size_t i;
+
+   for (i = 0; i < netplay->state_pages; i++)
+   {
+      const uint8_t *page = netplay->state_work + i * NETPLAY_PAGE_SIZE;
+      uint32_t id         = netplay->work_pages[i];
+
+      if (     id != NETPLAY_PAGE_NONE
+            && !memcmp(page, netplay_pages_get(netplay->pages, id),
+                  NETPLAY_PAGE_SIZE))
+         netplay_pages_ref(netplay->pages, id);
+      else if ((id = netplay_pages_intern(netplay->pages, page))
+            == NETPLAY_PAGE_NONE)
+      {
+         /* Out of memory: the frame holds no coherent state, so give
+          * it none rather than a mix of two frames. */
+         for (; i < netplay->state_pages; i++)
+         {
+            netplay_pages_unref(netplay->pages, delta->pages[i]);
+            delta->pages[i] = NETPLAY_PAGE_ZERO;
+            netplay_work_page_set(netplay, i, NETPLAY_PAGE_NONE);
+         }
+         return false;
+      }
+
+      /* id carries the frame's reference; the mirror takes its own. */
+      netplay_pages_unref(netplay->pages, delta->pages[i]);
+      delta->pages[i] = id;
+      netplay_work_page_set(netplay, i, id);
+   }
+
+   return true;
+}
+
+/**
+ * netplay_state_load_pages
+ *
+ * Bring the state held as @count page ids into the working buffer,
+ * zeros past them, copying only the pages that differ from what it
+ * holds already.
+ */
+static void netplay_state_load_pages(netplay_t *netplay,
+      const uint32_t *pages, size_t count)
+{
+   size_t i;
+
+   for (i = 0; i < netplay->state_pages; i++)
+   {
+      uint32_t id = (i < count) ? pages[i] : NETPLAY_PAGE_ZERO;
+      if (netplay->work_pages[i] == id)
+         continue;
+      memcpy(netplay->state_work + i * NETPLAY_PAGE_SIZE,
+            netplay_pages_get(netplay->pages, id), NETPLAY_PAGE_SIZE);
+      netplay_work_page_set(netplay, i, id);
+   }
+}
+
+/**
+ * netplay_delta_frame_load
+ *
+ * Bring this frame's state into the working buffer, copying only the
+ * pages that differ from what it holds already.
+ *
+ * Returns: the working buffer.
+ */
+const uint8_t *netplay_delta_frame_load(netplay_t *netplay,
+      const struct delta_frame *delta)
+{
+   netplay_state_load_pages(netplay, delta->pages, netplay->state_pages);
+   return netplay->state_work;
+}
+
+/**
+ * netplay_delta_frame_share
+ *
+ * Give @dst the same state as @src, by reference.
+ */
+void netplay_delta_frame_share(netplay_t *netplay,
+      struct delta_frame *dst, const struct delta_frame *src)
+{
+   size_t i;
+
+   for (i = 0; i < netplay->state_pages; i++)
+   {
+      netplay_pages_ref(netplay->pages, src->pages[i]);
+      netplay_pages_unref(netplay->pages, dst->pages[i]);
+      dst->pages[i] = src->pages[i];
+   }
+}
+
+/**
+ * netplay_state_pad
+ *
+ * Zero the working buffer past @size, so that a state's last page is
+ * the same bytes on every host and hashes the same.
+ */
+void netplay_state_pad(netplay_t *netplay, size_t size)
+{
+   size_t end = netplay->state_pages * NETPLAY_PAGE_SIZE;
+   if (size < end)
+      memset(netplay->state_work + size, 0, end - size);
+}
+
+/**
+ * netplay_delta_frame_put
+ *
+ * Store @size bytes of serialized state as this frame's state.
+ */
+bool netplay_delta_frame_put(netplay_t *netplay,
+      struct delta_frame *delta, const void *data, size_t size)
+{
+   if (size > netplay->state_size)
+      return false;
+   if (data != netplay->state_work)
+      memcpy(netplay->state_work, data, size);
+   netplay_state_pad(netplay, size);
+   return netplay_delta_frame_store(netplay, delta);
+}
+
+/**
+ * netplay_grow_states
+ *
+ * Grow the working buffer and every frame's state to @state_size;
+ * the new tail is zeros.
+ */
+bool netplay_grow_states(netplay_t *netplay, size_t state_size)
+{
+   size_t i, j;
+   size_t state_pages = (state_size + NETPLAY_PAGE_SIZE - 1)
+      / NETPLAY_PAGE_SIZE;
+
+   if (state_pages > netplay->state_pages)
+   {
+      uint8_t *work;
+      uint32_t *table;
+
+      /* realloc-to-tmp throughout: on OOM the old allocation stays
+       * owned, and state_pages still describes every table. */
+      for (i = 0; i < netplay->buffer_size; i++)
+      {
+         if (!(table = (uint32_t*)realloc(netplay->buffer[i].pages,
+               state_pages * sizeof(*table))))
+            return false;
+         for (j = netplay->state_pages; j < state_pages; j++)
+            table[j] = NETPLAY_PAGE_ZERO;
+         netplay->buffer[i].pages = table;
+      }
+      if (!(table = (uint32_t*)realloc(netplay->work_pages,
+            state_pages * sizeof(*table))))
+         return false;
+      for (j = netplay->state_pages; j < state_pages; j++)
+         table[j] = NETPLAY_PAGE_ZERO;
+      netplay->work_pages = table;
+      if (!(table = (uint32_t*)realloc(netplay->state_hashes,
+            state_pages * sizeof(*table))))
+         return false;
+      netplay->state_hashes = table;
+      if (!(work = (uint8_t*)realloc(netplay->state_work,
+            state_pages * NETPLAY_PAGE_SIZE)))
+         return false;
+      memset(work + netplay->state_pages * NETPLAY_PAGE_SIZE, 0,
+            (state_pages - netplay->state_pages) * NETPLAY_PAGE_SIZE);
+      netplay->state_work  = work;
+      netplay->state_pages = state_pages;
+   }
+
+   netplay->state_size = state_size;
+   return true;
+}
+
+/**
+ * netplay_state_digest
+ *
+ * Digest of the state held as @count page ids: netplay_pages_digest()
+ * over their hashes, so that a peer holding the same bytes arrives at
+ * the same value.
+ */
+bool netplay_state_digest(netplay_t *netplay,
+      const uint32_t *pages, size_t count, uint32_t *digest)
+{
+   size_t i;
+
+   if (!count || count > netplay->state_pages)
+      return false;
+   for (i = 0; i < count; i++)
+      netplay->state_hashes[i] = netplay_pages_hash(netplay->pages,
+            pages[i]);
+   *digest = netplay_pages_digest(netplay->state_hashes, count);
+   return true;
+}
+
+/**
+ * netplay_connection_drop_base
+ *
+ * Forget the savestate last exchanged with @connection; the next one
+ * goes whole.
+ */
+void netplay_connection_drop_base(netplay_t *netplay,
+      struct netplay_connection *connection)
+{
+   size_t i;
+
+   if (!connection->base_pages)
+      return;
+   if (netplay->pages)
+      for (i = 0; i < connection->base_count; i++)
+         netplay_pages_unref(netplay->pages, connection->base_pages[i]);
+   free(connection->base_pages);
+   connection->base_pages  = NULL;
+   connection->base_count  = 0;
+   connection->base_size   = 0;
+   connection->base_digest = 0;
+}
+
+/**
+ * netplay_connection_set_base
+ *
+ * Record the @size byte state held as @pages, whose digest is @digest,
+ * as the one last exchanged with @connection.
+ */
+void netplay_connection_set_base(netplay_t *netplay,
+      struct netplay_connection *connection, const uint32_t *pages,
+      uint32_t size, uint32_t digest)
+{
+   size_t i;
+   size_t count = (size + NETPLAY_PAGE_SIZE - 1) / NETPLAY_PAGE_SIZE;
+
+   if (connection->base_count != count)
+   {
+      netplay_connection_drop_base(netplay, connection);
+      /* Zeroed ids are NETPLAY_PAGE_ZERO, which holds no reference. */
+      if (!(connection->base_pages = (uint32_t*)calloc(count,
+            sizeof(*connection->base_pages))))
+         return;
+      connection->base_count = count;
+   }
+
+   for (i = 0; i < count; i++)
+   {
+      netplay_pages_ref(netplay->pages, pages[i]);
+      netplay_pages_unref(netplay->pages, connection->base_pages[i]);
+      connection->base_pages[i] = pages[i];
+   }
+   connection->base_size   = size;
+   connection->base_digest = digest;
+}
+
+/**
+ * netplay_delta_frame_take
+ *
+ * Store the working buffer, holding a whole @state_size byte state
+ * from @connection, as this frame's state, and keep it as the base for
+ * the peer's next delta where its protocol has them.
+ */
+bool netplay_delta_frame_take(netplay_t *netplay,
+      struct netplay_connection *connection, struct delta_frame *delta,
+      uint32_t state_size)
+{
+   uint32_t digest;
+
+   netplay_state_pad(netplay, state_size);
+   if (!netplay_delta_frame_store(netplay, delta))
+      return false;
+
+   REQUIRE_PROTOCOL_VERSION(connection, 8)
+   {
+      if (netplay_state_digest(netplay, delta->pages,
+               (state_size + NETPLAY_PAGE_SIZE - 1) / NETPLAY_PAGE_SIZE,
+               &digest))
+         netplay_connection_set_base(netplay, connection, delta->pages,
+               state_size, digest);
+      else
+         netplay_connection_drop_base(netplay, connection);
+   }
+   return true;
+}
+
+/**
+ * netplay_state_delta_runs
+ *
+ * Write the pages of the @size byte state held as @pages that differ
+ * from the one last exchanged with @connection to @raw, as runs
+ * { first page, page count, pages }; @len receives their size.
+ *
+ * Returns: false if @connection has no such base, or the runs do not
+ * fit in @raw_size bytes - the whole state is then the better send.
+ */
+bool netplay_state_delta_runs(netplay_t *netplay,
+      const struct netplay_connection *connection, const uint32_t *pages,
+      uint32_t size, uint8_t *raw, size_t raw_size, size_t *len)
+{
+   size_t i    = 0;
+   size_t _len = 0;
+
+   if (     !connection->base_pages
+         ||  connection->base_size != size)
+      return false;
+
+   while (i < connection->base_count)
+   {
+      uint32_t run[2];
+      size_t first;
+
+      if (pages[i] == connection->base_pages[i])
+      {
+         i++;
+         continue;
+      }
+      /* Pages are interned, and the base holds its own, so a page
+       * that changed is exactly one whose id did. */
+      for (first = i; i < connection->base_count
+            && pages[i] != connection->base_pages[i]; i++);
+
+      if (_len + sizeof(run) + (i - first) * NETPLAY_PAGE_SIZE > raw_size)
+         return false;
+      run[0] = htonl((uint32_t)first);
+      run[1] = htonl((uint32_t)(i - first));
+      memcpy(raw + _len, run, sizeof(run));
+      _len  += sizeof(run);
+      for (; first < i; first++, _len += NETPLAY_PAGE_SIZE)
+         memcpy(raw + _len, netplay_pages_get(netplay->pages, pages[first]),
+               NETPLAY_PAGE_SIZE);
+   }
+
+   *len = _len;
+   return true;
+}
+
+/**
+ * netplay_runs_compress
+ *
+ * Compress @len bytes of runs into @out, which holds @out_size; @wn
+ * receives the compressed size, 0 for no runs at all.
+ */
+bool netplay_runs_compress(struct compression_transcoder *z,
+      const uint8_t *raw, size_t len, uint8_t *out, size_t out_size,
+      uint32_t *wn)
+{
+   uint32_t rd;
+   enum trans_stream_error zerr = TRANS_STREAM_ERROR_NONE;
+
+   *wn = 0;
+   if (!len)
+      return true;
+   z->compression_backend->set_in(z->compression_stream,
+      raw, (uint32_t)len);
+   z->compression_backend->set_out(z->compression_stream,
+      out, (uint32_t)out_size);
+   return z->compression_backend->trans(z->compression_stream, true,
+            &rd, wn, &zerr)
+      && zerr == TRANS_STREAM_ERROR_NONE;
+}
+
+/**
+ * netplay_recv_runs
+ *
+ * Decompress @zsize bytes of runs from the zbuffer, expecting exactly
+ * @raw_size.
+ *
+ * Returns: a buffer to free(), or NULL.
+ */
+static uint8_t *netplay_recv_runs(netplay_t *netplay,
+      struct compression_transcoder *ctrans, uint32_t raw_size,
+      uint32_t zsize)
+{
+   uint32_t rd, wn;
+   enum trans_stream_error zerr = TRANS_STREAM_ERROR_NONE;
+   uint8_t *raw                 = (uint8_t*)malloc(raw_size);
+
+   if (!raw)
+      return NULL;
+   ctrans->decompression_backend->set_in(
+      ctrans->decompression_stream, netplay->zbuffer, zsize);
+   ctrans->decompression_backend->set_out(
+      ctrans->decompression_stream, raw, raw_size);
+   if (!ctrans->decompression_backend->trans(
+            ctrans->decompression_stream, true, &rd, &wn, &zerr)
+         || zerr != TRANS_STREAM_ERROR_NONE
+         || wn   != raw_size)
+   {
+      free(raw);
+      return NULL;
+   }
+   return raw;
+}
+
+/**
+ * netplay_delta_frame_apply
+ *
+ * Load into this frame the state the server describes as @raw_size
+ * bytes of runs { first page, page count, pages } - compressed in the
+ * zbuffer - over the one last loaded from @connection.
+ *
+ * Returns: false if this client has no such base, or the result is not
+ * the state the server holds; the frame is left as it was, short of
+ * running out of memory storing it.
+ */
+bool netplay_delta_frame_apply(netplay_t *netplay,
+      struct netplay_connection *connection,
+      struct compression_transcoder *ctrans, struct delta_frame *delta,
+      uint32_t state_size, uint32_t base_digest, uint32_t digest,
+      uint32_t raw_size, uint32_t zsize)
+{
+   size_t i, count;
+   size_t pos       = 0;
+   uint8_t *raw     = NULL;
+   uint32_t *hashes = netplay->state_hashes;
+   bool ret         = false;
+
+   if (     !connection->base_pages
+         ||  connection->base_size   != state_size
+         ||  connection->base_digest != base_digest)
+      return false;
+   count = connection->base_count;
+   if (     count > netplay->state_pages
+         || raw_size > count * (NETPLAY_PAGE_SIZE + 2 * sizeof(uint32_t)))
+      return false;
+   if (raw_size && !(raw = netplay_recv_runs(netplay, ctrans, raw_size,
+            zsize)))
+      return false;
+
+   /* Writing a page drops its id from the mirror, so a failure part
+    * way leaves the working buffer described truthfully. */
+   netplay_state_load_pages(netplay, connection->base_pages, count);
+   for (i = 0; i < count; i++)
+      hashes[i] = netplay_pages_hash(netplay->pages,
+            connection->base_pages[i]);
+
+   while (pos < raw_size)
+   {
+      uint32_t run[2];
+      size_t first, pages;
+
+      if (raw_size - pos < sizeof(run))
+         goto end;
+      memcpy(run, raw + pos, sizeof(run));
+      pos  += sizeof(run);
+      first = ntohl(run[0]);
+      pages = ntohl(run[1]);
+      if (     first > count
+            || pages > count - first
+            || pages > (raw_size - pos) / NETPLAY_PAGE_SIZE)
+         goto end;
+
+      for (i = first; i < first + pages; i++, pos += NETPLAY_PAGE_SIZE)
+      {
+         uint8_t *page = netplay->state_work + i * NETPLAY_PAGE_SIZE;
+         memcpy(page, raw + pos, NETPLAY_PAGE_SIZE);
+         netplay_work_page_set(netplay, i, NETPLAY_PAGE_NONE);
+         hashes[i] = netplay_pages_hash_data(page, NETPLAY_PAGE_SIZE);
+      }
+   }
+
+   if (netplay_pages_digest(hashes, count) != digest)
+      goto end;
+   if ((ret = netplay_delta_frame_store(netplay, delta)))
+      netplay_connection_set_base(netplay, connection, delta->pages,
+            state_size, digest);
+
+end:
+   free(raw);
+   return ret;
+}
+
+/**
+ * netplay_delta_frame_block_hashes
+ *
+ * Fill state_hashes with this frame's block hashes - one per page, as
+ * far as the end of the core's own memory, which @end receives.  The
+ * blocks after it are left out: server and client do not fill them
+ * alike.  A whole page reuses the hash the page store already has for
+ * it, so only a final partial block is hashed afresh.
+ *
+ * Returns: the number of blocks.
+ */
+size_t netplay_delta_frame_block_hashes(netplay_t *netplay,
+      const struct delta_frame *delta, size_t *end)
+{
+   size_t i, count;
+   /* The container puts the memory block first, inside page 0. */
+   const uint8_t *head = netplay_pages_get(netplay->pages, delta->pages[0]);
+   size_t _len         = netplay->coremem_size;
+
+   if (     !memcmp(head, "NETPLAY", 7)
+         && !memcmp(head + 8, NETPLAYSTATE_MEM_BLOCK, 4))
+      _len += 16;
+   if (_len > netplay->state_pages * NETPLAY_PAGE_SIZE)
+      _len  = netplay->state_pages * NETPLAY_PAGE_SIZE;
+
+   count = (_len + NETPLAY_PAGE_SIZE - 1) / NETPLAY_PAGE_SIZE;
+   for (i = 0; i < count; i++)
+   {
+      size_t n = _len - i * NETPLAY_PAGE_SIZE;
+      if (n >= NETPLAY_PAGE_SIZE)
+         netplay->state_hashes[i] = netplay_pages_hash(netplay->pages,
+               delta->pages[i]);
+      else
+         netplay->state_hashes[i] = netplay_pages_hash_data(
+               netplay_pages_get(netplay->pages, delta->pages[i]), n);
+   }
+
+   *end = _len;
+   return count;
+}
+
+/**
+ * netplay_blocks_root
+ *
+ * Fold the first @count of state_hashes into the root a CRC command
+ * carries from protocol 8 on.  Never 0, which means "no hash".
+ */
+uint32_t netplay_blocks_root(netplay_t *netplay, size_t count)
+{
+   uint32_t root = netplay_pages_digest(netplay->state_hashes, count);
+   return root ? root : 1;
+}
+
+/**
+ * netplay_delta_frame_repair_runs
+ *
+ * The blocks of @delta's state that @theirs - a peer's @count block
+ * hashes for it, in network order - say it has wrong, as runs
+ * { first block, block count, blocks }.  Leaves this frame's block
+ * hashes in state_hashes.
+ *
+ * Returns: a buffer to free(), of which @len bytes are the runs; NULL
+ * if the whole state is the better fix - the blocks do not line up, or
+ * are over half of it.
+ */
+uint8_t *netplay_delta_frame_repair_runs(netplay_t *netplay,
+      const struct delta_frame *delta, const uint32_t *theirs,
+      size_t count, size_t *len)
+{
+   size_t end      = 0;
+   size_t i        = 0;
+   size_t _len     = 0;
+   size_t raw_size;
+   uint8_t *raw;
+
+   if (     !count
+         || netplay_delta_frame_block_hashes(netplay, delta, &end) != count)
+      return NULL;
+   raw_size = end / 2;
+   if (!(raw = (uint8_t*)malloc(raw_size)))
+      return NULL;
+
+   while (i < count)
+   {
+      uint32_t run[2];
+      size_t first;
+
+      if (netplay->state_hashes[i] == ntohl(theirs[i]))
+      {
+         i++;
+         continue;
+      }
+      for (first = i; i < count
+            && netplay->state_hashes[i] != ntohl(theirs[i]); i++);
+
+      if (_len + sizeof(run) > raw_size)
+         goto fail;
+      run[0] = htonl((uint32_t)first);
+      run[1] = htonl((uint32_t)(i - first));
+      memcpy(raw + _len, run, sizeof(run));
+      _len  += sizeof(run);
+      for (; first < i; first++)
+      {
+         size_t n = end - first * NETPLAY_PAGE_SIZE;
+         if (n > NETPLAY_PAGE_SIZE)
+            n = NETPLAY_PAGE_SIZE;
+         if (_len + n > raw_size)
+            goto fail;
+         memcpy(raw + _len, netplay_pages_get(netplay->pages,
+                  delta->pages[first]), n);
+         _len += n;
+      }
+   }
+
+   *len = _len;
+   return raw;
+
+fail:
+   free(raw);
+   return NULL;
+}
+
+/**
+ * netplay_delta_frame_repair
+ *
+ * Patch this frame's state with the server's blocks - @raw_size bytes
+ * of runs { first block, block count, blocks }, compressed in the
+ * zbuffer - and keep the result if its root is @root.
+ *
+ * Returns: false if the result is not the server's state; the frame is
+ * left as it was.
+ */
+bool netplay_delta_frame_repair(netplay_t *netplay,
+      struct compression_transcoder *ctrans, struct delta_frame *delta,
+      uint32_t root, uint32_t raw_size, uint32_t zsize)
+{
+   size_t i, count, end;
+   size_t pos   = 0;
+   uint8_t *raw = NULL;
+   bool ret     = false;
+
+   if (!netplay->state_size)
+      return false;
+   count = netplay_delta_frame_block_hashes(netplay, delta, &end);
+   if (raw_size > end + count * 2 * sizeof(uint32_t))
+      return false;
+   if (raw_size && !(raw = netplay_recv_runs(netplay, ctrans, raw_size,
+            zsize)))
+      return false;
+
+   netplay_delta_frame_load(netplay, delta);
+
+   while (pos < raw_size)
+   {
+      uint32_t run[2];
+      size_t first, blocks;
+
+      if (raw_size - pos < sizeof(run))
+         goto end;
+      memcpy(run, raw + pos, sizeof(run));
+      pos   += sizeof(run);
+      first  = ntohl(run[0]);
+      blocks = ntohl(run[1]);
+      if (first > count || blocks > count - first)
+         goto end;
+
+      for (i = first; i < first + blocks; i++)
+      {
+         uint8_t *page = netplay->state_work + i * NETPLAY_PAGE_SIZE;
+         size_t n      = end - i * NETPLAY_PAGE_SIZE;
+         if (n > NETPLAY_PAGE_SIZE)
+            n = NETPLAY_PAGE_SIZE;
+         if (raw_size - pos < n)
+            goto end;
+         memcpy(page, raw + pos, n);
+         pos += n;
+         netplay_work_page_set(netplay, i, NETPLAY_PAGE_NONE);
+         netplay->state_hashes[i] = netplay_pages_hash_data(page, n);
+      }
+   }
+
+   if (netplay_blocks_root(netplay, count) == root)
+      ret = netplay_delta_frame_store(netplay, delta);
+
+end:
+   free(raw);
+   return ret;
+}
+
@@ -125,13 +125,6 @@
    if ((connection)->ping < 0 || ping < (connection)->ping) \
       (connection)->ping = ping;
 
-#define REQUIRE_PROTOCOL_VERSION(connection, version) \
-   if ((connection)->netplay_protocol >= (version))
-
-#define REQUIRE_PROTOCOL_RANGE(connection, vmin, vmax) \
-   if ((connection)->netplay_protocol >= (vmin) && \
-         (connection)->netplay_protocol <= (vmax))
-
 #define NETPLAY_MAGIC 0x52414E50 /* RANP */
 #define FULL_MAGIC    0x46554C4C /* FULL */
 #define POKE_MAGIC    0x504F4B45 /* POKE */
@@ -229,12 +222,6 @@ net_driver_state_t *networking_state_get_ptr(void)
 static bool netplay_build_savestate(netplay_t* netplay, retro_ctx_serialize_info_t* serial_info, bool force_capture_achievements);
 static bool netplay_process_savestate(netplay_t* netplay, retro_ctx_serialize_info_t* serial_info);
 
-/* Align to 8-byte boundary */
-#define CONTENT_ALIGN_SIZE(size) ((((size) + 7) & ~7))
-#define NETPLAYSTATE_VERSION 1
-#define NETPLAYSTATE_MEM_BLOCK "MEM "
-#define NETPLAYSTATE_CHEEVOS_BLOCK "ACHV"
-#define NETPLAYSTATE_END_BLOCK "END "
 
 #ifdef HAVE_NETWORKING
 /* The content fingerprint netplay advertises, compares and searches by.
@@ -1095,6 +1082,26 @@ static uint32_t select_protocol(uint32_t lo_protocol, uint32_t hi_protocol)
    return hi_protocol;
 }
 
+/**
+ * netplay_transcoder
+ *
+ * The transcoder for a compression chosen by select_compression().
+ */
+static struct compression_transcoder *netplay_transcoder(netplay_t *netplay,
+      uint32_t compression)
+{
+   switch (compression)
+   {
+      case NETPLAY_COMPRESSION_ZSTD:
+         return &netplay->compress_zstd;
+      case NETPLAY_COMPRESSION_ZLIB:
+         return &netplay->compress_zlib;
+      default:
+         break;
+   }
+   return &netplay->compress_nil;
+}
+
 static int select_compression(netplay_t *netplay, uint32_t compression)
 {
    struct compression_transcoder *ctrans = NULL;
@@ -1102,6 +1109,17 @@ static int select_compression(netplay_t *netplay, uint32_t compression)
 
    compression &= NETPLAY_COMPRESSION_SUPPORTED;
 
+#if defined(HAVE_RZSTD) || defined(HAVE_ZSTD)
+   if (compression & NETPLAY_COMPRESSION_ZSTD)
+   {
+      ctrans = &netplay->compress_zstd;
+      if (!ctrans->compression_backend)
+         ctrans->compression_backend =
+            trans_stream_get_zstd_compress_backend();
+      ret = NETPLAY_COMPRESSION_ZSTD;
+   }
+   else
+#endif
    if (compression & NETPLAY_COMPRESSION_ZLIB)
    {
       ctrans = &netplay->compress_zlib;
@@ -1610,6 +1628,30 @@ static bool netplay_handshake_sync(netplay_t *netplay,
          return false;
    }
 
+   /* Offer the UDP input channel. */
+   REQUIRE_PROTOCOL_VERSION(connection, 8)
+   {
+      if (     netplay->udp_fd >= 0
+            && netplay->modus == NETPLAY_MODUS_INPUT_FRAME_SYNC)
+      {
+         /* token, port */
+         uint32_t offer[2];
+         struct sockaddr_storage addr;
+         socklen_t addrlen = sizeof(addr);
+
+         if (getsockname(netplay->udp_fd, (struct sockaddr*)&addr,
+               &addrlen) >= 0)
+         {
+            connection->udp_token = netplay_udp_token();
+            offer[0] = htonl(connection->udp_token);
+            offer[1] = htonl(netplay_udp_addr_port((struct sockaddr*)&addr));
+            if (!netplay_send_raw_cmd(netplay, connection,
+                  NETPLAY_CMD_UDP_CHANNEL, offer, sizeof(offer)))
+               return false;
+         }
+      }
+   }
+
    if (!netplay_send_flush(&connection->send_packet_buffer,
          connection->fd, false))
       return false;
@@ -2330,6 +2372,148 @@ static const uint8_t* netplay_get_savestate_coremem(netplay_t* netplay, const ui
    return input;
 }
 
+/**
+ * netplay_profile_frame_end
+ *
+ * Close the profile's current frame, which ran from the last call to
+ * @now, and start the next.
+ */
+static void netplay_profile_frame_end(netplay_t *netplay, retro_time_t now)
+{
+   struct netplay_profile *profile = &netplay->profile;
+   struct netplay_profile_frame *cur = &profile->cur;
+
+   if (profile->frame_start)
+   {
+      if (cur->stalled)
+      {
+         cur->stall = now - profile->frame_start;
+         profile->stalled++;
+      }
+      if (cur->replayed)
+      {
+         profile->rollbacks++;
+         if (cur->replayed > profile->max_replayed)
+            profile->max_replayed = cur->replayed;
+      }
+      profile->total.serialize   += cur->serialize;
+      profile->total.unserialize += cur->unserialize;
+      profile->total.replay      += cur->replay;
+      profile->total.net         += cur->net;
+      profile->total.stall       += cur->stall;
+      profile->total.replayed    += cur->replayed;
+      profile->frames++;
+
+      profile->window[profile->window_ptr] = *cur;
+      if (++profile->window_ptr >= NETPLAY_PROFILE_WINDOW)
+         profile->window_ptr = 0;
+   }
+
+   memset(cur, 0, sizeof(*cur));
+   profile->frame_start = now;
+}
+
+/**
+ * netplay_profile_get
+ *
+ * Fill @stats from the last NETPLAY_PROFILE_WINDOW frames.
+ */
+static void netplay_profile_get(netplay_t *netplay,
+      netplay_rollback_stats_t *stats)
+{
+   size_t i;
+   struct netplay_profile_frame sum = {0};
+   uint32_t frames                  = netplay->profile.frames;
+
+   if (frames > NETPLAY_PROFILE_WINDOW)
+      frames = NETPLAY_PROFILE_WINDOW;
+
+   memset(stats, 0, sizeof(*stats));
+   stats->frames = frames;
+   if (!frames)
+      return;
+
+   for (i = 0; i < frames; i++)
+   {
+      const struct netplay_profile_frame *frame = &netplay->profile.window[i];
+      sum.serialize   += frame->serialize;
+      sum.unserialize += frame->unserialize;
+      sum.replay      += frame->replay;
+      sum.net         += frame->net;
+      sum.stall       += frame->stall;
+      stats->replayed += frame->replayed;
+      if (frame->replayed)
+      {
+         stats->rollbacks++;
+         if (frame->replayed > stats->max_replayed)
+            stats->max_replayed = frame->replayed;
+      }
+      if (frame->stalled)
+         stats->stalled++;
+   }
+
+   stats->serialize_usec   = (uint32_t)(sum.serialize   / frames);
+   stats->unserialize_usec = (uint32_t)(sum.unserialize / frames);
+   stats->replay_usec      = (uint32_t)(sum.replay      / frames);
+   stats->net_usec         = (uint32_t)(sum.net         / frames);
+   stats->stall_usec       = (uint32_t)(sum.stall       / frames);
+}
+
+/**
+ * netplay_profile_log
+ *
+ * Log the session's rollback profile, one line, as key=value pairs
+ * so tools/ranetplayer/ranetbench.py can read it back.
+ */
+static void netplay_profile_log(netplay_t *netplay)
+{
+   const struct netplay_profile *profile = &netplay->profile;
+   const struct netplay_profile_frame *total = &profile->total;
+   uint32_t frames = profile->frames;
+
+   if (!frames)
+      return;
+
+   RARCH_LOG("[Netplay] Rollback profile: frames=%u rollbacks=%u"
+         " replayed=%u max_replayed=%u stalled=%u serialize_us=%u"
+         " unserialize_us=%u replay_us=%u net_us=%u stall_us=%u\n",
+         frames, profile->rollbacks, total->replayed,
+         profile->max_replayed, profile->stalled,
+         (unsigned)(total->serialize   / frames),
+         (unsigned)(total->unserialize / frames),
+         (unsigned)(total->replay      / frames),
+         (unsigned)(total->net         / frames),
+         (unsigned)(total->stall       / frames));
+}
+
+/**
+ * netplay_delta_frame_capture
+ *
+ * Serialize the core into the working buffer and store it as this
+ * frame's state.  @serial_info receives the serialized state, which
+ * stays valid until the next capture or load.
+ */
+static bool netplay_delta_frame_capture(netplay_t *netplay,
+      struct delta_frame *delta, retro_ctx_serialize_info_t *serial_info,
+      bool force_capture_achievements)
+{
+   bool ret;
+   retro_time_t start = cpu_features_get_time_usec();
+
+   serial_info->data = netplay->state_work;
+   if (!netplay_build_savestate(netplay, serial_info,
+            force_capture_achievements))
+   {
+      netplay_state_invalidate(netplay);
+      return false;
+   }
+   netplay_state_pad(netplay, serial_info->size);
+   ret = netplay_delta_frame_store(netplay, delta);
+
+   netplay->profile.cur.serialize += cpu_features_get_time_usec() - start;
+   return ret;
+}
+
 /**
  * netplay_delta_frame_crc
  *
@@ -2342,11 +2526,31 @@ static uint32_t netplay_delta_frame_crc(netplay_t *netplay,
 
    NETPLAY_ASSERT_MODUS(NETPLAY_MODUS_INPUT_FRAME_SYNC);
    input = netplay_get_savestate_coremem(netplay,
-      (const uint8_t*)delta->state);
+      netplay_delta_frame_load(netplay, delta));
 
    return encoding_crc32(0L, input, netplay->coremem_size);
 }
 
+/**
+ * netplay_delta_frame_hash
+ *
+ * The hash of this frame's state to check against @connection: the
+ * root of its block hashes from protocol 8, the CRC of the core's
+ * memory before that.
+ */
+static uint32_t netplay_delta_frame_hash(netplay_t *netplay,
+      struct delta_frame *delta, const struct netplay_connection *connection)
+{
+   size_t end;
+
+   if (!netplay->state_size)
+      return 0;
+   REQUIRE_PROTOCOL_VERSION(connection, 8)
+      return netplay_blocks_root(netplay,
+            netplay_delta_frame_block_hashes(netplay, delta, &end));
+   return netplay_delta_frame_crc(netplay, delta);
+}
+
 /*
  * Free an input state list
  */
@@ -2372,10 +2576,11 @@ static void netplay_delta_frame_free(struct delta_frame *delta)
 {
    uint32_t i;
 
-   if (delta->state)
+   /* The pages themselves go with the store. */
+   if (delta->pages)
    {
-      free(delta->state);
-      delta->state = NULL;
+      free(delta->pages);
+      delta->pages = NULL;
    }
 
    for (i = 0; i < MAX_INPUT_DEVICES; i++)
@@ -2880,17 +3085,34 @@ static bool netplay_cmd_crc(netplay_t *netplay, struct delta_frame *delta)
 {
    size_t i;
    uint32_t payload[2];
-   bool success = true;
+   /* Each kind of hash is computed once, the first time a peer
+    * needs it. */
+   uint32_t hashes[2] = {0};
+   bool have[2]       = {false, false};
+   bool success       = true;
    NETPLAY_ASSERT_MODUS(NETPLAY_MODUS_INPUT_FRAME_SYNC);
 
    payload[0]   = htonl(delta->frame);
-   payload[1]   = htonl(delta->crc);
 
    for (i = 0; i < netplay->connections_size; i++)
    {
-      if (     (netplay->connections[i].flags & NETPLAY_CONN_FLAG_ACTIVE)
-            && (netplay->connections[i].mode >= NETPLAY_CONNECTION_CONNECTED))
-         success = netplay_send_raw_cmd(netplay, &netplay->connections[i],
+      struct netplay_connection *connection = &netplay->connections[i];
+      int kind                              = 0;
+
+      if (     !(connection->flags & NETPLAY_CONN_FLAG_ACTIVE)
+            ||  (connection->mode < NETPLAY_CONNECTION_CONNECTED))
+         continue;
+
+      REQUIRE_PROTOCOL_VERSION(connection, 8)
+         kind = 1;
+
+      if (!have[kind])
+      {
+         hashes[kind] = netplay_delta_frame_hash(netplay, delta, connection);
+         have[kind]   = true;
+      }
+      payload[1] = htonl(hashes[kind]);
+      success    = netplay_send_raw_cmd(netplay, connection,
             NETPLAY_CMD_CRC, payload, sizeof(payload)) && success;
    }
    return success;
@@ -2915,6 +3137,60 @@ static bool netplay_cmd_request_savestate(netplay_t *netplay)
       NETPLAY_CMD_REQUEST_SAVESTATE, NULL, 0);
 }
 
+/**
+ * netplay_cmd_block_hashes
+ *
+ * Tell the server the block hashes of our state for a frame whose
+ * hash did not match its own, so it can send the blocks that differ.
+ */
+static bool netplay_cmd_block_hashes(netplay_t *netplay,
+      struct delta_frame *delta)
+{
+   size_t i, count, end;
+   uint32_t header[4];
+   struct netplay_connection *connection = &netplay->connections[0];
+
+   if (     (netplay->connections_size == 0)
+       || (!(connection->flags & NETPLAY_CONN_FLAG_ACTIVE))
+       ||   (connection->mode  < NETPLAY_CONNECTION_CONNECTED)
+       ||   (netplay->modus == NETPLAY_MODUS_CORE_PACKET_INTERFACE)
+       ||   (!netplay->state_size))
+      return false;
+   if (netplay->savestate_request_outstanding)
+      return true;
+
+   count = netplay_delta_frame_block_hashes(netplay, delta, &end);
+   for (i = 0; i < count; i++)
+      netplay->state_hashes[i] = htonl(netplay->state_hashes[i]);
+
+   header[0] = htonl(NETPLAY_CMD_BLOCK_HASHES);
+   header[1] = htonl((uint32_t)((count + 2) * sizeof(uint32_t)));
+   header[2] = htonl(delta->frame);
+   header[3] = htonl((uint32_t)count);
+
+   netplay->savestate_request_outstanding = true;
+   return netplay_send(&connection->send_packet_buffer, connection->fd,
+            header, sizeof(header))
+      &&  netplay_send(&connection->send_packet_buffer, connection->fd,
+            netplay->state_hashes, count * sizeof(uint32_t));
+}
+
+/**
+ * netplay_frame_hash_mismatch
+ *
+ * Our state for this frame is not the server's.  From protocol 8, say
+ * which blocks we hold, for the server to send the ones that differ;
+ * before that, ask for the whole state.
+ */
+static void netplay_frame_hash_mismatch(netplay_t *netplay,
+      struct delta_frame *delta)
+{
+   REQUIRE_PROTOCOL_VERSION(&netplay->connections[0], 8)
+      netplay_cmd_block_hashes(netplay, delta);
+   else
+      netplay_cmd_request_savestate(netplay);
+}
+
 /**
  * netplay_cmd_stall
  *
@@ -3410,19 +3686,15 @@ static void netplay_handle_frame_hash(netplay_t *netplay,
    if (netplay->is_server)
    {
       if (netplay->check_frames && (delta->frame % netplay->check_frames) == 0)
-      {
-         delta->crc = netplay->state_size ?
-            netplay_delta_frame_crc(netplay, delta) : 0;
          netplay_cmd_crc(netplay, delta);
-      }
    }
    else
    {
       if (netplay->crcs_valid && delta->crc)
       {
          /* We have a remote CRC, so check it. */
-         uint32_t local_crc = netplay->state_size ?
-            netplay_delta_frame_crc(netplay, delta) : 0;
+         uint32_t local_crc = netplay_delta_frame_hash(netplay, delta,
+               &netplay->connections[0]);
 
          if (local_crc != delta->crc)
          {
@@ -3435,7 +3707,7 @@ static void netplay_handle_frame_hash(netplay_t *netplay,
             }
 
             if (netplay->check_frames)
-               netplay_cmd_request_savestate(netplay);
+               netplay_frame_hash_mismatch(netplay, delta);
             else
                RARCH_WARN("[Netplay] Netplay CRCs mismatch!\n");
          }
@@ -3894,9 +4166,9 @@ static bool netplay_sync_pre_frame(netplay_t *netplay)
       if (!(netplay->quirks & NETPLAY_QUIRK_INITIALIZATION))
       {
          retro_ctx_serialize_info_t serial_info = {0};
-         serial_info.data = netplay->buffer[netplay->run_ptr].state;
 
-         if (netplay_build_savestate(netplay, &serial_info, false))
+         if (netplay_delta_frame_capture(netplay,
+               &netplay->buffer[netplay->run_ptr], &serial_info, false))
          {
             if (netplay->force_send_savestate && !netplay->stall &&
                   !netplay->remote_paused)
@@ -3905,9 +4177,9 @@ static bool netplay_sync_pre_frame(netplay_t *netplay)
                 * parity so we don't send old info. */
                if (netplay->run_ptr != netplay->self_ptr)
                {
-                  memcpy(netplay->buffer[netplay->self_ptr].state,
-                     netplay->buffer[netplay->run_ptr].state,
-                     netplay->state_size);
+                  netplay_delta_frame_share(netplay,
+                     &netplay->buffer[netplay->self_ptr],
+                     &netplay->buffer[netplay->run_ptr]);
                   netplay->run_ptr         = netplay->self_ptr;
                   netplay->run_frame_count = netplay->self_frame_count;
                }
@@ -4098,6 +4370,9 @@ static void netplay_sync_input_post_frame(netplay_t *netplay, bool stalled)
        netplay->replay_frame_count < netplay->run_frame_count)
    {
       retro_ctx_serialize_info_t serial_info;
+      struct netplay_profile_frame *cur = &netplay->profile.cur;
+      retro_time_t replay_start         = cpu_features_get_time_usec();
+      retro_time_t saved                = cur->serialize + cur->unserialize;
 
       /* Replay frames. */
       netplay->is_replay = true;
@@ -4125,7 +4400,8 @@ static void netplay_sync_input_post_frame(netplay_t *netplay, bool stalled)
          netplay_wait_and_init_serialization(netplay);
 
       serial_info.data       = NULL;
-      serial_info.data_const = netplay->buffer[netplay->replay_ptr].state;
+      serial_info.data_const = netplay_delta_frame_load(netplay,
+            &netplay->buffer[netplay->replay_ptr]);
       serial_info.size       = netplay->state_size;
       if (!netplay_process_savestate(netplay, &serial_info))
          RARCH_ERR("[Netplay] Netplay savestate loading failed: Prepare for desync!\n");
@@ -4136,14 +4412,12 @@ static void netplay_sync_input_post_frame(netplay_t *netplay, bool stalled)
          struct delta_frame *ptr = &netplay->buffer[netplay->replay_ptr];
 
          serial_info.data_const  = NULL;
-         serial_info.data        = ptr->state;
-         serial_info.size        = netplay->state_size;
 
          start                   = cpu_features_get_time_usec();
 
          /* Remember the current state */
-         memset(serial_info.data, 0, serial_info.size);
-         netplay_build_savestate(netplay, &serial_info, true);
+         memset(netplay->state_work, 0, netplay->state_size);
+         netplay_delta_frame_capture(netplay, ptr, &serial_info, true);
 
          if (netplay->replay_frame_count < netplay->unread_frame_count)
             netplay_handle_frame_hash(netplay, ptr);
@@ -4160,6 +4434,7 @@ static void netplay_sync_input_post_frame(netplay_t *netplay, bool stalled)
 #endif
          netplay->replay_ptr = NEXT_PTR(netplay->replay_ptr);
          netplay->replay_frame_count++;
+         cur->replayed++;
 
 #ifdef DEBUG_NONDETERMINISTIC_CORES
          if (ptr->have_remote && netplay_delta_frame_ready(netplay, &netplay->buffer[netplay->replay_ptr], netplay->replay_frame_count))
@@ -4171,9 +4446,11 @@ static void netplay_sync_input_post_frame(netplay_t *netplay, bool stalled)
                RARCH_LOG("INP  %X %X\n", ptr->self_state[0], ptr->real_input_state[0]);
 
             ptr              = &netplay->buffer[netplay->replay_ptr];
-            serial_info.data = ptr->state;
-            memset(serial_info.data, 0, serial_info.size);
+            serial_info.data = netplay->state_work;
+            serial_info.size = netplay->coremem_size;
+            memset(serial_info.data, 0, netplay->state_size);
             core_serialize_special(&serial_info);
+            netplay_delta_frame_store(netplay, ptr);
 
             RARCH_LOG("POST %u: %X\n", netplay->replay_frame_count-1, netplay->state_size ? netplay_delta_frame_crc(netplay, ptr) : 0);
          }
@@ -4204,6 +4481,9 @@ static void netplay_sync_input_post_frame(netplay_t *netplay, bool stalled)
       }
       netplay->is_replay            = false;
       netplay->force_rewind         = false;
+
+      cur->replay += cpu_features_get_time_usec() - replay_start
+         - (cur->serialize + cur->unserialize - saved);
    }
 
    if (netplay->is_server)
@@ -4428,12 +4708,20 @@ static void netplay_hangup(netplay_t *netplay,
          MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
 
    socket_close(connection->fd);
-   connection->flags &= ~NETPLAY_CONN_FLAG_ACTIVE;
+   connection->flags &= ~(NETPLAY_CONN_FLAG_ACTIVE | NETPLAY_CONN_FLAG_UDP);
+   connection->udp_token = 0;
    netplay_deinit_socket_buffer(&connection->send_packet_buffer);
    netplay_deinit_socket_buffer(&connection->recv_packet_buffer);
+   netplay_connection_drop_base(netplay, connection);
 
    if (!netplay->is_server)
    {
+      if (netplay->udp_fd >= 0)
+      {
+         socket_close(netplay->udp_fd);
+         netplay->udp_fd = -1;
+      }
+
       netplay->self_mode = NETPLAY_CONNECTION_NONE;
       netplay->connected_players &= (1L<<netplay->self_client_num);
       for (i = 0; i < MAX_CLIENTS; i++)
@@ -4609,133 +4897,505 @@ static bool send_input_frame(netplay_t *netplay, struct delta_frame *dframe,
 }
 
 /**
- * netplay_send_cur_input
+ * netplay_udp_gather
  *
- * Send the current input frame to a given connection.
+ * Gather @client_num's input for the last few frames up to @last into
+ * @data, @words words a frame, oldest first; as many as it has in a
+ * row, to at most @max.
  *
- * Returns true if successful, false otherwise.
+ * Returns: how many frames; @first receives the first of them.
  */
-bool netplay_send_cur_input(netplay_t *netplay,
-   struct netplay_connection *connection)
+static uint32_t netplay_udp_gather(netplay_t *netplay, uint32_t client_num,
+      uint32_t last, uint32_t words, uint32_t max, uint32_t *data,
+      uint32_t *first)
 {
-   struct delta_frame *dframe = &netplay->buffer[netplay->self_ptr];
-   NETPLAY_ASSERT_MODUS(NETPLAY_MODUS_INPUT_FRAME_SYNC);
+   size_t ptrs[NETPLAY_UDP_REDUNDANCY];
+   uint32_t i, count = 0;
+   uint32_t devices  = netplay->client_devices[client_num];
+   size_t ptr        = netplay->self_ptr;
+   uint32_t frame    = netplay->self_frame_count;
 
-   if (netplay->is_server)
+   if (last > frame || frame - last >= netplay->buffer_size)
+      return 0;
+   for (; frame > last; frame--)
+      ptr = PREV_PTR(ptr);
+
+   /* Newest first, stopping at the first frame we do not hold whole */
+   for (;;)
    {
-      uint32_t from_client;
-      uint32_t to_client = (uint32_t)(connection - netplay->connections + 1);
+      struct delta_frame *dframe = &netplay->buffer[ptr];
+      if (     count >= max
+            || !dframe->used
+            ||  dframe->frame != frame
+            || !dframe->have_real[client_num])
+         break;
+      ptrs[count++] = ptr;
+      if (!frame--)
+         break;
+      ptr = PREV_PTR(ptr);
+   }
 
-      /* Send the other players' input data (FIXME: This involves an
-       * unacceptable amount of recalculating) */
-      for (from_client = 1; from_client < MAX_CLIENTS; from_client++)
+   if (count)
+      *first = netplay->buffer[ptrs[count - 1]].frame;
+
+   for (i = 0; i < count; i++)
+   {
+      uint32_t device;
+      uint32_t *out              = data + i * words;
+      struct delta_frame *dframe = &netplay->buffer[ptrs[count - 1 - i]];
+
+      for (device = 0; device < MAX_INPUT_DEVICES; device++)
       {
-         if (from_client == to_client)
+         uint32_t di;
+         netplay_input_state_t istate;
+         if (!(devices & (1<<device)))
             continue;
-
-         if ((netplay->connected_players & (1<<from_client)))
+         for (istate = dframe->real_input[device]; istate;
+               istate = istate->next)
+            if (istate->used && istate->client_num == client_num)
+               break;
+         /* A frame we cannot send whole ends the run; TCP has it. */
+         if (!istate || out + istate->size > data + (i + 1) * words)
          {
-            if (dframe->have_real[from_client])
-            {
-               if (!send_input_frame(netplay, dframe, connection, NULL, from_client, false))
-                  return false;
-            }
+            count = i;
+            break;
          }
+         for (di = 0; di < istate->size; di++)
+            *out++ = htonl(istate->data[di]);
       }
-
-      /* If we're not playing, send a NOINPUT */
-      if (netplay->self_mode != NETPLAY_CONNECTION_PLAYING)
-      {
-         uint32_t payload = htonl(netplay->self_frame_count);
-         if (!netplay_send_raw_cmd(netplay, connection, NETPLAY_CMD_NOINPUT,
-               &payload, sizeof(payload)))
-            return false;
-      }
-   }
-
-   /* Send our own data */
-   if (netplay->self_mode == NETPLAY_CONNECTION_PLAYING
-         || netplay->self_mode == NETPLAY_CONNECTION_SLAVE)
-   {
-      if (!send_input_frame(netplay, dframe, connection, NULL,
-            netplay->self_client_num,
-            netplay->self_mode == NETPLAY_CONNECTION_SLAVE))
-         return false;
    }
 
-   if (!netplay_send_flush(&connection->send_packet_buffer, connection->fd,
-         false))
-      return false;
-   return true;
+   return count;
 }
 
 /**
- * netplay_send_raw_cmd
- *
- * Send a raw Netplay command to the given connection.
+ * netplay_udp_send_client
  *
- * Returns true on success, false on failure.
+ * Send @connection a datagram of @client_num's last few frames of
+ * input, up to and including @last.
  */
-bool netplay_send_raw_cmd(netplay_t *netplay,
-   struct netplay_connection *connection, uint32_t cmd, const void *data,
-   size_t len)
-{
-   uint32_t cmdbuf[2];
+static void netplay_udp_send_client(netplay_t *netplay,
+      struct netplay_connection *connection, uint32_t client_num,
+      uint32_t last)
+{
+   uint32_t buf[NETPLAY_UDP_MAX_WORDS];
+   struct netplay_udp_input in;
+   uint32_t max;
+
+   in.token      = connection->udp_token;
+   in.client_num = client_num;
+   in.words      = netplay_expected_input_size(netplay,
+         netplay->client_devices[client_num]);
+   if (     !in.words
+         ||  in.words > NETPLAY_UDP_MAX_WORDS - NETPLAY_UDP_HEADER_WORDS)
+      return;
+   max = (NETPLAY_UDP_MAX_WORDS - NETPLAY_UDP_HEADER_WORDS) / in.words;
+   if (max > NETPLAY_UDP_REDUNDANCY)
+      max = NETPLAY_UDP_REDUNDANCY;
 
-   cmdbuf[0] = htonl(cmd);
-   cmdbuf[1] = htonl(len);
+   if (!(in.count = netplay_udp_gather(netplay, client_num, last, in.words,
+            max, buf + NETPLAY_UDP_HEADER_WORDS, &in.frame)))
+      return;
 
-   if (!netplay_send(&connection->send_packet_buffer, connection->fd, cmdbuf,
-         sizeof(cmdbuf)))
-      return false;
-   if (len > 0)
-      if (!netplay_send(&connection->send_packet_buffer, connection->fd, data, len))
-         return false;
-   return true;
+   netplay_udp_send(netplay->udp_fd, buf,
+         netplay_udp_input_pack(buf, &in),
+         netplay->is_server ? (struct sockaddr*)&connection->udp_addr : NULL,
+         connection->udp_addr_len);
 }
 
 /**
- * netplay_send_raw_cmd_all
+ * netplay_udp_send_input
  *
- * Send a raw Netplay command to all connections, optionally excluding one
- * (typically the client that the relevant command came from)
+ * The UDP half of netplay_send_cur_input: the same players' input,
+ * each with the frames before it.
  */
-void netplay_send_raw_cmd_all(netplay_t *netplay,
-   struct netplay_connection *except, uint32_t cmd, const void *data,
-   size_t len)
+static void netplay_udp_send_input(netplay_t *netplay,
+      struct netplay_connection *connection)
 {
-   size_t i;
-   for (i = 0; i < netplay->connections_size; i++)
+   uint32_t client_num;
+
+   if (     netplay->udp_fd < 0
+         || !(connection->flags & NETPLAY_CONN_FLAG_UDP))
+      return;
+
+   if (netplay->is_server)
    {
-      struct netplay_connection *connection = &netplay->connections[i];
-      if (connection == except)
-         continue;
-      if (     (connection->flags & NETPLAY_CONN_FLAG_ACTIVE)
-            && (connection->mode >= NETPLAY_CONNECTION_CONNECTED))
+      uint32_t to_client = (uint32_t)(connection - netplay->connections + 1);
+
+      for (client_num = 0; client_num < MAX_CLIENTS; client_num++)
       {
-         if (!netplay_send_raw_cmd(netplay, connection, cmd, data, len))
-            netplay_hangup(netplay, connection);
+         uint32_t last;
+
+         if (client_num == to_client)
+            continue;
+         if (client_num == netplay->self_client_num)
+         {
+            if (netplay->self_mode != NETPLAY_CONNECTION_PLAYING)
+               continue;
+            last = netplay->self_frame_count;
+         }
+         else
+         {
+            /* Slaves' input does not follow the frame count. */
+            if (     !(netplay->connected_players & (1 << client_num))
+                  ||  (netplay->connected_slaves  & (1 << client_num))
+                  || !netplay->read_frame_count[client_num])
+               continue;
+            last = netplay->read_frame_count[client_num] - 1;
+            if (last > netplay->self_frame_count)
+               last = netplay->self_frame_count;
+         }
+         netplay_udp_send_client(netplay, connection, client_num, last);
       }
    }
+   else if (netplay->self_mode == NETPLAY_CONNECTION_PLAYING)
+      netplay_udp_send_client(netplay, connection, netplay->self_client_num,
+            netplay->self_frame_count);
+   /* With nothing to send, still tell the server now and then where
+    * to send to, and keep any NAT mapping on the way open. */
+   else if (!(netplay->self_frame_count % NETPLAY_UDP_KEEPALIVE_FRAMES))
+   {
+      uint32_t buf[NETPLAY_UDP_HEADER_WORDS];
+      struct netplay_udp_input in = {0};
+      in.token = connection->udp_token;
+      netplay_udp_send(netplay->udp_fd, buf,
+            netplay_udp_input_pack(buf, &in), NULL, 0);
+   }
 }
 
 /**
- * netplay_send_flush_all
+ * netplay_udp_input_frames
  *
- * Flush all of our output buffers
+ * Take what a datagram from @connection holds of @client_num's input:
+ * the frames that come next, in order.  Frames already read are
+ * dropped, and a frame past a gap ends it - TCP fills the gap.
  */
-static void netplay_send_flush_all(netplay_t *netplay,
-   struct netplay_connection *except)
+static void netplay_udp_input_frames(netplay_t *netplay,
+      struct netplay_connection *connection, uint32_t client_num,
+      const struct netplay_udp_input *in)
 {
-   size_t i;
-   for (i = 0; i < netplay->connections_size; i++)
+   uint32_t i;
+   uint32_t devices = netplay->client_devices[client_num];
+
+   if (     !in->count
+         ||  in->words != netplay_expected_input_size(netplay, devices))
+      return;
+
+   for (i = 0; i < in->count; i++)
    {
-      struct netplay_connection *connection = &netplay->connections[i];
-      if (connection == except)
+      uint32_t device;
+      const uint32_t *data       = in->data + i * in->words;
+      struct delta_frame *dframe = &netplay->buffer[
+         netplay->read_ptr[client_num]];
+
+      if (in->frame + i < netplay->read_frame_count[client_num])
          continue;
-      if (     (connection->flags & NETPLAY_CONN_FLAG_ACTIVE)
-            && (connection->mode >= NETPLAY_CONNECTION_CONNECTED))
-      {
+      if (     in->frame + i != netplay->read_frame_count[client_num]
+            || !netplay_delta_frame_ready(netplay, dframe,
+                  netplay->read_frame_count[client_num]))
+         break;
+
+      for (device = 0; device < MAX_INPUT_DEVICES; device++)
+      {
+         netplay_input_state_t istate;
+         uint32_t dsize, di;
+         if (!(devices & (1<<device)))
+            continue;
+
+         dsize  = netplay_expected_input_size(netplay, 1 << device);
+         istate = netplay_input_state_for(&dframe->real_input[device],
+               client_num, dsize, false, false);
+         if (!istate)
+            return;
+         for (di = 0; di < dsize; di++)
+            istate->data[di] = ntohl(*data++);
+      }
+      dframe->have_real[client_num] = true;
+
+      netplay->read_ptr[client_num] = NEXT_PTR(netplay->read_ptr[client_num]);
+      netplay->read_frame_count[client_num]++;
+
+      /* Forward it over TCP if it's past data, as its TCP copy will
+       * now be dropped unforwarded.  The client leaves server_ptr
+       * alone: that follows the TCP stream, which commands in it are
+       * ordered against. */
+      if (netplay->is_server && dframe->frame <= netplay->self_frame_count)
+         send_input_frame(netplay, dframe, NULL, connection, client_num,
+               false);
+   }
+}
+
+/**
+ * netplay_udp_poll
+ *
+ * Take in every datagram waiting on the UDP input channel.
+ */
+static void netplay_udp_poll(netplay_t *netplay)
+{
+   uint32_t buf[NETPLAY_UDP_MAX_WORDS];
+
+   for (;;)
+   {
+      size_t i;
+      struct sockaddr_storage from;
+      socklen_t fromlen                     = 0;
+      struct netplay_udp_input in;
+      struct netplay_connection *connection = NULL;
+      ssize_t _len                          = netplay_udp_recv(
+            netplay->udp_fd, buf, sizeof(buf),
+            netplay->is_server ? &from : NULL, &fromlen);
+
+      if (_len < 0)
+         break;
+      if (!netplay_udp_input_parse(buf, (size_t)_len, &in) || !in.token)
+         continue;
+
+      for (i = 0; i < netplay->connections_size; i++)
+      {
+         if (     (netplay->connections[i].flags & NETPLAY_CONN_FLAG_ACTIVE)
+               &&  netplay->connections[i].udp_token == in.token)
+         {
+            connection = &netplay->connections[i];
+            break;
+         }
+      }
+      if (!connection)
+         continue;
+
+      if (netplay->is_server)
+      {
+         /* Only from the host the TCP connection came from: the token
+          * goes in the clear, so anyone who has seen one datagram
+          * could otherwise feed this client's input, or turn the
+          * replies to itself.  The port may change under NAT. */
+         if (!netplay_udp_addr_is_host((struct sockaddr*)&from,
+               connection->addr.addr))
+            continue;
+
+         /* Reply to wherever the client last sent from. */
+         memcpy(&connection->udp_addr, &from, sizeof(from));
+         connection->udp_addr_len = fromlen;
+         connection->flags       |= NETPLAY_CONN_FLAG_UDP;
+      }
+
+      /* Slaves' input does not follow the frame count. */
+      if (connection->mode != NETPLAY_CONNECTION_PLAYING)
+         continue;
+
+      /* Ignore the claimed client #, must be this client */
+      if (netplay->is_server)
+         netplay_udp_input_frames(netplay, connection, (uint32_t)(i + 1),
+               &in);
+      else if (     in.client_num < MAX_CLIENTS
+               &&   in.client_num != netplay->self_client_num
+               &&  (netplay->connected_players & (1 << in.client_num))
+               && !(netplay->connected_slaves  & (1 << in.client_num)))
+         netplay_udp_input_frames(netplay, connection, in.client_num, &in);
+   }
+}
+
+/**
+ * netplay_udp_listen
+ *
+ * Open the server's UDP input channel, beside the TCP port - or, if
+ * that port is taken, on any.
+ */
+static void netplay_udp_listen(netplay_t *netplay)
+{
+   struct sockaddr_storage addr;
+   socklen_t addrlen = sizeof(addr);
+   uint16_t port;
+
+   if (getsockname(netplay->listen_fd, (struct sockaddr*)&addr,
+            &addrlen) >= 0)
+   {
+      port = netplay_udp_addr_port((struct sockaddr*)&addr);
+      netplay_udp_addr_set_port((struct sockaddr*)&addr,
+            (uint16_t)(port + NETPLAY_UDP_PORT_OFFSET));
+      if ((netplay->udp_fd = netplay_udp_open((struct sockaddr*)&addr,
+            addrlen, true)) >= 0)
+         return;
+
+      RARCH_WARN("[Netplay] UDP port %u is taken; the UDP input channel will use another.\n",
+            (unsigned)(port + NETPLAY_UDP_PORT_OFFSET));
+      netplay_udp_addr_set_port((struct sockaddr*)&addr, 0);
+      if ((netplay->udp_fd = netplay_udp_open((struct sockaddr*)&addr,
+            addrlen, true)) >= 0)
+         return;
+   }
+
+   RARCH_WARN("[Netplay] Could not open the UDP input channel; input will go over TCP only.\n");
+}
+
+/**
+ * netplay_udp_connect
+ *
+ * Open a client's UDP input channel to @port on the server @connection
+ * is to, which offered it with @token.
+ */
+static void netplay_udp_connect(netplay_t *netplay,
+      struct netplay_connection *connection, uint32_t token, uint16_t port)
+{
+   uint32_t buf[NETPLAY_UDP_HEADER_WORDS];
+   struct netplay_udp_input in = {0};
+   struct sockaddr_storage addr;
+   socklen_t addrlen           = sizeof(addr);
+
+   if (netplay->udp_fd < 0)
+   {
+      if (getpeername(connection->fd, (struct sockaddr*)&addr,
+                  &addrlen) >= 0)
+         netplay_udp_addr_set_port((struct sockaddr*)&addr, port);
+      else
+         addrlen = 0;
+      if (     !addrlen
+            || (netplay->udp_fd = netplay_udp_open((struct sockaddr*)&addr,
+                  addrlen, false)) < 0)
+      {
+         RARCH_WARN("[Netplay] Could not open the UDP input channel; input will go over TCP only.\n");
+         return;
+      }
+   }
+
+   connection->udp_token = token;
+   connection->flags    |= NETPLAY_CONN_FLAG_UDP;
+
+   /* Let the server know where we are straight away. */
+   in.token = token;
+   netplay_udp_send(netplay->udp_fd, buf, netplay_udp_input_pack(buf, &in),
+         NULL, 0);
+}
+
+/**
+ * netplay_send_cur_input
+ *
+ * Send the current input frame to a given connection.
+ *
+ * Returns true if successful, false otherwise.
+ */
+bool netplay_send_cur_input(netplay_t *netplay,
+   struct netplay_connection *connection)
+{
+   struct delta_frame *dframe = &netplay->buffer[netplay->self_ptr];
+   NETPLAY_ASSERT_MODUS(NETPLAY_MODUS_INPUT_FRAME_SYNC);
+
+   if (netplay->is_server)
+   {
+      uint32_t from_client;
+      uint32_t to_client = (uint32_t)(connection - netplay->connections + 1);
+
+      /* Send the other players' input data (FIXME: This involves an
+       * unacceptable amount of recalculating) */
+      for (from_client = 1; from_client < MAX_CLIENTS; from_client++)
+      {
+         if (from_client == to_client)
+            continue;
+
+         if ((netplay->connected_players & (1<<from_client)))
+         {
+            if (dframe->have_real[from_client])
+            {
+               if (!send_input_frame(netplay, dframe, connection, NULL, from_client, false))
+                  return false;
+            }
+         }
+      }
+
+      /* If we're not playing, send a NOINPUT */
+      if (netplay->self_mode != NETPLAY_CONNECTION_PLAYING)
+      {
+         uint32_t payload = htonl(netplay->self_frame_count);
+         if (!netplay_send_raw_cmd(netplay, connection, NETPLAY_CMD_NOINPUT,
+               &payload, sizeof(payload)))
+            return false;
+      }
+   }
+
+   /* Send our own data */
+   if (netplay->self_mode == NETPLAY_CONNECTION_PLAYING
+         || netplay->self_mode == NETPLAY_CONNECTION_SLAVE)
+   {
+      if (!send_input_frame(netplay, dframe, connection, NULL,
+            netplay->self_client_num,
+            netplay->self_mode == NETPLAY_CONNECTION_SLAVE))
+         return false;
+   }
+
+   netplay_udp_send_input(netplay, connection);
+
+   if (!netplay_send_flush(&connection->send_packet_buffer, connection->fd,
+         false))
+      return false;
+   return true;
+}
+
+/**
+ * netplay_send_raw_cmd
+ *
+ * Send a raw Netplay command to the given connection.
+ *
+ * Returns true on success, false on failure.
+ */
+bool netplay_send_raw_cmd(netplay_t *netplay,
+   struct netplay_connection *connection, uint32_t cmd, const void *data,
+   size_t len)
+{
+   uint32_t cmdbuf[2];
+
+   cmdbuf[0] = htonl(cmd);
+   cmdbuf[1] = htonl(len);
+
+   if (!netplay_send(&connection->send_packet_buffer, connection->fd, cmdbuf,
+         sizeof(cmdbuf)))
+      return false;
+   if (len > 0)
+      if (!netplay_send(&connection->send_packet_buffer, connection->fd, data, len))
+         return false;
+   return true;
+}
+
+/**
+ * netplay_send_raw_cmd_all
+ *
+ * Send a raw Netplay command to all connections, optionally excluding one
+ * (typically the client that the relevant command came from)
+ */
+void netplay_send_raw_cmd_all(netplay_t *netplay,
+   struct netplay_connection *except, uint32_t cmd, const void *data,
+   size_t len)
+{
+   size_t i;
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      struct netplay_connection *connection = &netplay->connections[i];
+      if (connection == except)
+         continue;
+      if (     (connection->flags & NETPLAY_CONN_FLAG_ACTIVE)
+            && (connection->mode >= NETPLAY_CONNECTION_CONNECTED))
+      {
+         if (!netplay_send_raw_cmd(netplay, connection, cmd, data, len))
+            netplay_hangup(netplay, connection);
+      }
+   }
+}
+
+/**
+ * netplay_send_flush_all
+ *
+ * Flush all of our output buffers
+ */
+static void netplay_send_flush_all(netplay_t *netplay,
+   struct netplay_connection *except)
+{
+   size_t i;
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      struct netplay_connection *connection = &netplay->connections[i];
+      if (connection == except)
+         continue;
+      if (     (connection->flags & NETPLAY_CONN_FLAG_ACTIVE)
+            && (connection->mode >= NETPLAY_CONNECTION_CONNECTED))
+      {
          if (!netplay_send_flush(&connection->send_packet_buffer,
             connection->fd, true))
             netplay_hangup(netplay, connection);
@@ -5527,6 +6187,177 @@ static void netplay_answer_ping(netplay_t *netplay,
          false);
 }
 
+/**
+ * netplay_savestate_prepare
+ *
+ * Make sure serialization is up before loading a state from the
+ * server.
+ */
+static void netplay_savestate_prepare(netplay_t *netplay)
+{
+   if (netplay->quirks & NETPLAY_QUIRK_INITIALIZATION)
+   {
+      if (!netplay->is_replay)
+      {
+         netplay->is_replay          = true;
+         netplay->replay_ptr         = netplay->run_ptr;
+         netplay->replay_frame_count = netplay->run_frame_count;
+         netplay_wait_and_init_serialization(netplay);
+         netplay->is_replay          = false;
+      }
+      else
+         netplay_wait_and_init_serialization(netplay);
+   }
+}
+
+/**
+ * netplay_savestate_loaded
+ *
+ * Catch up with a state from the server, now stored at @load_ptr.
+ *
+ * There is a subtlety in whether the load comes before or after
+ * the current frame:
+ *
+ * If it comes before the current frame, then we need to force a
+ * rewind to that point.
+ *
+ * If it comes after the current frame, we need to jump ahead,
+ * then (strangely) force a rewind to the frame we're already on,
+ * so it gets loaded.
+ * This is just to avoid having reloading implemented
+ * in too many places.
+ */
+static void netplay_savestate_loaded(netplay_t *netplay, uint32_t frame,
+      size_t load_ptr, uint32_t load_frame_count)
+{
+   uint32_t i;
+
+   /* Force a rewind to the relevant frame. */
+   netplay->force_rewind = true;
+
+   /* Skip ahead if it's past where we are. */
+   if (load_frame_count > netplay->run_frame_count)
+   {
+      /* This is squirrely:
+       * We need to assure that when we advance the frame in post_frame,
+       * THEN we're referring to the frame to load into.
+       * If we refer directly to read_ptr,
+       * then we'll end up never reading the input for read_frame_count itself,
+       * which will make the other side unhappy. */
+      netplay->run_ptr         = PREV_PTR(load_ptr);
+      netplay->run_frame_count = load_frame_count - 1;
+
+      if (frame > netplay->self_frame_count)
+      {
+         netplay->self_ptr         = netplay->run_ptr;
+         netplay->self_frame_count = netplay->run_frame_count;
+      }
+   }
+
+   /* Don't expect earlier data from other clients. */
+   for (i = 0; i < MAX_CLIENTS; i++)
+   {
+      if (!(netplay->connected_players & (1 << i)))
+         continue;
+
+      if (frame > netplay->read_frame_count[i])
+      {
+         netplay->read_ptr[i]         = load_ptr;
+         netplay->read_frame_count[i] = load_frame_count;
+      }
+   }
+
+   /* Make sure our states are correct. */
+   netplay->savestate_request_outstanding = false;
+   netplay->other_ptr                     = load_ptr;
+   netplay->other_frame_count             = load_frame_count;
+}
+
+/**
+ * netplay_cmd_request_full_savestate
+ *
+ * Ask the server for a whole savestate, having failed to apply a
+ * delta: whatever base the server remembers for us is no good.
+ */
+static bool netplay_cmd_request_full_savestate(netplay_t *netplay,
+      struct netplay_connection *connection)
+{
+   netplay_connection_drop_base(netplay, connection);
+   netplay->savestate_request_outstanding = true;
+   return netplay_send_raw_cmd(netplay, connection,
+      NETPLAY_CMD_REQUEST_FULL_SAVESTATE, NULL, 0);
+}
+
+/**
+ * netplay_find_frame
+ *
+ * Returns: the ring slot holding @frame, or netplay->buffer_size if
+ * it is gone.
+ */
+static size_t netplay_find_frame(netplay_t *netplay, uint32_t frame)
+{
+   size_t tmp_ptr = netplay->run_ptr;
+
+   do
+   {
+      if (     netplay->buffer[tmp_ptr].used
+            && netplay->buffer[tmp_ptr].frame == frame)
+         return tmp_ptr;
+
+      tmp_ptr = PREV_PTR(tmp_ptr);
+   } while (tmp_ptr != netplay->run_ptr);
+
+   return netplay->buffer_size;
+}
+
+/**
+ * netplay_send_savestate_repair
+ * @netplay              : pointer to netplay object
+ * @connection           : client whose state went astray
+ * @delta                : our state for the frame
+ * @theirs               : the client's block hashes for it
+ * @count                : how many of them
+ *
+ * Send @connection the blocks of @delta's state its hashes say it has
+ * wrong, as runs { first block, block count, blocks }.
+ *
+ * Returns: false if the whole state is the better fix - the blocks do
+ * not line up, or are over half of it - or the connection failed.
+ */
+static bool netplay_send_savestate_repair(netplay_t *netplay,
+      struct netplay_connection *connection, struct delta_frame *delta,
+      const uint32_t *theirs, size_t count)
+{
+   uint32_t header[5];
+   uint32_t wn                          = 0;
+   size_t _len                          = 0;
+   uint8_t *raw                         = NULL;
+   struct compression_transcoder *z     = netplay_transcoder(netplay,
+         connection->compression_supported);
+   bool ret                             = false;
+
+   if (     !(raw = netplay_delta_frame_repair_runs(netplay, delta, theirs,
+               count, &_len))
+         || !netplay_runs_compress(z, raw, _len, netplay->zbuffer,
+               netplay->zbuffer_size, &wn))
+      goto end;
+
+   header[0] = htonl(NETPLAY_CMD_REPAIR_SAVESTATE);
+   header[1] = htonl(wn + 3*sizeof(uint32_t));
+   header[2] = htonl(delta->frame);
+   header[3] = htonl(netplay_blocks_root(netplay, count));
+   header[4] = htonl((uint32_t)_len);
+
+   ret =    netplay_send(&connection->send_packet_buffer,
+               connection->fd, header, sizeof(header))
+         && netplay_send(&connection->send_packet_buffer,
+               connection->fd, netplay->zbuffer, wn);
+
+end:
+   free(raw);
+   return ret;
+}
+
 #undef RECV
 #define RECV(buf, sz) \
    recvd = netplay_recv(&connection->recv_packet_buffer, connection->fd, (buf), (sz)); \
@@ -5639,6 +6470,14 @@ static bool netplay_get_cmd(netplay_t *netplay,
                      RECV(&buf, sizeof(uint32_t))
                         return false;
                   }
+                  /* The UDP copy came first; the stream has still moved
+                   * on a frame. */
+                  if (     !netplay->is_server && client_num == 0
+                        && frame_num == netplay->server_frame_count)
+                  {
+                     netplay->server_ptr = NEXT_PTR(netplay->server_ptr);
+                     netplay->server_frame_count++;
+                  }
                   break;
                }
                else if (frame_num > netplay->read_frame_count[client_num])
@@ -5712,6 +6551,35 @@ static bool netplay_get_cmd(netplay_t *netplay,
             break;
          }
 
+      case NETPLAY_CMD_UDP_CHANNEL:
+         {
+            /* token, port */
+            uint32_t offer[2];
+
+            if (netplay->is_server)
+            {
+               RARCH_ERR("[Netplay] NETPLAY_CMD_UDP_CHANNEL from a client.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            if (cmd_size != sizeof(offer))
+            {
+               RARCH_ERR("[Netplay] NETPLAY_CMD_UDP_CHANNEL received"
+                     " an unexpected payload size.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            RECV(offer, sizeof(offer))
+               return false;
+
+            /* Declining is just not answering. */
+            if (     netplay->udp_input && offer[0]
+                  && ntohl(offer[1]) && ntohl(offer[1]) <= 0xFFFF)
+               netplay_udp_connect(netplay, connection, ntohl(offer[0]),
+                     (uint16_t)ntohl(offer[1]));
+            break;
+         }
+
       case NETPLAY_CMD_NOINPUT:
          {
             uint32_t frame;
@@ -6134,8 +7002,7 @@ static bool netplay_get_cmd(netplay_t *netplay,
       case NETPLAY_CMD_CRC:
          {
             uint32_t buffer[2];
-            size_t tmp_ptr = netplay->run_ptr;
-            bool found = false;
+            size_t tmp_ptr;
             NETPLAY_ASSERT_MODUS(NETPLAY_MODUS_INPUT_FRAME_SYNC);
 
             if (cmd_size != sizeof(buffer))
@@ -6153,34 +7020,23 @@ static bool netplay_get_cmd(netplay_t *netplay,
             /* Received a CRC for some frame. If we still have it, check if it
              * matched. This approach could be improved with some quick modular
              * arithmetic. */
-            do
-            {
-               if (     netplay->buffer[tmp_ptr].used
-                     && netplay->buffer[tmp_ptr].frame == buffer[0])
-               {
-                  found = true;
-                  break;
-               }
-
-               tmp_ptr = PREV_PTR(tmp_ptr);
-            } while (tmp_ptr != netplay->run_ptr);
+            tmp_ptr = netplay_find_frame(netplay, buffer[0]);
 
             /* Oh well, we got rid of it! */
-            if (!found)
+            if (tmp_ptr == netplay->buffer_size)
                break;
 
             if (buffer[0] <= netplay->other_frame_count)
             {
                /* We've already replayed up to this frame, so we can check it
                 * directly */
-               uint32_t local_crc = 0;
-               if (netplay->state_size)
-                  local_crc       = netplay_delta_frame_crc(
-                        netplay, &netplay->buffer[tmp_ptr]);
+               uint32_t local_crc = netplay_delta_frame_hash(netplay,
+                     &netplay->buffer[tmp_ptr], connection);
 
                /* Problem! */
                if (buffer[1] != local_crc)
-                  netplay_cmd_request_savestate(netplay);
+                  netplay_frame_hash_mismatch(netplay,
+                        &netplay->buffer[tmp_ptr]);
             }
             /* We'll have to check it when we catch up */
             else
@@ -6196,9 +7052,143 @@ static bool netplay_get_cmd(netplay_t *netplay,
          netplay->force_send_savestate = true;
          break;
 
+      case NETPLAY_CMD_REQUEST_FULL_SAVESTATE:
+         NETPLAY_ASSERT_MODUS(NETPLAY_MODUS_INPUT_FRAME_SYNC);
+         if (!netplay->is_server)
+         {
+            RARCH_ERR("[Netplay] NETPLAY_CMD_REQUEST_FULL_SAVESTATE from server.\n");
+            return netplay_cmd_nak(netplay, connection);
+         }
+         netplay_connection_drop_base(netplay, connection);
+         netplay->force_send_savestate = true;
+         break;
+
+      case NETPLAY_CMD_BLOCK_HASHES:
+         {
+            /* frame, block count, then the hashes */
+            uint32_t payload[2];
+            size_t   count, tmp_ptr;
+            NETPLAY_ASSERT_MODUS(NETPLAY_MODUS_INPUT_FRAME_SYNC);
+
+            if (!netplay->is_server)
+            {
+               RARCH_ERR("[Netplay] NETPLAY_CMD_BLOCK_HASHES from server.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            if (cmd_size < sizeof(payload))
+            {
+               RARCH_ERR("[Netplay] Received invalid payload size for NETPLAY_CMD_BLOCK_HASHES.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            RECV(payload, sizeof(payload))
+               return false;
+            count = ntohl(payload[1]);
+            if (     count > netplay->state_pages
+                  || cmd_size - sizeof(payload) != count * sizeof(uint32_t))
+            {
+               RARCH_ERR("[Netplay] Received invalid payload size for NETPLAY_CMD_BLOCK_HASHES.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            /* The hashes go to the zbuffer, state_hashes being where
+             * ours are worked out. */
+            RECV(netplay->zbuffer, count * sizeof(uint32_t))
+               return false;
+
+            /* A frame we no longer hold, or hold unconfirmed, or blocks
+             * that do not line up with ours, get the whole state. */
+            tmp_ptr = netplay_find_frame(netplay, ntohl(payload[0]));
+            if (     tmp_ptr == netplay->buffer_size
+                  || ntohl(payload[0]) > netplay->other_frame_count
+                  || !netplay->state_size)
+            {
+               netplay->force_send_savestate = true;
+               break;
+            }
+
+            {
+               /* Copied out: the repair is compressed into the
+                * zbuffer. */
+               uint32_t *theirs = (uint32_t*)malloc(
+                     count * sizeof(uint32_t));
+               bool sent        = false;
+               if (theirs)
+               {
+                  memcpy(theirs, netplay->zbuffer, count * sizeof(uint32_t));
+                  sent = netplay_send_savestate_repair(netplay, connection,
+                        &netplay->buffer[tmp_ptr], theirs, count);
+                  free(theirs);
+               }
+               if (!sent)
+                  netplay->force_send_savestate = true;
+            }
+            break;
+         }
+
+      case NETPLAY_CMD_REPAIR_SAVESTATE:
+         {
+            /* frame, root, uncompressed size of the runs */
+            uint32_t payload[3];
+            uint32_t frame, state_size_raw;
+            size_t   tmp_ptr;
+            NETPLAY_ASSERT_MODUS(NETPLAY_MODUS_INPUT_FRAME_SYNC);
+
+            if (netplay->is_server)
+            {
+               RARCH_ERR("[Netplay] NETPLAY_CMD_REPAIR_SAVESTATE from client.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            if (cmd_size < sizeof(payload))
+            {
+               RARCH_ERR("[Netplay] Received invalid payload size for NETPLAY_CMD_REPAIR_SAVESTATE.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            state_size_raw = cmd_size - sizeof(payload);
+            if (state_size_raw > netplay->zbuffer_size)
+            {
+               RARCH_ERR("[Netplay] Netplay state repair with an unexpected size.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            RECV(payload, sizeof(payload))
+               return false;
+            RECV(netplay->zbuffer, state_size_raw)
+               return false;
+            frame = ntohl(payload[0]);
+
+            /* Replay from the repaired frame; the frames since ran on
+             * the bad state. */
+            tmp_ptr = netplay_find_frame(netplay, frame);
+            if (     tmp_ptr != netplay->buffer_size
+                  && frame <= netplay->other_frame_count
+                  && netplay_delta_frame_repair(netplay,
+                        netplay_transcoder(netplay,
+                           connection->compression_supported),
+                        &netplay->buffer[tmp_ptr], ntohl(payload[1]),
+                        ntohl(payload[2]), state_size_raw))
+            {
+               netplay->force_rewind                  = true;
+               netplay->savestate_request_outstanding = false;
+               netplay->other_ptr                     = tmp_ptr;
+               netplay->other_frame_count             = frame;
+               break;
+            }
+
+            /* Too late, or it did not check out: fall back on the
+             * whole state. */
+            RARCH_WARN("[Netplay] Could not repair a savestate; requesting the whole state.\n");
+            netplay->savestate_request_outstanding = false;
+            if (!netplay_cmd_request_savestate(netplay))
+               return false;
+            break;
+         }
+
       case NETPLAY_CMD_LOAD_SAVESTATE:
          {
-            uint32_t i;
             uint32_t frame;
             uint32_t state_size, state_size_raw;
             size_t   load_ptr;
@@ -6229,31 +7219,7 @@ static bool netplay_get_cmd(netplay_t *netplay,
             }
 
             /* Make sure we're ready for it. */
-            if (netplay->quirks & NETPLAY_QUIRK_INITIALIZATION)
-            {
-               if (!netplay->is_replay)
-               {
-                  netplay->is_replay          = true;
-                  netplay->replay_ptr         = netplay->run_ptr;
-                  netplay->replay_frame_count = netplay->run_frame_count;
-                  netplay_wait_and_init_serialization(netplay);
-                  netplay->is_replay          = false;
-               }
-               else
-                  netplay_wait_and_init_serialization(netplay);
-            }
-
-            /* There is a subtlety in whether the load comes before or after
-             * the current frame:
-             *
-             * If it comes before the current frame, then we need to force a
-             * rewind to that point.
-             *
-             * If it comes after the current frame, we need to jump ahead,
-             * then (strangely) force a rewind to the frame we're already on,
-             * so it gets loaded.
-             * This is just to avoid having reloading implemented
-             * in too many places. */
+            netplay_savestate_prepare(netplay);
 
             RECV(&frame, sizeof(frame))
                return false;
@@ -6287,44 +7253,22 @@ static bool netplay_get_cmd(netplay_t *netplay,
             RECV(netplay->zbuffer, state_size_raw)
                return false;
 
-            switch (connection->compression_supported)
-            {
-               case NETPLAY_COMPRESSION_ZLIB:
-                  ctrans = &netplay->compress_zlib;
-                  break;
-               default:
-                  ctrans = &netplay->compress_nil;
-                  break;
-            }
+            ctrans = netplay_transcoder(netplay,
+                  connection->compression_supported);
 
-            if (state_size > netplay->state_size)
-            {
-               /* other client state size is larger than ours, grow ours */
-               netplay->state_size = state_size;
-               for (i = 0; i < netplay->buffer_size; i++)
-               {
-                  /* realloc-to-tmp to avoid the classic realloc-
-                   * assign-self leak: on OOM realloc returns NULL
-                   * but leaves buffer[i].state pointing at the
-                   * old allocation; self-assign overwrites the
-                   * only pointer and leaks it.  Propagate failure
-                   * up - the caller tears down the netplay
-                   * connection on false return, so the partially-
-                   * grown buffer (0..i-1 at new size, i..end still
-                   * at old size) is about to be torn down anyway. */
-                  void *tmp = realloc(netplay->buffer[i].state, netplay->state_size);
-                  if (!tmp)
-                     return false;
-                  netplay->buffer[i].state = tmp;
-               }
-            }
+            /* other client state size is larger than ours, grow ours.
+             * On OOM the caller tears down the netplay connection on
+             * false return, so a partial grow is about to go anyway. */
+            if (     state_size > netplay->state_size
+                  && !netplay_grow_states(netplay, state_size))
+               return false;
 
             ctrans->decompression_backend->set_in(
                ctrans->decompression_stream,
                netplay->zbuffer, state_size_raw);
             ctrans->decompression_backend->set_out(
                ctrans->decompression_stream,
-               (uint8_t*)netplay->buffer[load_ptr].state, state_size);
+               netplay->state_work, state_size);
             /* trans() returns true for a finalized stream and also for
              * "input exhausted, codec still mid-stream" (reported as
              * TRANS_STREAM_ERROR_AGAIN), so neither the return value nor
@@ -6337,11 +7281,16 @@ static bool netplay_get_cmd(netplay_t *netplay,
                   || zerr != TRANS_STREAM_ERROR_NONE
                   || wn != state_size)
             {
+               netplay_state_invalidate(netplay);
                RARCH_ERR("[Netplay] Failed to decompress peer save state.\n");
                return netplay_cmd_nak(netplay, connection);
             }
+            /* Kept as the base for the server's next delta, too. */
+            if (!netplay_delta_frame_take(netplay, connection,
+                     &netplay->buffer[load_ptr], state_size))
+               return false;
 
-            if (memcmp(netplay->buffer[load_ptr].state, "NETPLAY", 7) != 0)
+            if (memcmp(netplay->state_work, "NETPLAY", 7) != 0)
             {
                if (state_size != netplay->coremem_size)
                {
@@ -6365,46 +7314,88 @@ static bool netplay_get_cmd(netplay_t *netplay,
 #endif
             }
 
-            /* Force a rewind to the relevant frame. */
-            netplay->force_rewind = true;
+            netplay_savestate_loaded(netplay, frame, load_ptr,
+                  load_frame_count);
+            break;
+         }
 
-            /* Skip ahead if it's past where we are. */
-            if (load_frame_count > netplay->run_frame_count)
+      case NETPLAY_CMD_LOAD_SAVESTATE_DELTA:
+         {
+            /* frame, state size, base digest, result digest,
+             * uncompressed size of the runs */
+            uint32_t payload[5];
+            uint32_t frame, state_size_raw;
+            size_t   load_ptr;
+            uint32_t load_frame_count;
+            NETPLAY_ASSERT_MODUS(NETPLAY_MODUS_INPUT_FRAME_SYNC);
+
+            if (netplay->is_server)
             {
-               /* This is squirrely:
-                * We need to assure that when we advance the frame in post_frame,
-                * THEN we're referring to the frame to load into.
-                * If we refer directly to read_ptr,
-                * then we'll end up never reading the input for read_frame_count itself,
-                * which will make the other side unhappy. */
-               netplay->run_ptr         = PREV_PTR(load_ptr);
-               netplay->run_frame_count = load_frame_count - 1;
-
-               if (frame > netplay->self_frame_count)
-               {
-                  netplay->self_ptr         = netplay->run_ptr;
-                  netplay->self_frame_count = netplay->run_frame_count;
-               }
+               RARCH_ERR("[Netplay] NETPLAY_CMD_LOAD_SAVESTATE_DELTA from client.\n");
+               return netplay_cmd_nak(netplay, connection);
             }
 
-            /* Don't expect earlier data from other clients. */
-            for (i = 0; i < MAX_CLIENTS; i++)
+            if (cmd_size < sizeof(payload))
             {
-               if (!(netplay->connected_players & (1 << i)))
-                  continue;
+               RARCH_ERR("[Netplay] Received invalid payload size for NETPLAY_CMD_LOAD_SAVESTATE_DELTA.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
 
-               if (frame > netplay->read_frame_count[i])
-               {
-                  netplay->read_ptr[i]         = load_ptr;
-                  netplay->read_frame_count[i] = load_frame_count;
-               }
+            /* Only players may load states. */
+            if (connection->mode != NETPLAY_CONNECTION_PLAYING &&
+                  connection->mode != NETPLAY_CONNECTION_SLAVE)
+            {
+               RARCH_ERR("[Netplay] Netplay state load from a spectator.\n");
+               return netplay_cmd_nak(netplay, connection);
             }
 
-            /* Make sure our states are correct. */
-            netplay->savestate_request_outstanding = false;
-            netplay->other_ptr                     = load_ptr;
-            netplay->other_frame_count             = load_frame_count;
+            netplay_savestate_prepare(netplay);
+
+            RECV(payload, sizeof(payload))
+               return false;
+            frame = ntohl(payload[0]);
+
+            load_ptr         = netplay->server_ptr;
+            load_frame_count = netplay->server_frame_count;
+
+            if (frame != load_frame_count)
+            {
+               RARCH_ERR("[Netplay] Netplay state load out of order!\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            if (!netplay_delta_frame_ready(netplay,
+                  &netplay->buffer[load_ptr], load_frame_count))
+               goto shrt;
+
+            state_size_raw = cmd_size - sizeof(payload);
+            if (state_size_raw > netplay->zbuffer_size)
+            {
+               RARCH_ERR("[Netplay] Netplay state load with an unexpected save state size.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            RECV(netplay->zbuffer, state_size_raw)
+               return false;
+
+            /* A base that went missing or a result that does not check
+             * out costs a round trip for the whole state, not the
+             * connection. */
+            if (!netplay_delta_frame_apply(netplay, connection,
+                     netplay_transcoder(netplay,
+                        connection->compression_supported),
+                     &netplay->buffer[load_ptr], ntohl(payload[1]),
+                     ntohl(payload[2]), ntohl(payload[3]),
+                     ntohl(payload[4]), state_size_raw))
+            {
+               RARCH_WARN("[Netplay] Could not apply a savestate delta; requesting the whole state.\n");
+               if (!netplay_cmd_request_full_savestate(netplay, connection))
+                  return false;
+               break;
+            }
 
+            netplay_savestate_loaded(netplay, frame, load_ptr,
+                  load_frame_count);
             break;
          }
 
@@ -6831,6 +7822,14 @@ static void netplay_poll_net_input(netplay_t *netplay)
    size_t i;
    bool had_input;
    struct netplay_connection *connection;
+   struct netplay_profile_frame *cur = &netplay->profile.cur;
+   retro_time_t start                = cpu_features_get_time_usec();
+   retro_time_t loaded               = cur->unserialize;
+
+   /* Datagrams first, so their TCP copies are the ones dropped. */
+   if (     netplay->udp_fd >= 0
+         && netplay->modus == NETPLAY_MODUS_INPUT_FRAME_SYNC)
+      netplay_udp_poll(netplay);
 
    do
    {
@@ -6847,6 +7846,10 @@ static void netplay_poll_net_input(netplay_t *netplay)
          }
       }
    } while (had_input);
+
+   /* A savestate loaded on the way counts as loading. */
+   cur->net += cpu_features_get_time_usec() - start
+      - (cur->unserialize - loaded);
 }
 
 /**
@@ -7351,10 +8354,26 @@ static bool netplay_init_serialization(netplay_t *netplay)
       netplay->state_size = info_size;
    }
 
+   /* Every frame starts out as the zero page throughout, which is
+    * what the working buffer holds too. */
+   netplay->state_pages = (netplay->state_size + NETPLAY_PAGE_SIZE - 1)
+      / NETPLAY_PAGE_SIZE;
+   if (!netplay->pages && !(netplay->pages = netplay_pages_new()))
+      return false;
+   if (!(netplay->state_work = (uint8_t*)calloc(netplay->state_pages,
+         NETPLAY_PAGE_SIZE)))
+      return false;
+   if (!(netplay->work_pages = (uint32_t*)calloc(netplay->state_pages,
+         sizeof(uint32_t))))
+      return false;
+   if (!(netplay->state_hashes = (uint32_t*)calloc(netplay->state_pages,
+         sizeof(uint32_t))))
+      return false;
    for (i = 0; i < netplay->buffer_size; i++)
    {
-      netplay->buffer[i].state = calloc(1, netplay->state_size);
-      if (!netplay->buffer[i].state)
+      netplay->buffer[i].pages = (uint32_t*)calloc(netplay->state_pages,
+            sizeof(uint32_t));
+      if (!netplay->buffer[i].pages)
          return false;
    }
 
@@ -7388,10 +8407,12 @@ static bool netplay_try_init_serialization(netplay_t *netplay)
 
    /* Check if we can actually save. */
    serial_info.data_const = NULL;
-   serial_info.data       = netplay->buffer[netplay->run_ptr].state;
+   serial_info.data       = netplay->state_work;
    serial_info.size       = netplay->coremem_size;
    if (!core_serialize_special(&serial_info))
       return false;
+   /* Only a trial; no frame takes it. */
+   netplay_state_invalidate(netplay);
 
    /* Once initialized, we no longer exhibit this quirk. */
    netplay->quirks &= ~NETPLAY_QUIRK_INITIALIZATION;
@@ -7468,8 +8489,12 @@ static void netplay_free(netplay_t *netplay)
 {
    size_t i;
 
+   netplay_profile_log(netplay);
+
    if (netplay->listen_fd >= 0)
       socket_close(netplay->listen_fd);
+   if (netplay->udp_fd >= 0)
+      socket_close(netplay->udp_fd);
 
    if (netplay->mitm_handler)
    {
@@ -7495,6 +8520,7 @@ static void netplay_free(netplay_t *netplay)
          netplay_deinit_socket_buffer(&connection->send_packet_buffer);
          netplay_deinit_socket_buffer(&connection->recv_packet_buffer);
       }
+      netplay_connection_drop_base(netplay, connection);
    }
 
    free(netplay->connections);
@@ -7508,6 +8534,10 @@ static void netplay_free(netplay_t *netplay)
       free(netplay->buffer);
    }
 
+   free(netplay->state_work);
+   free(netplay->work_pages);
+   free(netplay->state_hashes);
+   netplay_pages_free(netplay->pages);
    free(netplay->zbuffer);
 
    if (netplay->compress_nil.compression_stream)
@@ -7522,6 +8552,12 @@ static void netplay_free(netplay_t *netplay)
    if (netplay->compress_zlib.decompression_stream)
       netplay->compress_zlib.decompression_backend->stream_free(
          netplay->compress_zlib.decompression_stream);
+   if (netplay->compress_zstd.compression_stream)
+      netplay->compress_zstd.compression_backend->stream_free(
+         netplay->compress_zstd.compression_stream);
+   if (netplay->compress_zstd.decompression_stream)
+      netplay->compress_zstd.decompression_backend->stream_free(
+         netplay->compress_zstd.decompression_stream);
 
    free(netplay);
 }
@@ -7561,6 +8597,7 @@ static netplay_t *netplay_new(const char *server, const char *mitm,
    netplay->modus            = modus;
    netplay->crcs_valid       = true;
    netplay->listen_fd        = -1;
+   netplay->udp_fd           = -1;
    netplay->next_announce    = -1;
    netplay->next_ping        = -1;
    netplay->simple_rand_next = 1;
@@ -7650,10 +8687,17 @@ static netplay_t *netplay_new(const char *server, const char *mitm,
       /* Clients get device info from the server. */
    }
 
+   /* A relay carries TCP only. */
+   netplay->udp_input = config_get_ptr()->bools.netplay_udp_input
+      && !mitm && !(mitm_session && *mitm_session);
+
    if (     !init_tcp_socket(netplay, server, mitm, port)
          || !netplay_init_buffers(netplay))
       goto failure;
 
+   if (netplay->is_server && netplay->udp_input)
+      netplay_udp_listen(netplay);
+
    return netplay;
 
 failure:
@@ -7662,43 +8706,101 @@ failure:
    return NULL;
 }
 
+/**
+ * netplay_send_savestate_delta
+ * @netplay              : pointer to netplay object
+ * @connection           : peer to send to
+ * @size                 : size of the savestate
+ * @pages                : the savestate, as page ids
+ * @digest               : digest of the savestate
+ * @z                    : compression backend to use
+ * @scratch              : buffer for the delta, allocated on first use
+ *
+ * Send @connection only the pages of a savestate that differ from the
+ * last one it was sent, when it has that one and the difference is at
+ * most half the state; past that, the whole state costs about as much.
+ *
+ * Returns: true if the state went (or the connection did), false if
+ * the peer still needs the whole state.
+ */
+static bool netplay_send_savestate_delta(netplay_t *netplay,
+   struct netplay_connection *connection, uint32_t size,
+   const uint32_t *pages, uint32_t digest,
+   struct compression_transcoder *z, uint8_t **scratch)
+{
+   uint32_t header[7];
+   uint32_t wn        = 0;
+   size_t _len        = 0;
+   size_t raw_size    = size / 2;
+   size_t zsize       = raw_size + raw_size / 8 + 1024;
+   uint8_t *raw, *zraw;
+
+   /* Checked ahead of the runs too, so a peer with no base costs no
+    * scratch buffer. */
+   if (     !connection->base_pages
+         ||  connection->base_size != size)
+      return false;
+   if (!*scratch && !(*scratch = (uint8_t*)malloc(raw_size + zsize)))
+      return false;
+   raw  = *scratch;
+   zraw = raw + raw_size;
+
+   if (     !netplay_state_delta_runs(netplay, connection, pages, size,
+               raw, raw_size, &_len)
+         || !netplay_runs_compress(z, raw, _len, zraw, zsize, &wn))
+      return false;
+
+   header[0] = htonl(NETPLAY_CMD_LOAD_SAVESTATE_DELTA);
+   header[1] = htonl(wn + 5*sizeof(uint32_t));
+   header[2] = htonl(netplay->run_frame_count);
+   header[3] = htonl(size);
+   header[4] = htonl(connection->base_digest);
+   header[5] = htonl(digest);
+   header[6] = htonl((uint32_t)_len);
+
+   if (  !netplay_send(&connection->send_packet_buffer,
+           connection->fd, header, sizeof(header))
+      || !netplay_send(&connection->send_packet_buffer,
+           connection->fd, zraw, wn))
+      netplay_hangup(netplay, connection);
+   else
+      netplay_connection_set_base(netplay, connection, pages, size, digest);
+
+   return true;
+}
+
 /**
  * netplay_send_savestate
  * @netplay              : pointer to netplay object
  * @serial_info          : the savestate being loaded
+ * @pages                : (optional) the same savestate, as page ids
  * @cx                   : compression type
  * @z                    : compression backend to use
  *
  * Send a loaded savestate to those connected peers using the given compression
- * scheme.
+ * scheme.  Given @pages, peers on protocol 8 or higher that hold the last
+ * state sent them get only what changed since.
  */
 static void netplay_send_savestate(netplay_t *netplay,
-   retro_ctx_serialize_info_t *serial_info, uint32_t cx,
-   struct compression_transcoder *z, bool is_legacy_data)
+   retro_ctx_serialize_info_t *serial_info, const uint32_t *pages,
+   uint32_t cx, struct compression_transcoder *z, bool is_legacy_data)
 {
    uint32_t header[4];
-   uint32_t rd, wn;
+   uint32_t rd, wn            = 0;
    size_t i;
+   uint32_t digest            = 0;
+   uint8_t *scratch           = NULL;
+   bool compressed            = false;
    bool has_legacy_connection = false;
    NETPLAY_ASSERT_MODUS(NETPLAY_MODUS_INPUT_FRAME_SYNC);
 
-   /* Compress it */
-   z->compression_backend->set_in(z->compression_stream,
-      (const uint8_t*)serial_info->data_const, (uint32_t)serial_info->size);
-   z->compression_backend->set_out(z->compression_stream,
-      netplay->zbuffer, (uint32_t)netplay->zbuffer_size);
-   if (!z->compression_backend->trans(z->compression_stream, true, &rd,
-         &wn, NULL))
-   {
-      /* Catastrophe! */
-      for (i = 0; i < netplay->connections_size; i++)
-         netplay_hangup(netplay, &netplay->connections[i]);
-      return;
-   }
+   if (pages && !netplay_state_digest(netplay, pages,
+            (serial_info->size + NETPLAY_PAGE_SIZE - 1) / NETPLAY_PAGE_SIZE,
+            &digest))
+      pages = NULL;
 
    /* Send it to relevant peers */
    header[0] = htonl(NETPLAY_CMD_LOAD_SAVESTATE);
-   header[1] = htonl(wn + 2*sizeof(uint32_t));
    header[2] = htonl(netplay->run_frame_count);
    header[3] = htonl(serial_info->size);
 
@@ -7720,11 +8822,49 @@ static void netplay_send_savestate(netplay_t *netplay,
             ||  (connection->compression_supported != cx))
             continue;
 
+         if (pages)
+         {
+            REQUIRE_PROTOCOL_VERSION(connection, 8)
+            {
+               if (netplay_send_savestate_delta(netplay, connection,
+                        (uint32_t)serial_info->size, pages, digest, z,
+                        &scratch))
+                  continue;
+            }
+         }
+
+         /* Compress it, once, for the first peer that needs it whole */
+         if (!compressed)
+         {
+            z->compression_backend->set_in(z->compression_stream,
+               (const uint8_t*)serial_info->data_const,
+               (uint32_t)serial_info->size);
+            z->compression_backend->set_out(z->compression_stream,
+               netplay->zbuffer, (uint32_t)netplay->zbuffer_size);
+            if (!z->compression_backend->trans(z->compression_stream,
+                     true, &rd, &wn, NULL))
+            {
+               size_t j;
+               /* Catastrophe! */
+               for (j = 0; j < netplay->connections_size; j++)
+                  netplay_hangup(netplay, &netplay->connections[j]);
+               free(scratch);
+               return;
+            }
+            header[1]  = htonl(wn + 2*sizeof(uint32_t));
+            compressed = true;
+         }
+
          if (  !netplay_send(&connection->send_packet_buffer,
                  connection->fd, header, sizeof(header))
             || !netplay_send(&connection->send_packet_buffer,
                  connection->fd, netplay->zbuffer, wn))
             netplay_hangup(netplay, connection);
+         else if (!pages)
+            netplay_connection_drop_base(netplay, connection);
+         else REQUIRE_PROTOCOL_VERSION(connection, 8)
+            netplay_connection_set_base(netplay, connection, pages,
+                  (uint32_t)serial_info->size, digest);
       }
       else
       {
@@ -7732,19 +8872,23 @@ static void netplay_send_savestate(netplay_t *netplay,
       }
    }
 
+   free(scratch);
+
    if (has_legacy_connection && !is_legacy_data)
    {
       /* at least one peer is not on protocol 7 or higher. extract the coremem segment
-       * and only send it. */
+       * and only send it.  A copy, so the caller's serial_info still
+       * describes the whole state for its next compression scheme. */
+      retro_ctx_serialize_info_t legacy_info = *serial_info;
       const uint8_t* input = netplay_get_savestate_coremem(netplay,
             (const uint8_t*)serial_info->data_const);
 
       if (input != serial_info->data_const)
       {
-         serial_info->data_const = input;
-         serial_info->size = netplay->coremem_size;
+         legacy_info.data_const = input;
+         legacy_info.size       = netplay->coremem_size;
 
-         netplay_send_savestate(netplay, serial_info, cx, z, true);
+         netplay_send_savestate(netplay, &legacy_info, NULL, cx, z, true);
       }
    }
 }
@@ -7956,23 +9100,21 @@ static bool netplay_process_savestate1(retro_ctx_serialize_info_t* serial_info)
 
 static bool netplay_process_savestate(netplay_t* netplay, retro_ctx_serialize_info_t* serial_info)
 {
+   bool ret           = false;
+   retro_time_t start = cpu_features_get_time_usec();
    NETPLAY_ASSERT_MODUS(NETPLAY_MODUS_INPUT_FRAME_SYNC);
 
    /* if no NETPLAY marker, it's just raw core data */
    if (memcmp(serial_info->data_const, "NETPLAY", 7) != 0)
    {
       serial_info->size = netplay->coremem_size;
-      return core_unserialize_special(serial_info);
+      ret = core_unserialize_special(serial_info);
    }
+   else if (((uint8_t*)serial_info->data_const)[7] == 1)
+      ret = netplay_process_savestate1(serial_info);
 
-   switch (((uint8_t*)serial_info->data_const)[7])
-   {
-      case 1:
-         return netplay_process_savestate1(serial_info);
-
-      default:
-         return false;
-   }
+   netplay->profile.cur.unserialize += cpu_features_get_time_usec() - start;
+   return ret;
 }
 
 static bool netplay_build_savestate(netplay_t* netplay, retro_ctx_serialize_info_t* serial_info, bool force_capture_achievements)
@@ -8029,6 +9171,10 @@ void netplay_load_savestate(netplay_t *netplay,
       retro_ctx_serialize_info_t *serial_info, bool save)
 {
    retro_ctx_serialize_info_t tmp_serial_info = {0};
+   /* The state as stored in the ring, for delta transfers; a caller
+    * not asking us to save has just captured it at run_ptr. */
+   const uint32_t *pages = save ? NULL
+      : netplay->buffer[netplay->run_ptr].pages;
    NETPLAY_ASSERT_MODUS(NETPLAY_MODUS_INPUT_FRAME_SYNC);
 
    if (!serial_info)
@@ -8046,14 +9192,16 @@ void netplay_load_savestate(netplay_t *netplay,
 
       if (!serial_info)
       {
-         tmp_serial_info.data = netplay->buffer[netplay->run_ptr].state;
-         if (!netplay_build_savestate(netplay, &tmp_serial_info, false))
+         if (!netplay_delta_frame_capture(netplay,
+               &netplay->buffer[netplay->run_ptr], &tmp_serial_info, false))
             return;
          serial_info                = &tmp_serial_info;
+         pages                      = netplay->buffer[netplay->run_ptr].pages;
       }
-      else if (serial_info->size <= netplay->state_size)
-         memcpy(netplay->buffer[netplay->run_ptr].state,
-            serial_info->data_const, serial_info->size);
+      else if (netplay_delta_frame_put(netplay,
+            &netplay->buffer[netplay->run_ptr],
+            serial_info->data_const, serial_info->size))
+         pages                      = netplay->buffer[netplay->run_ptr].pages;
    }
 
    /* Don't send it if we're expected to be desynced. */
@@ -8061,11 +9209,14 @@ void netplay_load_savestate(netplay_t *netplay,
    {
       /* Send this to every peer. */
       if (netplay->compress_nil.compression_backend)
-         netplay_send_savestate(netplay, serial_info, 0,
+         netplay_send_savestate(netplay, serial_info, pages, 0,
             &netplay->compress_nil, false);
       if (netplay->compress_zlib.compression_backend)
-         netplay_send_savestate(netplay, serial_info, NETPLAY_COMPRESSION_ZLIB,
-            &netplay->compress_zlib, false);
+         netplay_send_savestate(netplay, serial_info, pages,
+            NETPLAY_COMPRESSION_ZLIB, &netplay->compress_zlib, false);
+      if (netplay->compress_zstd.compression_backend)
+         netplay_send_savestate(netplay, serial_info, pages,
+            NETPLAY_COMPRESSION_ZSTD, &netplay->compress_zstd, false);
    }
 }
 
@@ -9344,6 +10495,8 @@ static void netplay_disconnect(netplay_t *netplay)
  **/
 static bool netplay_pre_frame(netplay_t *netplay)
 {
+   netplay_profile_frame_end(netplay, cpu_features_get_time_usec());
+
    /* FIXME: This is an ugly way to learn we're not paused anymore */
    if (netplay->local_paused)
       netplay_frontend_paused(netplay, false);
@@ -9410,6 +10563,7 @@ static bool netplay_pre_frame(netplay_t *netplay)
       /* We may have received data even if we're stalled,
        * so run post-frame sync. */
       netplay_sync_input_post_frame(netplay, true);
+      netplay->profile.cur.stalled = true;
       return false;
    }
 
@@ -9427,6 +10581,7 @@ static bool netplay_pre_frame(netplay_t *netplay)
 static void netplay_post_frame(netplay_t *netplay)
 {
    size_t i;
+   retro_time_t start;
 
    /* When a core uses the netpacket interface frames are not synced */
    if (netplay->modus == NETPLAY_MODUS_INPUT_FRAME_SYNC)
@@ -9435,6 +10590,7 @@ static void netplay_post_frame(netplay_t *netplay)
       netplay_sync_input_post_frame(netplay, false);
    }
 
+   start = cpu_features_get_time_usec();
    for (i = 0; i < netplay->connections_size; i++)
    {
       struct netplay_connection *connection = &netplay->connections[i];
@@ -9444,6 +10600,7 @@ static void netplay_post_frame(netplay_t *netplay)
              false))
          netplay_hangup(netplay, connection);
    }
+   netplay->profile.cur.net += cpu_features_get_time_usec() - start;
 
    /* If we're disconnected, deinitialize */
    if (     (!(netplay->is_server))
@@ -9859,13 +11016,26 @@ bool netplay_reinit_serialization(void)
 
    netplay->state_size = 0;
 
+   /* A base is page ids in the store about to go. */
+   for (i = 0; i < netplay->connections_size; i++)
+      netplay_connection_drop_base(netplay, &netplay->connections[i]);
+
    /* netplay_init_serialization rebuilds the delta states and zbuffer, but
     * nothing else, so we have to free them directly */
    for (i = 0; i < netplay->buffer_size; i++)
    {
-      free(netplay->buffer[i].state);
-      netplay->buffer[i].state = NULL;
+      free(netplay->buffer[i].pages);
+      netplay->buffer[i].pages = NULL;
    }
+   netplay_pages_free(netplay->pages);
+   netplay->pages = NULL;
+   free(netplay->state_work);
+   netplay->state_work  = NULL;
+   free(netplay->work_pages);
+   netplay->work_pages  = NULL;
+   free(netplay->state_hashes);
+   netplay->state_hashes = NULL;
+   netplay->state_pages = 0;
 
    if (netplay->zbuffer)
    {
@@ -10020,6 +11190,15 @@ bool netplay_driver_ctl(enum rarch_netplay_ctl_state state, void *data)
          ret = (netplay && netplay->is_replay);
          break;
 
+      case RARCH_NETPLAY_CTL_GET_ROLLBACK_STATS:
+         if (!netplay || netplay->modus != NETPLAY_MODUS_INPUT_FRAME_SYNC)
+         {
+            ret = false;
+            break;
+         }
+         netplay_profile_get(netplay, (netplay_rollback_stats_t*)data);
+         break;
+
       case RARCH_NETPLAY_CTL_IS_SERVER:
          ret =   (net_st->flags & NET_DRIVER_ST_FLAG_NETPLAY_ENABLED)
             && (!(net_st->flags & NET_DRIVER_ST_FLAG_NETPLAY_IS_CLIENT));
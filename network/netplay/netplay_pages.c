@@ -0,0 +1,242 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <array/rbuf.h>
+#include <array/rhmap.h>
+
+#define XXH_INLINE_ALL
+#include <xxHash/xxhash.h>
+
+#include "netplay_pages.h"
+
+struct netplay_page
+{
+   uint8_t *data;
+   uint32_t refs;     /* 0: on the free list, data kept for reuse */
+   uint32_t hash;
+   uint32_t next;     /* same-hash chain, or the free list */
+};
+
+struct netplay_pages
+{
+   struct netplay_page *pages;  /* rbuf, indexed by id */
+   uint32_t *heads;             /* rhmap: hash -> first id of its chain */
+   uint32_t free_list;
+   size_t live;
+};
+
+/* rhmap reserves key 0 for empty slots. */
+uint32_t netplay_pages_hash_data(const uint8_t *data, size_t len)
+{
+   uint32_t hash = XXH32(data, len, 0);
+   return hash ? hash : 1;
+}
+
+netplay_pages_t *netplay_pages_new(void)
+{
+   struct netplay_page zero;
+   netplay_pages_t *pages = (netplay_pages_t*)calloc(1, sizeof(*pages));
+
+   if (!pages)
+      return NULL;
+
+   pages->free_list = NETPLAY_PAGE_NONE;
+
+   if (!(zero.data = (uint8_t*)calloc(1, NETPLAY_PAGE_SIZE)))
+      goto error;
+   zero.refs = 1;
+   zero.hash = netplay_pages_hash_data(zero.data, NETPLAY_PAGE_SIZE);
+   zero.next = NETPLAY_PAGE_NONE;
+   if (!RBUF_TRYFIT(pages->pages, 64) || !RHMAP_TRYFIT(pages->heads, 64))
+   {
+      free(zero.data);
+      goto error;
+   }
+   RBUF_PUSH(pages->pages, zero);
+   RHMAP_SET(pages->heads, zero.hash, NETPLAY_PAGE_ZERO);
+   pages->live = 1;
+   return pages;
+
+error:
+   RBUF_FREE(pages->pages);
+   RHMAP_FREE(pages->heads);
+   free(pages);
+   return NULL;
+}
+
+void netplay_pages_free(netplay_pages_t *pages)
+{
+   size_t i;
+
+   if (!pages)
+      return;
+
+   for (i = 0; i < RBUF_LEN(pages->pages); i++)
+      free(pages->pages[i].data);
+   RBUF_FREE(pages->pages);
+   RHMAP_FREE(pages->heads);
+   free(pages);
+}
+
+uint32_t netplay_pages_intern(netplay_pages_t *pages, const uint8_t *data)
+{
+   struct netplay_page *page;
+   uint32_t id;
+   uint32_t hash    = netplay_pages_hash_data(data, NETPLAY_PAGE_SIZE);
+   ptrdiff_t bucket = RHMAP_IDX(pages->heads, hash);
+
+   if (bucket >= 0)
+   {
+      for (id = pages->heads[bucket]; id != NETPLAY_PAGE_NONE;
+            id = pages->pages[id].next)
+      {
+         if (!memcmp(pages->pages[id].data, data, NETPLAY_PAGE_SIZE))
+         {
+            netplay_pages_ref(pages, id);
+            return id;
+         }
+      }
+   }
+   /* A new bucket may grow the map; fit it before taking a slot, so
+    * failure leaves nothing to unwind. */
+   else if (!RHMAP_TRYFIT(pages->heads, RHMAP_LEN(pages->heads) + 1))
+      return NETPLAY_PAGE_NONE;
+
+   if (pages->free_list != NETPLAY_PAGE_NONE)
+   {
+      id               = pages->free_list;
+      pages->free_list = pages->pages[id].next;
+   }
+   else
+   {
+      struct netplay_page fresh;
+      size_t len = RBUF_LEN(pages->pages);
+      if (len >= NETPLAY_PAGE_NONE)
+         return NETPLAY_PAGE_NONE;
+      if (!(fresh.data = (uint8_t*)malloc(NETPLAY_PAGE_SIZE)))
+         return NETPLAY_PAGE_NONE;
+      if (!RBUF_TRYFIT(pages->pages, len + 1))
+      {
+         free(fresh.data);
+         return NETPLAY_PAGE_NONE;
+      }
+      RBUF_PUSH(pages->pages, fresh);
+      id = (uint32_t)len;
+   }
+
+   page       = &pages->pages[id];
+   memcpy(page->data, data, NETPLAY_PAGE_SIZE);
+   page->refs = 1;
+   page->hash = hash;
+   if (bucket >= 0)
+   {
+      page->next           = pages->heads[bucket];
+      pages->heads[bucket] = id;
+   }
+   else
+   {
+      page->next = NETPLAY_PAGE_NONE;
+      RHMAP_SET(pages->heads, hash, id);
+   }
+   pages->live++;
+   return id;
+}
+
+void netplay_pages_ref(netplay_pages_t *pages, uint32_t id)
+{
+   if (id != NETPLAY_PAGE_ZERO && id != NETPLAY_PAGE_NONE)
+      pages->pages[id].refs++;
+}
+
+void netplay_pages_unref(netplay_pages_t *pages, uint32_t id)
+{
+   struct netplay_page *page;
+   ptrdiff_t bucket;
+
+   if (id == NETPLAY_PAGE_ZERO || id == NETPLAY_PAGE_NONE)
+      return;
+   page = &pages->pages[id];
+   if (--page->refs)
+      return;
+
+   /* Unlink from its hash chain; the data stays allocated for the
+    * next intern, the ring's steady state being one page out for
+    * one page in. */
+   bucket = RHMAP_IDX(pages->heads, page->hash);
+   if (bucket >= 0)
+   {
+      if (pages->heads[bucket] == id)
+      {
+         if (page->next == NETPLAY_PAGE_NONE)
+            (void)RHMAP_DEL(pages->heads, page->hash);
+         else
+            pages->heads[bucket] = page->next;
+      }
+      else
+      {
+         uint32_t prev = pages->heads[bucket];
+         while (     pages->pages[prev].next != NETPLAY_PAGE_NONE
+                  && pages->pages[prev].next != id)
+            prev = pages->pages[prev].next;
+         pages->pages[prev].next = page->next;
+      }
+   }
+
+   page->next       = pages->free_list;
+   pages->free_list = id;
+   pages->live--;
+}
+
+const uint8_t *netplay_pages_get(const netplay_pages_t *pages,
+      uint32_t id)
+{
+   return pages->pages[id].data;
+}
+
+size_t netplay_pages_count(const netplay_pages_t *pages)
+{
+   return pages ? pages->live : 0;
+}
+
+uint32_t netplay_pages_hash(const netplay_pages_t *pages, uint32_t id)
+{
+   return pages->pages[id].hash;
+}
+
+uint32_t netplay_pages_digest(const uint32_t *hashes, size_t count)
+{
+   XXH32_state_t state;
+   uint8_t le[256];
+   size_t i = 0;
+
+   XXH32_reset(&state, 0);
+   while (i < count)
+   {
+      size_t j, n = count - i;
+      if (n > sizeof(le) / 4)
+         n = sizeof(le) / 4;
+      for (j = 0; j < n; j++, i++)
+      {
+         le[j * 4 + 0] = (uint8_t)(hashes[i]      );
+         le[j * 4 + 1] = (uint8_t)(hashes[i] >>  8);
+         le[j * 4 + 2] = (uint8_t)(hashes[i] >> 16);
+         le[j * 4 + 3] = (uint8_t)(hashes[i] >> 24);
+      }
+      XXH32_update(&state, le, n * 4);
+   }
+   return XXH32_digest(&state);
+}
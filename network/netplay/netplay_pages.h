@@ -0,0 +1,82 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RARCH_NETPLAY_PAGES_H
+#define __RARCH_NETPLAY_PAGES_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+
+RETRO_BEGIN_DECLS
+
+/* Reference-counted, content-addressed store of fixed-size pages -
+ * the rollback ring's savestates, held as tables of page ids.
+ *
+ * Consecutive frames' states differ in a handful of pages, so a ring
+ * of them shares nearly everything: a page is stored once however
+ * many frames hold it, and dropped when the last one lets go.  Same
+ * shape as the statestream's block index (input/bsv/uint32s_index.c)
+ * - xxHash buckets confirmed by memcmp, a permanent all-zero page at
+ * id 0 - but ids are recycled, since a ring reuses its slots forever
+ * where a movie only appends. */
+
+#define NETPLAY_PAGE_SIZE 4096
+
+/* The all-zero page: always present, never counted. */
+#define NETPLAY_PAGE_ZERO 0
+/* No page - OOM from netplay_pages_intern, or nothing mirrored. */
+#define NETPLAY_PAGE_NONE UINT32_MAX
+
+typedef struct netplay_pages netplay_pages_t;
+
+netplay_pages_t *netplay_pages_new(void);
+
+/* Frees every page at once, referenced or not. */
+void netplay_pages_free(netplay_pages_t *pages);
+
+/* Returns the id of a page holding @data's NETPLAY_PAGE_SIZE bytes,
+ * reusing an identical one when there is one, and takes a reference
+ * on it.  NETPLAY_PAGE_NONE on OOM. */
+uint32_t netplay_pages_intern(netplay_pages_t *pages, const uint8_t *data);
+
+void netplay_pages_ref(netplay_pages_t *pages, uint32_t id);
+
+/* Drops a reference; the page goes at the last one.  NETPLAY_PAGE_ZERO
+ * and NETPLAY_PAGE_NONE are accepted and ignored. */
+void netplay_pages_unref(netplay_pages_t *pages, uint32_t id);
+
+const uint8_t *netplay_pages_get(const netplay_pages_t *pages,
+      uint32_t id);
+
+/* Distinct pages held, the zero page included. */
+size_t netplay_pages_count(const netplay_pages_t *pages);
+
+/* A page's hash, as the store computes it over NETPLAY_PAGE_SIZE
+ * bytes: the same on every host, so peers can compare pages without
+ * exchanging them.  A shorter @len hashes a page's head alike. */
+uint32_t netplay_pages_hash_data(const uint8_t *data, size_t len);
+
+/* The hash of a page already held. */
+uint32_t netplay_pages_hash(const netplay_pages_t *pages, uint32_t id);
+
+/* Folds a run of page hashes, in order, into one value that stands
+ * for the whole state they describe. */
+uint32_t netplay_pages_digest(const uint32_t *hashes, size_t count);
+
+RETRO_END_DECLS
+
+#endif
@@ -20,6 +20,8 @@
 
 #include "netplay.h"
 #include "netplay_protocol.h"
+#include "netplay_pages.h"
+#include "netplay_udp.h"
 
 #include <stdint.h>
 #include <libretro.h>
@@ -63,22 +65,48 @@
 #define NETPLAY_MAX_REQ_STALL_TIME      60
 #define NETPLAY_MAX_REQ_STALL_FREQUENCY 120
 
+/* Frames the rollback profile's figures are taken over */
+#define NETPLAY_PROFILE_WINDOW          60
+
 #define PREV_PTR(x) ((x) == 0 ? netplay->buffer_size - 1 : (x) - 1)
 #define NEXT_PTR(x) ((x + 1) % netplay->buffer_size)
 
+#define REQUIRE_PROTOCOL_VERSION(connection, version) \
+   if ((connection)->netplay_protocol >= (version))
+
+#define REQUIRE_PROTOCOL_RANGE(connection, vmin, vmax) \
+   if ((connection)->netplay_protocol >= (vmin) && \
+         (connection)->netplay_protocol <= (vmax))
+
 /* Quirks mandated by how particular cores save states. This is distilled from
  * the larger set of quirks that the quirks environment can communicate. */
 #define NETPLAY_QUIRK_INITIALIZATION     (1 << 0)
 #define NETPLAY_QUIRK_ENDIAN_DEPENDENT   (1 << 1)
 #define NETPLAY_QUIRK_PLATFORM_DEPENDENT (1 << 2)
 
+/* The savestate container: "NETPLAY#", then blocks of a four byte
+ * tag and size, each aligned to 8 bytes */
+#define CONTENT_ALIGN_SIZE(size) ((((size) + 7) & ~7))
+#define NETPLAYSTATE_VERSION 1
+#define NETPLAYSTATE_MEM_BLOCK "MEM "
+#define NETPLAYSTATE_CHEEVOS_BLOCK "ACHV"
+#define NETPLAYSTATE_END_BLOCK "END "
+
 /* Compression protocols supported */
 #define NETPLAY_COMPRESSION_ZLIB (1<<0)
+#define NETPLAY_COMPRESSION_ZSTD (1<<1)
 #if HAVE_ZLIB
-#define NETPLAY_COMPRESSION_SUPPORTED NETPLAY_COMPRESSION_ZLIB
+#define NETPLAY_COMPRESSION_SUPPORTED_ZLIB NETPLAY_COMPRESSION_ZLIB
 #else
-#define NETPLAY_COMPRESSION_SUPPORTED 0
+#define NETPLAY_COMPRESSION_SUPPORTED_ZLIB 0
 #endif
+#if defined(HAVE_RZSTD) || defined(HAVE_ZSTD)
+#define NETPLAY_COMPRESSION_SUPPORTED_ZSTD NETPLAY_COMPRESSION_ZSTD
+#else
+#define NETPLAY_COMPRESSION_SUPPORTED_ZSTD 0
+#endif
+#define NETPLAY_COMPRESSION_SUPPORTED \
+   (NETPLAY_COMPRESSION_SUPPORTED_ZLIB | NETPLAY_COMPRESSION_SUPPORTED_ZSTD)
 
 /* The keys supported by netplay */
 enum netplay_keys
@@ -111,6 +139,10 @@ enum netplay_cmd
    /* Non-input data */
    NETPLAY_CMD_NOINPUT        = 0x0004,
 
+   /* Offer a UDP channel for input: its port, and the token its
+    * datagrams must carry */
+   NETPLAY_CMD_UDP_CHANNEL    = 0x0005,
+
    /* Initialization commands */
 
    /* Inform the other side of our nick (must be first command) */
@@ -166,6 +198,20 @@ enum netplay_cmd
    /* Send a network packet from the raw packet core interface */
    NETPLAY_CMD_NETPACKET      = 0x0048,
 
+   /* Send a savestate as the blocks that changed since the last one
+    * sent, for the client to apply to that one and load */
+   NETPLAY_CMD_LOAD_SAVESTATE_DELTA = 0x0049,
+
+   /* Request a savestate, whole: the client has no usable delta base */
+   NETPLAY_CMD_REQUEST_FULL_SAVESTATE = 0x004A,
+
+   /* Report a frame's per-block hashes, its CRC having mismatched */
+   NETPLAY_CMD_BLOCK_HASHES   = 0x004B,
+
+   /* Send the blocks of a past frame's state that the client's
+    * BLOCK_HASHES showed diverging, for it to patch and replay from */
+   NETPLAY_CMD_REPAIR_SAVESTATE = 0x004C,
+
    /* Misc. commands */
 
    /* Sends multiple config requests over,
@@ -318,8 +364,9 @@ struct delta_frame
     * it's a real simulation, not real input. */
    netplay_input_state_t simulated_input[MAX_INPUT_DEVICES];
 
-   /* The serialized state of the core at this frame, before input */
-   void *state;
+   /* The serialized state of the core at this frame, before input,
+    * as state_pages ids into the netplay's page store */
+   uint32_t *pages;
 
    uint32_t frame;
 
@@ -365,7 +412,10 @@ enum netplay_connection_flags
    /* Is this connection allowed to play (server only)? */
    NETPLAY_CONN_FLAG_CAN_PLAY       = (1 << 2),
    /* Did we request a ping response? */
-   NETPLAY_CONN_FLAG_PING_REQUESTED = (1 << 3)
+   NETPLAY_CONN_FLAG_PING_REQUESTED = (1 << 3),
+   /* Is the UDP input channel up: for the server, has a datagram
+    * told us where to send ours? */
+   NETPLAY_CONN_FLAG_UDP            = (1 << 4)
 };
 
 /* Each connection gets a connection struct */
@@ -381,6 +431,22 @@ struct netplay_connection
    struct socket_buffer send_packet_buffer;
    struct socket_buffer recv_packet_buffer;
 
+   /* The last savestate exchanged with this peer, as page ids holding
+    * a reference each - what the server sent, or what the client
+    * loaded - which a LOAD_SAVESTATE_DELTA is relative to.  NULL when
+    * there is none. */
+   uint32_t *base_pages;
+   size_t base_count;
+   uint32_t base_size;
+   uint32_t base_digest;
+
+   /* Where this client's UDP datagrams come from (server only) */
+   struct sockaddr_storage udp_addr;
+   socklen_t udp_addr_len;
+
+   /* Token on this connection's UDP datagrams, or 0 for no channel */
+   uint32_t udp_token;
+
    /* What compression does this peer support? */
    uint32_t compression_supported;
 
@@ -478,6 +544,34 @@ struct netplay_chat
    } messages[NETPLAY_CHAT_MAX_MESSAGES];
 };
 
+/* Where one frame's time went, in microseconds. */
+struct netplay_profile_frame
+{
+   retro_time_t serialize;   /* saving states */
+   retro_time_t unserialize; /* loading them, for a rollback or from the
+                              * network */
+   retro_time_t replay;      /* re-running frames, less the above */
+   retro_time_t net;         /* reading and sending, less the above */
+   retro_time_t stall;       /* the whole frame, if it stalled */
+   uint32_t replayed;        /* frames re-run */
+   bool stalled;
+};
+
+struct netplay_profile
+{
+   struct netplay_profile_frame window[NETPLAY_PROFILE_WINDOW];
+   /* The frame under way */
+   struct netplay_profile_frame cur;
+   /* The session so far, for the log */
+   struct netplay_profile_frame total;
+   retro_time_t frame_start;
+   size_t window_ptr;
+   uint32_t frames;
+   uint32_t rollbacks;
+   uint32_t stalled;
+   uint32_t max_replayed;
+};
+
 struct netplay
 {
    /* We stall if we're far enough ahead that we
@@ -497,11 +591,15 @@ struct netplay
    retro_time_t next_announce;
    retro_time_t next_ping;
 
+   /* What rollback is costing us */
+   struct netplay_profile profile;
+
    struct retro_callbacks cbs;
 
    /* Compression transcoder */
    struct compression_transcoder compress_nil;
    struct compression_transcoder compress_zlib;
+   struct compression_transcoder compress_zstd;
 
    /* MITM session id */
    mitm_id_t mitm_session_id;
@@ -523,6 +621,17 @@ struct netplay
    /* A buffer into which to compress frames for transfer */
    uint8_t *zbuffer;
 
+   /* Frame states are held as pages, shared between frames.  A state
+    * is serialized into and loaded from state_work; work_pages names
+    * the page each of its pages currently mirrors (holding a
+    * reference), so a load copies only the pages that differ. */
+   netplay_pages_t *pages;
+   uint8_t *state_work;
+   uint32_t *work_pages;
+   /* Scratch for a state's per-page hashes, state_pages long */
+   uint32_t *state_hashes;
+   size_t state_pages;
+
    size_t connections_size;
    size_t buffer_size;
    size_t zbuffer_size;
@@ -613,6 +722,10 @@ struct netplay
    /* TCP connection for listening (server only) */
    int listen_fd;
 
+   /* UDP socket for input: bound beside listen_fd for the server,
+    * connected to the server for a client.  -1 when there is none. */
+   int udp_fd;
+
    int frame_run_time_ptr;
 
    /* Latency frames; positive to hide network latency,
@@ -655,6 +768,9 @@ struct netplay
 
    bool nat_traversal;
 
+   /* May input go over UDP as well? */
+   bool udp_input;
+
    /* Have we checked whether CRCs are valid at all? */
    bool crc_validity_checked;
 
@@ -763,6 +879,91 @@ bool netplay_delta_frame_ready(netplay_t *netplay,
       struct delta_frame *delta,
       uint32_t frame);
 
+/* Forget what the working buffer mirrors, after writing to it with no
+ * frame to store the result in. */
+void netplay_state_invalidate(netplay_t *netplay);
+
+/* Zero the working buffer past @size. */
+void netplay_state_pad(netplay_t *netplay, size_t size);
+
+/* Store the working buffer as this frame's state. */
+bool netplay_delta_frame_store(netplay_t *netplay,
+      struct delta_frame *delta);
+
+/* Bring this frame's state into the working buffer, and return it. */
+const uint8_t *netplay_delta_frame_load(netplay_t *netplay,
+      const struct delta_frame *delta);
+
+/* Give @dst the same state as @src, by reference. */
+void netplay_delta_frame_share(netplay_t *netplay,
+      struct delta_frame *dst, const struct delta_frame *src);
+
+/* Store @size bytes of serialized state as this frame's state. */
+bool netplay_delta_frame_put(netplay_t *netplay,
+      struct delta_frame *delta, const void *data, size_t size);
+
+/* Grow the working buffer and every frame's state to @state_size. */
+bool netplay_grow_states(netplay_t *netplay, size_t state_size);
+
+/* Digest of the state held as @count page ids. */
+bool netplay_state_digest(netplay_t *netplay,
+      const uint32_t *pages, size_t count, uint32_t *digest);
+
+/* Forget the savestate last exchanged with @connection. */
+void netplay_connection_drop_base(netplay_t *netplay,
+      struct netplay_connection *connection);
+
+/* Record the state held as @pages as the one last exchanged with
+ * @connection. */
+void netplay_connection_set_base(netplay_t *netplay,
+      struct netplay_connection *connection, const uint32_t *pages,
+      uint32_t size, uint32_t digest);
+
+/* Store a whole state from @connection, in the working buffer, as this
+ * frame's state and as the base for the peer's next delta. */
+bool netplay_delta_frame_take(netplay_t *netplay,
+      struct netplay_connection *connection, struct delta_frame *delta,
+      uint32_t state_size);
+
+/* The runs of a NETPLAY_CMD_LOAD_SAVESTATE_DELTA; false when the
+ * whole state should go instead. */
+bool netplay_state_delta_runs(netplay_t *netplay,
+      const struct netplay_connection *connection, const uint32_t *pages,
+      uint32_t size, uint8_t *raw, size_t raw_size, size_t *len);
+
+/* Compress @len bytes of runs into @out; *wn is 0 when there are none. */
+bool netplay_runs_compress(struct compression_transcoder *z,
+      const uint8_t *raw, size_t len, uint8_t *out, size_t out_size,
+      uint32_t *wn);
+
+/* Load a NETPLAY_CMD_LOAD_SAVESTATE_DELTA's runs, compressed in the
+ * zbuffer, into this frame; false when the whole state is needed. */
+bool netplay_delta_frame_apply(netplay_t *netplay,
+      struct netplay_connection *connection,
+      struct compression_transcoder *ctrans, struct delta_frame *delta,
+      uint32_t state_size, uint32_t base_digest, uint32_t digest,
+      uint32_t raw_size, uint32_t zsize);
+
+/* Fill state_hashes with this frame's block hashes. */
+size_t netplay_delta_frame_block_hashes(netplay_t *netplay,
+      const struct delta_frame *delta, size_t *end);
+
+/* The root of the first @count of state_hashes; never 0. */
+uint32_t netplay_blocks_root(netplay_t *netplay, size_t count);
+
+/* The runs of a NETPLAY_CMD_REPAIR_SAVESTATE, to free(); NULL when the
+ * whole state should go instead. */
+uint8_t *netplay_delta_frame_repair_runs(netplay_t *netplay,
+      const struct delta_frame *delta, const uint32_t *theirs,
+      size_t count, size_t *len);
+
+/* Patch this frame's state with a NETPLAY_CMD_REPAIR_SAVESTATE's runs,
+ * compressed in the zbuffer; false if the result is not the server's
+ * state. */
+bool netplay_delta_frame_repair(netplay_t *netplay,
+      struct compression_transcoder *ctrans, struct delta_frame *delta,
+      uint32_t root, uint32_t raw_size, uint32_t zsize);
+
 /***************************************************************
  * NETPLAY-FRONTEND.C
  **************************************************************/
@@ -0,0 +1,272 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <lrc_hash.h>
+#include <features/features_cpu.h>
+#include <net/net_compat.h>
+#include <net/net_socket.h>
+
+#include "netplay_udp.h"
+
+static netplay_udp_drop_t netplay_udp_drop      = NULL;
+static void              *netplay_udp_drop_data = NULL;
+
+/* netplay_udp_token's key, and how many tokens it has made. */
+static uint8_t  netplay_udp_key[32];
+static bool     netplay_udp_keyed  = false;
+static uint32_t netplay_udp_tokens = 0;
+
+size_t netplay_udp_input_pack(uint32_t *out,
+      const struct netplay_udp_input *in)
+{
+   out[0] = htonl(NETPLAY_UDP_MAGIC);
+   out[1] = htonl(in->token);
+   out[2] = htonl(in->client_num);
+   out[3] = htonl(in->frame);
+   out[4] = htonl(in->count);
+   out[5] = htonl(in->words);
+   return (NETPLAY_UDP_HEADER_WORDS + in->count * in->words)
+      * sizeof(uint32_t);
+}
+
+bool netplay_udp_input_parse(const uint32_t *buf, size_t len,
+      struct netplay_udp_input *out)
+{
+   if (     len < NETPLAY_UDP_HEADER_WORDS * sizeof(uint32_t)
+         || len > NETPLAY_UDP_MAX_SIZE
+         || ntohl(buf[0]) != NETPLAY_UDP_MAGIC)
+      return false;
+
+   out->token      = ntohl(buf[1]);
+   out->client_num = ntohl(buf[2]);
+   out->frame      = ntohl(buf[3]);
+   out->count      = ntohl(buf[4]);
+   out->words      = ntohl(buf[5]);
+   out->data       = buf + NETPLAY_UDP_HEADER_WORDS;
+
+   /* Bounded by the size check above, so this cannot overflow. */
+   if (     out->count > NETPLAY_UDP_MAX_WORDS
+         || out->words > NETPLAY_UDP_MAX_WORDS)
+      return false;
+   return len == (NETPLAY_UDP_HEADER_WORDS + out->count * out->words)
+      * sizeof(uint32_t);
+}
+
+int netplay_udp_open(const struct sockaddr *addr, socklen_t addrlen,
+      bool is_server)
+{
+   int fd = socket(addr->sa_family, SOCK_DGRAM, 0);
+
+   if (fd < 0)
+      return -1;
+
+   if (is_server)
+   {
+#if defined(HAVE_INET6) && defined(IPV6_V6ONLY)
+      /* Listen on IPv4 too, as the TCP socket does. */
+      if (addr->sa_family == AF_INET6)
+      {
+         int on = 0;
+         setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY,
+               (const char*)&on, sizeof(on));
+      }
+#endif
+      if (bind(fd, addr, addrlen) < 0)
+         goto error;
+   }
+   else if (connect(fd, addr, addrlen) < 0)
+      goto error;
+
+   if (socket_nonblock(fd))
+      return fd;
+
+error:
+   socket_close(fd);
+   return -1;
+}
+
+uint16_t netplay_udp_addr_port(const struct sockaddr *addr)
+{
+   switch (addr->sa_family)
+   {
+      case AF_INET:
+         return ntohs(((const struct sockaddr_in*)addr)->sin_port);
+#ifdef HAVE_INET6
+      case AF_INET6:
+         return ntohs(((const struct sockaddr_in6*)addr)->sin6_port);
+#endif
+      default:
+         break;
+   }
+   return 0;
+}
+
+void netplay_udp_addr_set_port(struct sockaddr *addr, uint16_t port)
+{
+   switch (addr->sa_family)
+   {
+      case AF_INET:
+         ((struct sockaddr_in*)addr)->sin_port = htons(port);
+         break;
+#ifdef HAVE_INET6
+      case AF_INET6:
+         ((struct sockaddr_in6*)addr)->sin6_port = htons(port);
+         break;
+#endif
+      default:
+         break;
+   }
+}
+
+bool netplay_udp_addr_is_host(const struct sockaddr *addr,
+      const uint8_t *host)
+{
+   static const uint8_t v4_prefix[12] =
+      { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff };
+
+   switch (addr->sa_family)
+   {
+      case AF_INET:
+         return !memcmp(host, v4_prefix, sizeof(v4_prefix))
+            && !memcmp(host + 12,
+                  &((const struct sockaddr_in*)addr)->sin_addr, 4);
+#ifdef HAVE_INET6
+      case AF_INET6:
+         /* A dual-stack socket has IPv4 peers as ::ffff:a.b.c.d too. */
+         return !memcmp(host,
+               &((const struct sockaddr_in6*)addr)->sin6_addr, 16);
+#endif
+      default:
+         break;
+   }
+   return false;
+}
+
+static void netplay_udp_key_init(void)
+{
+   struct sha256_state s;
+   uint8_t           seed[32];
+   size_t            seed_len = 0;
+   retro_time_t      usec     = cpu_features_get_time_usec();
+   retro_perf_tick_t tick     = cpu_features_get_perf_counter();
+   time_t            now      = time(NULL);
+   void             *heap     = malloc(1);
+   uintptr_t         where[3];
+#ifndef _WIN32
+   FILE             *f        = fopen("/dev/urandom", "rb");
+
+   if (f)
+   {
+      seed_len = fread(seed, 1, sizeof(seed), f);
+      fclose(f);
+   }
+#endif
+
+   where[0] = (uintptr_t)heap;
+   where[1] = (uintptr_t)&s;
+   where[2] = (uintptr_t)netplay_udp_key;
+
+   sha256_stream_init(&s, 0);
+   sha256_stream_update(&s, seed, seed_len);
+   sha256_stream_update(&s, (const uint8_t*)&usec, sizeof(usec));
+   sha256_stream_update(&s, (const uint8_t*)&tick, sizeof(tick));
+   sha256_stream_update(&s, (const uint8_t*)&now,  sizeof(now));
+   sha256_stream_update(&s, (const uint8_t*)where, sizeof(where));
+   sha256_stream_final(&s, netplay_udp_key);
+
+   free(heap);
+   netplay_udp_keyed = true;
+}
+
+uint32_t netplay_udp_token(void)
+{
+   uint32_t token = 0;
+
+   if (!netplay_udp_keyed)
+      netplay_udp_key_init();
+
+   while (!token)
+   {
+      struct sha256_state s;
+      uint8_t      digest[32];
+      retro_time_t usec = cpu_features_get_time_usec();
+
+      netplay_udp_tokens++;
+      sha256_stream_init(&s, 0);
+      sha256_stream_update(&s, netplay_udp_key, sizeof(netplay_udp_key));
+      sha256_stream_update(&s, (const uint8_t*)&netplay_udp_tokens,
+            sizeof(netplay_udp_tokens));
+      sha256_stream_update(&s, (const uint8_t*)&usec, sizeof(usec));
+      sha256_stream_final(&s, digest);
+
+      token = ((uint32_t)digest[0] << 24) | ((uint32_t)digest[1] << 16)
+            | ((uint32_t)digest[2] <<  8) |  (uint32_t)digest[3];
+   }
+   return token;
+}
+
+void netplay_udp_send(int fd, const void *buf, size_t len,
+      const struct sockaddr *to, socklen_t tolen)
+{
+   if (netplay_udp_drop && netplay_udp_drop(netplay_udp_drop_data, buf, len))
+      return;
+
+   if (to)
+      sendto(fd, (const char*)buf, len, 0, to, tolen);
+   else
+      send(fd, (const char*)buf, len, 0);
+}
+
+ssize_t netplay_udp_recv(int fd, void *buf, size_t size,
+      struct sockaddr_storage *from, socklen_t *fromlen)
+{
+   ssize_t ret;
+
+   if (from)
+   {
+      *fromlen = sizeof(*from);
+      ret      = recvfrom(fd, (char*)buf, size, 0,
+            (struct sockaddr*)from, fromlen);
+   }
+   else
+      ret      = recv(fd, (char*)buf, size, 0);
+
+   /* An ICMP unreachable from a peer that went away shows up here as
+    * an error on some systems; either way there is nothing to read. */
+   return ret < 0 ? -1 : ret;
+}
+
+void netplay_udp_set_drop(netplay_udp_drop_t drop, void *userdata)
+{
+   netplay_udp_drop      = drop;
+   netplay_udp_drop_data = userdata;
+}
+
+bool netplay_udp_drop_random(void *userdata, const void *buf, size_t len)
+{
+   struct netplay_udp_loss *loss = (struct netplay_udp_loss*)userdata;
+
+   /* xorshift32; never seeded with 0, where it would stick. */
+   if (!loss->seed)
+      loss->seed = 1;
+   loss->seed ^= loss->seed << 13;
+   loss->seed ^= loss->seed >> 17;
+   loss->seed ^= loss->seed << 5;
+   return loss->seed % 100 < loss->percent;
+}
@@ -0,0 +1,144 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RARCH_NETPLAY_UDP_H
+#define __RARCH_NETPLAY_UDP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+#include <net/net_compat.h>
+
+RETRO_BEGIN_DECLS
+
+/* The UDP side channel for netplay input.
+ *
+ * Every datagram carries one player's input for the last few frames,
+ * oldest first, so a lost datagram is made good by the next one
+ * instead of holding up every frame behind it the way a lost TCP
+ * segment does.  TCP still carries everything - input included - and
+ * the receiver drops whichever copy of a frame comes second, so the
+ * channel only ever makes input arrive sooner; it is never the only
+ * way it arrives.
+ *
+ * A datagram is NETPLAY_UDP_HEADER_WORDS network-order words:
+ *    magic, token, player, first frame, frame count, words per frame
+ * followed by frame count * words per frame words of input, laid out
+ * as NETPLAY_CMD_INPUT lays out one frame's.  A frame count of 0 is
+ * a keepalive: it tells the host where to reach a peer with nothing
+ * to send. */
+
+#define NETPLAY_UDP_MAGIC         0x52414955 /* RAIU */
+#define NETPLAY_UDP_HEADER_WORDS  6
+
+/* Frames of input per datagram, at most. */
+#define NETPLAY_UDP_REDUNDANCY    8
+
+/* The host's channel is on its TCP port plus this, where it can be:
+ * the TCP port's own number is LAN discovery's for UDP. */
+#define NETPLAY_UDP_PORT_OFFSET   1
+
+/* How often, in frames, a client with no input of its own to send
+ * sends a keepalive instead. */
+#define NETPLAY_UDP_KEEPALIVE_FRAMES 60
+
+/* Datagrams stay under any path's MTU: a player with more input than
+ * fits NETPLAY_UDP_REDUNDANCY frames sends fewer. */
+#define NETPLAY_UDP_MAX_SIZE      512
+#define NETPLAY_UDP_MAX_WORDS     (NETPLAY_UDP_MAX_SIZE / 4)
+
+struct netplay_udp_input
+{
+   const uint32_t *data;  /* count * words words, network order */
+   uint32_t token;
+   uint32_t client_num;
+   uint32_t frame;        /* the first, oldest, frame */
+   uint32_t count;
+   uint32_t words;
+};
+
+/* Writes @in's header to the start of @out; the caller has already
+ * put count * words words of input after it.
+ *
+ * Returns: the datagram's size in bytes. */
+size_t netplay_udp_input_pack(uint32_t *out,
+      const struct netplay_udp_input *in);
+
+/* Checks a datagram of @len bytes and points @out at its parts.
+ *
+ * Returns: false if it is not one of ours or is cut short. */
+bool netplay_udp_input_parse(const uint32_t *buf, size_t len,
+      struct netplay_udp_input *out);
+
+/* A socket for the channel, non-blocking: bound to @addr for the
+ * host, connected to it for a client.  -1 on failure. */
+int netplay_udp_open(const struct sockaddr *addr, socklen_t addrlen,
+      bool is_server);
+
+/* The port of an AF_INET or AF_INET6 address, host order; 0 for any
+ * other family. */
+uint16_t netplay_udp_addr_port(const struct sockaddr *addr);
+
+void netplay_udp_addr_set_port(struct sockaddr *addr, uint16_t port);
+
+/* Whether @addr, an AF_INET or AF_INET6 address, is on @host: 16
+ * bytes, an IPv4 host as ::ffff:a.b.c.d, the way netplay_address_t
+ * holds one.  Ports are not compared. */
+bool netplay_udp_addr_is_host(const struct sockaddr *addr,
+      const uint8_t *host);
+
+/* A token for a new connection's channel, never 0.
+ *
+ * The token is sent in the clear on every datagram, so it only has to
+ * be unguessable before a peer has seen it: each is SHA-256 over a
+ * process-wide key and a count.  The key is read from /dev/urandom
+ * where there is one, mixed with timers and addresses ASLR moves, and
+ * is never sent anywhere - unlike the salts, whose time-seeded
+ * generator a peer can wind forward from the one it was sent. */
+uint32_t netplay_udp_token(void);
+
+/* Sends a datagram, to @to - or, for NULL, where the socket is
+ * connected.  Losing one is not an error. */
+void netplay_udp_send(int fd, const void *buf, size_t len,
+      const struct sockaddr *to, socklen_t tolen);
+
+/* Receives one datagram, with its sender when @from is given.
+ *
+ * Returns: its size, or -1 when there is none waiting. */
+ssize_t netplay_udp_recv(int fd, void *buf, size_t size,
+      struct sockaddr_storage *from, socklen_t *fromlen);
+
+/* Loss shim, for exercising the channel over loopback: when set,
+ * every datagram netplay_udp_send is about to send is offered to
+ * @drop first, and goes nowhere if it returns true. */
+typedef bool (*netplay_udp_drop_t)(void *userdata, const void *buf,
+      size_t len);
+
+void netplay_udp_set_drop(netplay_udp_drop_t drop, void *userdata);
+
+/* A ready-made shim: drops @percent in a hundred datagrams, picked by
+ * a generator seeded with @seed, so a run can be repeated. */
+struct netplay_udp_loss
+{
+   uint32_t percent;
+   uint32_t seed;
+};
+
+bool netplay_udp_drop_random(void *userdata, const void *buf, size_t len);
+
+RETRO_END_DECLS
+
+#endif
@@ -19,6 +19,17 @@
 #include <string.h>
 #include <ctype.h>
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef HAVE_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 #include <libretro.h>
 #include <boolean.h>
 #include <retro_miscellaneous.h>
@@ -32,6 +43,8 @@
 #include <formats/rjson.h>
 #include <formats/rjson_stream.h>
 #include <array/rbuf.h>
+#include <array/rhmap.h>
+#include <encodings/crc32.h>
 
 #include "playlist.h"
 #include "verbosity.h"
@@ -71,7 +84,12 @@ enum content_playlist_flags
    CNT_PLAYLIST_FLG_MOD        = (1 << 0),
    CNT_PLAYLIST_FLG_OLD_FMT    = (1 << 1),
    CNT_PLAYLIST_FLG_COMPRESSED = (1 << 2),
-   CNT_PLAYLIST_FLG_CACHED_EXT = (1 << 3)
+   CNT_PLAYLIST_FLG_CACHED_EXT = (1 << 3),
+   /* image is a mapping rather than a heap block */
+   CNT_PLAYLIST_FLG_IMAGE_MAP  = (1 << 4),
+   /* changed in a way the journal cannot record */
+   CNT_PLAYLIST_FLG_REWRITE    = (1 << 5),
+   CNT_PLAYLIST_FLG_JOURNALED  = (1 << 6)
 };
 
 struct content_playlist
@@ -99,6 +117,20 @@ struct content_playlist
     * the cache explicitly. */
    int64_t file_size;
 
+   /* Binary cache this playlist was read from, if it was.  Entry
+    * strings point into it until they are replaced; see
+    * playlist_free_str(). */
+   const uint8_t *image;
+   size_t image_len;
+
+   /* Changes recorded since the last write, the length of the journal
+    * on disk that this playlist already reflects, and the stamp of
+    * the file that journal applies to; see playlist_journal_append(). */
+   uint8_t *journal;
+   int64_t journal_size;
+   int64_t journal_base_size;
+   int64_t journal_base_mtime;
+
    uint8_t flags;
 };
 
@@ -616,37 +648,52 @@ void playlist_get_index(playlist_t *playlist,
    *entry = &playlist->entries[idx];
 }
 
+/* Entry strings read from the binary cache point into its image,
+ * which is released with the playlist; only strings set since then
+ * are the entry's own. */
+static void playlist_free_str(const playlist_t *playlist, char *s)
+{
+   if (     playlist
+         && playlist->image
+         && (const uint8_t*)s >= playlist->image
+         && (const uint8_t*)s <  playlist->image + playlist->image_len)
+      return;
+   free(s);
+}
+
 /**
  * playlist_free_entry:
+ * @playlist            : Playlist the entry belongs to.
  * @entry               : Playlist entry handle.
  *
  * Frees playlist entry.
  **/
-static void playlist_free_entry(struct playlist_entry *entry)
+static void playlist_free_entry(const playlist_t *playlist,
+      struct playlist_entry *entry)
 {
    if (!entry)
       return;
 
    if (entry->path)
-      free(entry->path);
+      playlist_free_str(playlist, entry->path);
    if (entry->label)
-      free(entry->label);
+      playlist_free_str(playlist, entry->label);
    if (entry->core_path)
-      free(entry->core_path);
+      playlist_free_str(playlist, entry->core_path);
    if (entry->core_name)
-      free(entry->core_name);
+      playlist_free_str(playlist, entry->core_name);
    if (entry->db_name)
-      free(entry->db_name);
+      playlist_free_str(playlist, entry->db_name);
    if (entry->crc32)
-      free(entry->crc32);
+      playlist_free_str(playlist, entry->crc32);
    if (entry->subsystem_ident)
-      free(entry->subsystem_ident);
+      playlist_free_str(playlist, entry->subsystem_ident);
    if (entry->subsystem_name)
-      free(entry->subsystem_name);
+      playlist_free_str(playlist, entry->subsystem_name);
    if (entry->runtime_str)
-      free(entry->runtime_str);
+      playlist_free_str(playlist, entry->runtime_str);
    if (entry->last_played_str)
-      free(entry->last_played_str);
+      playlist_free_str(playlist, entry->last_played_str);
    if (entry->subsystem_roms)
       string_list_free(entry->subsystem_roms);
    if (entry->path_id)
@@ -677,6 +724,496 @@ static void playlist_free_entry(struct playlist_entry *entry)
    entry->last_played_second = 0;
 }
 
+static void playlist_cached_after_write(playlist_t *written);
+
+/* ------------------------------------------------------------------ */
+/* Journal                                                             */
+/*                                                                     */
+/* A playlist opted in with playlist_set_journaled() - the history and */
+/* favourites, which change on every content launch - does not         */
+/* rewrite its .lpl for each change.  Entry changes are recorded as    */
+/* they are made and playlist_write_file() appends them to a log       */
+/* beside the .lpl, which the next read replays over it: a write       */
+/* costs the size of the change rather than of the playlist.           */
+/*                                                                     */
+/* The log is folded back into the .lpl - a whole-file write, which    */
+/* deletes it - once it outgrows PLAYLIST_JOURNAL_MAX_SIZE or half the */
+/* .lpl, by playlist_compact() on the way out, by any write from a     */
+/* playlist that is not journaled, and after any change the log cannot */
+/* express: header fields, sorting, clearing, autofix.                 */
+/*                                                                     */
+/* It is stamped with the size and modification time of the .lpl it   */
+/* applies to and ignored once that has changed.  Each record carries  */
+/* a CRC, so a write cut short leaves a torn tail the replay stops at  */
+/* and the next append overwrites.  Native byte order, u32 fields:     */
+/*                                                                     */
+/*   header : "RAPJ" version byte-order-mark, i64 size, i64 mtime      */
+/*   record : body length, crc32 of body, body                         */
+/*   body   : op, index, and for INSERT and SET an entry:              */
+/*            entry_slot, str path, label, core_path, core_name,       */
+/*            crc32, db_name, subsystem_ident, subsystem_name,         */
+/*            rom count, str x count                                   */
+/*   str    : length + 1 (0 for NULL), bytes without the NUL           */
+/*                                                                     */
+/* An entry is recorded as the .lpl would store it, empty strings and  */
+/* unsaved fields dropped, so a replayed playlist is the one a         */
+/* whole-file write would have read back.                              */
+/* ------------------------------------------------------------------ */
+
+#define PLAYLIST_JOURNAL_EXT        "log"
+#define PLAYLIST_JOURNAL_MAGIC      "RAPJ"
+#define PLAYLIST_JOURNAL_VERSION    1
+#define PLAYLIST_JOURNAL_BOM        0x01020304
+#define PLAYLIST_JOURNAL_HEADER_LEN 28
+/* A smaller playlist is rewritten whole: that is cheap enough, and
+ * leaves one file fewer. */
+#define PLAYLIST_JOURNAL_MIN_FILE   (16 * 1024)
+#define PLAYLIST_JOURNAL_MAX_SIZE   (64 * 1024)
+
+enum playlist_journal_op
+{
+   PLAYLIST_JOURNAL_INSERT = 1,
+   PLAYLIST_JOURNAL_SET,
+   PLAYLIST_JOURNAL_DELETE,
+   PLAYLIST_JOURNAL_TO_FRONT
+};
+
+void playlist_get_journal_path(const char *path, char *s, size_t len)
+{
+   fill_pathname_join_delim(s, path, PLAYLIST_JOURNAL_EXT, '.', len);
+}
+
+static void playlist_journal_path(const playlist_t *playlist,
+      char *s, size_t len)
+{
+   playlist_get_journal_path(playlist->config.path, s, len);
+}
+
+static void playlist_journal_put(playlist_t *playlist,
+      const void *data, size_t len)
+{
+   size_t at = RBUF_LEN(playlist->journal);
+   RBUF_RESIZE(playlist->journal, at + len);
+   if (RBUF_LEN(playlist->journal) != at + len)
+   {
+      /* Out of memory: the next write goes whole instead. */
+      playlist->flags |= CNT_PLAYLIST_FLG_REWRITE;
+      return;
+   }
+   memcpy(playlist->journal + at, data, len);
+}
+
+static void playlist_journal_put_u32(playlist_t *playlist, uint32_t v)
+{
+   playlist_journal_put(playlist, &v, sizeof(v));
+}
+
+static void playlist_journal_put_str(playlist_t *playlist, const char *s)
+{
+   uint32_t _len = (s && *s) ? (uint32_t)strlen(s) : 0;
+   playlist_journal_put_u32(playlist, _len ? _len + 1 : 0);
+   if (_len)
+      playlist_journal_put(playlist, s, _len);
+}
+
+/* Records a change just made to @playlist: the entry now at @idx was
+ * inserted or changed, or the one that was there deleted or moved to
+ * the front. */
+static void playlist_journal_record(playlist_t *playlist,
+      enum playlist_journal_op op, size_t idx)
+{
+   size_t start;
+   uint32_t body_len, crc;
+
+   if (     !(playlist->flags & CNT_PLAYLIST_FLG_JOURNALED)
+         ||  (playlist->flags & CNT_PLAYLIST_FLG_REWRITE))
+      return;
+
+   start = RBUF_LEN(playlist->journal);
+   playlist_journal_put_u32(playlist, 0);   /* length, */
+   playlist_journal_put_u32(playlist, 0);   /* crc: filled in below */
+   playlist_journal_put_u32(playlist, (uint32_t)op);
+   playlist_journal_put_u32(playlist, (uint32_t)idx);
+
+   if (op == PLAYLIST_JOURNAL_INSERT || op == PLAYLIST_JOURNAL_SET)
+   {
+      size_t i;
+      uint32_t roms                      = 0;
+      const struct playlist_entry *entry = &playlist->entries[idx];
+
+      /* As playlist_write_file() stores it. */
+      playlist_journal_put_u32(playlist,
+               ((int)entry->entry_slot > 0
+            && !strstr(playlist->config.path, FILE_PATH_BUILTIN))
+            ? entry->entry_slot : 0);
+      playlist_journal_put_str(playlist, entry->path);
+      playlist_journal_put_str(playlist, entry->label);
+      playlist_journal_put_str(playlist, entry->core_path);
+      playlist_journal_put_str(playlist, entry->core_name);
+      playlist_journal_put_str(playlist, entry->crc32);
+      playlist_journal_put_str(playlist, entry->db_name);
+      playlist_journal_put_str(playlist, entry->subsystem_ident);
+      playlist_journal_put_str(playlist, entry->subsystem_name);
+
+      /* The reader skips empty rom paths. */
+      if (entry->subsystem_roms)
+         for (i = 0; i < entry->subsystem_roms->size; i++)
+            if (     entry->subsystem_roms->elems[i].data
+                  && *entry->subsystem_roms->elems[i].data)
+               roms++;
+      playlist_journal_put_u32(playlist, roms);
+      if (roms)
+         for (i = 0; i < entry->subsystem_roms->size; i++)
+            if (     entry->subsystem_roms->elems[i].data
+                  && *entry->subsystem_roms->elems[i].data)
+               playlist_journal_put_str(playlist,
+                     entry->subsystem_roms->elems[i].data);
+   }
+
+   if (playlist->flags & CNT_PLAYLIST_FLG_REWRITE)
+      return;
+
+   body_len = (uint32_t)(RBUF_LEN(playlist->journal) - start - 8);
+   crc      = encoding_crc32(0, playlist->journal + start + 8, body_len);
+   memcpy(playlist->journal + start,     &body_len, sizeof(body_len));
+   memcpy(playlist->journal + start + 4, &crc,      sizeof(crc));
+}
+
+/* Writes the recorded changes out by appending them to the log.  False
+ * when this write has to go whole instead, with nothing on disk
+ * changed. */
+static bool playlist_journal_append(playlist_t *playlist)
+{
+   RFILE *file;
+   int64_t size, mtime, limit;
+   int64_t end;
+   bool ok;
+   size_t pending = RBUF_LEN(playlist->journal);
+   char path[PATH_MAX_LENGTH];
+
+   if (     !(playlist->flags & CNT_PLAYLIST_FLG_JOURNALED)
+         ||  (playlist->flags & (CNT_PLAYLIST_FLG_REWRITE
+                               | CNT_PLAYLIST_FLG_OLD_FMT))
+         ||  playlist->config.old_format
+         ||  playlist->journal_base_size < PLAYLIST_JOURNAL_MIN_FILE)
+      return false;
+
+   limit = playlist->journal_base_size / 2;
+   if (limit > PLAYLIST_JOURNAL_MAX_SIZE)
+      limit = PLAYLIST_JOURNAL_MAX_SIZE;
+   end   = (playlist->journal_size
+         ? playlist->journal_size : PLAYLIST_JOURNAL_HEADER_LEN)
+         + (int64_t)pending;
+   if (end > limit)
+      return false;
+
+   /* Anything else writing the .lpl since it was read leaves the
+    * records describing changes to a file that is no longer there. */
+   if (     !path_get_size_and_mtime(playlist->config.path, &size, &mtime)
+         || size  != playlist->journal_base_size
+         || mtime != playlist->journal_base_mtime)
+      return false;
+
+   playlist_journal_path(playlist, path, sizeof(path));
+   if (playlist->journal_size)
+   {
+      /* ... and the same goes for the log. */
+      if (path_get_size(path) < playlist->journal_size)
+         return false;
+      file = filestream_open(path,
+            RETRO_VFS_FILE_ACCESS_READ_WRITE
+          | RETRO_VFS_FILE_ACCESS_UPDATE_EXISTING,
+            RETRO_VFS_FILE_ACCESS_HINT_NONE);
+      ok   = file && filestream_seek(file, playlist->journal_size,
+            RETRO_VFS_SEEK_POSITION_START) == 0;
+   }
+   else
+   {
+      uint8_t header[PLAYLIST_JOURNAL_HEADER_LEN];
+      uint32_t version = PLAYLIST_JOURNAL_VERSION;
+      uint32_t bom     = PLAYLIST_JOURNAL_BOM;
+
+      memcpy(header,      PLAYLIST_JOURNAL_MAGIC, 4);
+      memcpy(header + 4,  &version,               4);
+      memcpy(header + 8,  &bom,                   4);
+      memcpy(header + 12, &size,                  8);
+      memcpy(header + 20, &mtime,                 8);
+      file = filestream_open(path,
+            RETRO_VFS_FILE_ACCESS_WRITE,
+            RETRO_VFS_FILE_ACCESS_HINT_NONE);
+      ok   = file && filestream_write(file, header, sizeof(header))
+            == (int64_t)sizeof(header);
+   }
+
+   if (!file)
+      return false;
+
+   ok = ok
+      && (!pending || filestream_write(file, playlist->journal,
+            (int64_t)pending) == (int64_t)pending)
+      && filestream_flush(file) == 0
+      /* Drops what is left of a torn record from an earlier run. */
+      && filestream_truncate(file, end) == 0;
+   filestream_close(file);
+
+   if (!ok)
+   {
+      RARCH_WARN("[Playlist] Failed to append to journal: \"%s\".\n", path);
+      return false;
+   }
+
+   RARCH_LOG("[Playlist] Appended to journal: \"%s\".\n", path);
+   playlist->journal_size = end;
+   playlist->flags       &= ~CNT_PLAYLIST_FLG_MOD;
+   RBUF_CLEAR(playlist->journal);
+   playlist_cached_after_write(playlist);
+   return true;
+}
+
+/* The .lpl has just been written whole, with everything in the log
+ * folded in. */
+static void playlist_journal_reset(playlist_t *playlist)
+{
+   char path[PATH_MAX_LENGTH];
+
+   playlist_journal_path(playlist, path, sizeof(path));
+   if (path_is_valid(path))
+      filestream_delete(path);
+   RBUF_CLEAR(playlist->journal);
+   playlist->journal_size = 0;
+   playlist->flags       &= ~CNT_PLAYLIST_FLG_REWRITE;
+   if (!path_get_size_and_mtime(playlist->config.path,
+            &playlist->journal_base_size, &playlist->journal_base_mtime))
+      playlist->journal_base_size = -1;
+}
+
+typedef struct
+{
+   const uint8_t *data;
+   size_t len;
+   size_t pos;
+   bool ok;
+} playlist_journal_reader_t;
+
+static uint32_t playlist_journal_get_u32(playlist_journal_reader_t *r)
+{
+   uint32_t v = 0;
+   if (r->len - r->pos < sizeof(v))
+   {
+      r->ok = false;
+      return 0;
+   }
+   memcpy(&v, r->data + r->pos, sizeof(v));
+   r->pos += sizeof(v);
+   return v;
+}
+
+static char *playlist_journal_get_str(playlist_journal_reader_t *r)
+{
+   char *s;
+   uint32_t _len = playlist_journal_get_u32(r);
+
+   if (!_len-- || !r->ok)
+      return NULL;
+   if (r->len - r->pos < _len || !(s = (char*)malloc(_len + 1)))
+   {
+      r->ok = false;
+      return NULL;
+   }
+   memcpy(s, r->data + r->pos, _len);
+   s[_len]  = '\0';
+   r->pos  += _len;
+   return s;
+}
+
+static void playlist_journal_get_entry(playlist_journal_reader_t *r,
+      struct playlist_entry *entry)
+{
+   uint32_t i, roms;
+
+   memset(entry, 0, sizeof(*entry));
+   entry->runtime_status  = PLAYLIST_RUNTIME_UNKNOWN;
+   entry->entry_slot      = playlist_journal_get_u32(r);
+   entry->path            = playlist_journal_get_str(r);
+   entry->label           = playlist_journal_get_str(r);
+   entry->core_path       = playlist_journal_get_str(r);
+   entry->core_name       = playlist_journal_get_str(r);
+   entry->crc32           = playlist_journal_get_str(r);
+   entry->db_name         = playlist_journal_get_str(r);
+   entry->subsystem_ident = playlist_journal_get_str(r);
+   entry->subsystem_name  = playlist_journal_get_str(r);
+
+   if (     !(roms = playlist_journal_get_u32(r))
+         || !r->ok)
+      return;
+   if (!(entry->subsystem_roms = string_list_new()))
+   {
+      r->ok = false;
+      return;
+   }
+   for (i = 0; i < roms && r->ok; i++)
+   {
+      union string_list_elem_attr attr;
+      char *s = playlist_journal_get_str(r);
+      attr.i  = 0;
+      if (!s || !string_list_append(entry->subsystem_roms, s, attr))
+         r->ok = false;
+      free(s);
+   }
+}
+
+/* Applies one record.  False for a record that does not fit the
+ * playlist it is applied to; the replay stops there. */
+static bool playlist_journal_apply(playlist_t *playlist,
+      const uint8_t *body, size_t len)
+{
+   struct playlist_entry entry;
+   playlist_journal_reader_t r;
+   uint32_t op, idx;
+   size_t _len = RBUF_LEN(playlist->entries);
+
+   r.data = body;
+   r.len  = len;
+   r.pos  = 0;
+   r.ok   = true;
+   op     = playlist_journal_get_u32(&r);
+   idx    = playlist_journal_get_u32(&r);
+   if (!r.ok)
+      return false;
+
+   switch (op)
+   {
+      case PLAYLIST_JOURNAL_INSERT:
+      case PLAYLIST_JOURNAL_SET:
+         if (idx > _len || (op == PLAYLIST_JOURNAL_SET && idx == _len))
+            return false;
+         playlist_journal_get_entry(&r, &entry);
+         if (!r.ok || r.pos != len)
+         {
+            playlist_free_entry(playlist, &entry);
+            return false;
+         }
+         if (op == PLAYLIST_JOURNAL_SET)
+         {
+            playlist_free_entry(playlist, &playlist->entries[idx]);
+            playlist->entries[idx] = entry;
+            return true;
+         }
+         /* A reader with a smaller capacity than the writer keeps the
+          * same prefix a whole-file read would. */
+         if (_len >= playlist->config.capacity)
+         {
+            if (idx >= playlist->config.capacity)
+            {
+               playlist_free_entry(playlist, &entry);
+               return true;
+            }
+            playlist_free_entry(playlist, &playlist->entries[--_len]);
+            RBUF_RESIZE(playlist->entries, _len);
+         }
+         RBUF_RESIZE(playlist->entries, _len + 1);
+         if (RBUF_LEN(playlist->entries) != _len + 1)
+         {
+            playlist_free_entry(playlist, &entry);
+            return false;
+         }
+         memmove(playlist->entries + idx + 1, playlist->entries + idx,
+               (_len - idx) * sizeof(struct playlist_entry));
+         playlist->entries[idx] = entry;
+         return true;
+      case PLAYLIST_JOURNAL_DELETE:
+         if (idx >= _len || r.pos != len)
+            return false;
+         playlist_free_entry(playlist, &playlist->entries[idx]);
+         memmove(playlist->entries + idx, playlist->entries + idx + 1,
+               (_len - 1 - idx) * sizeof(struct playlist_entry));
+         RBUF_RESIZE(playlist->entries, _len - 1);
+         return true;
+      case PLAYLIST_JOURNAL_TO_FRONT:
+         if (idx >= _len || r.pos != len)
+            return false;
+         entry = playlist->entries[idx];
+         memmove(playlist->entries + 1, playlist->entries,
+               idx * sizeof(struct playlist_entry));
+         playlist->entries[0] = entry;
+         return true;
+      default:
+         break;
+   }
+   return false;
+}
+
+/* Replays the log, if there is one for the .lpl just read, whose size
+ * and modification time are @size and @mtime. */
+static void playlist_journal_replay(playlist_t *playlist,
+      int64_t size, int64_t mtime)
+{
+   size_t pos;
+   uint32_t v;
+   int64_t i64;
+   void *buf             = NULL;
+   int64_t len           = 0;
+   const uint8_t *data   = NULL;
+   char path[PATH_MAX_LENGTH];
+
+   playlist->journal_base_size  = size;
+   playlist->journal_base_mtime = mtime;
+
+   playlist_journal_path(playlist, path, sizeof(path));
+   if (     !path_is_valid(path)
+         || !filestream_read_file(path, &buf, &len)
+         || len < PLAYLIST_JOURNAL_HEADER_LEN)
+      goto end;
+
+   data = (const uint8_t*)buf;
+   if (memcmp(data, PLAYLIST_JOURNAL_MAGIC, 4))
+      goto end;
+   memcpy(&v, data + 4, 4);
+   if (v != PLAYLIST_JOURNAL_VERSION)
+      goto end;
+   memcpy(&v, data + 8, 4);
+   if (v != PLAYLIST_JOURNAL_BOM)
+      goto end;
+   memcpy(&i64, data + 12, 8);
+   if (i64 != size)
+      goto end;
+   memcpy(&i64, data + 20, 8);
+   if (i64 != mtime)
+      goto end;
+
+   for (pos = PLAYLIST_JOURNAL_HEADER_LEN; (int64_t)pos + 8 <= len; )
+   {
+      uint32_t body_len, crc;
+      memcpy(&body_len, data + pos,     4);
+      memcpy(&crc,      data + pos + 4, 4);
+      if (     body_len > (uint64_t)len - pos - 8
+            || encoding_crc32(0, data + pos + 8, body_len) != crc
+            || !playlist_journal_apply(playlist, data + pos + 8, body_len))
+         break;
+      pos += 8 + body_len;
+   }
+   playlist->journal_size = (int64_t)pos;
+
+end:
+   free(buf);
+}
+
+void playlist_set_journaled(playlist_t *playlist)
+{
+   if (playlist)
+      playlist->flags |= CNT_PLAYLIST_FLG_JOURNALED;
+}
+
+void playlist_compact(playlist_t *playlist)
+{
+   if (!playlist)
+      return;
+   if (playlist->journal_size > 0)
+      playlist->flags |= CNT_PLAYLIST_FLG_MOD;
+   playlist->flags    |= CNT_PLAYLIST_FLG_REWRITE;
+   playlist_write_file(playlist);
+}
+
 /**
  * playlist_delete_index:
  * @playlist            : Playlist handle.
@@ -700,7 +1237,7 @@ void playlist_delete_index(playlist_t *playlist,
    /* Free unwanted entry */
    entry_to_delete = (struct playlist_entry *)(playlist->entries + idx);
    if (entry_to_delete)
-      playlist_free_entry(entry_to_delete);
+      playlist_free_entry(playlist, entry_to_delete);
 
    /* Shift remaining entries to fill the gap */
    memmove(playlist->entries + idx, playlist->entries + idx + 1,
@@ -709,6 +1246,7 @@ void playlist_delete_index(playlist_t *playlist,
    RBUF_RESIZE(playlist->entries, _len - 1);
 
    playlist->flags |= CNT_PLAYLIST_FLG_MOD;
+   playlist_journal_record(playlist, PLAYLIST_JOURNAL_DELETE, idx);
 }
 
 /**
@@ -743,7 +1281,9 @@ void playlist_delete_by_path(playlist_t *playlist,
             &playlist->entries[i], &playlist->config))
       {
          /* Free the matching entry */
-         playlist_free_entry(&playlist->entries[i]);
+         playlist_free_entry(playlist, &playlist->entries[i]);
+         playlist_journal_record(playlist, PLAYLIST_JOURNAL_DELETE,
+               write_idx);
          deleted_any = true;
          continue;
       }
@@ -1100,7 +1640,7 @@ void playlist_update(playlist_t *playlist, size_t idx,
    if (update_entry->path && (update_entry->path != entry->path))
    {
       if (entry->path)
-         free(entry->path);
+         playlist_free_str(playlist, entry->path);
       entry->path        = strdup(update_entry->path);
 
       if (entry->path_id)
@@ -1115,7 +1655,7 @@ void playlist_update(playlist_t *playlist, size_t idx,
    if (update_entry->label && (update_entry->label != entry->label))
    {
       if (entry->label)
-         free(entry->label);
+         playlist_free_str(playlist, entry->label);
       entry->label       = strdup(update_entry->label);
       playlist->flags   |= CNT_PLAYLIST_FLG_MOD;
    }
@@ -1123,7 +1663,7 @@ void playlist_update(playlist_t *playlist, size_t idx,
    if (update_entry->core_path && (update_entry->core_path != entry->core_path))
    {
       if (entry->core_path)
-         free(entry->core_path);
+         playlist_free_str(playlist, entry->core_path);
       entry->core_path   = strdup(update_entry->core_path);
       playlist->flags   |= CNT_PLAYLIST_FLG_MOD;
    }
@@ -1131,7 +1671,7 @@ void playlist_update(playlist_t *playlist, size_t idx,
    if (update_entry->core_name && (update_entry->core_name != entry->core_name))
    {
       if (entry->core_name)
-         free(entry->core_name);
+         playlist_free_str(playlist, entry->core_name);
       entry->core_name   = strdup(update_entry->core_name);
       playlist->flags   |= CNT_PLAYLIST_FLG_MOD;
    }
@@ -1139,7 +1679,7 @@ void playlist_update(playlist_t *playlist, size_t idx,
    if (update_entry->db_name && (update_entry->db_name != entry->db_name))
    {
       if (entry->db_name)
-         free(entry->db_name);
+         playlist_free_str(playlist, entry->db_name);
       entry->db_name     = strdup(update_entry->db_name);
       playlist->flags   |= CNT_PLAYLIST_FLG_MOD;
    }
@@ -1147,10 +1687,12 @@ void playlist_update(playlist_t *playlist, size_t idx,
    if (update_entry->crc32 && (update_entry->crc32 != entry->crc32))
    {
       if (entry->crc32)
-         free(entry->crc32);
+         playlist_free_str(playlist, entry->crc32);
       entry->crc32       = strdup(update_entry->crc32);
       playlist->flags   |= CNT_PLAYLIST_FLG_MOD;
    }
+
+   playlist_journal_record(playlist, PLAYLIST_JOURNAL_SET, idx);
 }
 
 void playlist_update_runtime(playlist_t *playlist, size_t idx,
@@ -1167,7 +1709,7 @@ void playlist_update_runtime(playlist_t *playlist, size_t idx,
    if (update_entry->path && (update_entry->path != entry->path))
    {
       if (entry->path)
-         free(entry->path);
+         playlist_free_str(playlist, entry->path);
       entry->path        = strdup(update_entry->path);
 
       if (entry->path_id)
@@ -1183,7 +1725,7 @@ void playlist_update_runtime(playlist_t *playlist, size_t idx,
    if (update_entry->core_path && (update_entry->core_path != entry->core_path))
    {
       if (entry->core_path)
-         free(entry->core_path);
+         playlist_free_str(playlist, entry->core_path);
       entry->core_path      = strdup(update_entry->core_path);
       if (register_update)
          playlist->flags   |= CNT_PLAYLIST_FLG_MOD;
@@ -1262,7 +1804,7 @@ void playlist_update_runtime(playlist_t *playlist, size_t idx,
    if (update_entry->runtime_str && (update_entry->runtime_str != entry->runtime_str))
    {
       if (entry->runtime_str)
-         free(entry->runtime_str);
+         playlist_free_str(playlist, entry->runtime_str);
       entry->runtime_str    = strdup(update_entry->runtime_str);
       if (register_update)
          playlist->flags   |= CNT_PLAYLIST_FLG_MOD;
@@ -1271,12 +1813,15 @@ void playlist_update_runtime(playlist_t *playlist, size_t idx,
    if (update_entry->last_played_str && (update_entry->last_played_str != entry->last_played_str))
    {
       if (entry->last_played_str)
-         free(entry->last_played_str);
+         playlist_free_str(playlist, entry->last_played_str);
       entry->last_played_str = NULL;
       entry->last_played_str = strdup(update_entry->last_played_str);
       if (register_update)
          playlist->flags    |= CNT_PLAYLIST_FLG_MOD;
    }
+
+   /* Of all this only the paths are saved, but those are. */
+   playlist_journal_record(playlist, PLAYLIST_JOURNAL_SET, idx);
 }
 
 bool playlist_push_runtime(playlist_t *playlist,
@@ -1350,7 +1895,7 @@ bool playlist_push_runtime(playlist_t *playlist,
    if (_len == playlist->config.capacity)
    {
       struct playlist_entry *last_entry = &playlist->entries[_len - 1];
-      playlist_free_entry(last_entry);
+      playlist_free_entry(playlist, last_entry);
       _len--;
    }
    else
@@ -1397,7 +1942,8 @@ bool playlist_push_runtime(playlist_t *playlist,
 success:
    if (path_id)
       playlist_path_id_free(path_id);
-   playlist->flags   |= CNT_PLAYLIST_FLG_MOD;
+   /* Runtime logs are not journaled. */
+   playlist->flags   |= CNT_PLAYLIST_FLG_MOD | CNT_PLAYLIST_FLG_REWRITE;
    return true;
 
 error:
@@ -1685,8 +2231,9 @@ static bool playlist_push_new_entry(playlist_t *playlist,
    if (_len == playlist->config.capacity)
    {
       struct playlist_entry *last_entry = &playlist->entries[_len - 1];
-      playlist_free_entry(last_entry);
+      playlist_free_entry(playlist, last_entry);
       _len--;
+      playlist_journal_record(playlist, PLAYLIST_JOURNAL_DELETE, _len);
    }
    else
    {
@@ -1754,6 +2301,8 @@ static bool playlist_push_new_entry(playlist_t *playlist,
          for (i = 0; i < entry->subsystem_roms->size; i++)
             string_list_append(playlist->entries[0].subsystem_roms, entry->subsystem_roms->elems[i].data, attributes);
       }
+
+      playlist_journal_record(playlist, PLAYLIST_JOURNAL_INSERT, 0);
    }
 
    playlist->flags   |= CNT_PLAYLIST_FLG_MOD;
@@ -1911,7 +2460,10 @@ bool playlist_push(playlist_t *playlist,
       if (i == 0)
       {
          if (entry_updated)
+         {
+            playlist_journal_record(playlist, PLAYLIST_JOURNAL_SET, 0);
             goto success;
+         }
 
          goto error;
       }
@@ -1922,6 +2474,10 @@ bool playlist_push(playlist_t *playlist,
             i * sizeof(struct playlist_entry));
       playlist->entries[0] = tmp;
 
+      playlist_journal_record(playlist, PLAYLIST_JOURNAL_TO_FRONT, i);
+      if (entry_updated)
+         playlist_journal_record(playlist, PLAYLIST_JOURNAL_SET, 0);
+
       goto success;
    }
 
@@ -2213,6 +2769,15 @@ void playlist_write_file(playlist_t *playlist)
           ))
       return;
 
+   /* A journaled playlist already in the requested format appends its
+    * changes rather than rewriting the file. */
+   if (     pl_old_fmt == playlist->config.old_format
+#if defined(HAVE_COMPRESSION)
+         && pl_compressed == playlist->config.compress
+#endif
+         && playlist_journal_append(playlist))
+      return;
+
    /* Write beside the target and move it into place at the end, rather
     * than truncating the real file and filling it in.  A crash, a power
     * loss or a full disk part way through a write would otherwise leave
@@ -2610,6 +3175,7 @@ end:
    {
       RARCH_LOG("[Playlist] Written to file: \"%s\".\n",
             playlist->config.path);
+      playlist_journal_reset(playlist);
       playlist_cached_after_write(playlist);
    }
    else
@@ -2620,6 +3186,555 @@ end:
    }
 }
 
+/* ------------------------------------------------------------------ */
+/* Binary cache                                                        */
+/*                                                                     */
+/* A large playlist is written out a second time, next to the .lpl,    */
+/* in a form that loads without parsing: a fixed header, one fixed     */
+/* record per entry and a string table the records refer to.  The     */
+/* file is mapped where HAVE_MMAP is available and read whole          */
+/* otherwise, and entry strings are used where they lie in it until    */
+/* something replaces them - loading is one pass filling in pointers,  */
+/* with nothing allocated per entry.                                   */
+/*                                                                     */
+/* It is stamped with the size and modification time of the .lpl it   */
+/* was made from and used only while both still match; the .lpl stays  */
+/* the playlist, and every write goes there.  Only a parse that        */
+/* reached the end of the document cleanly is cached, so a damaged     */
+/* .lpl keeps warning on every read.                                   */
+/*                                                                     */
+/* Layout, in native byte order (the cache does not travel), all       */
+/* fields u32 unless noted:                                            */
+/*                                                                     */
+/*   "RAPB" version byte-order-mark                                    */
+/*   i64 .lpl size, i64 .lpl mtime                                     */
+/*   flags, capacity, entry count                                      */
+/*   label_display_mode, right/left thumbnail mode,                    */
+/*     thumbnail_match_mode, sort_mode, scan db_usage, scan flags      */
+/*   str default_core_path, default_core_name,                         */
+/*     base_content_directory, scan content_dir, file_exts,            */
+/*     dat_file_path, database_name                                    */
+/*   list length (in u32s), string table length (in bytes)             */
+/*   entry count x { str path, label, core_path, core_name, db_name,   */
+/*     crc32, subsystem_ident, subsystem_name, runtime_str,            */
+/*     last_played_str; list subsystem_roms; entry_slot,               */
+/*     runtime_status, runtime h/m/s, last played y/m/d/h/m/s,         */
+/*     thumbnail_flags }                                               */
+/*   lists: { n, n x str }                                             */
+/*   string table: NUL-terminated strings                              */
+/*                                                                     */
+/* where a str is one more than an offset into the string table and a  */
+/* list one more than an index into the lists, 0 meaning NULL.         */
+/* ------------------------------------------------------------------ */
+
+#define PLAYLIST_BIN_EXT           "bin"
+#define PLAYLIST_BIN_MAGIC         "RAPB"
+#define PLAYLIST_BIN_VERSION       1
+#define PLAYLIST_BIN_BOM           0x01020304
+/* Below this many entries the JSON parse is quick enough that a
+ * second file is not worth keeping. */
+#define PLAYLIST_BIN_MIN_ENTRIES   128
+#define PLAYLIST_BIN_HEADER_WORDS  (3 + 4 + 3 + 7 + 7 + 2)
+#define PLAYLIST_BIN_ENTRY_STRS    10
+#define PLAYLIST_BIN_ENTRY_WORDS   (PLAYLIST_BIN_ENTRY_STRS + 1 + 12)
+
+enum playlist_bin_flags
+{
+   PLAYLIST_BIN_FLG_COMPRESSED = (1 << 0),
+   PLAYLIST_BIN_FLG_OLD_FMT    = (1 << 1)
+};
+
+enum playlist_bin_scan_flags
+{
+   PLAYLIST_BIN_SCAN_RECURSIVE  = (1 << 0),
+   PLAYLIST_BIN_SCAN_ARCHIVES   = (1 << 1),
+   PLAYLIST_BIN_SCAN_FILTER_DAT = (1 << 2),
+   PLAYLIST_BIN_SCAN_OVERWRITE  = (1 << 3),
+   PLAYLIST_BIN_SCAN_OMIT_DB    = (1 << 4)
+};
+
+typedef struct
+{
+   uint32_t *words;   /* header, entries and lists */
+   char *strings;
+   size_t *index;     /* string -> offset + 1 */
+   bool oom;
+} playlist_bin_writer_t;
+
+static void playlist_bin_path(const playlist_t *playlist,
+      char *s, size_t len)
+{
+   fill_pathname_join_delim(s, playlist->config.path,
+         PLAYLIST_BIN_EXT, '.', len);
+}
+
+static void playlist_bin_word(playlist_bin_writer_t *w, uint32_t v)
+{
+   size_t _len = RBUF_LEN(w->words);
+   RBUF_PUSH(w->words, v);
+   if (RBUF_LEN(w->words) == _len)
+      w->oom = true;
+}
+
+/* Identical strings are stored once: a large playlist repeats its
+ * core paths, core names and database names on every entry. */
+static void playlist_bin_str(playlist_bin_writer_t *w, const char *s)
+{
+   size_t at, _len;
+
+   if (!s)
+   {
+      playlist_bin_word(w, 0);
+      return;
+   }
+   if ((at = RHMAP_GET_STR(w->index, s)))
+   {
+      playlist_bin_word(w, (uint32_t)at);
+      return;
+   }
+
+   at   = RBUF_LEN(w->strings);
+   _len = strlen(s) + 1;
+   RBUF_RESIZE(w->strings, at + _len);
+   if (RBUF_LEN(w->strings) != at + _len || at + 1 > UINT32_MAX)
+   {
+      w->oom = true;
+      return;
+   }
+   memcpy(w->strings + at, s, _len);
+   RHMAP_SET_STR(w->index, s, at + 1);
+   playlist_bin_word(w, (uint32_t)(at + 1));
+}
+
+static bool playlist_bin_write(const playlist_t *playlist,
+      int64_t size, int64_t mtime)
+{
+   size_t i, j;
+   bool ok;
+   uint32_t flags               = 0;
+   uint32_t scan_flags          = 0;
+   uint32_t *lists              = NULL;
+   uint8_t *buf                 = NULL;
+   size_t entries_len           = RBUF_LEN(playlist->entries);
+   const playlist_manual_scan_record_t *scan = &playlist->scan_record;
+   playlist_bin_writer_t w;
+   char path[PATH_MAX_LENGTH];
+   char tmp_path[PATH_MAX_LENGTH];
+
+   w.words   = NULL;
+   w.strings = NULL;
+   w.index   = NULL;
+   w.oom     = false;
+
+   if (playlist->flags & CNT_PLAYLIST_FLG_COMPRESSED)
+      flags      |= PLAYLIST_BIN_FLG_COMPRESSED;
+   if (playlist->flags & CNT_PLAYLIST_FLG_OLD_FMT)
+      flags      |= PLAYLIST_BIN_FLG_OLD_FMT;
+   if (scan->search_recursively)
+      scan_flags |= PLAYLIST_BIN_SCAN_RECURSIVE;
+   if (scan->search_archives)
+      scan_flags |= PLAYLIST_BIN_SCAN_ARCHIVES;
+   if (scan->filter_dat_content)
+      scan_flags |= PLAYLIST_BIN_SCAN_FILTER_DAT;
+   if (scan->overwrite_playlist)
+      scan_flags |= PLAYLIST_BIN_SCAN_OVERWRITE;
+   if (scan->omit_db_ref)
+      scan_flags |= PLAYLIST_BIN_SCAN_OMIT_DB;
+
+   /* Magic and byte order mark are patched in as raw bytes below. */
+   playlist_bin_word(&w, 0);
+   playlist_bin_word(&w, PLAYLIST_BIN_VERSION);
+   playlist_bin_word(&w, PLAYLIST_BIN_BOM);
+   playlist_bin_word(&w, (uint32_t)((uint64_t)size        & 0xFFFFFFFF));
+   playlist_bin_word(&w, (uint32_t)((uint64_t)size  >> 32));
+   playlist_bin_word(&w, (uint32_t)((uint64_t)mtime       & 0xFFFFFFFF));
+   playlist_bin_word(&w, (uint32_t)((uint64_t)mtime >> 32));
+   playlist_bin_word(&w, flags);
+   playlist_bin_word(&w, (uint32_t)playlist->config.capacity);
+   playlist_bin_word(&w, (uint32_t)entries_len);
+   playlist_bin_word(&w, (uint32_t)playlist->label_display_mode);
+   playlist_bin_word(&w, (uint32_t)playlist->right_thumbnail_mode);
+   playlist_bin_word(&w, (uint32_t)playlist->left_thumbnail_mode);
+   playlist_bin_word(&w, (uint32_t)playlist->thumbnail_match_mode);
+   playlist_bin_word(&w, (uint32_t)playlist->sort_mode);
+   playlist_bin_word(&w, (uint32_t)scan->db_usage);
+   playlist_bin_word(&w, scan_flags);
+   playlist_bin_str(&w, playlist->default_core_path);
+   playlist_bin_str(&w, playlist->default_core_name);
+   playlist_bin_str(&w, playlist->base_content_directory);
+   playlist_bin_str(&w, scan->content_dir);
+   playlist_bin_str(&w, scan->file_exts);
+   playlist_bin_str(&w, scan->dat_file_path);
+   playlist_bin_str(&w, scan->database_name);
+   /* List and string table lengths, known at the end. */
+   playlist_bin_word(&w, 0);
+   playlist_bin_word(&w, 0);
+
+   for (i = 0; i < entries_len; i++)
+   {
+      const struct playlist_entry *entry = &playlist->entries[i];
+
+      playlist_bin_str(&w, entry->path);
+      playlist_bin_str(&w, entry->label);
+      playlist_bin_str(&w, entry->core_path);
+      playlist_bin_str(&w, entry->core_name);
+      playlist_bin_str(&w, entry->db_name);
+      playlist_bin_str(&w, entry->crc32);
+      playlist_bin_str(&w, entry->subsystem_ident);
+      playlist_bin_str(&w, entry->subsystem_name);
+      playlist_bin_str(&w, entry->runtime_str);
+      playlist_bin_str(&w, entry->last_played_str);
+
+      if (entry->subsystem_roms)
+      {
+         size_t _len = RBUF_LEN(lists);
+         playlist_bin_word(&w, (uint32_t)(_len + 1));
+         RBUF_RESIZE(lists, _len + 1 + entry->subsystem_roms->size);
+         if (RBUF_LEN(lists) != _len + 1 + entry->subsystem_roms->size)
+         {
+            w.oom = true;
+            break;
+         }
+         lists[_len] = (uint32_t)entry->subsystem_roms->size;
+         /* The strings go through the writer, then move over. */
+         for (j = 0; j < entry->subsystem_roms->size; j++)
+         {
+            playlist_bin_str(&w, entry->subsystem_roms->elems[j].data);
+            if (!w.oom)
+               lists[_len + 1 + j] = RBUF_POP(w.words);
+         }
+      }
+      else
+         playlist_bin_word(&w, 0);
+
+      playlist_bin_word(&w, entry->entry_slot);
+      playlist_bin_word(&w, (uint32_t)entry->runtime_status);
+      playlist_bin_word(&w, entry->runtime_hours);
+      playlist_bin_word(&w, entry->runtime_minutes);
+      playlist_bin_word(&w, entry->runtime_seconds);
+      playlist_bin_word(&w, entry->last_played_year);
+      playlist_bin_word(&w, entry->last_played_month);
+      playlist_bin_word(&w, entry->last_played_day);
+      playlist_bin_word(&w, entry->last_played_hour);
+      playlist_bin_word(&w, entry->last_played_minute);
+      playlist_bin_word(&w, entry->last_played_second);
+      playlist_bin_word(&w, (uint32_t)entry->thumbnail_flags);
+   }
+
+   ok = false;
+   if (     !w.oom
+         && RBUF_LEN(w.words) == PLAYLIST_BIN_HEADER_WORDS
+               + entries_len * PLAYLIST_BIN_ENTRY_WORDS
+         && RBUF_LEN(w.strings) < UINT32_MAX
+         && (buf = (uint8_t*)malloc(RBUF_SIZEOF(w.words)
+               + RBUF_SIZEOF(lists) + RBUF_LEN(w.strings))))
+   {
+      size_t at = 0;
+
+      w.words[PLAYLIST_BIN_HEADER_WORDS - 2] = (uint32_t)RBUF_LEN(lists);
+      w.words[PLAYLIST_BIN_HEADER_WORDS - 1] = (uint32_t)RBUF_LEN(w.strings);
+      memcpy(buf, w.words, RBUF_SIZEOF(w.words));
+      memcpy(buf, PLAYLIST_BIN_MAGIC, 4);
+      at += RBUF_SIZEOF(w.words);
+      if (lists)
+         memcpy(buf + at, lists, RBUF_SIZEOF(lists));
+      at += RBUF_SIZEOF(lists);
+      if (w.strings)
+         memcpy(buf + at, w.strings, RBUF_LEN(w.strings));
+      at += RBUF_LEN(w.strings);
+
+      /* Written aside and moved into place: another playlist handle
+       * may have the old one mapped. */
+      playlist_bin_path(playlist, path, sizeof(path));
+      fill_pathname_join_delim(tmp_path, path, "tmp", '.',
+            sizeof(tmp_path));
+      ok = filestream_write_file(tmp_path, buf, (int64_t)at);
+      if (ok && filestream_rename(tmp_path, path) != 0)
+      {
+         filestream_delete(path);
+         ok = filestream_rename(tmp_path, path) == 0;
+      }
+      if (!ok)
+         filestream_delete(tmp_path);
+   }
+
+   free(buf);
+   RBUF_FREE(lists);
+   RBUF_FREE(w.words);
+   RBUF_FREE(w.strings);
+   RHMAP_FREE(w.index);
+   return ok;
+}
+
+static void *playlist_bin_map(const char *path, size_t *len,
+      bool *mapped)
+{
+   void *data   = NULL;
+   int64_t _len = 0;
+#ifdef HAVE_MMAP
+   /* Only a host file can be mapped, not a VFS URL. */
+   if (!strstr(path, "://"))
+   {
+      struct stat st;
+      int fd = open(path, O_RDONLY);
+      if (fd < 0)
+         return NULL;
+      if (     fstat(fd, &st) == 0
+            && st.st_size > 0
+            && (uint64_t)st.st_size <= (uint64_t)SIZE_MAX)
+         data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE,
+               fd, 0);
+      close(fd);
+      if (!data || data == MAP_FAILED)
+         return NULL;
+      *len    = (size_t)st.st_size;
+      *mapped = true;
+      return data;
+   }
+#endif
+   if (     !path_is_valid(path)
+         || !filestream_read_file(path, &data, &_len)
+         || !data)
+   {
+      free(data);
+      return NULL;
+   }
+   *len    = (size_t)_len;
+   *mapped = false;
+   return data;
+}
+
+static void playlist_bin_unmap(playlist_t *playlist)
+{
+   if (!playlist->image)
+      return;
+#ifdef HAVE_MMAP
+   if (playlist->flags & CNT_PLAYLIST_FLG_IMAGE_MAP)
+      munmap((void*)playlist->image, playlist->image_len);
+   else
+#endif
+      free((void*)playlist->image);
+   playlist->image     = NULL;
+   playlist->image_len = 0;
+   playlist->flags    &= ~CNT_PLAYLIST_FLG_IMAGE_MAP;
+}
+
+typedef struct
+{
+   const uint32_t *lists;
+   const char *strings;
+   uint32_t lists_len;
+   uint32_t strings_len;
+   bool ok;
+} playlist_bin_reader_t;
+
+/* A string in the table.  The table ends in a NUL, so any offset
+ * inside it yields a terminated string. */
+static char *playlist_bin_get_str(playlist_bin_reader_t *r, uint32_t ref)
+{
+   if (!ref)
+      return NULL;
+   if (ref > r->strings_len)
+   {
+      r->ok = false;
+      return NULL;
+   }
+   return (char*)r->strings + ref - 1;
+}
+
+static char *playlist_bin_dup_str(playlist_bin_reader_t *r, uint32_t ref)
+{
+   char *s = playlist_bin_get_str(r, ref);
+   return s ? strdup(s) : NULL;
+}
+
+static struct string_list *playlist_bin_get_list(playlist_bin_reader_t *r,
+      uint32_t ref)
+{
+   uint32_t i, n;
+   struct string_list *list;
+   union string_list_elem_attr attr;
+
+   if (!ref)
+      return NULL;
+   if (     ref > r->lists_len
+         || (n = r->lists[ref - 1]) > r->lists_len - ref
+         || !(list = string_list_new()))
+   {
+      r->ok = false;
+      return NULL;
+   }
+   attr.i = 0;
+   for (i = 0; i < n; i++)
+   {
+      const char *s = playlist_bin_get_str(r, r->lists[ref + i]);
+      if (!s || !string_list_append(list, s, attr))
+      {
+         r->ok = false;
+         string_list_free(list);
+         return NULL;
+      }
+   }
+   return list;
+}
+
+/* Fills a freshly begun @playlist from its binary cache.  False
+ * leaves it as it was: the cache is missing, stale or damaged, or
+ * was written for a smaller capacity than is asked for now. */
+static bool playlist_bin_read(playlist_t *playlist,
+      int64_t size, int64_t mtime)
+{
+   size_t i, count;
+   bool mapped;
+   size_t len;
+   const uint32_t *h;
+   playlist_bin_reader_t r;
+   char path[PATH_MAX_LENGTH];
+   uint8_t *image;
+
+   playlist_bin_path(playlist, path, sizeof(path));
+   if (!(image = (uint8_t*)playlist_bin_map(path, &len, &mapped)))
+      return false;
+
+   h = (const uint32_t*)image;
+   if (     len < PLAYLIST_BIN_HEADER_WORDS * sizeof(uint32_t)
+         || memcmp(image, PLAYLIST_BIN_MAGIC, 4)
+         || h[1] != PLAYLIST_BIN_VERSION
+         || h[2] != PLAYLIST_BIN_BOM
+         || h[3] != (uint32_t)((uint64_t)size        & 0xFFFFFFFF)
+         || h[4] != (uint32_t)((uint64_t)size  >> 32)
+         || h[5] != (uint32_t)((uint64_t)mtime       & 0xFFFFFFFF)
+         || h[6] != (uint32_t)((uint64_t)mtime >> 32))
+      goto error;
+
+   /* A cache cut off at its capacity holds too few entries for a
+    * larger one; otherwise the parse would keep the same prefix. */
+   count = h[9];
+   if (count == h[8] && playlist->config.capacity > count)
+      goto error;
+
+   r.lists_len   = h[PLAYLIST_BIN_HEADER_WORDS - 2];
+   r.strings_len = h[PLAYLIST_BIN_HEADER_WORDS - 1];
+   r.ok          = true;
+   if (     count > (len / sizeof(uint32_t) - PLAYLIST_BIN_HEADER_WORDS)
+               / PLAYLIST_BIN_ENTRY_WORDS
+         || (size_t)r.lists_len
+               > len / sizeof(uint32_t) - PLAYLIST_BIN_HEADER_WORDS
+                  - count * PLAYLIST_BIN_ENTRY_WORDS
+         || len - (PLAYLIST_BIN_HEADER_WORDS
+               + count * PLAYLIST_BIN_ENTRY_WORDS + r.lists_len)
+               * sizeof(uint32_t) != r.strings_len
+         || (r.strings_len && image[len - 1] != '\0'))
+      goto error;
+   r.lists   = h + PLAYLIST_BIN_HEADER_WORDS
+             + count * PLAYLIST_BIN_ENTRY_WORDS;
+   r.strings = (const char*)(r.lists + r.lists_len);
+
+   if (count > playlist->config.capacity)
+      count = playlist->config.capacity;
+   RBUF_RESIZE(playlist->entries, count);
+   if (RBUF_LEN(playlist->entries) != count)
+      goto error;
+
+   for (i = 0; i < count && r.ok; i++)
+   {
+      const uint32_t *rec          = h + PLAYLIST_BIN_HEADER_WORDS
+                                   + i * PLAYLIST_BIN_ENTRY_WORDS;
+      const uint32_t *val          = rec + PLAYLIST_BIN_ENTRY_STRS + 1;
+      struct playlist_entry *entry = &playlist->entries[i];
+
+      entry->path               = playlist_bin_get_str(&r, rec[0]);
+      entry->label              = playlist_bin_get_str(&r, rec[1]);
+      entry->core_path          = playlist_bin_get_str(&r, rec[2]);
+      entry->core_name          = playlist_bin_get_str(&r, rec[3]);
+      entry->db_name            = playlist_bin_get_str(&r, rec[4]);
+      entry->crc32              = playlist_bin_get_str(&r, rec[5]);
+      entry->subsystem_ident    = playlist_bin_get_str(&r, rec[6]);
+      entry->subsystem_name     = playlist_bin_get_str(&r, rec[7]);
+      entry->runtime_str        = playlist_bin_get_str(&r, rec[8]);
+      entry->last_played_str    = playlist_bin_get_str(&r, rec[9]);
+      entry->subsystem_roms     = playlist_bin_get_list(&r,
+            rec[PLAYLIST_BIN_ENTRY_STRS]);
+      entry->path_id            = NULL;
+      entry->entry_slot         = val[0];
+      entry->runtime_status     = (enum playlist_runtime_status)val[1];
+      entry->runtime_hours      = val[2];
+      entry->runtime_minutes    = val[3];
+      entry->runtime_seconds    = val[4];
+      entry->last_played_year   = val[5];
+      entry->last_played_month  = val[6];
+      entry->last_played_day    = val[7];
+      entry->last_played_hour   = val[8];
+      entry->last_played_minute = val[9];
+      entry->last_played_second = val[10];
+      entry->thumbnail_flags    = (int)val[11];
+   }
+
+   /* The header strings are few, and the setters free them. */
+   playlist->label_display_mode   = (enum playlist_label_display_mode)h[10];
+   playlist->right_thumbnail_mode = (enum playlist_thumbnail_mode)h[11];
+   playlist->left_thumbnail_mode  = (enum playlist_thumbnail_mode)h[12];
+   playlist->thumbnail_match_mode = (enum playlist_thumbnail_match_mode)h[13];
+   playlist->sort_mode            = (enum playlist_sort_mode)h[14];
+   playlist->scan_record.db_usage = (int)h[15];
+   playlist->scan_record.search_recursively = (h[16] & PLAYLIST_BIN_SCAN_RECURSIVE)  != 0;
+   playlist->scan_record.search_archives    = (h[16] & PLAYLIST_BIN_SCAN_ARCHIVES)   != 0;
+   playlist->scan_record.filter_dat_content = (h[16] & PLAYLIST_BIN_SCAN_FILTER_DAT) != 0;
+   playlist->scan_record.overwrite_playlist = (h[16] & PLAYLIST_BIN_SCAN_OVERWRITE)  != 0;
+   playlist->scan_record.omit_db_ref        = (h[16] & PLAYLIST_BIN_SCAN_OMIT_DB)    != 0;
+   playlist->default_core_path          = playlist_bin_dup_str(&r, h[17]);
+   playlist->default_core_name          = playlist_bin_dup_str(&r, h[18]);
+   playlist->base_content_directory     = playlist_bin_dup_str(&r, h[19]);
+   playlist->scan_record.content_dir    = playlist_bin_dup_str(&r, h[20]);
+   playlist->scan_record.file_exts      = playlist_bin_dup_str(&r, h[21]);
+   playlist->scan_record.dat_file_path  = playlist_bin_dup_str(&r, h[22]);
+   playlist->scan_record.database_name  = playlist_bin_dup_str(&r, h[23]);
+
+   if (h[7] & PLAYLIST_BIN_FLG_COMPRESSED)
+      playlist->flags |= CNT_PLAYLIST_FLG_COMPRESSED;
+   if (h[7] & PLAYLIST_BIN_FLG_OLD_FMT)
+      playlist->flags |= CNT_PLAYLIST_FLG_OLD_FMT;
+   if (mapped)
+      playlist->flags |= CNT_PLAYLIST_FLG_IMAGE_MAP;
+   playlist->image     = image;
+   playlist->image_len = len;
+   playlist->file_size = size;
+
+   if (r.ok)
+      return true;
+
+   /* Damaged past the header: put the playlist back as it was.  The
+    * entries after the one that failed were never filled in. */
+   RBUF_RESIZE(playlist->entries, i);
+   playlist_clear(playlist);
+   free(playlist->default_core_path);
+   free(playlist->default_core_name);
+   free(playlist->base_content_directory);
+   free(playlist->scan_record.content_dir);
+   free(playlist->scan_record.file_exts);
+   free(playlist->scan_record.dat_file_path);
+   free(playlist->scan_record.database_name);
+   playlist->default_core_path         = NULL;
+   playlist->default_core_name         = NULL;
+   playlist->base_content_directory    = NULL;
+   playlist->scan_record.content_dir   = NULL;
+   playlist->scan_record.file_exts     = NULL;
+   playlist->scan_record.dat_file_path = NULL;
+   playlist->scan_record.database_name = NULL;
+   playlist->flags &= ~(CNT_PLAYLIST_FLG_COMPRESSED | CNT_PLAYLIST_FLG_OLD_FMT);
+   playlist_bin_unmap(playlist);
+   return false;
+
+error:
+#ifdef HAVE_MMAP
+   if (mapped)
+      munmap(image, len);
+   else
+#endif
+      free(image);
+   return false;
+}
+
 /**
  * playlist_free:
  * @playlist            : Playlist handle.
@@ -2668,12 +3783,14 @@ void playlist_free(playlist_t *playlist)
          struct playlist_entry *entry = &playlist->entries[i];
 
          if (entry)
-            playlist_free_entry(entry);
+            playlist_free_entry(playlist, entry);
       }
 
       RBUF_FREE(playlist->entries);
    }
 
+   RBUF_FREE(playlist->journal);
+   playlist_bin_unmap(playlist);
    free(playlist);
 }
 
@@ -2694,9 +3811,10 @@ void playlist_clear(playlist_t *playlist)
       struct playlist_entry *entry = &playlist->entries[i];
 
       if (entry)
-         playlist_free_entry(entry);
+         playlist_free_entry(playlist, entry);
    }
    RBUF_CLEAR(playlist->entries);
+   playlist->flags |= CNT_PLAYLIST_FLG_REWRITE;
 }
 
 /**
@@ -2792,7 +3910,8 @@ static bool JSONStartObjectHandler(void *context)
              * the playlist must be flagged as being modified
              * (i.e. the playlist is not the same as when it was
              * last saved to disk...) */
-            pCtx->playlist->flags   |= CNT_PLAYLIST_FLG_MOD;
+            pCtx->playlist->flags   |= CNT_PLAYLIST_FLG_MOD
+                                     | CNT_PLAYLIST_FLG_REWRITE;
          }
       }
    }
@@ -3136,9 +4255,13 @@ struct playlist_parse
    size_t oldref_len;
    size_t newref_len;
    unsigned events;
+   int64_t bin_size;                      /* .lpl stamp for the */
+   int64_t bin_mtime;                     /* binary cache       */
    enum playlist_parse_phase phase;
    bool res;
    bool autofix_scan_done;
+   bool bin_stamped;
+   bool bin_fresh;                        /* JSON read cleanly  */
 };
 
 static void playlist_parse_close_io(playlist_parse_t *p)
@@ -3155,7 +4278,7 @@ static void playlist_parse_close_io(playlist_parse_t *p)
             && p->context.current_entry ==
                   p->playlist->entries + RBUF_LEN(p->playlist->entries))
       {
-         playlist_free_entry(p->context.current_entry);
+         playlist_free_entry(p->playlist, p->context.current_entry);
          p->context.current_entry = NULL;
       }
       rjson_free(p->parser);
@@ -3198,22 +4321,41 @@ static void playlist_parse_enter_autofix(playlist_parse_t *p)
       p->oldref_len = strlen(playlist->base_content_directory);
       p->newref_len = strlen(playlist->config.base_content_directory);
       p->phase      = PLAYLIST_PARSE_PHASE_AUTOFIX;
-      return;
    }
-
    /* No fixing applies; but when autofix is on the base content
     * directory record must still be refreshed and the file saved -
     * the tail playlist_init always ran. */
-   if (    playlist->config.autofix_paths
+   else if (playlist->config.autofix_paths
        && !string_is_equal(playlist->base_content_directory,
             playlist->config.base_content_directory))
    {
       p->phase      = PLAYLIST_PARSE_PHASE_AUTOFIX;
       p->autofix_idx = RBUF_LEN(playlist->entries);   /* skip entries */
-      return;
    }
+   else
+   {
+      /* Cached only when nothing is about to rewrite the .lpl, which
+       * would leave the cache stale as soon as it was made. */
+      if (p->bin_fresh && p->bin_stamped)
+      {
+         if (RBUF_LEN(playlist->entries) >= PLAYLIST_BIN_MIN_ENTRIES)
+            playlist_bin_write(playlist, p->bin_size, p->bin_mtime);
+         else
+         {
+            char path[PATH_MAX_LENGTH];
+            playlist_bin_path(playlist, path, sizeof(path));
+            if (path_is_valid(path))
+               filestream_delete(path);
+         }
+      }
 
-   p->phase = PLAYLIST_PARSE_PHASE_DONE;
+      p->phase = PLAYLIST_PARSE_PHASE_DONE;
+   }
+
+   /* After the binary cache is written, which must describe the .lpl
+    * alone, and before autofix, whose rewrite folds the journal in. */
+   if (p->bin_stamped)
+      playlist_journal_replay(playlist, p->bin_size, p->bin_mtime);
 }
 
 /* One budgeted slice of the JSON event stream.  This is the          */
@@ -3297,6 +4439,7 @@ static int playlist_parse_step_json(playlist_parse_t *p,
 
 stopped:
    context = p->context;   /* the moved block below reads context.flags */
+   p->bin_fresh = stop == RJSON_DONE && !(context.flags & JSON_CTX_FLG_OOM);
    if (stop != RJSON_DONE)
       {
          if (context.flags & JSON_CTX_FLG_OOM)
@@ -3329,7 +4472,7 @@ stopped:
    if (     p->context.current_entry
          && p->context.current_entry ==
                playlist->entries + RBUF_LEN(playlist->entries))
-      playlist_free_entry(p->context.current_entry);
+      playlist_free_entry(playlist, p->context.current_entry);
 
    playlist_parse_enter_autofix(p);
    return (p->phase == PLAYLIST_PARSE_PHASE_ERROR) ? -1 : 1;
@@ -3556,7 +4699,7 @@ static int playlist_parse_step_autofix(playlist_parse_t *p,
                playlist->config.base_content_directory, p->newref_len,
                sizeof(tmp_entry_path));
 
-         free(entry->path);
+         playlist_free_str(playlist, entry->path);
          entry->path = strdup(tmp_entry_path);
 
          /* Fix subsystem roms paths*/
@@ -3665,6 +4808,12 @@ playlist_parse_t *playlist_parse_begin(const playlist_config_t *config)
    playlist->default_core_path              = NULL;
    playlist->base_content_directory         = NULL;
    playlist->entries                        = NULL;
+   playlist->image                          = NULL;
+   playlist->image_len                      = 0;
+   playlist->journal                        = NULL;
+   playlist->journal_size                   = 0;
+   playlist->journal_base_size              = -1;
+   playlist->journal_base_mtime             = 0;
    playlist->label_display_mode             = LABEL_DISPLAY_MODE_DEFAULT;
    playlist->right_thumbnail_mode           = PLAYLIST_THUMBNAIL_MODE_DEFAULT;
    playlist->left_thumbnail_mode            = PLAYLIST_THUMBNAIL_MODE_DEFAULT;
@@ -3692,6 +4841,19 @@ playlist_parse_t *playlist_parse_begin(const playlist_config_t *config)
    p->res      = true;
    p->phase    = PLAYLIST_PARSE_PHASE_DONE;   /* until proven otherwise */
 
+   /* A current binary cache stands in for the whole parse.  Without
+    * a modification time there is no telling whether it is current,
+    * so nothing is read or written. */
+   p->bin_stamped = path_get_size_and_mtime(playlist->config.path,
+         &p->bin_size, &p->bin_mtime);
+   if (     p->bin_stamped
+         && p->bin_size > 0
+         && playlist_bin_read(playlist, p->bin_size, p->bin_mtime))
+   {
+      playlist_parse_enter_autofix(p);
+      return p;
+   }
+
 #if defined(HAVE_COMPRESSION)
       /* Always use RZIP interface when reading playlists
        * > this will automatically handle uncompressed
@@ -4199,6 +5361,10 @@ void playlist_qsort(playlist_t *playlist)
    qsort(playlist->entries, RBUF_LEN(playlist->entries),
          sizeof(struct playlist_entry),
          playlist_qsort_func);
+
+   /* Not a modification to save, but the order on disk is no longer
+    * the one journal records would be applied to. */
+   playlist->flags |= CNT_PLAYLIST_FLG_REWRITE;
 }
 
 void command_playlist_push_write(
@@ -4518,7 +5684,7 @@ void playlist_set_default_core_path(playlist_t *playlist,
       if (playlist->default_core_path)
          free(playlist->default_core_path);
       playlist->default_core_path  = strdup(real_core_path);
-      playlist->flags             |=  CNT_PLAYLIST_FLG_MOD;
+      playlist->flags             |=  CNT_PLAYLIST_FLG_MOD | CNT_PLAYLIST_FLG_REWRITE;
    }
 }
 
@@ -4533,7 +5699,7 @@ void playlist_set_default_core_name(
       if (playlist->default_core_name)
          free(playlist->default_core_name);
       playlist->default_core_name  = strdup(core_name);
-      playlist->flags             |=  CNT_PLAYLIST_FLG_MOD;
+      playlist->flags             |=  CNT_PLAYLIST_FLG_MOD | CNT_PLAYLIST_FLG_REWRITE;
    }
 }
 
@@ -4543,7 +5709,7 @@ void playlist_set_label_display_mode(playlist_t *playlist,
    if (playlist && playlist->label_display_mode != label_display_mode)
    {
       playlist->label_display_mode = label_display_mode;
-      playlist->flags             |=  CNT_PLAYLIST_FLG_MOD;
+      playlist->flags             |=  CNT_PLAYLIST_FLG_MOD | CNT_PLAYLIST_FLG_REWRITE;
    }
 }
 
@@ -4558,11 +5724,11 @@ void playlist_set_thumbnail_mode(
    {
       case PLAYLIST_THUMBNAIL_RIGHT:
          playlist->right_thumbnail_mode = thumbnail_mode;
-         playlist->flags               |=  CNT_PLAYLIST_FLG_MOD;
+         playlist->flags               |=  CNT_PLAYLIST_FLG_MOD | CNT_PLAYLIST_FLG_REWRITE;
          break;
       case PLAYLIST_THUMBNAIL_LEFT:
          playlist->left_thumbnail_mode  = thumbnail_mode;
-         playlist->flags               |=  CNT_PLAYLIST_FLG_MOD;
+         playlist->flags               |=  CNT_PLAYLIST_FLG_MOD | CNT_PLAYLIST_FLG_REWRITE;
          break;
       case PLAYLIST_THUMBNAIL_ICON:
          /* should never be reached.  Do Nothing */
@@ -4577,7 +5743,7 @@ void playlist_set_sort_mode(playlist_t *playlist,
    if (playlist && playlist->sort_mode != sort_mode)
    {
       playlist->sort_mode = sort_mode;
-      playlist->flags    |=  CNT_PLAYLIST_FLG_MOD;
+      playlist->flags    |=  CNT_PLAYLIST_FLG_MOD | CNT_PLAYLIST_FLG_REWRITE;
    }
 }
 
@@ -4603,7 +5769,7 @@ void playlist_set_scan_content_dir(playlist_t *playlist, const char *content_dir
    if (    (current_string_empty && !new_string_empty)
        || (!current_string_empty &&  new_string_empty)
        || !string_is_equal(playlist->scan_record.content_dir, content_dir))
-      playlist->flags    |=  CNT_PLAYLIST_FLG_MOD;
+      playlist->flags    |=  CNT_PLAYLIST_FLG_MOD | CNT_PLAYLIST_FLG_REWRITE;
    else
       return; /* Strings are identical; do nothing */
 
@@ -4634,7 +5800,7 @@ void playlist_set_scan_file_exts(playlist_t *playlist, const char *file_exts)
    if (   ( current_string_empty && !new_string_empty)
        || (!current_string_empty &&  new_string_empty)
        || !string_is_equal(playlist->scan_record.file_exts, file_exts))
-      playlist->flags    |=  CNT_PLAYLIST_FLG_MOD;
+      playlist->flags    |=  CNT_PLAYLIST_FLG_MOD | CNT_PLAYLIST_FLG_REWRITE;
    else
       return; /* Strings are identical; do nothing */
 
@@ -4670,7 +5836,7 @@ void playlist_set_scan_dat_file_path(playlist_t *playlist, const char *dat_file_
    if (   ( current_string_empty && !new_string_empty)
        || (!current_string_empty &&  new_string_empty)
        || !string_is_equal(playlist->scan_record.dat_file_path, dat_file_path))
-      playlist->flags    |=  CNT_PLAYLIST_FLG_MOD;
+      playlist->flags    |=  CNT_PLAYLIST_FLG_MOD | CNT_PLAYLIST_FLG_REWRITE;
    else
       return; /* Strings are identical; do nothing */
 
@@ -4701,7 +5867,7 @@ void playlist_set_scan_database_name(playlist_t *playlist, const char *database_
    if (   ( current_string_empty && !new_string_empty)
        || (!current_string_empty &&  new_string_empty)
        || !string_is_equal(playlist->scan_record.database_name, database_name))
-      playlist->flags    |=  CNT_PLAYLIST_FLG_MOD;
+      playlist->flags    |=  CNT_PLAYLIST_FLG_MOD | CNT_PLAYLIST_FLG_REWRITE;
    else
       return; /* Strings are identical; do nothing */
 
@@ -4720,7 +5886,7 @@ void playlist_set_scan_search_recursively(playlist_t *playlist, bool search_recu
    if (playlist && playlist->scan_record.search_recursively != search_recursively)
    {
       playlist->scan_record.search_recursively = search_recursively;
-      playlist->flags    |=  CNT_PLAYLIST_FLG_MOD;
+      playlist->flags    |=  CNT_PLAYLIST_FLG_MOD | CNT_PLAYLIST_FLG_REWRITE;
    }
 }
 
@@ -4729,7 +5895,7 @@ void playlist_set_scan_search_archives(playlist_t *playlist, bool search_archive
    if (playlist && playlist->scan_record.search_archives != search_archives)
    {
       playlist->scan_record.search_archives = search_archives;
-      playlist->flags    |=  CNT_PLAYLIST_FLG_MOD;
+      playlist->flags    |=  CNT_PLAYLIST_FLG_MOD | CNT_PLAYLIST_FLG_REWRITE;
    }
 }
 
@@ -4738,7 +5904,7 @@ void playlist_set_scan_filter_dat_content(playlist_t *playlist, bool filter_dat_
    if (playlist && playlist->scan_record.filter_dat_content != filter_dat_content)
    {
       playlist->scan_record.filter_dat_content = filter_dat_content;
-      playlist->flags    |=  CNT_PLAYLIST_FLG_MOD;
+      playlist->flags    |=  CNT_PLAYLIST_FLG_MOD | CNT_PLAYLIST_FLG_REWRITE;
    }
 }
 
@@ -4747,7 +5913,7 @@ void playlist_set_scan_omit_db_ref(playlist_t *playlist, bool omit_db_ref)
    if (playlist && playlist->scan_record.omit_db_ref != omit_db_ref)
    {
       playlist->scan_record.omit_db_ref = omit_db_ref;
-      playlist->flags    |=  CNT_PLAYLIST_FLG_MOD;
+      playlist->flags    |=  CNT_PLAYLIST_FLG_MOD | CNT_PLAYLIST_FLG_REWRITE;
    }
 }
 
@@ -4756,7 +5922,7 @@ void playlist_set_scan_db_usage(playlist_t *playlist, int db_usage)
    if (playlist && playlist->scan_record.db_usage != db_usage)
    {
       playlist->scan_record.db_usage = db_usage;
-      playlist->flags    |=  CNT_PLAYLIST_FLG_MOD;
+      playlist->flags    |=  CNT_PLAYLIST_FLG_MOD | CNT_PLAYLIST_FLG_REWRITE;
    }
 }
 
@@ -4765,7 +5931,7 @@ void playlist_set_scan_overwrite_playlist(playlist_t *playlist, bool overwrite_p
    if (playlist && playlist->scan_record.overwrite_playlist != overwrite_playlist)
    {
       playlist->scan_record.overwrite_playlist = overwrite_playlist;
-      playlist->flags    |=  CNT_PLAYLIST_FLG_MOD;
+      playlist->flags    |=  CNT_PLAYLIST_FLG_MOD | CNT_PLAYLIST_FLG_REWRITE;
    }
 }
 
@@ -413,6 +413,23 @@ uint32_t playlist_get_size(playlist_t *playlist);
 
 void playlist_write_file(playlist_t *playlist);
 
+/* Opts @playlist into journaled writes: playlist_write_file() then
+ * appends each batch of entry changes to a log beside the file
+ * instead of rewriting it, and every later read replays the log.
+ * For large playlists that change a little and often - the history
+ * and favourites lists. */
+void playlist_set_journaled(playlist_t *playlist);
+
+/* Where the journal of the playlist at @path is kept, whether or not
+ * there is one: anything that caches what a read of the playlist
+ * returns has to watch this file as well as the playlist.  @s may be
+ * @path itself. */
+void playlist_get_journal_path(const char *path, char *s, size_t len);
+
+/* Writes @playlist whole, folding in any journal; for a journaled
+ * playlist that is about to be freed for good. */
+void playlist_compact(playlist_t *playlist);
+
 void playlist_write_runtime_file(playlist_t *playlist);
 
 void playlist_qsort(playlist_t *playlist);
@@ -143,6 +143,14 @@
 #include <net/net_http.h>
 #endif
 
+#ifdef HAVE_7ZIP
+#include <7z/r7z_archive.h>
+#endif
+
+#ifdef HAVE_RCHD
+#include <formats/rchd.h>
+#endif
+
 #include <audio/audio_resampler.h>
 
 #include "audio/audio_driver.h"
@@ -3363,8 +3371,10 @@ bool command_event(enum event_command cmd, void *data)
                runloop_st->flags & RUNLOOP_FLAG_USE_SRAM,
 #if defined(HAVE_COMPRESSION)
                settings->bools.save_file_compression,
+               settings->bools.save_compression_zstd,
+               settings->uints.save_compression_zstd_level,
 #else
-               false,
+               false, false, 0,
 #endif
 #ifdef HAVE_CHEATS
                settings->paths.path_cheat_database
@@ -4326,8 +4336,10 @@ bool command_event(enum event_command cmd, void *data)
                if (autosave_init(
 #if defined(HAVE_COMPRESSION)
                         settings->bools.save_file_compression,
+                        settings->bools.save_compression_zstd,
+                        settings->uints.save_compression_zstd_level,
 #else
-                        false,
+                        false, false, 0,
 #endif
                         settings->uints.autosave_interval)
                      )
@@ -4534,16 +4546,18 @@ bool command_event(enum event_command cmd, void *data)
          }
          break;
       case CMD_EVENT_HISTORY_DEINIT:
+         /* The history lists are journaled (see CMD_EVENT_HISTORY_INIT);
+          * leave each as a single file on the way out. */
          if (g_defaults.content_history)
          {
-            playlist_write_file(g_defaults.content_history);
+            playlist_compact(g_defaults.content_history);
             playlist_free(g_defaults.content_history);
          }
          g_defaults.content_history = NULL;
 
          if (g_defaults.music_history)
          {
-            playlist_write_file(g_defaults.music_history);
+            playlist_compact(g_defaults.music_history);
             playlist_free(g_defaults.music_history);
          }
          g_defaults.music_history = NULL;
@@ -4551,7 +4565,7 @@ bool command_event(enum event_command cmd, void *data)
 #if defined(HAVE_FFMPEG) || defined(HAVE_MPV)
          if (g_defaults.video_history)
          {
-            playlist_write_file(g_defaults.video_history);
+            playlist_compact(g_defaults.video_history);
             playlist_free(g_defaults.video_history);
          }
          g_defaults.video_history = NULL;
@@ -4560,7 +4574,7 @@ bool command_event(enum event_command cmd, void *data)
 #ifdef HAVE_IMAGEVIEWER
          if (g_defaults.image_history)
          {
-            playlist_write_file(g_defaults.image_history);
+            playlist_compact(g_defaults.image_history);
             playlist_free(g_defaults.image_history);
          }
          g_defaults.image_history = NULL;
@@ -4603,6 +4617,7 @@ bool command_event(enum event_command cmd, void *data)
                g_defaults.content_history = playlist_init(&playlist_config);
                playlist_set_sort_mode(
                      g_defaults.content_history, PLAYLIST_SORT_MODE_OFF);
+               playlist_set_journaled(g_defaults.content_history);
             }
 
 #ifdef HAVE_IMAGEVIEWER
@@ -4614,6 +4629,7 @@ bool command_event(enum event_command cmd, void *data)
                g_defaults.image_history = playlist_init(&playlist_config);
                playlist_set_sort_mode(
                      g_defaults.image_history, PLAYLIST_SORT_MODE_OFF);
+               playlist_set_journaled(g_defaults.image_history);
             }
 #endif
 
@@ -4625,6 +4641,7 @@ bool command_event(enum event_command cmd, void *data)
                g_defaults.music_history = playlist_init(&playlist_config);
                playlist_set_sort_mode(
                      g_defaults.music_history, PLAYLIST_SORT_MODE_OFF);
+               playlist_set_journaled(g_defaults.music_history);
             }
 
 #if defined(HAVE_FFMPEG) || defined(HAVE_MPV)
@@ -4636,6 +4653,7 @@ bool command_event(enum event_command cmd, void *data)
                g_defaults.video_history = playlist_init(&playlist_config);
                playlist_set_sort_mode(
                      g_defaults.video_history, PLAYLIST_SORT_MODE_OFF);
+               playlist_set_journaled(g_defaults.video_history);
             }
 #endif
          }
@@ -6436,6 +6454,12 @@ void main_exit(void *args)
     * pooled connection. */
    net_http_deinit();
 #endif
+#ifdef HAVE_7ZIP
+   r7z_archive_cache_deinit();
+#endif
+#ifdef HAVE_RCHD
+   rchd_cache_deinit();
+#endif
 
    ui_companion_driver_deinit();
    retroarch_config_deinit();
@@ -8991,6 +9015,19 @@ void retroarch_init_task_queue(void)
     * transfers of the process could each create one and then lock
     * different objects. */
    net_http_init();
+#endif
+#ifdef HAVE_7ZIP
+   /* Also before the task thread exists: the decoded-folder cache is
+    * shared by every archive any task opens, and its lock is created
+    * here rather than on first use. Extracting several members of one
+    * solid 7z then decodes its folder once, not once per member. */
+   r7z_archive_cache_init(0);
+#endif
+#ifdef HAVE_RCHD
+   /* Likewise for CHD hunks: a scan, an achievement hash and a disc
+    * browse of the same image each open their own chdstream, and
+    * this is what lets them decode its hunks once between them. */
+   rchd_cache_init(0);
 #endif
    task_queue_init(threaded_enable, runloop_task_msg_queue_push);
 
@@ -9751,6 +9788,9 @@ void retroarch_favorites_init(void)
          path_content_favorites);
    playlist_config_set_path(&playlist_config, path_content_favorites);
    g_defaults.content_favorites = playlist_init(&playlist_config);
+   /* Added to at every favourite, so journaled rather than rewritten
+    * each time; folded back into one file by the deinit. */
+   playlist_set_journaled(g_defaults.content_favorites);
 
    /* Get current per-playlist sort mode */
    current_sort_mode = playlist_get_sort_mode(g_defaults.content_favorites);
@@ -9767,7 +9807,7 @@ void retroarch_favorites_deinit(void)
    if (!g_defaults.content_favorites)
       return;
 
-   playlist_write_file(g_defaults.content_favorites);
+   playlist_compact(g_defaults.content_favorites);
    playlist_free(g_defaults.content_favorites);
    g_defaults.content_favorites = NULL;
 }
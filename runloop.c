@@ -8162,14 +8162,22 @@ int runloop_iterate(void)
       want_runahead                     = want_runahead && !netplay_is_enabled;
 #endif
 
+      /* Both enter retro_run() directly as well as through
+       * core_run(), so say the state moved on here too. */
       if (want_runahead)
+      {
+         content_state_snapshot_invalidate();
          runahead_run(
                runloop_st,
                run_ahead_num_frames,
                run_ahead_hide_warnings,
                run_ahead_secondary_instance);
+      }
       else if (runloop_st->preempt_data)
+      {
+         content_state_snapshot_invalidate();
          preempt_run(runloop_st->preempt_data, runloop_st);
+      }
       else
 #endif
          core_run();
@@ -8567,6 +8575,8 @@ bool core_set_cheat(retro_ctx_cheat_info_t *info)
    }
 #endif
 
+   /* A cheat changes what the core serializes without it running */
+   content_state_snapshot_invalidate();
    runloop_st->current_core.retro_cheat_set(info->index, info->enabled, info->code);
 
 #if defined(HAVE_RUNAHEAD) && (defined(HAVE_DYNAMIC) || defined(HAVE_DYLIB))
@@ -8608,6 +8618,7 @@ bool core_reset_cheat(void)
    }
 #endif
 
+   content_state_snapshot_invalidate();
    runloop_st->current_core.retro_cheat_reset();
 
 #if defined(HAVE_RUNAHEAD) && (defined(HAVE_DYNAMIC) || defined(HAVE_DYLIB))
@@ -8724,6 +8735,7 @@ bool core_get_system_info(struct retro_system_info *sysinfo)
 bool core_unserialize(retro_ctx_serialize_info_t *info)
 {
    runloop_state_t *runloop_st  = &runloop_state;
+   content_state_snapshot_invalidate();
    if (!info || !runloop_st->current_core.retro_unserialize(info->data_const, info->size))
       return false;
 
@@ -8745,6 +8757,7 @@ bool core_unserialize_special(retro_ctx_serialize_info_t *info)
    if (!info)
       return false;
 
+   content_state_snapshot_invalidate();
    runloop_st->flags |=  RUNLOOP_FLAG_REQUEST_SPECIAL_SAVESTATE;
    ret = runloop_st->current_core.retro_unserialize(info->data_const, info->size);
    runloop_st->flags &= ~RUNLOOP_FLAG_REQUEST_SPECIAL_SAVESTATE;
@@ -8814,6 +8827,7 @@ void core_reset(void)
    video_driver_invalidate_hw_render_cache();
 
    video_driver_cached_frame_invalidate();
+   content_state_snapshot_invalidate();
    runloop_st->current_core.retro_reset();
 }
 
@@ -8881,6 +8895,7 @@ void core_run(void)
    /* Content can be marked CORE_RUNNING after a failed/partial load
     * (e.g. archive member opened with no core).  Never call through
     * a NULL retro_run — that is an immediate SIGSEGV. */
+   content_state_snapshot_invalidate();
    if (current_core->retro_run)
       current_core->retro_run();
 
@@ -0,0 +1,412 @@
+/* Oracle for the Explore cache (menu/menu_explore.c), compiled from
+ * the shipping translation unit - included below, so the lanes can
+ * see whether a state came out of the cache or was built.
+ *
+ * The fixture is one playlist, large enough that a journaled write
+ * appends to its log instead of rewriting it, and one database naming
+ * two of its entries, Alpha and Beta, each with a genre of its own.
+ * Every lane checks that each Explore entry still carries its own
+ * game's genre: a cache holds entries by playlist index, so one taken
+ * back over a playlist that has changed underneath it files games
+ * under the wrong genres.
+ *
+ *   hit      - a second build, nothing changed, comes from the cache.
+ *   journal  - moving Alpha to the front through the playlist's
+ *              journal leaves the .lpl byte for byte alone and the
+ *              entry count the same, yet the next build must not
+ *              come from the cache; the one after that may again.
+ *
+ * The stubs stand in for the menu, video and task code the build
+ * path never reaches. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../../../menu/menu_explore.c"
+
+#include "../../../core_info.h"
+#include "../../../file_path_special.h"
+#include "../../../frontend/frontend_driver.h"
+#include "../../../gfx/video_driver.h"
+#include "../../../menu/menu_displaylist.h"
+#include "../../../menu/menu_input.h"
+#include "../../../runloop.h"
+
+/* ------------------------------------------------------------------ */
+/* Stubs                                                              */
+/* ------------------------------------------------------------------ */
+
+bool core_info_find(const char *core_path, core_info_t **core_info)
+{
+   if (core_info)
+      *core_info = NULL;
+   return false;
+}
+
+bool core_info_core_file_id_is_equal(const char *core_path_a,
+      const char *core_path_b)
+{
+   return false;
+}
+
+const char *msg_hash_to_str(enum msg_hash_enums msg)
+{
+   switch (msg)
+   {
+      case MENU_ENUM_LABEL_VALUE_YES:
+         return "Yes";
+      case MENU_ENUM_LABEL_VALUE_NO:
+         return "No";
+      default:
+         break;
+   }
+   return "";
+}
+
+settings_t *config_get_ptr(void) { return NULL; }
+struct menu_state *menu_state_get_ptr(void) { return NULL; }
+void frontend_driver_attach_console(void) { }
+void frontend_driver_detach_console(void) { }
+void filebrowser_clear_type(void) { }
+void menu_input_dialog_end(void) { }
+bool menu_input_dialog_start(menu_input_ctx_line_t *line) { return false; }
+void menu_displaylist_info_init(menu_displaylist_info_t *info) { }
+uint32_t video_driver_get_disp_flags(void) { return 0; }
+bool video_driver_texture_unload(uintptr_t *id) { return true; }
+bool menu_explore_init_in_progress(void *data) { return false; }
+
+struct string_list *file_archive_get_file_list(const char *path,
+      const char *valid_exts)
+{
+   return NULL;
+}
+
+size_t fill_pathname_application_special(char *s, size_t len,
+      enum application_special_type type)
+{
+   if (len)
+      *s = '\0';
+   return 0;
+}
+
+int action_cancel_pop_default(const char *path,
+      const char *label, unsigned type, size_t idx)
+{
+   return 0;
+}
+
+int generic_action_ok_displaylist_push(const char *path,
+      const char *new_path, const char *label, unsigned type,
+      size_t idx, size_t entry_idx, unsigned action_type)
+{
+   return 0;
+}
+
+bool gfx_display_load_icon(const char *fullpath, bool supports_rgba,
+      uintptr_t *target_texture, uint64_t generation,
+      uint64_t *generation_ptr)
+{
+   return false;
+}
+
+bool gfx_thumbnail_set_system(gfx_thumbnail_path_data_t *path_data,
+      const char *system, playlist_t *playlist)
+{
+   return false;
+}
+
+bool gfx_thumbnail_set_content_playlist(
+      gfx_thumbnail_path_data_t *path_data, playlist_t *playlist,
+      size_t idx)
+{
+   return false;
+}
+
+bool menu_displaylist_ctl(enum menu_displaylist_ctl_state type,
+      menu_displaylist_info_t *info, settings_t *settings)
+{
+   return false;
+}
+
+bool menu_entries_append(file_list_t *list, const char *path,
+      const char *label, enum msg_hash_enums enum_idx, unsigned type,
+      size_t directory_ptr, size_t entry_idx, rarch_setting_t *setting)
+{
+   return false;
+}
+
+void runloop_msg_queue_push(const char *msg, size_t len,
+      unsigned prio, unsigned duration, bool flush, char *title,
+      enum message_queue_icon icon, enum message_queue_category category)
+{
+}
+
+bool task_push_menu_explore_init(const char *directory_playlist,
+      const char *directory_database)
+{
+   return false;
+}
+
+/* ------------------------------------------------------------------ */
+/* Fixture                                                            */
+/* ------------------------------------------------------------------ */
+
+static unsigned failures = 0;
+
+#define CHECK(cond, ...) \
+   do { \
+      if (!(cond)) \
+      { \
+         fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__); \
+         fprintf(stderr, __VA_ARGS__); \
+         fprintf(stderr, "\n"); \
+         failures++; \
+      } \
+   } while (0)
+
+/* Enough entries that the .lpl is past PLAYLIST_JOURNAL_MIN_FILE. */
+#define FILLERS 300
+
+static const struct
+{
+   const char *name;
+   const char *genre;
+} games[] = {
+   { "Alpha", "Shooter" },
+   { "Beta",  "Puzzle"  },
+};
+
+static char dir_root[256];
+static char dir_playlist[300];
+static char dir_database[300];
+static char lpl_path[320];
+
+static void dom_str(struct rmsgpack_dom_value *v, const char *s)
+{
+   v->type              = RDT_STRING;
+   v->val.string.len    = (uint32_t)strlen(s);
+   v->val.string.buff   = strdup(s);
+}
+
+static int rdb_provider(void *ctx, struct rmsgpack_dom_value *out)
+{
+   unsigned *next = (unsigned*)ctx;
+   struct rmsgpack_dom_pair *pairs;
+
+   if (*next >= sizeof(games) / sizeof(games[0]))
+      return 1;
+   pairs = (struct rmsgpack_dom_pair*)calloc(2, sizeof(*pairs));
+   dom_str(&pairs[0].key,   "name");
+   dom_str(&pairs[0].value, games[*next].name);
+   dom_str(&pairs[1].key,   "genre");
+   dom_str(&pairs[1].value, games[*next].genre);
+   out->type          = RDT_MAP;
+   out->val.map.len   = 2;
+   out->val.map.items = pairs;
+   (*next)++;
+   return 0;
+}
+
+static void push_entry(playlist_t *pl, const char *path, const char *label)
+{
+   struct playlist_entry entry;
+   memset(&entry, 0, sizeof(entry));
+   entry.path      = (char*)path;
+   entry.label     = (char*)label;
+   entry.core_path = (char*)"DETECT";
+   entry.core_name = (char*)"DETECT";
+   playlist_push(pl, &entry);
+}
+
+static playlist_t *open_playlist(void)
+{
+   playlist_config_t config;
+   memset(&config, 0, sizeof(config));
+   config.capacity = COLLECTION_SIZE;
+   strlcpy(config.path, lpl_path, sizeof(config.path));
+   return playlist_init(&config);
+}
+
+static bool make_fixture(void)
+{
+   char path[400];
+   unsigned next = 0;
+   intfstream_t *rdb;
+   playlist_t *pl;
+   unsigned i;
+
+   snprintf(dir_root, sizeof(dir_root), "/tmp/explore_cache_XXXXXX");
+   if (!mkdtemp(dir_root))
+      return false;
+   snprintf(dir_playlist, sizeof(dir_playlist), "%s/playlists", dir_root);
+   snprintf(dir_database, sizeof(dir_database), "%s/database", dir_root);
+   path_mkdir(dir_playlist);
+   path_mkdir(dir_database);
+
+   snprintf(path, sizeof(path), "%s/Test.rdb", dir_database);
+   if (!(rdb = intfstream_open_file(path, RETRO_VFS_FILE_ACCESS_WRITE,
+               RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+      return false;
+   libretrodb_create(rdb, rdb_provider, &next);
+   intfstream_close(rdb);
+   free(rdb);
+
+   /* Pushes go to the front: Alpha and Beta end up last. */
+   snprintf(lpl_path, sizeof(lpl_path), "%s/Test.lpl", dir_playlist);
+   if (!(pl = open_playlist()))
+      return false;
+   push_entry(pl, "/roms/test/alpha.bin", "Alpha");
+   push_entry(pl, "/roms/test/beta.bin",  "Beta");
+   for (i = 0; i < FILLERS; i++)
+   {
+      char rom[128], label[32];
+      snprintf(rom, sizeof(rom),
+            "/roms/test/a/directory/deep/enough/to/pad/filler%03u.bin", i);
+      snprintf(label, sizeof(label), "Filler %03u", i);
+      push_entry(pl, rom, label);
+   }
+   playlist_write_file(pl);
+   playlist_free(pl);
+   return true;
+}
+
+static void remove_tree(const char *dir)
+{
+   libretro_vfs_implementation_dir *d = retro_vfs_opendir_impl(dir, true);
+   char path[400];
+
+   while (d && retro_vfs_readdir_impl(d))
+   {
+      const char *name = retro_vfs_dirent_get_name_impl(d);
+      if (!strcmp(name, ".") || !strcmp(name, ".."))
+         continue;
+      snprintf(path, sizeof(path), "%s/%s", dir, name);
+      if (retro_vfs_dirent_is_dir_impl(d))
+         remove_tree(path);
+      else
+         remove(path);
+   }
+   if (d)
+      retro_vfs_closedir_impl(d);
+   rmdir(dir);
+}
+
+/* Builds the state and checks every entry's genre is its own game's.
+ * Returns the state's entry count, sets *cached to whether it came
+ * from the cache. */
+static size_t build(const char *lane, bool *cached)
+{
+   explore_state_t *state = menu_explore_build_list(dir_playlist,
+         dir_database);
+   size_t i, n;
+
+   if (!state)
+   {
+      CHECK(false, "%s: no state", lane);
+      return 0;
+   }
+   *cached = state->cache_image != NULL;
+   n       = RBUF_LEN(state->entries);
+
+   for (i = 0; i < n; i++)
+   {
+      const explore_entry_t *e   = &state->entries[i];
+      const char *label          = e->playlist_entry
+         ? e->playlist_entry->label : NULL;
+      const explore_string_t *g  = e->by[EXPLORE_BY_GENRE];
+      const char *want           = NULL;
+      size_t k;
+
+      for (k = 0; k < sizeof(games) / sizeof(games[0]); k++)
+         if (label && !strcmp(label, games[k].name))
+            want = games[k].genre;
+      CHECK(want && g && !strcmp(g->str, want),
+            "%s: entry %u is \"%s\" under genre \"%s\"", lane,
+            (unsigned)i, label ? label : "(none)", g ? g->str : "(none)");
+   }
+
+   menu_explore_free_state(state);
+   free(state);
+   return n;
+}
+
+/* ------------------------------------------------------------------ */
+/* Lanes                                                              */
+/* ------------------------------------------------------------------ */
+
+static void lane_hit(void)
+{
+   unsigned had = failures;
+   bool cached  = true;
+
+   CHECK(build("hit", &cached) == 2, "hit: first build lost a game");
+   CHECK(!cached, "hit: first build came from a cache");
+   CHECK(build("hit", &cached) == 2, "hit: second build lost a game");
+   CHECK(cached, "hit: second build did not come from the cache");
+
+   if (failures == had)
+      fprintf(stderr, "[pass] hit lane\n");
+}
+
+static void lane_journal(void)
+{
+   char log_path[PATH_MAX_LENGTH];
+   int64_t size_before, mtime_before, size_after, mtime_after;
+   const struct playlist_entry *e = NULL;
+   unsigned had  = failures;
+   bool cached   = true;
+   playlist_t *pl;
+
+   path_get_size_and_mtime(lpl_path, &size_before, &mtime_before);
+
+   if (!(pl = open_playlist()))
+   {
+      CHECK(false, "journal: open");
+      return;
+   }
+   playlist_set_journaled(pl);
+   push_entry(pl, "/roms/test/alpha.bin", "Alpha");
+   playlist_write_file(pl);
+   playlist_get_index(pl, 0, &e);
+   CHECK(e && !strcmp(e->label, "Alpha"), "journal: Alpha not moved up");
+   CHECK(playlist_size(pl) == FILLERS + 2, "journal: entry count changed");
+   playlist_free(pl);
+
+   playlist_get_journal_path(lpl_path, log_path, sizeof(log_path));
+   CHECK(path_is_valid(log_path), "journal: no log written");
+   path_get_size_and_mtime(lpl_path, &size_after, &mtime_after);
+   CHECK(size_before == size_after && mtime_before == mtime_after,
+         "journal: the .lpl was rewritten");
+
+   CHECK(build("journal", &cached) == 2, "journal: rebuild lost a game");
+   CHECK(!cached, "journal: came from a cache older than the log");
+   CHECK(build("journal", &cached) == 2, "journal: second build lost a game");
+   CHECK(cached, "journal: the rebuilt cache was not taken back");
+
+   if (failures == had)
+      fprintf(stderr, "[pass] journal lane\n");
+}
+
+int main(void)
+{
+   if (!make_fixture())
+   {
+      fprintf(stderr, "FAIL explore_cache_test: no fixture\n");
+      return 1;
+   }
+
+   lane_hit();
+   lane_journal();
+
+   remove_tree(dir_root);
+
+   if (failures)
+   {
+      fprintf(stderr, "FAIL explore_cache_test: %u failures\n", failures);
+      return 1;
+   }
+   fprintf(stderr, "PASS explore_cache_test\n");
+   return 0;
+}
@@ -0,0 +1,1214 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (netplay_delta_test.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Oracle for netplay's paged rollback states: the page store
+ * (network/netplay/netplay_pages.c) and the frame states built on it
+ * (network/netplay/netplay_delta.c), compiled from the tree.  Each
+ * peer is a netplay_t holding only what those two files use.
+ *
+ *   refcount - interning the same bytes twice is one page with two
+ *              references; it goes at the last unref and its id is
+ *              reused; the zero page is never counted.
+ *   ring     - a ring of frames driven by random stores, shares,
+ *              scribbles on the working buffer and loads, checked at
+ *              every load against the flat copy per frame netplay kept
+ *              before pages, and after every step for leaked or
+ *              duplicated pages.
+ *   invalidate - a working buffer written with no frame to keep it
+ *              is not trusted by the next load.
+ *
+ * Then a server and a client exchange savestates over zstd, as
+ * NETPLAY_CMD_LOAD_SAVESTATE and NETPLAY_CMD_LOAD_SAVESTATE_DELTA.  The
+ * test's sender and receiver mirror netplay_send_savestate() and the
+ * two command handlers in netplay_frontend.c - the wire framing and
+ * the size checks - around the shipping code that builds and applies
+ * the deltas; the wire is a buffer rather than a socket.
+ *
+ *   delta    - a run of states, each a few pages off the last, goes as
+ *              deltas, and every one the client loads is the server's
+ *              byte for byte; an unchanged state is a delta of nothing.
+ *   fallback - the whole state goes when over half the pages changed,
+ *              when the size did, and to a peer before protocol 8; a
+ *              client whose base is not the server's refuses the delta,
+ *              keeps its frame, and NETPLAY_CMD_REQUEST_FULL_SAVESTATE
+ *              gets it the whole state.
+ *   malformed - truncated, oversized and wrongly sized payloads, runs
+ *              past the state, and a wrong digest are refused, and the
+ *              frame and the base are left as they were.
+ *
+ * And a client whose state went astray asks for repairs, as
+ * NETPLAY_CMD_BLOCK_HASHES and NETPLAY_CMD_REPAIR_SAVESTATE.
+ *
+ *   repair   - one corrupt block is the one run the server sends, and
+ *              the only page of the client's frame that changes; a
+ *              partial last block, the state past the core's memory,
+ *              several runs, and the fallbacks to the whole state; a
+ *              wrong root or broken runs leave the frame as it was.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <boolean.h>
+
+#include "../../../network/netplay/netplay_private.h"
+
+static unsigned failures = 0;
+
+#define CHECK(cond, ...) \
+   do { \
+      if (!(cond)) \
+      { \
+         fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__); \
+         fprintf(stderr, __VA_ARGS__); \
+         fprintf(stderr, "\n"); \
+         failures++; \
+      } \
+   } while (0)
+
+static uint32_t rng_state = 0x12345678u;
+
+static uint32_t rng(void)
+{
+   rng_state ^= rng_state << 13;
+   rng_state ^= rng_state >> 17;
+   rng_state ^= rng_state << 5;
+   return rng_state;
+}
+
+static void fill(uint8_t *buf, size_t len)
+{
+   size_t i;
+   for (i = 0; i < len; i++)
+      buf[i] = (uint8_t)rng();
+}
+
+/* A peer whose ring has @frames frames of @state_size byte states */
+static netplay_t *peer_new(size_t state_size, size_t frames)
+{
+   netplay_t *netplay = (netplay_t*)calloc(1, sizeof(*netplay));
+
+   if (!netplay)
+      return NULL;
+   netplay->pages       = netplay_pages_new();
+   netplay->buffer      = (struct delta_frame*)calloc(frames,
+         sizeof(*netplay->buffer));
+   netplay->buffer_size = frames;
+   netplay->coremem_size = state_size;
+   /* From nothing, growing is the initial allocation */
+   if (     !netplay->pages
+         || !netplay->buffer
+         || !netplay_grow_states(netplay, state_size))
+      abort();
+   netplay->zbuffer_size = state_size * 2;
+   if (!(netplay->zbuffer = (uint8_t*)calloc(1, netplay->zbuffer_size)))
+      abort();
+   return netplay;
+}
+
+static void peer_free(netplay_t *netplay)
+{
+   size_t i;
+   for (i = 0; i < netplay->buffer_size; i++)
+      free(netplay->buffer[i].pages);
+   free(netplay->buffer);
+   free(netplay->work_pages);
+   free(netplay->state_work);
+   free(netplay->state_hashes);
+   free(netplay->zbuffer);
+   netplay_pages_free(netplay->pages);
+   free(netplay);
+}
+
+/* Drop every reference the frames and the mirror hold; the store must
+ * be back to the zero page alone. */
+static bool peer_release(netplay_t *netplay)
+{
+   size_t i, j;
+   for (i = 0; i < netplay->buffer_size; i++)
+      for (j = 0; j < netplay->state_pages; j++)
+      {
+         netplay_pages_unref(netplay->pages, netplay->buffer[i].pages[j]);
+         netplay->buffer[i].pages[j] = NETPLAY_PAGE_ZERO;
+      }
+   netplay_state_invalidate(netplay);
+   return netplay_pages_count(netplay->pages) == 1;
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+   uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+   return (x > y) - (x < y);
+}
+
+/* Every live page is referenced by a frame or the mirror, and no two
+ * hold the same bytes. */
+static bool peer_consistent(netplay_t *netplay)
+{
+   size_t i, j, n = 0, distinct = 0;
+   size_t max     = (netplay->buffer_size + 1) * netplay->state_pages + 1;
+   uint32_t *ids  = (uint32_t*)malloc(max * sizeof(*ids));
+   bool ok        = true;
+
+   ids[n++] = NETPLAY_PAGE_ZERO;
+   for (i = 0; i < netplay->buffer_size; i++)
+      for (j = 0; j < netplay->state_pages; j++)
+         ids[n++] = netplay->buffer[i].pages[j];
+   for (j = 0; j < netplay->state_pages; j++)
+      if (netplay->work_pages[j] != NETPLAY_PAGE_NONE)
+         ids[n++] = netplay->work_pages[j];
+   qsort(ids, n, sizeof(*ids), cmp_u32);
+
+   for (i = 0; i < n; i++)
+   {
+      if (i && ids[i] == ids[i - 1])
+         continue;
+      for (j = 0; j < distinct; j++)
+         if (!memcmp(netplay_pages_get(netplay->pages, ids[i]),
+                  netplay_pages_get(netplay->pages, ids[j]),
+                  NETPLAY_PAGE_SIZE))
+            ok = false;
+      ids[distinct++] = ids[i];
+   }
+
+   ok = ok && netplay_pages_count(netplay->pages) == distinct;
+   free(ids);
+   return ok;
+}
+
+static void lane_refcount(void)
+{
+   uint8_t a[NETPLAY_PAGE_SIZE], b[NETPLAY_PAGE_SIZE];
+   uint8_t zero[NETPLAY_PAGE_SIZE] = {0};
+   uint32_t id_a, id_a2, id_b;
+   unsigned had           = failures;
+   netplay_pages_t *pages = netplay_pages_new();
+
+   fill(a, sizeof(a));
+   fill(b, sizeof(b));
+
+   CHECK(netplay_pages_count(pages) == 1, "new store is not the zero page");
+   CHECK(netplay_pages_intern(pages, zero) == NETPLAY_PAGE_ZERO,
+         "zeros not interned as the zero page");
+   CHECK(netplay_pages_count(pages) == 1, "zero page counted twice");
+
+   id_a  = netplay_pages_intern(pages, a);
+   id_a2 = netplay_pages_intern(pages, a);
+   CHECK(id_a == id_a2 && id_a != NETPLAY_PAGE_ZERO,
+         "same bytes interned as %u and %u", id_a, id_a2);
+   CHECK(netplay_pages_count(pages) == 2, "duplicate page stored");
+   CHECK(!memcmp(netplay_pages_get(pages, id_a), a, sizeof(a)),
+         "page does not hold its bytes");
+   CHECK(netplay_pages_hash(pages, id_a)
+         == netplay_pages_hash_data(a, sizeof(a)), "stored hash differs");
+
+   netplay_pages_unref(pages, id_a);
+   CHECK(netplay_pages_count(pages) == 2, "page dropped with a reference left");
+   netplay_pages_ref(pages, id_a);
+   netplay_pages_unref(pages, id_a);
+   netplay_pages_unref(pages, id_a);
+   CHECK(netplay_pages_count(pages) == 1, "page kept after its last unref");
+
+   /* Its slot is taken by the next page, and the old bytes are gone */
+   id_b = netplay_pages_intern(pages, b);
+   CHECK(id_b == id_a, "freed id %u not reused, got %u", id_a, id_b);
+   id_a2 = netplay_pages_intern(pages, a);
+   CHECK(id_a2 != id_b && netplay_pages_count(pages) == 3,
+         "dropped page still found");
+
+   /* The zero page and no page at all are ignored */
+   netplay_pages_unref(pages, NETPLAY_PAGE_ZERO);
+   netplay_pages_unref(pages, NETPLAY_PAGE_NONE);
+   netplay_pages_ref(pages, NETPLAY_PAGE_ZERO);
+   CHECK(netplay_pages_count(pages) == 3, "zero page refcounted");
+
+   netplay_pages_free(pages);
+   if (failures == had)
+      fprintf(stderr, "[pass] refcount lane\n");
+}
+
+#define RING_FRAMES 8
+#define RING_STEPS  3000
+/* Ten whole pages and a partial one */
+#define RING_SIZE   (10 * NETPLAY_PAGE_SIZE + 100)
+
+static void lane_ring(void)
+{
+   static uint8_t flat[RING_FRAMES][RING_SIZE];
+   static uint8_t core[RING_SIZE];
+   unsigned step;
+   unsigned loads         = 0;
+   unsigned had           = failures;
+   netplay_t *netplay     = peer_new(RING_SIZE, RING_FRAMES);
+   size_t tail            = netplay->state_pages * NETPLAY_PAGE_SIZE;
+
+   fill(core, sizeof(core));
+   memset(flat, 0, sizeof(flat));
+
+   for (step = 0; step < RING_STEPS && failures == had; step++)
+   {
+      unsigned slot = step % RING_FRAMES;
+      unsigned op   = rng() % 8;
+      unsigned k, n = rng() % 4;
+
+      /* The core runs a frame: a few bytes change, now and then a
+       * page is cleared or made a copy of another */
+      for (k = 0; k < n; k++)
+         core[rng() % RING_SIZE] ^= (uint8_t)(1 + rng() % 255);
+      if (rng() % 16 == 0)
+         memset(core + (rng() % 10) * NETPLAY_PAGE_SIZE, 0,
+               NETPLAY_PAGE_SIZE);
+      if (rng() % 16 == 0)
+         memcpy(core + (rng() % 10) * NETPLAY_PAGE_SIZE,
+               core + (rng() % 10) * NETPLAY_PAGE_SIZE, NETPLAY_PAGE_SIZE);
+
+      CHECK(netplay_delta_frame_put(netplay, &netplay->buffer[slot],
+               core, RING_SIZE), "store failed at step %u", step);
+      memcpy(flat[slot], core, RING_SIZE);
+
+      if (op == 0)
+      {
+         unsigned dst = rng() % RING_FRAMES, src = rng() % RING_FRAMES;
+         netplay_delta_frame_share(netplay, &netplay->buffer[dst],
+               &netplay->buffer[src]);
+         memmove(flat[dst], flat[src], RING_SIZE);
+      }
+      else if (op < 5)
+      {
+         unsigned s = rng() % RING_FRAMES;
+         const uint8_t *p;
+         size_t i;
+
+         /* Something wrote over the working buffer and kept nothing,
+          * as a failed decompress does */
+         if (op == 1)
+         {
+            fill(netplay->state_work, tail);
+            netplay_state_invalidate(netplay);
+         }
+
+         p = netplay_delta_frame_load(netplay, &netplay->buffer[s]);
+
+         CHECK(!memcmp(p, flat[s], RING_SIZE),
+               "frame %u differs from its flat copy at step %u", s, step);
+         for (i = RING_SIZE; i < tail && !p[i]; i++);
+         CHECK(i == tail, "frame %u not zero past its end", s);
+         loads++;
+      }
+
+      CHECK(peer_consistent(netplay),
+            "pages leaked or duplicated at step %u", step);
+   }
+
+   /* Eleven pages a frame, but consecutive frames share nearly all */
+   CHECK(netplay_pages_count(netplay->pages)
+         < (RING_FRAMES * netplay->state_pages) / 2,
+         "%u pages live for %u frames",
+         (unsigned)netplay_pages_count(netplay->pages), RING_FRAMES);
+   CHECK(loads > RING_STEPS / 4, "only %u loads", loads);
+   CHECK(peer_release(netplay), "references left after releasing all");
+
+   peer_free(netplay);
+   if (failures == had)
+      fprintf(stderr, "[pass] ring lane\n");
+}
+
+static void lane_invalidate(void)
+{
+   static uint8_t a[RING_SIZE], b[RING_SIZE];
+   const uint8_t *p;
+   unsigned had       = failures;
+   netplay_t *netplay = peer_new(RING_SIZE, 2);
+
+   fill(a, sizeof(a));
+   memcpy(b, a, sizeof(b));
+   b[5 * NETPLAY_PAGE_SIZE] ^= 1;
+
+   netplay_delta_frame_put(netplay, &netplay->buffer[0], a, RING_SIZE);
+   netplay_delta_frame_put(netplay, &netplay->buffer[1], b, RING_SIZE);
+
+   /* The mirror holds frame 1; frame 0 differs by one page */
+   p = netplay_delta_frame_load(netplay, &netplay->buffer[0]);
+   CHECK(!memcmp(p, a, RING_SIZE), "frame 0 not loaded");
+
+   /* Scribble over every page, then let the store know */
+   memset(netplay->state_work, 0xAA, RING_SIZE);
+   netplay_state_invalidate(netplay);
+   p = netplay_delta_frame_load(netplay, &netplay->buffer[0]);
+   CHECK(!memcmp(p, a, RING_SIZE), "scribbled pages survived a load");
+
+   /* A store over an invalidated mirror hashes afresh and still
+    * finds the frames' pages */
+   memset(netplay->state_work, 0x55, RING_SIZE);
+   netplay_state_invalidate(netplay);
+   netplay_delta_frame_put(netplay, &netplay->buffer[1], a, RING_SIZE);
+   CHECK(!memcmp(netplay->buffer[0].pages, netplay->buffer[1].pages,
+            netplay->state_pages * sizeof(uint32_t)),
+         "equal states do not share their pages");
+   CHECK(peer_consistent(netplay), "pages leaked or duplicated");
+   CHECK(peer_release(netplay), "references left after releasing all");
+
+   peer_free(netplay);
+   if (failures == had)
+      fprintf(stderr, "[pass] invalidate lane\n");
+}
+
+/* A server and a client, and each one's connection to the other */
+struct link
+{
+   netplay_t *server;
+   netplay_t *client;
+   struct netplay_connection to_client;
+   struct netplay_connection to_server;
+   struct compression_transcoder zstd;
+   uint8_t *scratch;
+   uint8_t *wire;
+   size_t wire_size;
+   size_t wire_len;
+   uint32_t frame;
+};
+
+enum sent
+{
+   SENT_WHOLE = 0,
+   SENT_DELTA
+};
+
+enum received
+{
+   RECEIVED_LOADED = 0,
+   /* The delta was refused and the whole state asked for */
+   RECEIVED_REFUSED,
+   RECEIVED_NAK
+};
+
+static void link_init(struct link *link, size_t state_size,
+      uint32_t protocol)
+{
+   memset(link, 0, sizeof(*link));
+   link->server = peer_new(state_size, 2);
+   link->client = peer_new(state_size, 2);
+   link->to_client.netplay_protocol = protocol;
+   link->to_server.netplay_protocol = protocol;
+   link->zstd.compression_backend   = &zstd_compress_backend;
+   link->zstd.decompression_backend = &zstd_decompress_backend;
+   link->zstd.compression_stream    =
+      link->zstd.compression_backend->stream_new();
+   link->zstd.decompression_stream  =
+      link->zstd.decompression_backend->stream_new();
+   link->wire_size = 7 * sizeof(uint32_t) + state_size * 2;
+   link->wire      = (uint8_t*)malloc(link->wire_size);
+   if (!link->wire)
+      abort();
+}
+
+static bool link_deinit(struct link *link)
+{
+   bool ok;
+   netplay_connection_drop_base(link->server, &link->to_client);
+   netplay_connection_drop_base(link->client, &link->to_server);
+   ok =     peer_release(link->server)
+         && peer_release(link->client);
+   peer_free(link->server);
+   peer_free(link->client);
+   link->zstd.compression_backend->stream_free(
+         link->zstd.compression_stream);
+   link->zstd.decompression_backend->stream_free(
+         link->zstd.decompression_stream);
+   free(link->scratch);
+   free(link->wire);
+   return ok;
+}
+
+static void wire_put(struct link *link, const void *data, size_t len)
+{
+   if (link->wire_len + len > link->wire_size)
+      abort();
+   memcpy(link->wire + link->wire_len, data, len);
+   link->wire_len += len;
+}
+
+/* As netplay_send_savestate_delta() */
+static bool send_delta(struct link *link, uint32_t size,
+      const uint32_t *pages, uint32_t digest)
+{
+   uint32_t header[7];
+   uint32_t wn     = 0;
+   size_t _len     = 0;
+   size_t raw_size = size / 2;
+   size_t zsize    = raw_size + raw_size / 8 + 1024;
+   uint8_t *raw, *zraw;
+
+   if (     !link->to_client.base_pages
+         ||  link->to_client.base_size != size)
+      return false;
+   if (!link->scratch
+         && !(link->scratch = (uint8_t*)malloc(raw_size + zsize)))
+      abort();
+   raw  = link->scratch;
+   zraw = raw + raw_size;
+
+   if (     !netplay_state_delta_runs(link->server, &link->to_client,
+               pages, size, raw, raw_size, &_len)
+         || !netplay_runs_compress(&link->zstd, raw, _len, zraw, zsize, &wn))
+      return false;
+
+   header[0] = htonl(NETPLAY_CMD_LOAD_SAVESTATE_DELTA);
+   header[1] = htonl(wn + 5*sizeof(uint32_t));
+   header[2] = htonl(link->frame);
+   header[3] = htonl(size);
+   header[4] = htonl(link->to_client.base_digest);
+   header[5] = htonl(digest);
+   header[6] = htonl((uint32_t)_len);
+   wire_put(link, header, sizeof(header));
+   wire_put(link, zraw, wn);
+
+   netplay_connection_set_base(link->server, &link->to_client, pages,
+         size, digest);
+   return true;
+}
+
+/* As netplay_send_savestate(), with the state stored in the server's
+ * frame first as netplay_load_savestate() does */
+static enum sent server_send(struct link *link, const uint8_t *data,
+      uint32_t size)
+{
+   uint32_t header[4];
+   uint32_t rd, wn   = 0;
+   uint32_t digest   = 0;
+   netplay_t *server = link->server;
+   struct delta_frame *delta;
+   const uint32_t *pages;
+
+   link->frame++;
+   link->wire_len = 0;
+   delta          = &server->buffer[link->frame % 2];
+   if (!netplay_delta_frame_put(server, delta, data, size))
+      abort();
+   pages = delta->pages;
+   if (!netplay_state_digest(server, pages,
+            (size + NETPLAY_PAGE_SIZE - 1) / NETPLAY_PAGE_SIZE, &digest))
+      pages = NULL;
+
+   if (     pages
+         && link->to_client.netplay_protocol >= 8
+         && send_delta(link, size, pages, digest))
+      return SENT_DELTA;
+
+   link->zstd.compression_backend->set_in(link->zstd.compression_stream,
+         data, size);
+   link->zstd.compression_backend->set_out(link->zstd.compression_stream,
+         server->zbuffer, (uint32_t)server->zbuffer_size);
+   if (!link->zstd.compression_backend->trans(
+            link->zstd.compression_stream, true, &rd, &wn, NULL))
+      abort();
+   header[0] = htonl(NETPLAY_CMD_LOAD_SAVESTATE);
+   header[1] = htonl(wn + 2*sizeof(uint32_t));
+   header[2] = htonl(link->frame);
+   header[3] = htonl(size);
+   wire_put(link, header, sizeof(header));
+   wire_put(link, server->zbuffer, wn);
+
+   if (!pages)
+      netplay_connection_drop_base(server, &link->to_client);
+   else if (link->to_client.netplay_protocol >= 8)
+      netplay_connection_set_base(server, &link->to_client, pages,
+            size, digest);
+   return SENT_WHOLE;
+}
+
+/* As the client's NETPLAY_CMD_LOAD_SAVESTATE(_DELTA) handlers, loading
+ * into @delta */
+static enum received client_recv(struct link *link,
+      struct delta_frame *delta)
+{
+   uint32_t header[2], cmd, cmd_size;
+   const uint8_t *in = link->wire + sizeof(header);
+   netplay_t *client = link->client;
+
+   if (link->wire_len < sizeof(header))
+      return RECEIVED_NAK;
+   memcpy(header, link->wire, sizeof(header));
+   cmd      = ntohl(header[0]);
+   cmd_size = ntohl(header[1]);
+   if (cmd_size != link->wire_len - sizeof(header))
+      return RECEIVED_NAK;
+
+   if (cmd == NETPLAY_CMD_LOAD_SAVESTATE)
+   {
+      uint32_t payload[2], state_size, state_size_raw, rd, wn;
+      enum trans_stream_error zerr = TRANS_STREAM_ERROR_NONE;
+
+      if (cmd_size < sizeof(payload))
+         return RECEIVED_NAK;
+      memcpy(payload, in, sizeof(payload));
+      state_size     = ntohl(payload[1]);
+      state_size_raw = cmd_size - sizeof(payload);
+      if (state_size_raw > client->zbuffer_size)
+         return RECEIVED_NAK;
+      memcpy(client->zbuffer, in + sizeof(payload), state_size_raw);
+
+      if (     state_size > client->state_size
+            && !netplay_grow_states(client, state_size))
+         return RECEIVED_NAK;
+      link->zstd.decompression_backend->set_in(
+            link->zstd.decompression_stream,
+            client->zbuffer, state_size_raw);
+      link->zstd.decompression_backend->set_out(
+            link->zstd.decompression_stream,
+            client->state_work, state_size);
+      if (!link->zstd.decompression_backend->trans(
+               link->zstd.decompression_stream, true, &rd, &wn, &zerr)
+            || zerr != TRANS_STREAM_ERROR_NONE
+            || wn   != state_size)
+      {
+         netplay_state_invalidate(client);
+         return RECEIVED_NAK;
+      }
+      if (!netplay_delta_frame_take(client, &link->to_server, delta,
+               state_size))
+         return RECEIVED_NAK;
+      return RECEIVED_LOADED;
+   }
+
+   if (cmd == NETPLAY_CMD_LOAD_SAVESTATE_DELTA)
+   {
+      uint32_t payload[5], state_size_raw;
+
+      if (cmd_size < sizeof(payload))
+         return RECEIVED_NAK;
+      memcpy(payload, in, sizeof(payload));
+      state_size_raw = cmd_size - sizeof(payload);
+      if (state_size_raw > client->zbuffer_size)
+         return RECEIVED_NAK;
+      memcpy(client->zbuffer, in + sizeof(payload), state_size_raw);
+
+      if (netplay_delta_frame_apply(client, &link->to_server, &link->zstd,
+               delta, ntohl(payload[1]), ntohl(payload[2]),
+               ntohl(payload[3]), ntohl(payload[4]), state_size_raw))
+         return RECEIVED_LOADED;
+
+      /* netplay_cmd_request_full_savestate(), and the server's
+       * NETPLAY_CMD_REQUEST_FULL_SAVESTATE handler */
+      netplay_connection_drop_base(client, &link->to_server);
+      netplay_connection_drop_base(link->server, &link->to_client);
+      return RECEIVED_REFUSED;
+   }
+
+   return RECEIVED_NAK;
+}
+
+/* The client's frame holds the server's last state */
+static bool client_holds(struct link *link, struct delta_frame *delta,
+      const uint8_t *data, size_t size)
+{
+   const uint8_t *p = netplay_delta_frame_load(link->client, delta);
+   return !memcmp(p, data, size);
+}
+
+#define LINK_SIZE (24 * NETPLAY_PAGE_SIZE + 1000)
+
+static void lane_delta(void)
+{
+   static uint8_t core[LINK_SIZE];
+   struct link link;
+   unsigned step;
+   unsigned deltas   = 0;
+   unsigned had      = failures;
+   size_t delta_wire = 0;
+   size_t whole_wire;
+   struct delta_frame *delta;
+
+   link_init(&link, LINK_SIZE, NETPLAY_PROTOCOL_VERSION);
+   delta = &link.client->buffer[0];
+   fill(core, sizeof(core));
+
+   CHECK(server_send(&link, core, LINK_SIZE) == SENT_WHOLE,
+         "first state sent as a delta");
+   whole_wire = link.wire_len;
+   CHECK(client_recv(&link, delta) == RECEIVED_LOADED
+         && client_holds(&link, delta, core, LINK_SIZE),
+         "whole state not loaded");
+
+   for (step = 0; step < 200 && failures == had; step++)
+   {
+      unsigned k, n = 1 + rng() % 3;
+      for (k = 0; k < n; k++)
+         core[rng() % LINK_SIZE] ^= (uint8_t)(1 + rng() % 255);
+
+      if (server_send(&link, core, LINK_SIZE) == SENT_DELTA)
+      {
+         deltas++;
+         delta_wire += link.wire_len;
+      }
+      /* Alternate frames, as the ring would */
+      delta = &link.client->buffer[step % 2];
+      CHECK(client_recv(&link, delta) == RECEIVED_LOADED,
+            "state %u not loaded", step);
+      CHECK(client_holds(&link, delta, core, LINK_SIZE),
+            "state %u differs from the server's", step);
+   }
+   CHECK(deltas == 200, "only %u of 200 states went as deltas", deltas);
+   CHECK(delta_wire / 200 < whole_wire / 4,
+         "deltas average %u bytes against %u whole",
+         (unsigned)(delta_wire / 200), (unsigned)whole_wire);
+
+   /* Nothing changed: a delta with no runs at all */
+   CHECK(server_send(&link, core, LINK_SIZE) == SENT_DELTA
+         && link.wire_len == 7 * sizeof(uint32_t),
+         "unchanged state not an empty delta (%u bytes)",
+         (unsigned)link.wire_len);
+   CHECK(client_recv(&link, delta) == RECEIVED_LOADED
+         && client_holds(&link, delta, core, LINK_SIZE),
+         "empty delta not loaded");
+
+   CHECK(peer_consistent(link.server) && peer_consistent(link.client),
+         "pages leaked or duplicated");
+   CHECK(link_deinit(&link), "references left after releasing all");
+   if (failures == had)
+      fprintf(stderr, "[pass] delta lane\n");
+}
+
+/* Send, receive, and check the client ends up with @core */
+static bool exchange(struct link *link, const uint8_t *core, uint32_t size,
+      enum sent expect)
+{
+   struct delta_frame *delta = &link->client->buffer[link->frame % 2];
+   return server_send(link, core, size) == expect
+      && client_recv(link, delta) == RECEIVED_LOADED
+      && client_holds(link, delta, core, size);
+}
+
+static void lane_fallback(void)
+{
+   static uint8_t core[LINK_SIZE];
+   struct link link;
+   struct delta_frame *delta;
+   uint32_t before[LINK_SIZE / NETPLAY_PAGE_SIZE + 1];
+   size_t i;
+   unsigned had = failures;
+
+   link_init(&link, LINK_SIZE, NETPLAY_PROTOCOL_VERSION);
+   fill(core, sizeof(core));
+   CHECK(exchange(&link, core, LINK_SIZE, SENT_WHOLE), "first state");
+   core[10] ^= 1;
+   CHECK(exchange(&link, core, LINK_SIZE, SENT_DELTA), "small change");
+
+   /* Over half the pages: the whole state is about as cheap */
+   for (i = 0; i < 14; i++)
+      core[i * NETPLAY_PAGE_SIZE + 7] ^= 1;
+   CHECK(exchange(&link, core, LINK_SIZE, SENT_WHOLE),
+         "over half the state went as a delta");
+   core[20] ^= 1;
+   CHECK(exchange(&link, core, LINK_SIZE, SENT_DELTA),
+         "no delta after a whole state");
+
+   /* A different size has no base */
+   CHECK(exchange(&link, core, LINK_SIZE - 500, SENT_WHOLE),
+         "resized state went as a delta");
+   CHECK(exchange(&link, core, LINK_SIZE - 500, SENT_DELTA),
+         "no delta at the new size");
+
+   /* The client's base is gone, as after a failed load of its own */
+   netplay_connection_drop_base(link.client, &link.to_server);
+   core[30] ^= 1;
+   delta = &link.client->buffer[(link.frame + 1) % 2];
+   memcpy(before, delta->pages, link.client->state_pages * sizeof(uint32_t));
+   CHECK(server_send(&link, core, LINK_SIZE - 500) == SENT_DELTA,
+         "server did not send a delta");
+   CHECK(client_recv(&link, delta) == RECEIVED_REFUSED,
+         "delta applied over no base");
+   CHECK(!memcmp(before, delta->pages,
+            link.client->state_pages * sizeof(uint32_t)),
+         "refused delta changed the frame");
+   CHECK(!link.to_client.base_pages, "server kept its base");
+   CHECK(exchange(&link, core, LINK_SIZE - 500, SENT_WHOLE),
+         "whole state not sent on request");
+   core[40] ^= 1;
+   CHECK(exchange(&link, core, LINK_SIZE - 500, SENT_DELTA),
+         "no delta after the requested state");
+
+   /* The client's base is another state than the server's */
+   link.to_server.base_digest ^= 1;
+   core[50] ^= 1;
+   CHECK(server_send(&link, core, LINK_SIZE - 500) == SENT_DELTA
+         && client_recv(&link, &link.client->buffer[link.frame % 2])
+            == RECEIVED_REFUSED,
+         "delta applied over a different base");
+   CHECK(exchange(&link, core, LINK_SIZE - 500, SENT_WHOLE),
+         "whole state not sent on request");
+   CHECK(link_deinit(&link), "references left after releasing all");
+
+   /* Before protocol 8 there are no bases, and every state goes whole */
+   link_init(&link, LINK_SIZE, 7);
+   for (i = 0; i < 3; i++)
+   {
+      core[i] ^= 1;
+      CHECK(exchange(&link, core, LINK_SIZE, SENT_WHOLE),
+            "protocol 7 state %u", (unsigned)i);
+   }
+   CHECK(!link.to_client.base_pages && !link.to_server.base_pages,
+         "base kept before protocol 8");
+   CHECK(link_deinit(&link), "references left after releasing all");
+
+   if (failures == had)
+      fprintf(stderr, "[pass] fallback lane\n");
+}
+
+/* The last delta's payload field @field, 0 frame .. 4 runs size */
+static void wire_field(struct link *link, unsigned field, uint32_t value)
+{
+   uint32_t v = htonl(value);
+   memcpy(link->wire + (2 + field) * sizeof(uint32_t), &v, sizeof(v));
+}
+
+static uint32_t wire_get(struct link *link, unsigned field)
+{
+   uint32_t v;
+   memcpy(&v, link->wire + (2 + field) * sizeof(uint32_t), sizeof(v));
+   return ntohl(v);
+}
+
+/* Apply the delta on the wire as the handler does, but without the
+ * request for the whole state a refusal makes, so the base survives
+ * for the next case */
+static bool wire_apply(struct link *link, struct delta_frame *delta)
+{
+   size_t zsize = link->wire_len - 7 * sizeof(uint32_t);
+   memcpy(link->client->zbuffer, link->wire + 7 * sizeof(uint32_t), zsize);
+   return netplay_delta_frame_apply(link->client, &link->to_server,
+         &link->zstd, delta, wire_get(link, 1), wire_get(link, 2),
+         wire_get(link, 3), wire_get(link, 4), (uint32_t)zsize);
+}
+
+/* A delta over the client's base carrying @len bytes of made-up runs */
+static void wire_runs(struct link *link, const uint8_t *raw, size_t len)
+{
+   uint32_t header[2];
+   uint32_t wn = 0;
+
+   link->wire_len = 7 * sizeof(uint32_t);
+   if (!netplay_runs_compress(&link->zstd, raw, len,
+            link->wire + link->wire_len,
+            link->wire_size - link->wire_len, &wn))
+      abort();
+   link->wire_len += wn;
+   header[0] = htonl(NETPLAY_CMD_LOAD_SAVESTATE_DELTA);
+   header[1] = htonl(wn + 5*sizeof(uint32_t));
+   memcpy(link->wire, header, sizeof(header));
+   wire_field(link, 1, link->to_server.base_size);
+   wire_field(link, 2, link->to_server.base_digest);
+   wire_field(link, 4, (uint32_t)len);
+}
+
+static void lane_malformed(void)
+{
+   static uint8_t core[LINK_SIZE];
+   static uint8_t sent[7 * sizeof(uint32_t) + 2 * LINK_SIZE];
+   static uint8_t raw[2 * sizeof(uint32_t) + 2 * NETPLAY_PAGE_SIZE];
+   static const char *what[] = {
+      "runs shorter than their compressed size says",
+      "runs past the largest delta",
+      "runs larger than said",
+      "runs smaller than said",
+      "wrong result digest",
+      "wrong base digest",
+      "wrong state size",
+      "run past the last page",
+      "run over the last page",
+      "run longer than its pages",
+      "half a run header"
+   };
+   uint32_t before[LINK_SIZE / NETPLAY_PAGE_SIZE + 1];
+   uint32_t run[2], header[2], base_digest;
+   size_t sent_len, i, npages;
+   struct link link;
+   struct delta_frame *delta;
+   unsigned had = failures;
+
+   link_init(&link, LINK_SIZE, NETPLAY_PROTOCOL_VERSION);
+   npages = link.client->state_pages;
+   fill(core, sizeof(core));
+   CHECK(exchange(&link, core, LINK_SIZE, SENT_WHOLE), "first state");
+
+   /* One good delta, mangled a copy at a time */
+   core[100] ^= 1;
+   core[5 * NETPLAY_PAGE_SIZE] ^= 1;
+   CHECK(server_send(&link, core, LINK_SIZE) == SENT_DELTA, "no delta");
+   sent_len = link.wire_len;
+   memcpy(sent, link.wire, sent_len);
+   base_digest = link.to_server.base_digest;
+   delta = &link.client->buffer[link.frame % 2];
+   memcpy(before, delta->pages, npages * sizeof(uint32_t));
+
+   /* Sizes the handler refuses before anything is decompressed */
+   header[0] = htonl(NETPLAY_CMD_LOAD_SAVESTATE_DELTA);
+   header[1] = htonl(3 * sizeof(uint32_t));
+   memcpy(link.wire, header, sizeof(header));
+   link.wire_len = 5 * sizeof(uint32_t);
+   CHECK(client_recv(&link, delta) == RECEIVED_NAK,
+         "payload shorter than its fields not refused");
+   memcpy(link.wire, sent, sent_len);
+   link.wire_len = sent_len;
+   link.client->zbuffer_size = sent_len - 7 * sizeof(uint32_t) - 1;
+   CHECK(client_recv(&link, delta) == RECEIVED_NAK,
+         "payload past the zbuffer not refused");
+   link.client->zbuffer_size = 2 * LINK_SIZE;
+
+   for (i = 0; i < sizeof(what) / sizeof(what[0]); i++)
+   {
+      memcpy(link.wire, sent, sent_len);
+      link.wire_len = sent_len;
+
+      switch (i)
+      {
+         case 0:
+            link.wire_len -= 5;
+            break;
+         case 1:
+            wire_field(&link, 4, (uint32_t)(npages
+                     * (NETPLAY_PAGE_SIZE + 2 * sizeof(uint32_t)) + 1));
+            break;
+         case 2:
+            wire_field(&link, 4, wire_get(&link, 4) + 1);
+            break;
+         case 3:
+            wire_field(&link, 4, wire_get(&link, 4) - 1);
+            break;
+         case 4:
+            wire_field(&link, 3, wire_get(&link, 3) ^ 1);
+            break;
+         case 5:
+            wire_field(&link, 2, wire_get(&link, 2) ^ 1);
+            break;
+         case 6:
+            wire_field(&link, 1, LINK_SIZE - 1);
+            break;
+         case 7:
+            run[0] = htonl((uint32_t)npages);
+            run[1] = htonl(1);
+            memcpy(raw, run, sizeof(run));
+            memset(raw + sizeof(run), 0x5A, NETPLAY_PAGE_SIZE);
+            wire_runs(&link, raw, sizeof(run) + NETPLAY_PAGE_SIZE);
+            break;
+         case 8:
+            run[0] = htonl((uint32_t)npages - 1);
+            run[1] = htonl(2);
+            memcpy(raw, run, sizeof(run));
+            memset(raw + sizeof(run), 0x5A, 2 * NETPLAY_PAGE_SIZE);
+            wire_runs(&link, raw, sizeof(run) + 2 * NETPLAY_PAGE_SIZE);
+            break;
+         case 9:
+            run[0] = htonl(0);
+            run[1] = htonl(2);
+            memcpy(raw, run, sizeof(run));
+            wire_runs(&link, raw, sizeof(run) + NETPLAY_PAGE_SIZE);
+            break;
+         case 10:
+            wire_runs(&link, raw, sizeof(uint32_t));
+            break;
+      }
+
+      CHECK(!wire_apply(&link, delta), "%s applied", what[i]);
+      CHECK(!memcmp(before, delta->pages, npages * sizeof(uint32_t)),
+            "%s changed the frame", what[i]);
+      CHECK(link.to_server.base_digest == base_digest,
+            "%s moved the base", what[i]);
+   }
+
+   /* The untouched delta still applies over the base it was made for,
+    * whatever the refused ones left in the working buffer */
+   memcpy(link.wire, sent, sent_len);
+   link.wire_len = sent_len;
+   CHECK(client_recv(&link, delta) == RECEIVED_LOADED
+         && client_holds(&link, delta, core, LINK_SIZE),
+         "good delta not loaded after the bad ones");
+   CHECK(peer_consistent(link.client), "pages leaked or duplicated");
+   CHECK(link_deinit(&link), "references left after releasing all");
+
+   if (failures == had)
+      fprintf(stderr, "[pass] malformed lane\n");
+}
+
+#define REPAIR_FRAME 1
+
+/* The server holds @server_state and the client @client_state as
+ * frame REPAIR_FRAME */
+static void repair_put(struct link *link, const uint8_t *server_state,
+      const uint8_t *client_state, size_t size)
+{
+   netplay_delta_frame_put(link->server,
+         &link->server->buffer[REPAIR_FRAME], server_state, size);
+   netplay_delta_frame_put(link->client,
+         &link->client->buffer[REPAIR_FRAME], client_state, size);
+}
+
+static uint32_t frame_root(netplay_t *netplay)
+{
+   size_t end;
+   return netplay_blocks_root(netplay, netplay_delta_frame_block_hashes(
+            netplay, &netplay->buffer[REPAIR_FRAME], &end));
+}
+
+/* As netplay_cmd_block_hashes(): the client's hashes, in network order */
+static size_t client_hashes(struct link *link, uint32_t *theirs)
+{
+   size_t i, end;
+   size_t count = netplay_delta_frame_block_hashes(link->client,
+         &link->client->buffer[REPAIR_FRAME], &end);
+   for (i = 0; i < count; i++)
+      theirs[i] = htonl(link->client->state_hashes[i]);
+   return count;
+}
+
+/* As the server's NETPLAY_CMD_BLOCK_HASHES handler and
+ * netplay_send_savestate_repair(): the runs, compressed into the
+ * client's zbuffer, or NULL for the whole state */
+static uint8_t *server_repair(struct link *link, const uint32_t *theirs,
+      size_t count, size_t *len, uint32_t *root, uint32_t *wn)
+{
+   uint8_t *raw = netplay_delta_frame_repair_runs(link->server,
+         &link->server->buffer[REPAIR_FRAME], theirs, count, len);
+   if (!raw)
+      return NULL;
+   *root = netplay_blocks_root(link->server, count);
+   if (!netplay_runs_compress(&link->zstd, raw, *len,
+            link->client->zbuffer, link->client->zbuffer_size, wn))
+      abort();
+   return raw;
+}
+
+static bool run_at(const uint8_t *raw, size_t pos, uint32_t first,
+      uint32_t count)
+{
+   uint32_t run[2];
+   memcpy(run, raw + pos, sizeof(run));
+   return ntohl(run[0]) == first && ntohl(run[1]) == count;
+}
+
+#define REPAIR_SIZE   (20 * NETPLAY_PAGE_SIZE + 500)
+/* The memory block ends part way into block 18 */
+#define REPAIR_MEMORY (18 * NETPLAY_PAGE_SIZE + 300)
+#define REPAIR_END    (REPAIR_MEMORY + 16)
+
+static void lane_repair(void)
+{
+   static uint8_t server_state[REPAIR_SIZE], client_state[REPAIR_SIZE];
+   uint32_t theirs[REPAIR_SIZE / NETPLAY_PAGE_SIZE + 1];
+   uint32_t before[REPAIR_SIZE / NETPLAY_PAGE_SIZE + 1];
+   uint32_t root, wn, v;
+   size_t i, count, len, npages;
+   const uint8_t *p;
+   uint8_t *raw;
+   struct link link;
+   struct delta_frame *delta;
+   unsigned had = failures;
+
+   link_init(&link, REPAIR_SIZE, NETPLAY_PROTOCOL_VERSION);
+   link.server->coremem_size = REPAIR_MEMORY;
+   link.client->coremem_size = REPAIR_MEMORY;
+   npages = link.client->state_pages;
+   delta  = &link.client->buffer[REPAIR_FRAME];
+
+   /* A container: its memory block first, then whatever follows it,
+    * which the peers do not fill alike */
+   fill(server_state, REPAIR_SIZE);
+   memcpy(server_state, "NETPLAY", 7);
+   server_state[7] = NETPLAYSTATE_VERSION;
+   memcpy(server_state + 8, NETPLAYSTATE_MEM_BLOCK, 4);
+   v = REPAIR_MEMORY;
+   memcpy(server_state + 12, &v, sizeof(v));
+   memcpy(client_state, server_state, REPAIR_SIZE);
+   fill(client_state + REPAIR_END, REPAIR_SIZE - REPAIR_END);
+   repair_put(&link, server_state, client_state, REPAIR_SIZE);
+
+   count = client_hashes(&link, theirs);
+   CHECK(count == 19, "%u blocks for a memory block ending in the 19th",
+         (unsigned)count);
+   CHECK(frame_root(link.server) == frame_root(link.client),
+         "state past the core's memory is hashed");
+   raw = server_repair(&link, theirs, count, &len, &root, &wn);
+   CHECK(raw && len == 0 && wn == 0, "matching states need %u bytes",
+         (unsigned)len);
+   free(raw);
+
+   /* One block of the client's memory goes astray */
+   client_state[7 * NETPLAY_PAGE_SIZE + 123] ^= 0x40;
+   repair_put(&link, server_state, client_state, REPAIR_SIZE);
+   CHECK(frame_root(link.server) != frame_root(link.client),
+         "corrupt block not seen in the root");
+   count = client_hashes(&link, theirs);
+   raw   = server_repair(&link, theirs, count, &len, &root, &wn);
+   CHECK(raw && len == 2 * sizeof(uint32_t) + NETPLAY_PAGE_SIZE
+         && run_at(raw, 0, 7, 1)
+         && !memcmp(raw + 2 * sizeof(uint32_t),
+            server_state + 7 * NETPLAY_PAGE_SIZE, NETPLAY_PAGE_SIZE),
+         "repair is not block 7 alone");
+   free(raw);
+   memcpy(before, delta->pages, npages * sizeof(uint32_t));
+   CHECK(netplay_delta_frame_repair(link.client, &link.zstd, delta, root,
+            (uint32_t)len, wn), "repair of block 7 refused");
+   for (i = 0; i < npages; i++)
+      CHECK((i == 7) == (delta->pages[i] != before[i]),
+            "page %u %s", (unsigned)i,
+            i == 7 ? "not patched" : "patched too");
+   CHECK(frame_root(link.client) == root, "repaired root differs");
+   p = netplay_delta_frame_load(link.client, delta);
+   CHECK(!memcmp(p, server_state, REPAIR_END)
+         && !memcmp(p + REPAIR_END, client_state + REPAIR_END,
+            REPAIR_SIZE - REPAIR_END),
+         "repaired state is not the server's memory and our own tail");
+   memcpy(client_state, p, REPAIR_SIZE);
+
+   /* The partial last block: only as far as the memory goes */
+   client_state[REPAIR_END - 1] ^= 1;
+   repair_put(&link, server_state, client_state, REPAIR_SIZE);
+   count = client_hashes(&link, theirs);
+   raw   = server_repair(&link, theirs, count, &len, &root, &wn);
+   CHECK(raw && len == 2 * sizeof(uint32_t)
+            + (REPAIR_END - 18 * NETPLAY_PAGE_SIZE)
+         && run_at(raw, 0, 18, 1),
+         "partial block repair is %u bytes", (unsigned)len);
+   free(raw);
+   memcpy(before, delta->pages, npages * sizeof(uint32_t));
+   CHECK(netplay_delta_frame_repair(link.client, &link.zstd, delta, root,
+            (uint32_t)len, wn), "repair of the partial block refused");
+   for (i = 0; i < npages; i++)
+      CHECK((i == 18) == (delta->pages[i] != before[i]),
+            "page %u %s", (unsigned)i,
+            i == 18 ? "not patched" : "patched too");
+   p = netplay_delta_frame_load(link.client, delta);
+   CHECK(!memcmp(p, server_state, REPAIR_END)
+         && !memcmp(p + REPAIR_END, client_state + REPAIR_END,
+            REPAIR_SIZE - REPAIR_END),
+         "partial block repair reached past the memory");
+   memcpy(client_state, p, REPAIR_SIZE);
+
+   /* Blocks 3, 5 and 6: two runs */
+   client_state[3 * NETPLAY_PAGE_SIZE] ^= 1;
+   client_state[5 * NETPLAY_PAGE_SIZE + 1] ^= 1;
+   client_state[6 * NETPLAY_PAGE_SIZE + 2] ^= 1;
+   repair_put(&link, server_state, client_state, REPAIR_SIZE);
+   count = client_hashes(&link, theirs);
+   raw   = server_repair(&link, theirs, count, &len, &root, &wn);
+   CHECK(raw && len == 4 * sizeof(uint32_t) + 3 * NETPLAY_PAGE_SIZE
+         && run_at(raw, 0, 3, 1)
+         && run_at(raw, 2 * sizeof(uint32_t) + NETPLAY_PAGE_SIZE, 5, 2),
+         "blocks 3, 5 and 6 are not two runs");
+   free(raw);
+
+   /* Refused: a wrong root, runs shorter or longer than said, a run
+    * past the blocks; the frame stays as it was */
+   memcpy(before, delta->pages, npages * sizeof(uint32_t));
+   CHECK(!netplay_delta_frame_repair(link.client, &link.zstd, delta,
+            root ^ 1, (uint32_t)len, wn), "wrong root accepted");
+   CHECK(!netplay_delta_frame_repair(link.client, &link.zstd, delta,
+            root, (uint32_t)len - 1, wn), "runs shorter than said accepted");
+   CHECK(!netplay_delta_frame_repair(link.client, &link.zstd, delta,
+            root, (uint32_t)len + 1, wn), "runs longer than said accepted");
+   CHECK(!netplay_delta_frame_repair(link.client, &link.zstd, delta,
+            root, (uint32_t)len, wn - 1), "truncated runs accepted");
+   {
+      uint8_t bad[2 * sizeof(uint32_t) + NETPLAY_PAGE_SIZE];
+      uint32_t run[2];
+      run[0] = htonl((uint32_t)count);
+      run[1] = htonl(1);
+      memcpy(bad, run, sizeof(run));
+      memset(bad + sizeof(run), 0, NETPLAY_PAGE_SIZE);
+      netplay_runs_compress(&link.zstd, bad, sizeof(bad),
+            link.client->zbuffer, link.client->zbuffer_size, &wn);
+      CHECK(!netplay_delta_frame_repair(link.client, &link.zstd, delta,
+               root, sizeof(bad), wn), "run past the blocks accepted");
+   }
+   CHECK(!memcmp(before, delta->pages, npages * sizeof(uint32_t)),
+         "refused repairs changed the frame");
+
+   /* The good one still applies */
+   raw = server_repair(&link, theirs, count, &len, &root, &wn);
+   CHECK(raw && netplay_delta_frame_repair(link.client, &link.zstd, delta,
+            root, (uint32_t)len, wn)
+         && frame_root(link.client) == frame_root(link.server),
+         "two-run repair refused");
+   free(raw);
+   p = netplay_delta_frame_load(link.client, delta);
+   memcpy(client_state, p, REPAIR_SIZE);
+
+   /* Over half the blocks, or blocks that do not line up: the whole
+    * state is the fix */
+   for (i = 0; i < 10; i++)
+      client_state[i * NETPLAY_PAGE_SIZE + 50] ^= 1;
+   repair_put(&link, server_state, client_state, REPAIR_SIZE);
+   count = client_hashes(&link, theirs);
+   raw   = server_repair(&link, theirs, count, &len, &root, &wn);
+   CHECK(!raw, "over half the blocks sent as a repair");
+   free(raw);
+   raw   = server_repair(&link, theirs, count - 1, &len, &root, &wn);
+   CHECK(!raw, "repair for blocks that do not line up");
+   free(raw);
+   CHECK(link_deinit(&link), "references left after releasing all");
+
+   /* No container: the blocks are the core's memory and nothing else */
+   link_init(&link, REPAIR_SIZE, NETPLAY_PROTOCOL_VERSION);
+   link.server->coremem_size = REPAIR_SIZE;
+   link.client->coremem_size = REPAIR_SIZE;
+   delta = &link.client->buffer[REPAIR_FRAME];
+   fill(server_state, REPAIR_SIZE);
+   memcpy(client_state, server_state, REPAIR_SIZE);
+   client_state[REPAIR_SIZE - 1] ^= 1;
+   repair_put(&link, server_state, client_state, REPAIR_SIZE);
+   count = client_hashes(&link, theirs);
+   raw   = server_repair(&link, theirs, count, &len, &root, &wn);
+   CHECK(count == 21 && raw
+         && len == 2 * sizeof(uint32_t) + 500 && run_at(raw, 0, 20, 1),
+         "bare state's last byte not its own 500 byte block");
+   CHECK(raw && netplay_delta_frame_repair(link.client, &link.zstd, delta,
+            root, (uint32_t)len, wn)
+         && !memcmp(netplay_delta_frame_load(link.client, delta),
+            server_state, REPAIR_SIZE),
+         "bare state not repaired");
+   free(raw);
+   CHECK(link_deinit(&link), "references left after releasing all");
+
+   if (failures == had)
+      fprintf(stderr, "[pass] repair lane\n");
+}
+
+int main(void)
+{
+   lane_refcount();
+   lane_ring();
+   lane_invalidate();
+   lane_delta();
+   lane_fallback();
+   lane_malformed();
+   lane_repair();
+
+   if (failures)
+   {
+      fprintf(stderr, "FAIL netplay_delta_test: %u failures\n", failures);
+      return 1;
+   }
+   fprintf(stderr, "PASS netplay_delta_test\n");
+   return 0;
+}
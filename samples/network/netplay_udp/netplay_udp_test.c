@@ -0,0 +1,446 @@
+/* Oracle for netplay's UDP input channel (network/netplay/netplay_udp.c),
+ * over loopback sockets.
+ *
+ * What these lanes pin:
+ *
+ *   format     - a datagram packs and parses back to what went in, and
+ *                one cut short, padded, or not ours is refused.
+ *   loopback   - a bound "host" socket and a connected "client" socket
+ *                reach each other both ways, the host replying to the
+ *                address the client's datagram came from.
+ *   redundancy - with the loss shim dropping a fixed-seed share of
+ *                datagrams, a receiver taking frames strictly in order
+ *                gets every frame whose datagram or any of the next
+ *                NETPLAY_UDP_REDUNDANCY - 1 got through: exactly those
+ *                a burst shorter than the window left it.  The rest is
+ *                what TCP is still there for.  At 10% and 20% loss no
+ *                burst reaches NETPLAY_UDP_REDUNDANCY, so every frame
+ *                must arrive by UDP, bursts of several lost datagrams
+ *                included.
+ *   token      - tokens are never 0, do not repeat, and do not follow
+ *                from one another the way consecutive draws of an LCG
+ *                do.
+ *   host       - the host pins a client's datagrams to the address of
+ *                its TCP connection: the same host on any port passes,
+ *                any other host does not.
+ *
+ * The sender and receiver here follow the frontend's: each frame's
+ * datagram carries that frame and the ones before it, oldest first,
+ * and the receiver skips frames it has and stops at a gap. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <retro_timers.h>
+#include <net/net_compat.h>
+#include <net/net_socket.h>
+
+#include "../../../network/netplay/netplay_udp.h"
+
+#define FRAMES 2000
+#define WORDS  3
+#define TOKEN  0x1234abcd
+
+static unsigned failures = 0;
+
+#define CHECK(cond, ...) \
+   do { \
+      if (!(cond)) \
+      { \
+         fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__); \
+         fprintf(stderr, __VA_ARGS__); \
+         fprintf(stderr, "\n"); \
+         failures++; \
+      } \
+   } while (0)
+
+/* The shim under test, wrapped to record which datagrams it dropped. */
+static struct netplay_udp_loss loss;
+static bool dropped[FRAMES];
+static unsigned sent_count;
+
+static bool record_drop(void *userdata, const void *buf, size_t len)
+{
+   bool drop = netplay_udp_drop_random(userdata, buf, len);
+   if (sent_count < FRAMES)
+      dropped[sent_count++] = drop;
+   return drop;
+}
+
+static uint32_t input_word(uint32_t frame, uint32_t word)
+{
+   return frame * 2654435761u + word;
+}
+
+static void lane_format(void)
+{
+   uint32_t buf[NETPLAY_UDP_MAX_WORDS];
+   struct netplay_udp_input in, out;
+   unsigned had = failures;
+   size_t _len;
+   uint32_t i;
+
+   in.token      = TOKEN;
+   in.client_num = 2;
+   in.frame      = 100;
+   in.count      = 4;
+   in.words      = WORDS;
+   for (i = 0; i < in.count * in.words; i++)
+      buf[NETPLAY_UDP_HEADER_WORDS + i] = htonl(input_word(100, i));
+   _len = netplay_udp_input_pack(buf, &in);
+
+   CHECK(_len == (NETPLAY_UDP_HEADER_WORDS + 12) * sizeof(uint32_t),
+         "packed to %u bytes", (unsigned)_len);
+   CHECK(netplay_udp_input_parse(buf, _len, &out), "own datagram refused");
+   CHECK(     out.token == TOKEN && out.client_num == 2
+         && out.frame == 100 && out.count == 4 && out.words == WORDS,
+         "header did not round-trip");
+   CHECK(ntohl(out.data[5]) == input_word(100, 5), "input did not round-trip");
+
+   CHECK(!netplay_udp_input_parse(buf, _len - 4, &out), "short one taken");
+   CHECK(!netplay_udp_input_parse(buf, _len + 4, &out), "padded one taken");
+   CHECK(!netplay_udp_input_parse(buf, 8, &out), "stub taken");
+
+   /* Sizes that overflow count * words must not wrap into a match. */
+   buf[4] = htonl(0x80000000u);
+   buf[5] = htonl(2);
+   CHECK(!netplay_udp_input_parse(buf, NETPLAY_UDP_HEADER_WORDS * 4, &out),
+         "wrapped size taken");
+
+   buf[4] = htonl(4);
+   buf[5] = htonl(WORDS);
+   buf[0] = htonl(NETPLAY_UDP_MAGIC + 1);
+   CHECK(!netplay_udp_input_parse(buf, _len, &out), "bad magic taken");
+
+   /* A keepalive is a bare header. */
+   in.count = 0;
+   _len     = netplay_udp_input_pack(buf, &in);
+   CHECK(     netplay_udp_input_parse(buf, _len, &out) && !out.count,
+         "keepalive refused");
+
+   if (failures == had)
+      fprintf(stderr, "[pass] format lane\n");
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+   uint32_t x = *(const uint32_t*)a;
+   uint32_t y = *(const uint32_t*)b;
+   return x < y ? -1 : x > y;
+}
+
+#define TOKENS 4096
+
+static void lane_token(void)
+{
+   static uint32_t tokens[TOKENS];
+   unsigned had     = failures;
+   unsigned repeats = 0;
+   unsigned lcg     = 0;
+   unsigned i;
+
+   for (i = 0; i < TOKENS; i++)
+   {
+      tokens[i] = netplay_udp_token();
+      CHECK(tokens[i], "token %u is 0", i);
+      /* The salts' generator: next = prev * 1103515245 + 12345. */
+      if (i && tokens[i] == tokens[i - 1] * 1103515245u + 12345u)
+         lcg++;
+   }
+   CHECK(!lcg, "%u tokens follow from the one before", lcg);
+
+   qsort(tokens, TOKENS, sizeof(tokens[0]), cmp_u32);
+   for (i = 1; i < TOKENS; i++)
+      if (tokens[i] == tokens[i - 1])
+         repeats++;
+   /* 4096 draws of 32 bits collide about once in 500 runs. */
+   CHECK(repeats <= 1, "%u repeated tokens", repeats);
+
+   if (failures == had)
+      fprintf(stderr, "[pass] token lane\n");
+}
+
+static void lane_host(void)
+{
+   /* 127.0.0.1, as the host stores a TCP peer's address. */
+   static const uint8_t loopback[16] =
+      { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff, 127, 0, 0, 1 };
+   static const uint8_t other[16] =
+      { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff, 192, 0, 2, 1 };
+   struct sockaddr_in from;
+   unsigned had = failures;
+
+   memset(&from, 0, sizeof(from));
+   from.sin_family      = AF_INET;
+   from.sin_addr.s_addr = htonl(0x7f000001);
+   from.sin_port        = htons(55435);
+
+   CHECK(netplay_udp_addr_is_host((struct sockaddr*)&from, loopback),
+         "the TCP peer's host refused");
+   from.sin_port = htons(1);
+   CHECK(netplay_udp_addr_is_host((struct sockaddr*)&from, loopback),
+         "the TCP peer's host refused on another port");
+   CHECK(!netplay_udp_addr_is_host((struct sockaddr*)&from, other),
+         "another host taken");
+   from.sin_addr.s_addr = htonl(0x7f000002);
+   CHECK(!netplay_udp_addr_is_host((struct sockaddr*)&from, loopback),
+         "a neighbouring address taken");
+
+#ifdef HAVE_INET6
+   {
+      struct sockaddr_in6 from6;
+
+      memset(&from6, 0, sizeof(from6));
+      from6.sin6_family = AF_INET6;
+      memcpy(&from6.sin6_addr, loopback, 16);
+      CHECK(netplay_udp_addr_is_host((struct sockaddr*)&from6, loopback),
+            "a dual-stack socket's IPv4 peer refused");
+      memcpy(&from6.sin6_addr, other, 16);
+      CHECK(!netplay_udp_addr_is_host((struct sockaddr*)&from6, loopback),
+            "another dual-stack host taken");
+   }
+#endif
+
+   if (failures == had)
+      fprintf(stderr, "[pass] host lane\n");
+}
+
+/* Opens a host on an ephemeral loopback port and a client to it. */
+static bool open_pair(int *host, int *client)
+{
+   struct sockaddr_in addr;
+   socklen_t addrlen = sizeof(addr);
+
+   memset(&addr, 0, sizeof(addr));
+   addr.sin_family      = AF_INET;
+   addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+   if ((*host = netplay_udp_open((struct sockaddr*)&addr, sizeof(addr),
+               true)) < 0)
+      return false;
+   if (getsockname(*host, (struct sockaddr*)&addr, &addrlen) < 0)
+      return false;
+   return (*client = netplay_udp_open((struct sockaddr*)&addr, addrlen,
+            false)) >= 0;
+}
+
+/* Loopback is not truly instant; poll briefly for a datagram. */
+static ssize_t recv_wait(int fd, void *buf, size_t size,
+      struct sockaddr_storage *from, socklen_t *fromlen)
+{
+   int tries;
+   for (tries = 0; tries < 100; tries++)
+   {
+      ssize_t ret = netplay_udp_recv(fd, buf, size, from, fromlen);
+      if (ret >= 0)
+         return ret;
+      retro_sleep(1);
+   }
+   return -1;
+}
+
+static void lane_loopback(void)
+{
+   uint32_t buf[NETPLAY_UDP_MAX_WORDS];
+   struct netplay_udp_input in = {0}, out;
+   struct sockaddr_storage from;
+   socklen_t fromlen = 0;
+   unsigned had      = failures;
+   int host, client;
+   ssize_t ret;
+
+   if (!open_pair(&host, &client))
+   {
+      CHECK(false, "could not open a loopback pair");
+      return;
+   }
+
+   CHECK(netplay_udp_recv(host, buf, sizeof(buf), &from, &fromlen) < 0,
+         "host read something from nowhere");
+
+   in.token = TOKEN;
+   netplay_udp_send(client, buf, netplay_udp_input_pack(buf, &in), NULL, 0);
+   ret = recv_wait(host, buf, sizeof(buf), &from, &fromlen);
+   CHECK(ret == NETPLAY_UDP_HEADER_WORDS * 4, "host got %d bytes", (int)ret);
+   CHECK(     ret > 0 && netplay_udp_input_parse(buf, (size_t)ret, &out)
+         && out.token == TOKEN, "host got someone else's keepalive");
+
+   /* Back the way the keepalive came. */
+   in.client_num = 1;
+   in.frame      = 7;
+   in.count      = 1;
+   in.words      = 1;
+   buf[NETPLAY_UDP_HEADER_WORDS] = htonl(0xdeadbeef);
+   netplay_udp_send(host, buf, netplay_udp_input_pack(buf, &in),
+         (struct sockaddr*)&from, fromlen);
+   ret = recv_wait(client, buf, sizeof(buf), NULL, NULL);
+   CHECK(     ret > 0 && netplay_udp_input_parse(buf, (size_t)ret, &out)
+         && out.frame == 7 && ntohl(out.data[0]) == 0xdeadbeef,
+         "client did not get the host's reply");
+
+   socket_close(client);
+   socket_close(host);
+
+   if (failures == had)
+      fprintf(stderr, "[pass] loopback lane\n");
+}
+
+/* @every: the loss is light enough that the window covers every burst
+ * the seed produces, so nothing may be left to TCP. */
+static void lane_redundancy(unsigned percent, bool every)
+{
+   uint32_t buf[NETPLAY_UDP_MAX_WORDS];
+   bool expected[FRAMES];
+   unsigned had         = failures;
+   unsigned got         = 0;
+   unsigned want        = 0;
+   unsigned burst       = 0;
+   unsigned longest     = 0;
+   uint32_t next        = 0;
+   uint32_t frame;
+   int host, client;
+
+   if (!open_pair(&host, &client))
+   {
+      CHECK(false, "could not open a loopback pair");
+      return;
+   }
+
+   loss.percent = percent;
+   loss.seed    = 0x5eed + percent;
+   sent_count   = 0;
+   netplay_udp_set_drop(record_drop, &loss);
+
+   for (frame = 0; frame < FRAMES; frame++)
+   {
+      struct netplay_udp_input in;
+      ssize_t ret;
+      uint32_t i;
+
+      /* Send: this frame and up to K - 1 before it. */
+      in.token      = TOKEN;
+      in.client_num = 1;
+      in.count      = frame + 1 < NETPLAY_UDP_REDUNDANCY
+         ? frame + 1 : NETPLAY_UDP_REDUNDANCY;
+      in.frame      = frame + 1 - in.count;
+      in.words      = WORDS;
+      for (i = 0; i < in.count * WORDS; i++)
+         buf[NETPLAY_UDP_HEADER_WORDS + i] =
+            htonl(input_word(in.frame + i / WORDS, i % WORDS));
+      netplay_udp_send(client, buf, netplay_udp_input_pack(buf, &in),
+            NULL, 0);
+
+      /* Receive, strictly in order.  Every datagram sent has either
+       * been dropped or is waiting by the time this poll runs out. */
+      if (dropped[frame])
+         continue;
+      ret = recv_wait(host, buf, sizeof(buf), NULL, NULL);
+      if (ret < 0 || !netplay_udp_input_parse(buf, (size_t)ret, &in))
+      {
+         CHECK(false, "frame %u's datagram went missing", frame);
+         continue;
+      }
+      /* Stand in for TCP: what is older than the window, it has
+       * brought long since. */
+      if (next < in.frame)
+         next = in.frame;
+      for (i = 0; i < in.count; i++)
+      {
+         uint32_t f = in.frame + i;
+         uint32_t w;
+         if (f < next)
+            continue;
+         for (w = 0; w < WORDS; w++)
+            CHECK(ntohl(in.data[i * WORDS + w]) == input_word(f, w),
+                  "frame %u word %u garbled", f, w);
+         next++;
+         got++;
+      }
+   }
+
+   netplay_udp_set_drop(NULL, NULL);
+
+   /* Frame f arrives by UDP iff one of datagrams f..f+K-1 did. */
+   for (frame = 0; frame < FRAMES; frame++)
+   {
+      uint32_t d;
+      expected[frame] = false;
+      for (d = frame; d < FRAMES && d < frame + NETPLAY_UDP_REDUNDANCY; d++)
+         if (!dropped[d])
+            expected[frame] = true;
+      if (expected[frame])
+         want++;
+   }
+
+   for (frame = 0; frame < FRAMES; frame++)
+   {
+      burst = dropped[frame] ? burst + 1 : 0;
+      if (longest < burst)
+         longest = burst;
+   }
+
+   CHECK(got == want, "%u frames by UDP, %u expected", got, want);
+   if (every)
+   {
+      CHECK(longest < NETPLAY_UDP_REDUNDANCY,
+            "a burst of %u lost datagrams at %u%%", longest, percent);
+      /* Back-to-back losses, so more than the next datagram's copy
+       * was needed to make them good. */
+      CHECK(!percent || longest >= 2, "longest burst only %u at %u%%",
+            longest, percent);
+      CHECK(got == FRAMES, "%u of %u frames by UDP at %u%%", got, FRAMES,
+            percent);
+   }
+   if (percent == 0)
+      CHECK(got == FRAMES, "lossless run delivered %u of %u", got, FRAMES);
+   else
+   {
+      unsigned lost = 0;
+      for (frame = 0; frame < FRAMES; frame++)
+         lost += dropped[frame];
+      /* The shim drops about what it was asked to... */
+      CHECK(     lost > FRAMES * percent / 200
+            &&   lost < FRAMES * percent * 2 / 100,
+            "shim dropped %u of %u at %u%%", lost, FRAMES, percent);
+      /* ...and redundancy makes good far more than that. */
+      CHECK(FRAMES - got < lost / 4,
+            "%u frames missed UDP with %u datagrams lost", FRAMES - got,
+            lost);
+   }
+
+   socket_close(client);
+   socket_close(host);
+
+   if (failures == had)
+      fprintf(stderr, "[pass] redundancy lane, %u%% loss: %u/%u frames"
+            " (longest burst %u)\n", percent, got, FRAMES, longest);
+}
+
+int main(void)
+{
+   if (!network_init())
+   {
+      fprintf(stderr, "FAIL netplay_udp_test: no network\n");
+      return 1;
+   }
+
+   lane_format();
+   lane_loopback();
+   lane_redundancy(0,  true);
+   lane_redundancy(10, true);
+   lane_redundancy(20, true);
+   lane_redundancy(30, false);
+   lane_token();
+   lane_host();
+
+
+   if (failures)
+   {
+      fprintf(stderr, "FAIL netplay_udp_test: %u failures\n", failures);
+      return 1;
+   }
+   fprintf(stderr, "PASS netplay_udp_test\n");
+   return 0;
+}
@@ -29,6 +29,14 @@
  *                   successfully.
  *   capacity      - entries beyond config.capacity are dropped,
  *                   entries within it survive.
+ *   binary cache  - a large playlist read a second time comes from
+ *                   the .bin beside it, identical to the parse; a
+ *                   changed .lpl, a damaged cache or a capacity the
+ *                   cache cannot serve all parse again.
+ *   journal       - changes to a journaled playlist append to a log
+ *                   and leave the .lpl alone; a reread replays them
+ *                   exactly, past a torn record, and size limits,
+ *                   other writers and compaction fold the log back.
  *
  * No threads anywhere on this path, so the sanitizer sweep is
  * ASan+UBSan+LSan. */
@@ -39,8 +47,10 @@
 #include <unistd.h>
 
 #include <boolean.h>
+#include <compat/strl.h>
 #include <streams/interface_stream.h>
 #include <streams/file_stream.h>
+#include <file/file_path.h>
 #include <vfs/vfs_implementation.h>
 #include <streams/rzip_stream.h>
 #include <vfs/vfs.h>
@@ -120,6 +130,16 @@ static void config_defaults(playlist_config_t *config, const char *path)
    playlist_config_set_path(config, path);
 }
 
+/* Lanes pinning the JSON parse itself read a playlist a second
+ * time; without this the second read would come from the binary
+ * cache the first one left. */
+static void drop_binary_cache(const char *path)
+{
+   char bin_path[520];
+   snprintf(bin_path, sizeof(bin_path), "%s.bin", path);
+   remove(bin_path);
+}
+
 static bool streq(const char *a, const char *b)
 {
    if (!a && !b)
@@ -593,6 +613,7 @@ static void lane_budgeted_json(void)
    CHECK(blocking && playlist_size(blocking) == 5000,
          "budgeted json: blocking reference");
 
+   drop_binary_cache(path);
    p = playlist_parse_begin(&config);
    CHECK(p != NULL, "budgeted json: begin");
    for (;;)
@@ -730,6 +751,7 @@ static void lane_abort_midway(void)
    snprintf(path, sizeof(path), "%s/big.lpl", fixture_dir);
    config_defaults(&config, path);
    config.capacity = 8192;
+   drop_binary_cache(path);
 
    p = playlist_parse_begin(&config);
    CHECK(p != NULL, "abort: begin");
@@ -1388,6 +1410,433 @@ static void lane_rebuild_reuses_deferred_install(void)
             frames);
 }
 
+/* ------------------------------------------------------------------ */
+/* Binary cache: a large playlist read once leaves a .bin beside it   */
+/* that the next read takes instead of parsing, and must reproduce    */
+/* the parse exactly.                                                 */
+/* ------------------------------------------------------------------ */
+
+static void check_playlists_identical(playlist_t *a, playlist_t *b,
+      const char *lane)
+{
+   size_t i, j, n = playlist_size(a);
+
+   CHECK(n == playlist_size(b), "%s: sizes differ (%u vs %u)",
+         lane, (unsigned)n, (unsigned)playlist_size(b));
+   if (n != playlist_size(b))
+      return;
+   for (i = 0; i < n; i++)
+   {
+      const struct playlist_entry *ea = NULL;
+      const struct playlist_entry *eb = NULL;
+      bool same;
+      playlist_get_index(a, i, &ea);
+      playlist_get_index(b, i, &eb);
+      same = ea && eb
+            && streq(ea->path,            eb->path)
+            && streq(ea->label,           eb->label)
+            && streq(ea->core_path,       eb->core_path)
+            && streq(ea->core_name,       eb->core_name)
+            && streq(ea->db_name,         eb->db_name)
+            && streq(ea->crc32,           eb->crc32)
+            && streq(ea->subsystem_ident, eb->subsystem_ident)
+            && streq(ea->subsystem_name,  eb->subsystem_name)
+            && streq(ea->runtime_str,     eb->runtime_str)
+            && streq(ea->last_played_str, eb->last_played_str)
+            && !ea->subsystem_roms == !eb->subsystem_roms
+            && ea->entry_slot         == eb->entry_slot
+            && ea->runtime_status     == eb->runtime_status
+            && ea->runtime_hours      == eb->runtime_hours
+            && ea->runtime_minutes    == eb->runtime_minutes
+            && ea->runtime_seconds    == eb->runtime_seconds
+            && ea->last_played_year   == eb->last_played_year
+            && ea->last_played_month  == eb->last_played_month
+            && ea->last_played_day    == eb->last_played_day
+            && ea->last_played_hour   == eb->last_played_hour
+            && ea->last_played_minute == eb->last_played_minute
+            && ea->last_played_second == eb->last_played_second
+            && ea->thumbnail_flags    == eb->thumbnail_flags;
+      if (same && ea->subsystem_roms)
+      {
+         same = ea->subsystem_roms->size == eb->subsystem_roms->size;
+         for (j = 0; same && j < ea->subsystem_roms->size; j++)
+            same = streq(ea->subsystem_roms->elems[j].data,
+                  eb->subsystem_roms->elems[j].data);
+      }
+      if (!same)
+      {
+         CHECK(false, "%s: entry %u differs", lane, (unsigned)i);
+         return;
+      }
+   }
+   CHECK(streq(playlist_get_default_core_path(a),
+               playlist_get_default_core_path(b))
+         && streq(playlist_get_default_core_name(a),
+               playlist_get_default_core_name(b))
+         && streq(playlist_get_scan_database_name(a),
+               playlist_get_scan_database_name(b))
+         && streq(playlist_get_scan_content_dir(a),
+               playlist_get_scan_content_dir(b))
+         && streq(playlist_get_scan_file_exts(a),
+               playlist_get_scan_file_exts(b))
+         && streq(playlist_get_scan_dat_file_path(a),
+               playlist_get_scan_dat_file_path(b))
+         && playlist_get_label_display_mode(a)
+               == playlist_get_label_display_mode(b)
+         && playlist_get_thumbnail_mode(a, PLAYLIST_THUMBNAIL_RIGHT)
+               == playlist_get_thumbnail_mode(b, PLAYLIST_THUMBNAIL_RIGHT)
+         && playlist_get_thumbnail_mode(a, PLAYLIST_THUMBNAIL_LEFT)
+               == playlist_get_thumbnail_mode(b, PLAYLIST_THUMBNAIL_LEFT)
+         && playlist_get_sort_mode(a) == playlist_get_sort_mode(b)
+         && playlist_get_scan_search_recursively(a)
+               == playlist_get_scan_search_recursively(b)
+         && playlist_get_scan_filter_dat_content(a)
+               == playlist_get_scan_filter_dat_content(b),
+         "%s: header differs", lane);
+}
+
+/* json_full with @extra filler entries after its own three. */
+static char *bin_fixture_doc(unsigned extra)
+{
+   size_t head  = strstr(json_full, "    }\n  ]\n}\n") - json_full + 5;
+   size_t cap   = head + (size_t)extra * 96 + 64;
+   char *doc    = (char*)malloc(cap);
+   size_t _len  = head;
+   unsigned i;
+
+   if (!doc)
+      return NULL;
+   memcpy(doc, json_full, head);
+   for (i = 0; i < extra; i++)
+      _len += (size_t)snprintf(doc + _len, cap - _len,
+            ",\n    { \"path\": \"/games/snes/Filler %04u.sfc\","
+            " \"core_name\": \"Core A\" }", i);
+   _len += (size_t)snprintf(doc + _len, cap - _len, "\n  ]\n}\n");
+   return doc;
+}
+
+/* Overwrites the first @from in @path with @to, same length. */
+static bool patch_file(const char *path, const char *from, const char *to)
+{
+   void *buf   = NULL;
+   int64_t len = 0;
+   char *at    = NULL;
+   bool ok     = false;
+
+   if (!filestream_read_file(path, &buf, &len))
+      return false;
+   for (at = (char*)buf; at + strlen(from) <= (char*)buf + len; at++)
+   {
+      if (memcmp(at, from, strlen(from)))
+         continue;
+      memcpy(at, to, strlen(to));
+      ok = filestream_write_file(path, buf, len);
+      break;
+   }
+   free(buf);
+   return ok;
+}
+
+static void lane_binary_cache(void)
+{
+   char path[512];
+   char bin_path[520];
+   char *doc               = NULL;
+   playlist_config_t config;
+   playlist_t *parsed      = NULL;
+   playlist_t *cached      = NULL;
+   const struct playlist_entry *e = NULL;
+   struct playlist_entry update;
+   unsigned had            = failures;
+
+   if (!(doc = bin_fixture_doc(300)))
+   {
+      CHECK(false, "binary cache: doc alloc");
+      return;
+   }
+   snprintf(path, sizeof(path), "%s/bin.lpl", fixture_dir);
+   snprintf(bin_path, sizeof(bin_path), "%s.bin", path);
+   CHECK(write_whole(path, doc), "fixture write");
+   config_defaults(&config, path);
+
+   /* First read parses and leaves the cache; the second takes it. */
+   parsed = playlist_init(&config);
+   CHECK(parsed && playlist_size(parsed) == 303,
+         "binary cache: parse");
+   CHECK(path_is_valid(bin_path), "binary cache: no cache written");
+   cached = playlist_init(&config);
+   CHECK(cached != NULL, "binary cache: cached read");
+   if (parsed && cached)
+      check_playlists_identical(parsed, cached, "binary cache");
+   playlist_free(cached);
+
+   /* Prove it was the cache that was read: a string changed in it,
+    * with the .lpl untouched, shows through. */
+   CHECK(patch_file(bin_path, "Super Game Boy", "Patched Cache!"),
+         "binary cache: patch");
+   cached = playlist_init(&config);
+   e      = NULL;
+   if (cached)
+      playlist_get_index(cached, 0, &e);
+   CHECK(e && streq(e->subsystem_name, "Patched Cache!"),
+         "binary cache: second read did not come from the cache");
+
+   /* Entries replaced, removed and added on a cache-backed playlist
+    * free only what they own. */
+   memset(&update, 0, sizeof(update));
+   update.path      = "/games/snes/Updated.sfc";
+   update.label     = "Updated";
+   update.core_path = "/cores/core_b.so";
+   update.core_name = "Core B";
+   if (cached)
+   {
+      playlist_update(cached, 1, &update);
+      playlist_delete_index(cached, 2);
+      update.path  = "/games/snes/Pushed.sfc";
+      update.label = "Pushed";
+      playlist_push(cached, &update);
+      /* A push goes to the front. */
+      e = NULL;
+      playlist_get_index(cached, 2, &e);
+      CHECK(e && streq(e->label, "Updated") && streq(e->core_name, "Core B")
+            && streq(e->crc32, NULL),
+            "binary cache: update on a cached entry");
+      CHECK(playlist_size(cached) == 303, "binary cache: push/delete");
+   }
+   playlist_free(cached);
+
+   /* Fewer entries wanted than cached: the same prefix the parse
+    * would have kept. */
+   config.capacity = 100;
+   cached = playlist_init(&config);
+   e      = NULL;
+   if (cached)
+      playlist_get_index(cached, 0, &e);
+   CHECK(cached && playlist_size(cached) == 100
+         && e && streq(e->subsystem_name, "Patched Cache!"),
+         "binary cache: smaller capacity not served from the cache");
+   playlist_free(cached);
+   config.capacity = 512;
+
+   /* A changed .lpl is parsed again, and the cache rewritten.  (The
+    * size changes too: a rewrite of the same size within the mtime
+    * granularity cannot be told apart.) */
+   {
+      FILE *f = fopen(path, "ab");
+      CHECK(f && fputc('\n', f) != EOF, "fixture append");
+      if (f)
+         fclose(f);
+   }
+   cached = playlist_init(&config);
+   e      = NULL;
+   if (cached)
+      playlist_get_index(cached, 0, &e);
+   CHECK(e && streq(e->subsystem_name, "Super Game Boy"),
+         "binary cache: stale cache used after the .lpl changed");
+   playlist_free(cached);
+
+   /* Cut at capacity, a cache cannot serve a larger one. */
+   config.capacity = 150;
+   cached = playlist_init(&config);
+   CHECK(cached && playlist_size(cached) == 150,
+         "binary cache: capacity 150");
+   playlist_free(cached);
+   config.capacity = 512;
+   cached = playlist_init(&config);
+   CHECK(cached && playlist_size(cached) == 303,
+         "binary cache: entries cut by an earlier capacity went missing");
+   if (parsed && cached)
+      check_playlists_identical(parsed, cached, "binary cache reparse");
+   playlist_free(cached);
+
+   /* A damaged cache is ignored. */
+   CHECK(patch_file(bin_path, "RAPB", "XXXX"), "binary cache: damage");
+   cached = playlist_init(&config);
+   if (parsed && cached)
+      check_playlists_identical(parsed, cached, "binary cache damaged");
+   playlist_free(cached);
+
+   playlist_free(parsed);
+   free(doc);
+   if (failures == had)
+      fprintf(stderr, "[pass] binary cache lane\n");
+}
+
+/* ------------------------------------------------------------------ */
+/* Journal: a journaled playlist appends its changes to a log beside  */
+/* the .lpl, which every later read replays.                           */
+/* ------------------------------------------------------------------ */
+
+static void journal_push(playlist_t *pl, const char *path, const char *label)
+{
+   struct playlist_entry entry;
+   memset(&entry, 0, sizeof(entry));
+   entry.path      = (char*)path;
+   entry.label     = (char*)label;
+   entry.core_path = (char*)"/cores/core_a.so";
+   entry.core_name = (char*)"Core A";
+   playlist_push(pl, &entry);
+}
+
+static void check_journal_reload(playlist_t *pl, const char *path,
+      const char *lane)
+{
+   playlist_config_t config;
+   playlist_t *reloaded = NULL;
+
+   config_defaults(&config, path);
+   config.capacity = 400;
+   reloaded        = playlist_init(&config);
+   CHECK(reloaded != NULL, "%s: reload", lane);
+   if (reloaded)
+      check_playlists_identical(pl, reloaded, lane);
+   playlist_free(reloaded);
+}
+
+static void lane_journal(void)
+{
+   char path[512];
+   char log_path[520];
+   char *doc          = NULL;
+   void *before       = NULL;
+   void *after        = NULL;
+   int64_t before_len = 0;
+   int64_t after_len  = 0;
+   playlist_config_t config;
+   playlist_t *pl     = NULL;
+   playlist_t *other  = NULL;
+   const struct playlist_entry *e = NULL;
+   struct playlist_entry update;
+   unsigned had       = failures;
+   unsigned i;
+
+   if (!(doc = big_fixture_doc(400, "/games")))
+   {
+      CHECK(false, "journal: doc alloc");
+      return;
+   }
+   snprintf(path, sizeof(path), "%s/journal.lpl", fixture_dir);
+   snprintf(log_path, sizeof(log_path), "%s.log", path);
+   CHECK(write_whole(path, doc), "fixture write");
+   free(doc);
+   config_defaults(&config, path);
+   config.capacity = 400;
+
+   if (!(pl = playlist_init(&config)))
+   {
+      CHECK(false, "journal: init");
+      return;
+   }
+   playlist_set_journaled(pl);
+   filestream_read_file(path, &before, &before_len);
+
+   /* Every kind of change: a push that evicts the oldest entry, a
+    * push of an entry already present, an update, deletes by index
+    * and by path. */
+   journal_push(pl, "/games/new/a.bin", "New A");
+   playlist_write_file(pl);
+   journal_push(pl, "/games/new/b.bin", "New B");
+   journal_push(pl, "/games/new/a.bin", "New A");
+   memset(&update, 0, sizeof(update));
+   update.label = (char*)"Updated";
+   playlist_update(pl, 5, &update);
+   playlist_delete_index(pl, 7);
+   playlist_delete_by_path(pl, "/games/dir020/game00020.bin");
+   playlist_write_file(pl);
+
+   e = NULL;
+   playlist_get_index(pl, 0, &e);
+   CHECK(e && streq(e->path, "/games/new/a.bin"),
+         "journal: re-pushed entry not at the front");
+   CHECK(path_is_valid(log_path), "journal: no log written");
+   filestream_read_file(path, &after, &after_len);
+   CHECK(before && after && before_len == after_len
+         && !memcmp(before, after, (size_t)before_len),
+         "journal: the .lpl was rewritten");
+   free(before);
+   free(after);
+
+   /* Read back through the binary cache, and through the parse. */
+   check_journal_reload(pl, path, "journal");
+   drop_binary_cache(path);
+   check_journal_reload(pl, path, "journal without cache");
+
+   /* A torn record is where the replay stops, and the next append
+    * writes over it. */
+   {
+      FILE *f = fopen(log_path, "ab");
+      CHECK(f && fwrite("\x30\0\0\0\x01\x02\x03\x04\x05\x06", 1, 10, f) == 10,
+            "journal: tear");
+      if (f)
+         fclose(f);
+   }
+   check_journal_reload(pl, path, "journal torn");
+   journal_push(pl, "/games/new/c.bin", "New C");
+   playlist_write_file(pl);
+   check_journal_reload(pl, path, "journal after tear");
+
+   /* Past its size limit the log is folded back in. */
+   for (i = 0; i < 400; i++)
+   {
+      char label[32];
+      snprintf(label, sizeof(label), "Relabelled %u", i);
+      update.label = label;
+      playlist_update(pl, i % 50, &update);
+      playlist_write_file(pl);
+   }
+   CHECK(path_get_size(log_path) <= 64 * 1024,
+         "journal: log grew to %ld bytes",
+         (long)path_get_size(log_path));
+   check_journal_reload(pl, path, "journal compacted by size");
+
+   /* A playlist that is not journaled writes whole, taking the log
+    * with it; the journaled one then finds its base gone and does
+    * the same. */
+   other = playlist_init(&config);
+   CHECK(other != NULL, "journal: second reader");
+   if (other)
+   {
+      playlist_delete_index(other, 0);
+      playlist_write_file(other);
+      CHECK(!path_is_valid(log_path),
+            "journal: whole write left the log behind");
+      playlist_free(other);
+   }
+   playlist_delete_index(pl, 0);
+   journal_push(pl, "/games/new/d.bin", "New D");
+   playlist_write_file(pl);
+   check_journal_reload(pl, path, "journal after another writer");
+
+   /* Compaction folds the log into the .lpl. */
+   journal_push(pl, "/games/new/e.bin", "New E");
+   playlist_write_file(pl);
+   CHECK(path_is_valid(log_path), "journal: no log before compaction");
+   playlist_compact(pl);
+   CHECK(!path_is_valid(log_path), "journal: log left after compaction");
+   check_journal_reload(pl, path, "journal compacted");
+
+   /* A log whose .lpl has changed since is ignored. */
+   journal_push(pl, "/games/new/f.bin", "New F");
+   playlist_write_file(pl);
+   {
+      FILE *f = fopen(path, "ab");
+      CHECK(f && fputc('\n', f) != EOF, "fixture append");
+      if (f)
+         fclose(f);
+   }
+   other = playlist_init(&config);
+   e     = NULL;
+   if (other)
+      playlist_get_index(other, 0, &e);
+   CHECK(e && streq(e->path, "/games/new/e.bin"),
+         "journal: replayed over a .lpl it does not describe");
+   playlist_free(other);
+
+   playlist_free(pl);
+   if (failures == had)
+      fprintf(stderr, "[pass] journal lane\n");
+}
+
 int main(int argc, char *argv[])
 {
    char cmd[600];
@@ -1422,6 +1871,8 @@ int main(int argc, char *argv[])
    lane_saf_slow_reads();
    lane_pump_completes_without_input();
    lane_rebuild_reuses_deferred_install();
+   lane_binary_cache();
+   lane_journal();
 
    snprintf(cmd, sizeof(cmd), "rm -rf %s", fixture_dir);
    if (system(cmd) != 0) { }
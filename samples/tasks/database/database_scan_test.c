@@ -35,11 +35,15 @@
 #include <string.h>
 #include <stdint.h>
 #include <time.h>
+#include <sys/stat.h>
+#include <utime.h>
 
 #include <queues/task_queue.h>
 #include <lists/dir_list.h>
 #include <retro_timers.h>
 #include <streams/file_stream.h>
+#include <compat/strl.h>
+#include <file/file_path.h>
 
 #include "../../../core_info.h"
 #include "../../../tasks/tasks_internal.h"
@@ -47,6 +51,7 @@
 #include "../../../list_special.h"
 #include "../../../configuration.h"
 #include "../../../verbosity.h"
+#include "../../../tasks/task_database_scan_cache.h"
 
 #define SCAN_TIMEOUT_SECONDS 120
 
@@ -431,6 +436,123 @@ static void msgq_push(retro_task_t *task, const char *msg,
    (void)task; (void)msg; (void)prio; (void)duration; (void)flush;
 }
 
+/* Pushes a scan of @in_dir and runs the queue until it completes. */
+static bool run_scan(const char *pl_dir, const char *db_dir,
+      const char *in_dir)
+{
+   time_t started;
+
+   loop_active    = true;
+   scan_completed = false;
+   if (!task_push_dbscan(pl_dir, db_dir, in_dir, true, false, scan_cb))
+   {
+      check(0, "scan started", "task_push_dbscan refused");
+      return false;
+   }
+
+   started = time(NULL);
+   while (loop_active)
+   {
+      task_queue_check();
+      if (difftime(time(NULL), started) > SCAN_TIMEOUT_SECONDS)
+         break;
+      retro_sleep(1);
+   }
+   check(scan_completed, "scan ran to completion",
+         scan_completed ? "callback fired" : "timed out");
+   return scan_completed;
+}
+
+/* A rescan appends to the playlists it finds, so each one starts from
+ * none and what it writes is only what that scan matched.  The scan
+ * cache beside them is left alone. */
+static void remove_playlists(const char *pl_dir)
+{
+   static const char *names[] = {
+      "Test Alpha.lpl", "Test Beta.lpl", "Test Disc.lpl", "Test Zip.lpl"
+   };
+   char p[1024];
+   unsigned i;
+
+   for (i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+   {
+      sprintf(p, "%s/%s", pl_dir, names[i]);
+      remove(p);
+   }
+}
+
+/* The first scan left its checksums in the scan cache, which a rescan
+ * trusts for any file whose size and modification time are unchanged.
+ * Alpha's content is replaced by bytes of the same size that match no
+ * database, and its modification time put back: a rescan can then only
+ * file it under Alpha by taking the cached checksum.  Moving the time
+ * on makes the same rescan read the file again and find nothing.
+ *
+ * On the first scan Alpha was queued to the hash-ahead workers; on the
+ * last it is known to the cache, so it is not, and the lookup has to
+ * read it inline once the cache turns it away. */
+static void lane_scan_cache(const char *pl_dir, const char *db_dir,
+      const char *in_dir)
+{
+   const uint32_t crc_none = 0x0BADC0DEu;
+   const uint32_t sz_a     = 4096;
+   int had                 = failures;
+   struct stat st;
+   struct utimbuf times;
+   char p[1024];
+
+   sprintf(p, "%s/" SCAN_CACHE_FILE_NAME, pl_dir);
+   check(path_is_valid(p), "scan cache written beside the playlists",
+         SCAN_CACHE_FILE_NAME);
+
+   sprintf(p, "%s/02_alpha.bin", in_dir);
+   if (stat(p, &st) != 0 || !write_content(p, crc_none, sz_a))
+   {
+      check(0, "fixture", "could not rewrite alpha");
+      return;
+   }
+   times.actime  = st.st_atime;
+   times.modtime = st.st_mtime;
+   if (utime(p, &times) != 0)
+   {
+      check(0, "fixture", "could not restore alpha's mtime");
+      return;
+   }
+
+   remove_playlists(pl_dir);
+   if (!run_scan(pl_dir, db_dir, in_dir))
+      return;
+   sprintf(p, "%s/Test Alpha.lpl", pl_dir);
+   check(file_contains(p, "Alpha The Game"),
+         "unchanged stamp is a cache hit", "Alpha from its cached crc");
+   sprintf(p, "%s/Test Beta.lpl", pl_dir);
+   check(file_contains(p, "Beta The Game"),
+         "and the rest of the rescan still matches", "Beta The Game");
+   if (failures == had)
+      fprintf(stderr, "[pass] scan cache hit lane\n");
+
+   had = failures;
+   sprintf(p, "%s/02_alpha.bin", in_dir);
+   times.modtime = st.st_mtime + 60;
+   if (utime(p, &times) != 0)
+   {
+      check(0, "fixture", "could not move alpha's mtime");
+      return;
+   }
+
+   remove_playlists(pl_dir);
+   if (!run_scan(pl_dir, db_dir, in_dir))
+      return;
+   sprintf(p, "%s/Test Alpha.lpl", pl_dir);
+   check(!file_contains(p, "Alpha The Game"),
+         "changed mtime is a miss", "alpha read again, no match");
+   sprintf(p, "%s/Test Beta.lpl", pl_dir);
+   check(file_contains(p, "Beta The Game"),
+         "and the rest of the rescan still matches", "Beta The Game");
+   if (failures == had)
+      fprintf(stderr, "[pass] scan cache mtime lane\n");
+}
+
 int main(int argc, char **argv)
 {
    const char *root = (argc > 1) ? argv[1] : "/tmp";
@@ -565,24 +687,8 @@ int main(int argc, char **argv)
             MANUAL_CONTENT_SCAN_SYSTEM_NAME_CONTENT_DIR, NULL))
       check(0, "system name", "could not be set");
 
-   if (!task_push_dbscan(pl_dir, db_dir, in_dir, true, false, scan_cb))
-   {
-      check(0, "scan started", "task_push_dbscan refused");
+   if (!run_scan(pl_dir, db_dir, in_dir))
       goto done;
-   }
-
-   {
-      time_t started = time(NULL);
-      while (loop_active)
-      {
-         task_queue_check();
-         if (difftime(time(NULL), started) > SCAN_TIMEOUT_SECONDS)
-            break;
-         retro_sleep(1);
-      }
-   }
-   check(scan_completed, "scan ran to completion",
-         scan_completed ? "callback fired" : "timed out");
 
    /* Each game must appear in its own database's playlist.  Getting
     * this wrong is not a crash - the entry is a real record from a
@@ -619,6 +725,8 @@ int main(int argc, char **argv)
    check(file_contains(p, ".cue"),
          "playlist records the sheet, not the track", "path ends .cue");
 
+   lane_scan_cache(pl_dir, db_dir, in_dir);
+
 done:
    printf("\n%d checks, %d failures\n", checks, failures);
    return failures ? 1 : 0;
@@ -0,0 +1,676 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2026 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Oracle for tasks/task_decompress.c extracting a ZIP on its worker
+ * pool.
+ *
+ * Pushes the real task through the real task queue, unthreaded so
+ * that every tick is this test's own task_queue_check() and progress
+ * can be read between them, against archives written here: a few
+ * hundred members over several directories, stored and deflated
+ * alternately, one of them empty, plus a directory entry.  The core
+ * count is stubbed, which is what decides between the pool and the
+ * serial path, so both run on any machine.
+ *
+ *   pool    - every member lands byte for byte; progress never goes
+ *             back and ends at 100; and members are written between
+ *             ticks, by the workers, several of them from the one
+ *             tick that set the pool up.  The serial path writes
+ *             nothing unless ticked, and takes a tick a member.
+ *   serial  - one core: the same archive, the same files.
+ *   subdir  - only the named directory, with its prefix stripped.
+ *   corrupt - one deflated member is garbage: the task fails naming
+ *             it, and nothing is left reading the archive when the
+ *             task closes it.
+ *   cancel  - the first member each worker takes is a FIFO with no
+ *             reader, so every worker blocks in the middle of
+ *             writing one and nothing else can land.  The task is
+ *             cancelled there, has to wait for them, and once they
+ *             are let go it reports the cancel; the members they
+ *             were writing are removed, and none of the rest were
+ *             ever started.
+ *
+ * The last two are what the sanitizer passes are for: a member still
+ * reading a mapping the task has unmapped, or a job outliving the
+ * pool that counts it, shows up there and nowhere else.
+ *
+ * Build:  make            (SANITIZER=address,undefined, or thread)
+ *         make sweep      (all three passes)
+ * Run:    ./decompress_pool_test
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <boolean.h>
+#include <encodings/crc32.h>
+#include <encodings/deflate.h>
+#include <features/features_cpu.h>
+#include <file/file_path.h>
+#include <queues/task_queue.h>
+#include <retro_miscellaneous.h>
+
+#include "msg_hash.h"
+#include "tasks/tasks_internal.h"
+
+#define ARCHIVE    "decompress_pool_test.zip"
+#define OUT_DIR    "decompress_pool_test.out"
+#define MEMBERS    300
+#define DIRS       7
+#define MAX_TICKS  100000
+/* Members gated in the cancel lane: one per worker, and the first
+ * ones the walk hands out, so all of them are taken at once */
+#define GATED      4
+
+static unsigned failures = 0;
+
+#define CHECK(cond, ...) \
+   do { \
+      if (!(cond)) \
+      { \
+         fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__); \
+         fprintf(stderr, __VA_ARGS__); \
+         fprintf(stderr, "\n"); \
+         failures++; \
+      } \
+   } while (0)
+
+/* ---- stubs ---- */
+
+static unsigned stub_cores = 4;
+
+/* Scalar CRC and deflate: what is under test is who decodes, not how */
+uint64_t cpu_features_get(void)
+{
+   return 0;
+}
+
+unsigned cpu_features_get_core_amount(void)
+{
+   return stub_cores;
+}
+
+retro_time_t cpu_features_get_time_usec(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (retro_time_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+const char *msg_hash_to_str(enum msg_hash_enums msg)
+{
+   return "Extracting";
+}
+
+/* ---- archive ---- */
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+   p[0] = (uint8_t)v;
+   p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+   put_u16(p,     (uint16_t)v);
+   put_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+static void member_name(char *s, size_t len, unsigned i)
+{
+   snprintf(s, len, "dir%u/file%03u.bin", i % DIRS, i);
+}
+
+/* Sizes from nothing to a few hundred KiB, so that the decodes take
+ * visibly different times and finish out of order. */
+static size_t member_size(unsigned i)
+{
+   if (i == 5)
+      return 0;
+   return (i * 7919u) % (i % 10 == 0 ? 300000u : 20000u) + 1;
+}
+
+/* Runs of a member-specific byte broken up by noise: deflate has
+ * something to do, and no two members agree. */
+static void member_fill(uint8_t *buf, size_t len, unsigned i)
+{
+   uint32_t seed = 0x9e3779b9u * (i + 1);
+   size_t j;
+   for (j = 0; j < len; j++)
+   {
+      seed   = seed * 1103515245u + 12345u;
+      buf[j] = (j % 64 < 48) ? (uint8_t)(i + j / 64) : (uint8_t)(seed >> 24);
+   }
+}
+
+static size_t deflate_raw(const uint8_t *in, size_t len,
+      uint8_t *out, size_t out_len)
+{
+   size_t total = 0;
+   void *z      = rdeflate_new(6, -15);
+
+   if (!z)
+      return 0;
+   rdeflate_set_in(z, in, len);
+   rdeflate_set_out(z, out, out_len);
+   rdeflate_finish(z);
+   for (;;)
+   {
+      size_t rd = 0, wr = 0;
+      int st    = rdeflate_process(z, &rd, &wr);
+      total    += wr;
+      if (st == RDEFLATE_PROCESS_END)
+         break;
+      if (st == RDEFLATE_PROCESS_ERROR || (rd == 0 && wr == 0))
+      {
+         total = 0;
+         break;
+      }
+   }
+   rdeflate_free(z);
+   return total;
+}
+
+/* Writes the test archive: MEMBERS members, even ones deflated and odd
+ * ones stored, and a directory entry up front. A member numbered
+ * @corrupt, if any, opens with a block of the reserved type, which no
+ * inflate will take. */
+static bool write_archive(int corrupt)
+{
+   uint8_t *central = (uint8_t*)malloc((MEMBERS + 1) * (46 + 32));
+   size_t central_len = 0;
+   uint32_t offset    = 0;
+   unsigned entries   = 0;
+   FILE *fp           = fopen(ARCHIVE, "wb");
+   uint8_t eocd[22];
+   int i;
+
+   if (!fp || !central)
+   {
+      if (fp)
+         fclose(fp);
+      free(central);
+      return false;
+   }
+
+   for (i = -1; i < MEMBERS; i++)
+   {
+      char name[32];
+      uint8_t lfh[30];
+      uint8_t *cfh     = central + central_len;
+      size_t usize     = i < 0 ? 0 : member_size(i);
+      size_t cap       = usize + usize / 8 + 1024;
+      uint8_t *data    = (uint8_t*)malloc(usize + 1);
+      uint8_t *packed  = (uint8_t*)malloc(cap);
+      const uint8_t *body = data;
+      size_t csize     = usize;
+      uint16_t method  = 0;
+      uint32_t crc;
+      size_t nlen;
+
+      if (i < 0)
+         strcpy(name, "dir0/");
+      else
+         member_name(name, sizeof(name), i);
+      nlen = strlen(name);
+      if (i >= 0)
+         member_fill(data, usize, i);
+      crc = encoding_crc32(0, data, usize);
+
+      if (i >= 0 && i % 2 == 0 && usize > 0)
+      {
+         csize  = deflate_raw(data, usize, packed, cap);
+         body   = packed;
+         method = 8;
+         if (i == corrupt)
+            packed[0] = 0xff;
+      }
+
+      memset(lfh, 0, sizeof(lfh));
+      put_u32(lfh,      0x04034b50);
+      put_u16(lfh + 4,  20);
+      put_u16(lfh + 8,  method);
+      put_u32(lfh + 14, crc);
+      put_u32(lfh + 18, (uint32_t)csize);
+      put_u32(lfh + 22, (uint32_t)usize);
+      put_u16(lfh + 26, (uint16_t)nlen);
+      fwrite(lfh, 1, sizeof(lfh), fp);
+      fwrite(name, 1, nlen, fp);
+      fwrite(body, 1, csize, fp);
+
+      memset(cfh, 0, 46);
+      put_u32(cfh,      0x02014b50);
+      put_u16(cfh + 4,  20);
+      put_u16(cfh + 6,  20);
+      put_u16(cfh + 10, method);
+      put_u32(cfh + 16, crc);
+      put_u32(cfh + 20, (uint32_t)csize);
+      put_u32(cfh + 24, (uint32_t)usize);
+      put_u16(cfh + 28, (uint16_t)nlen);
+      put_u32(cfh + 42, offset);
+      memcpy(cfh + 46, name, nlen);
+      central_len += 46 + nlen;
+
+      offset += (uint32_t)(sizeof(lfh) + nlen + csize);
+      entries++;
+      free(data);
+      free(packed);
+   }
+
+   fwrite(central, 1, central_len, fp);
+   memset(eocd, 0, sizeof(eocd));
+   put_u32(eocd,      0x06054b50);
+   put_u16(eocd + 8,  (uint16_t)entries);
+   put_u16(eocd + 10, (uint16_t)entries);
+   put_u32(eocd + 12, (uint32_t)central_len);
+   put_u32(eocd + 16, offset);
+   fwrite(eocd, 1, sizeof(eocd), fp);
+
+   free(central);
+   return fclose(fp) == 0;
+}
+
+/* 1 if @path holds member @i exactly, 0 if it is missing, -1 if it is
+ * there but wrong. */
+static int member_matches(const char *path, unsigned i)
+{
+   size_t usize   = member_size(i);
+   uint8_t *want  = (uint8_t*)malloc(usize + 1);
+   uint8_t *got   = (uint8_t*)malloc(usize + 1);
+   FILE *fp       = fopen(path, "rb");
+   int ret        = 0;
+
+   if (fp)
+   {
+      member_fill(want, usize, i);
+      ret = (     fread(got, 1, usize + 1, fp) == usize
+               && !memcmp(got, want, usize)) ? 1 : -1;
+      fclose(fp);
+   }
+   free(want);
+   free(got);
+   return ret;
+}
+
+static void remove_output(void)
+{
+   char path[PATH_MAX_LENGTH];
+   unsigned i;
+
+   for (i = 0; i < MEMBERS; i++)
+   {
+      char name[32];
+      member_name(name, sizeof(name), i);
+      snprintf(path, sizeof(path), "%s/%s", OUT_DIR, name);
+      remove(path);
+      /* The subdir lane's flattened layout */
+      snprintf(path, sizeof(path), "%s/%s", OUT_DIR, path_basename(name));
+      remove(path);
+   }
+   for (i = 0; i < DIRS; i++)
+   {
+      snprintf(path, sizeof(path), "%s/dir%u", OUT_DIR, i);
+      rmdir(path);
+   }
+   rmdir(OUT_DIR);
+}
+
+/* ---- driving the task ---- */
+
+struct run
+{
+   char *error;
+   unsigned ticks;
+   /* Members on disk, waited for without ticking, after the tick that
+    * sets up the pool */
+   unsigned between_ticks;
+   int last_progress;
+   bool progress_backwards;
+   bool done;
+};
+
+static void run_cb(retro_task_t *task, void *task_data,
+      void *user_data, const char *error)
+{
+   struct run *r                = (struct run*)user_data;
+   decompress_task_data_t *data = (decompress_task_data_t*)task_data;
+
+   r->done  = true;
+   r->error = error ? strdup(error) : NULL;
+   if (data)
+   {
+      free(data->source_file);
+      free(data);
+   }
+}
+
+static unsigned count_members(unsigned *wrong);
+
+/* Runs an extraction to its end, or cancels it after @cancel_after
+ * ticks when that is not 0. With @probe, stops ticking once the pool
+ * is handing out members and waits to see what arrives regardless. */
+static bool run(struct run *r, const char *subdir, unsigned cancel_after,
+      bool probe)
+{
+   retro_task_t *task;
+
+   memset(r, 0, sizeof(*r));
+   r->last_progress = -1;
+
+   if (!(task = (retro_task_t*)task_push_decompress(ARCHIVE, OUT_DIR,
+               NULL, subdir, NULL, run_cb, r, NULL, true)))
+      return false;
+
+   while (!r->done && r->ticks < MAX_TICKS)
+   {
+      task_queue_check();
+      r->ticks++;
+      if (r->done)
+         break;
+      /* Unthreaded, so the task is only ever touched in here */
+      if (task_get_progress(task) < r->last_progress)
+         r->progress_backwards = true;
+      r->last_progress = task_get_progress(task);
+      if (cancel_after && r->ticks == cancel_after)
+         task_queue_cancel_task(task);
+      /* The first tick opens the archive, the second sets up the pool
+       * and fills its backlog */
+      if (probe && r->ticks == 2)
+      {
+         unsigned wrong, tries;
+         for (tries = 0; tries < 1000; tries++)
+         {
+            if ((r->between_ticks = count_members(&wrong)) > 1)
+               break;
+            usleep(10000);
+         }
+      }
+   }
+
+   return r->done;
+}
+
+static unsigned count_members(unsigned *wrong)
+{
+   char path[PATH_MAX_LENGTH];
+   unsigned i, found = 0;
+
+   *wrong = 0;
+   for (i = 0; i < MEMBERS; i++)
+   {
+      char name[32];
+      int m;
+      member_name(name, sizeof(name), i);
+      snprintf(path, sizeof(path), "%s/%s", OUT_DIR, name);
+      if ((m = member_matches(path, i)) != 0)
+         found++;
+      if (m < 0)
+         (*wrong)++;
+   }
+   return found;
+}
+
+static void lane_extract(const char *lane, unsigned cores)
+{
+   struct run r;
+   unsigned had = failures;
+   unsigned wrong, found;
+
+   stub_cores = cores;
+   remove_output();
+   CHECK(run(&r, NULL, 0, cores > 1), "%s: never finished", lane);
+   CHECK(!r.error, "%s: failed: %s", lane, r.error ? r.error : "");
+   found = count_members(&wrong);
+   CHECK(found == MEMBERS && !wrong, "%s: %u of %u members, %u wrong",
+         lane, found, MEMBERS, wrong);
+   CHECK(!r.progress_backwards, "%s: progress went backwards", lane);
+   CHECK(r.last_progress == 100, "%s: progress ended at %d", lane,
+         r.last_progress);
+   if (cores > 1)
+      CHECK(r.between_ticks > 1,
+            "%s: %u members written between ticks", lane, r.between_ticks);
+   else
+      CHECK(r.ticks >= MEMBERS,
+            "%s: %u ticks for %u members", lane, r.ticks, MEMBERS);
+   free(r.error);
+
+   if (failures == had)
+      fprintf(stderr, "[pass] %s lane, %u ticks, %u members between\n",
+            lane, r.ticks, r.between_ticks);
+}
+
+static void lane_subdir(void)
+{
+   char path[PATH_MAX_LENGTH];
+   struct run r;
+   unsigned had  = failures;
+   unsigned i, found = 0;
+
+   stub_cores = 4;
+   remove_output();
+   CHECK(run(&r, "dir3", 0, false), "subdir: never finished");
+   CHECK(!r.error, "subdir: failed: %s", r.error ? r.error : "");
+   for (i = 0; i < MEMBERS; i++)
+   {
+      char name[32];
+      int m;
+      member_name(name, sizeof(name), i);
+      snprintf(path, sizeof(path), "%s/%s", OUT_DIR, path_basename(name));
+      m = member_matches(path, i);
+      CHECK(m >= 0, "subdir: %s is wrong", path);
+      CHECK((m == 1) == (i % DIRS == 3), "subdir: %s %s", path,
+            m ? "extracted" : "missing");
+      found += (m == 1);
+   }
+   free(r.error);
+
+   if (failures == had)
+      fprintf(stderr, "[pass] subdir lane, %u members\n", found);
+}
+
+static void lane_corrupt(void)
+{
+   struct run r;
+   unsigned had = failures;
+   unsigned wrong;
+
+   stub_cores = 4;
+   remove_output();
+   CHECK(write_archive(40), "could not write the archive");
+   CHECK(run(&r, NULL, 0, false), "corrupt: never finished");
+   CHECK(     r.error && strstr(r.error, "Failed to deflate")
+         && strstr(r.error, "file040.bin"),
+         "corrupt: error was %s", r.error ? r.error : "(none)");
+   count_members(&wrong);
+   CHECK(!wrong, "corrupt: %u members written wrong", wrong);
+   free(r.error);
+
+   if (failures == had)
+      fprintf(stderr, "[pass] corrupt lane\n");
+}
+
+/* Reads member @i's FIFO until the worker blocked on it has written
+ * and closed it. Returns 1 if it wrote the member exactly, 0 if it
+ * never turned up, -1 if it wrote something else. */
+static int drain_gate(const char *path, unsigned i)
+{
+   size_t usize  = member_size(i);
+   uint8_t *want = (uint8_t*)malloc(usize + 1);
+   uint8_t *got  = (uint8_t*)malloc(usize + 1);
+   size_t have   = 0;
+   unsigned tries;
+   int ret       = 0;
+   /* Non-blocking, so a worker that is not there cannot hang the test;
+    * opening the read end is what lets its open for writing through. */
+   int fd        = open(path, O_RDONLY | O_NONBLOCK);
+
+   if (fd < 0)
+   {
+      free(want);
+      free(got);
+      return 0;
+   }
+   member_fill(want, usize, i);
+   for (tries = 0; tries < 5000; tries++)
+   {
+      ssize_t n = read(fd, got + have, usize + 1 - have);
+      if (n > 0)
+         have += (size_t)n;
+      /* End of file only counts once the whole member is in: before
+       * its writer has opened the FIFO, there is no writer either. */
+      else if (n == 0 && have >= usize)
+      {
+         ret = (have == usize && !memcmp(got, want, usize)) ? 1 : -1;
+         break;
+      }
+      else if (n < 0 && errno != EAGAIN)
+         break;
+      else
+         usleep(1000);
+   }
+   close(fd);
+   free(want);
+   free(got);
+   return ret;
+}
+
+static void lane_cancel(void)
+{
+   char path[PATH_MAX_LENGTH];
+   struct run r;
+   retro_task_t *task;
+   unsigned had  = failures;
+   unsigned i, found = 0, wrong = 0, written = 0;
+
+   stub_cores = 4;
+   remove_output();
+   memset(&r, 0, sizeof(r));
+
+   mkdir(OUT_DIR, 0755);
+   for (i = 0; i < GATED; i++)
+   {
+      char name[32];
+      member_name(name, sizeof(name), i);
+      snprintf(path, sizeof(path), "%s/dir%u", OUT_DIR, i % DIRS);
+      mkdir(path, 0755);
+      snprintf(path, sizeof(path), "%s/%s", OUT_DIR, name);
+      CHECK(mkfifo(path, 0644) == 0, "cancel: could not make %s", path);
+   }
+
+   task = (retro_task_t*)task_push_decompress(ARCHIVE, OUT_DIR,
+         NULL, NULL, NULL, run_cb, &r, NULL, true);
+   CHECK(task != NULL, "cancel: task not pushed");
+   if (!task)
+      return;
+
+   /* The first tick opens the archive, the second sets up the pool and
+    * fills its backlog: from then on every worker is stuck on a FIFO.
+    * Given the time a member takes to land in the pool lane, nothing
+    * else does. */
+   for (; r.ticks < 2 && !r.done; r.ticks++)
+      task_queue_check();
+   usleep(200000);
+   for (i = GATED; i < MEMBERS; i++)
+   {
+      char name[32];
+      member_name(name, sizeof(name), i);
+      snprintf(path, sizeof(path), "%s/%s", OUT_DIR, name);
+      found += (member_matches(path, i) != 0);
+   }
+   CHECK(!r.done && !found,
+         "cancel: %u members written past the gate", found);
+
+   /* Cancelled with every worker mid-member: the task has to hold on
+    * until they are done with the archive. */
+   task_queue_cancel_task(task);
+   for (i = 0; i < 10 && !r.done; i++, r.ticks++)
+      task_queue_check();
+   CHECK(!r.done, "cancel: finished with members still being written");
+
+   for (i = 0; i < GATED; i++)
+   {
+      char name[32];
+      int m;
+      member_name(name, sizeof(name), i);
+      snprintf(path, sizeof(path), "%s/%s", OUT_DIR, name);
+      m        = drain_gate(path, i);
+      written += (m == 1);
+      CHECK(m == 1, "cancel: %s %s", name,
+            m ? "was written wrong" : "was never being written");
+   }
+
+   for (; !r.done && r.ticks < MAX_TICKS; r.ticks++)
+      task_queue_check();
+   CHECK(r.done, "cancel: never finished");
+   CHECK(r.error && !strcmp(r.error, "Task canceled"),
+         "cancel: error was %s", r.error ? r.error : "(none)");
+
+   /* What was being written when it stopped is gone, and the backlog
+    * behind it was dropped, not extracted. */
+   for (i = 0; i < GATED; i++)
+   {
+      char name[32];
+      struct stat st;
+      member_name(name, sizeof(name), i);
+      snprintf(path, sizeof(path), "%s/%s", OUT_DIR, name);
+      CHECK(stat(path, &st) != 0, "cancel: %s left behind", name);
+      /* A FIFO left there would block the count below */
+      remove(path);
+   }
+   found = count_members(&wrong);
+   CHECK(!found, "cancel: %u members extracted after the cancel", found);
+   CHECK(!wrong, "cancel: %u members written wrong", wrong);
+   free(r.error);
+
+   if (failures == had)
+      fprintf(stderr, "[pass] cancel lane, %u of %u workers cancelled "
+            "mid-member, all removed\n", written, GATED);
+}
+
+int main(void)
+{
+   task_queue_init(false, NULL);
+
+   if (!write_archive(-1))
+   {
+      fprintf(stderr, "FAIL decompress_pool_test: could not write %s\n",
+            ARCHIVE);
+      return 1;
+   }
+
+   lane_extract("pool", 4);
+   lane_extract("serial", 1);
+   lane_subdir();
+   lane_cancel();
+   lane_corrupt();
+
+   task_queue_deinit();
+   remove_output();
+   remove(ARCHIVE);
+
+   if (failures)
+   {
+      fprintf(stderr, "FAIL decompress_pool_test: %u failures\n", failures);
+      return 1;
+   }
+   fprintf(stderr, "PASS decompress_pool_test\n");
+   return 0;
+}
@@ -124,6 +124,7 @@
 #include <string.h>
 #include <stdint.h>
 #include <stdarg.h>
+#include <time.h>
 
 #include <retro_common_api.h>
 #include <queues/message_queue.h>
@@ -137,6 +138,7 @@
 #include "../../../core.h"
 #include "../../../msg_hash.h"
 #include "../../../gfx/video_driver.h"
+#include "../../../disk_control_interface.h"
 
 /* Must match tasks/task_save.c.  Duplicated rather than exported: the
  * constants are an implementation detail of the handler and a test
@@ -175,6 +177,21 @@ retro_time_t cpu_features_get_time_usec(void)
  * table path if anything ever does. */
 uint64_t cpu_features_get(void) { return 0; }
 
+/* The autosave interval is kept in whole seconds of time(NULL).  Linked
+ * with -Wl,--wrap=time so a test can move that on instead of sleeping
+ * through it. */
+static time_t wall_offset = 0;
+
+extern time_t __real_time(time_t *t);
+
+time_t __wrap_time(time_t *t)
+{
+   time_t now = __real_time(NULL) + wall_offset;
+   if (t)
+      *t = now;
+   return now;
+}
+
 /* -----------------------------------------------------------------
  * Stub core
  * ----------------------------------------------------------------- */
@@ -276,6 +293,9 @@ bool core_unserialize(retro_ctx_serialize_info_t *info)
 
    if (info->size != core_len)
       return false;
+   /* As runloop.c's does: whatever was serialized before this is no
+    * longer the core's state.  See test 17. */
+   content_state_snapshot_invalidate();
    memcpy(core_mem, src, core_len);
    return true;
 }
@@ -317,6 +337,38 @@ void RARCH_LOG(const char *fmt, ...)  { (void)fmt; }
 void RARCH_WARN(const char *fmt, ...) { (void)fmt; }
 void RARCH_ERR(const char *fmt, ...)  { (void)fmt; }
 
+/* For disk_control_interface.c, which is linked so that test 17 swaps
+ * discs through the frontend's own call.  It only reaches these when
+ * a swap fails or the disk index is recorded, neither of which the
+ * test does. */
+void runloop_msg_queue_push(const char *msg, size_t len,
+      unsigned prio, unsigned duration,
+      bool flush, char *title, enum message_queue_icon icon,
+      enum message_queue_category category)
+{
+   (void)msg; (void)len; (void)prio; (void)duration;
+   (void)flush; (void)title; (void)icon; (void)category;
+}
+
+bool disk_index_file_init(disk_index_file_t *disk_index_file,
+      const char *content_path, const char *dir_savefile)
+{
+   (void)disk_index_file; (void)content_path; (void)dir_savefile;
+   return false;
+}
+
+void disk_index_file_set(disk_index_file_t *disk_index_file,
+      unsigned image_index, const char *image_path)
+{
+   (void)disk_index_file; (void)image_index; (void)image_path;
+}
+
+bool disk_index_file_save(disk_index_file_t *disk_index_file)
+{
+   (void)disk_index_file;
+   return false;
+}
+
 static void msg_push_stub(retro_task_t *task, const char *msg,
       unsigned prio, unsigned dur, bool flush)
 {
@@ -988,6 +1040,378 @@ static void test_undo_allocates_nothing(void)
    content_reset_savestate_backups();
 }
 
+/* -----------------------------------------------------------------
+ * 13. Slot saves reuse their buffer.
+ *
+ *     A slot save hands its serialized state to the save task, which
+ *     used to free it when the write was done - so every save paid
+ *     for a fresh state-sized mmap, the cost test 9 measures for the
+ *     undo snapshot.  The buffer now goes back to a pool when the
+ *     task's callback runs, and the next save serializes into it.
+ *
+ *     The file is deleted before each save so that no save takes the
+ *     load-to-backup path, whose read of the old file is a
+ *     state-sized allocation of its own.
+ * ----------------------------------------------------------------- */
+static void test_slot_saves_reuse_buffer(void)
+{
+   const char *path = "sst_pool.state";
+   int i, written   = 0;
+
+   frontend_reset();
+   core_fill(7 * TEST_SAVE_STATE_CHUNK);
+   content_reset_savestate_backups();
+
+   /* The first save is the one that allocates. */
+   filestream_delete(path);
+   content_save_state(path, true);
+   pump(1000);
+
+   alloc_count_begin();
+   for (i = 0; i < 6; i++)
+   {
+      filestream_delete(path);
+      content_state_snapshot_invalidate();
+      content_save_state(path, true);
+      pump(1000);
+      if (file_size(path) == (long)content_get_serialized_size())
+         written++;
+   }
+   alloc_count_end();
+
+   okf(written == 6, "six pooled slot saves all write full files");
+   okf(big_allocs == 0,
+       "slot saves allocate no state-sized buffer in steady state");
+   if (big_allocs != 0)
+      printf("       (%d state-sized allocations for 6 saves)\n",
+            big_allocs);
+
+   filestream_delete(path);
+   content_reset_savestate_backups();
+}
+
+/* -----------------------------------------------------------------
+ * 14. Saves of the same state share one snapshot, and only those.
+ *
+ *     A RAM state and a slot save taken before the core runs again
+ *     want the same bytes, so the second must not ask the core for
+ *     them a second time.  Once the state has moved on
+ *     (content_state_snapshot_invalidate(), which the frontend calls
+ *     wherever the core runs, resets or unserializes), the next save
+ *     must serialize afresh - and must not write into the snapshot
+ *     the RAM state still holds, which loading it back checks.
+ * ----------------------------------------------------------------- */
+static void test_snapshot_shared(void)
+{
+   const char *path = "sst_shared.state";
+   size_t   sz      = 4 * TEST_SAVE_STATE_CHUNK;
+   uint8_t *expect;
+
+   frontend_reset();
+   core_fill(sz);
+   content_reset_savestate_backups();
+   content_state_snapshot_invalidate();
+   filestream_delete(path);
+
+   expect = (uint8_t*)malloc(sz);
+   memcpy(expect, core_mem, sz);
+
+   ser_dest_reset();
+   okf(content_save_state_to_ram(), "a RAM state is taken");
+   okf(content_save_state(path, true), "a slot save of the same frame");
+   pump(1000);
+   okf(ser_dest_calls == 1, "the two share one serialize");
+   okf(file_size(path) == (long)content_get_serialized_size(),
+       "the shared snapshot is written in full");
+
+   /* A frame runs. */
+   memset(core_mem, 0x5A, sz);
+   content_state_snapshot_invalidate();
+   filestream_delete(path);
+   okf(content_save_state(path, true), "a slot save of the next frame");
+   pump(1000);
+   okf(ser_dest_calls == 2, "a new frame serializes again");
+
+   okf(content_load_state_from_ram(), "the RAM state loads back");
+   okf(memcmp(expect, core_mem, sz) == 0,
+       "the RAM state is the frame it was taken on");
+
+   free(expect);
+   filestream_delete(path);
+   content_reset_savestate_backups();
+}
+
+/* -----------------------------------------------------------------
+ * 15. The interval autosave writes from a task.
+ *
+ *     content_save_state_automatic() used to serialize, compress and
+ *     write on the main thread; it now only serializes, and the write
+ *     is a save task's.  So the call returns with the file not yet
+ *     written, and pumping the queue finishes it.  While a save is in
+ *     flight it must not serialize at all, and it must try again
+ *     afterwards.
+ * ----------------------------------------------------------------- */
+static void test_automatic_save_is_async(void)
+{
+   char   path[64];
+   size_t sz = 16 * TEST_SAVE_STATE_CHUNK;
+
+   frontend_reset();
+   core_fill(sz);
+   content_reset_savestate_backups();
+   content_state_snapshot_invalidate();
+   runloop_get_savestate_path(path, sizeof(path), -1);
+   filestream_delete(path);
+   filestream_delete("sst_auto_busy.state");
+   stub_settings.uints.savestate_automatic_interval = 1;
+   /* One quantum per tick, so a save can be caught in flight. */
+   clock_step = TEST_TICK_BUDGET_US;
+
+   content_save_state("sst_auto_busy.state", true);
+   ser_dest_reset();
+   okf(!content_save_state_automatic(),
+       "no autosave while a save is in flight");
+   okf(ser_dest_calls == 0, "and no serialize for it either");
+   pump(1000);
+
+   okf(content_save_state_automatic(), "the autosave is queued after");
+   okf(file_size(path) != (long)content_get_serialized_size(),
+       "the autosave returns before its file is written");
+   pump(1000);
+   okf(file_size(path) == (long)content_get_serialized_size(),
+       "the autosave task writes it in full");
+
+   filestream_delete(path);
+   filestream_delete("sst_auto_busy.state");
+   content_reset_savestate_backups();
+}
+
+/* -----------------------------------------------------------------
+ * 16. The interval autosave does not hold up the user.
+ *
+ *     Its task is not a blocking one, so a slot save or a load the
+ *     user asks for while it writes goes ahead.  Only its own file is
+ *     refused, to save and to load, until it is done - two writers
+ *     would interleave their chunks, and a load would read half a
+ *     state.  It is muted, so it must not hold back everyone else's
+ *     messages for a screenshot it does not announce.
+ * ----------------------------------------------------------------- */
+static void test_automatic_save_beside_user(void)
+{
+   char        path[64];
+   const char *slot  = "sst_auto_slot.state";
+   const char *other = "sst_auto_other.state";
+   size_t      sz    = 16 * TEST_SAVE_STATE_CHUNK;
+   uint8_t    *expect;
+
+   frontend_reset();
+   core_fill(sz);
+   content_reset_savestate_backups();
+   content_state_snapshot_invalidate();
+   runloop_get_savestate_path(path, sizeof(path), -1);
+   filestream_delete(path);
+   filestream_delete(slot);
+   filestream_delete(other);
+   stub_settings.uints.savestate_automatic_interval = 1;
+   stub_settings.bools.savestate_thumbnail_enable   = true;
+   stub_settings.bools.notification_show_save_state = true;
+
+   expect = (uint8_t*)malloc(sz);
+   memcpy(expect, core_mem, sz);
+
+   /* Something to load beside it later */
+   content_save_state(other, true);
+   pump(1000);
+   stub_runloop.msg_queue_delay = 0;
+
+   /* One quantum per tick, so the autosave stays in flight. */
+   clock_step   = TEST_TICK_BUDGET_US;
+   wall_offset += 2;
+   okf(content_save_state_automatic(), "the autosave is queued");
+   okf(stub_runloop.msg_queue_delay == 0,
+       "a muted autosave holds back no messages");
+   task_queue_check();
+
+   /* A frame runs.  Nothing blocking is in flight yet, so only the
+    * autosave's own guard can refuse these two. */
+   memset(core_mem, 0x3C, sz);
+   content_state_snapshot_invalidate();
+   content_save_state(path, true);
+   okf(!content_load_state(path, false, false),
+       "a load of the file it is writing is refused");
+   okf(content_save_state(slot, true),
+       "a slot save is admitted beside the autosave");
+   okf(stub_runloop.msg_queue_delay == 12,
+       "an announced save still holds messages for its screenshot");
+   pump(1000);
+
+   okf(!queue_busy(), "the queue drains");
+   okf(file_size(slot) == (long)content_get_serialized_size(),
+       "the slot save is written in full");
+   okf(content_load_state(path, false, false),
+       "the autosave's file loads once it is done");
+   pump(1000);
+   okf(memcmp(expect, core_mem, sz) == 0,
+       "and holds only what the autosave wrote");
+
+   /* Again, with a load beside it. */
+   memset(core_mem, 0x3C, sz);
+   content_state_snapshot_invalidate();
+   wall_offset += 2;
+   okf(content_save_state_automatic(), "the next autosave is queued");
+   task_queue_check();
+   okf(content_load_state(other, false, false),
+       "a load of another slot is admitted beside it");
+   pump(1000);
+   okf(!queue_busy(), "the queue drains");
+   okf(memcmp(expect, core_mem, sz) == 0, "the other slot loaded");
+   memset(expect, 0x3C, sz);
+   okf(content_load_state(path, false, false), "the autosave loads");
+   pump(1000);
+   okf(memcmp(expect, core_mem, sz) == 0,
+       "the autosave is the frame it was taken on");
+
+   free(expect);
+   filestream_delete(path);
+   filestream_delete(slot);
+   filestream_delete(other);
+   content_reset_savestate_backups();
+}
+
+/* -----------------------------------------------------------------
+ * 17. A load, a disc swap or a reset starts a new snapshot.
+ *
+ *     Test 14 shows a running frame does.  These three move the
+ *     core's state on without a frame, and each calls
+ *     content_state_snapshot_invalidate() itself: core_unserialize()
+ *     and core_reset() in runloop.c, and disk_control_set_index() in
+ *     disk_control_interface.c, which is linked here and driven
+ *     through a stub disc tray.  runloop.c cannot be linked, so the
+ *     stub core_unserialize above and snapshot_reset() below do what
+ *     its two do.
+ *
+ *     In each case a RAM state is holding the snapshot from before.
+ *     The slot save after must serialize again, must write the state
+ *     as it is now, and must leave the RAM state's snapshot alone.
+ * ----------------------------------------------------------------- */
+static unsigned stub_disc_index;
+static bool     stub_disc_ejected;
+
+static bool stub_disc_set_eject(bool ejected)
+{
+   stub_disc_ejected = ejected;
+   return true;
+}
+static bool stub_disc_get_eject(void)  { return stub_disc_ejected; }
+static unsigned stub_disc_get_index(void) { return stub_disc_index; }
+static unsigned stub_disc_count(void)  { return 2; }
+
+/* A core keeps the disc it is reading in its state. */
+static bool stub_disc_set_index(unsigned index)
+{
+   stub_disc_index = index;
+   memset(core_mem, 0x40 + (int)index, core_len);
+   return true;
+}
+
+static void snapshot_load(void)
+{
+   content_load_state("sst_event_other.state", false, false);
+   pump(1000);
+}
+
+static void snapshot_swap(void)
+{
+   disk_control_interface_t dc;
+
+   memset(&dc, 0, sizeof(dc));
+   dc.cb.set_eject_state = stub_disc_set_eject;
+   dc.cb.get_eject_state = stub_disc_get_eject;
+   dc.cb.get_image_index = stub_disc_get_index;
+   dc.cb.set_image_index = stub_disc_set_index;
+   dc.cb.get_num_images  = stub_disc_count;
+   stub_disc_index       = 0;
+   stub_disc_ejected     = false;
+   disk_control_set_index(&dc, 1, false);
+}
+
+/* runloop.c's core_reset(), less the video caches. */
+static void snapshot_reset(void)
+{
+   content_state_snapshot_invalidate();
+   memset(core_mem, 0x00, core_len);
+}
+
+static void test_snapshot_events(void)
+{
+   static const struct
+   {
+      void      (*event)(void);
+      const char *name;
+   } events[] = {
+      { snapshot_load,  "a state load" },
+      { snapshot_swap,  "a disc swap"  },
+      { snapshot_reset, "a reset"      },
+   };
+   const char *path  = "sst_event.state";
+   const char *other = "sst_event_other.state";
+   size_t      sz    = 4 * TEST_SAVE_STATE_CHUNK;
+   uint8_t    *before, *after;
+   unsigned    i;
+   char        what[96];
+
+   before = (uint8_t*)malloc(sz);
+   after  = (uint8_t*)malloc(sz);
+
+   for (i = 0; i < sizeof(events) / sizeof(events[0]); i++)
+   {
+      frontend_reset();
+      core_fill(sz);
+      content_reset_savestate_backups();
+      filestream_delete(path);
+      filestream_delete(other);
+
+      /* What the load will bring back. */
+      memset(core_mem, 0x77, sz);
+      content_state_snapshot_invalidate();
+      content_save_state(other, true);
+      pump(1000);
+
+      core_fill(sz);
+      content_state_snapshot_invalidate();
+      memcpy(before, core_mem, sz);
+      okf(content_save_state_to_ram(), "a RAM state holds the snapshot");
+
+      events[i].event();
+      memcpy(after, core_mem, sz);
+      snprintf(what, sizeof(what), "%s moves the core's state on",
+            events[i].name);
+      okf(memcmp(before, after, sz) != 0, what);
+
+      ser_dest_reset();
+      okf(content_save_state(path, true), "a slot save after it");
+      pump(1000);
+      snprintf(what, sizeof(what), "a slot save after %s serializes again",
+            events[i].name);
+      okf(ser_dest_calls == 1, what);
+
+      okf(content_load_state_from_ram(), "the RAM state loads back");
+      okf(memcmp(before, core_mem, sz) == 0,
+          "the RAM state is the state it was taken on");
+      okf(content_load_state(path, false, false), "the slot save loads");
+      pump(1000);
+      snprintf(what, sizeof(what), "the slot save is the state after %s",
+            events[i].name);
+      okf(memcmp(after, core_mem, sz) == 0, what);
+   }
+
+   free(before);
+   free(after);
+   filestream_delete(path);
+   filestream_delete(other);
+   content_reset_savestate_backups();
+}
+
 /* -----------------------------------------------------------------
  * Closing content while a save is in flight.
  *
@@ -1061,6 +1485,11 @@ static int run_default_lane(void)
    test_undo_snapshot_grows();
    test_undo_snapshot_failure_keeps_previous();
    test_undo_allocates_nothing();
+   test_slot_saves_reuse_buffer();
+   test_snapshot_shared();
+   test_automatic_save_is_async();
+   test_automatic_save_beside_user();
+   test_snapshot_events();
 
    content_reset_savestate_backups();
    task_queue_deinit();
@@ -0,0 +1,587 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (scan_cache_test.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Oracle for tasks/task_database_scan_cache.c, the database
+ * scanner's cache of what it read out of each content file.
+ *
+ * The cache file is the only state a rescan trusts without reading
+ * the content again, so what these lanes pin is that it never hands
+ * back a record it should not:
+ *
+ *   roundtrip - records put, saved and loaded come back field for
+ *               field, and saving the loaded cache again writes the
+ *               same bytes.
+ *   stamp     - a size or modification time that differs from the
+ *               one stored is a miss; an archive member is stamped
+ *               with its archive.
+ *   truncated - a file cut anywhere keeps the entries wholly before
+ *               the cut and nothing after it.
+ *   foreign   - another magic, another version, a header alone or
+ *               garbage loads as an empty cache.
+ *   duplicate - a path stored twice keeps its first record, and the
+ *               entries after the duplicate are still read.
+ *   prune     - a save drops the entries under the scanned root that
+ *               the scan did not ask about, keeps those it did (stale
+ *               ones included) and those outside the root, and does
+ *               not take "/roms2" for a child of "/roms".
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <boolean.h>
+#include <file/file_path.h>
+#include <streams/file_stream.h>
+
+#include "../../../tasks/task_database_scan_cache.h"
+
+#define CACHE_PATH   "rarch_scan_cache_test.cache"
+#define CONTENT_PATH "rarch_scan_cache_test.bin"
+#define ARCHIVE_PATH "rarch_scan_cache_test.zip"
+
+static unsigned failures = 0;
+
+#define CHECK(cond, ...) \
+   do { \
+      if (!(cond)) \
+      { \
+         fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__); \
+         fprintf(stderr, __VA_ARGS__); \
+         fprintf(stderr, "\n"); \
+         failures++; \
+      } \
+   } while (0)
+
+static void make_record(scan_cache_record_t *record, unsigned n)
+{
+   memset(record, 0, sizeof(*record));
+   record->size         = 0x100000000ULL + n * 4099u;
+   record->archive_size = n * 7u;
+   record->crc          = 0xC0FFEE00u ^ (n * 2654435761u);
+   record->archive_crc  = n * 40503u;
+   record->type         = n % 5;
+   if (n % 3)
+      snprintf(record->serial, sizeof(record->serial), "SLUS-%05u", n);
+}
+
+static void make_stamp(scan_cache_stamp_t *stamp, unsigned n)
+{
+   stamp->size  = 1000 + n;
+   stamp->mtime = 1700000000 + (int64_t)n * 60;
+}
+
+static bool record_equal(const scan_cache_record_t *a,
+      const scan_cache_record_t *b)
+{
+   return a->size         == b->size
+       && a->archive_size == b->archive_size
+       && a->crc          == b->crc
+       && a->archive_crc  == b->archive_crc
+       && a->type         == b->type
+       && !strcmp(a->serial, b->serial);
+}
+
+/* True when @path is cached and current with the record for @n */
+static bool holds(scan_cache_t *cache, const char *path, unsigned n)
+{
+   scan_cache_stamp_t stamp;
+   scan_cache_record_t want, got;
+   make_stamp(&stamp, n);
+   make_record(&want, n);
+   return scan_cache_get(cache, path, &stamp, &got)
+       && record_equal(&want, &got);
+}
+
+static bool read_file(const char *path, uint8_t **data, int64_t *len)
+{
+   void *buf = NULL;
+   if (!filestream_read_file(path, &buf, len) || !buf)
+      return false;
+   *data = (uint8_t*)buf;
+   return true;
+}
+
+static bool write_file(const char *path, const uint8_t *data, size_t len)
+{
+   return filestream_write_file(path, data, (int64_t)len);
+}
+
+/* Writes the on-disk layout by hand, independently of scan_cache_save,
+ * so that malformed files can be built. */
+static uint8_t *put_le(uint8_t *p, uint64_t v, unsigned bytes)
+{
+   while (bytes--)
+   {
+      *p++ = (uint8_t)v;
+      v  >>= 8;
+   }
+   return p;
+}
+
+static uint8_t *put_header(uint8_t *p, const char *magic, uint32_t version,
+      uint32_t count)
+{
+   memcpy(p, magic, 4);
+   p = put_le(p + 4, version, 4);
+   return put_le(p, count, 4);
+}
+
+static uint8_t *put_entry(uint8_t *p, const char *path, unsigned n)
+{
+   scan_cache_stamp_t stamp;
+   scan_cache_record_t record;
+   size_t path_len   = strlen(path);
+   size_t serial_len;
+
+   make_stamp(&stamp, n);
+   make_record(&record, n);
+   serial_len = strlen(record.serial);
+
+   p = put_le(p, path_len, 2);
+   memcpy(p, path, path_len);
+   p += path_len;
+   p = put_le(p, (uint64_t)stamp.size,  8);
+   p = put_le(p, (uint64_t)stamp.mtime, 8);
+   p = put_le(p, record.size,           8);
+   p = put_le(p, record.archive_size,   8);
+   p = put_le(p, record.crc,            4);
+   p = put_le(p, record.archive_crc,    4);
+   *p++ = (uint8_t)record.type;
+   *p++ = (uint8_t)serial_len;
+   memcpy(p, record.serial, serial_len);
+   return p + serial_len;
+}
+
+static void put_n(scan_cache_t *cache, const char *path, unsigned n)
+{
+   scan_cache_stamp_t stamp;
+   scan_cache_record_t record;
+   make_stamp(&stamp, n);
+   make_record(&record, n);
+   scan_cache_put(cache, path, &stamp, &record);
+}
+
+static void lane_roundtrip(void)
+{
+   char path[64];
+   unsigned i;
+   uint8_t *first = NULL, *second = NULL;
+   int64_t first_len = 0, second_len = 0;
+   unsigned had        = failures;
+   scan_cache_t *cache = scan_cache_load(CACHE_PATH);
+
+   CHECK(cache, "no cache for a missing file");
+   if (!cache)
+      return;
+
+   /* Past the initial capacity, so the entries and index both grow */
+   for (i = 0; i < 600; i++)
+   {
+      snprintf(path, sizeof(path), "/roms/dir%u/game%u.bin", i % 7, i);
+      put_n(cache, path, i);
+   }
+   /* The longest serial there is room for */
+   {
+      scan_cache_stamp_t stamp;
+      scan_cache_record_t record;
+      make_stamp(&stamp, 9999);
+      make_record(&record, 9999);
+      memset(record.serial, 'S', SCAN_CACHE_SERIAL_MAX - 1);
+      record.serial[SCAN_CACHE_SERIAL_MAX - 1] = '\0';
+      scan_cache_put(cache, "/roms/long_serial.iso", &stamp, &record);
+   }
+   CHECK(scan_cache_save(cache, CACHE_PATH, "/roms"), "save failed");
+   CHECK(!path_is_valid(CACHE_PATH ".tmp"), "temp file left behind");
+   scan_cache_free(cache);
+
+   cache = scan_cache_load(CACHE_PATH);
+   for (i = 0; i < 600; i++)
+   {
+      snprintf(path, sizeof(path), "/roms/dir%u/game%u.bin", i % 7, i);
+      CHECK(holds(cache, path, i), "%s not restored", path);
+   }
+   {
+      scan_cache_stamp_t stamp;
+      scan_cache_record_t record;
+      make_stamp(&stamp, 9999);
+      CHECK(scan_cache_get(cache, "/roms/long_serial.iso", &stamp, &record)
+            && strlen(record.serial) == SCAN_CACHE_SERIAL_MAX - 1,
+            "longest serial not restored");
+   }
+   CHECK(!scan_cache_has(cache, "/roms/dir0/game1.bin"),
+         "a path that was never stored is held");
+
+   /* Nothing changed, so nothing is written... */
+   read_file(CACHE_PATH, &first, &first_len);
+   remove(CACHE_PATH);
+   CHECK(scan_cache_save(cache, CACHE_PATH, "/roms"), "clean save failed");
+   CHECK(!path_is_valid(CACHE_PATH), "clean cache written");
+
+   /* ...and putting the same records back is no change either */
+   for (i = 0; i < 600; i++)
+   {
+      snprintf(path, sizeof(path), "/roms/dir%u/game%u.bin", i % 7, i);
+      put_n(cache, path, i);
+   }
+   scan_cache_save(cache, CACHE_PATH, "/roms");
+   CHECK(!path_is_valid(CACHE_PATH), "unchanged puts made the cache dirty");
+
+   /* A change writes the whole of it again, the same bytes bar that */
+   put_n(cache, "/roms/dir0/game0.bin", 0);
+   put_n(cache, "/other/new.bin", 1);
+   CHECK(scan_cache_save(cache, CACHE_PATH, NULL), "resave failed");
+   scan_cache_free(cache);
+   cache = scan_cache_load(CACHE_PATH);
+   CHECK(holds(cache, "/other/new.bin", 1), "added entry not restored");
+   scan_cache_free(cache);
+
+   /* And a cache saved from a load of itself is byte-identical */
+   write_file(CACHE_PATH, first, (size_t)first_len);
+   cache = scan_cache_load(CACHE_PATH);
+   put_n(cache, "/z", 3);
+   scan_cache_save(cache, CACHE_PATH, NULL);
+   scan_cache_free(cache);
+   read_file(CACHE_PATH, &second, &second_len);
+   /* "/z" has no serial: the fixed part and its two bytes of path */
+   CHECK(second_len == first_len + 44 + 2,
+         "resaved size %ld, expected %ld", (long)second_len,
+         (long)(first_len + 44 + 2));
+   CHECK(second && second_len > 12 && !memcmp(first + 12, second + 12,
+            (size_t)first_len - 12), "resaved entries differ");
+
+   free(first);
+   free(second);
+   remove(CACHE_PATH);
+   if (failures == had)
+      fprintf(stderr, "[pass] roundtrip lane\n");
+}
+
+static void lane_stamp(void)
+{
+   scan_cache_stamp_t stamp, stamp2;
+   scan_cache_record_t record;
+   unsigned had        = failures;
+   scan_cache_t *cache = scan_cache_load(CACHE_PATH);
+
+   put_n(cache, "/roms/a.bin", 1);
+
+   make_stamp(&stamp, 1);
+   stamp.size++;
+   CHECK(!scan_cache_get(cache, "/roms/a.bin", &stamp, &record),
+         "size mismatch was a hit");
+   make_stamp(&stamp, 1);
+   stamp.mtime--;
+   CHECK(!scan_cache_get(cache, "/roms/a.bin", &stamp, &record),
+         "mtime mismatch was a hit");
+   CHECK(scan_cache_has(cache, "/roms/a.bin"),
+         "a stale entry is not held");
+   CHECK(holds(cache, "/roms/a.bin", 1), "current stamp was a miss");
+
+   /* A stale entry survives a save and still misses after a reload */
+   scan_cache_save(cache, CACHE_PATH, "/roms");
+   scan_cache_free(cache);
+   cache = scan_cache_load(CACHE_PATH);
+   make_stamp(&stamp, 1);
+   stamp.mtime++;
+   CHECK(!scan_cache_get(cache, "/roms/a.bin", &stamp, &record),
+         "mtime mismatch was a hit after reload");
+   CHECK(holds(cache, "/roms/a.bin", 1), "current stamp missed after reload");
+   scan_cache_free(cache);
+
+   /* Real files: a member is stamped with its archive */
+   write_file(CONTENT_PATH, (const uint8_t*)"content", 7);
+   write_file(ARCHIVE_PATH, (const uint8_t*)"not really a zip", 16);
+   CHECK(scan_cache_stamp(CONTENT_PATH, &stamp) && stamp.size == 7,
+         "file not stamped with its size");
+   CHECK(scan_cache_stamp(ARCHIVE_PATH "#member.bin", &stamp2)
+         && stamp2.size == 16,
+         "archive member not stamped with its archive's size");
+   CHECK(!scan_cache_stamp("rarch_scan_cache_test.missing", &stamp),
+         "a missing file was stamped");
+
+   remove(CONTENT_PATH);
+   remove(ARCHIVE_PATH);
+   remove(CACHE_PATH);
+   if (failures == had)
+      fprintf(stderr, "[pass] stamp lane\n");
+}
+
+static void lane_truncated(void)
+{
+   uint8_t buf[1024];
+   size_t ends[4];
+   uint8_t *p;
+   size_t cut;
+   unsigned i;
+   unsigned had = failures;
+
+   /* Three entries, with the offset each one ends at */
+   p       = put_header(buf, "RASC", 1, 3);
+   p       = put_entry(p, "/roms/one.bin", 1);
+   ends[0] = (size_t)(p - buf);
+   p       = put_entry(p, "/roms/two.bin", 2);
+   ends[1] = (size_t)(p - buf);
+   p       = put_entry(p, "/roms/three.bin", 4);
+   ends[2] = (size_t)(p - buf);
+
+   for (cut = 0; cut <= ends[2]; cut++)
+   {
+      scan_cache_t *cache;
+      unsigned whole = 0;
+
+      for (i = 0; i < 3; i++)
+         if (ends[i] <= cut)
+            whole++;
+
+      write_file(CACHE_PATH, buf, cut);
+      cache = scan_cache_load(CACHE_PATH);
+      CHECK(cache, "no cache for a %u-byte file", (unsigned)cut);
+      if (!cache)
+         continue;
+      CHECK(holds(cache, "/roms/one.bin", 1) == (whole >= 1)
+            && scan_cache_has(cache, "/roms/one.bin") == (whole >= 1),
+            "first entry wrong at cut %u", (unsigned)cut);
+      CHECK(holds(cache, "/roms/two.bin", 2) == (whole >= 2)
+            && scan_cache_has(cache, "/roms/two.bin") == (whole >= 2),
+            "second entry wrong at cut %u", (unsigned)cut);
+      CHECK(holds(cache, "/roms/three.bin", 4) == (whole >= 3)
+            && scan_cache_has(cache, "/roms/three.bin") == (whole >= 3),
+            "third entry wrong at cut %u", (unsigned)cut);
+      scan_cache_free(cache);
+   }
+
+   /* A count larger than the entries there are is a truncation too */
+   put_header(buf, "RASC", 1, 0xFFFFFFFFu);
+   write_file(CACHE_PATH, buf, ends[2]);
+   {
+      scan_cache_t *cache = scan_cache_load(CACHE_PATH);
+      CHECK(holds(cache, "/roms/three.bin", 4), "overcounted file lost data");
+      scan_cache_free(cache);
+   }
+
+   remove(CACHE_PATH);
+   if (failures == had)
+      fprintf(stderr, "[pass] truncated lane\n");
+}
+
+static void lane_foreign(void)
+{
+   static const struct
+   {
+      const char *magic;
+      uint32_t version;
+      uint32_t count;
+      bool entry;
+   } cases[] = {
+      { "RASX", 1, 1, true  },   /* another magic */
+      { "RASC", 2, 1, true  },   /* a later version */
+      { "RASC", 0, 1, true  },   /* an earlier one */
+      { "RASC", 1, 0, true  },   /* an entry past the count */
+      { "RASC", 1, 0, false },   /* a header alone */
+   };
+   uint8_t buf[512];
+   unsigned i;
+   unsigned had = failures;
+
+   for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+   {
+      scan_cache_t *cache;
+      uint8_t *p = put_header(buf, cases[i].magic, cases[i].version,
+            cases[i].count);
+      if (cases[i].entry)
+         p = put_entry(p, "/roms/one.bin", 1);
+      write_file(CACHE_PATH, buf, (size_t)(p - buf));
+      cache = scan_cache_load(CACHE_PATH);
+      CHECK(cache && !scan_cache_has(cache, "/roms/one.bin"),
+            "case %u was not loaded as empty", i);
+      scan_cache_free(cache);
+   }
+
+   /* Garbage, and a path that is not a file at all */
+   for (i = 0; i < sizeof(buf); i++)
+      buf[i] = (uint8_t)(i * 131u + 7u);
+   write_file(CACHE_PATH, buf, sizeof(buf));
+   {
+      scan_cache_t *cache = scan_cache_load(CACHE_PATH);
+      CHECK(cache, "no cache for garbage");
+      scan_cache_free(cache);
+      cache = scan_cache_load(".");
+      CHECK(cache, "no cache for a directory");
+      scan_cache_free(cache);
+   }
+
+   /* An entry with an empty path or an oversized serial ends the read */
+   {
+      scan_cache_t *cache;
+      uint8_t *p = put_header(buf, "RASC", 1, 3);
+      uint8_t *bad;
+      p   = put_entry(p, "/roms/one.bin", 1);
+      bad = p;
+      p   = put_entry(p, "/roms/two.bin", 2);
+      p   = put_entry(p, "/roms/three.bin", 4);
+      /* serial_len sits just before the serial, which for entry 2 is
+       * "SLUS-00002" */
+      bad[2 + 13 + 8 + 8 + 8 + 8 + 4 + 4 + 1] = SCAN_CACHE_SERIAL_MAX;
+      write_file(CACHE_PATH, buf, (size_t)(p - buf));
+      cache = scan_cache_load(CACHE_PATH);
+      CHECK(holds(cache, "/roms/one.bin", 1)
+            && !scan_cache_has(cache, "/roms/two.bin")
+            && !scan_cache_has(cache, "/roms/three.bin"),
+            "read past an oversized serial");
+      scan_cache_free(cache);
+
+      p = put_header(buf, "RASC", 1, 2);
+      p = put_entry(p, "/roms/one.bin", 1);
+      p = put_le(p, 0, 2);
+      memset(p, 0, 42);
+      p += 42;
+      write_file(CACHE_PATH, buf, (size_t)(p - buf));
+      cache = scan_cache_load(CACHE_PATH);
+      CHECK(holds(cache, "/roms/one.bin", 1), "entry before empty path lost");
+      CHECK(!scan_cache_has(cache, ""), "empty path loaded");
+      scan_cache_free(cache);
+   }
+
+   remove(CACHE_PATH);
+   if (failures == had)
+      fprintf(stderr, "[pass] foreign lane\n");
+}
+
+static void lane_duplicate(void)
+{
+   uint8_t buf[1024];
+   uint8_t *p;
+   scan_cache_t *cache;
+   unsigned had = failures;
+
+   p = put_header(buf, "RASC", 1, 4);
+   p = put_entry(p, "/roms/dup.bin", 1);
+   p = put_entry(p, "/roms/other.bin", 2);
+   p = put_entry(p, "/roms/dup.bin", 3);
+   p = put_entry(p, "/roms/after.bin", 4);
+   write_file(CACHE_PATH, buf, (size_t)(p - buf));
+
+   cache = scan_cache_load(CACHE_PATH);
+   CHECK(holds(cache, "/roms/dup.bin", 1), "first record of a duplicate lost");
+   CHECK(!holds(cache, "/roms/dup.bin", 3), "second record of a duplicate won");
+   CHECK(holds(cache, "/roms/other.bin", 2), "entry between duplicates lost");
+   CHECK(holds(cache, "/roms/after.bin", 4), "entry after duplicate lost");
+
+   /* The saved file holds the path once */
+   put_n(cache, "/roms/new.bin", 5);
+   scan_cache_save(cache, CACHE_PATH, NULL);
+   scan_cache_free(cache);
+   {
+      uint8_t *data = NULL;
+      int64_t len   = 0;
+      read_file(CACHE_PATH, &data, &len);
+      CHECK(data && len >= 12 && data[8] == 4 && !data[9],
+            "saved count is not 4");
+      free(data);
+   }
+   cache = scan_cache_load(CACHE_PATH);
+   CHECK(holds(cache, "/roms/dup.bin", 1), "duplicate lost on resave");
+   scan_cache_free(cache);
+
+   remove(CACHE_PATH);
+   if (failures == had)
+      fprintf(stderr, "[pass] duplicate lane\n");
+}
+
+static void lane_prune(void)
+{
+   scan_cache_stamp_t stamp;
+   scan_cache_record_t record;
+   scan_cache_t *cache = scan_cache_load(CACHE_PATH);
+   unsigned had        = failures;
+
+   put_n(cache, "/roms/kept.bin",        1);
+   put_n(cache, "/roms/stale.bin",       2);
+   put_n(cache, "/roms/sub/gone.bin",    3);
+   put_n(cache, "/roms/gone.zip#a.bin",  4);
+   put_n(cache, "/roms2/outside.bin",    5);
+   put_n(cache, "/other/outside.bin",    6);
+   scan_cache_save(cache, CACHE_PATH, NULL);
+   scan_cache_free(cache);
+
+   /* A rescan of /roms that asks about two of its files, one of them
+    * changed since */
+   cache = scan_cache_load(CACHE_PATH);
+   CHECK(holds(cache, "/roms/kept.bin", 1), "kept entry missing");
+   make_stamp(&stamp, 2);
+   stamp.mtime++;
+   CHECK(!scan_cache_get(cache, "/roms/stale.bin", &stamp, &record),
+         "stale entry hit");
+   CHECK(scan_cache_save(cache, CACHE_PATH, "/roms"), "save failed");
+   scan_cache_free(cache);
+
+   cache = scan_cache_load(CACHE_PATH);
+   CHECK(holds(cache, "/roms/kept.bin", 1), "visited entry dropped");
+   CHECK(scan_cache_has(cache, "/roms/stale.bin"),
+         "visited stale entry dropped");
+   CHECK(!scan_cache_has(cache, "/roms/sub/gone.bin"),
+         "unvisited entry in a subdirectory kept");
+   CHECK(!scan_cache_has(cache, "/roms/gone.zip#a.bin"),
+         "unvisited archive member kept");
+   CHECK(holds(cache, "/roms2/outside.bin", 5), "sibling directory pruned");
+   CHECK(holds(cache, "/other/outside.bin", 6), "entry outside root pruned");
+   scan_cache_free(cache);
+
+   /* A root given with its trailing separator prunes the same way */
+   cache = scan_cache_load(CACHE_PATH);
+   CHECK(scan_cache_save(cache, CACHE_PATH, "/roms/"), "save failed");
+   scan_cache_free(cache);
+   cache = scan_cache_load(CACHE_PATH);
+   CHECK(!scan_cache_has(cache, "/roms/kept.bin"),
+         "unvisited entry kept under a root ending in a separator");
+   CHECK(holds(cache, "/roms2/outside.bin", 5), "sibling directory pruned");
+   scan_cache_free(cache);
+
+   remove(CACHE_PATH);
+   if (failures == had)
+      fprintf(stderr, "[pass] prune lane\n");
+}
+
+int main(void)
+{
+   remove(CACHE_PATH);
+
+   lane_roundtrip();
+   lane_stamp();
+   lane_truncated();
+   lane_foreign();
+   lane_duplicate();
+   lane_prune();
+
+   remove(CACHE_PATH);
+   remove(CACHE_PATH ".tmp");
+
+   if (failures)
+   {
+      fprintf(stderr, "FAIL scan_cache_test: %u failures\n", failures);
+      return 1;
+   }
+   fprintf(stderr, "PASS scan_cache_test\n");
+   return 0;
+}
@@ -0,0 +1,390 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (sram_journal_test.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Oracle for save.c's SRAM journal and block-patching autosave.
+ *
+ * Autosave writes only the blocks of save RAM that changed over an
+ * uncompressed save file, through a journal beside it: the blocks go
+ * to the journal, then over the file, then the journal is deleted.
+ * A journal left at the next load is replayed before the file is
+ * read.  What these lanes pin:
+ *
+ *   patch       - a journal written and replayed leaves the file equal
+ *                 to the new buffer and the journal gone, for runs of
+ *                 blocks, single blocks and a short last block.
+ *   interrupted - a crash after the journal was written, with the file
+ *                 part patched, is made good by the load: the core's
+ *                 RAM gets the new contents.
+ *   torn        - a journal cut short is discarded, and the file it
+ *                 was for left exactly as it was.
+ *   foreign     - a journal for a file of another size is discarded.
+ *   autosave    - the thread itself: after its first write, a change
+ *                 to one block rewrites that block and no other (a
+ *                 byte poked into the file behind its back survives),
+ *                 and a change to most of the file rewrites it whole.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdarg.h>
+
+#include <boolean.h>
+#include <retro_timers.h>
+#include <streams/file_stream.h>
+#include <file/file_path.h>
+
+#include "../../../autosave.h"
+#include "../../../core.h"
+#include "../../../msg_hash.h"
+#include "../../../paths.h"
+#include "../../../tasks/tasks_internal.h"
+
+#define SAVE_PATH    "rarch_sram_journal_test.srm"
+#define JOURNAL_PATH SAVE_PATH ".journal"
+#define BLOCK        4096
+/* Ten whole blocks and a short eleventh */
+#define SRAM_SIZE    (10 * BLOCK + 100)
+#define NUM_BLOCKS   11
+
+static unsigned failures = 0;
+
+#define CHECK(cond, ...) \
+   do { \
+      if (!(cond)) \
+      { \
+         fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__); \
+         fprintf(stderr, __VA_ARGS__); \
+         fprintf(stderr, "\n"); \
+         failures++; \
+      } \
+   } while (0)
+
+/* The stub core's save RAM */
+static uint8_t sram[SRAM_SIZE];
+
+bool core_get_memory(retro_ctx_memory_info_t *info)
+{
+   info->data = NULL;
+   info->size = 0;
+   if (info->id == RETRO_MEMORY_SAVE_RAM)
+   {
+      info->data = sram;
+      info->size = sizeof(sram);
+   }
+   return true;
+}
+
+const char *msg_hash_to_str(enum msg_hash_enums msg) { (void)msg; return ""; }
+bool fill_pathname_application_data(char *s, size_t len)
+{ (void)s; (void)len; return false; }
+void RARCH_LOG(const char *fmt, ...)  { (void)fmt; }
+void RARCH_WARN(const char *fmt, ...) { (void)fmt; }
+void RARCH_ERR(const char *fmt, ...)  { (void)fmt; }
+
+static void fill(uint8_t *buf, size_t len, uint32_t seed)
+{
+   size_t i;
+   for (i = 0; i < len; i++)
+   {
+      seed   = seed * 1103515245u + 12345u;
+      buf[i] = (uint8_t)(seed >> 24);
+   }
+}
+
+static bool write_file(const char *path, const uint8_t *buf, size_t len)
+{
+   return filestream_write_file(path, buf, (int64_t)len);
+}
+
+static bool file_equals(const char *path, const uint8_t *buf, size_t len)
+{
+   void *data  = NULL;
+   int64_t got = 0;
+   bool ret    = filestream_read_file(path, &data, &got)
+         && got == (int64_t)len
+         && !memcmp(data, buf, len);
+   free(data);
+   return ret;
+}
+
+/* Marks @block changed in both @dirty and @buf */
+static void change(uint8_t *buf, uint8_t *dirty, unsigned block)
+{
+   size_t at = (size_t)block * BLOCK;
+   buf[at + (block * 37) % (block == NUM_BLOCKS - 1 ? 100 : BLOCK)] ^= 0x5A;
+   dirty[block] = 1;
+}
+
+static void lane_patch(void)
+{
+   static uint8_t old_buf[SRAM_SIZE], new_buf[SRAM_SIZE];
+   uint8_t dirty[NUM_BLOCKS] = {0};
+   unsigned had = failures;
+
+   fill(old_buf, SRAM_SIZE, 1);
+   memcpy(new_buf, old_buf, SRAM_SIZE);
+   write_file(SAVE_PATH, old_buf, SRAM_SIZE);
+
+   CHECK(!autosave_journal_write(SAVE_PATH, new_buf, SRAM_SIZE, dirty,
+            BLOCK), "journal written with no block changed");
+   CHECK(!path_is_valid(JOURNAL_PATH), "empty journal left on disk");
+   CHECK(!autosave_journal_replay(SAVE_PATH), "replayed a missing journal");
+
+   change(new_buf, dirty, 0);
+   change(new_buf, dirty, 3);
+   change(new_buf, dirty, 4);
+   change(new_buf, dirty, 5);
+   change(new_buf, dirty, 8);
+   change(new_buf, dirty, 10);
+
+   CHECK(autosave_journal_write(SAVE_PATH, new_buf, SRAM_SIZE, dirty,
+            BLOCK), "journal not written");
+   CHECK(file_equals(SAVE_PATH, old_buf, SRAM_SIZE),
+         "writing the journal touched the file");
+   CHECK(autosave_journal_replay(SAVE_PATH), "journal not replayed");
+   CHECK(file_equals(SAVE_PATH, new_buf, SRAM_SIZE),
+         "file does not hold the new buffer");
+   CHECK(!path_is_valid(JOURNAL_PATH), "journal left after replay");
+
+   remove(SAVE_PATH);
+   if (failures == had)
+      fprintf(stderr, "[pass] patch lane\n");
+}
+
+static void lane_interrupted(void)
+{
+   static uint8_t old_buf[SRAM_SIZE], new_buf[SRAM_SIZE];
+   uint8_t dirty[NUM_BLOCKS] = {0};
+   unsigned had = failures;
+   RFILE *file;
+
+   fill(old_buf, SRAM_SIZE, 2);
+   memcpy(new_buf, old_buf, SRAM_SIZE);
+   change(new_buf, dirty, 1);
+   change(new_buf, dirty, 2);
+   change(new_buf, dirty, 9);
+   write_file(SAVE_PATH, old_buf, SRAM_SIZE);
+   autosave_journal_write(SAVE_PATH, new_buf, SRAM_SIZE, dirty, BLOCK);
+
+   /* The crash: block 1 written, half of block 2, block 9 not at all */
+   if ((file = filestream_open(SAVE_PATH,
+         RETRO_VFS_FILE_ACCESS_READ_WRITE
+       | RETRO_VFS_FILE_ACCESS_UPDATE_EXISTING,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+   {
+      filestream_seek(file, BLOCK, RETRO_VFS_SEEK_POSITION_START);
+      filestream_write(file, new_buf + BLOCK, BLOCK + BLOCK / 2);
+      filestream_close(file);
+   }
+
+   /* The next load, as the runloop does it */
+   memset(sram, 0, sizeof(sram));
+   path_init_savefile_new();
+   path_init_savefile_rtc(SAVE_PATH);
+   CHECK(event_load_save_files(false), "load reported failure");
+   path_deinit_savefile();
+
+   CHECK(!memcmp(sram, new_buf, SRAM_SIZE),
+         "core was handed the part-written file");
+   CHECK(file_equals(SAVE_PATH, new_buf, SRAM_SIZE),
+         "file not finished by the replay");
+   CHECK(!path_is_valid(JOURNAL_PATH), "journal left after load");
+
+   remove(SAVE_PATH);
+   if (failures == had)
+      fprintf(stderr, "[pass] interrupted lane\n");
+}
+
+static void lane_torn(void)
+{
+   static uint8_t old_buf[SRAM_SIZE], new_buf[SRAM_SIZE];
+   uint8_t dirty[NUM_BLOCKS] = {0};
+   unsigned had = failures;
+   void *journal = NULL;
+   int64_t len   = 0;
+   int64_t cut;
+
+   fill(old_buf, SRAM_SIZE, 3);
+   memcpy(new_buf, old_buf, SRAM_SIZE);
+   change(new_buf, dirty, 6);
+   change(new_buf, dirty, 7);
+   write_file(SAVE_PATH, old_buf, SRAM_SIZE);
+   autosave_journal_write(SAVE_PATH, new_buf, SRAM_SIZE, dirty, BLOCK);
+   filestream_read_file(JOURNAL_PATH, &journal, &len);
+   CHECK(len > 0, "no journal to tear");
+
+   /* Cut short anywhere - in the header, a record, the trailer - it
+    * must go unapplied. */
+   for (cut = 1; len > 0 && cut < len; cut += (cut < 64) ? 1 : 997)
+   {
+      write_file(JOURNAL_PATH, (const uint8_t*)journal, (size_t)(len - cut));
+      CHECK(!autosave_journal_replay(SAVE_PATH),
+            "journal short by %d bytes replayed", (int)cut);
+      CHECK(!path_is_valid(JOURNAL_PATH),
+            "journal short by %d bytes kept", (int)cut);
+   }
+
+   /* A flipped byte is as bad as a missing one */
+   if (len > 0)
+   {
+      ((uint8_t*)journal)[len / 2] ^= 1;
+      write_file(JOURNAL_PATH, (const uint8_t*)journal, (size_t)len);
+      CHECK(!autosave_journal_replay(SAVE_PATH), "corrupt journal replayed");
+      CHECK(!path_is_valid(JOURNAL_PATH), "corrupt journal kept");
+   }
+
+   CHECK(file_equals(SAVE_PATH, old_buf, SRAM_SIZE),
+         "a bad journal changed the file");
+
+   free(journal);
+   remove(SAVE_PATH);
+   if (failures == had)
+      fprintf(stderr, "[pass] torn lane\n");
+}
+
+static void lane_foreign(void)
+{
+   static uint8_t old_buf[SRAM_SIZE], new_buf[SRAM_SIZE];
+   uint8_t dirty[NUM_BLOCKS] = {0};
+   unsigned had = failures;
+
+   fill(old_buf, SRAM_SIZE, 4);
+   memcpy(new_buf, old_buf, SRAM_SIZE);
+   change(new_buf, dirty, 0);
+   autosave_journal_write(SAVE_PATH, new_buf, SRAM_SIZE, dirty, BLOCK);
+
+   /* Something else wrote the save since, at another size */
+   write_file(SAVE_PATH, old_buf, SRAM_SIZE - 1);
+   CHECK(!autosave_journal_replay(SAVE_PATH), "foreign journal replayed");
+   CHECK(!path_is_valid(JOURNAL_PATH), "foreign journal kept");
+   CHECK(file_equals(SAVE_PATH, old_buf, SRAM_SIZE - 1),
+         "foreign journal changed the file");
+
+   /* ...or deleted it */
+   autosave_journal_write(SAVE_PATH, new_buf, SRAM_SIZE, dirty, BLOCK);
+   remove(SAVE_PATH);
+   CHECK(!autosave_journal_replay(SAVE_PATH), "orphan journal replayed");
+   CHECK(!path_is_valid(JOURNAL_PATH), "orphan journal kept");
+   CHECK(!path_is_valid(SAVE_PATH), "orphan journal made a file");
+
+   if (failures == had)
+      fprintf(stderr, "[pass] foreign lane\n");
+}
+
+/* The autosave thread writes on its own schedule; give it a few of
+ * its one-second intervals to get the file to @want. */
+static bool wait_for_file(const uint8_t *want)
+{
+   int tries;
+   for (tries = 0; tries < 50; tries++)
+   {
+      if (file_equals(SAVE_PATH, want, SRAM_SIZE))
+         return true;
+      retro_sleep(100);
+   }
+   return false;
+}
+
+/* Stands in for a frame of the core, under the lock the runloop
+ * holds around retro_run() */
+static void core_write(size_t at, uint8_t val)
+{
+   autosave_lock();
+   sram[at] = val;
+   autosave_unlock();
+}
+
+static void lane_autosave(void)
+{
+   static uint8_t want[SRAM_SIZE];
+   unsigned had = failures;
+   RFILE *file;
+   unsigned i;
+
+   remove(SAVE_PATH);
+   fill(sram, SRAM_SIZE, 5);
+   path_init_savefile_new();
+   path_init_savefile_rtc(SAVE_PATH);
+   CHECK(autosave_init(false, false, 0, 1), "autosave did not start");
+
+   /* Nothing on disk yet: the first write is whole */
+   core_write(100, 0xAA);
+   memcpy(want, sram, SRAM_SIZE);
+   CHECK(wait_for_file(want), "first change not written");
+
+   /* A byte the thread does not know about, in a block it has no
+    * reason to write */
+   if ((file = filestream_open(SAVE_PATH,
+         RETRO_VFS_FILE_ACCESS_READ_WRITE
+       | RETRO_VFS_FILE_ACCESS_UPDATE_EXISTING,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+   {
+      uint8_t poke = (uint8_t)~want[9 * BLOCK];
+      filestream_seek(file, 9 * BLOCK, RETRO_VFS_SEEK_POSITION_START);
+      filestream_write(file, &poke, 1);
+      filestream_close(file);
+      want[9 * BLOCK] = poke;
+   }
+
+   core_write(2 * BLOCK + 5, 0x11);
+   core_write(SRAM_SIZE - 1, 0x22);
+   want[2 * BLOCK + 5] = 0x11;
+   want[SRAM_SIZE - 1] = 0x22;
+   CHECK(wait_for_file(want), "patch did not write just the changed blocks");
+   CHECK(!path_is_valid(JOURNAL_PATH), "journal left after patch");
+
+   /* Most of the file changed: whole, which drops the poked byte */
+   for (i = 0; i < NUM_BLOCKS; i += 2)
+      core_write((size_t)i * BLOCK + 1, (uint8_t)(0x30 + i));
+   core_write(BLOCK + 1, 0x40);
+   memcpy(want, sram, SRAM_SIZE);
+   CHECK(wait_for_file(want), "large change not written whole");
+
+   autosave_deinit();
+   path_deinit_savefile();
+
+   remove(SAVE_PATH);
+   if (failures == had)
+      fprintf(stderr, "[pass] autosave lane\n");
+}
+
+int main(void)
+{
+   lane_patch();
+   lane_interrupted();
+   lane_torn();
+   lane_foreign();
+   lane_autosave();
+
+   remove(SAVE_PATH);
+   remove(JOURNAL_PATH);
+
+   if (failures)
+   {
+      fprintf(stderr, "FAIL sram_journal_test: %u failures\n", failures);
+      return 1;
+   }
+   fprintf(stderr, "PASS sram_journal_test\n");
+   return 0;
+}
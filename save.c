@@ -19,7 +19,9 @@
 #include <string.h>
 #include <time.h>
 
+#include <encodings/crc32.h>
 #include <lists/string_list.h>
+#include <memdiff.h>
 #include <streams/interface_stream.h>
 #include <streams/file_stream.h>
 #include <streams/rzip_stream.h>
@@ -32,6 +34,7 @@
 #include "config.h"
 #endif
 
+#include "autosave.h"
 #include "content.h"
 #include "core.h"
 #include "core_info.h"
@@ -51,6 +54,229 @@ struct ram_type
 
 static struct string_list *task_save_files = NULL;
 
+/* ------------------------------------------------------------------ */
+/* Journal                                                             */
+/*                                                                     */
+/* Autosave does not rewrite a whole uncompressed save file for a      */
+/* change to a few bytes of it.  It tracks SRAM in blocks of           */
+/* AUTOSAVE_BLOCK_SIZE and writes only the blocks that changed over    */
+/* the file in place - by way of a journal beside it, so that a crash  */
+/* part way through cannot leave the file half old and half new.       */
+/* The changed blocks go to the journal first; only once that is       */
+/* closed are they written over the save file, and the journal is      */
+/* deleted after.  A journal still there at the next load is replayed  */
+/* over the file before it is read.                                    */
+/*                                                                     */
+/* It is stamped with the size of the file it applies to, and ends in  */
+/* a CRC of all before it: a journal cut short is discarded whole, and */
+/* the file it was for was not touched yet.  Native byte order:        */
+/*                                                                     */
+/*   header  : "RASJ", u32 version, u32 byte-order-mark, i64 size,     */
+/*             u32 record count                                        */
+/*   record  : i64 offset, u32 length, bytes                           */
+/*   trailer : u32 crc32 of header and records                         */
+/* ------------------------------------------------------------------ */
+
+#define AUTOSAVE_BLOCK_SIZE        4096
+#define AUTOSAVE_JOURNAL_EXT       "journal"
+#define AUTOSAVE_JOURNAL_MAGIC     "RASJ"
+#define AUTOSAVE_JOURNAL_VERSION   1
+#define AUTOSAVE_JOURNAL_BOM       0x01020304
+#define AUTOSAVE_JOURNAL_HEADER    24
+#define AUTOSAVE_JOURNAL_RECORD    12
+
+enum autosave_journal_result
+{
+   AUTOSAVE_JOURNAL_INVALID = -1,
+   AUTOSAVE_JOURNAL_IO_ERROR,
+   AUTOSAVE_JOURNAL_APPLIED
+};
+
+static void autosave_journal_path(const char *path, char *s, size_t len)
+{
+   fill_pathname_join_delim(s, path, AUTOSAVE_JOURNAL_EXT, '.', len);
+}
+
+/* Finds the next run of adjacent dirty blocks from *block on, as a byte
+ * range of the @len byte buffer, and moves *block past it.  False when
+ * there is none. */
+static bool autosave_journal_next_run(const uint8_t *dirty,
+      size_t len, size_t block_size, size_t *block,
+      size_t *offset, size_t *run_len)
+{
+   size_t num_blocks = (len + block_size - 1) / block_size;
+   size_t i          = *block;
+   size_t end;
+
+   while (i < num_blocks && !dirty[i])
+      i++;
+   if (i >= num_blocks)
+      return false;
+
+   *offset = i * block_size;
+   while (i < num_blocks && dirty[i])
+      i++;
+   end      = i * block_size;
+   if (end > len)
+      end   = len;
+   *run_len = end - *offset;
+   *block   = i;
+   return true;
+}
+
+bool autosave_journal_write(const char *path,
+      const void *data, size_t len,
+      const uint8_t *dirty, size_t block_size)
+{
+   const uint8_t *src = (const uint8_t*)data;
+   uint8_t *journal   = NULL;
+   size_t total       = AUTOSAVE_JOURNAL_HEADER + sizeof(uint32_t);
+   uint32_t records   = 0;
+   uint32_t version   = AUTOSAVE_JOURNAL_VERSION;
+   uint32_t bom       = AUTOSAVE_JOURNAL_BOM;
+   int64_t size       = (int64_t)len;
+   size_t block       = 0;
+   size_t offset, run_len, pos;
+   uint32_t crc;
+   bool ret;
+   char journal_path[PATH_MAX_LENGTH];
+
+   while (autosave_journal_next_run(dirty, len, block_size,
+            &block, &offset, &run_len))
+   {
+      total += AUTOSAVE_JOURNAL_RECORD + run_len;
+      records++;
+   }
+   if (!records || !(journal = (uint8_t*)malloc(total)))
+      return false;
+
+   memcpy(journal,      AUTOSAVE_JOURNAL_MAGIC, 4);
+   memcpy(journal + 4,  &version,               4);
+   memcpy(journal + 8,  &bom,                   4);
+   memcpy(journal + 12, &size,                  8);
+   memcpy(journal + 20, &records,               4);
+   pos   = AUTOSAVE_JOURNAL_HEADER;
+   block = 0;
+   while (autosave_journal_next_run(dirty, len, block_size,
+            &block, &offset, &run_len))
+   {
+      int64_t  at = (int64_t)offset;
+      uint32_t n  = (uint32_t)run_len;
+      memcpy(journal + pos,     &at, 8);
+      memcpy(journal + pos + 8, &n,  4);
+      memcpy(journal + pos + AUTOSAVE_JOURNAL_RECORD, src + offset, run_len);
+      pos += AUTOSAVE_JOURNAL_RECORD + run_len;
+   }
+   crc = encoding_crc32(0, journal, pos);
+   memcpy(journal + pos, &crc, 4);
+
+   autosave_journal_path(path, journal_path, sizeof(journal_path));
+   ret = filestream_write_file(journal_path, journal, (int64_t)total);
+   free(journal);
+   return ret;
+}
+
+/* Checks the whole of a journal before any of it is written: a torn
+ * or foreign one is INVALID, with the save file untouched. */
+static enum autosave_journal_result autosave_journal_apply(
+      const char *path, const uint8_t *journal, size_t len)
+{
+   RFILE *file;
+   uint32_t version, bom, records, crc, i;
+   int64_t size;
+   size_t pos;
+   enum autosave_journal_result ret = AUTOSAVE_JOURNAL_APPLIED;
+
+   if (     len < AUTOSAVE_JOURNAL_HEADER + sizeof(crc)
+         || memcmp(journal, AUTOSAVE_JOURNAL_MAGIC, 4))
+      return AUTOSAVE_JOURNAL_INVALID;
+   len -= sizeof(crc);
+   memcpy(&version, journal + 4,   4);
+   memcpy(&bom,     journal + 8,   4);
+   memcpy(&size,    journal + 12,  8);
+   memcpy(&records, journal + 20,  4);
+   memcpy(&crc,     journal + len, 4);
+   if (     version != AUTOSAVE_JOURNAL_VERSION
+         || bom     != AUTOSAVE_JOURNAL_BOM
+         || crc     != encoding_crc32(0, journal, len)
+         || size    <  0)
+      return AUTOSAVE_JOURNAL_INVALID;
+
+   for (pos = AUTOSAVE_JOURNAL_HEADER, i = 0; i < records; i++)
+   {
+      int64_t  at;
+      uint32_t n;
+      if (len - pos < AUTOSAVE_JOURNAL_RECORD)
+         return AUTOSAVE_JOURNAL_INVALID;
+      memcpy(&at, journal + pos,     8);
+      memcpy(&n,  journal + pos + 8, 4);
+      pos += AUTOSAVE_JOURNAL_RECORD;
+      if (     n  >  len - pos
+            || at <  0
+            || at >  size
+            || n  >  size - at)
+         return AUTOSAVE_JOURNAL_INVALID;
+      pos += n;
+   }
+   if (pos != len)
+      return AUTOSAVE_JOURNAL_INVALID;
+
+   /* Anything else writing the file since leaves the journal
+    * describing a file that is no longer there. */
+   if (path_get_size(path) != size)
+      return AUTOSAVE_JOURNAL_INVALID;
+
+   if (!(file = filestream_open(path,
+         RETRO_VFS_FILE_ACCESS_READ_WRITE
+       | RETRO_VFS_FILE_ACCESS_UPDATE_EXISTING,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+      return AUTOSAVE_JOURNAL_IO_ERROR;
+
+   for (pos = AUTOSAVE_JOURNAL_HEADER, i = 0; i < records; i++)
+   {
+      int64_t  at;
+      uint32_t n;
+      memcpy(&at, journal + pos,     8);
+      memcpy(&n,  journal + pos + 8, 4);
+      pos += AUTOSAVE_JOURNAL_RECORD;
+      if (     filestream_seek(file, at, RETRO_VFS_SEEK_POSITION_START) != 0
+            || filestream_write(file, journal + pos, n) != (int64_t)n)
+      {
+         ret = AUTOSAVE_JOURNAL_IO_ERROR;
+         break;
+      }
+      pos += n;
+   }
+
+   if (filestream_close(file) != 0)
+      ret = AUTOSAVE_JOURNAL_IO_ERROR;
+   return ret;
+}
+
+bool autosave_journal_replay(const char *path)
+{
+   void *buf   = NULL;
+   int64_t len = 0;
+   enum autosave_journal_result ret = AUTOSAVE_JOURNAL_INVALID;
+   char journal_path[PATH_MAX_LENGTH];
+
+   autosave_journal_path(path, journal_path, sizeof(journal_path));
+   if (!path_is_valid(journal_path))
+      return false;
+
+   if (filestream_read_file(journal_path, &buf, &len))
+   {
+      ret = autosave_journal_apply(path, (const uint8_t*)buf, (size_t)len);
+      free(buf);
+   }
+
+   /* On an I/O error it is kept, as the only copy of what it holds;
+    * applied or invalid, it has nothing more to give. */
+   if (ret != AUTOSAVE_JOURNAL_IO_ERROR)
+      filestream_delete(journal_path);
+   return ret == AUTOSAVE_JOURNAL_APPLIED;
+}
+
 #ifdef HAVE_THREADS
 typedef struct autosave autosave_t;
 
@@ -72,12 +298,20 @@ struct autosave
    void *buffer;
    const void *retro_buffer;
    char *path;
+   /* One per AUTOSAVE_BLOCK_SIZE block of 'buffer': changed since the
+    * file last held it.  Only the autosave thread touches it. */
+   uint8_t *dirty;
    slock_t *lock;
    slock_t *cond_lock;
    scond_t *cond;
    sthread_t *thread;
    size_t bufsize;
+   size_t num_blocks;
    unsigned interval;
+   /* enum rzip_codec and level when compressing; set by
+    * autosave_new() and never changed, so read unlocked */
+   unsigned codec;
+   int level;
    /* Guarded by 'lock'.  AUTOSAVE_FLAG_QUIT is deliberately NOT kept
     * here: it is guarded by cond_lock, and two locks protecting
     * different bits of one byte do not protect the byte -- the
@@ -100,19 +334,28 @@ static struct autosave_st autosave_state;
  *  - The dirty flag allows an early-out when the core
  *    has not touched SRAM since last check, avoiding a
  *    full memcmp on every wake-up.
- *  - When a comparison is needed we scan word-at-a-time
- *    to locate the first differing region, then only
- *    memcmp/memcpy from that point onward.
+ *  - When a comparison is needed, a vector scan skips
+ *    from one changed byte to the next; only the blocks
+ *    those fall in are copied and marked.
+ *  - An uncompressed file the last write left whole gets
+ *    just the changed blocks, through the journal; the
+ *    rest, and a change to most of the file, are written
+ *    whole.
  *  - The file write happens entirely outside the lock,
  *    so the core is never stalled on disk I/O.
  **/
 static void autosave_thread(void *data)
 {
-   autosave_t *save = (autosave_t*)data;
+   autosave_t *save    = (autosave_t*)data;
+   /* Changed blocks not yet on disk, counted over 'dirty' */
+   size_t dirty_blocks = 0;
+   /* The file holds 'buffer' but for the dirty blocks, so that
+    * writing those over it makes it whole.  Not known of whatever
+    * was there before this thread's first write. */
+   bool synced         = false;
 
    for (;;)
    {
-      bool differ   = false;
       bool compress = false;
 
       slock_lock(save->lock);
@@ -123,47 +366,29 @@ static void autosave_thread(void *data)
        * was never set (conservative default). */
       if (save->flags & AUTOSAVE_FLAG_DIRTY)
       {
-         const size_t word_size = sizeof(size_t);
-         const size_t aligned   = save->bufsize / word_size;
-         const size_t remainder = save->bufsize % word_size;
-         const size_t *src_w    = (const size_t*)save->retro_buffer;
-         const size_t *dst_w    = (const size_t*)save->buffer;
-         size_t offset          = 0;
-         size_t i;
-
-         /* Word-at-a-time scan to find first difference.
-          * Avoids touching the entire buffer when only
-          * a small region changed (common for SRAM). */
-         for (i = 0; i < aligned; i++)
-         {
-            if (src_w[i] != dst_w[i])
-            {
-               differ = true;
-               offset = i * word_size;
-               break;
-            }
-         }
+         const uint8_t *src = (const uint8_t*)save->retro_buffer;
+         uint8_t *dst       = (uint8_t*)save->buffer;
+         size_t offset      = 0;
 
-         /* Check trailing bytes if no word-level diff found */
-         if (!differ && remainder > 0)
+         while ((offset += memdiff_first(dst + offset, src + offset,
+                     save->bufsize - offset)) < save->bufsize)
          {
-            const unsigned char *src_b =
-               (const unsigned char*)save->retro_buffer + aligned * word_size;
-            const unsigned char *dst_b =
-               (const unsigned char*)save->buffer + aligned * word_size;
-            if (memcmp(dst_b, src_b, remainder) != 0)
+            size_t i    = offset / AUTOSAVE_BLOCK_SIZE;
+            size_t _len;
+
+            offset      = i * AUTOSAVE_BLOCK_SIZE;
+            _len        = save->bufsize - offset;
+            if (_len > AUTOSAVE_BLOCK_SIZE)
+               _len     = AUTOSAVE_BLOCK_SIZE;
+            memcpy(dst + offset, src + offset, _len);
+            offset     += _len;
+            if (!save->dirty[i])
             {
-               differ = true;
-               offset = aligned * word_size;
+               save->dirty[i] = 1;
+               dirty_blocks++;
             }
          }
 
-         /* Only copy from first difference onward */
-         if (differ)
-            memcpy((unsigned char*)save->buffer + offset,
-                   (const unsigned char*)save->retro_buffer + offset,
-                   save->bufsize - offset);
-
          /* Clear dirty flag regardless — we've checked */
          save->flags &= ~AUTOSAVE_FLAG_DIRTY;
       }
@@ -176,23 +401,57 @@ static void autosave_thread(void *data)
 
       slock_unlock(save->lock);
 
-      if (differ)
+      if (dirty_blocks)
       {
-         intfstream_t *file = NULL;
-
-         if (compress)
-            file = intfstream_open_rzip_file(save->path,
-                  RETRO_VFS_FILE_ACCESS_WRITE);
-         else
-            file = intfstream_open_file(save->path,
-                  RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+         bool written = false;
+
+         /* The journal has every changed byte written twice, so a
+          * change to more than half the file is cheaper whole. */
+         if (     synced
+               && !compress
+               && dirty_blocks * 2 <= save->num_blocks)
+            written = autosave_journal_write(save->path,
+                  save->buffer, save->bufsize,
+                  save->dirty, AUTOSAVE_BLOCK_SIZE)
+               && autosave_journal_replay(save->path);
+
+         if (!written)
+         {
+            intfstream_t *file = NULL;
+            char journal_path[PATH_MAX_LENGTH];
+
+            /* Nor must a journal a failed patch left be replayed over
+             * the file written in its place. */
+            autosave_journal_path(save->path, journal_path,
+                  sizeof(journal_path));
+            if (path_is_valid(journal_path))
+               filestream_delete(journal_path);
+
+            if (compress)
+               file = intfstream_open_rzip_file_codec(save->path,
+                     RETRO_VFS_FILE_ACCESS_WRITE, save->codec, save->level);
+            else
+               file = intfstream_open_file(save->path,
+                     RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+            if (file)
+            {
+               written = intfstream_write(file, save->buffer, save->bufsize)
+                     == (int64_t)save->bufsize;
+               intfstream_flush(file);
+               if (intfstream_close(file) != 0)
+                  written = false;
+               free(file);
+            }
+         }
 
-         if (file)
+         /* On failure the blocks stay dirty, and are tried again on
+          * the next wake-up whether or not anything else changes. */
+         synced = written;
+         if (written)
          {
-            intfstream_write(file, save->buffer, save->bufsize);
-            intfstream_flush(file);
-            intfstream_close(file);
-            free(file);
+            memset(save->dirty, 0, save->num_blocks);
+            dirty_blocks = 0;
          }
       }
 
@@ -223,6 +482,9 @@ static void autosave_thread(void *data)
  * @data            : pointer to buffer
  * @len             : size of @data buffer
  * @interval        : interval at which saves should be performed.
+ * @compress        : whether to use rzip compression
+ * @compress_zstd   : compress with zstd rather than deflate
+ * @compress_level  : zstd level
  *
  * Create and initialize autosave object.
  *
@@ -231,7 +493,8 @@ static void autosave_thread(void *data)
  **/
 static autosave_t *autosave_new(const char *path,
       const void *data, size_t len,
-      unsigned interval, bool compress)
+      unsigned interval, bool compress, bool compress_zstd,
+      unsigned compress_level)
 {
    void       *buf               = NULL;
    autosave_t *handle            = (autosave_t*)malloc(sizeof(*handle));
@@ -241,6 +504,8 @@ static autosave_t *autosave_new(const char *path,
    handle->flags                 = AUTOSAVE_FLAG_DIRTY;
    handle->quit                  = 0;
    handle->bufsize               = len;
+   handle->num_blocks            = (len + AUTOSAVE_BLOCK_SIZE - 1)
+         / AUTOSAVE_BLOCK_SIZE;
    handle->interval              = interval;
    handle->buffer                = NULL;
    handle->lock                  = NULL;
@@ -250,6 +515,9 @@ static autosave_t *autosave_new(const char *path,
 
    if (compress)
       handle->flags             |= AUTOSAVE_FLAG_COMPRESS_FILES;
+   handle->codec                 = compress_zstd
+         ? RZIP_CODEC_ZSTD : RZIP_CODEC_DEFLATE;
+   handle->level                 = compress_zstd ? (int)compress_level : 0;
    handle->retro_buffer          = data;
    /* Own the path string rather than borrowing it. The caller's
     * path comes from task_save_files->elems[i].data, freed by
@@ -271,6 +539,14 @@ static autosave_t *autosave_new(const char *path,
       return NULL;
    }
 
+   if (!(handle->dirty = (uint8_t*)calloc(handle->num_blocks, 1)))
+   {
+      free(buf);
+      free(handle->path);
+      free(handle);
+      return NULL;
+   }
+
    handle->buffer                = buf;
 
    memcpy(handle->buffer, handle->retro_buffer, handle->bufsize);
@@ -289,6 +565,7 @@ static autosave_t *autosave_new(const char *path,
       if (handle->cond)
          scond_free(handle->cond);
       free(handle->path);
+      free(handle->dirty);
       free(handle->buffer);
       free(handle);
       return NULL;
@@ -303,6 +580,7 @@ static autosave_t *autosave_new(const char *path,
       slock_free(handle->cond_lock);
       scond_free(handle->cond);
       free(handle->path);
+      free(handle->dirty);
       free(handle->buffer);
       free(handle);
       return NULL;
@@ -337,10 +615,12 @@ static void autosave_free(autosave_t *handle)
       free(handle->path);
    handle->path = NULL;
 
+   free(handle->dirty);
    free(handle);
 }
 
-bool autosave_init(bool compress_files, unsigned autosave_interval)
+bool autosave_init(bool compress_files, bool compress_zstd,
+      unsigned compress_level, unsigned autosave_interval)
 {
    unsigned i;
    autosave_t **list          = NULL;
@@ -374,7 +654,9 @@ bool autosave_init(bool compress_files, unsigned autosave_interval)
             mem_info.data,
             mem_info.size,
             autosave_interval,
-            compress_files)))
+            compress_files,
+            compress_zstd,
+            compress_level)))
       {
          RARCH_WARN("[SRAM] %s\n", msg_hash_to_str(MSG_AUTOSAVE_FAILED));
          continue;
@@ -504,8 +786,16 @@ static bool content_load_ram_file(unsigned slot)
     * not exist. This is a common enough occurrence
     * that we should check before attempting to
     * invoke the relevant read_file() function */
-   if (    (!ram.path || !*ram.path)
-       || !path_is_valid(ram.path))
+   if (!ram.path || !*ram.path)
+      return false;
+
+   /* An autosave cut short part way through writing its changes
+    * leaves them in the journal, whole; finish it first. */
+   if (autosave_journal_replay(ram.path))
+      RARCH_LOG("[SRAM] Replayed interrupted autosave into \"%s\".\n",
+            ram.path);
+
+   if (!path_is_valid(ram.path))
       return false;
 
 #if defined(HAVE_COMPRESSION)
@@ -592,12 +882,15 @@ static bool dump_to_file_desperate(const void *data,
  * content_save_ram_file:
  * @slot             : index into task_save_files
  * @compress         : whether to use rzip compression
+ * @compress_zstd    : compress with zstd rather than deflate
+ * @compress_level   : zstd level
  *
  * Save a RAM state from memory to disk.
  * Skips the write if the on-disk content already
  * matches memory (common when autosave has been active).
  */
-static bool content_save_ram_file(unsigned slot, bool compress)
+static bool content_save_ram_file(unsigned slot, bool compress,
+      bool compress_zstd, unsigned compress_level)
 {
    struct ram_type ram;
    retro_ctx_memory_info_t mem_info;
@@ -649,8 +942,10 @@ static bool content_save_ram_file(unsigned slot, bool compress)
 #if defined(HAVE_COMPRESSION)
    if (compress)
    {
-      if (!rzipstream_write_file(
-            ram.path, mem_info.data, mem_info.size))
+      if (!rzipstream_write_file_codec(
+            ram.path, mem_info.data, mem_info.size,
+            compress_zstd ? RZIP_CODEC_ZSTD : RZIP_CODEC_DEFLATE,
+            compress_zstd ? (int)compress_level : 0))
          goto fail;
    }
    else
@@ -682,6 +977,7 @@ fail:
 }
 
 bool event_save_files(bool is_sram_used, bool compress_files,
+      bool compress_zstd, unsigned compress_level,
       const char *path_cheat_database)
 {
    unsigned i;
@@ -691,7 +987,8 @@ bool event_save_files(bool is_sram_used, bool compress_files,
    if (!task_save_files || !is_sram_used)
       return false;
    for (i = 0; i < task_save_files->size; i++)
-      content_save_ram_file(i, compress_files);
+      content_save_ram_file(i, compress_files,
+            compress_zstd, compress_level);
    return true;
 }
 
@@ -23,6 +23,19 @@ S_BOOL(netplay_nat_traversal, NETPLAY_NAT_TRAVERSAL,
 /* The configuration row lives under defined(HAVE_NETWORKING); other passes are
  * unaffected. */
 #if !defined(SETTINGS_DEF_CONFIG_PASS) || (defined(HAVE_NETWORKING))
+S_BOOL(netplay_udp_input, NETPLAY_UDP_INPUT,
+      "netplay_udp_input",
+      DEFAULT_NETPLAY_UDP_INPUT, SD_FLAG_ADVANCED, 0, 0,
+      "Netplay UDP Input",
+      "Also send input over UDP, several frames to a packet, so that a lost packet does not hold up the frames behind it. Takes effect when both the host and the client enable it; the host must also accept UDP on the port after its TCP port. Not available through a relay server.")
+#endif
+#endif
+/* Descriptor and configuration rows are #if defined(HAVE_NETWORKING); the string
+ * tables always carry this row via the strings pass. */
+#if defined(HAVE_NETWORKING) || defined(SETTINGS_DEF_STRINGS_PASS)
+/* The configuration row lives under defined(HAVE_NETWORKING); other passes are
+ * unaffected. */
+#if !defined(SETTINGS_DEF_CONFIG_PASS) || (defined(HAVE_NETWORKING))
 S_UINT_EX_NS(netplay_share_digital, NETPLAY_SHARE_DIGITAL,
       "netplay_share_digital",
       DEFAULT_NETPLAY_SHARE_DIGITAL, SD_FLAG_NONE, SDESC_RANGE_MINMAX, 0, 0, RARCH_NETPLAY_SHARE_DIGITAL_LAST-1, 1, 0, setting_action_ok_uint, setting_get_string_representation_netplay_share_digital, NULL, NULL, NULL, NULL, ST_UI_TYPE_UINT_COMBOBOX,
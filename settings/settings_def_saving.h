@@ -110,3 +110,21 @@ S_BOOL(savestate_file_compression, SAVESTATE_FILE_COMPRESSION,
       "Save State: Compression",
       "Write save state files in an archived format. Dramatically reduces file size at the expense of increased saving/loading times.")
 #endif
+/* Descriptor and configuration rows are #if defined(HAVE_COMPRESSION); the string
+ * tables always carry this row via the strings pass. */
+#if defined(HAVE_COMPRESSION) || defined(SETTINGS_DEF_STRINGS_PASS)
+S_BOOL_EX(save_compression_zstd, SAVE_COMPRESSION_ZSTD,
+      "save_compression_zstd",
+      DEFAULT_SAVE_COMPRESSION_ZSTD, SD_FLAG_ADVANCED, 0, 0, setting_bool_action_left_with_refresh, NULL, NULL, NULL, setting_bool_action_left_with_refresh, setting_bool_action_right_with_refresh, 0,
+      "Save File/State: Zstandard Compression",
+      "Compress SaveRAM and save state files with Zstandard rather than deflate. Much faster to save and load, for files of about the same size. Files written this way cannot be read by older versions of RetroArch.")
+#endif
+/* Descriptor and configuration rows are #if defined(HAVE_COMPRESSION); the string
+ * tables always carry this row via the strings pass. */
+#if defined(HAVE_COMPRESSION) || defined(SETTINGS_DEF_STRINGS_PASS)
+S_UINT_EX(save_compression_zstd_level, SAVE_COMPRESSION_ZSTD_LEVEL,
+      "save_compression_zstd_level",
+      DEFAULT_SAVE_COMPRESSION_ZSTD_LEVEL, SD_FLAG_ADVANCED, SDESC_RANGE_MINMAX, 0, 1, 9, 1, 0, setting_action_ok_uint, NULL, NULL, NULL, NULL, NULL, 0,
+      "Save File/State: Zstandard Level",
+      "Zstandard compression level for SaveRAM and save state files. Higher levels make smaller files, and take longer to save. Builds without a system Zstandard library compress at one level whatever this is set to.")
+#endif
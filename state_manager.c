@@ -26,6 +26,7 @@
 #include <retro_inline.h>
 #include <compat/strl.h>
 #include <compat/intrinsics.h>
+#include <memdiff.h>
 
 #include "state_manager.h"
 #include "msg_hash.h"
@@ -63,122 +64,20 @@
 
 #if __SSE2__
 #include <emmintrin.h>
-/* An AVX2 scanner doubles the bytes compared per iteration. It is selected at
- * runtime, and is only built where the compiler can emit an AVX2 function
- * without raising the baseline ISA for the whole file. */
-#if (defined(__GNUC__) || defined(__clang__)) && (defined(__i386__) || defined(__x86_64__))
-#include <immintrin.h>
-#include <features/features_cpu.h>
-#define STATE_MANAGER_HAVE_AVX2_SCAN 1
-#endif
 #endif
 
 /* Tail padding on each block, in bytes. Must be >= the widest vector load
- * find_change() can issue (32 for AVX2); 64 leaves room for a wider scanner
- * without having to revisit the allocation. */
+ * find_same() can issue past the sentinel (16 for SSE2); 64 leaves room
+ * for a wider scanner without having to revisit the allocation. */
 #define STATE_MANAGER_SCAN_PAD 64
 
-/* There's no equivalent in libc, you'd think so ...
- * std::mismatch exists, but it's not optimized at all. */
-#ifdef STATE_MANAGER_HAVE_AVX2_SCAN
-__attribute__((target("avx2")))
-static size_t find_change_avx2(const uint16_t *a, const uint16_t *b)
-{
-   const __m256i *a256 = (const __m256i*)a;
-   const __m256i *b256 = (const __m256i*)b;
-
-   for (;;)
-   {
-      __m256i v0    = _mm256_loadu_si256(a256);
-      __m256i v1    = _mm256_loadu_si256(b256);
-      __m256i c     = _mm256_cmpeq_epi8(v0, v1);
-      uint32_t mask = (uint32_t)_mm256_movemask_epi8(c);
-
-      if (mask != 0xffffffffu)
-      {
-         /* Offset is a multiple of 32 and the tzcnt is 0..31, so the OR is
-          * an add, exactly as in the SSE2 form. */
-         size_t ret = (((uint8_t*)a256 - (uint8_t*)a) |
-               (compat_ctz(~mask)));
-
-         return (ret >> 1);
-      }
-
-      a256++;
-      b256++;
-   }
-}
-
-static int state_manager_use_avx2(void)
+/* The first uint16_t that differs among the @num16s from @a and @b, or
+ * @num16s if none does. */
+static INLINE size_t find_change(const uint16_t *a, const uint16_t *b,
+      size_t num16s)
 {
-   static int cached = -1;
-   if (cached < 0)
-      cached = (cpu_features_get() & RETRO_SIMD_AVX2) ? 1 : 0;
-   return cached;
-}
-#endif
-
-static size_t find_change(const uint16_t *a, const uint16_t *b)
-{
-#if __SSE2__
-   const __m128i *a128 = (const __m128i*)a;
-   const __m128i *b128 = (const __m128i*)b;
-
-#ifdef STATE_MANAGER_HAVE_AVX2_SCAN
-   if (state_manager_use_avx2())
-      return find_change_avx2(a, b);
-#endif
-
-   for (;;)
-   {
-      __m128i v0    = _mm_loadu_si128(a128);
-      __m128i v1    = _mm_loadu_si128(b128);
-      __m128i c     = _mm_cmpeq_epi8(v0, v1);
-      uint32_t mask = _mm_movemask_epi8(c);
-
-      if (mask != 0xffff) /* Something has changed, figure out where. */
-      {
-         /* calculate the real offset to the differing byte */
-         size_t ret = (((uint8_t*)a128 - (uint8_t*)a) |
-               (compat_ctz(~mask)));
-
-         /* and convert that to the uint16_t offset */
-         return (ret >> 1);
-      }
-
-      a128++;
-      b128++;
-   }
-#else
-   const uint16_t *a_org = a;
-#ifdef NO_UNALIGNED_MEM
-   while (((uintptr_t)a & (sizeof(size_t) - 1)) && *a == *b)
-   {
-      a++;
-      b++;
-   }
-   if (*a == *b)
-#endif
-   {
-      const size_t *a_big = (const size_t*)a;
-      const size_t *b_big = (const size_t*)b;
-
-      while (*a_big == *b_big)
-      {
-         a_big++;
-         b_big++;
-      }
-      a = (const uint16_t*)a_big;
-      b = (const uint16_t*)b_big;
-
-      while (*a == *b)
-      {
-         a++;
-         b++;
-      }
-   }
-   return a - a_org;
-#endif
+   return memdiff_first(a, b, num16s * sizeof(uint16_t))
+      / sizeof(uint16_t);
 }
 
 static size_t find_same(const uint16_t *a, const uint16_t *b)
@@ -278,7 +177,7 @@ static size_t state_manager_raw_compress(const void *src,
    while (num16s)
    {
       size_t i, changed;
-      size_t skip = find_change(old16, new16);
+      size_t skip = find_change(old16, new16, num16s);
 
       if (skip >= num16s)
          break;
@@ -455,11 +354,11 @@ static state_manager_t *state_manager_new(
     * Each block needs: block_size rounded to uint16_t alignment, plus the
     * four sentinel uint16_t, plus STATE_MANAGER_SCAN_PAD.
     *
-    * find_change() deliberately scans past the end of the logical data --
+    * find_same() deliberately scans past the end of the logical data --
     * the caller bounds the result afterwards -- and terminates only on the
-    * sentinel at byte block_size + 6. The final vector load may therefore
-    * begin at that sentinel and read a full vector beyond it, so the tail
-    * padding must be at least the widest load find_change can issue.
+    * equal sentinel words after block_size. Its final vector load may
+    * therefore begin at the sentinel and read a full vector beyond it, so
+    * the tail padding must be at least the widest load find_same can issue.
     * Keep the two in step: widening the scanner means widening this. */
    single_block_alloc = block_size + sizeof(uint16_t) * 4
       + STATE_MANAGER_SCAN_PAD;
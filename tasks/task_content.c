@@ -2629,9 +2629,15 @@ struct content_deferred_menu_load
    char *core_path;              /* the world this belongs to      */
    enum rarch_core_type type;
    content_ctx_info_t info;      /* argv-free by the deferral gate */
+   struct string_list *discs;    /* disc set, need_fullpath only   */
+   size_t discs_head;            /* how much of it the load awaited */
    bool showed_animation;        /* launch card already on screen */
 };
 
+/* For a disc set, how much of the first track the load waits on:
+ * the boot reads, not the whole image. */
+#define CONTENT_DISC_WARM_HEAD_BYTES (32 * 1024 * 1024)
+
 /* The continuation parked by the prefetch's done callback, consumed
  * by task_content_deferred_load_check() from the runloop.  One
  * deferral at a time (the CONTENT_ST_FLAG_DEFERRED_LOAD_PENDING
@@ -2694,6 +2700,7 @@ void task_content_deferred_load_check(void)
       RARCH_LOG("[Content] Dropping a deferred load superseded by "
             "another: \"%s\".\n", d->fullpath);
       content_file_prefetch_free(p_content);
+      string_list_free(d->discs);
       free(d->core_path);
       free(d->fullpath);
       free(d);
@@ -2710,8 +2717,29 @@ void task_content_deferred_load_check(void)
       task_push_to_history_list(p_content, true, false, false);
       if (d->type != CORE_TYPE_DUMMY)
          menu_driver_ctl(RARCH_MENU_CTL_SET_PENDING_QUICK_MENU, NULL);
+      /* The rest of the disc set warms while the content runs - from
+       * the first track again, whose head is all the load waited
+       * for.  Only on the threaded queue: the regular one would read
+       * 4 MiB per frame on the thread running the core. */
+      if (     d->discs
+            && d->discs->size > d->discs_head
+            && task_queue_is_threaded())
+      {
+         size_t i;
+         size_t from       = d->discs_head ? d->discs_head - 1 : 0;
+         size_t count      = d->discs->size - from;
+         const char **rest = (const char**)malloc(count * sizeof(*rest));
+         if (rest)
+         {
+            for (i = 0; i < count; i++)
+               rest[i] = d->discs->elems[from + i].data;
+            task_push_content_warm(rest, count, 0, NULL, NULL, NULL);
+            free(rest);
+         }
+      }
    }
    content_file_prefetch_free(p_content);   /* leftovers, if any */
+   string_list_free(d->discs);
    free(d->core_path);
    free(d->fullpath);
    free(d);
@@ -2760,6 +2788,10 @@ static bool task_content_defer_menu_load(content_state_t *p_content,
       content_ctx_info_t *content_info)
 {
    struct content_deferred_menu_load *d = NULL;
+   struct string_list *discs            = NULL;
+   size_t discs_head                    = 0;
+   bool need_fullpath;
+   bool pushed;
    const char *paths[1];
 
    if (type != CORE_TYPE_PLAIN)
@@ -2780,12 +2812,10 @@ static bool task_content_defer_menu_load(content_state_t *p_content,
     * sys info; it cannot answer this.) */
    {
       const content_file_override_t *override = NULL;
-      bool need_fullpath = runloop_st->system.info.need_fullpath;
+      need_fullpath = runloop_st->system.info.need_fullpath;
       if (content_file_override_get_ext(p_content,
             path_get_extension(fullpath), &override))
          need_fullpath = override->need_fullpath;
-      if (need_fullpath)
-         return false;             /* the load hands the core a path */
    }
    /* The prefetch keys on this exact path, but the load rewrites
     * some paths before reading them: a content:// SAF URI becomes a
@@ -2800,11 +2830,34 @@ static bool task_content_defer_menu_load(content_state_t *p_content,
    if (       path_is_compressed_file(fullpath)
        && !path_contains_compressed_file(fullpath))
       return false;                /* bare archive: load picks entry */
+   /* A need_fullpath core still reads the files, itself, from disk.
+    * For a disc set - an .m3u, .cue or .gdi, each naming files of its
+    * own - those are warmed into the page cache instead: every
+    * descriptor and the head of the first track before the load,
+    * the rest once the content runs.  Anything else is handed over
+    * by path, as before. */
+   if (need_fullpath)
+   {
+      if (!(discs = task_content_prefetch_disc_set(fullpath,
+            &discs_head)))
+         return false;             /* the load hands the core a path */
+      if (!discs_head)
+      {
+         string_list_free(discs);
+         return false;
+      }
+   }
 
    if (!(d = (struct content_deferred_menu_load*)calloc(1, sizeof(*d))))
+   {
+      string_list_free(discs);
       return false;
+   }
+   d->discs      = discs;
+   d->discs_head = discs_head;
    if (!(d->fullpath = strdup(fullpath)))
    {
+      string_list_free(d->discs);
       free(d);
       return false;
    }
@@ -2813,6 +2866,7 @@ static bool task_content_defer_menu_load(content_state_t *p_content,
     * can fire after the user has loaded something else. */
    if (!(d->core_path = strdup(path_get(RARCH_PATH_CORE))))
    {
+      string_list_free(d->discs);
       free(d->fullpath);
       free(d);
       return false;
@@ -2844,16 +2898,42 @@ static bool task_content_defer_menu_load(content_state_t *p_content,
    }
 #endif
 
-   if (!task_push_content_prefetch_progress(paths, 1,
-         content_file_prefetch_deposit,
-         task_content_deferred_menu_load_done,
+   if (d->discs)
+   {
+      const char **head = (const char**)malloc(
+            d->discs_head * sizeof(*head));
+      size_t i;
+      pushed = false;
+      if (head)
+      {
+         for (i = 0; i < d->discs_head; i++)
+            head[i] = d->discs->elems[i].data;
+         pushed = task_push_content_warm(head, d->discs_head,
+               CONTENT_DISC_WARM_HEAD_BYTES,
+               task_content_deferred_menu_load_done,
 #if defined(HAVE_GFX_WIDGETS)
-         d->showed_animation ? content_file_prefetch_progress : NULL,
+               d->showed_animation ? content_file_prefetch_progress : NULL,
 #else
-         NULL,
+               NULL,
 #endif
-         d))
+               d);
+         free(head);
+      }
+   }
+   else
+      pushed = task_push_content_prefetch_progress(paths, 1,
+            content_file_prefetch_deposit,
+            task_content_deferred_menu_load_done,
+#if defined(HAVE_GFX_WIDGETS)
+            d->showed_animation ? content_file_prefetch_progress : NULL,
+#else
+            NULL,
+#endif
+            d);
+
+   if (!pushed)
    {
+      string_list_free(d->discs);
       free(d->core_path);
       free(d->fullpath);
       free(d);
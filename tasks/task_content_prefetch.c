@@ -24,9 +24,15 @@
 #include <string.h>
 
 #include <boolean.h>
+#include <retro_miscellaneous.h>
 #include <streams/file_stream.h>
+#include <streams/interface_stream.h>
 #include <file/file_path.h>
+#include <lists/string_list.h>
+#include <string/stdstring.h>
 #include <formats/data_transfer.h>
+#include <formats/rm3u.h>
+#include <formats/rm3u_stream.h>
 #ifdef HAVE_COMPRESSION
 #include <file/archive_file.h>
 #endif
@@ -35,12 +41,24 @@
 
 #include "task_content_prefetch.h"
 #include "tasks_internal.h"
+#ifdef HAVE_LIBRETRODB
+#include "task_database_cue.h"
+#endif
 
 /* Bytes pumped per task tick, per file.  Sized so a frame's tick
  * costs a few milliseconds of read+inflate, keeping the frontend
  * responsive while a large ROM streams in over a second or two. */
 #define CONTENT_PREFETCH_TICK_BYTES (4 * 1024 * 1024)
 
+/* A warm read's bytes are thrown away; they pass through this much
+ * scratch at a time rather than piling up in a whole-file buffer. */
+#define CONTENT_PREFETCH_WARM_CHUNK (256 * 1024)
+
+/* Bounds on what a disc descriptor may expand to: a CD holds at most
+ * 99 tracks, and no multi-disc set comes near the disc bound. */
+#define CONTENT_PREFETCH_MAX_TRACKS 99
+#define CONTENT_PREFETCH_MAX_DISCS  32
+
 struct content_prefetch_item
 {
    char *path;
@@ -66,6 +84,8 @@ struct content_prefetch_state
    content_prefetch_done_t done;
    content_prefetch_progress_t progress_cb;
    void *ud;
+   uint8_t *scratch;                   /* warm reads: discard target */
+   uint64_t limit;                     /* warm reads: per item, 0=all */
    size_t bytes_total;                 /* across items, once opened  */
    size_t bytes_done;
    int8_t progress;                    /* last value computed        */
@@ -208,6 +228,66 @@ static bool content_prefetch_item_open(struct content_prefetch_item *it)
    return true;
 }
 
+/* One tick of a warm read: pull up to a tick's bytes of the current
+ * item through the scratch buffer and drop them. */
+static void content_prefetch_warm_step(retro_task_t *task,
+      struct content_prefetch_state *st, struct content_prefetch_item *it)
+{
+   size_t budget = CONTENT_PREFETCH_TICK_BYTES;
+
+   if (!it->opened)
+   {
+      int64_t sz;
+      it->opened = 1;
+      /* The core opens the archive's extracted copy, never this. */
+      if (     path_contains_compressed_file(it->path)
+            || (sz = path_get_size(it->path)) <= 0
+            || !(it->file = filestream_open(it->path,
+                  RETRO_VFS_FILE_ACCESS_READ,
+                  RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+      {
+         st->all_ok   = 0;
+         it->finished = 1;
+         st->cursor++;
+         return;
+      }
+      it->total        = (st->limit && (uint64_t)sz > st->limit)
+            ? (size_t)st->limit : (size_t)sz;
+      st->bytes_total += it->total;
+   }
+
+   while (budget && it->done < it->total)
+   {
+      size_t  want = it->total - it->done;
+      int64_t got;
+      if (want > CONTENT_PREFETCH_WARM_CHUNK)
+         want = CONTENT_PREFETCH_WARM_CHUNK;
+      if (want > budget)
+         want = budget;
+      if ((got = filestream_read(it->file, st->scratch,
+            (int64_t)want)) <= 0)
+      {
+         /* Shrunk under us: what was read is warm, the rest is the
+          * core's problem, as it would have been anyway. */
+         st->all_ok      = 0;
+         st->bytes_total -= it->total - it->done;
+         it->total        = it->done;
+         break;
+      }
+      it->done       += (size_t)got;
+      st->bytes_done += (size_t)got;
+      budget         -= (size_t)got;
+   }
+   content_prefetch_update_progress(task, st);
+
+   if (it->done >= it->total)
+   {
+      it->finished = 1;
+      content_prefetch_item_close(it);
+      st->cursor++;
+   }
+}
+
 /* The handler runs wherever the task queue runs it - the worker
  * thread, under the threaded queue - so it only reads and stores.
  * Deposits and done are delivered by content_prefetch_task_callback,
@@ -234,6 +314,12 @@ static void content_prefetch_handler(retro_task_t *task)
 
    it = &st->items[st->cursor];
 
+   if (st->scratch)
+   {
+      content_prefetch_warm_step(task, st, it);
+      return;
+   }
+
    if (!it->opened)
    {
       if (content_prefetch_item_open(it))
@@ -306,7 +392,7 @@ static void content_prefetch_task_callback(retro_task_t *task,
    for (i = 0; i < st->count; i++)
    {
       struct content_prefetch_item *it = &st->items[i];
-      if (it->out)
+      if (it->out && st->deposit)
       {
          st->deposit(st->ud, it->path, it->out, it->out_len);
          it->out     = NULL;   /* ownership transferred */
@@ -331,6 +417,7 @@ static void content_prefetch_cleanup(retro_task_t *task)
       free(st->items[i].path);
    }
    free(st->items);
+   free(st->scratch);
    free(st);
 }
 
@@ -342,21 +429,24 @@ bool task_push_content_prefetch(const char **paths, size_t count,
          done, NULL, ud);
 }
 
-bool task_push_content_prefetch_progress(const char **paths,
-      size_t count, content_prefetch_deposit_t deposit,
-      content_prefetch_done_t done,
-      content_prefetch_progress_t progress, void *ud)
+/* A NULL @deposit makes the task a warm read. */
+static bool content_prefetch_push(const char **paths, size_t count,
+      content_prefetch_deposit_t deposit, content_prefetch_done_t done,
+      content_prefetch_progress_t progress, uint64_t limit, void *ud)
 {
    struct content_prefetch_state *st = NULL;
    retro_task_t *t                   = NULL;
    size_t i;
 
-   if (!paths || !count || !deposit)
+   if (!paths || !count)
       return false;
    if (!(t = task_init()))
       return false;
    if (!(st = (struct content_prefetch_state*)calloc(1, sizeof(*st))))
       goto error;
+   if (     !deposit
+         && !(st->scratch = (uint8_t*)malloc(CONTENT_PREFETCH_WARM_CHUNK)))
+      goto error;
    if (!(st->items = (struct content_prefetch_item*)
          calloc(count, sizeof(*st->items))))
       goto error;
@@ -371,6 +461,7 @@ bool task_push_content_prefetch_progress(const char **paths,
    st->progress    = -1;
    st->reported    = -1;
    st->deposit     = deposit;
+   st->limit       = limit;
    st->progress_cb = progress;
    st->done    = done;
    st->ud      = ud;
@@ -393,8 +484,133 @@ error:
       for (i = 0; i < st->count; i++)
          free(st->items[i].path);
       free(st->items);
+      free(st->scratch);
       free(st);
    }
    free(t);
    return false;
 }
+
+bool task_push_content_prefetch_progress(const char **paths,
+      size_t count, content_prefetch_deposit_t deposit,
+      content_prefetch_done_t done,
+      content_prefetch_progress_t progress, void *ud)
+{
+   if (!deposit)
+      return false;
+   return content_prefetch_push(paths, count, deposit, done, progress,
+         0, ud);
+}
+
+bool task_push_content_warm(const char **paths, size_t count,
+      uint64_t limit, content_prefetch_done_t done,
+      content_prefetch_progress_t progress, void *ud)
+{
+   return content_prefetch_push(paths, count, NULL, done, progress,
+         limit, ud);
+}
+
+static bool content_prefetch_is_ext(const char *path, const char *ext)
+{
+   return string_is_equal_noncase(path_get_extension(path), ext);
+}
+
+static void content_prefetch_disc_append(struct string_list *list,
+      const char *path)
+{
+   union string_list_elem_attr attr;
+   attr.i = 0;
+   /* A CUE names a shared .bin once per FILE, and nothing stops an
+    * M3U listing a disc twice; read each file once. */
+   if (!string_list_find_elem(list, path))
+      string_list_append(list, path, attr);
+}
+
+/* One disc: its descriptor, then the tracks it references in file
+ * order, which puts the boot track first. */
+static void content_prefetch_disc_tracks(struct string_list *list,
+      const char *disc)
+{
+   content_prefetch_disc_append(list, disc);
+#ifdef HAVE_LIBRETRODB
+   {
+      char track[PATH_MAX_LENGTH];
+      bool gdi         = content_prefetch_is_ext(disc, "gdi");
+      intfstream_t *fd = NULL;
+      unsigned n;
+
+      if (!gdi && !content_prefetch_is_ext(disc, "cue"))
+         return;
+      if (!(fd = intfstream_open_file(disc,
+            RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+         return;
+      track[0] = '\0';
+      for (n = 0; n < CONTENT_PREFETCH_MAX_TRACKS; n++)
+      {
+         if (gdi
+               ? !gdi_next_file(fd, disc, track, sizeof(track))
+               : !cue_next_file(fd, disc, track, sizeof(track)))
+            break;
+         content_prefetch_disc_append(list, track);
+      }
+      intfstream_close(fd);
+      free(fd);
+   }
+#endif
+}
+
+struct string_list *task_content_prefetch_disc_set(const char *path,
+      size_t *head)
+{
+   struct string_list *list = NULL;
+   size_t first_disc        = 0;
+
+   if (!path || !*path)
+      return NULL;
+   if (     !rm3u_is_m3u(path)
+         && !content_prefetch_is_ext(path, "cue")
+         && !content_prefetch_is_ext(path, "gdi"))
+      return NULL;
+   if (!(list = string_list_new()))
+      return NULL;
+
+   if (rm3u_is_m3u(path))
+   {
+      rm3u_t *m3u = rm3u_load_filestream(path);
+      size_t i, discs;
+
+      content_prefetch_disc_append(list, path);
+      first_disc = list->size;
+      discs      = m3u ? rm3u_get_size(m3u) : 0;
+      if (discs > CONTENT_PREFETCH_MAX_DISCS)
+         discs = CONTENT_PREFETCH_MAX_DISCS;
+      for (i = 0; i < discs; i++)
+      {
+         rm3u_entry_t *entry = NULL;
+         if (     rm3u_get_entry(m3u, i, &entry)
+               && entry->full_path && *entry->full_path
+               /* an M3U of M3Us is no disc set any core takes */
+               && !rm3u_is_m3u(entry->full_path))
+            content_prefetch_disc_tracks(list, entry->full_path);
+      }
+      rm3u_free(m3u);
+   }
+   else
+      content_prefetch_disc_tracks(list, path);
+
+   /* The first disc's descriptor and its first track - or the disc
+    * itself, when it is a single image rather than a descriptor. */
+   if (list->size > first_disc)
+   {
+      const char *disc = list->elems[first_disc].data;
+      *head = first_disc + 1;
+      if (     (  content_prefetch_is_ext(disc, "cue")
+               || content_prefetch_is_ext(disc, "gdi"))
+            && list->size > first_disc + 1)
+         *head = first_disc + 2;
+   }
+   else
+      *head = list->size;
+
+   return list;
+}
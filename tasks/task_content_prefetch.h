@@ -68,6 +68,36 @@ bool task_push_content_prefetch_progress(const char **paths,
       content_prefetch_done_t done,
       content_prefetch_progress_t progress, void *ud);
 
+/* Reads @paths start to finish and throws the bytes away: nothing is
+ * deposited, the point is the OS page cache.  For content a core
+ * opens itself (need_fullpath - discs, mostly), where there is no
+ * buffer to hand over but its first reads still go to disk.
+ *
+ * A nonzero @limit reads at most that many bytes of each path - the
+ * head of a track, enough for a core's boot-time reads, without
+ * holding the load up for the rest of a 700 MB image.  Archive
+ * entries are skipped: the core is handed an extracted copy, not
+ * the archive.  done and progress behave as for the prefetch. */
+bool task_push_content_warm(const char **paths, size_t count,
+      uint64_t limit, content_prefetch_done_t done,
+      content_prefetch_progress_t progress, void *ud);
+
+struct string_list;
+
+/* Expands a disc descriptor into everything a core will open for it,
+ * in the order it will open it: the .m3u, its first disc's
+ * descriptor, that disc's first track, the rest of that disc, then
+ * each further disc the same way.  The tracks of a .cue or .gdi are
+ * listed by name as the file references them; CUE and GDI parsing
+ * needs HAVE_LIBRETRODB, without which a disc contributes its
+ * descriptor alone.
+ *
+ * @head receives how many leading entries a load should wait for -
+ * every descriptor up to and including the first track.  Returns
+ * NULL for a path that is not an .m3u, .cue or .gdi. */
+struct string_list *task_content_prefetch_disc_set(const char *path,
+      size_t *head);
+
 RETRO_END_DECLS
 
 #endif
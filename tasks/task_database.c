@@ -30,6 +30,10 @@
 #include <encodings/crc32.h>
 #include <streams/interface_stream.h>
 #include <streams/file_stream.h>
+#include <features/features_cpu.h>
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 #include "tasks_internal.h"
 
 #include "../core_info.h"
@@ -48,6 +52,7 @@
 #include "../retroarch.h"
 #include "../verbosity.h"
 #include "task_database_cue.h"
+#include "task_database_scan_cache.h"
 
 /* Scan result structure for accumulating identification results */
 typedef struct scan_result
@@ -263,7 +268,12 @@ enum db_flags_enum
    DB_HANDLE_FLAG_SCAN_WITHOUT_CORE_MATCH = (1 << 2),
    DB_HANDLE_FLAG_SHOW_HIDDEN_FILES       = (1 << 3),
    DB_HANDLE_FLAG_USE_FIRST_MATCH_ONLY    = (1 << 4),
-   DB_HANDLE_FLAG_DO_MENU_REFRESH         = (1 << 5)
+   DB_HANDLE_FLAG_DO_MENU_REFRESH         = (1 << 5),
+   /* Checksum upcoming files on worker threads; cleared if the
+    * workers cannot be started.  See task_database_hash_ahead_pump(). */
+   DB_HANDLE_FLAG_HASH_AHEAD              = (1 << 6),
+   /* scan_cache_load() has been tried, whatever it returned. */
+   DB_HANDLE_FLAG_SCAN_CACHE_LOADED       = (1 << 7)
 };
 
 enum manual_scan_status
@@ -339,6 +349,14 @@ typedef struct manual_scan_handle
    char *content_database_path;
    database_info_handle_t *handle;
    database_state_handle_t state;
+#ifdef HAVE_THREADS
+   struct db_hash_ahead *hash_ahead;
+#endif
+   /* What earlier scans read out of each file, and the current
+    * file's stamp to check it against.  See task_database_scan_cache.h. */
+   scan_cache_t *scan_cache;
+   scan_cache_stamp_t scan_stamp;
+   bool scan_stamp_valid;
    uint8_t flags;
 #endif
    /* The caller's completion callback, run after the task's own.
@@ -864,16 +882,567 @@ static enum msg_file_type extension_to_file_type(const char *ext)
    return FILE_TYPE_NONE;
 }
 
+#ifdef HAVE_THREADS
+/* Hash-ahead for the crc lookup.
+ *
+ * The match stage below walks content_list one file at a time, and
+ * for most content the first thing it does is read the whole file to
+ * checksum it.  On a network share that read is latency, not CPU:
+ * the task thread sits idle waiting on the server for every file in
+ * turn.  So a few workers read and checksum the files the match stage
+ * is about to reach, and the match stage picks the results up in
+ * list order.  It matches exactly as before; all that changes is
+ * that the crc is usually already there when it asks.
+ *
+ * Only the cases that always checksum the whole file are queued:
+ * plain files, an archive itself (its own crc plus that of its first
+ * member, which the crc lookup asks for next) and an archive member.
+ * Serial lookups read a few sectors at most and stay inline.
+ *
+ * Reading and checksumming are one step per worker rather than two
+ * stages: crc32 runs far faster than any share delivers, so a
+ * separate hashing stage would only add a copy.  What overlaps is
+ * the I/O - up to DB_HASH_AHEAD_MAX_WORKERS reads in flight, and a
+ * window of DB_HASH_AHEAD_DEPTH queued ahead of the match stage. */
+#define DB_HASH_AHEAD_MAX_WORKERS 8
+#define DB_HASH_AHEAD_DEPTH       16
+
+enum db_hash_job_state
+{
+   DB_HASH_JOB_FREE = 0,
+   DB_HASH_JOB_QUEUED,
+   DB_HASH_JOB_BUSY,
+   DB_HASH_JOB_DONE
+};
+
+enum db_hash_job_kind
+{
+   DB_HASH_JOB_FILE = 0,
+   DB_HASH_JOB_ARCHIVE,
+   DB_HASH_JOB_MEMBER
+};
+
+typedef struct db_hash_job
+{
+   char *path;          /* owned copy; content_list entries can be pruned */
+   size_t index;        /* position in content_list */
+   uint64_t size;
+   uint64_t member_size;
+   uint32_t crc;
+   uint32_t member_crc;
+   enum db_hash_job_state state;
+   enum db_hash_job_kind kind;
+   bool ok;
+   bool cancel;         /* abandoned while BUSY */
+} db_hash_job_t;
+
+typedef struct db_hash_ahead
+{
+   db_hash_job_t jobs[DB_HASH_AHEAD_DEPTH];
+   sthread_t *threads[DB_HASH_AHEAD_MAX_WORKERS];
+   slock_t *lock;
+   scond_t *work;       /* a job was queued, or stop */
+   scond_t *done;       /* a job finished */
+   size_t next_index;   /* next content_list position to consider */
+   unsigned workers;
+   bool stop;
+} db_hash_ahead_t;
+
+/* True if the worker should give up on @job: checked between reads,
+ * so abandoning a large file costs at most one more read. */
+static bool task_database_hash_job_abandoned(db_hash_ahead_t *ha,
+      db_hash_job_t *job)
+{
+   bool abandoned;
+   slock_lock(ha->lock);
+   abandoned = ha->stop || job->cancel;
+   slock_unlock(ha->lock);
+   return abandoned;
+}
+
+/* intfstream_file_get_crc_and_size(), stepped so that it can be
+ * abandoned part way through. */
+static bool task_database_hash_file(db_hash_ahead_t *ha,
+      db_hash_job_t *job, const char *path, uint32_t *crc, uint64_t *size)
+{
+   int64_t file_size;
+   int64_t data_read;
+   uint32_t accumulator = 0;
+   intfstream_t *fd     = intfstream_open_file(path,
+         RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!fd)
+      return false;
+
+   if (     intfstream_seek(fd, 0, SEEK_END) == -1
+         || (file_size = intfstream_tell(fd)) < 0
+         || intfstream_seek(fd, 0, SEEK_SET) == -1)
+   {
+      intfstream_close(fd);
+      free(fd);
+      return false;
+   }
+
+   while ((data_read = intfstream_crc_step(fd, &accumulator,
+               (size_t)-1)) > 0)
+   {
+      if (task_database_hash_job_abandoned(ha, job))
+      {
+         data_read = -1;
+         break;
+      }
+   }
+
+   intfstream_close(fd);
+   free(fd);
+
+   if (data_read < 0)
+      return false;
+
+   *crc  = accumulator;
+   *size = (uint64_t)file_size;
+   return true;
+}
+
+static void task_database_hash_worker(void *data)
+{
+   db_hash_ahead_t *ha = (db_hash_ahead_t*)data;
+
+   slock_lock(ha->lock);
+   for (;;)
+   {
+      size_t i;
+      db_hash_job_t *job = NULL;
+      uint64_t size      = 0;
+      uint64_t msize     = 0;
+      uint32_t crc       = 0;
+      uint32_t mcrc      = 0;
+      bool ok            = false;
+
+      if (ha->stop)
+         break;
+
+      /* Lowest index first: that is the one the match stage will
+       * ask for soonest. */
+      for (i = 0; i < DB_HASH_AHEAD_DEPTH; i++)
+         if (      ha->jobs[i].state == DB_HASH_JOB_QUEUED
+               && (!job || ha->jobs[i].index < job->index))
+            job = &ha->jobs[i];
+
+      if (!job)
+      {
+         scond_wait(ha->work, ha->lock);
+         continue;
+      }
+
+      job->state = DB_HASH_JOB_BUSY;
+      slock_unlock(ha->lock);
+
+      switch (job->kind)
+      {
+         case DB_HASH_JOB_FILE:
+            ok   = task_database_hash_file(ha, job, job->path, &crc, &size);
+            break;
+         case DB_HASH_JOB_ARCHIVE:
+            if ((ok = task_database_hash_file(ha, job, job->path,
+                        &crc, &size)))
+               mcrc = file_archive_get_file_crc32_and_size(job->path,
+                     &msize);
+            break;
+         case DB_HASH_JOB_MEMBER:
+            mcrc = file_archive_get_file_crc32_and_size(job->path, &msize);
+            ok   = true;
+            break;
+      }
+
+      slock_lock(ha->lock);
+      job->crc         = crc;
+      job->size        = size;
+      job->member_crc  = mcrc;
+      job->member_size = msize;
+      job->ok          = ok;
+      job->state       = DB_HASH_JOB_DONE;
+      scond_broadcast(ha->done);
+   }
+   slock_unlock(ha->lock);
+}
+
+static void task_database_hash_job_clear(db_hash_job_t *job)
+{
+   if (job->path)
+      free(job->path);
+   job->path   = NULL;
+   job->cancel = false;
+   job->state  = DB_HASH_JOB_FREE;
+}
+
+static void task_database_hash_ahead_free(db_hash_ahead_t *ha)
+{
+   unsigned i;
+
+   if (!ha)
+      return;
+
+   if (ha->lock)
+   {
+      slock_lock(ha->lock);
+      ha->stop = true;
+      if (ha->work)
+         scond_broadcast(ha->work);
+      slock_unlock(ha->lock);
+   }
+
+   for (i = 0; i < ha->workers; i++)
+      sthread_join(ha->threads[i]);
+
+   for (i = 0; i < DB_HASH_AHEAD_DEPTH; i++)
+      task_database_hash_job_clear(&ha->jobs[i]);
+
+   if (ha->work)
+      scond_free(ha->work);
+   if (ha->done)
+      scond_free(ha->done);
+   if (ha->lock)
+      slock_free(ha->lock);
+   free(ha);
+}
+
+static db_hash_ahead_t *task_database_hash_ahead_new(void)
+{
+   unsigned workers    = cpu_features_get_core_amount();
+   db_hash_ahead_t *ha = (db_hash_ahead_t*)calloc(1, sizeof(*ha));
+
+   if (!ha)
+      return NULL;
+
+   /* Two even on one core: the point is overlapping reads, which a
+    * single core does as well as many. */
+   if (workers < 2)
+      workers = 2;
+   if (workers > DB_HASH_AHEAD_MAX_WORKERS)
+      workers = DB_HASH_AHEAD_MAX_WORKERS;
+
+   if (   !(ha->lock = slock_new())
+       || !(ha->work = scond_new())
+       || !(ha->done = scond_new()))
+   {
+      task_database_hash_ahead_free(ha);
+      return NULL;
+   }
+
+   for (; ha->workers < workers; ha->workers++)
+      if (!(ha->threads[ha->workers] = sthread_create(
+                  task_database_hash_worker, ha)))
+         break;
+
+   if (!ha->workers)
+   {
+      task_database_hash_ahead_free(ha);
+      return NULL;
+   }
+
+   return ha;
+}
+
+/* Which kind of job would hash @path the way the match stage will,
+ * or -1 for content it does not checksum up front. */
+static int task_database_hash_job_kind(const char *path)
+{
+   if (path_contains_compressed_file(path))
+#ifdef HAVE_COMPRESSION
+      return DB_HASH_JOB_MEMBER;
+#else
+      return -1;
+#endif
+   switch (extension_to_file_type(path_get_extension(path)))
+   {
+      case FILE_TYPE_NONE:
+         return DB_HASH_JOB_FILE;
+#ifdef HAVE_COMPRESSION
+      case FILE_TYPE_COMPRESSED:
+         return DB_HASH_JOB_ARCHIVE;
+#endif
+      default:
+         break;
+   }
+   return -1;
+}
+
+/* Retire what the match stage has moved past and queue the files it
+ * is about to reach.  Cheap - no I/O - so it runs every time the
+ * match stage starts a file. */
+static void task_database_hash_ahead_pump(manual_scan_handle_t *_db)
+{
+   size_t i;
+   size_t first;
+   db_hash_ahead_t *ha;
+   struct string_list *list = _db->content_list;
+
+   if (!(_db->flags & DB_HANDLE_FLAG_HASH_AHEAD))
+      return;
+
+   if (!(ha = _db->hash_ahead))
+   {
+      /* Nothing to match against: every lookup ends before it
+       * hashes anything. */
+      if (!_db->state.list || !_db->state.list->size)
+         return;
+      if (!(ha = _db->hash_ahead = task_database_hash_ahead_new()))
+      {
+         _db->flags &= ~DB_HANDLE_FLAG_HASH_AHEAD;
+         return;
+      }
+   }
+
+   first = _db->content_list_index;
+
+   slock_lock(ha->lock);
+   for (i = 0; i < DB_HASH_AHEAD_DEPTH; i++)
+   {
+      db_hash_job_t *job = &ha->jobs[i];
+      /* Behind the match stage, or pruned since it was queued by a
+       * CUE or GDI that references it. */
+      bool stale = job->state != DB_HASH_JOB_FREE
+         && (      job->index < first
+               || !list->elems[job->index].data);
+
+      if (!stale)
+         continue;
+      if (job->state == DB_HASH_JOB_BUSY)
+         job->cancel = true;
+      else
+         task_database_hash_job_clear(job);
+   }
+
+   if (ha->next_index < first)
+      ha->next_index = first;
+
+   while (ha->next_index < list->size && ha->next_index
+         < first + DB_HASH_AHEAD_DEPTH)
+   {
+      int kind;
+      db_hash_job_t *job = NULL;
+      const char *path   = list->elems[ha->next_index].data;
+
+      for (i = 0; i < DB_HASH_AHEAD_DEPTH; i++)
+         if (ha->jobs[i].state == DB_HASH_JOB_FREE)
+         {
+            job = &ha->jobs[i];
+            break;
+         }
+      /* Every slot busy, some with a cancelled job still winding
+       * down; try again at the next file. */
+      if (!job)
+         break;
+
+      /* A file the scan cache already knows is most likely
+       * unchanged; if it did change, it is hashed inline. */
+      if (      path && *path
+            && !scan_cache_has(_db->scan_cache, path)
+            && (kind = task_database_hash_job_kind(path)) >= 0
+            && (job->path = strdup(path)))
+      {
+         job->index = ha->next_index;
+         job->kind  = (enum db_hash_job_kind)kind;
+         job->state = DB_HASH_JOB_QUEUED;
+         scond_signal(ha->work);
+      }
+      ha->next_index++;
+   }
+   slock_unlock(ha->lock);
+}
+
+static db_hash_job_t *task_database_hash_ahead_find(db_hash_ahead_t *ha,
+      size_t index)
+{
+   size_t i;
+   for (i = 0; i < DB_HASH_AHEAD_DEPTH; i++)
+      if (     ha->jobs[i].state != DB_HASH_JOB_FREE
+            && ha->jobs[i].index == index)
+         return &ha->jobs[i];
+   return NULL;
+}
+
+/* True if the current file's checksum is still being worked out and
+ * the handler should come back for it next tick.
+ *
+ * Under a threaded task queue this waits instead: that handler owns
+ * its thread, so blocking costs nothing, and re-entering straight
+ * away would only spin against the workers for the same core.  On
+ * the frame thread it never blocks - the frame is exactly what the
+ * task_nbio_slice window protects, and a wait on a network read
+ * would be worse than the inline hash it replaces. */
+static bool task_database_hash_ahead_pending(manual_scan_handle_t *_db)
+{
+   bool pending = false;
+   db_hash_job_t *job;
+   db_hash_ahead_t *ha = _db->hash_ahead;
+
+   if (!ha)
+      return false;
+
+   slock_lock(ha->lock);
+   if ((job = task_database_hash_ahead_find(ha, _db->content_list_index)))
+   {
+      if (task_queue_is_threaded())
+      {
+         while (job->state != DB_HASH_JOB_DONE)
+            scond_wait(ha->done, ha->lock);
+      }
+      else
+         pending = job->state != DB_HASH_JOB_DONE;
+   }
+   slock_unlock(ha->lock);
+   return pending;
+}
+
+/* Hand over the current file's checksum if a worker produced one.
+ * Fills the same fields, with the same values, that the inline path
+ * would; false means the caller hashes it inline as before. */
+static bool task_database_hash_ahead_take(manual_scan_handle_t *_db,
+      database_state_handle_t *db_state, const char *name)
+{
+   bool taken = false;
+   db_hash_job_t *job;
+   db_hash_ahead_t *ha = _db->hash_ahead;
+
+   if (!ha)
+      return false;
+
+   slock_lock(ha->lock);
+   if (     (job = task_database_hash_ahead_find(ha,
+                  _db->content_list_index))
+         && job->state == DB_HASH_JOB_DONE
+         && string_is_equal(job->path, name))
+   {
+      if ((taken = job->ok))
+      {
+         switch (job->kind)
+         {
+            case DB_HASH_JOB_FILE:
+               db_state->crc          = job->crc;
+               db_state->size         = job->size;
+               break;
+            case DB_HASH_JOB_ARCHIVE:
+               db_state->archive_crc  = job->crc;
+               db_state->archive_size = job->size;
+               db_state->crc          = job->member_crc;
+               db_state->size         = job->member_size;
+               break;
+            case DB_HASH_JOB_MEMBER:
+               db_state->crc          = job->member_crc;
+               db_state->size         = job->member_size;
+               break;
+         }
+      }
+      task_database_hash_job_clear(job);
+   }
+   slock_unlock(ha->lock);
+   return taken;
+}
+#else
+#define task_database_hash_ahead_pump(_db)               ((void)0)
+#define task_database_hash_ahead_pending(_db)            false
+#define task_database_hash_ahead_take(_db, state, name)  false
+#endif
+
+/* The cache lives beside the playlists the scan writes; its name
+ * has no .lpl extension, so nothing that lists playlists sees it. */
+static void task_database_scan_cache_path(manual_scan_handle_t *_db,
+      char *s, size_t len)
+{
+   fill_pathname_join_special(s, _db->playlist_directory,
+         SCAN_CACHE_FILE_NAME, len);
+}
+
+/* Restore what an earlier scan read out of the current file, in
+ * place of reading it again.  False for anything not cached, or
+ * cached against a different size or modification time. */
+static bool task_database_scan_cache_restore(manual_scan_handle_t *_db,
+      database_state_handle_t *db_state, const char *name,
+      scan_cache_record_t *record)
+{
+   if (     !_db->scan_stamp_valid
+         || !scan_cache_get(_db->scan_cache, name, &_db->scan_stamp,
+               record))
+      return false;
+   db_state->size         = record->size;
+   db_state->archive_size = record->archive_size;
+   db_state->crc          = record->crc;
+   db_state->archive_crc  = record->archive_crc;
+   strlcpy(db_state->serial, record->serial, sizeof(db_state->serial));
+   return true;
+}
+
+/* Remember what the lookups read out of the current file, once they
+ * are done with it and before the state is reset for the next one. */
+static void task_database_scan_cache_store(manual_scan_handle_t *_db,
+      database_state_handle_t *db_state, database_info_handle_t *db)
+{
+   scan_cache_record_t record;
+
+   if (!_db->scan_cache || !_db->scan_stamp_valid)
+      return;
+   /* Nothing read - an unreadable file, or one with no serial where
+    * one was looked for.  Try again next scan. */
+   if (!db_state->crc && !*db_state->serial)
+      return;
+
+   switch (db->type)
+   {
+      case DATABASE_TYPE_CRC_LOOKUP:
+      case DATABASE_TYPE_SERIAL_LOOKUP:
+      case DATABASE_TYPE_SERIAL_LOOKUP_SIZEHINT:
+      case DATABASE_TYPE_ITERATE_ARCHIVE:
+         break;
+      default:
+         return;
+   }
+
+   if (strlcpy(record.serial, db_state->serial, sizeof(record.serial))
+         >= sizeof(record.serial))
+      return;
+   record.size         = db_state->size;
+   record.archive_size = db_state->archive_size;
+   record.crc          = db_state->crc;
+   record.archive_crc  = db_state->archive_crc;
+   record.type         = (unsigned)db->type;
+
+   scan_cache_put(_db->scan_cache,
+         _db->content_list->elems[_db->content_list_index].data,
+         &_db->scan_stamp, &record);
+}
+
 static int task_database_iterate_playlist(
       manual_scan_handle_t *_db,
       database_state_handle_t *db_state,
       database_info_handle_t *db, const char *name)
 {
-   switch (extension_to_file_type(path_get_extension(name)))
+   scan_cache_record_t record;
+   enum msg_file_type type = extension_to_file_type(path_get_extension(name));
+
+   /* Read before: take the checksum or serial from the cache.  A
+    * CUE or GDI still has to drop the tracks it references from the
+    * list, and reading its sheet for that is cheap. */
+   if (     type != FILE_TYPE_LUTRO
+         && task_database_scan_cache_restore(_db, db_state, name, &record)
+         && record.type != DATABASE_TYPE_ITERATE_ARCHIVE)
+   {
+      if (type == FILE_TYPE_CUE)
+         task_database_cue_prune(_db->content_list, name);
+      else if (type == FILE_TYPE_GDI)
+         gdi_prune(_db->content_list, name);
+      db->type = (enum database_type)record.type;
+      return 1;
+   }
+
+   switch (type)
    {
       case FILE_TYPE_COMPRESSED:
 #ifdef HAVE_COMPRESSION
          db->type = DATABASE_TYPE_CRC_LOOKUP;
+         if (task_database_hash_ahead_take(_db, db_state, name))
+            return 1;
          /* first check crc of archive itself */
          return intfstream_file_get_crc_and_size(name,
                0, INT64_MAX, &db_state->archive_crc,
@@ -952,6 +1521,8 @@ static int task_database_iterate_playlist(
       default:
          db_state->serial[0] = '\0';
          db->type            = DATABASE_TYPE_CRC_LOOKUP;
+         if (task_database_hash_ahead_take(_db, db_state, name))
+            return 1;
          return intfstream_file_get_crc_and_size(name, 0, INT64_MAX, &db_state->crc, &db_state->size);
    }
 
@@ -1025,6 +1596,8 @@ static enum scan_verdict database_info_list_iterate_end_no_match(
       RARCH_LOG("[Scanner] No match for: \"%s\" (%s %08X).\n", path,
                 db_state->serial, db_state->crc);
 
+   task_database_scan_cache_store(_db, db_state, db);
+
    db_state->list_index   = 0;
    db_state->entry_index  = 0;
    db_state->size         = 0;
@@ -1195,6 +1768,8 @@ static enum scan_verdict database_info_list_iterate_found_match(
                          archive_name))
       RARCH_ERR("[Scanner] Failed to add result for: \"%s\".\n", entry_lbl);
 
+   task_database_scan_cache_store(_db, db_state, db);
+
    database_info_list_free(db_state->info);
    free(db_state->info);
 
@@ -1454,12 +2029,15 @@ static enum scan_verdict task_database_iterate_crc_lookup(
     * or the file is empty. */
    if (!db_state->crc)
    {
+      scan_cache_record_t record;
 #ifdef DEBUG
       RARCH_DBG("[Scanner] Extra crc check 1: %x %d / %x %d %s\n",
             db_state->crc, db_state->size, db_state->archive_crc, db_state->archive_size,
             path_contains_compressed_file ? "compressed:true" : "compressed:false");
 #endif
-      db_state->crc = file_archive_get_file_crc32_and_size(name, &db_state->size);
+      if (     !task_database_scan_cache_restore(_db, db_state, name, &record)
+            && !task_database_hash_ahead_take(_db, db_state, name))
+         db_state->crc = file_archive_get_file_crc32_and_size(name, &db_state->size);
 #ifdef DEBUG
       RARCH_DBG("[Scanner] Extra crc check 2: %x %d / %x %d.\n",
             db_state->crc, db_state->size, db_state->archive_crc, db_state->archive_size);
@@ -2362,6 +2940,16 @@ static void free_manual_content_scan_handle(manual_scan_handle_t *manual_scan)
    manual_scan->playlist_directory = NULL;
 
 #ifdef HAVE_LIBRETRODB
+#ifdef HAVE_THREADS
+   /* Before anything the workers might still be reading: they hold
+    * their own copies of the paths, but not of the database state. */
+   task_database_hash_ahead_free(manual_scan->hash_ahead);
+   manual_scan->hash_ahead = NULL;
+#endif
+   /* Not saved here: a scan that did not finish has not seen every
+    * file under its root, and saving would drop the rest. */
+   scan_cache_free(manual_scan->scan_cache);
+   manual_scan->scan_cache = NULL;
    if (1)
    {
       database_state_handle_t *dbstate = &manual_scan->state;
@@ -3201,6 +3789,19 @@ static void task_manual_content_scan_handler(retro_task_t *task)
             task_database_cleanup_state(dbstate);
             dbstate->list_index  = 0;
             dbstate->entry_index = 0;
+
+            if (!(manual_scan->flags & DB_HANDLE_FLAG_SCAN_CACHE_LOADED))
+            {
+               char cache_path[PATH_MAX_LENGTH];
+               task_database_scan_cache_path(manual_scan,
+                     cache_path, sizeof(cache_path));
+               manual_scan->scan_cache = scan_cache_load(cache_path);
+               manual_scan->flags     |= DB_HANDLE_FLAG_SCAN_CACHE_LOADED;
+            }
+            manual_scan->scan_stamp_valid = manual_scan->scan_cache
+               && scan_cache_stamp(content_path, &manual_scan->scan_stamp);
+
+            task_database_hash_ahead_pump(manual_scan);
             task_database_iterate_start(task, dbinfo, content_path);
             manual_scan->status = DATABASE_SCAN_ITERATE_CONTENT;
             dbinfo->type = DATABASE_TYPE_ITERATE;
@@ -3223,6 +3824,11 @@ static void task_manual_content_scan_handler(retro_task_t *task)
                if (dbinfo->type == DATABASE_TYPE_ITERATE)
                   dbinfo->type   = DATABASE_TYPE_ITERATE_ARCHIVE;
 
+            /* A worker is still reading this file; come back for
+             * its checksum rather than read it a second time. */
+            if (task_database_hash_ahead_pending(manual_scan))
+               break;
+
             current_verdict = (enum scan_verdict)task_database_iterate(manual_scan, content_path, dbstate, dbinfo,
                      path_contains_compressed_file);
 #ifdef DEBUG
@@ -3442,6 +4048,21 @@ static void task_manual_content_scan_handler(retro_task_t *task)
             else if (manual_scan->task_config->target_is_single_determined_playlist)
                playlist_write_file(manual_scan->playlist);
 
+#ifdef HAVE_LIBRETRODB
+            if (manual_scan->scan_cache)
+            {
+               char cache_path[PATH_MAX_LENGTH];
+               task_database_scan_cache_path(manual_scan,
+                     cache_path, sizeof(cache_path));
+               if (!scan_cache_save(manual_scan->scan_cache, cache_path,
+                     manual_scan->task_config->content_dir))
+                  RARCH_WARN("[Scanner] Could not write scan cache \"%s\".\n",
+                        cache_path);
+               scan_cache_free(manual_scan->scan_cache);
+               manual_scan->scan_cache = NULL;
+            }
+#endif
+
             /* Update progress display */
 #ifdef HAVE_LIBRETRODB
             if (dbstate && dbstate->list && dbstate->list->size == 0 &&
@@ -3596,6 +4217,14 @@ bool task_push_manual_content_scan(
 
    if (path_is_directory(manual_scan->task_config->content_dir))
       manual_scan->flags |= DB_HANDLE_FLAG_IS_DIRECTORY;
+
+#ifdef HAVE_THREADS
+   /* A single file has nothing to hash ahead of. */
+   if (   (manual_scan->flags & DB_HANDLE_FLAG_IS_DIRECTORY)
+       && (manual_scan->task_config->db_usage == MANUAL_CONTENT_SCAN_USE_DB_LOOSE
+        || manual_scan->task_config->db_usage == MANUAL_CONTENT_SCAN_USE_DB_STRICT))
+      manual_scan->flags |= DB_HANDLE_FLAG_HASH_AHEAD;
+#endif
 #endif 
 
    playlist_config_set_path(
@@ -0,0 +1,398 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <array/rhmap.h>
+#include <compat/strl.h>
+#include <file/file_path.h>
+#include <retro_miscellaneous.h>
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
+
+#include "task_database_scan_cache.h"
+
+/* On-disk layout, all integers little-endian:
+ *
+ *   "RASC" u32 version u32 count
+ *   count x { u16 path_len, path,
+ *             i64 file size, i64 mtime,
+ *             u64 size, u64 archive_size, u32 crc, u32 archive_crc,
+ *             u8 type, u8 serial_len, serial }
+ *
+ * Bump the version whenever what the scanner reads out of a file
+ * changes - a new serial detector, say - so that results from the old
+ * code are not trusted by the new. */
+#define SCAN_CACHE_MAGIC        "RASC"
+#define SCAN_CACHE_VERSION      1
+#define SCAN_CACHE_HEADER_SIZE  12
+#define SCAN_CACHE_FIXED_SIZE   (2 + 8 + 8 + 8 + 8 + 4 + 4 + 1 + 1)
+
+typedef struct
+{
+   char *path;
+   scan_cache_stamp_t stamp;
+   scan_cache_record_t record;
+   bool seen;   /* asked about or stored by this scan */
+} scan_cache_entry_t;
+
+struct scan_cache
+{
+   scan_cache_entry_t *entries;
+   /* Path -> index into entries.  The keys are the entries' own path
+    * strings, which live until the cache is freed. */
+   size_t *index;
+   size_t count;
+   size_t capacity;
+   bool dirty;
+};
+
+static uint64_t scan_cache_get_le(const uint8_t *p, unsigned bytes)
+{
+   uint64_t v = 0;
+   while (bytes--)
+      v = (v << 8) | p[bytes];
+   return v;
+}
+
+static uint8_t *scan_cache_put_le(uint8_t *p, uint64_t v, unsigned bytes)
+{
+   while (bytes--)
+   {
+      *p++ = (uint8_t)v;
+      v  >>= 8;
+   }
+   return p;
+}
+
+static scan_cache_entry_t *scan_cache_find(scan_cache_t *cache,
+      const char *content_path)
+{
+   ptrdiff_t i = RHMAP_IDX_STR(cache->index, content_path);
+   return (i < 0) ? NULL : &cache->entries[cache->index[i]];
+}
+
+/* Takes ownership of @path. */
+static scan_cache_entry_t *scan_cache_add(scan_cache_t *cache, char *path)
+{
+   scan_cache_entry_t *entry;
+
+   if (cache->count == cache->capacity)
+   {
+      size_t cap = cache->capacity ? cache->capacity * 2 : 256;
+      scan_cache_entry_t *n = (scan_cache_entry_t*)realloc(
+            cache->entries, cap * sizeof(*n));
+      if (!n)
+         return NULL;
+      cache->entries  = n;
+      cache->capacity = cap;
+   }
+
+   if (!RHMAP_TRYFIT(cache->index, cache->count + 1))
+      return NULL;
+
+   entry       = &cache->entries[cache->count];
+   memset(entry, 0, sizeof(*entry));
+   entry->path = path;
+   RHMAP_SET_STR(cache->index, path, cache->count);
+   cache->count++;
+   return entry;
+}
+
+static void scan_cache_parse(scan_cache_t *cache, const uint8_t *data,
+      size_t len)
+{
+   size_t pos = SCAN_CACHE_HEADER_SIZE;
+   uint32_t count;
+
+   if (     len < SCAN_CACHE_HEADER_SIZE
+         || memcmp(data, SCAN_CACHE_MAGIC, 4)
+         || scan_cache_get_le(data + 4, 4) != SCAN_CACHE_VERSION)
+      return;
+
+   count = (uint32_t)scan_cache_get_le(data + 8, 4);
+
+   /* A truncated file keeps what was read before the cut. */
+   while (count-- && len - pos >= SCAN_CACHE_FIXED_SIZE)
+   {
+      scan_cache_entry_t *entry;
+      const uint8_t *p    = data + pos;
+      size_t path_len     = (size_t)scan_cache_get_le(p, 2);
+      size_t serial_len;
+      char *path;
+
+      if (len - pos < SCAN_CACHE_FIXED_SIZE + path_len)
+         break;
+      serial_len = p[SCAN_CACHE_FIXED_SIZE - 1 + path_len];
+      if (     len - pos < SCAN_CACHE_FIXED_SIZE + path_len + serial_len
+            || serial_len >= SCAN_CACHE_SERIAL_MAX
+            || !path_len)
+         break;
+
+      if (!(path = (char*)malloc(path_len + 1)))
+         break;
+      memcpy(path, p + 2, path_len);
+      path[path_len] = '\0';
+      p += 2 + path_len;
+
+      /* A duplicate would leave the first entry unreachable. */
+      if (RHMAP_HAS_STR(cache->index, path))
+         entry = NULL;
+      else
+         entry = scan_cache_add(cache, path);
+      if (!entry)
+      {
+         free(path);
+         pos += SCAN_CACHE_FIXED_SIZE + path_len + serial_len;
+         continue;
+      }
+
+      entry->stamp.size           = (int64_t)scan_cache_get_le(p,      8);
+      entry->stamp.mtime          = (int64_t)scan_cache_get_le(p + 8,  8);
+      entry->record.size          = scan_cache_get_le(p + 16, 8);
+      entry->record.archive_size  = scan_cache_get_le(p + 24, 8);
+      entry->record.crc           = (uint32_t)scan_cache_get_le(p + 32, 4);
+      entry->record.archive_crc   = (uint32_t)scan_cache_get_le(p + 36, 4);
+      entry->record.type          = p[40];
+      memcpy(entry->record.serial, p + 42, serial_len);
+      entry->record.serial[serial_len] = '\0';
+
+      pos += SCAN_CACHE_FIXED_SIZE + path_len + serial_len;
+   }
+}
+
+scan_cache_t *scan_cache_load(const char *path)
+{
+   void *data          = NULL;
+   int64_t len         = 0;
+   scan_cache_t *cache = (scan_cache_t*)calloc(1, sizeof(*cache));
+
+   if (!cache)
+      return NULL;
+
+   RHMAP_BORROW_KEYS(cache->index);
+
+   if (     path_is_valid(path)
+         && filestream_read_file(path, &data, &len)
+         && data)
+      scan_cache_parse(cache, (const uint8_t*)data, (size_t)len);
+   free(data);
+   return cache;
+}
+
+void scan_cache_free(scan_cache_t *cache)
+{
+   size_t i;
+
+   if (!cache)
+      return;
+   for (i = 0; i < cache->count; i++)
+      free(cache->entries[i].path);
+   free(cache->entries);
+   RHMAP_FREE(cache->index);
+   free(cache);
+}
+
+/* Under @root, separator-aware so that "/roms" does not claim
+ * "/roms2". */
+static bool scan_cache_under(const char *path, const char *root,
+      size_t root_len)
+{
+   if (!root_len || strncmp(path, root, root_len))
+      return false;
+   return    path[root_len] == '\0'
+          || PATH_CHAR_IS_SLASH(path[root_len])
+          || PATH_CHAR_IS_SLASH(root[root_len - 1]);
+}
+
+bool scan_cache_save(scan_cache_t *cache, const char *path,
+      const char *root)
+{
+   size_t i, bytes, kept = 0;
+   uint8_t *buf, *p;
+   bool ok;
+   char tmp_path[PATH_MAX_LENGTH];
+   size_t root_len = root ? strlen(root) : 0;
+
+   if (!cache)
+      return false;
+
+   /* Anything under the scanned root that the scan did not reach is
+    * gone, and dropping it is a change worth writing. */
+   bytes = SCAN_CACHE_HEADER_SIZE;
+   for (i = 0; i < cache->count; i++)
+   {
+      scan_cache_entry_t *entry = &cache->entries[i];
+      if (!entry->seen && scan_cache_under(entry->path, root, root_len))
+      {
+         cache->dirty = true;
+         continue;
+      }
+      bytes += SCAN_CACHE_FIXED_SIZE + strlen(entry->path)
+             + strlen(entry->record.serial);
+      kept++;
+   }
+
+   if (!cache->dirty)
+      return true;
+
+   if (!(buf = (uint8_t*)malloc(bytes)))
+      return false;
+
+   memcpy(buf, SCAN_CACHE_MAGIC, 4);
+   p = scan_cache_put_le(buf + 4, SCAN_CACHE_VERSION, 4);
+   p = scan_cache_put_le(p, kept, 4);
+
+   for (i = 0; i < cache->count; i++)
+   {
+      size_t path_len, serial_len;
+      scan_cache_entry_t *entry = &cache->entries[i];
+
+      if (!entry->seen && scan_cache_under(entry->path, root, root_len))
+         continue;
+
+      path_len   = strlen(entry->path);
+      serial_len = strlen(entry->record.serial);
+      p = scan_cache_put_le(p, path_len, 2);
+      memcpy(p, entry->path, path_len);
+      p += path_len;
+      p = scan_cache_put_le(p, (uint64_t)entry->stamp.size,  8);
+      p = scan_cache_put_le(p, (uint64_t)entry->stamp.mtime, 8);
+      p = scan_cache_put_le(p, entry->record.size,          8);
+      p = scan_cache_put_le(p, entry->record.archive_size,  8);
+      p = scan_cache_put_le(p, entry->record.crc,           4);
+      p = scan_cache_put_le(p, entry->record.archive_crc,   4);
+      *p++ = (uint8_t)entry->record.type;
+      *p++ = (uint8_t)serial_len;
+      memcpy(p, entry->record.serial, serial_len);
+      p += serial_len;
+   }
+
+   /* Written aside and moved into place, so that an interrupted
+    * write loses this scan's additions rather than the whole cache.
+    * Windows will not rename over an existing file; a cache is cheap
+    * enough to lose that the fallback need not be more careful. */
+   fill_pathname_join_delim(tmp_path, path, "tmp", '.', sizeof(tmp_path));
+   ok = filestream_write_file(tmp_path, buf, (int64_t)(p - buf));
+   free(buf);
+
+   if (ok && filestream_rename(tmp_path, path) != 0)
+   {
+      filestream_delete(path);
+      ok = filestream_rename(tmp_path, path) == 0;
+   }
+   if (!ok)
+      filestream_delete(tmp_path);
+   else
+      cache->dirty = false;
+   return ok;
+}
+
+bool scan_cache_stamp(const char *content_path, scan_cache_stamp_t *stamp)
+{
+   const char *delim = path_get_archive_delim(content_path);
+
+   if (delim)
+   {
+      char archive[PATH_MAX_LENGTH];
+      size_t _len = (size_t)(delim - content_path);
+      if (_len >= sizeof(archive))
+         return false;
+      memcpy(archive, content_path, _len);
+      archive[_len] = '\0';
+      return path_get_size_and_mtime(archive, &stamp->size, &stamp->mtime);
+   }
+   return path_get_size_and_mtime(content_path, &stamp->size,
+         &stamp->mtime);
+}
+
+bool scan_cache_get(scan_cache_t *cache, const char *content_path,
+      const scan_cache_stamp_t *stamp, scan_cache_record_t *record)
+{
+   scan_cache_entry_t *entry;
+
+   if (!cache || !(entry = scan_cache_find(cache, content_path)))
+      return false;
+
+   /* Seen either way: a stale entry is about to be replaced, and must
+    * not be dropped as a vanished file if it is not. */
+   entry->seen = true;
+
+   if (     entry->stamp.size  != stamp->size
+         || entry->stamp.mtime != stamp->mtime)
+      return false;
+
+   *record = entry->record;
+   return true;
+}
+
+bool scan_cache_has(scan_cache_t *cache, const char *content_path)
+{
+   return cache && RHMAP_HAS_STR(cache->index, content_path);
+}
+
+static bool scan_cache_record_equal(const scan_cache_record_t *a,
+      const scan_cache_record_t *b)
+{
+   return a->size         == b->size
+       && a->archive_size == b->archive_size
+       && a->crc          == b->crc
+       && a->archive_crc  == b->archive_crc
+       && a->type         == b->type
+       && string_is_equal(a->serial, b->serial);
+}
+
+void scan_cache_put(scan_cache_t *cache, const char *content_path,
+      const scan_cache_stamp_t *stamp, const scan_cache_record_t *record)
+{
+   scan_cache_entry_t *entry;
+
+   if (     !cache
+         || !content_path
+         || !*content_path
+         || strlen(content_path) > 0xFFFF
+         || strlen(record->serial) >= SCAN_CACHE_SERIAL_MAX)
+      return;
+
+   if (!(entry = scan_cache_find(cache, content_path)))
+   {
+      char *path = strdup(content_path);
+      if (!path)
+         return;
+      if (!(entry = scan_cache_add(cache, path)))
+      {
+         free(path);
+         return;
+      }
+   }
+   else if (   entry->stamp.size  == stamp->size
+            && entry->stamp.mtime == stamp->mtime
+            && scan_cache_record_equal(&entry->record, record))
+   {
+      entry->seen = true;
+      return;
+   }
+
+   entry->stamp  = *stamp;
+   entry->record = *record;
+   /* Zero the tail so that what is saved is only what was meant. */
+   {
+      size_t serial_len = strlen(record->serial);
+      memset(entry->record.serial + serial_len, 0,
+            sizeof(entry->record.serial) - serial_len);
+   }
+   entry->seen   = true;
+   cache->dirty  = true;
+}
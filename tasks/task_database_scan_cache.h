@@ -0,0 +1,92 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef TASK_DATABASE_SCAN_CACHE
+#define TASK_DATABASE_SCAN_CACHE
+
+#include <stdint.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+
+RETRO_BEGIN_DECLS
+
+/* What the database scanner learned about a content file by reading
+ * it - its checksum or serial, before any database was consulted -
+ * remembered across scans so an unchanged file is not read again.
+ *
+ * Keyed by path and stamped with the file's size and modification
+ * time; an archive member is stamped with its archive's.  A stamp
+ * that does not match is a miss, and a file whose modification time
+ * cannot be had (a core-supplied VFS, SMB, SAF, some consoles) is
+ * never cached at all: size alone would let a rewritten file of the
+ * same size through.
+ *
+ * Match results are deliberately not kept.  They depend on the
+ * databases as much as on the file, databases change with every
+ * update, and with the crc and serial indexes a match costs a lookup
+ * once the file itself no longer has to be read. */
+
+#define SCAN_CACHE_FILE_NAME  ".scan_cache"
+#define SCAN_CACHE_SERIAL_MAX 64
+
+typedef struct scan_cache scan_cache_t;
+
+typedef struct
+{
+   int64_t size;
+   int64_t mtime;
+} scan_cache_stamp_t;
+
+/* Mirrors the database_state_handle_t fields the lookups fill in. */
+typedef struct
+{
+   uint64_t size;
+   uint64_t archive_size;
+   uint32_t crc;
+   uint32_t archive_crc;
+   unsigned type;          /* enum database_type the lookup settled on */
+   char serial[SCAN_CACHE_SERIAL_MAX];
+} scan_cache_record_t;
+
+/* Never NULL short of OOM: a missing, foreign or damaged file loads
+ * as an empty cache. */
+scan_cache_t *scan_cache_load(const char *path);
+
+/* Writes the cache back if anything changed.  Entries under @root
+ * that this scan never asked about are dropped on the way - the scan
+ * walked @root, so they are files that no longer exist. */
+bool scan_cache_save(scan_cache_t *cache, const char *path,
+      const char *root);
+
+void scan_cache_free(scan_cache_t *cache);
+
+/* Stamp @content_path, which may name an archive member.  False when
+ * no modification time is available; such a file is neither looked
+ * up nor stored. */
+bool scan_cache_stamp(const char *content_path, scan_cache_stamp_t *stamp);
+
+bool scan_cache_get(scan_cache_t *cache, const char *content_path,
+      const scan_cache_stamp_t *stamp, scan_cache_record_t *record);
+
+/* Whether anything is held for @content_path, without checking that
+ * it is still current.  Cheap enough to ask about files the scan has
+ * not reached yet. */
+bool scan_cache_has(scan_cache_t *cache, const char *content_path);
+
+void scan_cache_put(scan_cache_t *cache, const char *content_path,
+      const scan_cache_stamp_t *stamp, const scan_cache_record_t *record);
+
+RETRO_END_DECLS
+
+#endif
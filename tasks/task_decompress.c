@@ -18,6 +18,13 @@
 #include <file/archive_file.h>
 #include <retro_miscellaneous.h>
 #include <compat/strl.h>
+#include <streams/file_stream.h>
+
+#ifdef HAVE_THREADS
+#include <features/features_cpu.h>
+#include <rthreads/rthreads.h>
+#include <rthreads/tpool.h>
+#endif
 
 #include "tasks_internal.h"
 #include "../file_path_special.h"
@@ -25,6 +32,352 @@
 
 #define CALLBACK_ERROR_SIZE 4200
 
+#ifdef HAVE_THREADS
+/* Members of a ZIP are compressed independently of one another, so
+ * once the walk has found one it can be handed to a worker and the
+ * walk can move straight on to the next. The updater's asset, overlay,
+ * shader and core info bundles are thousands of small members each,
+ * and extracting them one per tick was one of the slowest parts of a
+ * first boot.
+ *
+ * The walk itself stays on the task thread: it owns the transfer and
+ * the directory cursor, makes the directories, and decides what gets
+ * extracted, exactly as before. Only the decode and the write of each
+ * member move to the pool, through
+ * file_archive_perform_mode_detached(), which reads the transfer but
+ * never changes it. What the pool must never see is the archive going
+ * away under it, so while anything is outstanding the handler holds
+ * the transfer in ITERATE and does not call the walk at all once it
+ * wants to stop or tear down. */
+#define DECOMPRESS_POOL_MAX_THREADS 4
+/* Members handed out but not yet written, per worker, before the walk
+ * waits for them: enough to keep every worker busy between ticks
+ * without queueing the whole directory up front. */
+#define DECOMPRESS_POOL_BACKLOG     4
+/* Longest a tick blocks waiting for a worker to finish a member. */
+#define DECOMPRESS_POOL_WAIT_USEC   2000
+
+struct decompress_pool
+{
+   tpool_t *tp;
+   slock_t *lock;
+   scond_t *cond;
+   /* The first member that failed, as a task error. */
+   char *error;
+   unsigned threads;
+   /* Members handed to the pool, and those since finished either
+    * way; only the task thread adds to queued. */
+   unsigned queued;
+   unsigned done;
+   /* Set on cancellation or on the first failure: members not yet
+    * started are dropped rather than extracted, and those that finish
+    * after it do not keep what they wrote. */
+   bool cancel;
+};
+
+struct decompress_job
+{
+   struct decompress_pool *pool;
+   file_archive_transfer_t *transfer;
+   const uint8_t *cdata;
+   unsigned cmode;
+   uint32_t csize;
+   uint32_t size;
+   char path[PATH_MAX_LENGTH];
+};
+#endif
+
+/* "Failed to deflate <path>.", as a task error */
+static char *task_decompress_error_msg(const char *path)
+{
+   size_t _len;
+   char *msg = (char*)malloc(CALLBACK_ERROR_SIZE);
+   /* NULL-check: the strlcpy below NULL-derefs on OOM.  The
+    * downstream task_set_error calls accept NULL, so skipping the
+    * error-string population leaves the task with a NULL error and
+    * the user sees no 'Failed to deflate' message - which is
+    * strictly better than segfaulting. */
+   if (!msg)
+      return NULL;
+   _len  = strlcpy(msg, "Failed to deflate ", CALLBACK_ERROR_SIZE);
+   _len += strlcpy(msg + _len, path, CALLBACK_ERROR_SIZE - _len);
+   msg[  _len] = '.';
+   msg[++_len] = '\n';
+   msg[++_len] = '\0';
+   return msg;
+}
+
+#ifdef HAVE_THREADS
+static void task_decompress_job(void *arg)
+{
+   struct decompress_job *job   = (struct decompress_job*)arg;
+   struct decompress_pool *pool = job->pool;
+   bool cancel;
+   bool ok                      = true;
+
+   slock_lock(pool->lock);
+   cancel = pool->cancel;
+   slock_unlock(pool->lock);
+
+   if (!cancel)
+   {
+      ok = file_archive_perform_mode_detached(job->transfer, job->path,
+            job->cdata, job->cmode, job->csize, job->size);
+
+      slock_lock(pool->lock);
+      cancel = pool->cancel;
+      slock_unlock(pool->lock);
+
+      /* A failed member can leave a short file behind, and one still
+       * being written when the task stopped is not one it reports, so
+       * neither stays on disk.  Removed before it is counted done:
+       * the task only finishes once every member is, and nothing it
+       * abandoned should outlive it. */
+      if (!ok || cancel)
+         filestream_delete(job->path);
+   }
+
+   slock_lock(pool->lock);
+   if (!ok)
+   {
+      if (!pool->error)
+         pool->error = task_decompress_error_msg(job->path);
+      pool->cancel   = true;
+   }
+   pool->done++;
+   scond_signal(pool->cond);
+   slock_unlock(pool->lock);
+
+   free(job);
+}
+
+/* Returns a pool for the archive just opened in @transfer, or NULL
+ * to extract it serially: on one core, for an archive with a single
+ * member, or for a format whose members cannot be decoded apart. */
+static struct decompress_pool *task_decompress_pool_new(
+      file_archive_transfer_t *transfer)
+{
+   struct decompress_pool *pool;
+   unsigned threads = cpu_features_get_core_amount();
+
+   if (     threads < 2
+         || transfer->step_total < 2
+         || !file_archive_can_perform_detached(transfer))
+      return NULL;
+   if (threads > DECOMPRESS_POOL_MAX_THREADS)
+      threads = DECOMPRESS_POOL_MAX_THREADS;
+   if (!(pool = (struct decompress_pool*)calloc(1, sizeof(*pool))))
+      return NULL;
+
+   pool->threads = threads;
+   pool->lock    = slock_new();
+   pool->cond    = scond_new();
+   if (pool->lock && pool->cond)
+      pool->tp   = tpool_create(threads);
+   if (!pool->tp)
+   {
+      if (pool->lock)
+         slock_free(pool->lock);
+      if (pool->cond)
+         scond_free(pool->cond);
+      free(pool);
+      return NULL;
+   }
+
+   return pool;
+}
+
+/* Drops whatever has not started, waits out what has, and hands any
+ * failure on to @dec->callback_error. Blocks, but only ever for the
+ * members already being written; the handlers reach here with
+ * nothing outstanding unless the task was cancelled mid-tick. Must
+ * run before the transfer is stopped. */
+static void task_decompress_pool_free(decompress_state_t *dec)
+{
+   struct decompress_pool *pool =
+      (struct decompress_pool*)dec->userdata->cb_data;
+
+   if (!pool)
+      return;
+   dec->userdata->cb_data = NULL;
+
+   slock_lock(pool->lock);
+   pool->cancel = true;
+   slock_unlock(pool->lock);
+
+   tpool_wait(pool->tp);
+   tpool_destroy(pool->tp);
+
+   if (pool->error && !dec->callback_error)
+      dec->callback_error = pool->error;
+   else
+      free(pool->error);
+
+   scond_free(pool->cond);
+   slock_free(pool->lock);
+   free(pool);
+}
+
+static bool task_decompress_pool_add(struct decompress_pool *pool,
+      file_archive_transfer_t *transfer, const char *path,
+      const uint8_t *cdata, unsigned cmode, uint32_t csize, uint32_t size)
+{
+   struct decompress_job *job;
+   bool cancel;
+
+   slock_lock(pool->lock);
+   cancel = pool->cancel;
+   slock_unlock(pool->lock);
+
+   /* Already stopping; the failure that stopped it is reported by
+    * the pool, not charged to this member. */
+   if (cancel)
+      return true;
+
+   if (!(job = (struct decompress_job*)malloc(sizeof(*job))))
+      return false;
+
+   job->pool     = pool;
+   job->transfer = transfer;
+   job->cdata    = cdata;
+   job->cmode    = cmode;
+   job->csize    = csize;
+   job->size     = size;
+   strlcpy(job->path, path, sizeof(job->path));
+
+   /* Counted before it can possibly finish. */
+   slock_lock(pool->lock);
+   pool->queued++;
+   slock_unlock(pool->lock);
+
+   if (!tpool_add_work(pool->tp, task_decompress_job, job))
+   {
+      slock_lock(pool->lock);
+      pool->queued--;
+      slock_unlock(pool->lock);
+      free(job);
+      return false;
+   }
+
+   return true;
+}
+
+/* Runs before every step of the walk. Returns true when the handler
+ * must not step it this tick: too many members are still in flight,
+ * or the walk wants to stop or tear down and some still are. Waits a
+ * little for one to finish first, so that a threaded task queue,
+ * which calls straight back, is not left spinning. */
+static bool task_decompress_pool_busy(retro_task_t *task,
+      decompress_state_t *dec)
+{
+   unsigned outstanding;
+   bool stopping;
+   struct decompress_pool *pool =
+      (struct decompress_pool*)dec->userdata->cb_data;
+
+   if (!pool)
+   {
+      /* Set up once the archive is open and before its first member
+       * is looked at. */
+      if (     dec->archive.type         == ARCHIVE_TRANSFER_ITERATE
+            && dec->archive.step_current == 0)
+         dec->userdata->cb_data = task_decompress_pool_new(&dec->archive);
+      return false;
+   }
+
+   slock_lock(pool->lock);
+   if ((task_get_flags(task) & RETRO_TASK_FLG_CANCELLED) > 0)
+      pool->cancel   = true;
+   stopping          = pool->cancel
+      || dec->archive.type != ARCHIVE_TRANSFER_ITERATE;
+   outstanding       = pool->queued - pool->done;
+   if (     outstanding > 0
+         && (stopping || outstanding >= pool->threads
+            * DECOMPRESS_POOL_BACKLOG))
+   {
+      scond_wait_timeout(pool->cond, pool->lock,
+            DECOMPRESS_POOL_WAIT_USEC);
+      slock_unlock(pool->lock);
+      return true;
+   }
+   slock_unlock(pool->lock);
+
+   /* Drained after a failure: stop the walk here, rather than let it
+    * hand out a member that would only be dropped. The failure itself
+    * reaches the task through task_decompress_pool_free(). */
+   if (stopping && dec->archive.type == ARCHIVE_TRANSFER_ITERATE)
+      dec->archive.type = ARCHIVE_TRANSFER_DEINIT;
+
+   return false;
+}
+
+/* Whether the walk may hand out another member this tick. Stepping
+ * the directory is cheap next to a decode, so with a pool one tick
+ * fills the backlog rather than finding a single member per frame. */
+static bool task_decompress_pool_more(decompress_state_t *dec)
+{
+   bool more;
+   struct decompress_pool *pool =
+      (struct decompress_pool*)dec->userdata->cb_data;
+
+   if (!pool || dec->archive.type != ARCHIVE_TRANSFER_ITERATE)
+      return false;
+
+   slock_lock(pool->lock);
+   more = !pool->cancel && pool->queued - pool->done
+      < pool->threads * DECOMPRESS_POOL_BACKLOG;
+   slock_unlock(pool->lock);
+
+   return more;
+}
+
+/* While members are in flight the walk is ahead of the files on disk,
+ * so count only what the pool has finished. */
+static int task_decompress_progress(decompress_state_t *dec)
+{
+   struct decompress_pool *pool =
+      (struct decompress_pool*)dec->userdata->cb_data;
+
+   if (pool && dec->archive.step_total > 0)
+   {
+      unsigned outstanding;
+      slock_lock(pool->lock);
+      outstanding = pool->queued - pool->done;
+      slock_unlock(pool->lock);
+      return (int)(((dec->archive.step_current - outstanding) * 100)
+            / dec->archive.step_total);
+   }
+
+   return file_archive_parse_file_progress(&dec->archive);
+}
+#else
+#define task_decompress_pool_more(dec) false
+#define task_decompress_progress(dec) \
+   file_archive_parse_file_progress(&(dec)->archive)
+#endif
+
+/* Hands a member to the pool where there is one, otherwise starts it
+ * in the transfer's pending slot as before. */
+static bool task_decompress_member(decompress_state_t *dec,
+      const char *path, const char *valid_exts, const uint8_t *cdata,
+      unsigned cmode, uint32_t csize, uint32_t size, uint32_t crc32,
+      struct archive_extract_userdata *userdata)
+{
+#ifdef HAVE_THREADS
+   struct decompress_pool *pool =
+      (struct decompress_pool*)userdata->cb_data;
+   if (pool)
+      return task_decompress_pool_add(pool, userdata->transfer, path,
+            cdata, cmode, csize, size);
+#endif
+   /* Start the decode rather than driving it to completion here.
+    * Whatever is left is parked in the transfer and finished by
+    * file_archive_parse_file_iterate() on later ticks, one slice
+    * per tick, so a large member no longer holds the frame. */
+   return file_archive_perform_mode_start(path, valid_exts,
+         cdata, cmode, csize, size, crc32, userdata) != -1;
+}
+
 static int file_decompressed_target_file(const char *name,
       const char *valid_exts, const uint8_t *cdata,
       unsigned cmode, uint32_t csize, uint32_t size,
@@ -132,36 +485,12 @@ static int file_decompressed_subdir(const char *name,
    /* Make directory */
    if (path_mkdir(path_dir))
    {
-      /* Start the decode rather than driving it to completion here.
-       * Whatever is left is parked in the transfer and finished by
-       * file_archive_parse_file_iterate() on later ticks, one slice
-       * per tick, so a large member no longer holds the frame. */
-      if (file_archive_perform_mode_start(path, valid_exts,
-               cdata, cmode, csize, size, crc32, userdata) != -1)
+      if (task_decompress_member(userdata->dec, path, valid_exts,
+               cdata, cmode, csize, size, crc32, userdata))
          return 1;
    }
 
-   userdata->dec->callback_error = (char*)malloc(CALLBACK_ERROR_SIZE);
-   /* NULL-check: the strlcpy below NULL-derefs on OOM.  The
-    * downstream task_set_error calls (lines 246, 274, 304) accept
-    * NULL, so skipping the error-string population leaves the task
-    * with a NULL error and the user sees no 'Failed to deflate'
-    * message - which is strictly better than segfaulting.  Any
-    * subsequent 'if (dec->callback_error)' downstream is already
-    * NULL-safe. */
-   if (userdata->dec->callback_error)
-   {
-      _len  = strlcpy(userdata->dec->callback_error,
-            "Failed to deflate ",
-            CALLBACK_ERROR_SIZE);
-      _len += strlcpy(
-            userdata->dec->callback_error + _len,
-            path,
-            CALLBACK_ERROR_SIZE - _len);
-      userdata->dec->callback_error[  _len] = '.';
-      userdata->dec->callback_error[++_len] = '\n';
-      userdata->dec->callback_error[++_len] = '\0';
-   }
+   userdata->dec->callback_error = task_decompress_error_msg(path);
 
    return 0;
 }
@@ -188,24 +517,12 @@ static int file_decompressed(const char *name, const char *valid_exts,
    {
       fill_pathname_join_special(path, dec->target_dir, name, sizeof(path));
 
-      /* Started, not completed; see the twin in file_archived. */
-      if (file_archive_perform_mode_start(path, valid_exts,
-               cdata, cmode, csize, size, crc32, userdata) != -1)
+      if (task_decompress_member(dec, path, valid_exts,
+               cdata, cmode, csize, size, crc32, userdata))
          return 1;
    }
 
-   dec->callback_error = (char*)malloc(CALLBACK_ERROR_SIZE);
-   /* NULL-check: see twin in file_archived for reasoning. */
-   if (dec->callback_error)
-   {
-      _len  = strlcpy(dec->callback_error, "Failed to deflate ",
-              CALLBACK_ERROR_SIZE);
-      _len += strlcpy(dec->callback_error + _len,
-              path, CALLBACK_ERROR_SIZE     - _len);
-      dec->callback_error[  _len] = '.';
-      dec->callback_error[++_len] = '\n';
-      dec->callback_error[++_len] = '\0';
-   }
+   dec->callback_error = task_decompress_error_msg(path);
 
    return 0;
 }
@@ -281,6 +598,11 @@ static void task_decompress_cleanup(retro_task_t *task)
    free(dec->target_file);
    free(dec->subdir);
    free(dec->valid_ext);
+#ifdef HAVE_THREADS
+   /* Drained when the handler finished; this only guards a task
+    * retired without getting that far. */
+   task_decompress_pool_free(dec);
+#endif
    free(dec->callback_error);
    free(dec->userdata);
    free(dec);
@@ -297,18 +619,33 @@ static void task_decompress_handler(retro_task_t *task)
    strlcpy(dec->userdata->archive_path,
          dec->source_file, sizeof(dec->userdata->archive_path));
 
-   ret                     = file_archive_parse_file_iterate(
-         &dec->archive,
-         &retdec, dec->source_file,
-         dec->valid_ext, file_decompressed, dec->userdata);
+#ifdef HAVE_THREADS
+   if (task_decompress_pool_busy(task, dec))
+   {
+      task_set_progress(task, task_decompress_progress(dec));
+      return;
+   }
+#endif
 
-   task_set_progress(task,
-         file_archive_parse_file_progress(&dec->archive));
+   do
+   {
+      ret                  = file_archive_parse_file_iterate(
+            &dec->archive,
+            &retdec, dec->source_file,
+            dec->valid_ext, file_decompressed, dec->userdata);
+   } while (ret == 0 && task_decompress_pool_more(dec));
+
+   task_set_progress(task, task_decompress_progress(dec));
 
    flg = task_get_flags(task);
 
    if (((flg & RETRO_TASK_FLG_CANCELLED) > 0) || ret != 0)
    {
+#ifdef HAVE_THREADS
+      /* Ahead of the stop below: members still being written are
+       * reading the archive it closes. */
+      task_decompress_pool_free(dec);
+#endif
       task_set_error(task, dec->callback_error);
       /* Ownership of the buffer moved to task->error (freed at
        * retirement); cleared so task_decompress_cleanup() does
@@ -364,17 +701,32 @@ static void task_decompress_handler_subdir(retro_task_t *task)
          dec->source_file,
          sizeof(dec->userdata->archive_path));
 
-   ret                     = file_archive_parse_file_iterate(
-         &dec->archive, &retdec, dec->source_file,
-         dec->valid_ext, file_decompressed_subdir, dec->userdata);
+#ifdef HAVE_THREADS
+   if (task_decompress_pool_busy(task, dec))
+   {
+      task_set_progress(task, task_decompress_progress(dec));
+      return;
+   }
+#endif
+
+   do
+   {
+      ret                  = file_archive_parse_file_iterate(
+            &dec->archive, &retdec, dec->source_file,
+            dec->valid_ext, file_decompressed_subdir, dec->userdata);
+   } while (ret == 0 && task_decompress_pool_more(dec));
 
-   task_set_progress(task,
-         file_archive_parse_file_progress(&dec->archive));
+   task_set_progress(task, task_decompress_progress(dec));
 
    flg = task_get_flags(task);
 
    if (((flg & RETRO_TASK_FLG_CANCELLED) > 0) || ret != 0)
    {
+#ifdef HAVE_THREADS
+      /* Ahead of the stop below: members still being written are
+       * reading the archive it closes. */
+      task_decompress_pool_free(dec);
+#endif
       task_set_error(task, dec->callback_error);
       /* Ownership of the buffer moved to task->error (freed at
        * retirement); cleared so task_decompress_cleanup() does
@@ -101,9 +101,10 @@ struct save_state_buf
    size_t size;
    /* Bytes actually allocated at 'data'.  Equal to 'size' for every
     * buffer that was allocated to fit, and larger only for
-    * undo_load_buf, which reuses an allocation across snapshots that
-    * may differ in length.  Tracked on all of them so the field
-    * cannot be read stale by whoever reuses this struct next. */
+    * undo_load_buf and ram_buf, which reuse allocations across
+    * snapshots that may differ in length.  Tracked on all of them so
+    * the field cannot be read stale by whoever reuses this struct
+    * next. */
    size_t capacity;
    char path[PATH_MAX_LENGTH];
 };
@@ -111,6 +112,8 @@ struct save_state_buf
 struct ram_save_state_buf
 {
    struct save_state_buf state_buf;
+   /* The snapshot state_buf points into; see state_snapshot_acquire(). */
+   struct state_snapshot *snapshot;
    bool to_write_file;
 };
 
@@ -137,18 +140,47 @@ typedef struct
 {
    intfstream_t *file;
    void *data;
-   void *undo_data;
+   /* Non-NULL when 'data' is a shared snapshot's rather than the
+    * task's own.  The task then does not free it: the reference is
+    * the task's user_data, dropped by its callback. */
+   struct state_snapshot *snapshot;
    ssize_t size;
-   ssize_t undo_size;
    ssize_t written;
    ssize_t bytes_read;
    int state_slot;
+   /* With SAVE_TASK_FLAG_COMPRESS_FILES: the enum rzip_codec
+    * and level to write with */
+   unsigned codec;
+   int level;
    uint8_t flags;
    char path[PATH_MAX_LENGTH];
 } save_task_state_t;
 
 typedef save_task_state_t load_task_data_t;
 
+/* One serialized state, shared by reference.
+ *
+ * A slot save, the interval autosave, a RAM state and the blocking
+ * autosave at unload all want the same thing - the core's state as
+ * it is right now - and each used to serialize its own copy.  Within
+ * one frame they now get the same snapshot: the first asks the core,
+ * the rest take a reference.  Nothing writes to a snapshot after it
+ * is taken, so sharing needs no copy, and the last reference dropped
+ * returns the buffer to state_buf_pool.
+ *
+ * 'generation' is content_state_snapshot_invalidate()'s count at the
+ * time of the serialize: anything that moves the core's state on
+ * (running a frame, a reset, an unserialize) bumps it, and a
+ * snapshot from an older generation is never handed out again. */
+struct state_snapshot
+{
+   void    *data;
+   size_t   size;
+   size_t   capacity;
+   unsigned generation;
+   unsigned refs;
+};
+
 /* Holds the previous saved state
  * Can be restored to disk with undo_save_state(). */
 static struct save_state_buf undo_save_buf;
@@ -174,6 +206,32 @@ static struct
    size_t capacity;
 } undo_load_spare;
 
+/* The snapshot state_snapshot_acquire() would share, or NULL.  Not a
+ * reference: cleared when the last holder drops the snapshot. */
+static struct state_snapshot *state_snapshot_shared = NULL;
+static unsigned state_snapshot_generation           = 0;
+
+/* Retained state-sized allocations for snapshots, the same trade
+ * undo_load_spare makes for the undo capture.  A slot save hands its
+ * buffer to a task, and the task used to free it when the write was
+ * done, so every save paid for a fresh mmap and faulted each page in
+ * again - most of the cost of a serialize, per
+ * content_serialize_reusing().  The finished buffer now comes back
+ * here and the next snapshot is serialized into it.
+ *
+ * Two, because a write in flight still holds one while the next
+ * snapshot is taken.  Only ever touched on the main thread: buffers
+ * are taken by the save entry points and returned by task callbacks,
+ * which the queue runs on the thread that gathers it, never on the
+ * worker.  Holds nothing while save_state_disable_undo is set, for
+ * the reason the undo spare does not. */
+#define STATE_BUF_POOL_SIZE 2
+static struct
+{
+   void  *data;
+   size_t capacity;
+} state_buf_pool[STATE_BUF_POOL_SIZE];
+
 /* Buffer that stores state instead of file.
  * This is useful for devices with slow I/O. */
 static struct ram_save_state_buf ram_buf;
@@ -183,6 +241,13 @@ static bool save_state_in_background       = false;
  * not a task_queue_find(). */
 static bool load_state_task_pending        = false;
 static bool save_state_disable_undo        = false;
+/* The interval autosave's file, while its task writes it.  That task
+ * does not block the queue, so slot saves and loads go ahead beside
+ * it; only one on the same file is refused.  A flag for the same
+ * reason as load_state_task_pending: set on push, cleared in the
+ * callback, both on the main thread. */
+static bool autosave_task_pending          = false;
+static char autosave_task_path[PATH_MAX_LENGTH];
 
 /* Time tracking for automatic savestate interval */
 static time_t last_savestate_automatic_time = 0;
@@ -425,7 +490,11 @@ static void task_save_handler_finished(retro_task_t *task,
       task_set_data(task, task_data);
    }
 
-   if (state->data)
+   /* A snapshot's buffer is not the task's to free, and this may be
+    * the worker thread; the callback drops the reference instead. */
+   if (state->snapshot)
+      state->data = NULL;
+   else if (state->data)
    {
       if (     (state->flags & SAVE_TASK_FLAG_UNDO_SAVE)
             && (state->data == undo_save_buf.data))
@@ -671,6 +740,111 @@ static size_t content_serialize_reusing(void **buf, size_t *cap)
    return size.total_size;
 }
 
+/* Hands out the largest retained buffer (possibly NULL, with *cap 0):
+ * content_serialize_reusing() grows it if even that is short. */
+static void *state_buf_pool_take(size_t *cap)
+{
+   unsigned i;
+   void *data;
+   unsigned best = 0;
+
+   for (i = 1; i < STATE_BUF_POOL_SIZE; i++)
+      if (state_buf_pool[i].capacity > state_buf_pool[best].capacity)
+         best = i;
+
+   data                          = state_buf_pool[best].data;
+   *cap                          = state_buf_pool[best].capacity;
+   state_buf_pool[best].data     = NULL;
+   state_buf_pool[best].capacity = 0;
+   return data;
+}
+
+static void state_buf_pool_give(void *data, size_t cap)
+{
+   unsigned i;
+
+   if (data && !save_state_disable_undo)
+   {
+      for (i = 0; i < STATE_BUF_POOL_SIZE; i++)
+      {
+         if (!state_buf_pool[i].data)
+         {
+            state_buf_pool[i].data     = data;
+            state_buf_pool[i].capacity = cap;
+            return;
+         }
+      }
+   }
+
+   free(data);
+}
+
+static void state_buf_pool_clear(void)
+{
+   unsigned i;
+
+   for (i = 0; i < STATE_BUF_POOL_SIZE; i++)
+   {
+      free(state_buf_pool[i].data);
+      state_buf_pool[i].data     = NULL;
+      state_buf_pool[i].capacity = 0;
+   }
+}
+
+/**
+ * state_snapshot_acquire:
+ *
+ * Takes a reference to a snapshot of the current state: the one
+ * already taken this generation if anyone still holds it, otherwise a
+ * new one serialized into a pooled buffer.
+ *
+ * @return the snapshot, to be dropped with state_snapshot_release(),
+ * or NULL if the core could not serialize.
+ **/
+static struct state_snapshot *state_snapshot_acquire(void)
+{
+   struct state_snapshot *snap = state_snapshot_shared;
+
+   if (snap && snap->generation == state_snapshot_generation)
+   {
+      snap->refs++;
+      return snap;
+   }
+
+   if (!(snap = (struct state_snapshot*)calloc(1, sizeof(*snap))))
+      return NULL;
+
+   snap->data = state_buf_pool_take(&snap->capacity);
+   if (!(snap->size = content_serialize_reusing(&snap->data,
+               &snap->capacity)))
+   {
+      state_buf_pool_give(snap->data, snap->capacity);
+      free(snap);
+      return NULL;
+   }
+
+   snap->generation      = state_snapshot_generation;
+   snap->refs            = 1;
+   state_snapshot_shared = snap;
+   return snap;
+}
+
+static void state_snapshot_release(struct state_snapshot *snap)
+{
+   if (!snap || --snap->refs)
+      return;
+
+   if (state_snapshot_shared == snap)
+      state_snapshot_shared = NULL;
+   state_buf_pool_give(snap->data, snap->capacity);
+   free(snap);
+}
+
+void content_state_snapshot_invalidate(void)
+{
+   state_snapshot_generation++;
+}
+
 /**
  * task_save_handler:
  * @task : the task being worked on
@@ -713,8 +887,9 @@ static void task_save_handler(retro_task_t *task)
    if (!state->file)
    {
       if (state->flags & SAVE_TASK_FLAG_COMPRESS_FILES)
-         state->file   = intfstream_open_rzip_file(
-               state->path, RETRO_VFS_FILE_ACCESS_WRITE);
+         state->file   = intfstream_open_rzip_file_codec(
+               state->path, RETRO_VFS_FILE_ACCESS_WRITE,
+               state->codec, state->level);
       else
          state->file   = intfstream_open_file(
                state->path, RETRO_VFS_FILE_ACCESS_WRITE,
@@ -828,6 +1003,29 @@ static void task_save_handler(retro_task_t *task)
    }
 }
 
+/**
+ * task_save_set_compression:
+ * @state    : the task state
+ * @settings : current settings
+ *
+ * Flags @state to compress what it writes, with the configured
+ * codec, if save states are compressed at all.
+ **/
+static void task_save_set_compression(save_task_state_t *state,
+      const settings_t *settings)
+{
+#if defined(HAVE_COMPRESSION)
+   if (!settings->bools.savestate_file_compression)
+      return;
+   state->flags |= SAVE_TASK_FLAG_COMPRESS_FILES;
+   if (settings->bools.save_compression_zstd)
+   {
+      state->codec = RZIP_CODEC_ZSTD;
+      state->level = (int)settings->uints.save_compression_zstd_level;
+   }
+#endif
+}
+
 /**
  * task_push_undo_save_state:
  * @path : file path of the save state
@@ -853,10 +1051,7 @@ static bool task_push_undo_save_state(const char *path, void *data, size_t len)
       state->state_slot     = settings->ints.state_slot;
       if (video_driver_cached_frame_is_hw_render())
          state->flags      |= SAVE_TASK_FLAG_HAS_VALID_FB;
-#if defined(HAVE_COMPRESSION)
-      if (settings->bools.savestate_file_compression)
-         state->flags      |= SAVE_TASK_FLAG_COMPRESS_FILES;
-#endif
+      task_save_set_compression(state, settings);
       if (!settings->bools.notification_show_save_state)
          state->flags      |= SAVE_TASK_FLAG_MUTE;
 
@@ -1471,6 +1666,11 @@ static void save_state_cb(retro_task_t *task,
       void *user_data, const char *error)
 {
    save_task_state_t *state   = (save_task_state_t*)task_data;
+
+   /* The snapshot the task wrote, if any.  Dropped through user_data
+    * rather than task_data so that it is dropped on OOM too. */
+   state_snapshot_release((struct state_snapshot*)user_data);
+
    /* NULL-check: task_save_handler_finished may fail to alloc
     * the task_data copy on OOM and leave it NULL.  Skip the
     * screenshot hook and free(state) on NULL - free(NULL) is a
@@ -1491,15 +1691,33 @@ static void save_state_cb(retro_task_t *task,
    free(state);
 }
 
+/* True if the interval autosave is still writing @path */
+static bool autosave_task_writing(const char *path)
+{
+   return autosave_task_pending && !strcmp(path, autosave_task_path);
+}
+
+static void autosave_state_cb(retro_task_t *task,
+      void *task_data,
+      void *user_data, const char *error)
+{
+   autosave_task_pending = false;
+   save_state_cb(task, task_data, user_data, error);
+}
+
 /**
  * task_push_save_state:
  * @path : file path of the save state
- * @data : the save state data to write
- * @size : the total size of the save state
+ * @snap : the snapshot to write, or NULL to serialize in the task
+ * @autosave : whether this is the automatic slot
  *
- * Create a new task to save the content state.
+ * Create a new task to save the content state.  Takes over the
+ * caller's reference to @snap, whether or not the task is queued.
+ *
+ * Returns: true if the task was queued.
  **/
-static void task_push_save_state(const char *path, void *data, size_t len, bool autosave)
+static bool task_push_save_state(const char *path,
+      struct state_snapshot *snap, bool autosave)
 {
    settings_t     *settings        = config_get_ptr();
    retro_task_t       *task        = task_init();
@@ -1508,35 +1726,56 @@ static void task_push_save_state(const char *path, void *data, size_t len, bool
    if (!task || !state)
       goto error;
 
+   /* Two writers of one file would interleave their chunks */
+   if (!autosave && autosave_task_writing(path))
+   {
+      RARCH_WARN("[State] \"%s\" is being autosaved; try again.\n", path);
+      goto error;
+   }
+
    strlcpy(state->path, path, sizeof(state->path));
-   state->data                   = data;
-   state->size                   = len;
+   if (snap)
+   {
+      state->snapshot            = snap;
+      state->data                = snap->data;
+      state->size                = (ssize_t)snap->size;
+   }
    /* Don't show OSD messages if we are auto-saving */
    if (autosave)
       state->flags              |= (  SAVE_TASK_FLAG_AUTOSAVE
                                     | SAVE_TASK_FLAG_MUTE);
+   if (!settings->bools.notification_show_save_state)
+      state->flags              |= SAVE_TASK_FLAG_MUTE;
    if (settings->bools.savestate_thumbnail_enable)
    {
       /* Delay OSD messages and widgets for a few frames
-       * to prevent GPU screenshots from having notifications */
-      runloop_state_t *runloop_st = runloop_state_get_ptr();
-      runloop_st->msg_queue_delay = 12;
+       * to prevent GPU screenshots from having notifications.
+       * A muted save has none, and holding back everyone else's
+       * every interval would only make them late. */
+      if (!(state->flags & SAVE_TASK_FLAG_MUTE))
+      {
+         runloop_state_t *runloop_st = runloop_state_get_ptr();
+         runloop_st->msg_queue_delay = 12;
+      }
       state->flags               |= SAVE_TASK_FLAG_THUMBNAIL_ENABLE;
    }
-   state->state_slot             = settings->ints.state_slot;
+   /* The automatic slot is -1 to runloop_get_savestate_path() */
+   state->state_slot             = autosave ? -1 : settings->ints.state_slot;
    if (video_driver_cached_frame_is_hw_render())
       state->flags              |= SAVE_TASK_FLAG_HAS_VALID_FB;
-#if defined(HAVE_COMPRESSION)
-   if (settings->bools.savestate_file_compression)
-      state->flags              |= SAVE_TASK_FLAG_COMPRESS_FILES;
-#endif
-   if (!settings->bools.notification_show_save_state)
-      state->flags              |= SAVE_TASK_FLAG_MUTE;
-
-   task->type                    = TASK_TYPE_BLOCKING;
+   task_save_set_compression(state, settings);
+
+   /* The interval autosave does not take the blocking slot: a slot
+    * save or load the user asks for while it writes must not be
+    * refused for it.  content_save_state_automatic() does not start
+    * one while another save or a load is in flight. */
+   task->type                    = autosave
+      ? TASK_TYPE_NONE : TASK_TYPE_BLOCKING;
    task->state                   = state;
    task->handler                 = task_save_handler;
-   task->callback                = save_state_cb;
+   task->callback                = autosave
+      ? autosave_state_cb : save_state_cb;
+   task->user_data               = snap;
    task->title                   = strdup(msg_hash_to_str(MSG_SAVING_STATE));
 
    if (state->flags & SAVE_TASK_FLAG_MUTE)
@@ -1547,19 +1786,24 @@ static void task_push_save_state(const char *path, void *data, size_t len, bool
    if (!task_queue_push(task))
    {
       /* Another blocking task is already active. */
-      if (data)
-         free(data);
+      state_snapshot_release(snap);
       if (task->title)
          task_free_title(task);
       free(task);
       free(state);
+      return false;
    }
 
-   return;
+   if (autosave)
+   {
+      autosave_task_pending = true;
+      strlcpy(autosave_task_path, path, sizeof(autosave_task_path));
+   }
+
+   return true;
 
 error:
-   if (data)
-      free(data);
+   state_snapshot_release(snap);
    if (state)
       free(state);
    if (task)
@@ -1568,6 +1812,7 @@ error:
          task_free_title(task);
       free(task);
    }
+   return false;
 }
 
 /**
@@ -1581,30 +1826,28 @@ static void content_load_and_save_state_cb(retro_task_t *task,
       void *user_data, const char *error)
 {
    load_task_data_t *load_data = (load_task_data_t*)task_data;
+   struct state_snapshot *snap = (struct state_snapshot*)user_data;
    char                  *path;
-   void                  *data;
-   size_t                 size;
    bool               autosave;
 
    /* NULL-check load_data: task_load_handler_finished may have
     * failed to allocate the task_data copy on OOM.  Delegate the
     * NULL-safe no-op to content_load_state_cb (which already
     * handles NULL via its own guard) and skip the subsequent
-    * save push which would NULL-deref ->path / ->undo_data. */
+    * save push which would NULL-deref ->path. */
    if (!load_data)
    {
       content_load_state_cb(task, task_data, user_data, error);
+      state_snapshot_release(snap);
       return;
    }
 
    path     = strdup(load_data->path);
-   data     = load_data->undo_data;
-   size     = load_data->undo_size;
    autosave = (load_data->flags & SAVE_TASK_FLAG_AUTOSAVE) ? true : false;
 
    content_load_state_cb(task, task_data, user_data, error);
 
-   task_push_save_state(path, data, size, autosave);
+   task_push_save_state(path, snap, autosave);
 
    free(path);
 }
@@ -1612,26 +1855,36 @@ static void content_load_and_save_state_cb(retro_task_t *task,
 /**
  * task_push_load_and_save_state:
  * @path : file path of the save state
- * @data : the save state data to write
- * @size : the total size of the save state
+ * @snap : the snapshot to write, or NULL to serialize in the save task
  * @load_to_backup_buffer : If true, the state will be loaded into undo_save_buf.
  *
  * Create a new task to load current state first into a backup buffer (for undo)
- * and then save the content state.
+ * and then save the content state.  Takes over the caller's reference
+ * to @snap, which rides to the save task as the load task's user_data.
  **/
-static void task_push_load_and_save_state(const char *path, void *data,
-      size_t len, bool load_to_backup_buffer, bool autosave)
+static void task_push_load_and_save_state(const char *path,
+      struct state_snapshot *snap, bool load_to_backup_buffer, bool autosave)
 {
    retro_task_t      *task        = NULL;
    settings_t        *settings    = config_get_ptr();
    save_task_state_t *state       = (save_task_state_t*)
       calloc(1, sizeof(*state));
 
-   if (!state)
+   /* It would read, for undo, a file the autosave is part way
+    * through writing, then write over it */
+   if (!state || autosave_task_writing(path))
+   {
+      if (state)
+         RARCH_WARN("[State] \"%s\" is being autosaved; try again.\n",
+               path);
+      state_snapshot_release(snap);
+      free(state);
       return;
+   }
 
    if (!(task = task_init()))
    {
+      state_snapshot_release(snap);
       free(state);
       return;
    }
@@ -1640,8 +1893,6 @@ static void task_push_load_and_save_state(const char *path, void *data,
    strlcpy(state->path, path, sizeof(state->path));
    if (load_to_backup_buffer)
       state->flags             |= SAVE_TASK_FLAG_LOAD_TO_BACKUP_BUFF;
-   state->undo_size             = len;
-   state->undo_data             = data;
    /* Don't show OSD messages if we are auto-saving */
    if (autosave)
       state->flags             |= ( SAVE_TASK_FLAG_AUTOSAVE
@@ -1651,10 +1902,7 @@ static void task_push_load_and_save_state(const char *path, void *data,
    state->state_slot            = settings->ints.state_slot;
    if (video_driver_cached_frame_is_hw_render())
       state->flags             |= SAVE_TASK_FLAG_HAS_VALID_FB;
-#if defined(HAVE_COMPRESSION)
-   if (settings->bools.savestate_file_compression)
-      state->flags             |= SAVE_TASK_FLAG_COMPRESS_FILES;
-#endif
+   task_save_set_compression(state, settings);
    if (!settings->bools.notification_show_save_state)
       state->flags             |= SAVE_TASK_FLAG_MUTE;
 
@@ -1662,6 +1910,7 @@ static void task_push_load_and_save_state(const char *path, void *data,
    task->type                   = TASK_TYPE_BLOCKING;
    task->handler                = task_load_handler;
    task->callback               = content_load_and_save_state_cb;
+   task->user_data              = snap;
    task->title                  = strdup(msg_hash_to_str(MSG_LOADING_STATE));
 
    load_state_task_pending      = true;
@@ -1676,8 +1925,7 @@ static void task_push_load_and_save_state(const char *path, void *data,
       /* Another blocking task is already active.  No callback will
        * run for this task, so clear the flag here. */
       load_state_task_pending   = false;
-      if (data)
-         free(data);
+      state_snapshot_release(snap);
       if (task->title)
          task_free_title(task);
       free(task);
@@ -1697,9 +1945,9 @@ static void task_push_load_and_save_state(const char *path, void *data,
 bool content_auto_save_state(const char *path)
 {
    size_t _len;
-   settings_t *settings = config_get_ptr();
-   void *serial_data    = NULL;
-   intfstream_t *file   = NULL;
+   settings_t *settings        = config_get_ptr();
+   struct state_snapshot *snap = NULL;
+   intfstream_t *file          = NULL;
 
    if (!core_info_current_supports_savestate())
    {
@@ -1712,13 +1960,20 @@ bool content_auto_save_state(const char *path)
    if (_len == 0)
       return false;
 
-   serial_data = content_get_serialized_data(&_len);
-   if (!serial_data)
+   /* A snapshot still held from this frame (a RAM state, a slot save
+    * in flight) is this state already; share it. */
+   if (!(snap = state_snapshot_acquire()))
       return false;
+   _len = snap->size;
 
 #if defined(HAVE_COMPRESSION)
    if (settings->bools.savestate_file_compression)
-      file = intfstream_open_rzip_file(path, RETRO_VFS_FILE_ACCESS_WRITE);
+      file = intfstream_open_rzip_file_codec(path,
+            RETRO_VFS_FILE_ACCESS_WRITE,
+            settings->bools.save_compression_zstd
+            ? RZIP_CODEC_ZSTD : RZIP_CODEC_DEFLATE,
+            settings->bools.save_compression_zstd
+            ? (int)settings->uints.save_compression_zstd_level : 0);
    else
 #endif
       file = intfstream_open_file(path, RETRO_VFS_FILE_ACCESS_WRITE,
@@ -1726,20 +1981,20 @@ bool content_auto_save_state(const char *path)
 
    if (!file)
    {
-      free(serial_data);
+      state_snapshot_release(snap);
       return false;
    }
 
-   if (_len != (size_t)intfstream_write(file, serial_data, _len))
+   if (_len != (size_t)intfstream_write(file, snap->data, _len))
    {
       intfstream_close(file);
-      free(serial_data);
+      state_snapshot_release(snap);
       free(file);
       return false;
    }
 
    intfstream_close(file);
-   free(serial_data);
+   state_snapshot_release(snap);
    free(file);
 
 #ifdef HAVE_SCREENSHOTS
@@ -1766,7 +2021,7 @@ bool content_auto_save_state(const char *path)
 bool content_save_state(const char *path, bool save_to_disk)
 {
    size_t _len;
-   void *data  = NULL;
+   struct state_snapshot *snap = NULL;
 
    if (!save_to_disk && save_state_disable_undo)
       return false;
@@ -1786,8 +2041,8 @@ bool content_save_state(const char *path, bool save_to_disk)
     * hottest serialize the frontend does, and it is the one where the
     * destination can be kept between calls: nothing outside this
     * function owns undo_load_buf's allocation.  Split out ahead of
-    * the disk path, which cannot reuse anything - it hands its buffer
-    * to a task that takes ownership of it. */
+    * the disk path, which hands its buffer to a task and so takes a
+    * pooled, shared snapshot instead; see state_snapshot_acquire(). */
    if (!save_to_disk)
    {
       if (!(_len = content_serialize_reusing(&undo_load_spare.data,
@@ -1832,13 +2087,14 @@ bool content_save_state(const char *path, bool save_to_disk)
 
    if (!save_state_in_background)
    {
-      if (!(data = content_get_serialized_data(&_len)))
+      if (!(snap = state_snapshot_acquire()))
       {
          RARCH_ERR("[State] %s \"%s\".\n",
                msg_hash_to_str(MSG_FAILED_TO_SAVE_STATE_TO),
                path);
          return false;
       }
+      _len = snap->size;
 
       RARCH_LOG("[State] %s \"%s\", %u %s.\n",
             msg_hash_to_str(MSG_SAVING_STATE),
@@ -1854,10 +2110,10 @@ bool content_save_state(const char *path, bool save_to_disk)
       /* TODO/FIXME - Use msg_hash_to_str here */
       RARCH_LOG("[State] %s...\n",
             msg_hash_to_str(MSG_FILE_ALREADY_EXISTS_SAVING_TO_BACKUP_BUFFER));
-      task_push_load_and_save_state(path, data, _len, true, false);
+      task_push_load_and_save_state(path, snap, true, false);
    }
    else
-      task_push_save_state(path, data, _len, false);
+      task_push_save_state(path, snap, false);
 
    return true;
 }
@@ -1960,6 +2216,13 @@ bool content_load_state(const char *path,
       goto error;
    }
 
+   /* Only part of it is written yet */
+   if (autosave_task_writing(path))
+   {
+      RARCH_WARN("[State] \"%s\" is being autosaved; try again.\n", path);
+      goto error;
+   }
+
    task  = task_init();
    state = (save_task_state_t*)calloc(1, sizeof(*state));
 
@@ -1974,10 +2237,7 @@ bool content_load_state(const char *path,
    state->state_slot            = settings->ints.state_slot;
    if (video_driver_cached_frame_is_hw_render())
       state->flags             |= SAVE_TASK_FLAG_HAS_VALID_FB;
-#if defined(HAVE_COMPRESSION)
-   if (settings->bools.savestate_file_compression)
-      state->flags             |= SAVE_TASK_FLAG_COMPRESS_FILES;
-#endif
+   task_save_set_compression(state, settings);
    if (!settings->bools.notification_show_save_state)
       state->flags             |= SAVE_TASK_FLAG_MUTE;
 
@@ -2059,12 +2319,14 @@ void content_reset_savestate_backups(void)
 
    undo_load_spare.capacity = 0;
 
-   if (ram_buf.state_buf.data)
-   {
-      free(ram_buf.state_buf.data);
-      ram_buf.state_buf.data     = NULL;
-      ram_buf.state_buf.capacity = 0;
-   }
+   state_snapshot_release(ram_buf.snapshot);
+   ram_buf.snapshot           = NULL;
+   ram_buf.state_buf.data     = NULL;
+
+   /* After the RAM state's release, so its buffer goes too.  A save
+    * still in flight returns its buffer after this; the pool keeps it
+    * until the next reset. */
+   state_buf_pool_clear();
 
    ram_buf.state_buf.path[0]  = '\0';
    ram_buf.state_buf.size     = 0;
@@ -2135,7 +2397,7 @@ bool content_load_state_from_ram(void)
 bool content_save_state_to_ram(void)
 {
    size_t _len;
-   void *data  = NULL;
+   struct state_snapshot *snap = NULL;
 
    if (!core_info_current_supports_savestate())
    {
@@ -2153,27 +2415,30 @@ bool content_save_state_to_ram(void)
          (unsigned)_len,
          msg_hash_to_str(MSG_BYTES));
 
-   if (save_state_disable_undo && ram_buf.state_buf.data)
+   if (save_state_disable_undo && ram_buf.snapshot)
    {
       /* Undo off means lack of memory, free before we alloc the new one */
-      free(ram_buf.state_buf.data);
+      state_snapshot_release(ram_buf.snapshot);
+      ram_buf.snapshot           = NULL;
       ram_buf.state_buf.data     = NULL;
       ram_buf.state_buf.capacity = 0;
    }
 
-   if (!(data = content_get_serialized_data(&_len)))
+   if (!(snap = state_snapshot_acquire()))
    {
       RARCH_ERR("[State] %s.\n",
             msg_hash_to_str(MSG_FAILED_TO_SAVE_SRAM));
       return false;
    }
 
-   if (ram_buf.state_buf.data)
-      free(ram_buf.state_buf.data);
+   /* Acquire before release: a RAM state taken twice in one frame is
+    * the same snapshot, and dropping it first would lose it. */
+   state_snapshot_release(ram_buf.snapshot);
 
-   ram_buf.state_buf.data     = data;
-   ram_buf.state_buf.size     = _len;
-   ram_buf.state_buf.capacity = _len;
+   ram_buf.snapshot           = snap;
+   ram_buf.state_buf.data     = snap->data;
+   ram_buf.state_buf.size     = snap->size;
+   ram_buf.state_buf.capacity = snap->capacity;
    ram_buf.to_write_file      = true;
 
    return true;
@@ -2197,8 +2462,12 @@ bool content_ram_state_to_file(const char *path)
       settings_t *settings = config_get_ptr();
       if (settings->bools.save_file_compression)
       {
-         if (rzipstream_write_file(
-               path, ram_buf.state_buf.data, ram_buf.state_buf.size))
+         if (rzipstream_write_file_codec(
+               path, ram_buf.state_buf.data, ram_buf.state_buf.size,
+               settings->bools.save_compression_zstd
+               ? RZIP_CODEC_ZSTD : RZIP_CODEC_DEFLATE,
+               settings->bools.save_compression_zstd
+               ? (int)settings->uints.save_compression_zstd_level : 0))
             goto success;
       }
       else
@@ -2231,12 +2500,12 @@ bool content_save_state_automatic(void)
 {
    time_t current_time;
    char savestate_path[PATH_MAX_LENGTH];
+   struct state_snapshot *snap = NULL;
    settings_t *settings = config_get_ptr();
    unsigned savestate_automatic_interval = 
       settings->uints.savestate_automatic_interval;
    
-   /* Return early if automatic savestate is disabled,
-      safety checks already happen in content_auto_save_state() */
+   /* Return early if automatic savestate is disabled */
    if (savestate_automatic_interval == 0)
       return false;
    
@@ -2261,8 +2530,40 @@ bool content_save_state_automatic(void)
          msg_hash_to_str(MSG_SAVING_STATE),
          savestate_path);
    
+   /* Not beside another save or a load: the previous autosave may
+    * still be writing this file, and a load may be about to replace
+    * the state this would serialize.  Leaving the time alone retries
+    * on the next frame. */
+   if (     load_state_task_pending
+         || content_save_state_in_progress(NULL))
+      return false;
+
    /* Update the last savestate time, rinse/repeat */
    last_savestate_automatic_time = current_time;
-   
-   return content_auto_save_state(savestate_path);
+
+   if (!core_info_current_supports_savestate())
+   {
+      RARCH_LOG("[State] %s\n",
+            msg_hash_to_str(MSG_CORE_DOES_NOT_SUPPORT_SAVESTATES));
+      return false;
+   }
+
+   if (core_serialize_size() == 0)
+      return false;
+
+   /* This used to be content_auto_save_state(), which serializes and
+    * then writes - and with savestate_file_compression, compresses -
+    * the whole state on the main thread, stalling a frame every
+    * interval.  Only the serialize has to happen here; the write goes
+    * to a task like a slot save's, sharing the snapshot if a slot
+    * save or RAM state took one this frame. */
+   if (!(snap = state_snapshot_acquire()))
+   {
+      RARCH_ERR("[State] %s \"%s\".\n",
+            msg_hash_to_str(MSG_FAILED_TO_SAVE_STATE_TO),
+            savestate_path);
+      return false;
+   }
+
+   return task_push_save_state(savestate_path, snap, true);
 }
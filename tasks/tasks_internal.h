@@ -340,6 +340,7 @@ bool take_screenshot(
 bool event_load_save_files(bool is_sram_load_disabled);
 
 bool event_save_files(bool sram_used, bool compress_files,
+      bool compress_zstd, unsigned compress_level,
       const char *path_cheat_database);
 
 void path_init_savefile_rtc(const char *savefile_path);
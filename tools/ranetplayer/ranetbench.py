@@ -0,0 +1,225 @@
+#!/usr/bin/env python3
+"""
+ranetbench -- benchmark netplay rollback settings against a recorded trace.
+
+Usage, from the repository root:
+    python3 tools/ranetplayer/ranetbench.py --retroarch ./retroarch \\
+        --core <core> --content <content> --trace session.ranp \\
+        --set low:netplay_input_latency_frames_min=0 \\
+        --set high:netplay_input_latency_frames_min=2
+
+For every --set, starts two headless RetroArch instances on this machine,
+a host and a client connected to it, and has ranetplayer play the trace
+into the host as a further player, --ahead frames off the host's clock to
+force rollbacks. Each instance runs --frames frames and exits; at exit
+netplay logs its rollback profile (frames re-run, and time spent saving,
+loading, replaying, on network I/O and stalled, per frame), which this
+collects into one table.
+
+Record a trace with ranetplayer itself:
+    tools/ranetplayer/ranetplayer -H <host> -r session.ranp
+
+Without --trace the two instances play idle; rollbacks then come only from
+the client's own input arriving late.
+
+Standard library only. Exits non-zero if an instance failed to report.
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import time
+
+PROFILE_RE = re.compile(r"\[Netplay\] Rollback profile: (.*)$")
+
+# Everything an instance needs to run with nobody watching.
+HEADLESS = {
+    "video_driver": "null",
+    "audio_driver": "null",
+    "input_driver": "null",
+    "menu_driver": "null",
+    "pause_nonactive": "false",
+    "netplay_public_announce": "false",
+    "netplay_nat_traversal": "false",
+    "config_save_on_exit": "false",
+    # With no display to sync to, pace frames to the core's rate.
+    "vrr_runloop_enable": "true",
+}
+
+COLUMNS = [
+    ("frames", "frames"),
+    ("rollbacks", "rollbk"),
+    ("replayed", "re-run"),
+    ("max_replayed", "max"),
+    ("stalled", "stalled"),
+    ("serialize_us", "save us"),
+    ("unserialize_us", "load us"),
+    ("replay_us", "replay us"),
+    ("net_us", "net us"),
+    ("stall_us", "stall us"),
+]
+
+
+def parse_set(arg):
+    """name:key=value,key=value -> (name, {key: value})"""
+    name, _, rest = arg.partition(":")
+    if not rest:
+        raise argparse.ArgumentTypeError("expected NAME:KEY=VALUE[,...]")
+    keys = {}
+    for pair in rest.split(","):
+        key, eq, value = pair.partition("=")
+        if not eq:
+            raise argparse.ArgumentTypeError("expected KEY=VALUE, got " + pair)
+        keys[key.strip()] = value.strip()
+    return name, keys
+
+
+def write_config(path, keys):
+    with open(path, "w") as f:
+        for key, value in sorted(keys.items()):
+            f.write('%s = "%s"\n' % (key, value))
+
+
+def read_profile(log_path):
+    """The last rollback profile in a log, as {key: int}, or None."""
+    profile = None
+    try:
+        with open(log_path) as f:
+            for line in f:
+                m = PROFILE_RE.search(line.rstrip())
+                if m:
+                    profile = dict((k, int(v)) for k, v in
+                                   (kv.split("=") for kv in m.group(1).split()))
+    except (IOError, OSError):
+        pass
+    return profile
+
+
+def spawn(argv, verbose):
+    if verbose:
+        print("  $ " + " ".join(argv))
+    return subprocess.Popen(argv, stdout=subprocess.DEVNULL,
+                            stderr=subprocess.DEVNULL)
+
+
+def wait_all(procs, timeout):
+    deadline = time.time() + timeout
+    for p in procs:
+        while p.poll() is None and time.time() < deadline:
+            time.sleep(0.1)
+    for p in procs:
+        if p.poll() is None:
+            p.terminate()
+            try:
+                p.wait(5)
+            except subprocess.TimeoutExpired:
+                p.kill()
+
+
+def run_variant(args, name, keys, run, out_dir):
+    tag = "%s.%d" % (name, run)
+    cfg = os.path.join(out_dir, tag + ".cfg")
+    settings = dict(HEADLESS)
+    settings.update(keys)
+    write_config(cfg, settings)
+
+    common = [args.retroarch, "--verbose", "--appendconfig", cfg,
+              "-L", args.core, "--port", str(args.port),
+              "--max-frames", str(args.frames)]
+    logs = {"host": os.path.join(out_dir, tag + ".host.log"),
+            "client": os.path.join(out_dir, tag + ".client.log")}
+
+    print("%s: run %d" % (name, run))
+    host = spawn(common + ["--log-file", logs["host"], "--host",
+                           "--nick", "bench-host", args.content],
+                 args.verbose)
+    time.sleep(args.settle)
+    client = spawn(common + ["--log-file", logs["client"],
+                             "--connect", "127.0.0.1",
+                             "--nick", "bench-client", args.content],
+                   args.verbose)
+    player = None
+    if args.trace:
+        time.sleep(args.settle)
+        player = spawn([args.ranetplayer, "-H", "127.0.0.1",
+                        "-P", str(args.port), "-p", args.trace,
+                        "-a", str(args.ahead)], args.verbose)
+
+    wait_all([host, client], args.timeout)
+    if player:
+        wait_all([player], 0)
+
+    return dict((who, read_profile(path)) for who, path in logs.items())
+
+
+def print_table(rows):
+    head = "%-16s %-6s" % ("variant", "side") + "".join(
+        " %9s" % title for _, title in COLUMNS)
+    print()
+    print(head)
+    print("-" * len(head))
+    for name, who, profile in rows:
+        if profile is None:
+            print("%-16s %-6s  (no profile logged)" % (name, who))
+            continue
+        print("%-16s %-6s" % (name, who) + "".join(
+            " %9d" % profile.get(key, 0) for key, _ in COLUMNS))
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    p = argparse.ArgumentParser(
+        description="Benchmark netplay rollback settings on one machine.")
+    p.add_argument("--retroarch", default="./retroarch",
+                   help="RetroArch binary (default ./retroarch)")
+    p.add_argument("--core", required=True, help="libretro core to load")
+    p.add_argument("--content", required=True, help="content to run")
+    p.add_argument("--trace", help="ranetplayer recording to play in")
+    p.add_argument("--ranetplayer", default=os.path.join(here, "ranetplayer"),
+                   help="ranetplayer binary (default: built next to this)")
+    p.add_argument("--ahead", type=int, default=-2,
+                   help="frames the trace plays ahead of the host; "
+                        "negative forces rollbacks (default -2)")
+    p.add_argument("--set", dest="sets", action="append", type=parse_set,
+                   default=[], metavar="NAME:KEY=VALUE[,...]",
+                   help="a variant: retroarch.cfg keys to run with; "
+                        "repeat to compare several")
+    p.add_argument("--frames", type=int, default=3600,
+                   help="frames each instance runs (default 3600)")
+    p.add_argument("--runs", type=int, default=1,
+                   help="runs per variant (default 1)")
+    p.add_argument("--port", type=int, default=55435)
+    p.add_argument("--settle", type=float, default=2.0,
+                   help="seconds between starting instances (default 2)")
+    p.add_argument("--timeout", type=float, default=600.0,
+                   help="seconds to wait for a run (default 600)")
+    p.add_argument("--out-dir", help="keep configs and logs here")
+    p.add_argument("-v", "--verbose", action="store_true")
+    args = p.parse_args()
+
+    if args.trace and not os.path.exists(args.ranetplayer):
+        p.error("no ranetplayer at %s; build it with make -C %s"
+                % (args.ranetplayer, here))
+
+    sets = args.sets or [("default", {})]
+    out_dir = args.out_dir or tempfile.mkdtemp(prefix="ranetbench.")
+    if not os.path.isdir(out_dir):
+        os.makedirs(out_dir)
+
+    rows = []
+    for name, keys in sets:
+        for run in range(args.runs):
+            profiles = run_variant(args, name, keys, run, out_dir)
+            for who in ("host", "client"):
+                rows.append((name, who, profiles[who]))
+
+    print_table(rows)
+    print("\nlogs and configs: " + out_dir)
+    return 1 if any(profile is None for _, _, profile in rows) else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())